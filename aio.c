@@ -0,0 +1,602 @@
+/*
+ * aio.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "aio.h"
+#include "kstdio.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "hal.h"
+#include "mm.h"
+#include "string.h"
+#include "stdlib.h"
+
+/* Queues served by threads */
+static K_IO_QUEUE	*aio_queues[AIO_MAX_QUEUES];
+static K_SPINLOCK	aio_lock;
+
+/* Serves streams without native async support */
+static K_IO_QUEUE	aio_generic_queue;
+
+/*
+ * Prototypes
+ */
+static K_IO_QUEUE *aio_claim_queue();
+static K_IO_REQUEST *aio_queue_pop(K_IO_QUEUE *q);
+static void __nxapi aio_queue_thread();
+static HRESULT __nxapi aio_generic_service(K_IO_QUEUE *q, K_IO_REQUEST *req);
+
+HRESULT __nxapi aio_initialize()
+{
+	memset(aio_queues, 0, sizeof(aio_queues));
+	spinlock_create(&aio_lock);
+
+	return aio_queue_create(&aio_generic_queue, AIO_DEFAULT_QUEUE_DEPTH, aio_generic_service, NULL, AIO_WORKER_THREADS);
+}
+
+HRESULT __nxapi aio_queue_create(K_IO_QUEUE *q, uint32_t max_depth, K_IO_SERVICE service, void *context, uint32_t thread_count)
+{
+	uint32_t	slot, intf;
+	HRESULT		hr;
+
+	if (!q || !service) {
+		return E_POINTER;
+	}
+
+	if (max_depth == 0 || thread_count == 0) {
+		return E_INVALIDARG;
+	}
+
+	memset(q, 0, sizeof(K_IO_QUEUE));
+	q->max_depth		= max_depth;
+	q->service			= service;
+	q->context			= context;
+	q->threads_wanted	= thread_count;
+
+	event_create(&q->event, EVENT_FLAG_NONE);
+	spinlock_create(&q->lock);
+
+	/* Register the queue, so threads can claim it */
+	intf = spinlock_acquire(&aio_lock);
+
+	for (slot=0; slot<AIO_MAX_QUEUES; slot++) {
+		if (aio_queues[slot] == NULL) break;
+	}
+
+	if (slot < AIO_MAX_QUEUES) {
+		aio_queues[slot] = q;
+	}
+
+	spinlock_release(&aio_lock, intf);
+
+	if (slot == AIO_MAX_QUEUES) {
+		return E_OUTOFMEM;
+	}
+
+	for (uint32_t i=0; i<thread_count; i++) {
+		hr = sched_create_thread(NULL, aio_queue_thread, NULL);
+		if (FAILED(hr)) return hr;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Threads don't receive arguments, so a new thread picks the first
+ * queue which still lacks some of it's threads.
+ */
+static K_IO_QUEUE *aio_claim_queue()
+{
+	K_IO_QUEUE	*q = NULL;
+	uint32_t	intf;
+
+	intf = spinlock_acquire(&aio_lock);
+
+	for (uint32_t i=0; i<AIO_MAX_QUEUES; i++) {
+		if (aio_queues[i] && aio_queues[i]->threads_running < aio_queues[i]->threads_wanted) {
+			q = aio_queues[i];
+			q->threads_running++;
+			break;
+		}
+	}
+
+	spinlock_release(&aio_lock, intf);
+	return q;
+}
+
+static void __nxapi aio_queue_thread()
+{
+	K_IO_QUEUE		*q;
+	K_IO_REQUEST	*req;
+	HRESULT			hr;
+
+	if (!(q = aio_claim_queue())) {
+		HalKernelPanic("aio_queue_thread(): No queue to serve.");
+	}
+
+	while (TRUE) {
+		if (!(req = aio_queue_pop(q))) {
+			continue;
+		}
+
+		req->bytes = 0;
+		hr = q->service(q, req);
+
+		aio_complete(req, hr, req->bytes);
+	}
+}
+
+HRESULT __nxapi aio_queue_push(K_IO_QUEUE *q, K_IO_REQUEST *req)
+{
+	uint32_t	intf;
+	HRESULT		hr = S_OK;
+
+	intf = spinlock_acquire(&q->lock);
+
+	if (q->depth >= q->max_depth) {
+		hr = E_BUFFEROVERFLOW;
+		goto finally;
+	}
+
+	req->queue	= q;
+	req->next	= NULL;
+	req->state	= AIO_STATE_QUEUED;
+
+	if (q->tail) {
+		q->tail->next = req;
+	} else {
+		q->head = req;
+	}
+
+	q->tail = req;
+	q->depth++;
+
+	event_signal(&q->event);
+
+finally:
+	spinlock_release(&q->lock, intf);
+	return hr;
+}
+
+/*
+ * Waits until the queue is not empty and dequeues the first request.
+ * Returns NULL if another thread was faster.
+ */
+static K_IO_REQUEST *aio_queue_pop(K_IO_QUEUE *q)
+{
+	K_IO_REQUEST	*req;
+	uint32_t		intf;
+
+	event_waitfor(&q->event, TIMEOUT_INFINITE);
+
+	intf = spinlock_acquire(&q->lock);
+
+	if ((req = q->head) != NULL) {
+		q->head = req->next;
+		if (q->head == NULL) q->tail = NULL;
+
+		q->depth--;
+		req->next	= NULL;
+		req->state	= AIO_STATE_ACTIVE;
+	}
+
+	if (q->head == NULL) {
+		event_reset(&q->event);
+	}
+
+	spinlock_release(&q->lock, intf);
+	return req;
+}
+
+static HRESULT __nxapi aio_generic_service(K_IO_QUEUE *q, K_IO_REQUEST *req)
+{
+	UNUSED_ARG(q);
+
+	if (req->op == AIO_OP_READ) {
+		return k_fpread(req->stream, req->offset, req->size, req->buffer, &req->bytes);
+	}
+
+	return k_fpwrite(req->stream, req->offset, req->size, req->buffer, &req->bytes);
+}
+
+HRESULT __nxapi aio_cq_create(uint32_t capacity, K_IO_COMPLETION_QUEUE **out)
+{
+	K_IO_COMPLETION_QUEUE *cq;
+
+	if (!out) {
+		return E_POINTER;
+	}
+
+	if (capacity == 0) {
+		return E_INVALIDARG;
+	}
+
+	if (!(cq = kcalloc(sizeof(K_IO_COMPLETION_QUEUE)))) {
+		return E_OUTOFMEM;
+	}
+
+	if (!(cq->ring = kcalloc(capacity * sizeof(K_IO_REQUEST*)))) {
+		kfree(cq);
+		return E_OUTOFMEM;
+	}
+
+	cq->capacity = capacity;
+
+	event_create(&cq->event, EVENT_FLAG_NONE);
+	spinlock_create(&cq->lock);
+
+	*out = cq;
+	return S_OK;
+}
+
+HRESULT __nxapi aio_cq_destroy(K_IO_COMPLETION_QUEUE **cq)
+{
+	K_IO_COMPLETION_QUEUE *c;
+
+	if (!cq || !*cq) {
+		return E_POINTER;
+	}
+
+	c = *cq;
+
+	/* Requests in flight would complete into freed memory */
+	if (c->reserved > 0) {
+		return E_INVALIDSTATE;
+	}
+
+	event_destroy(&c->event);
+	spinlock_destroy(&c->lock);
+	kfree(c->ring);
+	kfree(c);
+
+	*cq = NULL;
+	return S_OK;
+}
+
+HRESULT __nxapi aio_cq_wait(K_IO_COMPLETION_QUEUE *cq, uint32_t timeout, K_IO_REQUEST **out)
+{
+	uint32_t	start, elapsed, intf;
+	HRESULT		hr;
+
+	if (!cq || !out) {
+		return E_POINTER;
+	}
+
+	start = timer_gettickcount();
+
+	while (TRUE) {
+		intf = spinlock_acquire(&cq->lock);
+
+		if (cq->count > 0) {
+			*out = cq->ring[cq->head];
+			cq->head = (cq->head + 1) % cq->capacity;
+
+			if (--cq->count == 0) {
+				event_reset(&cq->event);
+			}
+
+			spinlock_release(&cq->lock, intf);
+			return S_OK;
+		}
+
+		spinlock_release(&cq->lock, intf);
+
+		elapsed = timer_gettickcount() - start;
+
+		if (timeout != TIMEOUT_INFINITE && elapsed >= timeout) {
+			return E_TIMEDOUT;
+		}
+
+		hr = event_waitfor(&cq->event, timeout == TIMEOUT_INFINITE ? TIMEOUT_INFINITE : timeout - elapsed);
+		if (FAILED(hr)) return hr;
+	}
+}
+
+HRESULT __nxapi aio_submit(K_STREAM *str, K_IO_REQUEST *req, K_IO_COMPLETION_QUEUE *cq)
+{
+	uint32_t	intf;
+	HRESULT		hr = S_OK;
+
+	if (!str || !req) {
+		return E_POINTER;
+	}
+
+	if ((req->op != AIO_OP_READ && req->op != AIO_OP_WRITE) || (req->size > 0 && !req->buffer)) {
+		return E_INVALIDARG;
+	}
+
+	if (req->state == AIO_STATE_QUEUED || req->state == AIO_STATE_ACTIVE) {
+		return E_INVALIDSTATE;
+	}
+
+	/* Reserve a completion slot */
+	if (cq) {
+		intf = spinlock_acquire(&cq->lock);
+
+		if (cq->count + cq->reserved >= cq->capacity) {
+			hr = E_BUFFEROVERFLOW;
+		} else {
+			cq->reserved++;
+		}
+
+		spinlock_release(&cq->lock, intf);
+		if (FAILED(hr)) return hr;
+	}
+
+	req->stream			= str;
+	req->cq				= cq;
+	req->status			= S_OK;
+	req->bytes			= 0;
+	req->state			= AIO_STATE_IDLE;
+	req->queue			= NULL;
+	req->driver_data	= NULL;
+	event_create(&req->done, EVENT_FLAG_NONE);
+
+	/* Prefer the driver's own queue */
+	hr = str->submit ? str->submit(str, req) : E_NOTSUPPORTED;
+
+	if (hr == E_NOTSUPPORTED) {
+		hr = aio_queue_push(&aio_generic_queue, req);
+	}
+
+	if (FAILED(hr) && cq) {
+		intf = spinlock_acquire(&cq->lock);
+		cq->reserved--;
+		spinlock_release(&cq->lock, intf);
+	}
+
+	return hr;
+}
+
+HRESULT __nxapi aio_cancel(K_IO_REQUEST *req)
+{
+	K_IO_QUEUE		*q;
+	K_IO_REQUEST	**link;
+	uint32_t		intf;
+
+	if (!req) {
+		return E_POINTER;
+	}
+
+	if (!(q = req->queue)) {
+		return E_INVALIDSTATE;
+	}
+
+	intf = spinlock_acquire(&q->lock);
+
+	if (req->state != AIO_STATE_QUEUED) {
+		spinlock_release(&q->lock, intf);
+		return E_INVALIDSTATE;
+	}
+
+	/* Unlink */
+	for (link = &q->head; *link != req; link = &(*link)->next);
+	*link = req->next;
+
+	if (q->tail == req) {
+		q->tail = NULL;
+
+		/* Find new tail */
+		for (K_IO_REQUEST *r = q->head; r; r = r->next) {
+			q->tail = r;
+		}
+	}
+
+	q->depth--;
+	req->next = NULL;
+
+	if (q->head == NULL) {
+		event_reset(&q->event);
+	}
+
+	spinlock_release(&q->lock, intf);
+
+	aio_complete(req, E_TERMINATED, 0);
+	return S_OK;
+}
+
+HRESULT __nxapi aio_wait(K_IO_REQUEST *req, uint32_t timeout)
+{
+	HRESULT hr;
+
+	if (!req) {
+		return E_POINTER;
+	}
+
+	if (req->state == AIO_STATE_IDLE) {
+		return E_INVALIDSTATE;
+	}
+
+	hr = event_waitfor(&req->done, timeout);
+	if (FAILED(hr)) return hr;
+
+	return req->status;
+}
+
+void __nxapi aio_complete(K_IO_REQUEST *req, HRESULT status, size_t bytes)
+{
+	K_IO_COMPLETION_QUEUE	*cq = req->cq;
+	uint32_t				intf;
+
+	req->status	= status;
+	req->bytes	= bytes;
+	req->state	= AIO_STATE_COMPLETED;
+
+	if (cq) {
+		intf = spinlock_acquire(&cq->lock);
+
+		cq->ring[(cq->head + cq->count) % cq->capacity] = req;
+		cq->count++;
+		cq->reserved--;
+
+		event_signal(&cq->event);
+		spinlock_release(&cq->lock, intf);
+	}
+
+	event_signal(&req->done);
+}
+
+#define AIO_BENCH_DEVICE		"/dev/hd0"
+#define AIO_BENCH_BYTES			(4 * 1024 * 1024)
+#define AIO_BENCH_CHUNK			0x10000
+#define AIO_BENCH_DEPTH			4
+#define AIO_BENCH_BASELINE_MS	1000
+
+static volatile BOOL		aio_bench_spin;
+static volatile uint32_t	aio_bench_spins;
+
+/*
+ * CPU-bound side of the benchmark. It runs for the lifetime of the kernel.
+ */
+static void __nxapi aio_bench_spinner()
+{
+	while (TRUE) {
+		if (aio_bench_spin) {
+			aio_bench_spins++;
+		} else {
+			sched_yield();
+		}
+	}
+}
+
+/*
+ * Share of the CPU the spinner got, relative to the baseline run.
+ */
+static uint32_t aio_bench_cpu_share(uint32_t spins, uint32_t ms, uint32_t base_spins)
+{
+	if (ms == 0 || base_spins == 0) return 0;
+	return (uint32_t)udiv64(udiv64((uint64_t)spins * 100 * AIO_BENCH_BASELINE_MS, base_spins, NULL), ms, NULL);
+}
+
+HRESULT __nxapi aio_benchmark()
+{
+	static BOOL				initialized = FALSE;
+	K_STREAM				*s = NULL;
+	K_IO_COMPLETION_QUEUE	*cq = NULL;
+	K_IO_REQUEST			req[AIO_BENCH_DEPTH], *done;
+	uint8_t					*buf[AIO_BENCH_DEPTH];
+	K_EVENT					idle;
+	uint32_t				i, t, base_spins, sync_ms, sync_spins, async_ms, async_spins;
+	uint32_t				next_off, in_flight;
+	size_t					bytes;
+	HRESULT					hr;
+
+	memset(buf, 0, sizeof(buf));
+	memset(req, 0, sizeof(req));
+
+	if (!initialized) {
+		hr = sched_create_thread(NULL, aio_bench_spinner, NULL);
+		if (FAILED(hr)) return hr;
+
+		initialized = TRUE;
+	}
+
+	hr = k_fopen(AIO_BENCH_DEVICE, FILE_OPEN_READ, &s);
+	if (FAILED(hr)) {
+		k_printf("No IDE disk at %s.\n", AIO_BENCH_DEVICE);
+		return hr;
+	}
+
+	for (i=0; i<AIO_BENCH_DEPTH; i++) {
+		if (!(buf[i] = kmalloc(AIO_BENCH_CHUNK))) {
+			hr = E_OUTOFMEM;
+			goto finally;
+		}
+	}
+
+	hr = aio_cq_create(AIO_BENCH_DEPTH, &cq);
+	if (FAILED(hr)) goto finally;
+
+	/* Baseline: the spinner alone */
+	event_create(&idle, EVENT_FLAG_NONE);
+
+	aio_bench_spins = 0;
+	aio_bench_spin = TRUE;
+	event_waitfor(&idle, AIO_BENCH_BASELINE_MS);
+	aio_bench_spin = FALSE;
+	base_spins = aio_bench_spins;
+
+	event_destroy(&idle);
+
+	/* Synchronous streaming */
+	aio_bench_spins = 0;
+	aio_bench_spin = TRUE;
+	t = timer_gettickcount();
+
+	for (next_off=0; next_off<AIO_BENCH_BYTES; next_off+=AIO_BENCH_CHUNK) {
+		hr = k_fpread(s, next_off, AIO_BENCH_CHUNK, buf[0], &bytes);
+		if (FAILED(hr)) break;
+	}
+
+	sync_ms = timer_gettickcount() - t;
+	aio_bench_spin = FALSE;
+	sync_spins = aio_bench_spins;
+
+	if (FAILED(hr)) goto finally;
+
+	/* Asynchronous streaming, AIO_BENCH_DEPTH requests in flight */
+	aio_bench_spins = 0;
+	aio_bench_spin = TRUE;
+	t = timer_gettickcount();
+
+	for (next_off=0, in_flight=0; in_flight<AIO_BENCH_DEPTH && next_off<AIO_BENCH_BYTES; in_flight++) {
+		req[in_flight].op		= AIO_OP_READ;
+		req[in_flight].offset	= next_off;
+		req[in_flight].buffer	= buf[in_flight];
+		req[in_flight].size		= AIO_BENCH_CHUNK;
+
+		hr = aio_submit(s, &req[in_flight], cq);
+		if (FAILED(hr)) break;
+
+		next_off += AIO_BENCH_CHUNK;
+	}
+
+	while (SUCCEEDED(hr) && in_flight > 0) {
+		hr = aio_cq_wait(cq, TIMEOUT_INFINITE, &done);
+		if (FAILED(hr)) break;
+
+		in_flight--;
+
+		hr = done->status;
+		if (FAILED(hr)) break;
+
+		/* Reuse the request for the next chunk */
+		if (next_off < AIO_BENCH_BYTES) {
+			done->offset = next_off;
+
+			hr = aio_submit(s, done, cq);
+			if (FAILED(hr)) break;
+
+			next_off += AIO_BENCH_CHUNK;
+			in_flight++;
+		}
+	}
+
+	async_ms = timer_gettickcount() - t;
+	aio_bench_spin = FALSE;
+	async_spins = aio_bench_spins;
+
+	/* Drain, so no request completes into freed memory */
+	while (in_flight > 0 && SUCCEEDED(aio_cq_wait(cq, TIMEOUT_INFINITE, &done))) {
+		in_flight--;
+	}
+
+	if (FAILED(hr)) goto finally;
+
+	k_printf("Streaming %d KiB from %s in %d KiB chunks:\n", AIO_BENCH_BYTES / 1024, AIO_BENCH_DEVICE, AIO_BENCH_CHUNK / 1024);
+	k_printf("  sync:  %d ms, CPU thread got %d percent\n", sync_ms, aio_bench_cpu_share(sync_spins, sync_ms, base_spins));
+	k_printf("  async: %d ms, CPU thread got %d percent\n", async_ms, aio_bench_cpu_share(async_spins, async_ms, base_spins));
+
+finally:
+	if (cq) aio_cq_destroy(&cq);
+	if (s) k_fclose(&s);
+
+	for (i=0; i<AIO_BENCH_DEPTH; i++) {
+		if (buf[i]) kfree(buf[i]);
+	}
+
+	return hr;
+}
@@ -0,0 +1,760 @@
+/*
+ * bcache.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "bcache.h"
+#include "syncobjs.h"
+#include "scheduler.h"
+#include "kstdio.h"
+#include "timer.h"
+#include "string.h"
+#include "mm.h"
+#include "hal.h"
+
+#define BCACHE_BUCKET_MASK		(BCACHE_BUCKETS - 1)
+
+static K_BCACHE_DEVICE	bcache_devices[BCACHE_MAX_DEVICES];
+static K_BUFFER_HEAD	*bcache_buckets[BCACHE_BUCKETS];
+static K_BUFFER_HEAD	*bcache_lru_head;
+static K_BUFFER_HEAD	*bcache_lru_tail;
+static size_t			bcache_used;
+static K_BCACHE_STATS	bcache_stats;
+static K_MUTEX			bcache_lock;
+static K_EVENT			bcache_flush_ev;
+static volatile BOOL	bcache_ready = FALSE;
+
+/*
+ * Prototypes
+ */
+static HRESULT bcache_dev_transfer(K_STREAM *io, uint32_t code, uint32_t start, uint32_t count, void *buffer);
+static K_BCACHE_DEVICE *bcache_get_device(K_STREAM *drv, BOOL create);
+static uint32_t bcache_bucket(K_BCACHE_DEVICE *dev, uint32_t block);
+static K_BUFFER_HEAD *bcache_find(K_BCACHE_DEVICE *dev, uint32_t block);
+static K_BUFFER_HEAD *bcache_alloc(K_BCACHE_DEVICE *dev, uint32_t block);
+static void bcache_unhash(K_BUFFER_HEAD *bh);
+static void bcache_lru_unlink(K_BUFFER_HEAD *bh);
+static void bcache_lru_push(K_BUFFER_HEAD *bh);
+static void bcache_lru_push_tail(K_BUFFER_HEAD *bh);
+static HRESULT bcache_writeback(K_BUFFER_HEAD *bh);
+static HRESULT bcache_flush(K_BCACHE_DEVICE *dev);
+static void bcache_set_dirty(K_BUFFER_HEAD *bh);
+static void __nxapi bcache_flusher_thread();
+
+HRESULT __nxapi bcache_initialize(size_t budget)
+{
+	HRESULT hr;
+
+	memset(bcache_devices, 0, sizeof(bcache_devices));
+	memset(bcache_buckets, 0, sizeof(bcache_buckets));
+	memset(&bcache_stats, 0, sizeof(bcache_stats));
+
+	bcache_lru_head = bcache_lru_tail = NULL;
+	bcache_used = 0;
+	bcache_stats.budget = budget != 0 ? budget : BCACHE_DEFAULT_BUDGET;
+
+	mutex_create(&bcache_lock);
+	event_create(&bcache_flush_ev, EVENT_FLAG_AUTORESET);
+
+	hr = sched_create_thread(NULL, bcache_flusher_thread, NULL);
+	if (FAILED(hr)) return hr;
+
+	/* Storage I/O goes through the cache from now on */
+	bcache_ready = TRUE;
+
+	return S_OK;
+}
+
+HRESULT __nxapi bcache_get(K_STREAM *drv, uint32_t block, K_BUFFER_HEAD **out)
+{
+	K_BCACHE_DEVICE	*dev;
+	K_BUFFER_HEAD	*bh;
+	HRESULT			hr = S_OK;
+
+	if (!bcache_ready) {
+		return E_FAIL;
+	}
+
+	mutex_lock(&bcache_lock);
+
+	if (!(dev = bcache_get_device(drv, TRUE))) {
+		hr = E_NOTSUPPORTED;
+		goto finally;
+	}
+
+	if ((bh = bcache_find(dev, block)) != NULL) {
+		bcache_stats.hits++;
+
+		bcache_lru_unlink(bh);
+		bcache_lru_push(bh);
+	} else {
+		if (!(bh = bcache_alloc(dev, block))) {
+			/* Every buffer is referenced */
+			hr = E_OUTOFMEM;
+			goto finally;
+		}
+
+		bcache_stats.misses++;
+
+		hr = bcache_dev_transfer(dev->io, IOCTL_STORAGE_READ_BLOCKS, block, 1, bh->data);
+		if (FAILED(hr)) {
+			/* Leave an unused buffer at the LRU tail, so it's recycled first */
+			bcache_unhash(bh);
+			bcache_lru_unlink(bh);
+			bh->dev = NULL;
+			bcache_lru_push_tail(bh);
+
+			goto finally;
+		}
+
+		bh->flags |= BCACHE_BUF_VALID;
+	}
+
+	bh->ref_count++;
+	*out = bh;
+
+finally:
+	mutex_unlock(&bcache_lock);
+	return hr;
+}
+
+VOID __nxapi bcache_put(K_BUFFER_HEAD *bh)
+{
+	mutex_lock(&bcache_lock);
+
+	assert_msg(bh->ref_count > 0, "bcache_put(): buffer is not referenced.");
+	bh->ref_count--;
+
+	mutex_unlock(&bcache_lock);
+}
+
+VOID __nxapi bcache_mark_dirty(K_BUFFER_HEAD *bh)
+{
+	mutex_lock(&bcache_lock);
+	bcache_set_dirty(bh);
+	mutex_unlock(&bcache_lock);
+}
+
+HRESULT __nxapi bcache_read(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags)
+{
+	K_BCACHE_DEVICE	*dev;
+	K_BUFFER_HEAD	*bh;
+	uint8_t			*dst = buffer;
+	uint32_t		i, j;
+	HRESULT			hr = S_OK;
+
+	if (!bcache_ready) {
+		return bcache_dev_transfer(drv, IOCTL_STORAGE_READ_BLOCKS, start, count, buffer);
+	}
+
+	mutex_lock(&bcache_lock);
+
+	dev = bcache_get_device(drv, TRUE);
+
+	if (dev == NULL) {
+		/* Not a device we can cache */
+		bcache_stats.bypassed += count;
+		hr = bcache_dev_transfer(drv, IOCTL_STORAGE_READ_BLOCKS, start, count, buffer);
+		goto finally;
+	}
+
+	if ((flags & STORAGE_IO_BYPASS) || count >= BCACHE_BYPASS_BLOCKS) {
+		/* Make sure the device has the latest data, then read directly */
+		for (i=0; i<count; i++) {
+			bh = bcache_find(dev, start + i);
+
+			if (bh && (bh->flags & BCACHE_BUF_DIRTY)) {
+				hr = bcache_writeback(bh);
+				if (FAILED(hr)) goto finally;
+			}
+		}
+
+		bcache_stats.bypassed += count;
+		hr = bcache_dev_transfer(dev->io, IOCTL_STORAGE_READ_BLOCKS, start, count, buffer);
+		goto finally;
+	}
+
+	i = 0;
+	while (i < count) {
+		bh = bcache_find(dev, start + i);
+
+		if (bh != NULL) {
+			memcpy(dst + i * dev->block_size, bh->data, dev->block_size);
+			bcache_stats.hits++;
+
+			bcache_lru_unlink(bh);
+			bcache_lru_push(bh);
+
+			i++;
+			continue;
+		}
+
+		/* Read the whole run of missing blocks with a single request */
+		for (j=i+1; j<count && bcache_find(dev, start + j) == NULL; j++) ;
+
+		hr = bcache_dev_transfer(dev->io, IOCTL_STORAGE_READ_BLOCKS, start + i, j - i, dst + i * dev->block_size);
+		if (FAILED(hr)) goto finally;
+
+		bcache_stats.misses += j - i;
+
+		for (; i<j; i++) {
+			/* If every buffer is referenced, the block just isn't cached */
+			if (!(bh = bcache_alloc(dev, start + i))) continue;
+
+			memcpy(bh->data, dst + i * dev->block_size, dev->block_size);
+			bh->flags |= BCACHE_BUF_VALID;
+		}
+	}
+
+finally:
+	mutex_unlock(&bcache_lock);
+	return hr;
+}
+
+HRESULT __nxapi bcache_write(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags)
+{
+	K_BCACHE_DEVICE	*dev;
+	K_BUFFER_HEAD	*bh;
+	uint8_t			*src = buffer;
+	uint32_t		i;
+	HRESULT			hr = S_OK;
+
+	if (!bcache_ready) {
+		return bcache_dev_transfer(drv, IOCTL_STORAGE_WRITE_BLOCKS, start, count, buffer);
+	}
+
+	mutex_lock(&bcache_lock);
+
+	dev = bcache_get_device(drv, TRUE);
+
+	if (dev == NULL) {
+		bcache_stats.bypassed += count;
+		hr = bcache_dev_transfer(drv, IOCTL_STORAGE_WRITE_BLOCKS, start, count, buffer);
+		goto finally;
+	}
+
+	if ((flags & STORAGE_IO_BYPASS) || count >= BCACHE_BYPASS_BLOCKS) {
+		/* Write through, then refresh cached copies */
+		bcache_stats.bypassed += count;
+		hr = bcache_dev_transfer(dev->io, IOCTL_STORAGE_WRITE_BLOCKS, start, count, buffer);
+		if (FAILED(hr)) goto finally;
+
+		for (i=0; i<count; i++) {
+			if (!(bh = bcache_find(dev, start + i))) continue;
+
+			memcpy(bh->data, src + i * dev->block_size, dev->block_size);
+
+			if (bh->flags & BCACHE_BUF_DIRTY) {
+				bh->flags &= ~BCACHE_BUF_DIRTY;
+				bcache_stats.dirty--;
+			}
+		}
+
+		goto finally;
+	}
+
+	for (i=0; i<count; i++) {
+		/* Blocks are overwritten entirely, so missing ones needn't be read */
+		if (!(bh = bcache_find(dev, start + i))) {
+			bh = bcache_alloc(dev, start + i);
+		}
+
+		if (bh == NULL) {
+			/* No buffer available, write through */
+			hr = bcache_dev_transfer(dev->io, IOCTL_STORAGE_WRITE_BLOCKS, start + i, 1, src + i * dev->block_size);
+			if (FAILED(hr)) goto finally;
+
+			continue;
+		}
+
+		memcpy(bh->data, src + i * dev->block_size, dev->block_size);
+		bh->flags |= BCACHE_BUF_VALID;
+		bcache_set_dirty(bh);
+
+		bcache_lru_unlink(bh);
+		bcache_lru_push(bh);
+	}
+
+finally:
+	mutex_unlock(&bcache_lock);
+	return hr;
+}
+
+HRESULT __nxapi bcache_sync()
+{
+	HRESULT hr;
+
+	mutex_lock(&bcache_lock);
+	hr = bcache_flush(NULL);
+	mutex_unlock(&bcache_lock);
+
+	return hr;
+}
+
+HRESULT __nxapi bcache_fsync(K_STREAM *drv)
+{
+	K_BCACHE_DEVICE	*dev;
+	HRESULT			hr = S_OK;
+
+	if (!bcache_ready) {
+		return S_OK;
+	}
+
+	mutex_lock(&bcache_lock);
+
+	if ((dev = bcache_get_device(drv, FALSE)) != NULL) {
+		hr = bcache_flush(dev);
+	}
+
+	mutex_unlock(&bcache_lock);
+	return hr;
+}
+
+HRESULT __nxapi bcache_invalidate(K_STREAM *drv)
+{
+	K_BCACHE_DEVICE	*dev;
+	K_BUFFER_HEAD	*bh, *prev;
+	BOOL			in_use = FALSE;
+	HRESULT			hr = S_OK;
+
+	if (!bcache_ready) {
+		return S_OK;
+	}
+
+	mutex_lock(&bcache_lock);
+
+	if ((dev = bcache_get_device(drv, FALSE)) == NULL) {
+		goto finally;
+	}
+
+	hr = bcache_flush(dev);
+	if (FAILED(hr)) goto finally;
+
+	/* Free the device's buffers */
+	for (bh = bcache_lru_tail; bh != NULL; bh = prev) {
+		prev = bh->lru_prev;
+
+		if (bh->dev != dev) continue;
+
+		if (bh->ref_count > 0) {
+			in_use = TRUE;
+			continue;
+		}
+
+		bcache_unhash(bh);
+		bcache_lru_unlink(bh);
+
+		bcache_used -= bh->size;
+		bcache_stats.buffers--;
+
+		kfree(bh->data);
+		kfree(bh);
+	}
+
+	/* Forget the device, unless someone still holds one of it's buffers */
+	if (!in_use) {
+		k_fclose(&dev->io);
+		dev->key = NULL;
+	}
+
+finally:
+	mutex_unlock(&bcache_lock);
+	return hr;
+}
+
+VOID __nxapi bcache_get_stats(K_BCACHE_STATS *stats)
+{
+	mutex_lock(&bcache_lock);
+	*stats = bcache_stats;
+	mutex_unlock(&bcache_lock);
+}
+
+static HRESULT bcache_dev_transfer(K_STREAM *io, uint32_t code, uint32_t start, uint32_t count, void *buffer)
+{
+	IOCTL_STORAGE_READWRITE rw;
+
+	rw.buffer 	= buffer;
+	rw.start 	= start;
+	rw.count	= count;
+
+	return k_ioctl(io, code, &rw);
+}
+
+/*
+ * Finds the cache's record of the device behind `drv`. If `create` is set and
+ * there is none, opens a stream to the device and registers it.
+ */
+static K_BCACHE_DEVICE *bcache_get_device(K_STREAM *drv, BOOL create)
+{
+	K_BCACHE_DEVICE	*free_dev = NULL;
+	K_STREAM		*io;
+	size_t			block_size;
+	uint32_t		i;
+
+	/* Device streams refer to the device's VFS node */
+	if (drv->priv_data == NULL || drv->filename == NULL) {
+		return NULL;
+	}
+
+	for (i=0; i<BCACHE_MAX_DEVICES; i++) {
+		if (bcache_devices[i].key == drv->priv_data) {
+			return &bcache_devices[i];
+		}
+
+		if (bcache_devices[i].key == NULL && free_dev == NULL) {
+			free_dev = &bcache_devices[i];
+		}
+	}
+
+	if (!create || free_dev == NULL) {
+		return NULL;
+	}
+
+	if (FAILED(storage_get_block_size(drv, &block_size)) || block_size == 0) {
+		return NULL;
+	}
+
+	if (FAILED(k_fopen(drv->filename, FILE_OPEN_READWRITE, &io))) {
+		return NULL;
+	}
+
+	if (io->priv_data != drv->priv_data) {
+		/* Not the same device (stream wasn't opened through the VFS) */
+		k_fclose(&io);
+		return NULL;
+	}
+
+	free_dev->key = drv->priv_data;
+	free_dev->io = io;
+	free_dev->block_size = block_size;
+
+	return free_dev;
+}
+
+static uint32_t bcache_bucket(K_BCACHE_DEVICE *dev, uint32_t block)
+{
+	uint32_t h = block * 2654435761u;
+
+	h ^= (uint32_t)(dev - bcache_devices) * 40503u;
+	h ^= h >> 16;
+
+	return h & BCACHE_BUCKET_MASK;
+}
+
+static K_BUFFER_HEAD *bcache_find(K_BCACHE_DEVICE *dev, uint32_t block)
+{
+	K_BUFFER_HEAD *bh = bcache_buckets[bcache_bucket(dev, block)];
+
+	while (bh != NULL) {
+		if (bh->block == block && bh->dev == dev) {
+			return bh;
+		}
+
+		bh = bh->hash_next;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns an unreferenced buffer for `block`, hashed and at the front of the
+ * LRU list, but without valid data. New buffers are allocated while within
+ * the budget, otherwise the least recently used one is recycled.
+ */
+static K_BUFFER_HEAD *bcache_alloc(K_BCACHE_DEVICE *dev, uint32_t block)
+{
+	K_BUFFER_HEAD	*bh = NULL;
+
+	if (bcache_used + dev->block_size <= bcache_stats.budget) {
+		if ((bh = kcalloc(sizeof(K_BUFFER_HEAD))) != NULL) {
+			if ((bh->data = kmalloc(dev->block_size)) == NULL) {
+				kfree(bh);
+				bh = NULL;
+			} else {
+				bh->size = dev->block_size;
+				bcache_used += bh->size;
+				bcache_stats.buffers++;
+			}
+		}
+	}
+
+	if (bh == NULL) {
+		/* Recycle the least recently used buffer */
+		for (bh = bcache_lru_tail; bh != NULL; bh = bh->lru_prev) {
+			if (bh->ref_count > 0) continue;
+
+			/* Write back modified data first */
+			if ((bh->flags & BCACHE_BUF_DIRTY) && FAILED(bcache_writeback(bh))) continue;
+
+			break;
+		}
+
+		if (bh == NULL) {
+			return NULL;
+		}
+
+		if (bh->dev != NULL) {
+			bcache_unhash(bh);
+			bcache_stats.evictions++;
+		}
+		bcache_lru_unlink(bh);
+
+		if (bh->size != dev->block_size) {
+			uint8_t *data = kmalloc(dev->block_size);
+
+			if (data == NULL) {
+				/* Keep it as an unused buffer */
+				bh->dev = NULL;
+				bh->flags = 0;
+				bcache_lru_push_tail(bh);
+				return NULL;
+			}
+
+			kfree(bh->data);
+			bcache_used = bcache_used - bh->size + dev->block_size;
+
+			bh->data = data;
+			bh->size = dev->block_size;
+		}
+	}
+
+	bh->dev = dev;
+	bh->block = block;
+	bh->flags = 0;
+	bh->ref_count = 0;
+
+	uint32_t b = bcache_bucket(dev, block);
+	bh->hash_next = bcache_buckets[b];
+	bcache_buckets[b] = bh;
+
+	bcache_lru_push(bh);
+
+	return bh;
+}
+
+static void bcache_unhash(K_BUFFER_HEAD *bh)
+{
+	K_BUFFER_HEAD **link = &bcache_buckets[bcache_bucket(bh->dev, bh->block)];
+
+	while (*link != NULL) {
+		if (*link == bh) {
+			*link = bh->hash_next;
+			break;
+		}
+
+		link = &(*link)->hash_next;
+	}
+
+	bh->hash_next = NULL;
+}
+
+static void bcache_lru_unlink(K_BUFFER_HEAD *bh)
+{
+	if (bh->lru_prev) bh->lru_prev->lru_next = bh->lru_next;
+	else bcache_lru_head = bh->lru_next;
+
+	if (bh->lru_next) bh->lru_next->lru_prev = bh->lru_prev;
+	else bcache_lru_tail = bh->lru_prev;
+
+	bh->lru_prev = bh->lru_next = NULL;
+}
+
+static void bcache_lru_push(K_BUFFER_HEAD *bh)
+{
+	bh->lru_prev = NULL;
+	bh->lru_next = bcache_lru_head;
+
+	if (bcache_lru_head) bcache_lru_head->lru_prev = bh;
+	else bcache_lru_tail = bh;
+
+	bcache_lru_head = bh;
+}
+
+static void bcache_lru_push_tail(K_BUFFER_HEAD *bh)
+{
+	bh->lru_next = NULL;
+	bh->lru_prev = bcache_lru_tail;
+
+	if (bcache_lru_tail) bcache_lru_tail->lru_next = bh;
+	else bcache_lru_head = bh;
+
+	bcache_lru_tail = bh;
+}
+
+static HRESULT bcache_writeback(K_BUFFER_HEAD *bh)
+{
+	HRESULT hr;
+
+	hr = bcache_dev_transfer(bh->dev->io, IOCTL_STORAGE_WRITE_BLOCKS, bh->block, 1, bh->data);
+	if (FAILED(hr)) return hr;
+
+	bh->flags &= ~BCACHE_BUF_DIRTY;
+	bcache_stats.dirty--;
+	bcache_stats.writebacks++;
+
+	return S_OK;
+}
+
+/* Writes back dirty buffers of `dev` (all devices if NULL). Called with the lock held. */
+static HRESULT bcache_flush(K_BCACHE_DEVICE *dev)
+{
+	K_BUFFER_HEAD	*bh;
+	HRESULT			hr = S_OK;
+
+	for (bh = bcache_lru_head; bh != NULL && bcache_stats.dirty > 0; bh = bh->lru_next) {
+		if ((bh->flags & BCACHE_BUF_DIRTY) == 0) continue;
+		if (dev != NULL && bh->dev != dev) continue;
+
+		/* Try the rest anyway, but report the failure */
+		if (FAILED(bcache_writeback(bh))) hr = E_FAIL;
+	}
+
+	return hr;
+}
+
+/* Called with the lock held */
+static void bcache_set_dirty(K_BUFFER_HEAD *bh)
+{
+	if (bh->flags & BCACHE_BUF_DIRTY) {
+		return;
+	}
+
+	bh->flags |= BCACHE_BUF_DIRTY;
+
+	if (++bcache_stats.dirty >= BCACHE_DIRTY_THRESHOLD) {
+		event_signal(&bcache_flush_ev);
+	}
+}
+
+static void __nxapi bcache_flusher_thread()
+{
+	while (TRUE) {
+		/* Wakes up periodically, or early if too many buffers are dirty */
+		event_waitfor(&bcache_flush_ev, BCACHE_FLUSH_INTERVAL);
+
+		if (bcache_stats.dirty > 0) {
+			bcache_sync();
+		}
+	}
+}
+
+#define BCACHE_BENCH_BLOCKS		64
+#define BCACHE_BENCH_PASSES		4
+
+static const char *bcache_bench_devices[] = { "/dev/fdd0", "/dev/hd0", NULL };
+
+/* Reads the first BCACHE_BENCH_BLOCKS blocks one at a time, like file systems do */
+static uint32_t bcache_bench_read_blocks(K_STREAM *s, void *buf, HRESULT *hr_out)
+{
+	QWORD		t = timer_gettickcount();
+	uint32_t	i;
+	HRESULT		hr = S_OK;
+
+	for (i=0; i<BCACHE_BENCH_BLOCKS && SUCCEEDED(hr); i++) {
+		hr = storage_read_blocks(s, i, 1, buf);
+	}
+
+	*hr_out = hr;
+	return (uint32_t)(timer_gettickcount() - t);
+}
+
+/* Reads a whole file, returns elapsed milliseconds */
+static uint32_t bcache_bench_read_file(char *path, void *buf, size_t buf_size, size_t *total, HRESULT *hr_out)
+{
+	QWORD		t = timer_gettickcount();
+	K_STREAM	*s;
+	size_t		bytes;
+	HRESULT		hr;
+
+	*total = 0;
+
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (SUCCEEDED(hr)) {
+		do {
+			hr = k_fread(s, buf_size, buf, &bytes);
+			*total += bytes;
+		} while (SUCCEEDED(hr) && bytes == buf_size);
+
+		k_fclose(&s);
+	}
+
+	*hr_out = hr == E_ENDOFSTR ? S_OK : hr;
+	return (uint32_t)(timer_gettickcount() - t);
+}
+
+HRESULT __nxapi bcache_benchmark()
+{
+	K_BCACHE_STATS	st;
+	K_DIR_STREAM	*ds;
+	K_FS_NODE_INFO	info;
+	K_STREAM		*s;
+	char			name[MAX_FILENAME_LENGTH];
+	char			path[MAX_DIRNAME_LENGTH];
+	uint8_t			*buf;
+	size_t			total;
+	uint32_t		i, pass, ms;
+	HRESULT			hr;
+
+	if (!(buf = kmalloc(4096))) {
+		return E_OUTOFMEM;
+	}
+
+	for (i=0; bcache_bench_devices[i] != NULL; i++) {
+		if (FAILED(k_fopen((char*)bcache_bench_devices[i], FILE_OPEN_READ, &s))) {
+			k_printf("%s: not present, skipped.\n", bcache_bench_devices[i]);
+			continue;
+		}
+
+		/* Start cold */
+		bcache_invalidate(s);
+
+		for (pass=0; pass<BCACHE_BENCH_PASSES; pass++) {
+			ms = bcache_bench_read_blocks(s, buf, &hr);
+			if (FAILED(hr)) break;
+
+			k_printf("%s: %s read of %d blocks in %d ms\n", bcache_bench_devices[i],
+					pass == 0 ? "cold" : "repeat", BCACHE_BENCH_BLOCKS, ms);
+		}
+
+		if (FAILED(hr)) {
+			k_printf("%s: read failed (hr=0x%X).\n", bcache_bench_devices[i], hr);
+		}
+
+		k_fclose(&s);
+	}
+
+	/* Files on the FAT floppy, if mounted */
+	if (SUCCEEDED(k_opendir("/drives/a", &ds))) {
+		name[0] = '\0';
+		while (k_readdir(ds, name, &info) == S_OK) {
+			if (info.node_type == FS_NODE_TYPE_FILE && info.size > 0) break;
+			name[0] = '\0';
+		}
+		k_closedir(&ds);
+
+		if (name[0] != '\0') {
+			snprintf(path, sizeof(path), "/drives/a/%s", name);
+
+			for (pass=0; pass<BCACHE_BENCH_PASSES; pass++) {
+				ms = bcache_bench_read_file(path, buf, 4096, &total, &hr);
+				if (FAILED(hr)) {
+					k_printf("%s: read failed (hr=0x%X).\n", path, hr);
+					break;
+				}
+
+				k_printf("%s: read %d bytes in %d ms\n", path, total, ms);
+			}
+		}
+	} else {
+		k_printf("/drives/a: not mounted, FAT test skipped.\n");
+	}
+
+	bcache_get_stats(&st);
+	k_printf("Buffer cache: %d hits, %d misses, %d bypassed, %d evictions, %d writebacks, %d buffers (%d KiB budget)\n",
+			st.hits, st.misses, st.bypassed, st.evictions, st.writebacks, st.buffers, st.budget / 1024);
+
+	kfree(buf);
+	return S_OK;
+}
@@ -0,0 +1,1239 @@
+/*
+ * blkq.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "blkq.h"
+#include "devices.h"
+#include "kstdio.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "hal.h"
+#include "mm.h"
+#include "string.h"
+
+/* Deadline elevator tunables, in milliseconds and requests */
+#define DEADLINE_READ_EXPIRE		500
+#define DEADLINE_WRITE_EXPIRE		5000
+#define DEADLINE_FIFO_BATCH			16
+#define DEADLINE_WRITES_STARVED		2
+
+/* Bios submitted at once by blkq_transfer() */
+#define BLKQ_SYNC_BATCH				8
+
+/* Direction index of the deadline lists */
+#define BLKQ_DIR(op)				((op) == BIO_OP_READ ? 0 : 1)
+
+/* Queues served by threads */
+static K_BLK_QUEUE	*blkq_queues[BLKQ_MAX_QUEUES];
+static K_SPINLOCK	blkq_lock;
+
+typedef struct {
+	K_BLK_REQUEST	*sorted[2];
+	K_BLK_REQUEST	*fifo_head[2];
+	K_BLK_REQUEST	*fifo_tail[2];
+
+	/* Next request of the current batch, in sector order */
+	K_BLK_REQUEST	*next_rq[2];
+	uint32_t		batch_dir;
+	uint32_t		batching;
+
+	/* Read batches started while writes were waiting */
+	uint32_t		starved;
+} BLK_DEADLINE_DATA;
+
+typedef struct {
+	K_BLK_REQUEST	*head;
+	K_BLK_REQUEST	*tail;
+} BLK_NOOP_DATA;
+
+/* Completion of bios submitted by blkq_transfer() */
+typedef struct {
+	K_SPINLOCK		lock;
+	K_EVENT			done;
+	uint32_t		pending;
+	HRESULT			status;
+} BLKQ_SYNC;
+
+/*
+ * Prototypes
+ */
+static K_BLK_QUEUE *blkq_claim_queue();
+static void __nxapi blkq_thread();
+static VOID blkq_end_request(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, HRESULT status);
+static VOID blkq_sync_end_io(K_BIO *bio);
+
+static HRESULT deadline_init(K_BLK_QUEUE *q);
+static VOID deadline_exit(K_BLK_QUEUE *q);
+static VOID deadline_add(K_BLK_QUEUE *q, K_BLK_REQUEST *rq);
+static K_BLK_REQUEST *deadline_find_merge(K_BLK_QUEUE *q, K_BIO *bio, BOOL *front);
+static VOID deadline_merged(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, BOOL front);
+static K_BLK_REQUEST *deadline_dispatch(K_BLK_QUEUE *q);
+
+static HRESULT noop_init(K_BLK_QUEUE *q);
+static VOID noop_exit(K_BLK_QUEUE *q);
+static VOID noop_add(K_BLK_QUEUE *q, K_BLK_REQUEST *rq);
+static K_BLK_REQUEST *noop_find_merge(K_BLK_QUEUE *q, K_BIO *bio, BOOL *front);
+static VOID noop_merged(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, BOOL front);
+static K_BLK_REQUEST *noop_dispatch(K_BLK_QUEUE *q);
+
+const K_BLK_SCHEDULER blk_deadline_scheduler = {
+	.name		= "deadline",
+	.init		= deadline_init,
+	.exit		= deadline_exit,
+	.add		= deadline_add,
+	.find_merge	= deadline_find_merge,
+	.merged		= deadline_merged,
+	.dispatch	= deadline_dispatch
+};
+
+const K_BLK_SCHEDULER blk_noop_scheduler = {
+	.name		= "noop",
+	.init		= noop_init,
+	.exit		= noop_exit,
+	.add		= noop_add,
+	.find_merge	= noop_find_merge,
+	.merged		= noop_merged,
+	.dispatch	= noop_dispatch
+};
+
+HRESULT __nxapi blkq_initialize()
+{
+	memset(blkq_queues, 0, sizeof(blkq_queues));
+	spinlock_create(&blkq_lock);
+
+	return S_OK;
+}
+
+HRESULT __nxapi blkq_create(K_BLK_QUEUE *q, K_BLK_TRANSFER transfer, void *context, uint32_t sector_size, uint32_t max_sectors)
+{
+	uint32_t	slot, intf;
+	HRESULT		hr;
+
+	if (!q || !transfer) {
+		return E_POINTER;
+	}
+
+	if (sector_size == 0 || max_sectors == 0) {
+		return E_INVALIDARG;
+	}
+
+	memset(q, 0, sizeof(K_BLK_QUEUE));
+	q->transfer		= transfer;
+	q->context		= context;
+	q->sector_size	= sector_size;
+	q->max_sectors	= max_sectors;
+
+	mutex_create(&q->lock);
+	event_create(&q->event, EVENT_FLAG_NONE);
+	event_create(&q->rq_event, EVENT_FLAG_NONE);
+
+	/* All requests start on the free list */
+	for (uint32_t i=BLKQ_MAX_REQUESTS; i>0; i--) {
+		q->rq_pool[i-1].fifo_next = q->rq_free;
+		q->rq_free = &q->rq_pool[i-1];
+	}
+
+	q->sched = &blk_deadline_scheduler;
+
+	hr = q->sched->init(q);
+	if (FAILED(hr)) return hr;
+
+	/* Register the queue, so it's thread can claim it */
+	intf = spinlock_acquire(&blkq_lock);
+
+	for (slot=0; slot<BLKQ_MAX_QUEUES; slot++) {
+		if (blkq_queues[slot] == NULL) break;
+	}
+
+	if (slot < BLKQ_MAX_QUEUES) {
+		blkq_queues[slot] = q;
+	}
+
+	spinlock_release(&blkq_lock, intf);
+
+	if (slot == BLKQ_MAX_QUEUES) {
+		q->sched->exit(q);
+		return E_OUTOFMEM;
+	}
+
+	hr = sched_create_thread(NULL, blkq_thread, NULL);
+	if (FAILED(hr)) {
+		intf = spinlock_acquire(&blkq_lock);
+		blkq_queues[slot] = NULL;
+		spinlock_release(&blkq_lock, intf);
+
+		q->sched->exit(q);
+	}
+
+	return hr;
+}
+
+HRESULT __nxapi blkq_destroy(K_BLK_QUEUE *q)
+{
+	uint32_t intf;
+
+	mutex_lock(&q->lock);
+	q->dying = TRUE;
+	q->plug_count = 0;
+	event_signal(&q->event);
+	mutex_unlock(&q->lock);
+
+	/* The thread drains the queue before it exits */
+	while (q->has_thread) {
+		timer_sleep(1);
+	}
+
+	intf = spinlock_acquire(&blkq_lock);
+
+	for (uint32_t i=0; i<BLKQ_MAX_QUEUES; i++) {
+		if (blkq_queues[i] == q) blkq_queues[i] = NULL;
+	}
+
+	spinlock_release(&blkq_lock, intf);
+
+	q->sched->exit(q);
+	mutex_destroy(&q->lock);
+
+	return S_OK;
+}
+
+HRESULT __nxapi blkq_set_scheduler(K_BLK_QUEUE *q, const K_BLK_SCHEDULER *sched)
+{
+	const K_BLK_SCHEDULER	*old;
+	HRESULT					hr;
+
+	/* Requests can't be moved between schedulers, wait until it's empty */
+	while (TRUE) {
+		mutex_lock(&q->lock);
+		if (q->queued == 0) break;
+
+		mutex_unlock(&q->lock);
+		timer_sleep(1);
+	}
+
+	old = q->sched;
+	old->exit(q);
+
+	hr = sched->init(q);
+	if (SUCCEEDED(hr)) {
+		q->sched = sched;
+	} else {
+		old->init(q);
+	}
+
+	mutex_unlock(&q->lock);
+	return hr;
+}
+
+/*
+ * Threads don't receive arguments, so a new thread picks the first
+ * queue which doesn't have it's thread yet.
+ */
+static K_BLK_QUEUE *blkq_claim_queue()
+{
+	K_BLK_QUEUE	*q = NULL;
+	uint32_t	intf;
+
+	intf = spinlock_acquire(&blkq_lock);
+
+	for (uint32_t i=0; i<BLKQ_MAX_QUEUES; i++) {
+		if (blkq_queues[i] && !blkq_queues[i]->has_thread) {
+			q = blkq_queues[i];
+			q->has_thread = TRUE;
+			break;
+		}
+	}
+
+	spinlock_release(&blkq_lock, intf);
+	return q;
+}
+
+static void __nxapi blkq_thread()
+{
+	K_BLK_QUEUE		*q;
+	K_BLK_REQUEST	*rq;
+	uint32_t		elapsed;
+	HRESULT			hr;
+
+	if (!(q = blkq_claim_queue())) {
+		HalKernelPanic("blkq_thread(): No queue to serve.");
+	}
+
+	while (TRUE) {
+		mutex_lock(&q->lock);
+
+		if (q->queued == 0) {
+			if (q->dying) break;
+
+			event_reset(&q->event);
+			mutex_unlock(&q->lock);
+
+			event_waitfor(&q->event, TIMEOUT_INFINITE);
+			continue;
+		}
+
+		if (q->plug_count > 0) {
+			elapsed = timer_gettickcount() - q->plug_time;
+
+			if (elapsed < BLKQ_UNPLUG_DELAY) {
+				event_reset(&q->event);
+				mutex_unlock(&q->lock);
+
+				event_waitfor(&q->event, BLKQ_UNPLUG_DELAY - elapsed);
+				continue;
+			}
+
+			/* The owner didn't unplug in time */
+			q->plug_count = 0;
+			q->stats.plug_timeouts++;
+		}
+
+		rq = q->sched->dispatch(q);
+		q->queued--;
+		q->stats.dispatched++;
+		q->stats.sectors += rq->count;
+
+		mutex_unlock(&q->lock);
+
+		hr = q->transfer(q, rq);
+		blkq_end_request(q, rq, hr);
+	}
+
+	q->has_thread = FALSE;
+	mutex_unlock(&q->lock);
+}
+
+/*
+ * Completes the bios of a request and returns it to the free list.
+ */
+static VOID blkq_end_request(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, HRESULT status)
+{
+	K_BIO *bio, *next;
+
+	for (bio = rq->bio_head; bio != NULL; bio = next) {
+		/* The callback may free the bio */
+		next = bio->next;
+
+		bio->status = status;
+		bio->end_io(bio);
+	}
+
+	mutex_lock(&q->lock);
+
+	rq->bio_head = rq->bio_tail = NULL;
+	rq->fifo_next = q->rq_free;
+	q->rq_free = rq;
+
+	event_signal(&q->rq_event);
+	mutex_unlock(&q->lock);
+}
+
+BOOL __nxapi blkq_can_merge(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, K_BIO *bio, BOOL front)
+{
+	if (rq->op != bio->op) {
+		return FALSE;
+	}
+
+	if (rq->count + bio->count > q->max_sectors || rq->seg_count + bio->seg_count > BLKQ_MAX_SEGMENTS) {
+		return FALSE;
+	}
+
+	if (front) {
+		return bio->sector + bio->count == rq->sector;
+	}
+
+	return rq->sector + rq->count == bio->sector;
+}
+
+HRESULT __nxapi blkq_submit(K_BLK_QUEUE *q, K_BIO *bio)
+{
+	K_BLK_REQUEST	*rq;
+	BOOL			front;
+
+	if (bio->op != BIO_OP_READ && bio->op != BIO_OP_WRITE) {
+		return E_INVALIDARG;
+	}
+
+	if (bio->count == 0 || bio->count > q->max_sectors || bio->seg_count == 0 || bio->seg_count > BIO_MAX_SEGMENTS) {
+		return E_INVALIDARG;
+	}
+
+	bio->next	= NULL;
+	bio->status	= S_OK;
+
+	mutex_lock(&q->lock);
+
+	if (q->dying) {
+		mutex_unlock(&q->lock);
+		return E_INVALIDSTATE;
+	}
+
+	q->stats.bios++;
+
+	/* Try to grow a queued request first */
+	if ((rq = q->sched->find_merge(q, bio, &front)) != NULL) {
+		if (front) {
+			bio->next = rq->bio_head;
+			rq->bio_head = bio;
+			rq->sector = bio->sector;
+			q->stats.front_merges++;
+		} else {
+			rq->bio_tail->next = bio;
+			rq->bio_tail = bio;
+			q->stats.back_merges++;
+		}
+
+		rq->count += bio->count;
+		rq->seg_count += bio->seg_count;
+
+		q->sched->merged(q, rq, front);
+
+		mutex_unlock(&q->lock);
+		return S_OK;
+	}
+
+	/* Wait for a free request */
+	while ((rq = q->rq_free) == NULL) {
+		event_reset(&q->rq_event);
+		mutex_unlock(&q->lock);
+
+		event_waitfor(&q->rq_event, TIMEOUT_INFINITE);
+		mutex_lock(&q->lock);
+	}
+
+	q->rq_free = rq->fifo_next;
+
+	memset(rq, 0, sizeof(K_BLK_REQUEST));
+	rq->op			= bio->op;
+	rq->sector		= bio->sector;
+	rq->count		= bio->count;
+	rq->seg_count	= bio->seg_count;
+	rq->bio_head	= bio;
+	rq->bio_tail	= bio;
+
+	q->sched->add(q, rq);
+	q->queued++;
+	q->stats.requests++;
+
+	if (q->plug_count == 0) {
+		event_signal(&q->event);
+	}
+
+	mutex_unlock(&q->lock);
+	return S_OK;
+}
+
+VOID __nxapi blkq_plug(K_BLK_QUEUE *q)
+{
+	mutex_lock(&q->lock);
+
+	if (q->plug_count++ == 0) {
+		q->plug_time = timer_gettickcount();
+	}
+
+	mutex_unlock(&q->lock);
+}
+
+VOID __nxapi blkq_unplug(K_BLK_QUEUE *q)
+{
+	mutex_lock(&q->lock);
+
+	/* The plug may have expired already */
+	if (q->plug_count > 0 && --q->plug_count == 0 && q->queued > 0) {
+		event_signal(&q->event);
+	}
+
+	mutex_unlock(&q->lock);
+}
+
+static VOID blkq_sync_end_io(K_BIO *bio)
+{
+	BLKQ_SYNC	*sync = bio->private;
+	uint32_t	intf;
+
+	intf = spinlock_acquire(&sync->lock);
+
+	if (FAILED(bio->status)) {
+		sync->status = bio->status;
+	}
+
+	if (--sync->pending == 0) {
+		event_signal(&sync->done);
+	}
+
+	spinlock_release(&sync->lock, intf);
+}
+
+HRESULT __nxapi blkq_transfer(K_BLK_QUEUE *q, uint32_t op, uint64_t sector, uint32_t count, void *buffer)
+{
+	K_BIO		bios[BLKQ_SYNC_BATCH];
+	BLKQ_SYNC	sync;
+	uint8_t		*ptr = buffer;
+	uint32_t	i, n, intf;
+	HRESULT		hr;
+
+	spinlock_create(&sync.lock);
+	event_create(&sync.done, EVENT_FLAG_NONE);
+	sync.status = S_OK;
+
+	while (count > 0) {
+		/* Split into bios of at most max_sectors */
+		for (n=0; n<BLKQ_SYNC_BATCH && count > 0; n++) {
+			K_BIO *bio = &bios[n];
+
+			memset(bio, 0, sizeof(K_BIO));
+			bio->op				= op;
+			bio->sector			= sector;
+			bio->count			= count > q->max_sectors ? q->max_sectors : count;
+			bio->segs[0].base	= ptr;
+			bio->segs[0].len	= bio->count * q->sector_size;
+			bio->seg_count		= 1;
+			bio->end_io			= blkq_sync_end_io;
+			bio->private		= &sync;
+
+			sector	+= bio->count;
+			ptr		+= bio->segs[0].len;
+			count	-= bio->count;
+		}
+
+		event_reset(&sync.done);
+		sync.pending = n;
+
+		blkq_plug(q);
+
+		for (i=0; i<n; i++) {
+			hr = blkq_submit(q, &bios[i]);
+			if (FAILED(hr)) break;
+		}
+
+		blkq_unplug(q);
+
+		if (i < n) {
+			/* Account for the bios which were never queued */
+			intf = spinlock_acquire(&sync.lock);
+
+			sync.status = hr;
+			sync.pending -= n - i;
+			if (sync.pending == 0) event_signal(&sync.done);
+
+			spinlock_release(&sync.lock, intf);
+		}
+
+		event_waitfor(&sync.done, TIMEOUT_INFINITE);
+
+		if (FAILED(sync.status)) {
+			break;
+		}
+	}
+
+	event_destroy(&sync.done);
+	return sync.status;
+}
+
+uint32_t __nxapi blkq_request_iov(K_BLK_REQUEST *rq, K_IOVEC *iov)
+{
+	uint32_t n = 0;
+
+	for (K_BIO *bio = rq->bio_head; bio != NULL; bio = bio->next) {
+		for (uint32_t i=0; i<bio->seg_count; i++) {
+			/* Coalesce segments, which are adjacent in memory */
+			if (n > 0 && (uint8_t*)iov[n-1].base + iov[n-1].len == bio->segs[i].base) {
+				iov[n-1].len += bio->segs[i].len;
+				continue;
+			}
+
+			iov[n++] = bio->segs[i];
+		}
+	}
+
+	return n;
+}
+
+VOID __nxapi blkq_get_stats(K_BLK_QUEUE *q, K_BLK_STATS *stats)
+{
+	mutex_lock(&q->lock);
+	*stats = q->stats;
+	mutex_unlock(&q->lock);
+}
+
+/*
+ * Deadline elevator. Requests are kept sorted by sector and in arrival order,
+ * per direction. Batches of up to DEADLINE_FIFO_BATCH requests are served in
+ * sector order, unless the oldest request has expired. Reads are preferred,
+ * but writes are served after DEADLINE_WRITES_STARVED read batches.
+ */
+static HRESULT deadline_init(K_BLK_QUEUE *q)
+{
+	if (!(q->sched_data = kcalloc(sizeof(BLK_DEADLINE_DATA)))) {
+		return E_OUTOFMEM;
+	}
+
+	return S_OK;
+}
+
+static VOID deadline_exit(K_BLK_QUEUE *q)
+{
+	kfree(q->sched_data);
+	q->sched_data = NULL;
+}
+
+static VOID deadline_sort_insert(BLK_DEADLINE_DATA *d, K_BLK_REQUEST *rq)
+{
+	uint32_t		dir = BLKQ_DIR(rq->op);
+	K_BLK_REQUEST	*prev = NULL, *cur = d->sorted[dir];
+
+	while (cur && cur->sector <= rq->sector) {
+		prev = cur;
+		cur = cur->sort_next;
+	}
+
+	rq->sort_prev = prev;
+	rq->sort_next = cur;
+
+	if (prev) {
+		prev->sort_next = rq;
+	} else {
+		d->sorted[dir] = rq;
+	}
+
+	if (cur) cur->sort_prev = rq;
+}
+
+static VOID deadline_sort_remove(BLK_DEADLINE_DATA *d, K_BLK_REQUEST *rq)
+{
+	uint32_t dir = BLKQ_DIR(rq->op);
+
+	if (d->next_rq[dir] == rq) {
+		d->next_rq[dir] = rq->sort_next;
+	}
+
+	if (rq->sort_prev) {
+		rq->sort_prev->sort_next = rq->sort_next;
+	} else {
+		d->sorted[dir] = rq->sort_next;
+	}
+
+	if (rq->sort_next) rq->sort_next->sort_prev = rq->sort_prev;
+
+	rq->sort_prev = rq->sort_next = NULL;
+}
+
+static VOID deadline_add(K_BLK_QUEUE *q, K_BLK_REQUEST *rq)
+{
+	BLK_DEADLINE_DATA	*d = q->sched_data;
+	uint32_t			dir = BLKQ_DIR(rq->op);
+
+	rq->deadline = timer_gettickcount() + (dir == 0 ? DEADLINE_READ_EXPIRE : DEADLINE_WRITE_EXPIRE);
+
+	deadline_sort_insert(d, rq);
+
+	rq->fifo_prev = d->fifo_tail[dir];
+	rq->fifo_next = NULL;
+
+	if (d->fifo_tail[dir]) {
+		d->fifo_tail[dir]->fifo_next = rq;
+	} else {
+		d->fifo_head[dir] = rq;
+	}
+
+	d->fifo_tail[dir] = rq;
+}
+
+static K_BLK_REQUEST *deadline_find_merge(K_BLK_QUEUE *q, K_BIO *bio, BOOL *front)
+{
+	BLK_DEADLINE_DATA	*d = q->sched_data;
+	K_BLK_REQUEST		*rq;
+
+	for (rq = d->sorted[BLKQ_DIR(bio->op)]; rq != NULL; rq = rq->sort_next) {
+		if (rq->sector > bio->sector + bio->count) {
+			/* Sorted, nothing further can be adjacent */
+			break;
+		}
+
+		if (blkq_can_merge(q, rq, bio, FALSE)) {
+			*front = FALSE;
+			return rq;
+		}
+
+		if (blkq_can_merge(q, rq, bio, TRUE)) {
+			*front = TRUE;
+			return rq;
+		}
+	}
+
+	return NULL;
+}
+
+static VOID deadline_merged(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, BOOL front)
+{
+	BLK_DEADLINE_DATA	*d = q->sched_data;
+	uint32_t			dir = BLKQ_DIR(rq->op);
+	BOOL				was_next;
+
+	if (!front) {
+		return;
+	}
+
+	/* The start sector moved, keep the list sorted */
+	was_next = d->next_rq[dir] == rq;
+
+	deadline_sort_remove(d, rq);
+	deadline_sort_insert(d, rq);
+
+	if (was_next) d->next_rq[dir] = rq;
+}
+
+static K_BLK_REQUEST *deadline_dispatch(K_BLK_QUEUE *q)
+{
+	BLK_DEADLINE_DATA	*d = q->sched_data;
+	K_BLK_REQUEST		*rq, *next;
+	uint32_t			dir;
+
+	/* Continue the current batch */
+	rq = d->next_rq[d->batch_dir];
+	if (rq && d->batching < DEADLINE_FIFO_BATCH) {
+		dir = d->batch_dir;
+		goto dispatch;
+	}
+
+	if (d->sorted[0]) {
+		if (d->sorted[1] && d->starved++ >= DEADLINE_WRITES_STARVED) {
+			goto writes;
+		}
+
+		dir = 0;
+		goto start_batch;
+	}
+
+	if (d->sorted[1]) {
+writes:
+		d->starved = 0;
+		dir = 1;
+		goto start_batch;
+	}
+
+	return NULL;
+
+start_batch:
+	/* Serve expired requests first, otherwise continue in sector order */
+	rq = d->next_rq[dir];
+
+	if (!rq || (int32_t)(timer_gettickcount() - d->fifo_head[dir]->deadline) >= 0) {
+		rq = d->fifo_head[dir];
+	}
+
+	d->batch_dir = dir;
+	d->batching = 0;
+
+dispatch:
+	next = rq->sort_next;
+	deadline_sort_remove(d, rq);
+	d->next_rq[dir] = next;
+
+	if (rq->fifo_prev) {
+		rq->fifo_prev->fifo_next = rq->fifo_next;
+	} else {
+		d->fifo_head[dir] = rq->fifo_next;
+	}
+
+	if (rq->fifo_next) {
+		rq->fifo_next->fifo_prev = rq->fifo_prev;
+	} else {
+		d->fifo_tail[dir] = rq->fifo_prev;
+	}
+
+	d->batching++;
+	return rq;
+}
+
+/*
+ * Noop scheduler. Requests are served in arrival order; bios only merge
+ * with the last request.
+ */
+static HRESULT noop_init(K_BLK_QUEUE *q)
+{
+	if (!(q->sched_data = kcalloc(sizeof(BLK_NOOP_DATA)))) {
+		return E_OUTOFMEM;
+	}
+
+	return S_OK;
+}
+
+static VOID noop_exit(K_BLK_QUEUE *q)
+{
+	kfree(q->sched_data);
+	q->sched_data = NULL;
+}
+
+static VOID noop_add(K_BLK_QUEUE *q, K_BLK_REQUEST *rq)
+{
+	BLK_NOOP_DATA *d = q->sched_data;
+
+	rq->fifo_next = NULL;
+
+	if (d->tail) {
+		d->tail->fifo_next = rq;
+	} else {
+		d->head = rq;
+	}
+
+	d->tail = rq;
+}
+
+static K_BLK_REQUEST *noop_find_merge(K_BLK_QUEUE *q, K_BIO *bio, BOOL *front)
+{
+	BLK_NOOP_DATA *d = q->sched_data;
+
+	if (d->tail == NULL) {
+		return NULL;
+	}
+
+	*front = FALSE;
+	if (blkq_can_merge(q, d->tail, bio, FALSE)) return d->tail;
+
+	*front = TRUE;
+	if (blkq_can_merge(q, d->tail, bio, TRUE)) return d->tail;
+
+	return NULL;
+}
+
+static VOID noop_merged(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, BOOL front)
+{
+	UNUSED_ARG(q);
+	UNUSED_ARG(rq);
+	UNUSED_ARG(front);
+}
+
+static K_BLK_REQUEST *noop_dispatch(K_BLK_QUEUE *q)
+{
+	BLK_NOOP_DATA	*d = q->sched_data;
+	K_BLK_REQUEST	*rq = d->head;
+
+	if (rq) {
+		d->head = rq->fifo_next;
+		if (d->head == NULL) d->tail = NULL;
+	}
+
+	return rq;
+}
+
+/*
+ * Self-test on a RAM disk. Each case submits a few bios while the queue is
+ * plugged, so the scheduler sees all of them before the first dispatch, and
+ * checks the merge counters, the order of the dispatched requests and the
+ * data, for both schedulers.
+ */
+#define BLKQ_TEST_SECTORS		256
+#define BLKQ_TEST_MAX_BIOS		4
+#define BLKQ_TEST_BIO_SIZE		(8 * 512)
+
+#define R	BIO_OP_READ
+#define W	BIO_OP_WRITE
+
+typedef struct {
+	const char	*name;
+
+	/* Submitted bios and dispatched requests, as { op, sector, count } */
+	uint32_t	bios[BLKQ_TEST_MAX_BIOS][3];
+	uint32_t	expect[2][BLKQ_TEST_MAX_BIOS][3];
+
+	uint32_t	back_merges;
+	uint32_t	front_merges;
+} BLKQ_TEST_CASE;
+
+typedef struct {
+	uint8_t		*data;
+
+	/* Dispatched requests */
+	uint32_t	log[BLKQ_TEST_MAX_BIOS][3];
+	uint32_t	log_cnt;
+} BLKQ_RAMDISK;
+
+/* Expected orders are for the deadline and noop scheduler, respectively */
+static const BLKQ_TEST_CASE blkq_test_cases[] = {
+	{ "back merge", { {W,0,8}, {W,8,8}, {W,16,8} },
+		{ { {W,0,24} }, { {W,0,24} } }, 2, 0 },
+	{ "front merge", { {W,48,8}, {W,40,8}, {W,32,8} },
+		{ { {W,32,24} }, { {W,32,24} } }, 0, 2 },
+	{ "front and back merge", { {R,72,4}, {R,76,4}, {R,68,4} },
+		{ { {R,68,12} }, { {R,68,12} } }, 1, 1 },
+	{ "sector order", { {R,50,4}, {R,100,4}, {R,10,4}, {R,70,4} },
+		{ { {R,50,4}, {R,70,4}, {R,100,4}, {R,10,4} }, { {R,50,4}, {R,100,4}, {R,10,4}, {R,70,4} } }, 0, 0 },
+	{ "reads first", { {W,200,8}, {R,0,8}, {W,8,8} },
+		{ { {R,0,8}, {W,200,8}, {W,8,8} }, { {W,200,8}, {R,0,8}, {W,8,8} } }, 0, 0 },
+};
+
+#undef R
+#undef W
+
+static HRESULT blkq_ram_transfer(K_BLK_QUEUE *q, K_BLK_REQUEST *rq)
+{
+	BLKQ_RAMDISK	*rd = q->context;
+	K_IOVEC			iov[BLKQ_MAX_SEGMENTS];
+	uint32_t		i, cnt;
+	uint8_t			*p;
+
+	if (rq->sector + rq->count > BLKQ_TEST_SECTORS) {
+		return E_INVALIDARG;
+	}
+
+	if (rd->log_cnt < BLKQ_TEST_MAX_BIOS) {
+		rd->log[rd->log_cnt][0] = rq->op;
+		rd->log[rd->log_cnt][1] = rq->sector;
+		rd->log[rd->log_cnt][2] = rq->count;
+	}
+
+	rd->log_cnt++;
+
+	cnt = blkq_request_iov(rq, iov);
+	p = rd->data + (uint32_t)rq->sector * q->sector_size;
+
+	for (i=0; i<cnt; i++) {
+		if (rq->op == BIO_OP_READ) {
+			memcpy(iov[i].base, p, iov[i].len);
+		} else {
+			memcpy(p, iov[i].base, iov[i].len);
+		}
+
+		p += iov[i].len;
+	}
+
+	return S_OK;
+}
+
+/* Byte _i_ of _sector_, as written by the test */
+static uint8_t blkq_test_pattern(uint32_t sector, uint32_t i)
+{
+	return (uint8_t)(sector * 13 + i) ^ 0x5A;
+}
+
+static HRESULT blkq_test_case(K_BLK_QUEUE *q, BLKQ_RAMDISK *rd, const BLKQ_TEST_CASE *tc, uint32_t sched, uint8_t *buf)
+{
+	K_BIO		bios[BLKQ_TEST_MAX_BIOS];
+	K_BLK_STATS	before, after;
+	BLKQ_SYNC	sync;
+	uint32_t	i, j, n, half;
+	uint8_t		*p;
+	HRESULT		hr = S_OK;
+
+	spinlock_create(&sync.lock);
+	event_create(&sync.done, EVENT_FLAG_NONE);
+	sync.status = S_OK;
+
+	rd->log_cnt = 0;
+	blkq_get_stats(q, &before);
+
+	for (n=0; n<BLKQ_TEST_MAX_BIOS && tc->bios[n][2] > 0; n++);
+	sync.pending = n;
+
+	/* Two segments per bio, buffers in submission order */
+	blkq_plug(q);
+
+	for (i=0; i<n; i++) {
+		K_BIO *bio = &bios[i];
+
+		p = buf + i * BLKQ_TEST_BIO_SIZE;
+		half = tc->bios[i][2] / 2 * q->sector_size;
+
+		memset(bio, 0, sizeof(K_BIO));
+		bio->op				= tc->bios[i][0];
+		bio->sector			= tc->bios[i][1];
+		bio->count			= tc->bios[i][2];
+		bio->segs[0].base	= p;
+		bio->segs[0].len	= half;
+		bio->segs[1].base	= p + half;
+		bio->segs[1].len	= bio->count * q->sector_size - half;
+		bio->seg_count		= 2;
+		bio->end_io			= blkq_sync_end_io;
+		bio->private		= &sync;
+
+		for (j=0; j<bio->count * q->sector_size; j++) {
+			p[j] = bio->op == BIO_OP_WRITE ? blkq_test_pattern(bio->sector + j / q->sector_size, j % q->sector_size) : 0;
+		}
+
+		hr = blkq_submit(q, bio);
+		if (FAILED(hr)) break;
+	}
+
+	blkq_unplug(q);
+
+	if (FAILED(hr)) {
+		/* Wait for the bios which made it */
+		sync.pending -= n - i;
+		if (sync.pending > 0) event_waitfor(&sync.done, TIMEOUT_INFINITE);
+
+		event_destroy(&sync.done);
+		return hr;
+	}
+
+	event_waitfor(&sync.done, TIMEOUT_INFINITE);
+	event_destroy(&sync.done);
+
+	if (FAILED(sync.status)) {
+		k_printf("  %s, %s: transfer failed (hr=0x%X)\n", tc->name, q->sched->name, sync.status);
+		return sync.status;
+	}
+
+	blkq_get_stats(q, &after);
+
+	if (after.plug_timeouts != before.plug_timeouts) {
+		k_printf("  %s, %s: plug expired, order not checked\n", tc->name, q->sched->name);
+		return E_FAIL;
+	}
+
+	if (after.back_merges - before.back_merges != tc->back_merges ||
+		after.front_merges - before.front_merges != tc->front_merges) {
+		k_printf("  %s, %s: %d back, %d front merges, expected %d, %d\n", tc->name, q->sched->name,
+				after.back_merges - before.back_merges, after.front_merges - before.front_merges,
+				tc->back_merges, tc->front_merges);
+		return E_FAIL;
+	}
+
+	for (i=0; i<BLKQ_TEST_MAX_BIOS && tc->expect[sched][i][2] > 0; i++);
+
+	if (rd->log_cnt != i) {
+		k_printf("  %s, %s: %d requests dispatched, expected %d\n", tc->name, q->sched->name, rd->log_cnt, i);
+		return E_FAIL;
+	}
+
+	for (i=0; i<rd->log_cnt; i++) {
+		if (memcmp(rd->log[i], tc->expect[sched][i], sizeof(rd->log[i])) != 0) {
+			k_printf("  %s, %s: request %d covers sectors %d..%d, expected %d..%d\n", tc->name, q->sched->name, i,
+					rd->log[i][1], rd->log[i][1] + rd->log[i][2] - 1,
+					tc->expect[sched][i][1], tc->expect[sched][i][1] + tc->expect[sched][i][2] - 1);
+			return E_FAIL;
+		}
+	}
+
+	/* Written sectors hold the pattern, read buffers hold the disk */
+	for (i=0; i<n; i++) {
+		uint32_t size = bios[i].count * q->sector_size;
+
+		p = rd->data + (uint32_t)bios[i].sector * q->sector_size;
+
+		if (memcmp(p, buf + i * BLKQ_TEST_BIO_SIZE, size) != 0) {
+			k_printf("  %s, %s: data of sectors %d..%d differs\n", tc->name, q->sched->name,
+					(uint32_t)bios[i].sector, (uint32_t)bios[i].sector + bios[i].count - 1);
+			return E_FAIL;
+		}
+	}
+
+	return S_OK;
+}
+
+HRESULT __nxapi blkq_selftest()
+{
+	static const K_BLK_SCHEDULER	*scheds[] = { &blk_deadline_scheduler, &blk_noop_scheduler };
+	static K_BLK_QUEUE				q;
+	BLKQ_RAMDISK					rd;
+	uint8_t							*buf;
+	uint32_t						i, s, passed = 0, total = 0;
+	HRESULT							hr;
+
+	memset(&rd, 0, sizeof(rd));
+	rd.data	= kmalloc(BLKQ_TEST_SECTORS * 512);
+	buf		= kmalloc(BLKQ_TEST_MAX_BIOS * BLKQ_TEST_BIO_SIZE);
+
+	if (!rd.data || !buf) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (i=0; i<BLKQ_TEST_SECTORS * 512; i++) {
+		rd.data[i] = (uint8_t)(i * 7);
+	}
+
+	/* Bios are up to 8 sectors, requests up to 32 */
+	hr = blkq_create(&q, blkq_ram_transfer, &rd, 512, 32);
+	if (FAILED(hr)) goto finally;
+
+	for (s=0; s<2; s++) {
+		for (i=0; i<sizeof(blkq_test_cases) / sizeof(blkq_test_cases[0]); i++) {
+			/* Start each case with fresh scheduler state */
+			hr = blkq_set_scheduler(&q, scheds[s]);
+			if (FAILED(hr)) break;
+
+			total++;
+
+			hr = blkq_test_case(&q, &rd, &blkq_test_cases[i], s, buf);
+			if (SUCCEEDED(hr)) passed++;
+
+			hr = S_OK;
+		}
+	}
+
+	blkq_destroy(&q);
+
+	k_printf("RAM disk: %d/%d request queue checks passed\n", passed, total);
+
+	if (SUCCEEDED(hr) && passed != total) {
+		hr = E_FAIL;
+	}
+
+finally:
+	if (rd.data) kfree(rd.data);
+	if (buf) kfree(buf);
+
+	return hr;
+}
+
+/*
+ * Benchmark. Half of the threads read sequentially, each it's own region,
+ * the other half read random blocks.
+ */
+#define BLKQ_BENCH_DEVICE		"/dev/hd0"
+#define BLKQ_BENCH_THREADS		4
+#define BLKQ_BENCH_READS		256
+#define BLKQ_BENCH_SECTORS		8
+#define BLKQ_BENCH_REGION		(16 * 1024)
+
+static K_STREAM			*blkq_bench_stream;
+static uint32_t			blkq_bench_blocks;
+static K_EVENT			blkq_bench_go[BLKQ_BENCH_THREADS];
+static K_EVENT			blkq_bench_done;
+static K_SPINLOCK		blkq_bench_lock;
+static uint32_t			blkq_bench_started;
+static uint32_t			blkq_bench_remaining;
+static HRESULT			blkq_bench_status;
+
+/*
+ * Worker thread. It runs for the lifetime of the kernel, one round for
+ * each signal of it's go event.
+ */
+static void __nxapi blkq_bench_worker()
+{
+	IOCTL_STORAGE_READWRITE	rw;
+	uint32_t				id, i, intf, seed;
+	uint8_t					*buf;
+	HRESULT					hr;
+
+	intf = spinlock_acquire(&blkq_bench_lock);
+	id = blkq_bench_started++;
+	spinlock_release(&blkq_bench_lock, intf);
+
+	buf = kmalloc(BLKQ_BENCH_SECTORS * 512);
+
+	while (TRUE) {
+		event_waitfor(&blkq_bench_go[id], TIMEOUT_INFINITE);
+
+		seed = 12345 + id;
+		hr = buf ? S_OK : E_OUTOFMEM;
+
+		for (i=0; i<BLKQ_BENCH_READS && SUCCEEDED(hr); i++) {
+			if (id % 2 == 0) {
+				rw.start = (id / 2) * BLKQ_BENCH_REGION + i * BLKQ_BENCH_SECTORS;
+			} else {
+				seed = seed * 1103515245 + 12345;
+				rw.start = (seed >> 8) % (blkq_bench_blocks - BLKQ_BENCH_SECTORS);
+			}
+
+			rw.start %= blkq_bench_blocks - BLKQ_BENCH_SECTORS;
+			rw.count = BLKQ_BENCH_SECTORS;
+			rw.buffer = buf;
+
+			hr = k_ioctl(blkq_bench_stream, IOCTL_STORAGE_READ_BLOCKS, &rw);
+		}
+
+		intf = spinlock_acquire(&blkq_bench_lock);
+
+		if (FAILED(hr)) blkq_bench_status = hr;
+		if (--blkq_bench_remaining == 0) event_signal(&blkq_bench_done);
+
+		spinlock_release(&blkq_bench_lock, intf);
+	}
+}
+
+HRESULT __nxapi blkq_benchmark()
+{
+	static const K_BLK_SCHEDULER	*scheds[] = { &blk_deadline_scheduler, &blk_noop_scheduler };
+	static BOOL						initialized = FALSE;
+	K_BLK_QUEUE						*q;
+	K_BLK_STATS						before, after;
+	size_t							blocks;
+	uint32_t						i, pass, t, total;
+	HRESULT							hr;
+
+	hr = blkq_selftest();
+	if (FAILED(hr)) return hr;
+
+	hr = k_fopen(BLKQ_BENCH_DEVICE, FILE_OPEN_READ, &blkq_bench_stream);
+	if (FAILED(hr)) {
+		k_printf("No IDE disk at %s, skipped.\n", BLKQ_BENCH_DEVICE);
+		return S_OK;
+	}
+
+	hr = k_ioctl(blkq_bench_stream, IOCTL_STORAGE_GET_QUEUE, &q);
+	if (FAILED(hr)) {
+		k_printf("%s has no request queue.\n", BLKQ_BENCH_DEVICE);
+		goto finally;
+	}
+
+	hr = storage_get_block_count(blkq_bench_stream, &blocks);
+	if (FAILED(hr)) goto finally;
+
+	if (blocks <= BLKQ_BENCH_THREADS * BLKQ_BENCH_REGION) {
+		k_printf("%s is too small.\n", BLKQ_BENCH_DEVICE);
+		hr = E_FAIL;
+		goto finally;
+	}
+
+	blkq_bench_blocks = blocks;
+
+	if (!initialized) {
+		spinlock_create(&blkq_bench_lock);
+		event_create(&blkq_bench_done, EVENT_FLAG_NONE);
+
+		for (i=0; i<BLKQ_BENCH_THREADS; i++) {
+			event_create(&blkq_bench_go[i], EVENT_FLAG_AUTORESET);
+
+			hr = sched_create_thread(NULL, blkq_bench_worker, NULL);
+			if (FAILED(hr)) goto finally;
+		}
+
+		initialized = TRUE;
+	}
+
+	total = BLKQ_BENCH_THREADS * BLKQ_BENCH_READS * BLKQ_BENCH_SECTORS * 512;
+
+	for (pass=0; pass<2; pass++) {
+		hr = blkq_set_scheduler(q, scheds[pass]);
+		if (FAILED(hr)) goto finally;
+
+		blkq_get_stats(q, &before);
+
+		blkq_bench_status = S_OK;
+		blkq_bench_remaining = BLKQ_BENCH_THREADS;
+		event_reset(&blkq_bench_done);
+
+		t = timer_gettickcount();
+
+		for (i=0; i<BLKQ_BENCH_THREADS; i++) {
+			event_signal(&blkq_bench_go[i]);
+		}
+
+		event_waitfor(&blkq_bench_done, TIMEOUT_INFINITE);
+		t = timer_gettickcount() - t;
+
+		blkq_get_stats(q, &after);
+
+		if (FAILED(blkq_bench_status)) {
+			k_printf("%s: reads failed (hr=0x%X).\n", scheds[pass]->name, blkq_bench_status);
+			hr = blkq_bench_status;
+			break;
+		}
+
+		k_printf("%s: %d KiB in %d ms (%d KiB/s), %d bios in %d requests (%d back, %d front merges)\n",
+				scheds[pass]->name, total / 1024, t, t > 0 ? total / 1024 * 1000 / t : 0,
+				after.bios - before.bios, after.requests - before.requests,
+				after.back_merges - before.back_merges, after.front_merges - before.front_merges);
+	}
+
+	blkq_set_scheduler(q, &blk_deadline_scheduler);
+
+finally:
+	k_fclose(&blkq_bench_stream);
+	return hr;
+}
@@ -0,0 +1,431 @@
+/*
+ * dcache.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "dcache.h"
+#include "syncobjs.h"
+#include "string.h"
+#include "kstdio.h"
+#include "timer.h"
+#include "vfs.h"
+#include "drivers/fat16.h"
+
+#define DCACHE_BUCKET_MASK		(DCACHE_BUCKETS - 1)
+
+static K_DENTRY			dcache_pool[DCACHE_MAX_ENTRIES];
+static K_DENTRY			*dcache_buckets[DCACHE_BUCKETS];
+static K_DENTRY			*dcache_free;
+static K_DENTRY			*dcache_lru_head;
+static K_DENTRY			*dcache_lru_tail;
+static K_SPINLOCK		dcache_lock;
+static K_DCACHE_STATS	dcache_stats;
+
+/*
+ * Prototypes
+ */
+static uint32_t dcache_bucket(void *owner, uint64_t parent, uint32_t name_hash);
+static K_DENTRY *dcache_find(void *owner, uint64_t parent, const char *name, uint32_t hash);
+static void dcache_lru_unlink(K_DENTRY *d);
+static void dcache_lru_push(K_DENTRY *d);
+static void dcache_remove(K_DENTRY *d);
+static void dcache_print_stats(const char *label);
+
+uint32_t __nxapi dcache_hash_name(const char *name, size_t len)
+{
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i=0; i<len; i++) {
+		h ^= (uint8_t)name[i];
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+HRESULT __nxapi dcache_initialize()
+{
+	uint32_t i;
+
+	memset(dcache_pool, 0, sizeof(dcache_pool));
+	memset(dcache_buckets, 0, sizeof(dcache_buckets));
+	memset(&dcache_stats, 0, sizeof(dcache_stats));
+
+	/* Chain all entries to the free list */
+	dcache_free = NULL;
+	for (i=DCACHE_MAX_ENTRIES; i>0; i--) {
+		dcache_pool[i-1].hash_next = dcache_free;
+		dcache_free = &dcache_pool[i-1];
+	}
+
+	dcache_lru_head = dcache_lru_tail = NULL;
+	spinlock_create(&dcache_lock);
+
+	return S_OK;
+}
+
+HRESULT __nxapi dcache_lookup(void *owner, uint64_t parent, const char *name, void *value, size_t size)
+{
+	size_t len = strlen(name);
+	uint32_t intf;
+	HRESULT hr;
+
+	if (len >= DCACHE_MAX_NAME) {
+		/* Never cached */
+		return S_FALSE;
+	}
+
+	uint32_t hash = dcache_hash_name(name, len);
+
+	intf = spinlock_acquire(&dcache_lock);
+
+	K_DENTRY *d = dcache_find(owner, parent, name, hash);
+
+	if (d == NULL) {
+		dcache_stats.misses++;
+		hr = S_FALSE;
+	} else {
+		/* Move to the front of the LRU list */
+		dcache_lru_unlink(d);
+		dcache_lru_push(d);
+
+		if (d->negative) {
+			dcache_stats.negative_hits++;
+			hr = E_NOTFOUND;
+		} else {
+			if (value) {
+				memcpy(value, d->value, size < d->value_size ? size : d->value_size);
+			}
+
+			dcache_stats.hits++;
+			hr = S_OK;
+		}
+	}
+
+	spinlock_release(&dcache_lock, intf);
+	return hr;
+}
+
+HRESULT __nxapi dcache_insert(void *owner, uint64_t parent, const char *name, const void *value, size_t size)
+{
+	size_t len = strlen(name);
+	uint32_t intf;
+
+	if (owner == NULL) {
+		return E_POINTER;
+	}
+
+	if (len >= DCACHE_MAX_NAME || size > DCACHE_MAX_VALUE) {
+		/* Not cacheable, but not an error either */
+		return S_FALSE;
+	}
+
+	uint32_t hash = dcache_hash_name(name, len);
+
+	intf = spinlock_acquire(&dcache_lock);
+
+	K_DENTRY *d = dcache_find(owner, parent, name, hash);
+
+	if (d != NULL) {
+		/* Replace the old value */
+		dcache_lru_unlink(d);
+	} else {
+		if (dcache_free == NULL) {
+			/* Recycle least recently used entry */
+			dcache_remove(dcache_lru_tail);
+			dcache_stats.evictions++;
+		}
+
+		d = dcache_free;
+		dcache_free = d->hash_next;
+
+		d->owner = owner;
+		d->parent = parent;
+		d->hash = hash;
+		memcpy(d->name, name, len + 1);
+
+		uint32_t b = dcache_bucket(owner, parent, hash);
+		d->hash_next = dcache_buckets[b];
+		dcache_buckets[b] = d;
+
+		dcache_stats.entries++;
+	}
+
+	d->negative = (value == NULL);
+	d->value_size = value ? size : 0;
+	if (value) {
+		memcpy(d->value, value, size);
+	}
+
+	dcache_lru_push(d);
+
+	spinlock_release(&dcache_lock, intf);
+	return S_OK;
+}
+
+VOID __nxapi dcache_invalidate(void *owner, uint64_t parent, const char *name)
+{
+	size_t len = strlen(name);
+	uint32_t intf;
+
+	if (len >= DCACHE_MAX_NAME) {
+		return;
+	}
+
+	uint32_t hash = dcache_hash_name(name, len);
+
+	intf = spinlock_acquire(&dcache_lock);
+
+	K_DENTRY *d = dcache_find(owner, parent, name, hash);
+	if (d != NULL) {
+		dcache_remove(d);
+	}
+
+	spinlock_release(&dcache_lock, intf);
+}
+
+VOID __nxapi dcache_invalidate_dir(void *owner, uint64_t parent)
+{
+	uint32_t intf, i;
+
+	intf = spinlock_acquire(&dcache_lock);
+
+	for (i=0; i<DCACHE_MAX_ENTRIES; i++) {
+		K_DENTRY *d = &dcache_pool[i];
+
+		if (d->owner == owner && d->parent == parent) {
+			dcache_remove(d);
+		}
+	}
+
+	spinlock_release(&dcache_lock, intf);
+}
+
+VOID __nxapi dcache_invalidate_owner(void *owner)
+{
+	uint32_t intf, i;
+
+	intf = spinlock_acquire(&dcache_lock);
+
+	for (i=0; i<DCACHE_MAX_ENTRIES; i++) {
+		K_DENTRY *d = &dcache_pool[i];
+
+		if (d->owner != NULL && d->owner == owner) {
+			dcache_remove(d);
+		}
+	}
+
+	spinlock_release(&dcache_lock, intf);
+}
+
+VOID __nxapi dcache_get_stats(K_DCACHE_STATS *stats)
+{
+	uint32_t intf = spinlock_acquire(&dcache_lock);
+	*stats = dcache_stats;
+	spinlock_release(&dcache_lock, intf);
+}
+
+VOID __nxapi dcache_reset_stats()
+{
+	uint32_t intf = spinlock_acquire(&dcache_lock);
+
+	dcache_stats.hits = 0;
+	dcache_stats.negative_hits = 0;
+	dcache_stats.misses = 0;
+	dcache_stats.evictions = 0;
+
+	spinlock_release(&dcache_lock, intf);
+}
+
+static uint32_t dcache_bucket(void *owner, uint64_t parent, uint32_t name_hash)
+{
+	uint32_t h = name_hash;
+
+	h ^= (uint32_t)owner * 2654435761u;
+	h ^= (uint32_t)parent * 40503u;
+	h ^= (uint32_t)(parent >> 32);
+	h ^= h >> 16;
+
+	return h & DCACHE_BUCKET_MASK;
+}
+
+static K_DENTRY *dcache_find(void *owner, uint64_t parent, const char *name, uint32_t hash)
+{
+	K_DENTRY *d = dcache_buckets[dcache_bucket(owner, parent, hash)];
+
+	while (d != NULL) {
+		if (d->hash == hash && d->owner == owner && d->parent == parent && strcmp(d->name, name) == 0) {
+			return d;
+		}
+
+		d = d->hash_next;
+	}
+
+	return NULL;
+}
+
+static void dcache_lru_unlink(K_DENTRY *d)
+{
+	if (d->lru_prev) d->lru_prev->lru_next = d->lru_next;
+	else dcache_lru_head = d->lru_next;
+
+	if (d->lru_next) d->lru_next->lru_prev = d->lru_prev;
+	else dcache_lru_tail = d->lru_prev;
+
+	d->lru_prev = d->lru_next = NULL;
+}
+
+static void dcache_lru_push(K_DENTRY *d)
+{
+	d->lru_prev = NULL;
+	d->lru_next = dcache_lru_head;
+
+	if (dcache_lru_head) dcache_lru_head->lru_prev = d;
+	else dcache_lru_tail = d;
+
+	dcache_lru_head = d;
+}
+
+/* Unlinks an entry and returns it to the free list. Called with the lock held. */
+static void dcache_remove(K_DENTRY *d)
+{
+	K_DENTRY **link = &dcache_buckets[dcache_bucket(d->owner, d->parent, d->hash)];
+
+	while (*link != d) {
+		link = &(*link)->hash_next;
+	}
+
+	*link = d->hash_next;
+	dcache_lru_unlink(d);
+
+	d->owner = NULL;
+	d->hash_next = dcache_free;
+	dcache_free = d;
+
+	dcache_stats.entries--;
+}
+
+#define DCACHE_BENCH_DEPTH		8
+#define DCACHE_BENCH_FANOUT		16
+#define DCACHE_BENCH_OPENS		5000
+#define DCACHE_BENCH_FAT_OPENS	500
+
+static void dcache_print_stats(const char *label)
+{
+	K_DCACHE_STATS	s;
+	uint32_t		total;
+
+	dcache_get_stats(&s);
+	total = s.hits + s.negative_hits + s.misses;
+
+	k_printf("%s: %d hits, %d negative hits, %d misses (%d%% hit rate), %d evictions, %d entries\n",
+			label, s.hits, s.negative_hits, s.misses,
+			total ? (s.hits + s.negative_hits) * 100 / total : 0, s.evictions, s.entries);
+}
+
+/* Opens and closes `path` `count` times, returns elapsed milliseconds */
+static uint32_t dcache_bench_open(char *path, uint32_t count, HRESULT *hr_out)
+{
+	K_STREAM	*s;
+	uint32_t	i;
+	QWORD		t = timer_gettickcount();
+	HRESULT		hr = S_OK;
+
+	for (i=0; i<count; i++) {
+		hr = k_fopen(path, FILE_OPEN_READ, &s);
+		if (FAILED(hr)) break;
+
+		k_fclose(&s);
+	}
+
+	*hr_out = hr;
+	return (uint32_t)(timer_gettickcount() - t);
+}
+
+HRESULT __nxapi dcache_benchmark()
+{
+	char			path[VFS_MAX_DIRNAME_LENGTH];
+	char			name[VFS_MAX_FILENAME_LENGTH];
+	K_FS_NODE_INFO	info;
+	K_DIR_STREAM	*ds;
+	uint32_t		i, j, len, ms;
+	HRESULT			hr;
+
+	/* Build a tree on the VFS, DCACHE_BENCH_FANOUT directories wide at every level */
+	strcpy(path, "/temp/dcbench");
+	k_mkdir(path, NODE_MODE_ALL_RWE);
+
+	for (i=0; i<DCACHE_BENCH_DEPTH; i++) {
+		len = strlen(path);
+
+		for (j=0; j<DCACHE_BENCH_FANOUT; j++) {
+			snprintf(path + len, sizeof(path) - len, "/level%d_%d", i, j);
+			k_mkdir(path, NODE_MODE_ALL_RWE);
+		}
+
+		/* Descend through the last one, so a linear scan has the most work */
+		snprintf(path + len, sizeof(path) - len, "/level%d_%d", i, DCACHE_BENCH_FANOUT - 1);
+	}
+
+	len = strlen(path);
+	snprintf(path + len, sizeof(path) - len, "/file");
+	k_fcreate(path, NODE_MODE_ALL_RWE);
+
+	ms = dcache_bench_open(path, DCACHE_BENCH_OPENS, &hr);
+	if (FAILED(hr)) {
+		k_printf("Failed to open %s (hr=0x%X).\n", path, hr);
+		return hr;
+	}
+
+	k_printf("VFS: %d opens of a %d level deep path in %d ms (%d ns/open)\n",
+			DCACHE_BENCH_OPENS, DCACHE_BENCH_DEPTH + 3, ms, ms * (1000000 / DCACHE_BENCH_OPENS));
+
+	/* FAT floppy. Mount it, unless it's already mounted. */
+	hr = k_opendir("/drives/a", &ds);
+	if (FAILED(hr)) {
+		hr = vfs_mount_fs("/drives/a", fat16_get_constructor(), "/dev/fdd0");
+		if (SUCCEEDED(hr)) hr = k_opendir("/drives/a", &ds);
+	}
+
+	if (FAILED(hr)) {
+		k_printf("FAT: no floppy mounted at /drives/a (hr=0x%X), skipped.\n", hr);
+		return S_OK;
+	}
+
+	/* Find a file in the root directory */
+	name[0] = '\0';
+	while (k_readdir(ds, name, &info) == S_OK) {
+		if (info.node_type == FS_NODE_TYPE_FILE) break;
+		name[0] = '\0';
+	}
+	k_closedir(&ds);
+
+	if (name[0] == '\0') {
+		k_printf("FAT: no files in the root directory, skipped.\n");
+		return S_OK;
+	}
+
+	snprintf(path, sizeof(path), "/drives/a/%s", name);
+	dcache_reset_stats();
+
+	ms = dcache_bench_open(path, 1, &hr);
+	if (FAILED(hr)) {
+		k_printf("Failed to open %s (hr=0x%X).\n", path, hr);
+		return hr;
+	}
+	k_printf("FAT: cold open of %s in %d ms\n", path, ms);
+
+	ms = dcache_bench_open(path, DCACHE_BENCH_FAT_OPENS, &hr);
+	k_printf("FAT: %d warm opens in %d ms\n", DCACHE_BENCH_FAT_OPENS, ms);
+
+	/* Names which don't exist are answered by negative entries */
+	snprintf(path, sizeof(path), "/drives/a/NOFILE.XYZ");
+	ms = dcache_bench_open(path, DCACHE_BENCH_FAT_OPENS, &hr);
+	k_printf("FAT: %d failed opens in %d ms\n", DCACHE_BENCH_FAT_OPENS, ms);
+
+	dcache_print_stats("FAT");
+	return S_OK;
+}
@@ -258,11 +258,11 @@ void __nxapi isr_handler_gateway(K_REGISTERS regs)
 		return isr_callbacks[regs.int_no](regs);
 	}
 
-	k_printf("Unhandled interrupt: %x\n", regs.int_no);
+	k_printf("Unhandled interrupt: 0x%X\n", regs.int_no);
 	k_printf("Dumping register states...\n");
-	k_printf("EAX= %x\t EBX= %x\t ECX= %x\t EDX= %x\n", regs.eax, regs.ebx, regs.ecx, regs.edx);
-	k_printf("CS = %x\t DS = %x\t SS = %x\t EIP= %x\n", regs.cs, regs.ds, regs.ss, regs.eip);
-	k_printf("RETCODE= %x\t INT_NUM= %x\n", regs.err_code, regs.int_no);
+	k_printf("EAX= 0x%X\t EBX= 0x%X\t ECX= 0x%X\t EDX= 0x%X\n", regs.eax, regs.ebx, regs.ecx, regs.edx);
+	k_printf("CS = 0x%X\t DS = 0x%X\t SS = 0x%X\t EIP= 0x%X\n", regs.cs, regs.ds, regs.ss, regs.eip);
+	k_printf("RETCODE= 0x%X\t INT_NUM= 0x%X\n", regs.err_code, regs.int_no);
 }
 
 HRESULT __nxapi register_isr_callback(DWORD int_id, K_INTERRUPTCALLBACK pCB, void* data_ptr)
@@ -345,7 +345,7 @@ void __nxapi irq_handler_gateway(K_REGISTERS regs)
 	char msg[256];
 
 	/* It seems we weren't able to handle this */
-	sprintf(msg, "Unhandled IRQ (int_id= %x; dec= %d)\n", regs.int_no, regs.int_no );
+	sprintf(msg, "Unhandled IRQ (int_id= 0x%X; dec= %d)\n", regs.int_no, regs.int_no );
 	HalKernelPanic(msg);
 }
 
@@ -448,7 +448,7 @@ void __nxapi gdt_update_tss(uint16_t ss_kernel, uint32_t esp_kernel)
 
 void __nxapi exception_handler_gpf(K_REGISTERS regs)
 {
-	k_printf("General protection fault at address %x. (errcode: %x)\n", regs.eip, regs.err_code);
+	k_printf("General protection fault at address 0x%X. (errcode: 0x%X)\n", regs.eip, regs.err_code);
 	HalKernelPanic("");
 }
 
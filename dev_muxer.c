@@ -6,52 +6,31 @@
  */
 #include <dev_muxer.h>
 #include <syncobjs.h>
+#include <scheduler.h>
 #include <timer.h>
+#include <pipe.h>
+#include <ioctl_def.h>
 #include <hal.h>
 #include <mm.h>
+#include <string.h>
 
-typedef enum {
-	VSTREAM_CALL_READ,
-	VSTREAM_CALL_WRITE,
-	VSTREAM_CALL_CLOSE,
-	VSTREAM_CALL_TELL,
-	VSTREAM_CALL_SEEK,
-	VSTREAM_CALL_IOCTL,
-} VSTREAM_CALL_TYPE;
-
-typedef union {
-	VSTREAM_CALL_TYPE type;
-
-	struct {
-		size_t	block_size;
-		void	*out_buf;
-		size_t	*bytes_read;
-	} read;
-
-	struct {
-		int32_t	block_size;
-		void	*in_buf;
-		size_t	*bytes_written;
-	} write;
-
-	struct {
-		int64_t pos;
-		int8_t	origin;
-	} seek;
-
-	struct {
-		uint32_t code;
-		void	*arg;
-	} ioctl;
-} VSTREAM_CALL_PARAMS;
+/* Muxers, served by demultiplexer threads */
+static K_DEV_MUXER	*devmux_muxers[DEVMUX_MAX_MUXERS];
+static uint32_t		devmux_active_cnt;
+static uint32_t		devmux_thread_cnt;
+static K_SPINLOCK	devmux_lock;
+
+/* Signaled when a muxer is registered, idle threads wait on it */
+static K_EVENT		devmux_work_ev;
 
 /*
  * Private function prototypes
  */
 static K_DEV_STREAM __nxapi *vstream_create(K_DEV_MUXER *dm, uint32_t slot);
 static VOID			__nxapi	vstream_destroy(K_DEV_STREAM *s);
-static HRESULT		__nxapi vstream_forward_call(K_DEV_STREAM *str, VSTREAM_CALL_PARAMS *params, uint32_t *result);
-static HRESULT		__nxapi vstream_deserialize_call(K_STREAM *target, VSTREAM_CALL_PARAMS *p, uint32_t *result);
+static HRESULT		__nxapi vstream_begin_call(K_DEV_STREAM *str, K_DEVMUX_FRAME *hdr, void *payload, void *out_buf, size_t out_size, K_DEVMUX_CALL **out);
+static HRESULT		__nxapi vstream_end_call(K_DEV_STREAM *str, K_DEVMUX_CALL *call, uint32_t *result, size_t *bytes);
+static HRESULT		__nxapi vstream_call(K_DEV_STREAM *str, K_DEVMUX_FRAME *hdr, void *payload, void *out_buf, size_t out_size, uint32_t *result, size_t *bytes);
 static HRESULT 		__nxapi vstream_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read);
 static HRESULT 		__nxapi vstream_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written);
 static HRESULT 		__nxapi vstream_close(K_STREAM **str);
@@ -59,22 +38,43 @@ static uint32_t 	__nxapi vstream_tell(K_STREAM *str);
 static uint32_t 	__nxapi vstream_seek(K_STREAM *str, int64_t pos, int8_t origin);
 static HRESULT 		__nxapi vstream_ioctl(K_STREAM *s, uint32_t code, void *arg);
 
-static ULONG		__nxapi device_addref(K_DEV_DESC *dd);
-static ULONG		__nxapi device_release(K_DEV_DESC *dd);
+static VOID			__nxapi device_fail_calls(K_DEV_DESC *dd, HRESULT status);
+static VOID			__nxapi device_release(K_DEV_DESC *dd);
+
+static K_EVENT		__nxapi *link_event(K_STREAM *s, uint32_t code);
+static VOID			__nxapi link_wait(K_EVENT *ev);
+static HRESULT		__nxapi link_read(K_STREAM *s, K_EVENT *ev, void *buf, size_t size, volatile BOOL *stop);
+static HRESULT		__nxapi link_write(K_STREAM *s, K_EVENT *ev, void *buf, size_t size, volatile BOOL *stop);
+static HRESULT		__nxapi link_discard(K_STREAM *s, K_EVENT *ev, size_t size, volatile BOOL *stop);
 
-static K_DEV_MUXER	__nxapi *devmux_create_intrnl(K_DEVMUX_DIRECTION dir, K_STREAM *stream, BOOL autoclose);
+static K_DEV_MUXER	__nxapi *devmux_create_intrnl(K_STREAM *tx, K_STREAM *rx, BOOL autoclose);
+static K_DEV_MUXER	__nxapi *devmux_claim();
+static void			__nxapi devmux_demux_thread();
+static HRESULT		__nxapi devmux_demux(K_DEV_MUXER *dm);
 
 /*
  * Implementation
  */
 
+HRESULT __nxapi devmux_initialize()
+{
+	memset(devmux_muxers, 0, sizeof(devmux_muxers));
+	devmux_active_cnt = 0;
+	devmux_thread_cnt = 0;
+	spinlock_create(&devmux_lock);
+	event_create(&devmux_work_ev, EVENT_FLAG_NONE);
+
+	return S_OK;
+}
+
 static K_DEV_MUXER __nxapi
-*devmux_create_intrnl(K_DEVMUX_DIRECTION dir, K_STREAM *stream, BOOL autoclose)
+*devmux_create_intrnl(K_STREAM *tx, K_STREAM *rx, BOOL autoclose)
 {
 	K_DEV_MUXER	*dm;
-	uint32_t	i;
+	uint32_t	i, intf;
+	BOOL		new_thread = FALSE;
 
-	if (stream == NULL || (dir != DEVMUX_DIRECTION_INPUT && dir != DEVMUX_DIRECTION_OUTPUT)) {
+	if (tx == NULL || rx == NULL) {
 		return NULL;
 	}
 
@@ -82,57 +82,72 @@ static K_DEV_MUXER __nxapi
 		return NULL;
 	}
 
-	dm->direction = dir;
-	mutex_create(&dm->sec_devices_lock);
+	dm->tx				= tx;
+	dm->rx				= rx;
+	dm->prim_auto_close	= autoclose;
+	dm->link_status		= S_OK;
+	dm->rx_ev			= link_event(rx, IOCTL_STREAM_GET_READ_EVENT);
+	dm->tx_ev			= link_event(tx, IOCTL_STREAM_GET_WRITE_EVENT);
 
-	dm->prim_auto_close				= autoclose;
-	dm->prim_device.initialized 	= TRUE;
-	dm->prim_device.stream			= stream;
+	mutex_create(&dm->tx_lock);
+	mutex_create(&dm->sec_devices_lock);
+	event_create(&dm->demux_done, EVENT_FLAG_NONE);
 
 	for (i=0; i<DEV_MUXER_MAX_DEVICES; i++) {
-		mutex_create(&dm->sec_devices[i].lock);
+		spinlock_create(&dm->sec_devices[i].lock);
+		event_create(&dm->sec_devices[i].ready_ev, EVENT_FLAG_NONE);
 		dm->sec_devices[i].muxer = dm;
 	}
 
+	/* Register the muxer, so a demultiplexer thread can claim it */
+	intf = spinlock_acquire(&devmux_lock);
+
+	for (i=0; i<DEVMUX_MAX_MUXERS; i++) {
+		if (devmux_muxers[i] == NULL) break;
+	}
+
+	if (i < DEVMUX_MAX_MUXERS) {
+		devmux_muxers[i] = dm;
+
+		/* Threads are reused, so start a new one only if all are busy */
+		if (++devmux_active_cnt > devmux_thread_cnt) {
+			devmux_thread_cnt++;
+			new_thread = TRUE;
+		}
+	}
+
+	spinlock_release(&devmux_lock, intf);
+
+	if (i == DEVMUX_MAX_MUXERS) {
+		kfree(dm);
+		return NULL;
+	}
+
+	if (new_thread && FAILED(sched_create_thread(NULL, devmux_demux_thread, NULL))) {
+		HalKernelPanic("devmux_create(): Failed to start demultiplexer thread.");
+	}
+
+	event_signal(&devmux_work_ev);
+
 	return dm;
 }
 
 K_DEV_MUXER	__nxapi
-*devmux_create(K_DEVMUX_DIRECTION dir, char	*primary_device)
+*devmux_create(char	*primary_device)
 {
 	K_DEV_MUXER	*dm;
-	uint32_t	s_flags;
 	K_STREAM	*s;
 
 	if (primary_device == NULL) {
 		return NULL;
 	}
 
-	/* Decide file open flags according to device multiplexer direction
-	 */
-	switch (dir) {
-	case DEVMUX_DIRECTION_INPUT:
-		s_flags = FILE_OPEN_WRITE;
-		break;
-
-	case DEVMUX_DIRECTION_OUTPUT:
-		s_flags = FILE_OPEN_READ;
-		break;
-
-	case DEVMUX_DIRECTION_BIDIRECTION:
-		s_flags = FILE_OPEN_READWRITE;
-		break;
-
-	default:
-		return NULL;
-	}
-
-	if (FAILED(k_fopen(primary_device, s_flags, &s))) {
+	if (FAILED(k_fopen(primary_device, FILE_OPEN_READWRITE, &s))) {
 		return NULL;
 	}
 
 	/* Invoke internal constructor */
-	dm = devmux_create_intrnl(dir, s, TRUE);
+	dm = devmux_create_intrnl(s, s, TRUE);
 
 	if (dm == NULL) {
 		k_fclose(&s);
@@ -142,34 +157,57 @@ K_DEV_MUXER	__nxapi
 }
 
 K_DEV_MUXER	__nxapi
-*devmux_create2(K_DEVMUX_DIRECTION dir, K_STREAM *stream)
+*devmux_create2(K_STREAM *tx, K_STREAM *rx)
 {
-	return devmux_create_intrnl(dir, stream, FALSE);
+	return devmux_create_intrnl(tx, rx, FALSE);
 }
 
 VOID __nxapi
 devmux_destroy(K_DEV_MUXER *dm)
 {
-	uint32_t 	i;
+	K_DEV_DESC	*dd;
+	uint32_t	i, intf;
+	BOOL		busy;
+
+	/* Stop the demultiplexer. It fails all pending calls on it's way out. */
+	dm->stopping = TRUE;
+	devmux_wake(dm->rx, dm->tx);
+	event_waitfor(&dm->demux_done, TIMEOUT_INFINITE);
 
-	/* Lock list */
 	mutex_lock(&dm->sec_devices_lock);
 
-	/* Remove all devices */
 	for (i=0; i<DEV_MUXER_MAX_DEVICES; i++) {
-		devmux_remove_device(dm, i);
-		mutex_destroy(&dm->sec_devices[i].lock);
-	}
+		dd = &dm->sec_devices[i];
+
+		if (dd->initialized) {
+			devmux_remove_device(dm, i);
+		}
+
+		/* Wait for calls, still executing on the slot, to return */
+		while (TRUE) {
+			intf = spinlock_acquire(&dd->lock);
 
-	/* Wait for all devices slots to be released. A semaphore
-	 * will be more appropriate approach than sleep. */
-	while (dm->sec_device_count != 0) {
-		timer_sleep(10);
+			busy = dd->ref_count > 0;
+			if (busy) event_reset(&dd->ready_ev);
+
+			spinlock_release(&dd->lock, intf);
+
+			if (!busy) break;
+			event_waitfor(&dd->ready_ev, TIMEOUT_INFINITE);
+		}
+
+		event_destroy(&dd->ready_ev);
+		spinlock_destroy(&dd->lock);
 	}
 
-	/* Unlock list */
 	mutex_unlock(&dm->sec_devices_lock);
 	mutex_destroy(&dm->sec_devices_lock);
+	mutex_destroy(&dm->tx_lock);
+	event_destroy(&dm->demux_done);
+
+	if (dm->prim_auto_close) {
+		k_fclose(&dm->tx);
+	}
 
 	/* Free device multiplexer structure */
 	kfree(dm);
@@ -178,9 +216,10 @@ devmux_destroy(K_DEV_MUXER *dm)
 HRESULT	__nxapi
 devmux_add_device(K_DEV_MUXER *dm, int32_t slot_id, uint32_t *slot_id_out, K_STREAM **stream_out)
 {
-	HRESULT 	hr = S_OK;
-	uint32_t	i;
-	K_DEV_DESC	*dd;
+	HRESULT 		hr = S_OK;
+	K_DEV_STREAM	*s;
+	K_DEV_DESC		*dd = NULL;
+	uint32_t		i, intf;
 
 	if (slot_id < -1 || slot_id >= DEV_MUXER_MAX_DEVICES) {
 		return E_INVALIDARG;
@@ -189,10 +228,12 @@ devmux_add_device(K_DEV_MUXER *dm, int32_t slot_id, uint32_t *slot_id_out, K_STR
 	/* Lock secondary device list */
 	mutex_lock(&dm->sec_devices_lock);
 
-	/* If no slot is specified, find free slot */
+	/* If no slot is specified, find free slot. Slots with calls
+	 * still returning are not free yet.
+	 */
 	if (slot_id == -1) {
 		for (i=0; i<DEV_MUXER_MAX_DEVICES; i++) {
-			if (!dm->sec_devices[i].initialized) {
+			if (!dm->sec_devices[i].initialized && dm->sec_devices[i].ref_count == 0) {
 				slot_id = i;
 				break;
 			}
@@ -205,42 +246,36 @@ devmux_add_device(K_DEV_MUXER *dm, int32_t slot_id, uint32_t *slot_id_out, K_STR
 		}
 	}
 
-	/* Lock device slot */
 	dd = &dm->sec_devices[slot_id];
-	mutex_lock(&dd->lock);
 
 	/* Make sure slot is free */
-	if (dd->initialized) {
-		/* Invalid slot */
+	if (dd->initialized || dd->ref_count != 0) {
 		hr = E_INVALIDARG;
-		mutex_unlock(&dd->lock);
 		goto finally;
 	}
 
-	if (dd->ref_count != 0) {
-		HalKernelPanic("Unexpected error.");
+	if ((s = vstream_create(dm, slot_id)) == NULL) {
+		/* Failed to create virtual stream */
+		hr = E_OUTOFMEM;
+		goto finally;
 	}
 
-	dd->initialized = TRUE;
-	dd->stream		= (K_STREAM*)vstream_create(dm, slot_id);
+	intf = spinlock_acquire(&dd->lock);
 
-	if (dd->stream == NULL) {
-		/* Failed to create virtual stream */
-		dd->initialized	= FALSE;
-		hr = E_FAIL;
-		mutex_unlock(&dd->lock);
-		goto finally;
+	for (i=0; i<DEVMUX_MAX_INFLIGHT; i++) {
+		dd->calls[i].state = DEVMUX_SLOT_FREE;
+		event_create(&dd->calls[i].done, EVENT_FLAG_NONE);
 	}
 
-	/* Create activation and destruction event */
-	event_create(&dd->activation_ev, EVENT_FLAG_AUTORESET);
-	event_create(&dd->destruction_ev, EVENT_FLAG_AUTORESET);
+	dd->stream		= (K_STREAM*)s;
+	dd->credits		= DEVMUX_INITIAL_CREDITS;
+	dd->next_seq	= 1;
+	dd->initialized = TRUE;
+
+	spinlock_release(&dd->lock, intf);
 
-	/* Add reference to device slot to keep it alive */
-	device_addref(dd);
+	dm->sec_device_count++;
 
-	/* Unlock device slot */
-	mutex_unlock(&dd->lock);
 finally:
 	/* Assign output parameters on success */
 	if (SUCCEEDED(hr)) {
@@ -259,6 +294,7 @@ devmux_remove_device(K_DEV_MUXER *dm, uint32_t slot_id)
 {
 	HRESULT		hr = S_OK;
 	K_DEV_DESC	*dd;
+	uint32_t	intf;
 
 	if (slot_id >= DEV_MUXER_MAX_DEVICES) {
 		return E_INVALIDARG;
@@ -267,33 +303,37 @@ devmux_remove_device(K_DEV_MUXER *dm, uint32_t slot_id)
 	/* Lock device list */
 	mutex_lock(&dm->sec_devices_lock);
 
-	/* Lock device slot */
 	dd = &dm->sec_devices[slot_id];
-	mutex_lock(&dd->lock);
+	intf = spinlock_acquire(&dd->lock);
 
 	/* If slot is free, we can't remove it's device */
 	if (!dd->initialized) {
+		spinlock_release(&dd->lock, intf);
 		hr = E_INVALIDARG;
 		goto finally;
 	}
 
-	/* Signal the destruction event */
-	event_signal(&dd->destruction_ev);
+	dd->initialized = FALSE;
+	dm->sec_device_count--;
+
+	/* Nobody waits for replies anymore */
+	device_fail_calls(dd, E_TERMINATED);
+
+	/* Frees the stream right away, unless a call still holds it */
+	dd->ref_count++;
+	spinlock_release(&dd->lock, intf);
 
-	/* Release reference */
 	device_release(dd);
 
 finally:
-	mutex_unlock(&dd->lock);
 	mutex_unlock(&dm->sec_devices_lock);
-
 	return hr;
 }
 
 HRESULT	__nxapi
 devmux_get_device_stream(K_DEV_MUXER *dm, uint32_t slot_id, K_STREAM **stream_out)
 {
-	HRESULT	hr;
+	HRESULT	hr = S_OK;
 
 	if (slot_id >= DEV_MUXER_MAX_DEVICES) {
 		return E_INVALIDARG;
@@ -302,56 +342,65 @@ devmux_get_device_stream(K_DEV_MUXER *dm, uint32_t slot_id, K_STREAM **stream_ou
 	/* Lock device list */
 	mutex_lock(&dm->sec_devices_lock);
 
-	/* Lock device */
-	mutex_lock(&dm->sec_devices[slot_id].lock);
-
 	if (!dm->sec_devices[slot_id].initialized) {
 		hr = E_INVALIDARG;
 		goto finally;
 	}
 
-	*stream_out = (K_STREAM*)dm->sec_devices[slot_id].stream;
+	*stream_out = dm->sec_devices[slot_id].stream;
 
 finally:
-	/* Unlock device */
-	mutex_unlock(&dm->sec_devices[slot_id].lock);
-
 	/* Unlock device list */
 	mutex_unlock(&dm->sec_devices_lock);
 	return hr;
 }
 
-HRESULT	__nxapi
-devmux_switch_to(K_DEV_MUXER *dm, uint32_t slot)
+/*
+ * Completes all calls still waiting for a reply. Calls, whose reply is being
+ * copied by the demultiplexer, are left to it. Must be called with dd->lock held.
+ */
+static VOID __nxapi
+device_fail_calls(K_DEV_DESC *dd, HRESULT status)
 {
-	HRESULT		hr;
-	K_DEV_DESC	*dd;
+	K_DEVMUX_CALL	*call;
 
-	if (slot >= DEV_MUXER_MAX_DEVICES) {
-		return E_INVALIDARG;
+	for (uint32_t i=0; i<DEVMUX_MAX_INFLIGHT; i++) {
+		call = &dd->calls[i];
+
+		if (call->state == DEVMUX_SLOT_PENDING) {
+			call->status	= status;
+			call->bytes		= 0;
+			call->state		= DEVMUX_SLOT_DONE;
+			event_signal(&call->done);
+		}
 	}
+}
 
-	/* Lock multiplexer */
-	mutex_lock(&dm->sec_devices_lock);
+/*
+ * Drops a call reference. The virtual stream is freed along with the last one.
+ */
+static VOID __nxapi
+device_release(K_DEV_DESC *dd)
+{
+	K_DEV_STREAM	*s = NULL;
+	uint32_t		intf;
 
-	/* Lock device */
-	dd = &dm->sec_devices[slot];
-	mutex_lock(&dd->lock);
+	intf = spinlock_acquire(&dd->lock);
 
-	/* Make sure new device slot is valid */
-	if (!dm->sec_devices[slot].initialized) {
-		hr = E_INVALIDARG;
-		goto finally;
+	if (dd->ref_count == 0) {
+		HalKernelPanic("device_release(): reference count underflow.");
 	}
 
-	/* Switch active device slot */
-	dm->active_slot = slot;
-	event_signal(&dm->sec_devices[slot].activation_ev);
+	if (--dd->ref_count == 0 && !dd->initialized) {
+		s = (K_DEV_STREAM*)dd->stream;
+		dd->stream = NULL;
+	}
 
-finally:
-	mutex_unlock(&dd->lock);
-	mutex_unlock(&dm->sec_devices_lock);
-	return hr;
+	/* Wake anybody waiting for a response slot or for the device to go idle */
+	event_signal(&dd->ready_ev);
+	spinlock_release(&dd->lock, intf);
+
+	if (s) vstream_destroy(s);
 }
 
 static K_DEV_STREAM __nxapi
@@ -383,255 +432,766 @@ vstream_destroy(K_DEV_STREAM *s)
 	kfree(s);
 }
 
+/*
+ * Reserves a response slot and a credit, then sends the CALL frame. Blocks
+ * while the virtual stream has no free slot or credits. On success, the
+ * caller holds a reference to the device until vstream_end_call().
+ */
+static HRESULT __nxapi
+vstream_begin_call(K_DEV_STREAM *str, K_DEVMUX_FRAME *hdr, void *payload, void *out_buf, size_t out_size, K_DEVMUX_CALL **out)
+{
+	K_DEV_MUXER		*dm = str->dm;
+	K_DEV_DESC		*dd = &dm->sec_devices[str->slot];
+	K_DEVMUX_CALL	*call = NULL;
+	uint32_t		intf, i;
+	HRESULT			hr;
+
+	while (TRUE) {
+		intf = spinlock_acquire(&dd->lock);
+
+		if (!dd->initialized || (K_DEV_STREAM*)dd->stream != str) {
+			spinlock_release(&dd->lock, intf);
+			return E_TERMINATED;
+		}
+
+		if (FAILED(dm->link_status)) {
+			hr = dm->link_status;
+			spinlock_release(&dd->lock, intf);
+			return hr;
+		}
+
+		if (dd->credits > 0) {
+			for (i=0; i<DEVMUX_MAX_INFLIGHT; i++) {
+				if (dd->calls[i].state == DEVMUX_SLOT_FREE) {
+					call = &dd->calls[i];
+					break;
+				}
+			}
+		}
+
+		if (call) break;
+
+		/* Reset under the lock, so a release in between is not lost */
+		event_reset(&dd->ready_ev);
+		spinlock_release(&dd->lock, intf);
+
+		event_waitfor(&dd->ready_ev, TIMEOUT_INFINITE);
+	}
+
+	dd->credits--;
+	dd->ref_count++;
+
+	call->state		= DEVMUX_SLOT_PENDING;
+	call->seq		= dd->next_seq++;
+	call->out_buf	= out_buf;
+	call->out_size	= out_size;
+	call->status	= S_OK;
+	call->result	= 0;
+	call->bytes		= 0;
+	event_reset(&call->done);
+
+	spinlock_release(&dd->lock, intf);
+
+	hdr->magic	= DEVMUX_FRAME_MAGIC;
+	hdr->type	= DEVMUX_FRAME_CALL;
+	hdr->slot	= str->slot;
+	hdr->seq	= call->seq;
+
+	/* Header and payload must be adjacent on the link */
+	mutex_lock(&dm->tx_lock);
+
+	hr = link_write(dm->tx, dm->tx_ev, hdr, sizeof(K_DEVMUX_FRAME), &dm->stopping);
+	if (SUCCEEDED(hr) && hdr->payload_size > 0) {
+		hr = link_write(dm->tx, dm->tx_ev, payload, hdr->payload_size, &dm->stopping);
+	}
+
+	mutex_unlock(&dm->tx_lock);
+
+	if (FAILED(hr)) {
+		/* The call never left, so complete it right away */
+		intf = spinlock_acquire(&dd->lock);
+
+		if (call->state == DEVMUX_SLOT_PENDING) {
+			call->status	= hr;
+			call->state		= DEVMUX_SLOT_DONE;
+			event_signal(&call->done);
+		}
+
+		spinlock_release(&dd->lock, intf);
+	}
+
+	*out = call;
+	return S_OK;
+}
+
+/*
+ * Waits for the reply of a call, frees it's response slot and returns it's status.
+ */
+static HRESULT __nxapi
+vstream_end_call(K_DEV_STREAM *str, K_DEVMUX_CALL *call, uint32_t *result, size_t *bytes)
+{
+	K_DEV_DESC	*dd = &str->dm->sec_devices[str->slot];
+	uint32_t	intf;
+	HRESULT		hr;
+
+	event_waitfor(&call->done, TIMEOUT_INFINITE);
+
+	intf = spinlock_acquire(&dd->lock);
+
+	hr = call->status;
+	if (result) *result = call->result;
+	if (bytes) *bytes = call->bytes;
+
+	call->state = DEVMUX_SLOT_FREE;
+
+	spinlock_release(&dd->lock, intf);
+
+	/* Signals ready_ev as well */
+	device_release(dd);
+
+	return hr;
+}
+
+static HRESULT __nxapi
+vstream_call(K_DEV_STREAM *str, K_DEVMUX_FRAME *hdr, void *payload, void *out_buf, size_t out_size, uint32_t *result, size_t *bytes)
+{
+	K_DEVMUX_CALL	*call;
+	HRESULT			hr;
+
+	hr = vstream_begin_call(str, hdr, payload, out_buf, out_size, &call);
+	if (FAILED(hr)) return hr;
+
+	return vstream_end_call(str, call, result, bytes);
+}
+
+/*
+ * Reads are not split, so at most DEVMUX_MAX_PAYLOAD bytes are returned at once.
+ */
 static HRESULT __nxapi
 vstream_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
 {
-	VSTREAM_CALL_PARAMS params;
+	K_DEVMUX_FRAME	hdr;
+	size_t			size = block_size, bytes = 0;
+	HRESULT			hr;
+
+	if (size > DEVMUX_MAX_PAYLOAD) {
+		size = DEVMUX_MAX_PAYLOAD;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.op		= DEVMUX_CALL_READ;
+	hdr.arg[0]	= size;
 
-	params.type = VSTREAM_CALL_READ;
-	params.read.block_size	= block_size;
-	params.read.out_buf		= out_buf;
-	params.read.bytes_read	= bytes_read;
+	hr = vstream_call((K_DEV_STREAM*)str, &hdr, NULL, out_buf, size, NULL, &bytes);
 
-	return vstream_forward_call((K_DEV_STREAM*)str, &params, NULL);
+	if (bytes_read) *bytes_read = bytes;
+	return hr;
 }
 
+/*
+ * Large writes are split into frames, which are kept in flight together.
+ */
 static HRESULT __nxapi
 vstream_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written)
 {
-	VSTREAM_CALL_PARAMS params;
+	K_DEV_STREAM	*s = (K_DEV_STREAM*)str;
+	K_DEVMUX_CALL	*pending[DEVMUX_MAX_INFLIGHT];
+	K_DEVMUX_FRAME	hdr;
+	uint32_t		first = 0, count = 0;
+	size_t			offset = 0, total = 0, bytes, chunk;
+	HRESULT			hr = S_OK, hr2;
+
+	if (block_size < 0) {
+		return E_INVALIDARG;
+	}
+
+	while (offset < (size_t)block_size || count > 0) {
+		/* Issue while there is data and room in the window */
+		if (SUCCEEDED(hr) && offset < (size_t)block_size && count < DEVMUX_MAX_INFLIGHT) {
+			chunk = (size_t)block_size - offset;
+			if (chunk > DEVMUX_MAX_PAYLOAD) chunk = DEVMUX_MAX_PAYLOAD;
+
+			memset(&hdr, 0, sizeof(hdr));
+			hdr.op				= DEVMUX_CALL_WRITE;
+			hdr.arg[0]			= chunk;
+			hdr.payload_size	= chunk;
+
+			hr = vstream_begin_call(s, &hdr, (uint8_t*)in_buf + offset, NULL, 0, &pending[(first + count) % DEVMUX_MAX_INFLIGHT]);
+			if (SUCCEEDED(hr)) {
+				offset += chunk;
+				count++;
+			}
+
+			continue;
+		}
 
-	params.type = VSTREAM_CALL_WRITE;
-	params.write.block_size		= block_size;
-	params.write.in_buf			= in_buf;
-	params.write.bytes_written 	= bytes_written;
+		if (count == 0) {
+			/* Failed before anything was sent */
+			break;
+		}
+
+		/* Retire the oldest call */
+		hr2 = vstream_end_call(s, pending[first], NULL, &bytes);
+		first = (first + 1) % DEVMUX_MAX_INFLIGHT;
+		count--;
+
+		if (SUCCEEDED(hr) && FAILED(hr2)) hr = hr2;
+		if (SUCCEEDED(hr2)) total += bytes;
+	}
 
-	return vstream_forward_call((K_DEV_STREAM*)str, &params, NULL);
+	if (bytes_written) *bytes_written = total;
+	return hr;
 }
 
 static HRESULT __nxapi
 vstream_close(K_STREAM **str)
 {
-	VSTREAM_CALL_PARAMS params;
+	K_DEV_STREAM	*s = (K_DEV_STREAM*)*str;
+	HRESULT			hr;
 
-	params.type = VSTREAM_CALL_CLOSE;
-	return vstream_forward_call((K_DEV_STREAM*)str, &params, NULL);
+	/* The stream is freed once calls in flight return */
+	hr = devmux_remove_device(s->dm, s->slot);
+
+	*str = NULL;
+	return hr;
 }
 
 static uint32_t __nxapi
 vstream_tell(K_STREAM *str)
 {
-	VSTREAM_CALL_PARAMS params;
-	uint32_t			result = 0;
+	K_DEVMUX_FRAME	hdr;
+	uint32_t		result = 0;
 
-	params.type = VSTREAM_CALL_TELL;
-	vstream_forward_call((K_DEV_STREAM*)str, &params, &result);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.op = DEVMUX_CALL_TELL;
 
+	vstream_call((K_DEV_STREAM*)str, &hdr, NULL, NULL, 0, &result, NULL);
 	return result;
 }
 
 static uint32_t __nxapi
 vstream_seek(K_STREAM *str, int64_t pos, int8_t origin)
 {
-	VSTREAM_CALL_PARAMS params;
-	uint32_t			result = 0;
-
-	params.type = VSTREAM_CALL_SEEK;
-	params.seek.pos 	= pos;
-	params.seek.origin	= origin;
+	K_DEVMUX_FRAME	hdr;
+	uint32_t		result = 0;
 
-	vstream_forward_call((K_DEV_STREAM*)str, &params, &result);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.op		= DEVMUX_CALL_SEEK;
+	hdr.arg[0]	= (uint32_t)pos;
+	hdr.arg[1]	= (uint32_t)(pos >> 32);
+	hdr.arg[2]	= (uint32_t)origin;
 
+	vstream_call((K_DEV_STREAM*)str, &hdr, NULL, NULL, 0, &result, NULL);
 	return result;
 }
 
 static HRESULT __nxapi
 vstream_ioctl(K_STREAM *s, uint32_t code, void *arg)
 {
-	VSTREAM_CALL_PARAMS params;
+	K_DEVMUX_FRAME	hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.op		= DEVMUX_CALL_IOCTL;
+	hdr.arg[0]	= code;
+	hdr.arg[1]	= (uint32_t)arg;
+
+	return vstream_call((K_DEV_STREAM*)s, &hdr, NULL, NULL, 0, NULL, NULL);
+}
+
+/*
+ * Transfer helpers. Streams like pipes refuse transfers they can't complete
+ * at once, so keep retrying until it's done or _stop_ is set. In between wait
+ * for the stream's readiness event, streams without one are retried after
+ * yielding the CPU.
+ *
+ * The event is reset before each attempt and _stop_ is checked after that,
+ * so neither a transfer by the peer nor devmux_wake() can slip in unnoticed.
+ */
+static K_EVENT __nxapi *link_event(K_STREAM *s, uint32_t code)
+{
+	K_EVENT	*ev = NULL;
 
-	params.type = VSTREAM_CALL_IOCTL;
-	params.ioctl.code	= code;
-	params.ioctl.arg	= arg;
+	if (s->ioctl == NULL || FAILED(k_ioctl(s, code, &ev))) {
+		return NULL;
+	}
 
-	return vstream_forward_call((K_DEV_STREAM*)s, &params, NULL);
+	return ev;
+}
+
+static VOID __nxapi link_wait(K_EVENT *ev)
+{
+	if (ev) {
+		event_waitfor(ev, TIMEOUT_INFINITE);
+	} else {
+		sched_yield();
+	}
 }
 
 static HRESULT __nxapi
-vstream_forward_call(K_DEV_STREAM *str, VSTREAM_CALL_PARAMS *params, uint32_t *result)
+link_read(K_STREAM *s, K_EVENT *ev, void *buf, size_t size, volatile BOOL *stop)
 {
-	K_DEV_MUXER		*dm = str->dm;
-	K_DEV_DESC		*dd;
-	K_EVENT			elist[2];
-	uint32_t		waitres;
-	HRESULT			hr;
-	BOOL			is_active_slot;
+	size_t	bytes;
+	HRESULT	hr;
 
-	mutex_lock(&dm->sec_devices_lock);
+	while (size > 0) {
+		if (ev) event_reset(ev);
+		if (*stop) return E_TERMINATED;
 
-	is_active_slot	= str->dm->active_slot == str->slot;
-	dd 				= &dm->sec_devices[str->slot];
+		bytes = 0;
+		hr = k_fread(s, size, buf, &bytes);
 
-	/* Add reference to the device, which ensures it will not be
-	 * removed until we release it later. This is similar to locking.
-	 */
-	device_addref(dd);
+		if (hr == E_ENDOFSTR) return hr;
 
-	/* Unlock device list, so other devices can be added/removed while we wait */
-	mutex_unlock(&dm->sec_devices_lock);
+		if (FAILED(hr) || bytes == 0) {
+			link_wait(ev);
+			continue;
+		}
 
-	/* If we are not on an active slot, block until we are activated or terminated */
-	if (!is_active_slot) {
-		elist[0] = dd->destruction_ev;
-		elist[1] = dd->activation_ev;
+		buf = (uint8_t*)buf + bytes;
+		size -= bytes;
+	}
 
-		/* Wait for device to either get activated or terminated */
-		hr = event_waitfor_multiple(elist, 2, TIMEOUT_INFINITE, &waitres);
-		if (FAILED(hr)) goto finally;
+	return S_OK;
+}
 
-		if (waitres == 0) {
-			/* Destruction event signaled */
-			return E_INTERRUPTED;
-		} else if (waitres == 1) {
-			/* Activation event signaled - forward the call to primary device */
-		} else {
-			/* Unexpected */
-			HalKernelPanic("Unexpected case.");
+static HRESULT __nxapi
+link_write(K_STREAM *s, K_EVENT *ev, void *buf, size_t size, volatile BOOL *stop)
+{
+	size_t	bytes;
+	HRESULT	hr;
+
+	while (size > 0) {
+		if (ev) event_reset(ev);
+		if (*stop) return E_TERMINATED;
+
+		bytes = 0;
+		hr = k_fwrite(s, size, buf, &bytes);
+
+		if (FAILED(hr) || bytes == 0) {
+			link_wait(ev);
+			continue;
 		}
+
+		buf = (uint8_t*)buf + bytes;
+		size -= bytes;
 	}
 
-	/* Forward the call */
-	hr = vstream_deserialize_call(dm->prim_device.stream, params, result);
+	return S_OK;
+}
 
-finally:
-	device_release(dd);
-	return hr;
+static HRESULT __nxapi
+link_discard(K_STREAM *s, K_EVENT *ev, size_t size, volatile BOOL *stop)
+{
+	uint8_t	scratch[64];
+	size_t	chunk;
+	HRESULT	hr;
+
+	while (size > 0) {
+		chunk = size > sizeof(scratch) ? sizeof(scratch) : size;
+
+		hr = link_read(s, ev, scratch, chunk, stop);
+		if (FAILED(hr)) return hr;
+
+		size -= chunk;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Threads don't receive arguments, so a new (or idle) thread picks the first
+ * muxer which isn't served yet.
+ */
+static K_DEV_MUXER __nxapi *devmux_claim()
+{
+	K_DEV_MUXER	*dm = NULL;
+	uint32_t	intf;
+
+	intf = spinlock_acquire(&devmux_lock);
+
+	for (uint32_t i=0; i<DEVMUX_MAX_MUXERS; i++) {
+		if (devmux_muxers[i] && !devmux_muxers[i]->demux_claimed) {
+			dm = devmux_muxers[i];
+			dm->demux_claimed = TRUE;
+			break;
+		}
+	}
+
+	spinlock_release(&devmux_lock, intf);
+	return dm;
+}
+
+static void __nxapi devmux_demux_thread()
+{
+	K_DEV_MUXER	*dm;
+	uint32_t	intf;
+	HRESULT		hr;
+
+	while (TRUE) {
+		/* Park until a muxer is registered. Resetting before the claim
+		 * keeps a registration made in between from being missed.
+		 */
+		event_reset(&devmux_work_ev);
+
+		if (!(dm = devmux_claim())) {
+			event_waitfor(&devmux_work_ev, TIMEOUT_INFINITE);
+			continue;
+		}
+
+		hr = devmux_demux(dm);
+
+		/* Fail everything still waiting, so callers don't hang */
+		dm->link_status = hr;
+
+		for (uint32_t i=0; i<DEV_MUXER_MAX_DEVICES; i++) {
+			intf = spinlock_acquire(&dm->sec_devices[i].lock);
+			device_fail_calls(&dm->sec_devices[i], hr);
+			event_signal(&dm->sec_devices[i].ready_ev);
+			spinlock_release(&dm->sec_devices[i].lock, intf);
+		}
+
+		/* Unregister and go back to the pool */
+		intf = spinlock_acquire(&devmux_lock);
+
+		for (uint32_t i=0; i<DEVMUX_MAX_MUXERS; i++) {
+			if (devmux_muxers[i] == dm) {
+				devmux_muxers[i] = NULL;
+				break;
+			}
+		}
+
+		devmux_active_cnt--;
+		spinlock_release(&devmux_lock, intf);
+
+		/* The muxer may be freed right after this */
+		event_signal(&dm->demux_done);
+	}
 }
 
+/*
+ * Reads frames from the link and hands replies to their calls, until the
+ * muxer is stopped or the link breaks. Returns the status pending calls
+ * should fail with.
+ */
 static HRESULT __nxapi
-vstream_deserialize_call(K_STREAM *target, VSTREAM_CALL_PARAMS *p, uint32_t *result)
+devmux_demux(K_DEV_MUXER *dm)
 {
-	switch (p->type) {
-		case VSTREAM_CALL_READ:
-			return k_fread(target, p->read.block_size, p->read.out_buf, p->read.bytes_read);
+	K_DEVMUX_FRAME	hdr;
+	K_DEVMUX_CALL	*call;
+	K_DEV_DESC		*dd;
+	size_t			copy;
+	uint32_t		intf, i;
+	HRESULT			hr;
+
+	while (TRUE) {
+		hr = link_read(dm->rx, dm->rx_ev, &hdr, sizeof(hdr), &dm->stopping);
+		if (FAILED(hr)) return E_TERMINATED;
+
+		if (hdr.magic != DEVMUX_FRAME_MAGIC || hdr.slot >= DEV_MUXER_MAX_DEVICES) {
+			/* Lost framing, there is no way to resynchronize */
+			return E_INVALIDDATA;
+		}
+
+		if (hdr.type != DEVMUX_FRAME_REPLY && hdr.type != DEVMUX_FRAME_CREDIT) {
+			hr = link_discard(dm->rx, dm->rx_ev, hdr.payload_size, &dm->stopping);
+			if (FAILED(hr)) return E_TERMINATED;
+
+			continue;
+		}
+
+		dd		= &dm->sec_devices[hdr.slot];
+		call	= NULL;
+
+		intf = spinlock_acquire(&dd->lock);
+
+		if (dd->initialized) {
+			dd->credits += hdr.credits;
+
+			if (hdr.type == DEVMUX_FRAME_REPLY) {
+				for (i=0; i<DEVMUX_MAX_INFLIGHT; i++) {
+					if (dd->calls[i].state == DEVMUX_SLOT_PENDING && dd->calls[i].seq == hdr.seq) {
+						call = &dd->calls[i];
+						call->state = DEVMUX_SLOT_FILLING;
+						break;
+					}
+				}
+			}
+
+			if (hdr.credits > 0) {
+				event_signal(&dd->ready_ev);
+			}
+		}
 
-		case VSTREAM_CALL_WRITE:
-			return k_fwrite(target, p->write.block_size, p->write.in_buf, p->write.bytes_written);
+		spinlock_release(&dd->lock, intf);
 
-		case VSTREAM_CALL_CLOSE:
-			return E_UNEXPECTED;
+		/* Copy the payload straight into the caller's buffer. Replies nobody
+		 * waits for anymore (the call was terminated) are dropped.
+		 */
+		copy = 0;
 
-		case VSTREAM_CALL_TELL:
-			*result = k_ftell(target);
-			return S_OK;
+		if (call) {
+			copy = hdr.payload_size < call->out_size ? hdr.payload_size : call->out_size;
 
-		case VSTREAM_CALL_SEEK:
-			*result = k_fseek(target, p->seek.pos, p->seek.origin);
-			return S_OK;
+			hr = link_read(dm->rx, dm->rx_ev, call->out_buf, copy, &dm->stopping);
+			if (FAILED(hr)) {
+				call->state = DEVMUX_SLOT_PENDING;
+				return E_TERMINATED;
+			}
+		}
 
-		case VSTREAM_CALL_IOCTL:
-			return k_ioctl(target, p->ioctl.code, p->ioctl.arg);
+		hr = link_discard(dm->rx, dm->rx_ev, hdr.payload_size - copy, &dm->stopping);
 
-		default:
+		if (call) {
+			intf = spinlock_acquire(&dd->lock);
+
+			call->status	= hdr.status;
+			call->result	= hdr.result;
+			call->bytes		= hdr.payload_size > 0 ? copy : hdr.bytes;
+			call->state		= DEVMUX_SLOT_DONE;
+			event_signal(&call->done);
+
+			spinlock_release(&dd->lock, intf);
+		}
+
+		if (FAILED(hr)) return E_TERMINATED;
+	}
+}
+
+/*
+ * Executes a single call on a target stream.
+ */
+static HRESULT __nxapi
+devmux_execute(K_STREAM *target, K_DEVMUX_FRAME *call, void *buf, K_DEVMUX_FRAME *reply)
+{
+	size_t	bytes = 0;
+	int64_t	pos;
+	HRESULT	hr = S_OK;
+
+	switch (call->op) {
+	case DEVMUX_CALL_READ:
+		if (call->arg[0] > DEVMUX_MAX_PAYLOAD) {
 			return E_INVALIDARG;
+		}
+
+		if (target) {
+			hr = k_fread(target, call->arg[0], buf, &bytes);
+		} else {
+			memset(buf, 0, call->arg[0]);
+			bytes = call->arg[0];
+		}
+
+		reply->payload_size = bytes;
+		break;
+
+	case DEVMUX_CALL_WRITE:
+		if (target) {
+			hr = k_fwrite(target, call->payload_size, buf, &bytes);
+		} else {
+			bytes = call->payload_size;
+		}
+
+		break;
+
+	case DEVMUX_CALL_TELL:
+		reply->result = target ? k_ftell(target) : 0;
+		break;
+
+	case DEVMUX_CALL_SEEK:
+		pos = (int64_t)(((uint64_t)call->arg[1] << 32) | call->arg[0]);
+		reply->result = target ? k_fseek(target, pos, (int8_t)call->arg[2]) : 0;
+		break;
+
+	case DEVMUX_CALL_IOCTL:
+		if (target) {
+			hr = k_ioctl(target, call->arg[0], (void*)call->arg[1]);
+		}
+
+		break;
+
+	default:
+		hr = E_NOTSUPPORTED;
 	}
+
+	reply->bytes = bytes;
+	return hr;
 }
 
-static ULONG __nxapi
-device_addref(K_DEV_DESC *dd)
+HRESULT __nxapi
+devmux_serve(K_STREAM *rx, K_STREAM *tx, K_STREAM **targets, volatile BOOL *stop)
 {
-	uint32_t	cnt;
-	K_DEV_MUXER	*m;
+	K_DEVMUX_FRAME	call, reply;
+	K_EVENT			*rx_ev, *tx_ev;
+	uint8_t			*buf;
+	HRESULT			hr;
+
+	if (!rx || !tx || !stop) {
+		return E_POINTER;
+	}
 
-	mutex_lock(&dd->lock);
-	cnt = dd->ref_count++;
+	rx_ev = link_event(rx, IOCTL_STREAM_GET_READ_EVENT);
+	tx_ev = link_event(tx, IOCTL_STREAM_GET_WRITE_EVENT);
 
-	m = dd->muxer;
-	atomic_increment(&m->sec_device_count);
+	if (!(buf = kmalloc(DEVMUX_MAX_PAYLOAD))) {
+		return E_OUTOFMEM;
+	}
+
+	while (TRUE) {
+		hr = link_read(rx, rx_ev, &call, sizeof(call), stop);
+		if (FAILED(hr)) break;
+
+		if (call.magic != DEVMUX_FRAME_MAGIC || call.payload_size > DEVMUX_MAX_PAYLOAD) {
+			hr = E_INVALIDDATA;
+			break;
+		}
+
+		hr = link_read(rx, rx_ev, buf, call.payload_size, stop);
+		if (FAILED(hr)) break;
 
-	mutex_unlock(&dd->lock);
+		if (call.type != DEVMUX_FRAME_CALL) {
+			continue;
+		}
 
-	return cnt;
+		memset(&reply, 0, sizeof(reply));
+		reply.magic		= DEVMUX_FRAME_MAGIC;
+		reply.type		= DEVMUX_FRAME_REPLY;
+		reply.slot		= call.slot;
+		reply.seq		= call.seq;
+		reply.credits	= 1;
+
+		reply.status = devmux_execute(targets && call.slot < DEV_MUXER_MAX_DEVICES ? targets[call.slot] : NULL, &call, buf, &reply);
+
+		hr = link_write(tx, tx_ev, &reply, sizeof(reply), stop);
+		if (SUCCEEDED(hr) && reply.payload_size > 0) {
+			hr = link_write(tx, tx_ev, buf, reply.payload_size, stop);
+		}
+
+		if (FAILED(hr)) break;
+	}
+
+	kfree(buf);
+	return hr == E_TERMINATED ? S_OK : hr;
 }
 
-static ULONG __nxapi
-device_release(K_DEV_DESC *dd)
+VOID __nxapi
+devmux_wake(K_STREAM *rx, K_STREAM *tx)
 {
-	uint32_t	cnt;
-	K_DEV_MUXER	*m;
+	K_EVENT	*ev;
 
-	mutex_lock(&dd->lock);
+	if (rx && (ev = link_event(rx, IOCTL_STREAM_GET_READ_EVENT))) {
+		event_signal(ev);
+	}
 
-	cnt = dd->ref_count--;
-	if (cnt == 0) {
-		/* Destroy */
-		vstream_destroy((K_DEV_STREAM*)dd->stream);
-		dd->initialized = FALSE;
+	if (tx && (ev = link_event(tx, IOCTL_STREAM_GET_WRITE_EVENT))) {
+		event_signal(ev);
 	}
+}
+
+/*
+ * Benchmark. The peer runs in a persistent thread and serves the
+ * request pipe with null devices.
+ */
+#define DEVMUX_BENCH_PIPE_SIZE		(32 * 1024)
+#define DEVMUX_BENCH_CALLS			1000
+#define DEVMUX_BENCH_WRITE_SIZE		(64 * 1024)
+#define DEVMUX_BENCH_TOTAL			(4 * 1024 * 1024)
+
+static volatile BOOL	devmux_bench_stop = FALSE;
+static BOOL				devmux_bench_started = FALSE;
+
+static void __nxapi devmux_bench_server()
+{
+	K_STREAM	*req, *rep;
 
-	m = dd->muxer;
-	atomic_decrement(&m->sec_device_count);
+	if (FAILED(k_fopen("/ipc/dmxreq", FILE_OPEN_READ, &req)) ||
+		FAILED(k_fopen("/ipc/dmxrep", FILE_OPEN_WRITE, &rep))) {
+		HalKernelPanic("devmux_bench_server(): Failed to open pipes.");
+	}
 
-	mutex_unlock(&dd->lock);
-	return cnt;
+	/* Threads can't exit, so keep serving */
+	while (TRUE) {
+		if (FAILED(devmux_serve(req, rep, NULL, &devmux_bench_stop))) {
+			sched_yield();
+		}
+	}
 }
 
 HRESULT	__nxapi
-devmux_test(char *target_device)
+devmux_test()
 {
-	K_DEV_MUXER *dm;
+	K_DEV_MUXER *dm = NULL;
+	K_STREAM	*tx = NULL, *rx = NULL, *s;
+	uint8_t		*buf = NULL;
+	uint32_t	t, i;
+	size_t		bytes;
 	HRESULT		hr;
-	uint32_t	i, j, bytes;
-	uint8_t		buff[128];
-
-#define TEST_STREAM_CNT	10
-	K_STREAM	*streams[TEST_STREAM_CNT], *s;
-	uint32_t	slots[TEST_STREAM_CNT];
-
-	/* Create new muxer */
-	dm = devmux_create(DEVMUX_DIRECTION_BIDIRECTION, target_device);
-	if (dm == NULL) return E_FAIL;
-
-	/* Create secondary device streams */
-	for (i=0; i<TEST_STREAM_CNT; i++) {
-		hr = devmux_add_device(dm, -1, &slots[i], &streams[i]);
-		if (FAILED(hr)) {
-			k_printf("devmux_add_device() failed, hr=%x\n", hr);
-			goto finally;
-		}
+
+	if (!devmux_bench_started) {
+		/* Pipes stay around between runs */
+		pipe_create("dmxreq", PIPE_FLAG_NONE, DEVMUX_BENCH_PIPE_SIZE);
+		pipe_create("dmxrep", PIPE_FLAG_NONE, DEVMUX_BENCH_PIPE_SIZE);
+
+		hr = sched_create_thread(NULL, devmux_bench_server, NULL);
+		if (FAILED(hr)) return hr;
+
+		devmux_bench_started = TRUE;
 	}
 
-	/* Switch to each stream and try to access any other */
-	for (i=0; i<TEST_STREAM_CNT; i++) {
-		hr = devmux_switch_to(dm, i);
-		if (FAILED(hr)) {
-			k_printf("devmux_switch_to() failed, hr=%x\n", hr);
-			goto finally;
-		}
+	hr = k_fopen("/ipc/dmxreq", FILE_OPEN_WRITE, &tx);
+	if (FAILED(hr)) goto finally;
 
-		for (j=0; j<TEST_STREAM_CNT; j++) {
-			/* Test devmux_get_device_stream() */
-			hr = devmux_get_device_stream(dm, j, &s);
-			if (FAILED(hr) || s != streams[j]) {
-				k_printf("devmux_get_device_stream() failed, hr=%x\n", hr);
-				goto finally;
-			}
+	hr = k_fopen("/ipc/dmxrep", FILE_OPEN_READ, &rx);
+	if (FAILED(hr)) goto finally;
 
-			/* Skip active stream */
-			if (i==j) {
-				continue;
-			}
+	if (!(buf = kcalloc(DEVMUX_BENCH_WRITE_SIZE))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
 
-			/* Try each operation */
-			hr = k_fread(s, 128, buff, &bytes);
-			///....
-		}
+	if (!(dm = devmux_create2(tx, rx))) {
+		hr = E_FAIL;
+		goto finally;
+	}
+
+	hr = devmux_add_device(dm, -1, NULL, &s);
+	if (FAILED(hr)) goto finally;
 
-		/* Test active stream */
+	/* Round trip latency */
+	t = timer_gettickcount();
 
+	for (i=0; i<DEVMUX_BENCH_CALLS; i++) {
+		k_ftell(s);
 	}
 
+	t = timer_gettickcount() - t;
+	k_printf("tell() round trip: %d us/call (%d calls in %d ms)\n", t * 1000 / DEVMUX_BENCH_CALLS, DEVMUX_BENCH_CALLS, t);
+
+	/* Write throughput, with frames pipelined */
+	t = timer_gettickcount();
+
+	for (i=0; i<DEVMUX_BENCH_TOTAL / DEVMUX_BENCH_WRITE_SIZE; i++) {
+		hr = k_fwrite(s, DEVMUX_BENCH_WRITE_SIZE, buf, &bytes);
+		if (FAILED(hr)) goto finally;
+
+		if (bytes != DEVMUX_BENCH_WRITE_SIZE) {
+			hr = E_UNEXPECTED;
+			goto finally;
+		}
+	}
+
+	t = timer_gettickcount() - t;
+	if (t == 0) t = 1;
+
+	k_printf("write(): %d KiB/s (%d KiB in %d ms)\n", (DEVMUX_BENCH_TOTAL / 1024) * 1000 / t, DEVMUX_BENCH_TOTAL / 1024, t);
+
 finally:
-	devmux_destroy(dm);
+	if (FAILED(hr)) {
+		k_printf("devmux_test() failed, hr=0x%X\n", hr);
+	}
+
+	if (dm) devmux_destroy(dm);
+	if (tx) k_fclose(&tx);
+	if (rx) k_fclose(&rx);
+	if (buf) kfree(buf);
+
 	return hr;
 }
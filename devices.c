@@ -6,27 +6,26 @@
  */
 #include <devices.h>
 #include <kstdio.h>
+#include <bcache.h>
 
 HRESULT storage_read_blocks(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer)
 {
-	IOCTL_STORAGE_READWRITE rw;
-
-	rw.buffer 	= buffer;
-	rw.start 	= start;
-	rw.count	= count;
-
-	return k_ioctl(drv, IOCTL_STORAGE_READ_BLOCKS, &rw);
+	return bcache_read(drv, start, count, buffer, STORAGE_IO_DEFAULT);
 }
 
 HRESULT storage_write_blocks(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer)
 {
-	IOCTL_STORAGE_READWRITE rw;
+	return bcache_write(drv, start, count, buffer, STORAGE_IO_DEFAULT);
+}
 
-	rw.buffer 	= buffer;
-	rw.start 	= start;
-	rw.count	= count;
+HRESULT storage_read_blocks_ex(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags)
+{
+	return bcache_read(drv, start, count, buffer, flags);
+}
 
-	return k_ioctl(drv, IOCTL_STORAGE_WRITE_BLOCKS, &rw);
+HRESULT storage_write_blocks_ex(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags)
+{
+	return bcache_write(drv, start, count, buffer, flags);
 }
 
 HRESULT storage_get_block_size(K_STREAM *drv, size_t *size)
@@ -0,0 +1,523 @@
+/*
+ * dirindex.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "dirindex.h"
+#include "syncobjs.h"
+#include "string.h"
+#include "mm.h"
+#include "kstdio.h"
+#include "timer.h"
+#include "vfs.h"
+#include "dcache.h"
+#include "drivers/fat16.h"
+
+/* Initial capacities */
+#define DIRINDEX_INITIAL_ENTRIES	32
+#define DIRINDEX_INITIAL_NAMES		512
+
+static K_MUTEX			dirindex_lock;
+static K_DIRINDEX		*dirindex_lru_head;
+static K_DIRINDEX		*dirindex_lru_tail;
+static K_DIRINDEX_STATS	dirindex_stats;
+static BOOL				dirindex_enabled = TRUE;
+
+/*
+ * Prototypes
+ */
+static char dirindex_fold(char c);
+static uint32_t dirindex_hash(const char *name);
+static void dirindex_free(K_DIRINDEX *idx);
+static void dirindex_lru_unlink(K_DIRINDEX *idx);
+static void dirindex_lru_push(K_DIRINDEX *idx);
+static void dirindex_uncache(K_DIRINDEX *idx);
+
+HRESULT __nxapi dirindex_initialize()
+{
+	mutex_create(&dirindex_lock);
+
+	dirindex_lru_head = dirindex_lru_tail = NULL;
+	memset(&dirindex_stats, 0, sizeof(dirindex_stats));
+
+	return S_OK;
+}
+
+HRESULT __nxapi dirindex_get(void *owner, uint64_t dir, K_DIRINDEX **out)
+{
+	K_DIRINDEX	*idx;
+	HRESULT		hr = S_FALSE;
+
+	mutex_lock(&dirindex_lock);
+
+	for (idx = dirindex_lru_head; idx != NULL; idx = idx->lru_next) {
+		if (idx->owner == owner && idx->dir == dir) {
+			/* Move to the front of the LRU list */
+			dirindex_lru_unlink(idx);
+			dirindex_lru_push(idx);
+
+			idx->ref_count++;
+			*out = idx;
+
+			hr = S_OK;
+			break;
+		}
+	}
+
+	if (hr == S_OK) {
+		dirindex_stats.hits++;
+	} else {
+		dirindex_stats.misses++;
+	}
+
+	mutex_unlock(&dirindex_lock);
+	return hr;
+}
+
+HRESULT __nxapi dirindex_create(void *owner, uint64_t dir, size_t value_size, K_DIRINDEX **out)
+{
+	K_DIRINDEX *idx;
+
+	if (owner == NULL || out == NULL) {
+		return E_POINTER;
+	}
+
+	if (!(idx = kcalloc(sizeof(K_DIRINDEX)))) {
+		return E_OUTOFMEM;
+	}
+
+	idx->owner		= owner;
+	idx->dir		= dir;
+	idx->value_size	= value_size;
+	idx->ref_count	= 1;
+
+	*out = idx;
+	return S_OK;
+}
+
+HRESULT __nxapi dirindex_add(K_DIRINDEX *idx, const char *name, const void *value, uint32_t flags)
+{
+	uint32_t	len = strlen(name) + 1;
+	uint32_t	cap;
+	void		*p;
+
+	if (idx->buckets != NULL) {
+		/* Already published */
+		return E_INVALIDSTATE;
+	}
+
+	/* Grow entry and value arrays */
+	if (idx->count == idx->capacity) {
+		cap = idx->capacity ? idx->capacity * 2 : DIRINDEX_INITIAL_ENTRIES;
+
+		if (!(p = krealloc(idx->entries, cap * sizeof(K_DIRINDEX_ENTRY)))) {
+			return E_OUTOFMEM;
+		}
+		idx->entries = p;
+
+		if (!(p = krealloc(idx->values, cap * idx->value_size))) {
+			return E_OUTOFMEM;
+		}
+		idx->values = p;
+
+		idx->capacity = cap;
+	}
+
+	/* Grow name pool */
+	if (idx->names_size + len > idx->names_cap) {
+		cap = idx->names_cap ? idx->names_cap : DIRINDEX_INITIAL_NAMES;
+		while (idx->names_size + len > cap) cap *= 2;
+
+		if (!(p = krealloc(idx->names, cap))) {
+			return E_OUTOFMEM;
+		}
+
+		idx->names = p;
+		idx->names_cap = cap;
+	}
+
+	K_DIRINDEX_ENTRY *e = &idx->entries[idx->count];
+
+	e->hash		= dirindex_hash(name);
+	e->name		= idx->names_size;
+	e->flags	= flags;
+	e->next		= DIRINDEX_NONE;
+
+	memcpy(idx->names + idx->names_size, name, len);
+	memcpy(idx->values + idx->count * idx->value_size, value, idx->value_size);
+
+	idx->names_size += len;
+	idx->count++;
+
+	return S_OK;
+}
+
+HRESULT __nxapi dirindex_publish(K_DIRINDEX *idx)
+{
+	K_DIRINDEX	*old;
+	uint32_t	buckets = 16;
+	uint32_t	i, b;
+
+	/* Keep the load factor at or below 1/2 */
+	while (buckets < idx->count * 2) buckets *= 2;
+
+	if (!(idx->buckets = kmalloc(buckets * sizeof(uint32_t)))) {
+		return E_OUTOFMEM;
+	}
+
+	memset(idx->buckets, 0xFF, buckets * sizeof(uint32_t));
+	idx->bucket_mask = buckets - 1;
+
+	/* Insert backwards, so earlier entries come first within a bucket */
+	for (i=idx->count; i>0; i--) {
+		K_DIRINDEX_ENTRY *e = &idx->entries[i-1];
+
+		b = e->hash & idx->bucket_mask;
+		e->next = idx->buckets[b];
+		idx->buckets[b] = i-1;
+	}
+
+	idx->bytes = sizeof(K_DIRINDEX) + idx->capacity * (sizeof(K_DIRINDEX_ENTRY) + idx->value_size)
+			+ idx->names_cap + buckets * sizeof(uint32_t);
+
+	if (!dirindex_enabled) {
+		/* Only used by the caller */
+		return S_OK;
+	}
+
+	mutex_lock(&dirindex_lock);
+
+	/* Replace an index built concurrently */
+	for (old = dirindex_lru_head; old != NULL; old = old->lru_next) {
+		if (old->owner == idx->owner && old->dir == idx->dir) {
+			dirindex_uncache(old);
+			break;
+		}
+	}
+
+	/* The cache holds a reference too */
+	idx->ref_count++;
+	idx->cached = TRUE;
+	dirindex_lru_push(idx);
+
+	dirindex_stats.builds++;
+	dirindex_stats.dirs++;
+	dirindex_stats.bytes += idx->bytes;
+
+	/* Evict least recently used indexes, but never the new one */
+	while ((dirindex_stats.dirs > DIRINDEX_MAX_DIRS || dirindex_stats.bytes > DIRINDEX_BUDGET) && dirindex_lru_tail != idx) {
+		dirindex_uncache(dirindex_lru_tail);
+		dirindex_stats.evictions++;
+	}
+
+	mutex_unlock(&dirindex_lock);
+	return S_OK;
+}
+
+VOID __nxapi dirindex_release(K_DIRINDEX *idx)
+{
+	mutex_lock(&dirindex_lock);
+
+	if (--idx->ref_count == 0) {
+		dirindex_free(idx);
+	}
+
+	mutex_unlock(&dirindex_lock);
+}
+
+HRESULT __nxapi dirindex_find(K_DIRINDEX *idx, const char *name, void *value)
+{
+	uint32_t hash = dirindex_hash(name);
+	uint32_t i;
+
+	if (idx->buckets == NULL) {
+		return E_INVALIDSTATE;
+	}
+
+	for (i = idx->buckets[hash & idx->bucket_mask]; i != DIRINDEX_NONE; i = idx->entries[i].next) {
+		K_DIRINDEX_ENTRY *e = &idx->entries[i];
+
+		if (e->hash == hash && stricmp(idx->names + e->name, (char*)name) == 0) {
+			if (value) {
+				memcpy(value, idx->values + i * idx->value_size, idx->value_size);
+			}
+
+			return S_OK;
+		}
+	}
+
+	return E_NOTFOUND;
+}
+
+HRESULT __nxapi dirindex_next(K_DIRINDEX *idx, uint32_t *pos, const char **name, void **value)
+{
+	uint32_t i;
+
+	for (i=*pos; i<idx->count; i++) {
+		if ((idx->entries[i].flags & DIRINDEX_ALIAS) != 0) {
+			continue;
+		}
+
+		if (name) *name = idx->names + idx->entries[i].name;
+		if (value) *value = idx->values + i * idx->value_size;
+
+		*pos = i + 1;
+		return S_OK;
+	}
+
+	*pos = idx->count;
+	return E_ENDOFSTR;
+}
+
+VOID __nxapi dirindex_invalidate(void *owner, uint64_t dir)
+{
+	K_DIRINDEX *idx;
+
+	mutex_lock(&dirindex_lock);
+
+	for (idx = dirindex_lru_head; idx != NULL; idx = idx->lru_next) {
+		if (idx->owner == owner && idx->dir == dir) {
+			dirindex_uncache(idx);
+			break;
+		}
+	}
+
+	mutex_unlock(&dirindex_lock);
+}
+
+VOID __nxapi dirindex_invalidate_owner(void *owner)
+{
+	K_DIRINDEX *idx, *next;
+
+	mutex_lock(&dirindex_lock);
+
+	for (idx = dirindex_lru_head; idx != NULL; idx = next) {
+		next = idx->lru_next;
+
+		if (idx->owner == owner) {
+			dirindex_uncache(idx);
+		}
+	}
+
+	mutex_unlock(&dirindex_lock);
+}
+
+VOID __nxapi dirindex_set_enabled(BOOL enable)
+{
+	K_DIRINDEX *idx, *next;
+
+	mutex_lock(&dirindex_lock);
+
+	dirindex_enabled = enable;
+
+	if (!enable) {
+		for (idx = dirindex_lru_head; idx != NULL; idx = next) {
+			next = idx->lru_next;
+			dirindex_uncache(idx);
+		}
+	}
+
+	mutex_unlock(&dirindex_lock);
+}
+
+VOID __nxapi dirindex_get_stats(K_DIRINDEX_STATS *stats)
+{
+	mutex_lock(&dirindex_lock);
+	*stats = dirindex_stats;
+	mutex_unlock(&dirindex_lock);
+}
+
+static char dirindex_fold(char c)
+{
+	return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+/* FNV-1a of the case-folded name */
+static uint32_t dirindex_hash(const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	while (*name) {
+		h ^= (uint8_t)dirindex_fold(*name++);
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static void dirindex_free(K_DIRINDEX *idx)
+{
+	if (idx->entries) kfree(idx->entries);
+	if (idx->values) kfree(idx->values);
+	if (idx->names) kfree(idx->names);
+	if (idx->buckets) kfree(idx->buckets);
+
+	kfree(idx);
+}
+
+static void dirindex_lru_unlink(K_DIRINDEX *idx)
+{
+	if (idx->lru_prev) idx->lru_prev->lru_next = idx->lru_next;
+	else dirindex_lru_head = idx->lru_next;
+
+	if (idx->lru_next) idx->lru_next->lru_prev = idx->lru_prev;
+	else dirindex_lru_tail = idx->lru_prev;
+
+	idx->lru_prev = idx->lru_next = NULL;
+}
+
+static void dirindex_lru_push(K_DIRINDEX *idx)
+{
+	idx->lru_prev = NULL;
+	idx->lru_next = dirindex_lru_head;
+
+	if (dirindex_lru_head) dirindex_lru_head->lru_prev = idx;
+	else dirindex_lru_tail = idx;
+
+	dirindex_lru_head = idx;
+}
+
+/* Removes an index from the cache and drops the cache's reference. Called
+ * with the lock held. */
+static void dirindex_uncache(K_DIRINDEX *idx)
+{
+	dirindex_lru_unlink(idx);
+	idx->cached = FALSE;
+
+	dirindex_stats.dirs--;
+	dirindex_stats.bytes -= idx->bytes;
+
+	if (--idx->ref_count == 0) {
+		dirindex_free(idx);
+	}
+}
+
+#define DIRINDEX_BENCH_ENTRIES	5000
+#define DIRINDEX_BENCH_FAT_DIR	"/drives/a/DIRBENCH"
+#define DIRINDEX_BENCH_ISO_DIR	"/drives/cd/DIRBENCH"
+
+/*
+ * Opens every file of `dir` once. Returns the number of files opened.
+ */
+static uint32_t dirindex_bench_pass(char *dir, uint32_t *ms, HRESULT *hr_out)
+{
+	char			path[VFS_MAX_DIRNAME_LENGTH];
+	char			name[VFS_MAX_FILENAME_LENGTH];
+	K_FS_NODE_INFO	info;
+	K_DIR_STREAM	*ds;
+	K_STREAM		*s;
+	uint32_t		count = 0;
+	QWORD			t;
+	HRESULT			hr;
+
+	*ms = 0;
+
+	hr = k_opendir(dir, &ds);
+	if (FAILED(hr)) {
+		*hr_out = hr;
+		return 0;
+	}
+
+	t = timer_gettickcount();
+
+	while (k_readdir(ds, name, &info) == S_OK) {
+		if (info.node_type != FS_NODE_TYPE_FILE) continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+		hr = k_fopen(path, FILE_OPEN_READ, &s);
+		if (FAILED(hr)) break;
+
+		/* Forget the name right away, so only the index can help */
+		dcache_invalidate_owner(s->fs_driver);
+		k_fclose(&s);
+
+		count++;
+	}
+
+	*ms = (uint32_t)(timer_gettickcount() - t);
+	k_closedir(&ds);
+
+	*hr_out = hr;
+	return count;
+}
+
+static void dirindex_bench_dir(const char *label, char *dir)
+{
+	uint32_t	count, ms, i;
+	HRESULT		hr;
+
+	for (i=0; i<2; i++) {
+		/* Turning it off drops all cached indexes, so both passes start cold */
+		dirindex_set_enabled(FALSE);
+		if (i == 1) dirindex_set_enabled(TRUE);
+
+		count = dirindex_bench_pass(dir, &ms, &hr);
+		if (FAILED(hr) && count == 0) {
+			k_printf("%s: failed to read %s (hr=0x%X).\n", label, dir, hr);
+			break;
+		}
+
+		k_printf("%s: %d names resolved in %d ms (%d us/lookup), index %s\n",
+				label, count, ms, count ? ms * 1000 / count : 0,
+				i == 0 ? "off" : "on");
+	}
+
+	dirindex_set_enabled(TRUE);
+}
+
+HRESULT __nxapi dirindex_benchmark()
+{
+	char			path[VFS_MAX_DIRNAME_LENGTH];
+	K_DIR_STREAM	*ds;
+	uint32_t		i;
+	HRESULT			hr;
+
+	/* FAT floppy. Mount it, unless it's already mounted. */
+	hr = k_opendir("/drives/a", &ds);
+	if (FAILED(hr)) {
+		hr = vfs_mount_fs("/drives/a", fat16_get_constructor(), "/dev/fdd0");
+		if (SUCCEEDED(hr)) hr = k_opendir("/drives/a", &ds);
+	}
+
+	if (FAILED(hr)) {
+		k_printf("FAT: no floppy mounted at /drives/a (hr=0x%X), skipped.\n", hr);
+	} else {
+		k_closedir(&ds);
+
+		/* Populate the directory on the first run. Long names, so each file
+		 * takes a short and a long filename entry. */
+		if (FAILED(k_opendir(DIRINDEX_BENCH_FAT_DIR, &ds))) {
+			k_printf("FAT: creating %d files in %s...\n", DIRINDEX_BENCH_ENTRIES, DIRINDEX_BENCH_FAT_DIR);
+
+			hr = k_mkdir(DIRINDEX_BENCH_FAT_DIR, NODE_MODE_ALL_RWE);
+
+			for (i=0; i<DIRINDEX_BENCH_ENTRIES && SUCCEEDED(hr); i++) {
+				snprintf(path, sizeof(path), "%s/entry_%05d.dat", DIRINDEX_BENCH_FAT_DIR, i);
+				hr = k_fcreate(path, NODE_MODE_ALL_RWE);
+			}
+
+			if (FAILED(hr)) {
+				k_printf("FAT: failed to populate %s (hr=0x%X).\n", DIRINDEX_BENCH_FAT_DIR, hr);
+			}
+
+			k_sync();
+		} else {
+			k_closedir(&ds);
+		}
+
+		dirindex_bench_dir("FAT", DIRINDEX_BENCH_FAT_DIR);
+	}
+
+	/* ISO9660 images can't be written, the directory has to be on the image */
+	if (FAILED(k_opendir(DIRINDEX_BENCH_ISO_DIR, &ds))) {
+		k_printf("ISO9660: %s not found, skipped.\n", DIRINDEX_BENCH_ISO_DIR);
+	} else {
+		k_closedir(&ds);
+		dirindex_bench_dir("ISO9660", DIRINDEX_BENCH_ISO_DIR);
+	}
+
+	return S_OK;
+}
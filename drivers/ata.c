@@ -11,8 +11,13 @@
 #include <kstdio.h>
 #include <vfs.h>
 #include <string.h>
+#include <stdlib.h>
 #include <desctables.h>
 #include <mm.h>
+#include <mm_virt.h>
+#include <mm_phys.h>
+#include <shm.h>
+#include "pci_bus.h"
 #include "ata.h"
 
 /*
@@ -21,6 +26,7 @@
 static HRESULT	__nxapi ata_get_controller(uint32_t controller_id, ATA_CONTROLLER_CTX **ctrl);
 static HRESULT	__nxapi ata_wait_status(uint32_t controller_id, uint32_t timeout);
 static HRESULT	__nxapi ata_wait_ex(uint32_t controller_id, uint32_t timeout);
+static HRESULT	__nxapi ata_wait_irq(ATA_CONTROLLER_CTX *ctrl);
 static void		__nxapi ata_wait_4us(uint32_t controller_id);
 static uint8_t	__nxapi ata_read_reg(ATA_CONTROLLER_CTX *ctrl, uint8_t reg);
 static void		__nxapi ata_write_reg(ATA_CONTROLLER_CTX *ctrl, uint8_t reg, uint8_t value);
@@ -34,13 +40,21 @@ static HRESULT	__nxapi ata_identify_signature(ATA_DEVICE_CONTEXT *target_dev);
 static HRESULT	__nxapi ata_identify(ATA_DEVICE_CONTEXT *target_dev, void *dst_buffer);
 static HRESULT	__nxapi ata_issue_atapi_identify(ATA_DEVICE_CONTEXT *target_dev);
 static BOOL		__nxapi ata_is_packet_interface(ATA_DEVICE_CONTEXT *dc);
-static HRESULT	__nxapi ata_rw_sectors(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer);
-static HRESULT	__nxapi ata_rw_sectors_pio(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer);
-static HRESULT	__nxapi ata_rw_sectors_dma(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer);
+static HRESULT	__nxapi ata_rw_sectors(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt);
+static HRESULT	__nxapi ata_rw_sectors_pio(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt);
+static HRESULT	__nxapi ata_rw_sectors_dma(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt);
+static HRESULT	__nxapi ata_issue_rw_command(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, BOOL dma, uint64_t start, size_t count);
+static HRESULT	__nxapi ata_prdt_add(ATA_CONTROLLER_CTX *ctrl, uint32_t *n, uintptr_t phys, size_t size);
+static HRESULT	__nxapi ata_build_prdt(ATA_CONTROLLER_CTX *ctrl, const K_IOVEC *iov, uint32_t iov_cnt, size_t size, BOOL *bounced);
+static VOID		__nxapi ata_iov_copy(const K_IOVEC *iov, uint32_t iov_cnt, uint8_t *buf, BOOL to_iov);
+static HRESULT	__nxapi ata_blk_transfer(K_BLK_QUEUE *q, K_BLK_REQUEST *rq);
+static BOOL		__nxapi ata_dma_supported(ATA_DEVICE_CONTEXT *dev);
 static HRESULT	__nxapi atapi_read_sectors(ATA_DEVICE_CONTEXT *dev, uint64_t start, size_t count, void *buffer);
 static HRESULT	__nxapi atapi_eject(ATA_DEVICE_CONTEXT *dev);
 
 static HRESULT	__nxapi ata_setup_buses();
+static HRESULT	__nxapi ata_setup_bus_master();
+static HRESULT	__nxapi ata_setup_dma_memory(ATA_CONTROLLER_CTX *ctrl);
 static HRESULT	__nxapi ata_finalize_buses();
 static HRESULT	__nxapi ata_create_device(uint32_t ctrl_id, uint32_t drv_id, K_DEVICE **dev);
 static HRESULT	__nxapi ata_destroy_device(K_DEVICE **dev);
@@ -48,12 +62,22 @@ static HRESULT	__nxapi ata_destroy_device(K_DEVICE **dev);
 static VOID __cdecl irq14_isr(K_REGISTERS regs);
 static VOID __cdecl irq15_isr(K_REGISTERS regs);
 
-static HRESULT	__nxapi atadev_generate_url(char *prefix, char *dst);
+static HRESULT	__nxapi atadev_generate_url(char *prefix, char **dst);
 static uint32_t	__nxapi atadev_get_sector_size(K_STREAM *s);
 static uint32_t	__nxapi atadev_get_sector_count(K_STREAM *s);
 static HRESULT	__nxapi atadev_ioctl(K_STREAM *s, uint32_t code, void *arg);
 static HRESULT	__nxapi atadev_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args);
 static HRESULT	__nxapi atadev_write_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args);
+static HRESULT	__nxapi atadev_transfer_sectors(ATA_DEVICE_CONTEXT *dc, ATA_OPERATION op, uint64_t lba, uint32_t cnt, void *buffer);
+static HRESULT	__nxapi atadev_rw_at(ATA_DEVICE_CONTEXT *dc, ATA_OPERATION op, uint64_t offset, size_t size, void *buffer, size_t *bytes);
+static HRESULT	__nxapi atadev_pread(K_STREAM *s, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
+static HRESULT	__nxapi atadev_pwrite(K_STREAM *s, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
+static HRESULT	__nxapi atadev_readv(K_STREAM *s, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+static HRESULT	__nxapi atadev_writev(K_STREAM *s, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+static uint32_t	__nxapi atadev_seek(K_STREAM *s, int64_t pos, int8_t origin);
+static uint32_t	__nxapi atadev_tell(K_STREAM *s);
+static HRESULT	__nxapi atadev_submit(K_STREAM *s, K_IO_REQUEST *req);
+static HRESULT	__nxapi ata_aio_service(K_IO_QUEUE *q, K_IO_REQUEST *req);
 
 /*
  * Macros for locking and unlocking ATA controller.
@@ -69,6 +93,8 @@ static K_DEVICE *__ata_devices[4] = {0};
  */
 static HRESULT __nxapi ata_setup_buses()
 {
+	HRESULT hr;
+
 	/* Setup primary bus */
 	memset(&__ata_buses[0], 0, sizeof(ATA_CONTROLLER_CTX));
 	__ata_buses[0].id			= 0;
@@ -101,9 +127,96 @@ static HRESULT __nxapi ata_setup_buses()
 	register_isr_callback(irq_to_intid(ATA_PRIMARY_IRQ), irq14_isr, &__ata_buses[0]);
 	register_isr_callback(irq_to_intid(ATA_SECONADRY_IRQ), irq15_isr, &__ata_buses[1]);
 
+	/* Bus mastering is optional, drives use PIO without it */
+	if (FAILED(ata_setup_bus_master())) {
+		__ata_buses[0].bm_base = 0;
+		__ata_buses[1].bm_base = 0;
+	}
+
+	/* Start asynchronous request queues, one thread per bus */
+	hr = aio_queue_create(&__ata_buses[0].io_queue, AIO_DEFAULT_QUEUE_DEPTH, ata_aio_service, &__ata_buses[0], 1);
+	if (FAILED(hr)) return hr;
+
+	hr = aio_queue_create(&__ata_buses[1].io_queue, AIO_DEFAULT_QUEUE_DEPTH, ata_aio_service, &__ata_buses[1], 1);
+	if (FAILED(hr)) return hr;
+
+	return S_OK;
+}
+
+/*
+ * Finds the PCI IDE controller and enables bus mastering. BAR4 holds the
+ * I/O base of the bus master registers, 8 ports per bus.
+ */
+static HRESULT __nxapi ata_setup_bus_master()
+{
+	K_PCI_CONFIG_ADDRESS	addr;
+	uint32_t				bar4;
+	uint16_t				cmd;
+	HRESULT					hr;
+
+	hr = pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, &addr);
+	if (FAILED(hr)) return hr;
+
+	pci_read_config_u32(MAKE_CONFIG_ADDRESS(addr.bus_id, addr.device_id, addr.function_id, PCI_BAR4), &bar4);
+
+	/* Bus master registers have to be in I/O space */
+	if ((bar4 & 0x1) == 0 || (bar4 & 0xFFFC) == 0) {
+		return E_NOTSUPPORTED;
+	}
+
+	pci_read_config_u16(MAKE_CONFIG_ADDRESS(addr.bus_id, addr.device_id, addr.function_id, PCI_COMMAND), &cmd);
+	cmd |= PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER;
+	pci_write_config_u16(MAKE_CONFIG_ADDRESS(addr.bus_id, addr.device_id, addr.function_id, PCI_COMMAND), cmd);
+
+	__ata_buses[0].bm_base = bar4 & 0xFFFC;
+	__ata_buses[1].bm_base = (bar4 & 0xFFFC) + 8;
+
+	hr = ata_setup_dma_memory(&__ata_buses[0]);
+	if (FAILED(hr)) return hr;
+
+	hr = ata_setup_dma_memory(&__ata_buses[1]);
+	if (FAILED(hr)) return hr;
+
 	return S_OK;
 }
 
+/*
+ * Allocates the PRD table and the bounce buffer of a bus. Both are
+ * physically contiguous: the table takes the first page, the buffer follows.
+ */
+static HRESULT __nxapi ata_setup_dma_memory(ATA_CONTROLLER_CTX *ctrl)
+{
+	uint32_t	pages = 1 + ATA_DMA_BUF_SIZE / VM_PAGE_FRAME_SIZE;
+	PVOID		phys;
+	uintptr_t	va;
+	HRESULT		hr;
+
+	hr = kpmm_alloc(pages, &phys);
+	if (FAILED(hr)) return hr;
+
+	hr = shm_find_map_address(NULL, pages * VM_PAGE_FRAME_SIZE, &va);
+	if (FAILED(hr)) goto fail;
+
+	hr = vmm_map_region(NULL, (uintptr_t)phys, va, pages * VM_PAGE_FRAME_SIZE, USAGE_KERNEL | USAGE_DATA, ACCESS_READWRITE, TRUE);
+	if (FAILED(hr)) goto fail;
+
+	ctrl->prdt			= (ATA_PRD*)va;
+	ctrl->prdt_phys		= (uintptr_t)phys;
+	ctrl->dma_buf		= (void*)(va + VM_PAGE_FRAME_SIZE);
+	ctrl->dma_buf_phys	= (uintptr_t)phys + VM_PAGE_FRAME_SIZE;
+	ctrl->dma_buf_size	= ATA_DMA_BUF_SIZE;
+
+	/* Stop the engine and clear stale status bits (they are write-one-to-clear) */
+	ata_write_reg(ctrl, ATA_REG_BMCOMMAND, 0);
+	ata_write_reg(ctrl, ATA_REG_BMSTATUS, ata_read_reg(ctrl, ATA_REG_BMSTATUS) | ATA_BMSTATUS_ERR | ATA_BMSTATUS_IRQ);
+
+	return S_OK;
+
+fail:
+	kpmm_unmark_blocks(phys, pages);
+	return hr;
+}
+
 static HRESULT __nxapi ata_finalize_buses()
 {
 	mutex_destroy(&__ata_buses[0].lock);
@@ -223,6 +336,22 @@ static HRESULT	__nxapi ata_wait_ex(uint32_t controller_id, uint32_t timeout)
 	return S_OK;
 }
 
+/**
+ * Sleeps until the drive raises it's IRQ and then validates the status
+ * like @ata_wait_ex (reading the status register also acknowledges the
+ * interrupt). If the IRQ is lost, we fall back to polling after
+ * ATA_IRQ_TIMEOUT.
+ */
+static HRESULT	__nxapi ata_wait_irq(ATA_CONTROLLER_CTX *ctrl)
+{
+	uint32_t t = timer_gettickcount();
+
+	event_waitfor(&ctrl->irq_event, ATA_IRQ_TIMEOUT);
+	ctrl->irq_wait_ms += timer_gettickcount() - t;
+
+	return ata_wait_ex(ctrl->id, 10000);
+}
+
 static HRESULT __nxapi ata_get_controller(uint32_t controller_id, ATA_CONTROLLER_CTX **ctrl)
 {
 	if (controller_id >= 2) {
@@ -316,11 +445,12 @@ static HRESULT	__nxapi ata_select_drive_ex(ATA_CONTROLLER_CTX *ctrl, uint32_t ne
 	switch (addr_mode) {
 		case ATA_LBA28:
 		case ATA_LBA48:
-			ata_write_reg(ctrl, ATA_REG_DRIVE, 0xA0 | (new_drive_id << 4) | head_value);
+			/* Bit 6 selects LBA addressing */
+			ata_write_reg(ctrl, ATA_REG_DRIVE, 0xE0 | (new_drive_id << 4) | head_value);
 			break;
 
 		case ATA_CHS:
-			ata_write_reg(ctrl, ATA_REG_DRIVE, 0xE0 | (new_drive_id << 4) | head_value);
+			ata_write_reg(ctrl, ATA_REG_DRIVE, 0xA0 | (new_drive_id << 4) | head_value);
 			break;
 
 		default:
@@ -389,8 +519,8 @@ static HRESULT	__nxapi ata_detect_device(uint32_t controller_id, uint32_t drive_
 
 	target_dev->sector_size = ata_is_packet_interface(target_dev) ? ATAPI_SECTOR_SIZE : ATA_SECTOR_SIZE;
 
-	/* Default to PIO mode, since we don't support DMA in driver */
-	target_dev->mode = ATA_PIO;
+	/* ATAPI transfers are done with PIO only */
+	target_dev->mode = ata_dma_supported(target_dev) ? ATA_DMA : ATA_PIO;
 
 	/* Get device model string. We have to reverse endianness */
 	for (i=0; i<40; i+=2) {
@@ -536,7 +666,7 @@ static HRESULT	__nxapi ata_issue_atapi_identify(ATA_DEVICE_CONTEXT *target_dev)
 	return S_OK;
 }
 
-static HRESULT	__nxapi ata_rw_sectors(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer)
+static HRESULT	__nxapi ata_rw_sectors(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt)
 {
 	HRESULT hr;
 
@@ -550,12 +680,26 @@ static HRESULT	__nxapi ata_rw_sectors(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op,
 	/* Perform operation depending ot the transfer mode */
 	if (dev->mode == ATA_DMA) {
 		/* DMA mode */
-		hr = ata_rw_sectors_dma(dev, op, start, count, buffer);
+		hr = ata_rw_sectors_dma(dev, op, start, count, iov, iov_cnt);
+		if (SUCCEEDED(hr)) goto finally;
+
+		/* Retry with PIO. The drive may be stuck in the middle of the
+		 * command, so reset the bus first. */
+		dev->controller->dma_errors++;
+
+		if (++dev->dma_errors >= ATA_DMA_MAX_ERRORS) {
+			k_printf("ata: too many DMA errors on %s, switching to PIO.\n", dev->model);
+			dev->mode = ATA_PIO;
+		}
+
+		ata_software_reset(dev->controller->id);
+
+		hr = ata_rw_sectors_pio(dev, op, start, count, iov, iov_cnt);
 		if (FAILED(hr)) goto finally;
 
 	} else if (dev->mode == ATA_PIO) {
 		/* PIO mode */
-		hr = ata_rw_sectors_pio(dev, op, start, count, buffer);
+		hr = ata_rw_sectors_pio(dev, op, start, count, iov, iov_cnt);
 		if (FAILED(hr)) goto finally;
 
 	} else {
@@ -677,110 +821,61 @@ finally:
 	return hr;
 }
 
-static HRESULT	__nxapi ata_rw_sectors_pio(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer)
+static HRESULT	__nxapi ata_rw_sectors_pio(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt)
 {
-	uint32_t	i, j;
+	uint32_t	i, j, seg = 0;
 	HRESULT 	hr = S_OK;
-	uint16_t	*ptr = buffer;
+	uint16_t	*ptr = iov[0].base;
+	size_t		left = iov[0].len;
 	uint8_t 	cmd;
-	uint8_t 	head;
-	uint8_t		params[6];
 
-	if (count > 256) {
+	if (count == 0 || count > ATA_MAX_SECTORS) {
 		/* This routine can read up to 256 sectors at once */
 		return E_INVALIDARG;
 	}
 
-	if (dev->mode != ATA_PIO) {
-		/* This routine handles PIO only */
-		return E_FAIL;
-	}
-
-	/* We don't support CHS addressing mode, since it is obsolete */
-	if (dev->adr_mode == ATA_CHS) {
-		return E_FAIL;
-	}
-
-	/* Decide command byte */
-	switch (dev->mode) {
-		case ATA_LBA48:
-			params[0] = (start & 0x000000FF) >> 0;
-			params[1] = (start & 0x0000FF00) >> 8;
-			params[2] = (start & 0x00FF0000) >> 16;
-			params[3] = (start & 0xFF000000) >> 24;
-			params[4] = 0; //todo
-			params[5] = 0; //todo
-			head      = 0;
-			cmd		  = op == ATA_READ ? ATA_CMD_READ_PIO_EXT : ATA_CMD_WRITE_PIO_EXT;
-
-			break;
-
-		case ATA_LBA28:
-			params[0] = (start & 0x000000FF) >> 0;
-			params[1] = (start & 0x0000FF00) >> 8;
-			params[2] = (start & 0x00FF0000) >> 16;
-			params[3] = 0;
-			params[4] = 0;
-			params[5] = 0;
-			head 	  = (start & 0xF000000) >> 24;
-			cmd		  = op == ATA_READ ? ATA_CMD_READ_PIO : ATA_CMD_WRITE_PIO;
-
-			break;
-
-		default:
-			return E_INVALIDARG;
-	}
-
 	/* Lock controller */
 	ATA_LOCK(dev->controller);
 
-	/* Disable interrupts for current ATA bus */
-	ata_enable_interrupts(dev->controller, FALSE);
+	/* Interrupts are only used when serving asynchronous requests */
+	ata_enable_interrupts(dev->controller, dev->controller->irq_mode);
 
-	/* Wait the device if it is busy */
-	hr = ata_wait_status(dev->controller->id, 10000);
+	hr = ata_issue_rw_command(dev, op, FALSE, start, count);
 	if (FAILED(hr)) goto finally;
 
-	/* Select drive */
-	hr = ata_select_drive_ex(dev->controller, dev->drive_id, dev->mode, head);
-	if (FAILED(hr)) goto finally;
-
-	/* Write LBA48-related parameters (must be written first) */
-	if (dev->adr_mode == ATA_LBA48) {
-		ata_write_reg(dev->controller, ATA_REG_SECCOUNT1, 0);
-		ata_write_reg(dev->controller, ATA_REG_LBA3, params[3]);
-		ata_write_reg(dev->controller, ATA_REG_LBA4, params[4]);
-		ata_write_reg(dev->controller, ATA_REG_LBA5, params[5]);
-	}
-
-	/* Write generic parameters */
-	ata_write_reg(dev->controller, ATA_REG_SEC_CNT, count == 256 ? 0 : count);
-	ata_write_reg(dev->controller, ATA_REG_LBA_LOW, params[0]);
-	ata_write_reg(dev->controller, ATA_REG_LBA_MID, params[1]);
-	ata_write_reg(dev->controller, ATA_REG_LBA_HIGH, params[2]);
-	ata_write_reg(dev->controller, ATA_REG_COMMAND, cmd);
-
 	switch (op) {
 		case ATA_READ:
 			for (i=0; i<count; i++) {
-				hr = ata_wait_ex(dev->controller->id, 10000);
+				hr = dev->controller->irq_mode ? ata_wait_irq(dev->controller) : ata_wait_ex(dev->controller->id, 10000);
 				if (FAILED(hr)) goto finally;
 
 				for (j=0; j<ATA_SECTOR_SIZE/2; j++) {
 					*(ptr++) = READ_PORT_USHORT(dev->controller->cmd_base + ATA_REG_DATA);
 				}
+
+				/* Next segment */
+				if ((left -= ATA_SECTOR_SIZE) == 0 && ++seg < iov_cnt) {
+					ptr = iov[seg].base;
+					left = iov[seg].len;
+				}
 			}
 
 			break;
 
 		case ATA_WRITE:
 			for (i=0; i<count; i++) {
-				hr = ata_wait_status(dev->controller->id, 10000);
+				/* The drive interrupts after each sector, except before the first one */
+				hr = dev->controller->irq_mode && i > 0 ? ata_wait_irq(dev->controller) : ata_wait_status(dev->controller->id, 10000);
 				if (FAILED(hr)) goto finally;
 
 				for (j=0; j<ATA_SECTOR_SIZE/2; j++) {
 					WRITE_PORT_USHORT(dev->controller->cmd_base + ATA_REG_DATA, *(ptr++));
 				}
+
+				if ((left -= ATA_SECTOR_SIZE) == 0 && ++seg < iov_cnt) {
+					ptr = iov[seg].base;
+					left = iov[seg].len;
+				}
 			}
 
 			/* Flush the cache buffer. */
@@ -878,38 +973,318 @@ static void	__nxapi ata_enable_interrupts(ATA_CONTROLLER_CTX *ctrl, BOOL enable)
 	ATA_UNLOCK(ctrl);
 }
 
-static HRESULT	__nxapi ata_rw_sectors_dma(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, void *buffer)
+/*
+ * Waits for the drive, selects it and writes the task file of a read/write
+ * command (PIO or DMA). CHS addressing isn't supported, since it is obsolete.
+ */
+static HRESULT	__nxapi ata_issue_rw_command(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, BOOL dma, uint64_t start, size_t count)
 {
-	UNUSED_ARG(dev);
-	UNUSED_ARG(op);
-	UNUSED_ARG(start);
-	UNUSED_ARG(count);
-	UNUSED_ARG(buffer);
+	ATA_CONTROLLER_CTX	*ctrl = dev->controller;
+	uint8_t				cmd, head;
+	HRESULT				hr;
 
-	HalKernelPanic("ata_rw_sectors(): DMA mode access routine not implemented.");
-	return E_NOTIMPL;
+	switch (dev->adr_mode) {
+		case ATA_LBA48:
+			if (start + count > 0x1000000000000ULL) return E_INVALIDARG;
+
+			head = 0;
+			if (dma) {
+				cmd = op == ATA_READ ? ATA_CMD_READ_DMA_EXT : ATA_CMD_WRITE_DMA_EXT;
+			} else {
+				cmd = op == ATA_READ ? ATA_CMD_READ_PIO_EXT : ATA_CMD_WRITE_PIO_EXT;
+			}
+			break;
+
+		case ATA_LBA28:
+			if (start + count > 0x10000000) return E_INVALIDARG;
+
+			head = (start >> 24) & 0x0F;
+			if (dma) {
+				cmd = op == ATA_READ ? ATA_CMD_READ_DMA : ATA_CMD_WRITE_DMA;
+			} else {
+				cmd = op == ATA_READ ? ATA_CMD_READ_PIO : ATA_CMD_WRITE_PIO;
+			}
+			break;
+
+		default:
+			return E_INVALIDARG;
+	}
+
+	/* Wait the device if it is busy */
+	hr = ata_wait_status(ctrl->id, 10000);
+	if (FAILED(hr)) return hr;
+
+	/* Select drive */
+	hr = ata_select_drive_ex(ctrl, dev->drive_id, dev->adr_mode, head);
+	if (FAILED(hr)) return hr;
+
+	/* Write LBA48-related parameters (must be written first). A sector count
+	 * of 0 means 256 for LBA28 and 65536 for LBA48. */
+	if (dev->adr_mode == ATA_LBA48) {
+		ata_write_reg(ctrl, ATA_REG_SECCOUNT1, (count >> 8) & 0xFF);
+		ata_write_reg(ctrl, ATA_REG_LBA3, (start >> 24) & 0xFF);
+		ata_write_reg(ctrl, ATA_REG_LBA4, (start >> 32) & 0xFF);
+		ata_write_reg(ctrl, ATA_REG_LBA5, (start >> 40) & 0xFF);
+	}
+
+	/* Write generic parameters */
+	ata_write_reg(ctrl, ATA_REG_SEC_CNT, count & 0xFF);
+	ata_write_reg(ctrl, ATA_REG_LBA_LOW, (start >> 0) & 0xFF);
+	ata_write_reg(ctrl, ATA_REG_LBA_MID, (start >> 8) & 0xFF);
+	ata_write_reg(ctrl, ATA_REG_LBA_HIGH, (start >> 16) & 0xFF);
+	ata_write_reg(ctrl, ATA_REG_COMMAND, cmd);
+
+	return S_OK;
+}
+
+/**
+ * Returns TRUE if the bus has a bus master and the drive can do DMA.
+ */
+static BOOL __nxapi ata_dma_supported(ATA_DEVICE_CONTEXT *dev)
+{
+	if (dev->controller->bm_base == 0 || ata_is_packet_interface(dev)) {
+		return FALSE;
+	}
+
+	/* Capabilities word (49), bit 8 */
+	return dev->ident_space[ATA_IDENT_CAPABILITIES + 1] & 0x01 ? TRUE : FALSE;
 }
 
-static HRESULT __nxapi atadev_generate_url(char *prefix, char *dst)
+/*
+ * Appends a physical range to the PRD table, splitting it at 64KiB
+ * boundaries and merging it with the previous entry when contiguous.
+ */
+static HRESULT	__nxapi ata_prdt_add(ATA_CONTROLLER_CTX *ctrl, uint32_t *n, uintptr_t phys, size_t size)
 {
-	uint32_t	i;
-	uint32_t	l = strlen(prefix);
-	char		tmp[256];
+	ATA_PRD		*prev;
+	uint32_t	chunk, prev_size;
 
-	strcpy(tmp, prefix);
-	tmp[l+1] = '\0';
+	while (size > 0) {
+		chunk = 0x10000 - (phys & 0xFFFF);
+		if (chunk > size) chunk = size;
 
-	/* TODO: Expand to be able to test more than 10 ids */
-	for (i=0; i<10; i++) {
-		tmp[l] = '0' + i;
+		prev = *n > 0 ? &ctrl->prdt[*n - 1] : NULL;
+		prev_size = prev && prev->size == 0 ? 0x10000 : (prev ? prev->size : 0);
 
-		if (!k_file_exists(tmp)) {
-			strcpy(dst, tmp);
-			return S_OK;
+		if (prev && prev->phys + prev_size == phys && (phys & 0xFFFF) != 0) {
+			/* Same 64KiB window, grow the previous region */
+			prev->size = (prev_size + chunk) & 0xFFFF;
+		} else {
+			if (*n == ATA_PRDT_ENTRIES) {
+				return E_BUFFEROVERFLOW;
+			}
+
+			ctrl->prdt[*n].phys		= phys;
+			ctrl->prdt[*n].size		= chunk & 0xFFFF;
+			ctrl->prdt[*n].flags	= 0;
+			(*n)++;
+		}
+
+		phys += chunk;
+		size -= chunk;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Builds the PRD table for a transfer of `size` bytes, described by `iov`.
+ * Kernel buffers are described page by page (scatter-gather); user buffers,
+ * misaligned ones and segments that aren't whole sectors use the bounce
+ * buffer, in which case `bounced` is set and the caller copies the data
+ * (see ata_iov_copy()).
+ */
+static HRESULT	__nxapi ata_build_prdt(ATA_CONTROLLER_CTX *ctrl, const K_IOVEC *iov, uint32_t iov_cnt, size_t size, BOOL *bounced)
+{
+	uintptr_t	va, phys;
+	uint32_t	i, n = 0, chunk;
+	size_t		left;
+	HRESULT		hr = S_OK;
+
+	*bounced = FALSE;
+
+	for (i=0; i<iov_cnt && SUCCEEDED(hr); i++) {
+		va		= (uintptr_t)iov[i].base;
+		left	= iov[i].len;
+
+		/* Buffers must be 4-byte aligned and hold whole sectors, so no PRD entry
+		 * ends mid-dword. User memory may be paged out under us.
+		 */
+		if ((va & 0x3) != 0 || left % ATA_SECTOR_SIZE != 0 || va < KERNEL_CODE_START) {
+			hr = E_INVALIDARG;
+		}
+
+		while (SUCCEEDED(hr) && left > 0) {
+			chunk = VM_PAGE_FRAME_SIZE - (va & (VM_PAGE_FRAME_SIZE - 1));
+			if (chunk > left) chunk = left;
+
+			hr = vmm_virt_to_phys(NULL, va, &phys);
+			if (FAILED(hr)) break;
+
+			hr = ata_prdt_add(ctrl, &n, phys, chunk);
+
+			va += chunk;
+			left -= chunk;
+		}
+	}
+
+	if (FAILED(hr)) {
+		/* Start over with the bounce buffer */
+		if (size > ctrl->dma_buf_size) return E_INVALIDARG;
+
+		n = 0;
+		*bounced = TRUE;
+
+		hr = ata_prdt_add(ctrl, &n, ctrl->dma_buf_phys, size);
+		if (FAILED(hr)) return hr;
+	}
+
+	ctrl->prdt[n - 1].flags = ATA_PRD_EOT;
+	return S_OK;
+}
+
+/*
+ * Transfers up to 256 sectors with bus-master DMA. The drive interrupts once
+ * the whole transfer is done, so the caller sleeps instead of moving words.
+ */
+static HRESULT	__nxapi ata_rw_sectors_dma(ATA_DEVICE_CONTEXT *dev, ATA_OPERATION op, uint64_t start, size_t count, const K_IOVEC *iov, uint32_t iov_cnt)
+{
+	ATA_CONTROLLER_CTX	*ctrl = dev->controller;
+	size_t				size = count * ATA_SECTOR_SIZE;
+	BOOL				bounced;
+	uint8_t				bm_status, status;
+	uint32_t			t;
+	HRESULT				hr;
+
+	if (count == 0 || count > ATA_MAX_SECTORS) {
+		return E_INVALIDARG;
+	}
+
+	ATA_LOCK(ctrl);
+
+	hr = ata_build_prdt(ctrl, iov, iov_cnt, size, &bounced);
+	if (FAILED(hr)) goto finally;
+
+	if (bounced) {
+		ctrl->dma_bounced++;
+		if (op == ATA_WRITE) ata_iov_copy(iov, iov_cnt, ctrl->dma_buf, FALSE);
+	}
+
+	/* Set up the engine, without starting it */
+	ata_write_reg(ctrl, ATA_REG_BMCOMMAND, 0);
+	WRITE_PORT_ULONG(ctrl->bm_base + ATA_REG_BMPRDT - ATA_REG_BMCOMMAND, ctrl->prdt_phys);
+	ata_write_reg(ctrl, ATA_REG_BMCOMMAND, op == ATA_READ ? ATA_BMCMD_READ : 0);
+	ata_write_reg(ctrl, ATA_REG_BMSTATUS, ata_read_reg(ctrl, ATA_REG_BMSTATUS) | ATA_BMSTATUS_ERR | ATA_BMSTATUS_IRQ);
+
+	/* Completion is signalled by IRQ14/15 */
+	ata_enable_interrupts(ctrl, TRUE);
+	event_reset(&ctrl->irq_event);
+
+	hr = ata_issue_rw_command(dev, op, TRUE, start, count);
+	if (FAILED(hr)) goto stop;
+
+	ata_write_reg(ctrl, ATA_REG_BMCOMMAND, (op == ATA_READ ? ATA_BMCMD_READ : 0) | ATA_BMCMD_START);
+
+	t = timer_gettickcount();
+	hr = event_waitfor(&ctrl->irq_event, ATA_IRQ_TIMEOUT);
+	ctrl->irq_wait_ms += timer_gettickcount() - t;
+
+	if (FAILED(hr)) {
+		/* The IRQ may be lost, trust the bus master status */
+		bm_status = ata_read_reg(ctrl, ATA_REG_BMSTATUS);
+		hr = (bm_status & ATA_BMSTATUS_IRQ) ? S_OK : E_TIMEDOUT;
+	}
+
+stop:
+	ata_write_reg(ctrl, ATA_REG_BMCOMMAND, 0);
+
+	bm_status	= ata_read_reg(ctrl, ATA_REG_BMSTATUS);
+	status		= ata_read_reg(ctrl, ATA_REG_STATUS);
+
+	ata_write_reg(ctrl, ATA_REG_BMSTATUS, bm_status | ATA_BMSTATUS_ERR | ATA_BMSTATUS_IRQ);
+
+	if (SUCCEEDED(hr) && ((bm_status & ATA_BMSTATUS_ERR) || (status & (ATA_STATUS_ERR | ATA_STATUS_DF)))) {
+		hr = E_FAIL;
+	}
+
+	if (SUCCEEDED(hr)) {
+		hr = ata_wait_status(ctrl->id, 10000);
+	}
+
+	if (SUCCEEDED(hr) && op == ATA_WRITE) {
+		/* Flush the cache buffer. */
+		ata_write_reg(ctrl, ATA_REG_COMMAND, dev->adr_mode == ATA_LBA48 ? ATA_CMD_CACHE_FLUSH_EXT : ATA_CMD_CACHE_FLUSH);
+		ata_wait_status(ctrl->id, 10000);
+	}
+
+	if (SUCCEEDED(hr)) {
+		ctrl->dma_transfers++;
+		if (bounced && op == ATA_READ) ata_iov_copy(iov, iov_cnt, ctrl->dma_buf, TRUE);
+	}
+
+	ata_enable_interrupts(ctrl, ctrl->irq_mode);
+
+finally:
+	ATA_UNLOCK(ctrl);
+	return hr;
+}
+
+/*
+ * Copies between a segment list and a flat buffer.
+ */
+static VOID __nxapi ata_iov_copy(const K_IOVEC *iov, uint32_t iov_cnt, uint8_t *buf, BOOL to_iov)
+{
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		if (to_iov) {
+			memcpy(iov[i].base, buf, iov[i].len);
+		} else {
+			memcpy(buf, iov[i].base, iov[i].len);
 		}
+
+		buf += iov[i].len;
 	}
+}
+
+/*
+ * Serves a request of the drive's queue, on behalf of the queue thread.
+ * Merged requests arrive as a segment list, which DMA transfers turn into
+ * a single PRD table.
+ */
+static HRESULT __nxapi ata_blk_transfer(K_BLK_QUEUE *q, K_BLK_REQUEST *rq)
+{
+	ATA_DEVICE_CONTEXT	*dc = q->context;
+	K_IOVEC				iov[BLKQ_MAX_SEGMENTS];
+	uint32_t			iov_cnt;
+	HRESULT				hr;
+
+	iov_cnt = blkq_request_iov(rq, iov);
+
+	ATA_LOCK(dc->controller);
+	dc->controller->irq_mode = TRUE;
 
-	return E_FAIL;
+	hr = ata_rw_sectors(dc, rq->op == BIO_OP_READ ? ATA_READ : ATA_WRITE, rq->sector, rq->count, iov, iov_cnt);
+
+	dc->controller->irq_mode = FALSE;
+	ATA_UNLOCK(dc->controller);
+
+	return hr;
+}
+
+/*
+ * Allocates the url of the next drive with _prefix_. Drives are numbered
+ * in detection order, separately for each prefix.
+ */
+static HRESULT __nxapi atadev_generate_url(char *prefix, char **dst)
+{
+	static uint32_t	hd_cnt = 0, cdrom_cnt = 0;
+	uint32_t		*cnt = strcmp(prefix, "/dev/cdrom") == 0 ? &cdrom_cnt : &hd_cnt;
+
+	if (!(*dst = kmalloc(strlen(prefix) + 12))) {
+		return E_OUTOFMEM;
+	}
+
+	sprintf(*dst, "%s%d", prefix, (*cnt)++);
+	return S_OK;
 }
 
 static uint32_t	__nxapi atadev_get_sector_size(K_STREAM *s)
@@ -924,29 +1299,31 @@ static uint32_t	__nxapi atadev_get_sector_count(K_STREAM *s)
 	return dc->size;
 }
 
-static HRESULT	__nxapi atadev_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
+/*
+ * Transfers whole sectors. ATA transfers go through the request queue of
+ * the drive, ATAPI reads are split into chunks of at most 256 sectors.
+ */
+static HRESULT	__nxapi atadev_transfer_sectors(ATA_DEVICE_CONTEXT *dc, ATA_OPERATION op, uint64_t lba, uint32_t cnt, void *buffer)
 {
-	ATA_DEVICE_CONTEXT  *dc = GET_DRV_CTX(s);
-	uint32_t			cnt = args->count;
-	uint64_t			pos = args->start;
-	uint32_t			effective_cnt;
-	uint8_t				*ptr = args->buffer;
-	HRESULT				hr;
+	uint32_t	effective_cnt;
+	uint8_t		*ptr = buffer;
+	HRESULT		hr;
+
+	if (!ata_is_packet_interface(dc)) {
+		/* ATA */
+		return blkq_transfer(&dc->queue, op == ATA_READ ? BIO_OP_READ : BIO_OP_WRITE, lba, cnt, buffer);
+	}
+
+	/* ATAPI - writing to ATAPI drives is not supported by kernel. */
+	if (op == ATA_WRITE) return E_FAIL;
 
 	while (cnt > 0) {
 		effective_cnt = cnt > 256 ? 256 : cnt;
 
-		if (ata_is_packet_interface(dc)) {
-			/* ATAPI */
-			hr = atapi_read_sectors(dc, pos, effective_cnt, ptr);
-			if (FAILED(hr)) return hr;
-		} else {
-			/* ATA */
-			hr = ata_rw_sectors(dc, ATA_READ, pos, effective_cnt, ptr);
-			if (FAILED(hr)) return hr;
-		}
+		hr = atapi_read_sectors(dc, lba, effective_cnt, ptr);
+		if (FAILED(hr)) return hr;
 
-		pos += effective_cnt;
+		lba += effective_cnt;
 		ptr += effective_cnt * dc->sector_size;
 		cnt -= effective_cnt;
 	}
@@ -954,37 +1331,234 @@ static HRESULT	__nxapi atadev_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *
 	return S_OK;
 }
 
-static HRESULT	__nxapi atadev_write_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
+/*
+ * Byte-granular transfer. Partial sectors at the head and tail of the range
+ * go through a bounce sector (read-modify-write when writing), the aligned
+ * middle part is transferred directly to/from the caller's buffer.
+ */
+static HRESULT	__nxapi atadev_rw_at(ATA_DEVICE_CONTEXT *dc, ATA_OPERATION op, uint64_t offset, size_t size, void *buffer, size_t *bytes)
 {
-	ATA_DEVICE_CONTEXT  *dc = GET_DRV_CTX(s);
-	uint32_t			cnt = args->count;
-	uint64_t			pos = args->start;
-	uint32_t			effective_cnt;
-	uint8_t				*ptr;
-	HRESULT				hr;
+	uint64_t	dev_size = (uint64_t)dc->size * dc->sector_size;
+	uint64_t	lba;
+	uint32_t	head, chunk;
+	uint32_t	rem;
+	uint8_t		*ptr = buffer;
+	uint8_t		*bounce = NULL;
+	size_t		left;
+	HRESULT		hr = S_OK;
 
-	while (cnt > 0) {
-		effective_cnt = cnt > 256 ? 256 : cnt;
+	if (bytes) *bytes = 0;
+
+	if (offset >= dev_size) {
+		return E_ENDOFSTR;
+	}
+
+	/* Clamp to device size */
+	if (offset + size > dev_size) {
+		size = dev_size - offset;
+	}
+
+	lba		= udiv64(offset, dc->sector_size, &rem);
+	head	= rem;
+	left	= size;
+
+	if ((head != 0 || left % dc->sector_size != 0) && !(bounce = kmalloc(dc->sector_size))) {
+		return E_OUTOFMEM;
+	}
+
+	/* Unaligned head */
+	if (head != 0) {
+		chunk = dc->sector_size - head;
+		if (chunk > left) chunk = left;
+
+		hr = atadev_transfer_sectors(dc, ATA_READ, lba, 1, bounce);
+		if (FAILED(hr)) goto finally;
 
-		if (ata_is_packet_interface(dc)) {
-			/* ATAPI - writing to ATAPI drives is not supported by kernel. */
-			return E_FAIL;
+		if (op == ATA_READ) {
+			memcpy(ptr, bounce + head, chunk);
 		} else {
-			/* ATA */
-			hr = ata_rw_sectors(dc, ATA_WRITE, pos, effective_cnt, ptr);
-			if (FAILED(hr)) return hr;
+			memcpy(bounce + head, ptr, chunk);
+
+			hr = atadev_transfer_sectors(dc, ATA_WRITE, lba, 1, bounce);
+			if (FAILED(hr)) goto finally;
 		}
 
-		pos += effective_cnt;
-		ptr += effective_cnt * dc->sector_size;
-		cnt -= effective_cnt;
+		ptr		+= chunk;
+		left	-= chunk;
+		lba++;
 	}
 
-	return S_OK;
+	/* Aligned middle */
+	if (left >= dc->sector_size) {
+		chunk = left / dc->sector_size;
+
+		hr = atadev_transfer_sectors(dc, op, lba, chunk, ptr);
+		if (FAILED(hr)) goto finally;
+
+		ptr		+= chunk * dc->sector_size;
+		left	-= chunk * dc->sector_size;
+		lba		+= chunk;
+	}
+
+	/* Unaligned tail */
+	if (left > 0) {
+		hr = atadev_transfer_sectors(dc, ATA_READ, lba, 1, bounce);
+		if (FAILED(hr)) goto finally;
+
+		if (op == ATA_READ) {
+			memcpy(ptr, bounce, left);
+		} else {
+			memcpy(bounce, ptr, left);
+
+			hr = atadev_transfer_sectors(dc, ATA_WRITE, lba, 1, bounce);
+			if (FAILED(hr)) goto finally;
+		}
+
+		left = 0;
+	}
+
+finally:
+	if (bounce) kfree(bounce);
+	if (bytes) *bytes = size - left;
+
+	return hr;
+}
+
+static HRESULT	__nxapi atadev_pread(K_STREAM *s, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read)
+{
+	return atadev_rw_at(GET_DRV_CTX(s), ATA_READ, offset, size, out_buf, bytes_read);
+}
+
+static HRESULT	__nxapi atadev_pwrite(K_STREAM *s, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written)
+{
+	return atadev_rw_at(GET_DRV_CTX(s), ATA_WRITE, offset, size, in_buf, bytes_written);
+}
+
+/*
+ * Vectored transfer, starting at the position marker of the stream.
+ */
+static HRESULT	__nxapi atadev_rw_vector(K_STREAM *s, ATA_OPERATION op, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes)
+{
+	ATA_DEVICE_CONTEXT	*dc = GET_DRV_CTX(s);
+	size_t				total = 0, done;
+	HRESULT				hr = S_OK;
+
+	mutex_lock(&s->lock);
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0) continue;
+
+		hr = atadev_rw_at(dc, op, s->pos, iov[i].len, iov[i].base, &done);
+
+		s->pos += done;
+		total += done;
+
+		if (FAILED(hr) || done < iov[i].len) break;
+	}
+
+	mutex_unlock(&s->lock);
+
+	if (bytes) *bytes = total;
+	return total > 0 ? S_OK : hr;
+}
+
+static HRESULT	__nxapi atadev_readv(K_STREAM *s, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read)
+{
+	return atadev_rw_vector(s, ATA_READ, iov, iov_cnt, bytes_read);
+}
+
+static HRESULT	__nxapi atadev_writev(K_STREAM *s, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written)
+{
+	return atadev_rw_vector(s, ATA_WRITE, iov, iov_cnt, bytes_written);
+}
+
+static uint32_t	__nxapi atadev_seek(K_STREAM *s, int64_t pos, int8_t origin)
+{
+	ATA_DEVICE_CONTEXT	*dc = GET_DRV_CTX(s);
+	int64_t				dev_size = (int64_t)dc->size * dc->sector_size;
+	int64_t				new_pos;
+	HRESULT				hr = S_OK;
+
+	mutex_lock(&s->lock);
+
+	switch (origin) {
+	case KSTREAM_ORIGIN_BEGINNING:
+		new_pos = pos;
+		break;
+
+	case KSTREAM_ORIGIN_CURRENT:
+		new_pos = s->pos + pos;
+		break;
+
+	case KSTREAM_ORIGIN_END:
+		new_pos = dev_size - pos;
+		break;
+
+	default:
+		hr = E_INVALIDARG;
+		goto finally;
+	}
+
+	/* Position marker is 32-bit */
+	if (new_pos < 0 || new_pos > dev_size || new_pos > 0xFFFFFFFF) {
+		hr = E_INVALIDARG;
+		goto finally;
+	}
+
+	s->pos = new_pos;
+
+finally:
+	mutex_unlock(&s->lock);
+	return hr;
+}
+
+static uint32_t	__nxapi atadev_tell(K_STREAM *s)
+{
+	mutex_lock(&s->lock);
+	uint32_t r = s->pos;
+	mutex_unlock(&s->lock);
+
+	return r;
+}
+
+/*
+ * Queues an asynchronous request to the bus of the drive.
+ */
+static HRESULT	__nxapi atadev_submit(K_STREAM *s, K_IO_REQUEST *req)
+{
+	ATA_DEVICE_CONTEXT *dc = GET_DRV_CTX(s);
+
+	req->driver_data = dc;
+	return aio_queue_push(&dc->controller->io_queue, req);
+}
+
+/*
+ * Serves a request on behalf of the bus queue thread. Sector transfers are
+ * queued to the block queue of the drive, whose thread locks the controller,
+ * so the controller must not be held here.
+ */
+static HRESULT	__nxapi ata_aio_service(K_IO_QUEUE *q, K_IO_REQUEST *req)
+{
+	ATA_DEVICE_CONTEXT *dc = req->driver_data;
+
+	UNUSED_ARG(q);
+	return atadev_rw_at(dc, req->op == AIO_OP_READ ? ATA_READ : ATA_WRITE, req->offset, req->size, req->buffer, &req->bytes);
+}
+
+static HRESULT	__nxapi atadev_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
+{
+	return atadev_transfer_sectors(GET_DRV_CTX(s), ATA_READ, args->start, args->count, args->buffer);
+}
+
+static HRESULT	__nxapi atadev_write_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
+{
+	return atadev_transfer_sectors(GET_DRV_CTX(s), ATA_WRITE, args->start, args->count, args->buffer);
 }
 
 static HRESULT __nxapi atadev_ioctl(K_STREAM *s, uint32_t code, void *arg)
 {
+	ATA_DEVICE_CONTEXT *dc;
+
 	switch (code) {
 		case IOCTL_STORAGE_READ_BLOCKS:
 			return atadev_read_blocks(s, arg);
@@ -1000,6 +1574,13 @@ static HRESULT __nxapi atadev_ioctl(K_STREAM *s, uint32_t code, void *arg)
 			*(size_t*)arg = atadev_get_sector_count(s);
 			break;
 
+		case IOCTL_STORAGE_GET_QUEUE:
+			dc = GET_DRV_CTX(s);
+			if (ata_is_packet_interface(dc)) return E_NOTSUPPORTED;
+
+			*(K_BLK_QUEUE**)arg = &dc->queue;
+			break;
+
 		case IOCTL_STORAGE_EJECT:
 			return atapi_eject(GET_DRV_CTX(s));
 
@@ -1020,8 +1601,8 @@ static HRESULT __nxapi atadev_ioctl(K_STREAM *s, uint32_t code, void *arg)
 static HRESULT	__nxapi ata_create_device(uint32_t ctrl_id, uint32_t drv_id, K_DEVICE **dev)
 {
 	HRESULT				hr;
-	ATA_DEVICE_CONTEXT	*dc;
-	K_DEVICE			*kd;
+	ATA_DEVICE_CONTEXT	*dc = NULL;
+	K_DEVICE			*kd = NULL;
 
 	/* Allocate kernel device struct */
 	if (!(dc = kcalloc(sizeof(ATA_DEVICE_CONTEXT)))) {
@@ -1044,9 +1625,21 @@ static HRESULT	__nxapi ata_create_device(uint32_t ctrl_id, uint32_t drv_id, K_DE
 	kd->type		= DEVICE_TYPE_BLOCK;
 	kd->opaque		= dc;
 	kd->ioctl		= atadev_ioctl;
-	kd->default_url = ata_is_packet_interface(dc) ? "/dev/cdrom" : "/dev/hd";
+	kd->seek		= atadev_seek;
+	kd->tell		= atadev_tell;
+	kd->readv		= atadev_readv;
+	kd->writev		= atadev_writev;
+	kd->pread		= atadev_pread;
+	kd->pwrite		= atadev_pwrite;
+	kd->submit		= atadev_submit;
+	hr = atadev_generate_url(ata_is_packet_interface(dc) ? "/dev/cdrom" : "/dev/hd", &kd->default_url);
+	if (FAILED(hr)) goto finally;
 
-	hr = atadev_generate_url(kd->default_url, kd->default_url);
+	/* ATAPI drives are read directly, everything else is queued */
+	if (!ata_is_packet_interface(dc)) {
+		hr = blkq_create(&dc->queue, ata_blk_transfer, dc, dc->sector_size, ATA_MAX_SECTORS);
+		if (FAILED(hr)) goto finally;
+	}
 
 finally:
 	if (FAILED(hr)) {
@@ -1056,6 +1649,7 @@ finally:
 		}
 
 		if (kd) {
+			if (kd->default_url) kfree(kd->default_url);
 			kfree(kd);
 			kd = NULL;
 		}
@@ -1067,14 +1661,21 @@ finally:
 
 static HRESULT	__nxapi ata_destroy_device(K_DEVICE **dev)
 {
-	K_DEVICE *d = *dev;
+	K_DEVICE			*d = *dev;
+	ATA_DEVICE_CONTEXT	*dc = d->opaque;
 
 	/* Unmount */
 	vfs_unmount_device(d->default_url);
 
+	/* Drain pending requests */
+	if (!ata_is_packet_interface(dc)) {
+		blkq_destroy(&dc->queue);
+	}
+
 	/* Free */
+	kfree(d->default_url);
 	kfree(d->opaque);
-	kfree(dev);
+	kfree(d);
 
 	*dev = NULL;
 	return S_OK;
@@ -1107,7 +1708,7 @@ HRESULT __nxapi ata_driver_init()
 
 				/* Print device info */
 				if (!ata_is_packet_interface(dc)) {
-					k_printf("%s - %dmb; %s (mounted at '%s')\n", dc->model, dc->size * dc->sector_size / (1024*1024), proto_name[ata_is_packet_interface(dc) ? 1:0], dev->default_url);
+					k_printf("%s - %dmb; %s (mounted at '%s')\n", dc->model, dc->size / (1024*1024 / dc->sector_size), proto_name[ata_is_packet_interface(dc) ? 1:0], dev->default_url);
 				} else {
 					k_printf("%s; %s (mounted at '%s')\n", dc->model, proto_name[ata_is_packet_interface(dc) ? 1:0], dev->default_url);
 				}
@@ -1178,13 +1779,13 @@ HRESULT __nxapi ata_driver_test(char *dev)
 	/* Perform block read - read the boot sector */
 	hr = k_ioctl(hdrv, IOCTL_STORAGE_READ_BLOCKS, &rw_desc);
 	if (FAILED(hr))	{
-		k_printf("ata_driver_test(): failed to read block via ioctl (hr=%x).", hr);
+		k_printf("ata_driver_test(): failed to read block via ioctl (hr=0x%X).", hr);
 		goto finally;
 	}
 
 	/* Print first 128 bytes of boot sector */
 	for (i=0; i<128; i++) {
-		k_printf("%x ", (uint32_t)buff[i]);
+		k_printf("0x%X ", (uint32_t)buff[i]);
 
 		if (buff[i] <= 0xF) {
 			k_printf(" ");
@@ -1201,3 +1802,123 @@ finally:
 
 	return hr;
 }
+
+/*
+ * Reads up to ATA_BENCH_SIZE bytes from the start of the drive, in
+ * transfers of 256 sectors.
+ */
+#define ATA_BENCH_SIZE		(16 * 1024 * 1024)
+
+static HRESULT __nxapi ata_bench_pass(ATA_DEVICE_CONTEXT *dc, void *buf, size_t *total, uint32_t *ms, uint32_t *wait_ms)
+{
+	uint64_t	lba = 0;
+	uint64_t	end = (uint64_t)ATA_BENCH_SIZE / ATA_SECTOR_SIZE;
+	uint32_t	t, w;
+	HRESULT		hr = S_OK;
+
+	if (end > dc->size) end = dc->size;
+
+	*total = 0;
+	w = dc->controller->irq_wait_ms;
+	t = timer_gettickcount();
+
+	while (lba < end) {
+		uint32_t cnt = end - lba > ATA_MAX_SECTORS ? ATA_MAX_SECTORS : end - lba;
+
+		hr = atadev_transfer_sectors(dc, ATA_READ, lba, cnt, buf);
+		if (FAILED(hr)) break;
+
+		lba += cnt;
+		*total += cnt * ATA_SECTOR_SIZE;
+	}
+
+	*ms = timer_gettickcount() - t;
+	*wait_ms = dc->controller->irq_wait_ms - w;
+
+	return hr;
+}
+
+HRESULT __nxapi ata_driver_benchmark(char *dev)
+{
+	static const char		*mode_names[] = { "PIO", "DMA" };
+	ATA_DEVICE_CONTEXT		*dc;
+	ATA_TRANSFER_MODE		mode;
+	K_STREAM 				*hdrv;
+	uint8_t					*buf;
+	size_t					total;
+	uint32_t				pass, ms, wait_ms;
+	HRESULT					hr;
+
+	hr = k_fopen(dev, FILE_OPEN_READ, &hdrv);
+	if (FAILED(hr)) {
+		k_printf("ata_driver_benchmark(): failed to open driver handle.");
+		return hr;
+	}
+
+	dc = GET_DRV_CTX(hdrv);
+
+	if (ata_is_packet_interface(dc)) {
+		k_printf("%s: ATAPI drives are not benchmarked.\n", dev);
+		goto finally;
+	}
+
+	if (!(buf = kmalloc(ATA_DMA_BUF_SIZE))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	mode = dc->mode;
+
+	for (pass=0; pass<2; pass++) {
+		if (pass == 1 && !ata_dma_supported(dc)) {
+			k_printf("%s: no bus master or drive doesn't support DMA.\n", dev);
+			break;
+		}
+
+		dc->mode = pass == 0 ? ATA_PIO : ATA_DMA;
+
+		hr = ata_bench_pass(dc, buf, &total, &ms, &wait_ms);
+		if (FAILED(hr)) {
+			k_printf("%s: %s pass failed (hr=0x%X).\n", dev, mode_names[pass], hr);
+			break;
+		}
+
+		/* Time not spent sleeping on the IRQ is time the CPU was busy */
+		k_printf("%s: %s %d KiB in %d ms (%d KiB/s), CPU busy ~%d%%\n", dev, mode_names[pass], total / 1024, ms,
+				ms > 0 ? (uint32_t)(total / 1024 * 1000 / ms) : 0, ms > 0 ? (ms - wait_ms) * 100 / ms : 100);
+	}
+
+	dc->mode = mode;
+
+	k_printf("DMA: %d transfers, %d through the bounce buffer, %d errors\n",
+			dc->controller->dma_transfers, dc->controller->dma_bounced, dc->controller->dma_errors);
+
+	kfree(buf);
+
+finally:
+	k_fclose(&hdrv);
+	return hr;
+}
+
+HRESULT __nxapi ata_benchmark()
+{
+	HRESULT		hr = S_OK;
+	uint32_t	i, cnt = 0;
+
+	for (i=0; i<4; i++) {
+		if (__ata_devices[i] == NULL || __ata_devices[i]->subclass != DEVICE_SUBCLASS_HARDDISK) {
+			continue;
+		}
+
+		hr = ata_driver_benchmark(__ata_devices[i]->default_url);
+		if (FAILED(hr)) return hr;
+
+		cnt++;
+	}
+
+	if (cnt == 0) {
+		k_printf("No ATA drives detected.\n");
+	}
+
+	return hr;
+}
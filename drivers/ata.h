@@ -7,7 +7,8 @@
  *		- Dynamically allocate ATA controller IO ports (currently
  *			we assume that they are set to standard values by the BIOS).
  *
- *		- Support DMA transfer (currently we support PIO only).
+ *		- Program the drive's DMA mode with SET FEATURES (we rely on the
+ *			BIOS, which is enough for QEMU's PIIX IDE).
  *
  *		- Support for Serial ATA/ATAPI.
  *
@@ -17,6 +18,8 @@
 #include <types.h>
 #include <syncobjs.h>
 #include <stddef.h>
+#include <aio.h>
+#include <blkq.h>
 
 #ifndef DRIVERS_ATA_H_
 #define DRIVERS_ATA_H_
@@ -50,6 +53,36 @@
 #define ATA_REG_ALTSTATUS   	0xC
 #define ATA_REG_DEVADDRESS   	0xD
 
+/* Bus master registers (relative to BAR4, +8 for the secondary bus) */
+#define ATA_REG_BMCOMMAND		0xE
+#define ATA_REG_BMSTATUS		0x10
+#define ATA_REG_BMPRDT			0x12
+
+/* Bus master command bits */
+#define ATA_BMCMD_START			(1 << 0)
+#define ATA_BMCMD_READ			(1 << 3)
+
+/* Bus master status bits */
+#define ATA_BMSTATUS_ACTIVE		(1 << 0)
+#define ATA_BMSTATUS_ERR		(1 << 1)
+#define ATA_BMSTATUS_IRQ		(1 << 2)
+#define ATA_BMSTATUS_DRV0_DMA	(1 << 5)
+#define ATA_BMSTATUS_DRV1_DMA	(1 << 6)
+
+/* Physical Region Descriptor table. It fills one page, which never crosses
+ * a 64KiB boundary. */
+#define ATA_PRDT_ENTRIES		512
+#define ATA_PRD_EOT				0x8000
+
+/* Largest transfer of a single command */
+#define ATA_MAX_SECTORS			256
+
+/* Bounce buffer, used for buffers which can't be DMA'd directly */
+#define ATA_DMA_BUF_SIZE		(ATA_MAX_SECTORS * ATA_SECTOR_SIZE)
+
+/* Drives fall back to PIO for good after this many failed DMA transfers */
+#define ATA_DMA_MAX_ERRORS		3
+
 /* Control registers offset */
 #define ATA_CTL_REG_CONTROL     0x10
 #define ATA_CTL_REG_ALT_STATUS  0x10
@@ -117,6 +150,17 @@ typedef enum {
 	ATA_TYPE_SATAPI,
 } ATA_DEVICE_TYPE;
 
+/**
+ * Physical Region Descriptor. A region must not cross a 64KiB boundary;
+ * a byte count of 0 means 64KiB.
+ */
+typedef struct ATA_PRD ATA_PRD;
+struct ATA_PRD {
+	uint32_t	phys;
+	uint16_t	size;
+	uint16_t	flags;
+} __packed;
+
 typedef struct ATA_CONTROLLER_CTX ATA_CONTROLLER_CTX;
 struct ATA_CONTROLLER_CTX {
 	uint32_t	id;
@@ -129,10 +173,27 @@ struct ATA_CONTROLLER_CTX {
 	uint32_t	drive;
 	uint8_t		nIEN;
 
-	/* Used when in DMA mode */
+	/* Asynchronous requests for drives on this bus. Sector transfers of ATA
+	 * drives go through the block queue of the drive; while it's thread
+	 * serves a request, irq_mode is set and PIO transfers sleep on irq_event
+	 * instead of polling the status register. */
+	K_IO_QUEUE	io_queue;
+	BOOL		irq_mode;
+
+	/* Used when in DMA mode. bm_base is 0 if there is no bus master. */
 	uint32_t	dma_buf_size;
 	uintptr_t	dma_buf_phys;
 	void*		dma_buf;
+	ATA_PRD		*prdt;
+	uintptr_t	prdt_phys;
+
+	/* Statistics */
+	uint32_t	dma_transfers;
+	uint32_t	dma_bounced;
+	uint32_t	dma_errors;
+
+	/** Time spent sleeping on irq_event, in ms */
+	uint32_t	irq_wait_ms;
 };
 
 typedef struct ATA_DEVICE_CONTEXT ATA_DEVICE_CONTEXT;
@@ -152,6 +213,12 @@ struct ATA_DEVICE_CONTEXT {
 	char				model[41];
 
 	uint32_t			command_sets;
+
+	/** Failed DMA transfers, see ATA_DMA_MAX_ERRORS */
+	uint32_t			dma_errors;
+
+	/** Request queue, ATA drives only */
+	K_BLK_QUEUE			queue;
 };
 
 typedef struct ATA_REQUEST ATA_REQUEST;
@@ -166,4 +233,14 @@ HRESULT __nxapi ata_driver_init();
 HRESULT __nxapi ata_driver_fini();
 HRESULT __nxapi ata_driver_test(char *dev);
 
+/**
+ * Compares sequential read throughput and CPU usage of PIO and DMA.
+ */
+HRESULT __nxapi ata_driver_benchmark(char *dev);
+
+/**
+ * Runs ata_driver_benchmark() on every detected ATA (not ATAPI) drive.
+ */
+HRESULT __nxapi ata_benchmark();
+
 #endif /* DRIVERS_ATA_H_ */
@@ -1,17 +1,27 @@
 /*
  * fat16.c
  *
- *	FAT12/FAT16 file-system driver.
+ *	FAT12/FAT16/FAT32 file-system driver.
  *
- *	Yet to current date the driver supports only reading operations.
- *	Some of the routines does handle FAT32 as well, but it is not generally
- *	supported.
+ *	Files and directories can be created, written, truncated, renamed and
+ *	deleted. Long filenames (VFAT) are read and written. New names which
+ *	aren't valid 8.3 names get a generated short alias (NAME~1.EXT).
+ *
+ *	The FAT is kept in memory. Modified FAT sectors are tracked and written
+ *	to every copy of the FAT when a namespace operation completes, when a
+ *	written file is closed, on sync and on unmount. While a file is being
+ *	written, this happens at most every FAT_FLUSH_INTERVAL ms. Directory
+ *	sectors and file content go through the (write-back) buffer cache.
+ *
+ *	Free clusters are tracked in a bitmap, built at mount time. Allocations
+ *	look for a run of free clusters long enough for the request first,
+ *	starting right after the end of the file, so files stay contiguous. On
+ *	FAT32 the FSInfo sector is kept up to date as well.
  *
  *	TODO:
- *		- Implement write support (creating/writing files, directories)
- *		- Support for FAT32
  *		- Format
  *		- Defragmentation
+ *		- Timestamps (there is no RTC driver yet)
  *		- Clobbering
 
  *	References:
@@ -26,26 +36,80 @@
 #include <string.h>
 #include <hal.h>
 #include <kstdio.h>
+#include <dcache.h>
+#include <dirindex.h>
+#include <timer.h>
+#include <bcache.h>
+
+/* Initial capacity of extent maps */
+#define FAT_EXTENT_MAP_INITIAL	8
+
+/* While files are written, the FAT is flushed at most this often (ms) */
+#define FAT_FLUSH_INTERVAL		2000
+
+/* Highest number tried for generated short names (NAME~N) */
+#define FAT_ALIAS_MAX			999999
+
+/* Cleared by the benchmark, to compare with walking the chain on every read */
+static BOOL fat16_extents_enabled = TRUE;
 
 /* Prototypes of internal functions */
 static HRESULT fat16_parse_bpb(K_FS_DRIVER *drv);
 static HRESULT fat16_fat_lookup(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t *value);
+static HRESULT fat16_fat_set(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t value);
 static HRESULT fat16_cache_fat_table(K_FS_DRIVER *drv);
-static HRESULT fat16_read_file_content(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry, uint32_t start, uint32_t count, void *dst);
+static HRESULT fat16_flush_fat(K_FS_DRIVER *drv);
+static HRESULT fat16_flush_fat_lazy(K_FS_DRIVER *drv);
+static HRESULT fat16_build_free_map(K_FS_DRIVER *drv);
+static HRESULT fat16_read_fsinfo(K_FS_DRIVER *drv);
+static HRESULT fat16_write_fsinfo(K_FS_DRIVER *drv);
+static HRESULT fat16_alloc_clusters(K_FS_DRIVER *drv, uint32_t prev, uint32_t count, uint32_t *first, uint32_t *last);
+static HRESULT fat16_free_chain(K_FS_DRIVER *drv, uint32_t first_cluster);
+static HRESULT fat16_chain_last(K_FS_DRIVER *drv, uint32_t first_cluster, uint32_t *last, uint32_t *count);
+static HRESULT fat16_zero_cluster(K_FS_DRIVER *drv, uint32_t cluster);
+static HRESULT fat16_file_content_io(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *buf, BOOL write);
+static HRESULT fat16_read_file_content(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *dst);
+static HRESULT fat16_write_file_content(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *src);
+static HRESULT fat16_extent_extend(K_FS_DRIVER *drv, FAT16_EXTENT_MAP *map);
+static HRESULT fat16_extent_find(K_FS_DRIVER *drv, FAT16_EXTENT_MAP *map, uint32_t file_cluster, uint32_t *index);
 static HRESULT fat16_read_rootdir_content(K_FS_DRIVER *drv, void *dst);
-static HRESULT fat16_find_subentry(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *dir, char *filename, uint32_t flagmask, BOOL skip_vlabel, FAT16_DIR_ENTRY *dst);
-static HRESULT fat16_parse_url(K_FS_DRIVER *drv, char *url, FAT16_DIR_ENTRY *out_entry);
+static HRESULT fat16_read_dir(K_FS_DRIVER *drv, uint32_t dir_cluster, FAT16_DIR_ENTRY **out, uint32_t *count);
+static HRESULT fat16_write_dir_entries(K_FS_DRIVER *drv, uint32_t dir_cluster, uint32_t index, uint32_t count, FAT16_DIR_ENTRY *entries);
+static HRESULT fat16_dir_add(K_FS_DRIVER *drv, uint32_t dir_cluster, char *name, FAT16_DIR_ENTRY *entry, FAT16_DIR_LOC *out);
+static HRESULT fat16_dir_remove(K_FS_DRIVER *drv, FAT16_DIR_LOC *loc);
+static HRESULT fat16_dir_is_empty(K_FS_DRIVER *drv, uint32_t dir_cluster);
+static HRESULT fat16_check_not_below(K_FS_DRIVER *drv, uint32_t dir_cluster, uint32_t ancestor);
+static HRESULT fat16_dir_index(K_FS_DRIVER *drv, uint32_t dir_cluster, K_DIRINDEX **out);
+static void fat16_dir_changed(K_FS_DRIVER *drv, uint32_t dir_cluster);
+static HRESULT fat16_find_subentry(K_FS_DRIVER *drv, uint32_t dir_cluster, char *filename, uint32_t flagmask, FAT16_DIR_LOC *dst);
+static HRESULT fat16_lookup(K_FS_DRIVER *drv, uint32_t dir_cluster, char *filename, uint32_t flagmask, FAT16_DIR_LOC *dst);
+static HRESULT fat16_parse_url(K_FS_DRIVER *drv, char *url, FAT16_DIR_LOC *out);
+static HRESULT fat16_parse_parent(K_FS_DRIVER *drv, char *path, uint32_t *dir_cluster, char *name);
 
 /* Helper functions.
  * Functions with "fat" prefix are usually usable for all FAT file-system types.
  */
 static BOOL fat_is_end_of_chain(K_FS_DRIVER *drv, uint32_t cluster_id);
+static uint32_t fat_get_eoc(K_FS_DRIVER *drv);
+static BOOL fat_is_free(FAT16_DRV_CONTEXT *ctx, uint32_t cluster);
+static void fat_mark_free(FAT16_DRV_CONTEXT *ctx, uint32_t cluster, BOOL free);
+static uint32_t fat_find_free_run(FAT16_DRV_CONTEXT *ctx, uint32_t from, uint32_t count);
 static void	fat_copy_short_filename(FAT16_DIR_ENTRY *entry, char *dst);
+static HRESULT fat_dir_next(FAT16_DIR_ENTRY *entries, uint32_t count, uint32_t *pos, uint32_t *lfn_index, char *name);
+static uint8_t fat_lfn_checksum(FAT16_DIR_ENTRY *entry);
+static BOOL fat_is_valid_name(char *name);
+static BOOL fat_make_short_name(char *name, FAT16_DIR_ENTRY *entry);
+static HRESULT fat_make_short_alias(char *name, FAT16_DIR_ENTRY *entries, uint32_t count, FAT16_DIR_ENTRY *entry);
 static uint32_t fat_get_type(K_FS_DRIVER *drv);
 static uint32_t fat_get_rootdir_size(K_FS_DRIVER *drv);
 static uint32_t fat_get_subitem_count(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry_arr, uint32_t entries_max);
 static uint32_t fat_count_chain(K_FS_DRIVER *drv, uint32_t first_cluster);
 static uint32_t	fat_get_first_cluster(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry);
+static void		fat_set_first_cluster(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry, uint32_t cluster);
+static uint32_t	fat_get_root_cluster(K_FS_DRIVER *drv);
+static uint64_t	fat_get_inode_id(uint32_t dir_cluster, uint32_t index);
+static void		fat_extent_map_init(FAT16_EXTENT_MAP *map, uint32_t first_cluster);
+static void		fat_extent_map_free(FAT16_EXTENT_MAP *map);
 
 /* Functions exported through the driver interface */
 static HRESULT fat16_init(K_FS_DRIVER *drv, char *storage_drv);
@@ -54,6 +118,9 @@ static HRESULT fat16_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out
 static HRESULT fat16_mkdir(K_FS_DRIVER *drv, char *path, uint32_t mode);
 static HRESULT fat16_create(K_FS_DRIVER *drv, char *filename, uint32_t perm);
 static HRESULT fat16_open(K_FS_DRIVER *drv, char *filename, uint32_t flags, K_STREAM **out);
+static HRESULT fat16_unlink(K_FS_DRIVER *drv, char *path);
+static HRESULT fat16_rename(K_FS_DRIVER *drv, char *old_path, char *new_path);
+static HRESULT fat16_sync(K_FS_DRIVER *drv);
 
 /* Directory stream functions */
 static HRESULT fat16_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info);
@@ -62,15 +129,27 @@ static HRESULT fat16_closedir(K_DIR_STREAM **dirstr);
 
 /* File stream functions */
 static HRESULT fat16_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read);
+static HRESULT fat16_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+static HRESULT fat16_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
 static HRESULT fat16_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written);
+static HRESULT fat16_file_writev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+static HRESULT fat16_file_pwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
 static HRESULT fat16_file_ioctl(K_STREAM *s, uint32_t code, void *arg);
 static uint32_t fat16_file_seek(K_STREAM *s, int64_t pos, int8_t origin);
 static uint32_t fat16_file_tell(K_STREAM *s);
 static HRESULT fat16_file_close(K_STREAM **str);
+static HRESULT fat16_page_fill(K_STREAM *s, uint64_t offset, size_t size, void *dst, size_t *bytes_read);
+static HRESULT fat16_file_read_cached(K_STREAM *str, uint32_t pos, size_t size, void *out_buf, size_t *bytes_read);
 
 /* File stream helpers */
 static HRESULT fat16_read_subblock(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t size, void *dst);
 static HRESULT fat16_cache_blocks(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t block_cnt);
+static HRESULT fat16_file_chain_info(K_STREAM *s);
+static HRESULT fat16_file_reserve(K_STREAM *s, uint32_t clusters);
+static HRESULT fat16_file_write_bytes(K_STREAM *s, uint32_t pos, uint32_t size, const void *in_buf);
+static HRESULT fat16_file_write_at(K_STREAM *str, uint32_t pos, size_t size, const void *in_buf, size_t *bytes_written);
+static HRESULT fat16_file_set_size(K_STREAM *s, uint32_t size);
+static HRESULT fat16_file_update_entry(K_STREAM *s);
 
 /*
  * Tests if a given cluster id is a symbolic constant for
@@ -107,6 +186,25 @@ fat_is_end_of_chain(K_FS_DRIVER *drv, uint32_t cluster_id)
 	return FALSE;
 }
 
+/*
+ * Returns the value marking the end of a cluster chain.
+ */
+static uint32_t fat_get_eoc(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT *ctx = drv->priv_data;
+
+	switch (ctx->fs_type) {
+		case FS_TYPE_FAT12:
+			return 0xFFF;
+
+		case FS_TYPE_FAT16:
+			return 0xFFFF;
+
+		default:
+			return 0x0FFFFFFF;
+	}
+}
+
 /*
  * Looks up the successive cluster id in the cluster chain for given
  * cluster with id of `cluster_index`.
@@ -121,6 +219,11 @@ fat16_fat_lookup(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t *value)
 		return E_INVALIDARG;
 	}
 
+	/* Clusters 0 and 1 are reserved, anything past the data area is corrupt */
+	if (fat_index < 2 || fat_index > ctx->total_cluster_cnt + 1) {
+		return E_INVALIDARG;
+	}
+
 	switch (ctx->fs_type) {
 		case FS_TYPE_FAT12:
 			result = *(uint16_t*)&ctx->fat_cache[fat_index + fat_index / 2];
@@ -132,7 +235,8 @@ fat16_fat_lookup(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t *value)
 			break;
 
 		case FS_TYPE_FAT32:
-			result = *(uint32_t*)&ctx->fat_cache[fat_index * 4];
+			/* Upper 4 bits are reserved */
+			result = *(uint32_t*)&ctx->fat_cache[fat_index * 4] & 0x0FFFFFFF;
 			break;
 
 		default:
@@ -144,13 +248,79 @@ fat16_fat_lookup(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t *value)
 	return S_OK;
 }
 
+/*
+ * Sets the FAT entry of cluster `fat_index` in the FAT cache and marks the
+ * sectors holding it dirty. The free cluster bitmap is updated accordingly.
+ */
+static HRESULT fat16_fat_set(K_FS_DRIVER *drv, uint32_t fat_index, uint32_t value)
+{
+	FAT16_DRV_CONTEXT	*ctx = drv->priv_data;
+	uint32_t			offset, last, old;
+	uint8_t				*p;
+	HRESULT				hr;
+
+	hr = fat16_fat_lookup(drv, fat_index, &old);
+	if (FAILED(hr)) return hr;
+
+	switch (ctx->fs_type) {
+		case FS_TYPE_FAT12:
+			/* 12-bit entries share a byte with their neighbour, and the two
+			 * bytes may lie in different sectors */
+			offset	= fat_index + fat_index / 2;
+			last	= offset + 1;
+			p		= &ctx->fat_cache[offset];
+
+			if ((fat_index & 0x1) != 0) {
+				p[0] = (p[0] & 0x0F) | ((value << 4) & 0xF0);
+				p[1] = (value >> 4) & 0xFF;
+			} else {
+				p[0] = value & 0xFF;
+				p[1] = (p[1] & 0xF0) | ((value >> 8) & 0x0F);
+			}
+			break;
+
+		case FS_TYPE_FAT16:
+			offset	= fat_index * 2;
+			last	= offset;
+			*(uint16_t*)&ctx->fat_cache[offset] = value;
+			break;
+
+		case FS_TYPE_FAT32:
+			/* Upper 4 bits are reserved and have to be preserved */
+			offset	= fat_index * 4;
+			last	= offset;
+			*(uint32_t*)&ctx->fat_cache[offset] = (*(uint32_t*)&ctx->fat_cache[offset] & 0xF0000000) | (value & 0x0FFFFFFF);
+			break;
+
+		default:
+			HalKernelPanic("fat16_fat_set(): Unhandled FS type.");
+			return E_FAIL;
+	}
+
+	if (!ctx->fat_cache_dirty) {
+		ctx->fat_cache_dirty = TRUE;
+		ctx->dirty_since = timer_gettickcount();
+	}
+
+	ctx->fat_dirty[offset / ctx->bpb.bytes_per_sector] = 1;
+	ctx->fat_dirty[last / ctx->bpb.bytes_per_sector] = 1;
+
+	if (old == 0 && value != 0) {
+		fat_mark_free(ctx, fat_index, FALSE);
+	} else if (old != 0 && value == 0) {
+		fat_mark_free(ctx, fat_index, TRUE);
+	}
+
+	return S_OK;
+}
+
 /*
  * Reads the content of the FAT and stores it in a memory buffer.
  */
 static HRESULT fat16_cache_fat_table(K_FS_DRIVER *drv)
 {
 	FAT16_DRV_CONTEXT *ctx 		= drv->priv_data;
-	uint32_t	fat_size		= ctx->bpb.sectors_per_FAT * ctx->bpb.bytes_per_sector;
+	uint32_t	fat_size		= ctx->sectors_per_fat * ctx->bpb.bytes_per_sector;
 	uint32_t	fat_start		= ctx->first_fat_sector;
 	HRESULT		hr;
 
@@ -164,1116 +334,4366 @@ static HRESULT fat16_cache_fat_table(K_FS_DRIVER *drv)
 		return E_OUTOFMEM;
 	}
 
-	/* Read sectors to memory buffer directly */
-	hr = storage_read_blocks(ctx->storage_drv, fat_start, ctx->bpb.sectors_per_FAT, ctx->fat_cache);
+	/* Read sectors to memory buffer directly. The table is kept in memory
+	 * anyway, so it would only take space in the buffer cache.
+	 */
+	hr = storage_read_blocks_ex(ctx->storage_drv, fat_start, ctx->sectors_per_fat, ctx->fat_cache, STORAGE_IO_BYPASS);
 	return hr;
 }
 
 /*
- * Reads `count` bytes from the content of a FAT12/16 file starting from the
- * `start`-th byte. Start address and count have to be multiple of the sector
- * size.
- *
- * Reading is done by iterating the cluster chain and copying
- * cluster's content to `dst` buffer.
- *
- * Note that directories are also considered files holding an array of
- * `FAT16_DIR_ENTRY` structs.
+ * Writes the modified sectors of the FAT cache to every copy of the FAT, and
+ * updates the FSInfo sector. Like the initial read, this bypasses the buffer
+ * cache. Must be called with the driver lock held.
  */
-static HRESULT fat16_read_file_content(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry, uint32_t start, uint32_t count, void *dst)
+static HRESULT fat16_flush_fat(K_FS_DRIVER *drv)
 {
-	FAT16_DRV_CONTEXT 	*ctx 			= drv->priv_data;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			bps	= ctx->bpb.bytes_per_sector;
+	uint32_t			sector = 0, count, i;
 	HRESULT				hr;
-	uint32_t			skip_sectors	= start / ctx->bpb.bytes_per_sector;
-	uint32_t			count_sectors	= count / ctx->bpb.bytes_per_sector;
-	uint32_t			count_clusters	= (count_sectors + ctx->bpb.sectors_per_cluster - 1) / ctx->bpb.sectors_per_cluster;
-	uint32_t			cluster_id		= fat_get_first_cluster(drv, entry);
-	uint8_t				*dst_buff		= dst;
-	uint32_t			write_index		= 0;
-	uint32_t			i, j, sector;
 
-	/* Validate input arguments */
-	if (start % ctx->bpb.bytes_per_sector != 0 || count % ctx->bpb.bytes_per_sector != 0) {
-		return E_INVALIDARG;
-	}
+	while (ctx->fat_cache_dirty && sector < ctx->sectors_per_fat) {
+		if (!ctx->fat_dirty[sector]) {
+			sector++;
+			continue;
+		}
 
-	/* Skip to the first cluster of interest */
-	while (skip_sectors >= ctx->bpb.sectors_per_cluster) {
-		/* Find ID of next cluster */
-		hr = fat16_fat_lookup(drv, cluster_id, &cluster_id);
-		if (FAILED(hr)) return E_FAIL;
+		/* Write runs of dirty sectors with a single request */
+		count = 1;
+		while (sector + count < ctx->sectors_per_fat && ctx->fat_dirty[sector + count]) {
+			count++;
+		}
+
+		for (i=0; i<ctx->bpb.FAT_count; i++) {
+			hr = storage_write_blocks_ex(ctx->storage_drv, ctx->first_fat_sector + i * ctx->sectors_per_fat + sector, count, ctx->fat_cache + sector * bps, STORAGE_IO_BYPASS);
+			if (FAILED(hr)) return hr;
+		}
 
-		skip_sectors -= ctx->bpb.sectors_per_cluster;
+		memset(&ctx->fat_dirty[sector], 0, count);
+		sector += count;
 	}
 
-	/* Iterate clusters */
-	for (i=0; i<count_clusters; i++) {
-		sector = ctx->first_data_sector + (cluster_id - 2) * ctx->bpb.sectors_per_cluster;
+	ctx->fat_cache_dirty = FALSE;
 
-		/* Iterate sectors */
-		for (j=0; j<ctx->bpb.sectors_per_cluster; j++) {
-			/* Do we have to skip more sectors? */
-			if (skip_sectors > 0) {
-				skip_sectors--;
-				continue;
-			}
+	if (ctx->fsinfo_dirty) {
+		return fat16_write_fsinfo(drv);
+	}
 
-			/* Read sector */
-			hr = storage_read_blocks(ctx->storage_drv, sector+j, 1, dst_buff + write_index);
-			if (FAILED(hr)) return hr;;
-			write_index += ctx->bpb.bytes_per_sector;
+	return S_OK;
+}
 
-			/* Did we read enough? */
-			if (write_index == count) {
-				break;
-			}
-		}
+/*
+ * Flushes the FAT once it has been modified for FAT_FLUSH_INTERVAL. Used while
+ * files are written, so appending to a file doesn't write the FAT every time.
+ */
+static HRESULT fat16_flush_fat_lazy(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT *ctx = drv->priv_data;
 
-		/* Jump to next cluster */
-		hr = fat16_fat_lookup(drv, cluster_id, &cluster_id);
-		if (FAILED(hr)) return E_FAIL;
+	if (ctx->fat_cache_dirty && timer_gettickcount() - ctx->dirty_since >= FAT_FLUSH_INTERVAL) {
+		return fat16_flush_fat(drv);
 	}
 
-	/* Sanity check */
-	if (write_index != count) {
-		k_printf("write_index=%d; count=%d\n", write_index, count);
-		HalKernelPanic("fat16_read_file_content(): Unexpected.");
+	return S_OK;
+}
+
+/*
+ * Tests the bit of `cluster` in the free cluster bitmap.
+ */
+static BOOL fat_is_free(FAT16_DRV_CONTEXT *ctx, uint32_t cluster)
+{
+	return (ctx->free_map[cluster / 32] & (1u << (cluster % 32))) != 0 ? TRUE : FALSE;
+}
+
+static void fat_mark_free(FAT16_DRV_CONTEXT *ctx, uint32_t cluster, BOOL free)
+{
+	uint32_t bit = 1u << (cluster % 32);
+
+	if (free && (ctx->free_map[cluster / 32] & bit) == 0) {
+		ctx->free_map[cluster / 32] |= bit;
+		ctx->free_count++;
+	} else if (!free && (ctx->free_map[cluster / 32] & bit) != 0) {
+		ctx->free_map[cluster / 32] &= ~bit;
+		ctx->free_count--;
 	}
 
-	return S_OK;
+	ctx->fsinfo_dirty = TRUE;
 }
 
 /*
- * Reads the content of the FAT12/16 "root dir", which holds an array
- * of DIR ENTRIES for files and directories residing in the root file system
- * directory.
- *
- * It is not possible to retrieve parts of the root dir content.
+ * Scans the FAT for free clusters and builds the free cluster bitmap.
  */
-static HRESULT fat16_read_rootdir_content(K_FS_DRIVER *drv, void *dst)
+static HRESULT fat16_build_free_map(K_FS_DRIVER *drv)
 {
-	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
-	uint32_t			root_bytes 	= fat_get_rootdir_size(drv);
-	uint32_t			root_sectors= (root_bytes + ctx->bpb.bytes_per_sector - 1) / ctx->bpb.bytes_per_sector;
-	uint32_t			write_index = 0;
-	uint8_t				*dst_buff	= dst; //use uint8_t* for pointer arithmetics
-	uint32_t			i;
-	uint8_t				*buff;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			last = ctx->total_cluster_cnt + 1;
+	uint32_t			cluster, value;
 	HRESULT				hr;
 
-	for (i=0; i<root_sectors; i++) {
-		if (root_bytes - write_index >= ctx->bpb.bytes_per_sector) {
-			/* Read sector directly to destination buffer */
-			hr = storage_read_blocks(ctx->storage_drv, ctx->first_root_sector + i, 1, dst_buff + write_index);
-			if (FAILED(hr)) return hr;
+	if (!(ctx->free_map = kcalloc((last / 32 + 1) * sizeof(uint32_t)))) {
+		return E_OUTOFMEM;
+	}
 
-			write_index += ctx->bpb.bytes_per_sector;
-		} else {
-			/* Read sector through temporary buffer, since we have no guarantee that
-			 * destination buffer can accommodate more that `root_bytes` bytes.
-			 */
-			buff = kmalloc(ctx->bpb.bytes_per_sector);
-			hr = storage_read_blocks(ctx->storage_drv, ctx->first_root_sector + i, 1, buff);
+	ctx->free_count = 0;
 
-			if (SUCCEEDED(hr)) {
-				memcpy(dst_buff + write_index, buff, root_bytes - write_index);
-			}
+	for (cluster=2; cluster<=last; cluster++) {
+		hr = fat16_fat_lookup(drv, cluster, &value);
+		if (FAILED(hr)) return hr;
 
-			/* Clean up */
-			kfree(buff);
-			if (FAILED(hr)) return hr;
+		if (value == 0) {
+			ctx->free_map[cluster / 32] |= 1u << (cluster % 32);
+			ctx->free_count++;
 		}
 	}
 
+	ctx->next_free = 2;
 	return S_OK;
 }
 
-
 /*
- * Opens a handle to a directory
+ * Reads the FAT32 FSInfo sector. Only the next free cluster hint is taken
+ * from it, since free clusters are counted at mount time anyway. Invalid
+ * FSInfo sectors are never written.
  */
-static HRESULT
-fat16_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out)
+static HRESULT fat16_read_fsinfo(K_FS_DRIVER *drv)
 {
 	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
-	FAT16_DIR_ENTRY		entry;
-	FAT16_DIR_ENTRY		*content = NULL;
-	uint32_t			max_entry_cnt;
-	uint32_t			content_size;
-	BOOL				is_root_dir;
+	FAT32_FSINFO		*info;
+	uint8_t				*buff;
 	HRESULT				hr;
 
-	is_root_dir = strlen(dirname) == 0 ? TRUE : FALSE;
-
-	if (!is_root_dir) {
-		/* Find target directory and read it's DIR ENTRY */
-		hr = fat16_parse_url(drv, dirname, &entry);
-		if (FAILED(hr)) return hr;
+	if (ctx->fs_type != FS_TYPE_FAT32 || ctx->fsinfo_sector == 0 || ctx->fsinfo_sector == 0xFFFF) {
+		ctx->fsinfo_sector = 0;
+		return S_OK;
+	}
 
-		/* Assert item is directory */
-		if ((entry.attributes & FAT_ATTR_DIRECTORY) == 0) {
-			//k_printf("not a directory\n");
-			return E_FAIL;
-		}
+	if (!(buff = kmalloc(ctx->bpb.bytes_per_sector))) {
+		return E_OUTOFMEM;
+	}
 
-		content_size = fat_count_chain(drv, fat_get_first_cluster(drv, &entry)) * ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster;
-		if (content_size == 0) {
-			/* Invalid starting cluster */
-			return E_FAIL;
-		}
+	hr = storage_read_blocks(ctx->storage_drv, ctx->fsinfo_sector, 1, buff);
+	if (FAILED(hr)) goto finally;
 
-		/* Allocate content buffer */
-		if (!(content = kmalloc(content_size))) {
-			return E_OUTOFMEM;
-		}
+	info = (FAT32_FSINFO*)buff;
 
-		/* Read content */
-		hr = fat16_read_file_content(drv, &entry, 0, content_size, content);
-		if (FAILED(hr)) goto fail;
+	if (info->lead_signature != FAT32_FSINFO_LEAD_SIG || info->struc_signature != FAT32_FSINFO_STRUC_SIG || info->trail_signature != FAT32_FSINFO_TRAIL_SIG) {
+		ctx->fsinfo_sector = 0;
+		goto finally;
+	}
 
-		/* Max entry count */
-		max_entry_cnt = content_size / sizeof(FAT16_DIR_ENTRY);
-	} else {
-		/* Allocate content buffer */
-		if (!(content = kmalloc(fat_get_rootdir_size(drv)))) {
-			return E_OUTOFMEM;
-		}
+	if (info->next_free >= 2 && info->next_free <= ctx->total_cluster_cnt + 1) {
+		ctx->next_free = info->next_free;
+	}
 
-		hr = fat16_read_rootdir_content(drv, content);
-		if (FAILED(hr)) goto fail;
+	/* Correct a stale free count on the next flush */
+	ctx->fsinfo_dirty = info->free_count != ctx->free_count ? TRUE : FALSE;
 
-		/* Max entry count */
-		max_entry_cnt = ctx->bpb.root_entries;
-	}
+finally:
+	kfree(buff);
+	return hr;
+}
 
-	/* Create new kernel directory stream */
-	K_DIR_STREAM *ds = kmalloc(sizeof(K_DIR_STREAM));
+/*
+ * Stores the free cluster count and the next free cluster hint in the FSInfo
+ * sector (FAT32 only).
+ */
+static HRESULT fat16_write_fsinfo(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT32_FSINFO		*info;
+	uint8_t				*buff;
+	HRESULT				hr;
 
-	/* Allocate string to hold name of the directory being opened */
-	if (!(ds->dirname = kmalloc(VFS_MAX_DIRNAME_LENGTH))) {
-		hr = E_OUTOFMEM;
-		goto fail;
+	if (ctx->fsinfo_sector == 0) {
+		ctx->fsinfo_dirty = FALSE;
+		return S_OK;
 	}
 
-	if (is_root_dir) {
-		ds->dirname[0] = '\0';
-	} else {
-		strcpy(ds->dirname, dirname);
+	if (!(buff = kmalloc(ctx->bpb.bytes_per_sector))) {
+		return E_OUTOFMEM;
 	}
 
-	ds->priv_data = content;
-	ds->len = max_entry_cnt;
-	ds->pos = 0;
-
-	/* Assign ops */
-	ds->readdir 	= fat16_readdir;
-	ds->rewinddir 	= fat16_rewinddir;
-	ds->closedir 	= fat16_closedir;
-
-	/* Success */
-	*out = ds;
+	hr = storage_read_blocks(ctx->storage_drv, ctx->fsinfo_sector, 1, buff);
+	if (FAILED(hr)) goto finally;
 
-	return S_OK;
+	info = (FAT32_FSINFO*)buff;
+	info->free_count	= ctx->free_count;
+	info->next_free		= ctx->next_free;
 
-fail:
-	if (content != NULL) {
-		kfree(content);
+	hr = storage_write_blocks(ctx->storage_drv, ctx->fsinfo_sector, 1, buff);
+	if (SUCCEEDED(hr)) {
+		ctx->fsinfo_dirty = FALSE;
 	}
 
+finally:
+	kfree(buff);
 	return hr;
 }
 
 /*
- * Reads the sub-item currently pointed by `dirstr`'s position. Then moves position
- * to the next one.
+ * Looks for `count` free clusters in a row, starting at `from` and wrapping
+ * around once. Returns the first cluster of the run, or 0 if there is none.
  */
-static HRESULT fat16_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info)
+static uint32_t fat_find_free_run(FAT16_DRV_CONTEXT *ctx, uint32_t from, uint32_t count)
 {
-	FAT16_DIR_ENTRY *entries = dirstr->priv_data;
-	FAT16_DIR_ENTRY *e;
+	uint32_t	last = ctx->total_cluster_cnt + 1;
+	uint32_t	cluster = from, start = 0, run = 0, scanned = 0;
 
-	while (dirstr->pos < dirstr->len) {
-		e = &entries[dirstr->pos];
+	if (cluster < 2 || cluster > last) {
+		cluster = 2;
+	}
 
-		if (e->filename[0] == 0xE5) {
-			/* Deleted sub-item. Skip */
-			goto skip;
+	/* Scan a bit further than once around, so runs crossing `from` are found */
+	while (scanned < ctx->total_cluster_cnt + count) {
+		if (cluster > last) {
+			/* Runs don't continue across the end */
+			cluster = 2;
+			run = 0;
 		}
 
-		if (e->filename[0] == 0x00) {
-			/* End of entry list */
-			dirstr->pos = dirstr->len;
-			break;
+		/* Skip whole words without free clusters */
+		if (cluster % 32 == 0 && ctx->free_map[cluster / 32] == 0 && cluster + 32 <= last) {
+			cluster += 32;
+			scanned += 32;
+			run = 0;
+			continue;
 		}
 
-		/* Skip volume labels */
-		if ((e->attributes & FAT_ATTR_VOLUMEL) != 0) {
-			goto skip;
+		if (fat_is_free(ctx, cluster)) {
+			if (run++ == 0) start = cluster;
+			if (run == count) return start;
+		} else {
+			run = 0;
 		}
 
-		/* Skip long filename entries */
-		if (e->attributes == 0x0F) {
-			goto skip;
-		}
+		cluster++;
+		scanned++;
+	}
 
-		/* Skip "." and ".." entries */
-		if (e->filename[0] == '.') {
-			if (e->filename[1] == ' ' || (e->filename[1] == '.' && e->filename[2] == ' ')) {
-				goto skip;
+	return 0;
+}
+
+/*
+ * Allocates `count` clusters, links them into a chain and appends it to the
+ * chain ending with `prev` (0 starts a new chain). A single run of free
+ * clusters is used if there is one, preferably right after `prev`, so the
+ * file stays contiguous. Otherwise the clusters are taken one by one.
+ * Must be called with the driver lock held.
+ */
+static HRESULT fat16_alloc_clusters(K_FS_DRIVER *drv, uint32_t prev, uint32_t count, uint32_t *first, uint32_t *last)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			eoc = fat_get_eoc(drv);
+	uint32_t			tail = prev, start, cluster, n;
+	HRESULT				hr = S_OK;
+
+	if (count == 0) {
+		return E_INVALIDARG;
+	}
+
+	if (count > ctx->free_count) {
+		/* Volume is full */
+		return E_BUFFEROVERFLOW;
+	}
+
+	start = fat_find_free_run(ctx, prev != 0 ? prev + 1 : ctx->next_free, count);
+	*first = 0;
+
+	for (n=0; n<count; n++) {
+		if (start != 0) {
+			cluster = start + n;
+		} else {
+			cluster = fat_find_free_run(ctx, tail != 0 ? tail + 1 : ctx->next_free, 1);
+			if (cluster == 0) {
+				hr = E_BUFFEROVERFLOW;
+				break;
 			}
 		}
 
-		/* Found */
-		fat_copy_short_filename(e, filename);
-		info->node_type = (e->attributes & FAT_ATTR_DIRECTORY) == 0 ? NODE_TYPE_FILE : NODE_TYPE_DIRECTORY;
-		info->size = e->size;
+		hr = fat16_fat_set(drv, cluster, eoc);
+		if (FAILED(hr)) break;
 
-		/* Move position */
-		dirstr->pos++;
+		if (tail != 0) {
+			hr = fat16_fat_set(drv, tail, cluster);
+			if (FAILED(hr)) break;
+		}
 
-		return S_OK;
+		if (*first == 0) *first = cluster;
+		tail = cluster;
+	}
 
-skip:
-		dirstr->pos++;
-		continue;
+	if (FAILED(hr) && *first != 0) {
+		/* Undo */
+		if (prev != 0) fat16_fat_set(drv, prev, eoc);
+		fat16_free_chain(drv, *first);
+		*first = 0;
 	}
 
-	return E_ENDOFSTR;
+	ctx->next_free = tail + 1;
+	ctx->chain_gen++;
+
+	if (last) *last = tail;
+	return hr;
 }
 
 /*
- * Rewinds the directory stream position.
+ * Frees all clusters of a chain. Must be called with the driver lock held.
  */
-static HRESULT fat16_rewinddir(K_DIR_STREAM *dirstr)
+static HRESULT fat16_free_chain(K_FS_DRIVER *drv, uint32_t first_cluster)
 {
-	dirstr->pos = 0;
-	return S_OK;
+	uint32_t	cluster = first_cluster, next;
+	HRESULT		hr = S_OK;
+
+	/* Freed clusters read as 0, so this stops on cyclic chains too */
+	while (cluster >= 2 && !fat_is_end_of_chain(drv, cluster)) {
+		hr = fat16_fat_lookup(drv, cluster, &next);
+		if (FAILED(hr)) break;
+
+		hr = fat16_fat_set(drv, cluster, 0);
+		if (FAILED(hr)) break;
+
+		cluster = next;
+	}
+
+	((FAT16_DRV_CONTEXT*)drv->priv_data)->chain_gen++;
+	return hr;
 }
 
 /*
- * Closes directory stream and deallocates it's related resources.
+ * Retrieves the last cluster and the length of a chain.
  */
-static HRESULT fat16_closedir(K_DIR_STREAM **dirstr)
+static HRESULT fat16_chain_last(K_FS_DRIVER *drv, uint32_t first_cluster, uint32_t *last, uint32_t *count)
 {
-	K_DIR_STREAM *d = *dirstr;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			cluster = first_cluster, next;
+	HRESULT				hr;
 
-	kfree(d->dirname);
+	*count = 0;
+	*last = 0;
 
-	if (d->priv_data) {
-		kfree(d->priv_data);
-	}
+	while (cluster >= 2 && !fat_is_end_of_chain(drv, cluster)) {
+		hr = fat16_fat_lookup(drv, cluster, &next);
+		if (FAILED(hr)) return hr;
 
-	kfree(d);
+		*last = cluster;
+		cluster = next;
+
+		/* Break out of defective (cyclic) chains */
+		if (++(*count) > ctx->total_cluster_cnt) {
+			return E_FAIL;
+		}
+	}
 
-	*dirstr = NULL;
 	return S_OK;
 }
 
 /*
- * Creates a directory.
+ * Fills a cluster with zeros.
  */
-static HRESULT fat16_mkdir(K_FS_DRIVER *drv, char *path, uint32_t mode)
+static HRESULT fat16_zero_cluster(K_FS_DRIVER *drv, uint32_t cluster)
 {
-	UNUSED_ARG(drv);
-	UNUSED_ARG(path);
-	UNUSED_ARG(mode);
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			spc = ctx->bpb.sectors_per_cluster;
+	uint8_t				*buff;
+	HRESULT				hr;
 
-	return E_NOTIMPL;
-}
+	if (!(buff = kcalloc(spc * ctx->bpb.bytes_per_sector))) {
+		return E_OUTOFMEM;
+	}
 
-/*
- * Creates an empty file.
- */
-static HRESULT fat16_create(K_FS_DRIVER *drv, char *filename, uint32_t perm)
-{
-	UNUSED_ARG(drv);
-	UNUSED_ARG(filename);
-	UNUSED_ARG(perm);
+	hr = storage_write_blocks(ctx->storage_drv, ctx->first_data_sector + (cluster - 2) * spc, spc, buff);
 
-	return E_NOTIMPL;
+	kfree(buff);
+	return hr;
 }
 
 /*
- * Opens handle to a file stream.
+ * Maps the next extent of the chain, following the last mapped one.
+ * Returns E_ENDOFSTR if the chain is fully mapped.
  */
-static HRESULT fat16_open(K_FS_DRIVER *drv, char *filename, uint32_t flags, K_STREAM **out)
+static HRESULT fat16_extent_extend(K_FS_DRIVER *drv, FAT16_EXTENT_MAP *map)
 {
-	FAT16_DIR_ENTRY			entry;
-	FAT16_STR_CONTEXT 		*strctx = NULL;
-	K_STREAM 				*stream = NULL;
-	HRESULT					hr;
-
-	/* Find target directory and read it's DIR ENTRY */
-	hr = fat16_parse_url(drv, filename, &entry);
-	if (FAILED(hr)) return hr;
+	FAT16_EXTENT	*ext;
+	uint32_t		cluster_id = map->next_cluster;
+	uint32_t		next_id, length = 1;
+	HRESULT			hr;
 
-	/* Assert item is a file */
-	if ((entry.attributes & (FAT_ATTR_DIRECTORY | FAT_ATTR_VOLUMEL)) != 0) {
-		return E_FAIL;
+	if (cluster_id < 2 || fat_is_end_of_chain(drv, cluster_id)) {
+		return E_ENDOFSTR;
 	}
 
-	/* Create new file stream */
-	if (!(stream = kcalloc(sizeof(K_STREAM)))) {
-		hr = E_OUTOFMEM;
-		goto fail;
-	}
+	/* Follow the chain while it's contiguous */
+	for (;;) {
+		hr = fat16_fat_lookup(drv, cluster_id, &next_id);
+		if (FAILED(hr)) return E_FAIL;
 
-	if (!(strctx = kcalloc(sizeof(FAT16_STR_CONTEXT)))) {
-		hr = E_OUTOFMEM;
-		goto fail;
-	}
+		if (next_id != cluster_id + 1) {
+			break;
+		}
 
-	/* Setup stream. No need to set cache params since they
-	 * are initially zeroed. */
-	stream->mode = flags;
-	stream->fs_driver = drv;
-	stream->priv_data = strctx;
+		cluster_id = next_id;
+		length++;
+	}
 
-	memcpy(&strctx->entry, &entry, sizeof(FAT16_DIR_ENTRY));
+	if (map->count == map->capacity) {
+		uint32_t cap = map->capacity ? map->capacity * 2 : FAT_EXTENT_MAP_INITIAL;
 
-	/* Create mutex */
-	mutex_create(&stream->lock);
+		if (!(ext = krealloc(map->extents, cap * sizeof(FAT16_EXTENT)))) {
+			return E_OUTOFMEM;
+		}
 
-	/* Assign file ops */
-	stream->read 	= fat16_file_read;
-	stream->write 	= fat16_file_write;
-	stream->ioctl	= fat16_file_ioctl;
-	stream->seek	= fat16_file_seek;
-	stream->tell	= fat16_file_tell;
-	stream->close	= fat16_file_close;
+		map->extents = ext;
+		map->capacity = cap;
+	}
 
-	/* Success */
-	*out = stream;
-	return S_OK;
+	ext = &map->extents[map->count++];
+	ext->file_cluster	= map->clusters;
+	ext->cluster		= map->next_cluster;
+	ext->length			= length;
 
-fail:
-	if (stream) kfree(stream);
-	if (strctx) kfree(strctx);
+	map->clusters		+= length;
+	map->next_cluster	= next_id;
 
-	return hr;
+	return S_OK;
 }
 
 /*
- * Closes file stream and frees it's related resources.
+ * Finds the extent holding the `file_cluster`-th cluster of the file,
+ * mapping the chain up to it if needed.
  */
-static HRESULT fat16_file_close(K_STREAM **str)
+static HRESULT fat16_extent_find(K_FS_DRIVER *drv, FAT16_EXTENT_MAP *map, uint32_t file_cluster, uint32_t *index)
 {
-	K_STREAM 			*s = *str;
-	FAT16_STR_CONTEXT 	*strctx = s->priv_data;
-
-	/* Free mutex */
-	mutex_destroy(&s->lock);
+	uint32_t	lo = 0, hi, mid;
+	HRESULT		hr;
 
-	/* Free cache buffer*/
-	if (strctx->cache_buff) {
-		kfree(strctx->cache_buff);
+	while (file_cluster >= map->clusters) {
+		hr = fat16_extent_extend(drv, map);
+		if (FAILED(hr)) return hr;
 	}
 
-	/* Free private data and stream itself */
-	kfree(s->priv_data);
-	kfree(s);
+	/* Extents are ordered by file_cluster */
+	hi = map->count - 1;
 
-	*str = NULL;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+
+		if (map->extents[mid].file_cluster <= file_cluster) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	*index = lo;
 	return S_OK;
 }
 
 /*
- * Reads non-sector-aligned memory blocks from a file stream.
+ * Reads (or writes) `count` bytes of the content of a file starting from the
+ * `start`-th byte. Start address and count have to be multiple of the sector
+ * size. Written content has to be allocated already.
+ *
+ * The clusters are located through the extent map `map`, which is extended as
+ * far as the transfer reaches, and rebuilt if the chain has changed since.
+ * Each run of contiguous clusters is transferred with a single request. If
+ * `map` is NULL, a temporary map is used.
+ *
+ * Note that directories are also considered files holding an array of
+ * `FAT16_DIR_ENTRY` structs.
  */
-static HRESULT fat16_read_subblock(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t size, void *dst)
+static HRESULT fat16_file_content_io(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *buf, BOOL write)
 {
-	FAT16_STR_CONTEXT 	*sc 		= s->priv_data;
-	K_FS_DRIVER			*drv 		= s->fs_driver;
-	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
-	uint32_t			write_index	= 0;
-	uint32_t			read_index  = start_addr;
-	uint32_t			block_size	= ctx->bpb.bytes_per_sector;
-	uint8_t				*dst_buff 	= dst;
-	uint32_t			block_count;
-	HRESULT				hr;
+	FAT16_DRV_CONTEXT 	*ctx 			= drv->priv_data;
+	HRESULT				hr				= S_OK;
+	uint32_t			skip_sectors	= start / ctx->bpb.bytes_per_sector;
+	uint32_t			remaining		= count / ctx->bpb.bytes_per_sector;
+	uint32_t			spc				= ctx->bpb.sectors_per_cluster;
+	uint8_t				*buff			= buf;
+	uint32_t			index			= 0;
+	uint32_t			file_cluster, offset, run, sector, i;
+	FAT16_EXTENT_MAP	temp;
+	FAT16_EXTENT		ext;
 
-	/* Check if requested sub-block is already cached */
-	if (!sc->cache_invalid && start_addr >= sc->cache_start_addr && start_addr <= (sc->cache_start_addr + sc->cache_size)) {
-		uint32_t cache_offs = start_addr - sc->cache_start_addr;
+	/* Validate input arguments */
+	if (start % ctx->bpb.bytes_per_sector != 0 || count % ctx->bpb.bytes_per_sector != 0) {
+		return E_INVALIDARG;
+	}
 
-		if ((start_addr+size) <= (sc->cache_start_addr + sc->cache_size)) {
-			/* Fully cached (cache hit) */
-			memcpy(dst_buff, sc->cache_buff + cache_offs, size);
-			return S_OK;
+	if (map == NULL || !fat16_extents_enabled) {
+		fat_extent_map_init(&temp, first_cluster);
+		map = &temp;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	if (map->first_cluster != first_cluster || map->generation != ctx->chain_gen) {
+		/* Chain has changed since the map was built */
+		fat_extent_map_free(map);
+		fat_extent_map_init(map, first_cluster);
+	}
+
+	map->generation = ctx->chain_gen;
+	mutex_unlock(&ctx->lock);
+
+	file_cluster	= skip_sectors / spc;
+	skip_sectors	%= spc;
+
+	while (remaining > 0) {
+		/* The array may move while the map grows, so copy the extent */
+		mutex_lock(&ctx->lock);
+
+		hr = fat16_extent_find(drv, map, file_cluster, &i);
+		if (SUCCEEDED(hr)) {
+			ext = map->extents[i];
 		}
-		else {
-			/* Partially cached (beginning part overlaps) */
-			memcpy(dst_buff, sc->cache_buff + cache_offs, sc->cache_size - cache_offs);
 
-			write_index = sc->cache_size - cache_offs;
-			read_index	+= write_index;
-			size 		-= write_index;
+		mutex_unlock(&ctx->lock);
+
+		if (FAILED(hr)) {
+			hr = E_FAIL;
+			goto finally;
 		}
-	}
 
-	/* Since we got here, this is a cache miss.
-	 *
-	 * If first block is not aligned read it in separate manner. So the
-	 * remaining blocks (if any) will be block-aligned.
-	 */
-	if (read_index % block_size != 0) {
-		uint32_t offs = read_index % ctx->bpb.bytes_per_sector;
+		offset	= file_cluster - ext.file_cluster;
+		sector	= ctx->first_data_sector + (ext.cluster - 2 + offset) * spc + skip_sectors;
+		run		= (ext.length - offset) * spc - skip_sectors;
 
-		hr = fat16_cache_blocks(s, entry, read_index - offs, 1);
-		if (FAILED(hr)) return hr;
+		if (run > remaining) run = remaining;
 
-		/* Copy sub-block to destination buffer */
-		memcpy(dst_buff + write_index, sc->cache_buff + offs, block_size - offs);
+		if (write) {
+			hr = storage_write_blocks(ctx->storage_drv, sector, run, buff + index);
+		} else {
+			hr = storage_read_blocks(ctx->storage_drv, sector, run, buff + index);
+		}
+		if (FAILED(hr)) goto finally;
 
-		write_index += block_size - offs;
-		read_index += block_size - offs;
-		size -= block_size - offs;
+		index += run * ctx->bpb.bytes_per_sector;
+		remaining -= run;
+
+		file_cluster = ext.file_cluster + ext.length;
+		skip_sectors = 0;
 	}
 
 	/* Sanity check */
-	if (read_index % block_size != 0) {
-		HalKernelPanic("fat16_read_subblock(): unexpected.");
-		return E_FAIL;
+	if (index != count) {
+		k_printf("index=%d; count=%d\n", index, count);
+		HalKernelPanic("fat16_file_content_io(): Unexpected.");
 	}
 
-	/* Calculate the remaining _aligned_ block count. */
-	block_count = size / block_size;
+finally:
+	if (map == &temp) {
+		fat_extent_map_free(&temp);
+	}
 
-	/* Read aligned blocks */
-	hr = fat16_read_file_content(drv, entry, read_index, block_count * block_size, dst_buff + write_index);
-	if (FAILED(hr)) return hr;
+	return hr;
+}
 
-	/* Move read and write indices */
-	read_index += block_count * block_size;
-	write_index += block_count * block_size;
-	size -= block_count * block_size;
+static HRESULT fat16_read_file_content(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *dst)
+{
+	return fat16_file_content_io(drv, first_cluster, map, start, count, dst, FALSE);
+}
 
-	/* Sanity check */
-	if (size >= block_size) {
-		HalKernelPanic("fat16_read_subblock(): unexpected(2).");
-		return E_FAIL;
-	}
+static HRESULT fat16_write_file_content(K_FS_DRIVER *drv, uint32_t first_cluster, FAT16_EXTENT_MAP *map, uint32_t start, uint32_t count, void *src)
+{
+	return fat16_file_content_io(drv, first_cluster, map, start, count, src, TRUE);
+}
 
-	/* Read last _unaligned_ block (if remained). As first unaligned block,
-	 * this too requires different treatment.
-	 */
-	if (size > 0) {
-		/* Cache whole block */
-		hr = fat16_cache_blocks(s, entry, read_index, 1);
-		if (FAILED(hr)) return hr;
+/*
+ * Reads the content of the FAT12/16 "root dir", which holds an array
+ * of DIR ENTRIES for files and directories residing in the root file system
+ * directory.
+ *
+ * It is not possible to retrieve parts of the root dir content.
+ */
+static HRESULT fat16_read_rootdir_content(K_FS_DRIVER *drv, void *dst)
+{
+	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
+	uint32_t			root_bytes 	= fat_get_rootdir_size(drv);
+	uint32_t			root_sectors= (root_bytes + ctx->bpb.bytes_per_sector - 1) / ctx->bpb.bytes_per_sector;
+	uint32_t			write_index = 0;
+	uint8_t				*dst_buff	= dst; //use uint8_t* for pointer arithmetics
+	uint32_t			i;
+	uint8_t				*buff;
+	HRESULT				hr;
 
-		/* Write it to destination buffer */
-		memcpy(dst_buff + write_index, sc->cache_buff, size);
+	for (i=0; i<root_sectors; i++) {
+		if (root_bytes - write_index >= ctx->bpb.bytes_per_sector) {
+			/* Read sector directly to destination buffer */
+			hr = storage_read_blocks(ctx->storage_drv, ctx->first_root_sector + i, 1, dst_buff + write_index);
+			if (FAILED(hr)) return hr;
+
+			write_index += ctx->bpb.bytes_per_sector;
+		} else {
+			/* Read sector through temporary buffer, since we have no guarantee that
+			 * destination buffer can accommodate more that `root_bytes` bytes.
+			 */
+			buff = kmalloc(ctx->bpb.bytes_per_sector);
+			hr = storage_read_blocks(ctx->storage_drv, ctx->first_root_sector + i, 1, buff);
+
+			if (SUCCEEDED(hr)) {
+				memcpy(dst_buff + write_index, buff, root_bytes - write_index);
+			}
+
+			/* Clean up */
+			kfree(buff);
+			if (FAILED(hr)) return hr;
+		}
 	}
 
-	/* Success */
 	return S_OK;
 }
 
+
 /*
- * Reads `block_cnt` blocks from the content of a file/directory and stores them
- * in the cache buffer.
+ * Reads all entries of the directory starting at `dir_cluster` (0 for the
+ * FAT12/16 root directory) into a newly allocated array.
  */
-static HRESULT fat16_cache_blocks(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t block_cnt)
+static HRESULT fat16_read_dir(K_FS_DRIVER *drv, uint32_t dir_cluster, FAT16_DIR_ENTRY **out, uint32_t *count)
 {
-	FAT16_STR_CONTEXT 	*sc			= s->priv_data;
-	K_FS_DRIVER			*drv 		= s->fs_driver;
-	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
-	uint32_t			block_size	= ctx->bpb.bytes_per_sector;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_ENTRY		*content;
+	uint32_t			content_size;
 	HRESULT				hr;
 
-	/* Validate input arguments */
-	if (start_addr % block_size != 0 || block_cnt == 0) {
-		return E_INVALIDARG;
+	if (dir_cluster == 0) {
+		content_size = fat_get_rootdir_size(drv);
+	} else {
+		content_size = fat_count_chain(drv, dir_cluster) * ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster;
 	}
 
-	/* Assert cache buffer is big enough */
-	if (sc->cache_cap < block_cnt * block_size) {
-		if (sc->cache_buff) {
+	if (content_size == 0) {
+		/* Invalid starting cluster */
+		return E_FAIL;
+	}
+
+	/* Allocate content buffer */
+	if (!(content = kmalloc(content_size))) {
+		return E_OUTOFMEM;
+	}
+
+	if (dir_cluster == 0) {
+		hr = fat16_read_rootdir_content(drv, content);
+	} else {
+		hr = fat16_read_file_content(drv, dir_cluster, NULL, 0, content_size, content);
+	}
+
+	if (FAILED(hr)) {
+		kfree(content);
+		return hr;
+	}
+
+	*out = content;
+	*count = content_size / sizeof(FAT16_DIR_ENTRY);
+
+	return S_OK;
+}
+
+/*
+ * Writes `count` entries to the directory starting at `dir_cluster` (0 for the
+ * FAT12/16 root directory), beginning with the `index`-th entry. Sectors are
+ * read, modified and written back through the buffer cache.
+ */
+static HRESULT fat16_write_dir_entries(K_FS_DRIVER *drv, uint32_t dir_cluster, uint32_t index, uint32_t count, FAT16_DIR_ENTRY *entries)
+{
+	FAT16_DRV_CONTEXT 	*ctx 			= drv->priv_data;
+	uint32_t			bps				= ctx->bpb.bytes_per_sector;
+	uint32_t			cluster_size	= bps * ctx->bpb.sectors_per_cluster;
+	uint32_t			offset			= index * sizeof(FAT16_DIR_ENTRY);
+	uint32_t			end				= offset + count * sizeof(FAT16_DIR_ENTRY);
+	uint8_t				*src			= (uint8_t*)entries;
+	uint32_t			sector, in_sector, n, i;
+	FAT16_EXTENT_MAP	map;
+	FAT16_EXTENT		*ext;
+	uint8_t				*buff;
+	HRESULT				hr = S_OK;
+
+	if (dir_cluster == 0 && end > fat_get_rootdir_size(drv)) {
+		return E_INVALIDARG;
+	}
+
+	if (!(buff = kmalloc(bps))) {
+		return E_OUTOFMEM;
+	}
+
+	fat_extent_map_init(&map, dir_cluster);
+
+	while (offset < end) {
+		in_sector = offset % bps;
+		n = bps - in_sector;
+		if (n > end - offset) n = end - offset;
+
+		if (dir_cluster == 0) {
+			sector = ctx->first_root_sector + offset / bps;
+		} else {
+			hr = fat16_extent_find(drv, &map, offset / cluster_size, &i);
+			if (FAILED(hr)) break;
+
+			ext		= &map.extents[i];
+			sector	= ctx->first_data_sector + (ext->cluster - 2 + offset / cluster_size - ext->file_cluster) * ctx->bpb.sectors_per_cluster + (offset % cluster_size) / bps;
+		}
+
+		hr = storage_read_blocks(ctx->storage_drv, sector, 1, buff);
+		if (FAILED(hr)) break;
+
+		memcpy(buff + in_sector, src, n);
+
+		hr = storage_write_blocks(ctx->storage_drv, sector, 1, buff);
+		if (FAILED(hr)) break;
+
+		src += n;
+		offset += n;
+	}
+
+	fat_extent_map_free(&map);
+	kfree(buff);
+
+	return hr;
+}
+
+/* Byte offsets of the characters within a long filename entry */
+static const uint8_t fat_lfn_char_offsets[FAT_LFN_CHARS] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+/*
+ * Checksum of the short name of an entry, which is stored in it's long
+ * filename entries.
+ */
+static uint8_t fat_lfn_checksum(FAT16_DIR_ENTRY *entry)
+{
+	uint8_t		sum = 0;
+	uint32_t	i;
+
+	for (i=0; i<11; i++) {
+		sum = ((sum & 1) << 7) + (sum >> 1) + (i < 8 ? entry->filename[i] : entry->ext[i - 8]);
+	}
+
+	return sum;
+}
+
+/*
+ * Finds the next file or directory in `entries`, starting at `*pos`, and
+ * retrieves it's name. That is the long filename if there is a valid one,
+ * otherwise the short name. Deleted entries, volume labels and the "." and
+ * ".." entries are skipped.
+ *
+ * On success `*pos` is the index of the entry and `*lfn_index` the index of
+ * it's first long filename entry. `name` has to hold MAX_FILENAME_LENGTH
+ * characters, longer names are returned as short names. Non-ASCII characters
+ * are only supported up to U+00FF.
+ */
+static HRESULT fat_dir_next(FAT16_DIR_ENTRY *entries, uint32_t count, uint32_t *pos, uint32_t *lfn_index, char *name)
+{
+	FAT16_DIR_ENTRY		*e;
+	FAT_LFN_ENTRY		*lfn;
+	uint8_t				*raw;
+	uint32_t			i, j, seq, k, expected = 0, lfn_start = 0, len = 0;
+	uint8_t				checksum = 0;
+	uint16_t			c;
+
+	for (i=*pos; i<count; i++) {
+		e = &entries[i];
+
+		if (e->filename[0] == 0x00) {
+			/* End of entry list */
+			break;
+		}
+
+		if (e->filename[0] == 0xE5) {
+			/* Deleted sub-item */
+			expected = 0;
+			continue;
+		}
+
+		if (e->attributes == FAT_ATTR_LFN) {
+			lfn = (FAT_LFN_ENTRY*)e;
+			raw = (uint8_t*)e;
+			seq = lfn->order & 0x1F;
+
+			if ((lfn->order & FAT_LFN_LAST) != 0) {
+				/* The first entry on disk holds the end of the name */
+				expected	= seq;
+				checksum	= lfn->checksum;
+				lfn_start	= i;
+				len			= seq * FAT_LFN_CHARS;
+			} else if (expected == 0 || seq != expected - 1 || lfn->checksum != checksum) {
+				/* Orphaned or out of sequence */
+				expected = 0;
+				continue;
+			} else {
+				expected = seq;
+			}
+
+			if (seq == 0 || (seq - 1) * FAT_LFN_CHARS >= MAX_FILENAME_LENGTH - 1) {
+				/* Invalid, or too long for us */
+				expected = 0;
+				continue;
+			}
+
+			for (j=0; j<FAT_LFN_CHARS; j++) {
+				c = raw[fat_lfn_char_offsets[j]] | (raw[fat_lfn_char_offsets[j] + 1] << 8);
+				k = (seq - 1) * FAT_LFN_CHARS + j;
+
+				if (c == 0x0000) {
+					len = k;
+					break;
+				}
+
+				if (k < MAX_FILENAME_LENGTH - 1) {
+					name[k] = c <= 0xFF ? (char)c : '?';
+				}
+			}
+
+			if (len >= MAX_FILENAME_LENGTH) {
+				expected = 0;
+			}
+
+			continue;
+		}
+
+		/* Skip volume labels */
+		if ((e->attributes & FAT_ATTR_VOLUMEL) != 0) {
+			expected = 0;
+			continue;
+		}
+
+		/* Skip "." and ".." entries */
+		if (e->filename[0] == '.') {
+			if (e->filename[1] == ' ' || (e->filename[1] == '.' && e->filename[2] == ' ')) {
+				expected = 0;
+				continue;
+			}
+		}
+
+		/* Found */
+		if (expected == 1 && checksum == fat_lfn_checksum(e)) {
+			name[len] = '\0';
+			*lfn_index = lfn_start;
+		} else {
+			fat_copy_short_filename(e, name);
+			*lfn_index = i;
+		}
+
+		*pos = i;
+		return S_OK;
+	}
+
+	*pos = count;
+	return E_ENDOFSTR;
+}
+
+/*
+ * Tests if `name` can be stored as a long filename.
+ */
+static BOOL fat_is_valid_name(char *name)
+{
+	uint32_t	len = strlen(name);
+	uint32_t	i;
+
+	if (len == 0 || len >= MAX_FILENAME_LENGTH) {
+		return FALSE;
+	}
+
+	if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+		return FALSE;
+	}
+
+	for (i=0; i<len; i++) {
+		uint8_t c = name[i];
+
+		if (c < 0x20 || c == '"' || c == '*' || c == '/' || c == ':' || c == '<' || c == '>' || c == '?' || c == '\\' || c == '|') {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * Tests if a character may appear in a short name (in any case).
+ */
+static BOOL fat_is_short_char(char c)
+{
+	static const char specials[] = "!#$%&'()-@^_`{}~";
+	uint32_t i;
+
+	if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+		return TRUE;
+	}
+
+	for (i=0; specials[i] != '\0'; i++) {
+		if (specials[i] == c) return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Copies `len` characters of a short name part in upper case. Fails for
+ * invalid characters and mixed case. Lower case parts are flagged with
+ * `lower_flag` in the NT flags of `entry`.
+ */
+static BOOL fat_copy_short_part(char *src, uint32_t len, uint8_t *dst, FAT16_DIR_ENTRY *entry, uint8_t lower_flag)
+{
+	BOOL		upper = FALSE, lower = FALSE;
+	uint32_t	i;
+	char		c;
+
+	for (i=0; i<len; i++) {
+		c = src[i];
+
+		if (!fat_is_short_char(c)) {
+			return FALSE;
+		}
+
+		if (c >= 'a' && c <= 'z') {
+			lower = TRUE;
+			c = c - 'a' + 'A';
+		} else if (c >= 'A' && c <= 'Z') {
+			upper = TRUE;
+		}
+
+		dst[i] = c;
+	}
+
+	if (upper && lower) {
+		return FALSE;
+	}
+
+	if (lower) {
+		entry->reserved |= lower_flag;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Stores `name` as the short name of `entry`, if it is a valid 8.3 name.
+ * Lower case names are recorded with the NT case flags, like Windows NT does.
+ * Returns FALSE if the name needs long filename entries.
+ */
+static BOOL fat_make_short_name(char *name, FAT16_DIR_ENTRY *entry)
+{
+	char		*dot = strrchr(name, '.');
+	uint32_t	base_len = dot ? (uint32_t)(dot - name) : strlen(name);
+	uint32_t	ext_len = dot ? strlen(dot + 1) : 0;
+
+	memset(entry->filename, ' ', 8);
+	memset(entry->ext, ' ', 3);
+	entry->reserved = 0;
+
+	if (base_len == 0 || base_len > 8 || ext_len > 3 || (dot && ext_len == 0)) {
+		return FALSE;
+	}
+
+	if (!fat_copy_short_part(name, base_len, entry->filename, entry, FAT_NT_LOWER_BASE)) {
+		return FALSE;
+	}
+
+	if (dot && !fat_copy_short_part(dot + 1, ext_len, entry->ext, entry, FAT_NT_LOWER_EXT)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Tests if a short name is used by any of the `count` entries.
+ */
+static BOOL fat_short_name_exists(FAT16_DIR_ENTRY *entries, uint32_t count, FAT16_DIR_ENTRY *entry)
+{
+	uint32_t i, j;
+
+	for (i=0; i<count; i++) {
+		if (entries[i].filename[0] == 0x00) break;
+		if (entries[i].filename[0] == 0xE5 || entries[i].attributes == FAT_ATTR_LFN) continue;
+
+		for (j=0; j<8 && entries[i].filename[j] == entry->filename[j]; j++);
+		if (j < 8) continue;
+
+		for (j=0; j<3 && entries[i].ext[j] == entry->ext[j]; j++);
+		if (j == 3) return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Generates a short alias (BASE~N.EXT) for a long filename, unique among the
+ * `count` entries of the directory, and stores it in `entry`.
+ */
+static HRESULT fat_make_short_alias(char *name, FAT16_DIR_ENTRY *entries, uint32_t count, FAT16_DIR_ENTRY *entry)
+{
+	uint8_t		base[8], ext[3];
+	uint32_t	base_len = 0, ext_len = 0, digits, keep, n, i;
+	char		*dot = strrchr(name, '.');
+	char		*p;
+
+	/* A leading dot doesn't start an extension */
+	if (dot == name) dot = NULL;
+
+	/* Invalid characters become '_', spaces and dots are dropped */
+	for (p=name; *p != '\0' && p != dot; p++) {
+		if (base_len < 8 && *p != ' ' && *p != '.') {
+			base[base_len++] = !fat_is_short_char(*p) ? '_' : (*p >= 'a' && *p <= 'z') ? *p - 'a' + 'A' : *p;
+		}
+	}
+
+	for (p=dot ? dot + 1 : ""; *p != '\0'; p++) {
+		if (ext_len < 3 && *p != ' ' && *p != '.') {
+			ext[ext_len++] = !fat_is_short_char(*p) ? '_' : (*p >= 'a' && *p <= 'z') ? *p - 'a' + 'A' : *p;
+		}
+	}
+
+	if (base_len == 0) {
+		base[base_len++] = '_';
+	}
+
+	entry->reserved = 0;
+
+	for (n=1; n<=FAT_ALIAS_MAX; n++) {
+		for (digits=0, i=n; i>0; i/=10) digits++;
+
+		/* "~N" replaces the end of the base name if needed */
+		keep = base_len < 7 - digits ? base_len : 7 - digits;
+
+		memset(entry->filename, ' ', 8);
+		memset(entry->ext, ' ', 3);
+		memcpy(entry->filename, base, keep);
+		memcpy(entry->ext, ext, ext_len);
+
+		entry->filename[keep] = '~';
+		for (i=n, p=(char*)&entry->filename[keep + digits]; i>0; i/=10, p--) {
+			*p = '0' + i % 10;
+		}
+
+		if (!fat_short_name_exists(entries, count, entry)) {
+			return S_OK;
+		}
+	}
+
+	return E_FAIL;
+}
+
+/*
+ * Adds an entry named `name` to the directory starting at `dir_cluster`. The
+ * short name, NT case flags and long filename entries are generated, the
+ * remaining fields are taken from `entry`. If there are not enough free
+ * slots, the directory is extended (the FAT12/16 root directory can't be).
+ * Must be called with the driver lock held.
+ */
+static HRESULT fat16_dir_add(K_FS_DRIVER *drv, uint32_t dir_cluster, char *name, FAT16_DIR_ENTRY *entry, FAT16_DIR_LOC *out)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_ENTRY		*entries = NULL, *slots = NULL;
+	FAT16_DIR_ENTRY		short_entry = *entry;
+	FAT_LFN_ENTRY		*lfn;
+	uint8_t				*raw;
+	uint32_t			name_len = strlen(name);
+	uint32_t			count, lfn_count = 0, slot_count, start = 0, run = 0;
+	uint32_t			per_cluster, clusters, last, first_new, chain_len, i, j, k;
+	uint16_t			c;
+	uint8_t				checksum;
+	HRESULT				hr;
+
+	if (!fat_is_valid_name(name)) {
+		return E_INVALIDARG;
+	}
+
+	hr = fat16_read_dir(drv, dir_cluster, &entries, &count);
+	if (FAILED(hr)) return hr;
+
+	/* Valid 8.3 names don't need long filename entries */
+	if (!fat_make_short_name(name, &short_entry)) {
+		hr = fat_make_short_alias(name, entries, count, &short_entry);
+		if (FAILED(hr)) goto finally;
+
+		lfn_count = (name_len + FAT_LFN_CHARS - 1) / FAT_LFN_CHARS;
+	}
+
+	slot_count = lfn_count + 1;
+
+	/* Find a run of free slots. Everything past the end marker is free. */
+	for (i=0; i<count && run < slot_count; i++) {
+		if (entries[i].filename[0] == 0x00 || entries[i].filename[0] == 0xE5) {
+			if (run++ == 0) start = i;
+		} else {
+			run = 0;
+		}
+	}
+
+	if (run < slot_count) {
+		if (dir_cluster == 0) {
+			/* Root directory is full */
+			hr = E_BUFFEROVERFLOW;
+			goto finally;
+		}
+
+		/* Extend the directory by zeroed clusters, continuing the free run
+		 * at it's end */
+		if (run == 0) start = count;
+
+		per_cluster = ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster / sizeof(FAT16_DIR_ENTRY);
+		clusters = (slot_count - run + per_cluster - 1) / per_cluster;
+
+		hr = fat16_chain_last(drv, dir_cluster, &last, &chain_len);
+		if (FAILED(hr)) goto finally;
+
+		hr = fat16_alloc_clusters(drv, last, clusters, &first_new, NULL);
+		if (FAILED(hr)) goto finally;
+
+		for (i=0, k=first_new; i<clusters; i++) {
+			hr = fat16_zero_cluster(drv, k);
+			if (FAILED(hr)) goto finally;
+
+			if (i + 1 < clusters) {
+				hr = fat16_fat_lookup(drv, k, &k);
+				if (FAILED(hr)) goto finally;
+			}
+		}
+	}
+
+	if (!(slots = kcalloc(slot_count * sizeof(FAT16_DIR_ENTRY)))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	/* Long filename entries, in reverse order */
+	checksum = fat_lfn_checksum(&short_entry);
+
+	for (i=0; i<lfn_count; i++) {
+		uint32_t seq = lfn_count - i;
+
+		lfn = (FAT_LFN_ENTRY*)&slots[i];
+		raw = (uint8_t*)&slots[i];
+
+		lfn->order		= seq | (i == 0 ? FAT_LFN_LAST : 0);
+		lfn->attributes	= FAT_ATTR_LFN;
+		lfn->checksum	= checksum;
+
+		/* Name is terminated by 0x0000 and padded with 0xFFFF */
+		for (j=0; j<FAT_LFN_CHARS; j++) {
+			k = (seq - 1) * FAT_LFN_CHARS + j;
+			c = k < name_len ? (uint8_t)name[k] : k == name_len ? 0x0000 : 0xFFFF;
+
+			raw[fat_lfn_char_offsets[j]]		= c & 0xFF;
+			raw[fat_lfn_char_offsets[j] + 1]	= c >> 8;
+		}
+	}
+
+	slots[lfn_count] = short_entry;
+
+	hr = fat16_write_dir_entries(drv, dir_cluster, start, slot_count, slots);
+	if (FAILED(hr)) goto finally;
+
+	out->entry			= short_entry;
+	out->dir_cluster	= dir_cluster;
+	out->index			= start + lfn_count;
+	out->lfn_index		= start;
+
+	/* Drop negative entries, for the long name as well as the alias */
+	fat16_dir_changed(drv, dir_cluster);
+
+finally:
+	if (slots) kfree(slots);
+	kfree(entries);
+
+	return hr;
+}
+
+/*
+ * Marks an entry and it's long filename entries deleted. Must be called with
+ * the driver lock held.
+ */
+static HRESULT fat16_dir_remove(K_FS_DRIVER *drv, FAT16_DIR_LOC *loc)
+{
+	FAT16_DIR_ENTRY		*entries;
+	uint32_t			count, i;
+	HRESULT				hr;
+
+	hr = fat16_read_dir(drv, loc->dir_cluster, &entries, &count);
+	if (FAILED(hr)) return hr;
+
+	if (loc->index >= count || loc->lfn_index > loc->index) {
+		kfree(entries);
+		return E_INVALIDARG;
+	}
+
+	for (i=loc->lfn_index; i<=loc->index; i++) {
+		entries[i].filename[0] = 0xE5;
+	}
+
+	hr = fat16_write_dir_entries(drv, loc->dir_cluster, loc->lfn_index, loc->index - loc->lfn_index + 1, &entries[loc->lfn_index]);
+	kfree(entries);
+
+	fat16_dir_changed(drv, loc->dir_cluster);
+	return hr;
+}
+
+/*
+ * Returns S_OK if a directory has no sub-items.
+ */
+static HRESULT fat16_dir_is_empty(K_FS_DRIVER *drv, uint32_t dir_cluster)
+{
+	FAT16_DIR_ENTRY		*entries;
+	char				name[MAX_FILENAME_LENGTH];
+	uint32_t			count, pos = 0, lfn_index;
+	HRESULT				hr;
+
+	hr = fat16_read_dir(drv, dir_cluster, &entries, &count);
+	if (FAILED(hr)) return hr;
+
+	hr = fat_dir_next(entries, count, &pos, &lfn_index, name);
+	kfree(entries);
+
+	return hr == E_ENDOFSTR ? S_OK : E_INVALIDSTATE;
+}
+
+/*
+ * Fails if the directory starting at `dir_cluster` is `ancestor`, or lies
+ * somewhere below it. The ".." entries are followed up to the root.
+ */
+static HRESULT fat16_check_not_below(K_FS_DRIVER *drv, uint32_t dir_cluster, uint32_t ancestor)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_ENTRY		*entries;
+	uint32_t			count, depth = 0;
+	HRESULT				hr;
+
+	while (dir_cluster != 0 && dir_cluster != fat_get_root_cluster(drv)) {
+		if (dir_cluster == ancestor) {
+			return E_INVALIDARG;
+		}
+
+		hr = fat16_read_dir(drv, dir_cluster, &entries, &count);
+		if (FAILED(hr)) return hr;
+
+		if (count < 2 || entries[1].filename[0] != '.' || entries[1].filename[1] != '.') {
+			/* Missing ".." entry */
+			kfree(entries);
+			return E_FAIL;
+		}
+
+		dir_cluster = fat_get_first_cluster(drv, &entries[1]);
+		kfree(entries);
+
+		/* Break out of cycles */
+		if (++depth > ctx->total_cluster_cnt) {
+			return E_FAIL;
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Opens a handle to a directory
+ */
+static HRESULT
+fat16_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_LOC		loc;
+	K_DIRINDEX			*idx;
+	uint32_t			dir_cluster;
+	BOOL				is_root_dir;
+	HRESULT				hr;
+
+	is_root_dir = strlen(dirname) == 0 || strcmp(dirname, "/") == 0 ? TRUE : FALSE;
+
+	mutex_lock(&ctx->lock);
+
+	if (!is_root_dir) {
+		/* Find target directory and read it's DIR ENTRY */
+		hr = fat16_parse_url(drv, dirname, &loc);
+		if (FAILED(hr)) goto fail;
+
+		/* Assert item is directory */
+		if ((loc.entry.attributes & FAT_ATTR_DIRECTORY) == 0) {
+			//k_printf("not a directory\n");
+			hr = E_FAIL;
+			goto fail;
+		}
+
+		dir_cluster = fat_get_first_cluster(drv, &loc.entry);
+	} else {
+		dir_cluster = fat_get_root_cluster(drv);
+	}
+
+	/* Index content. The stream iterates the index, which stays valid even
+	 * if the directory is modified meanwhile. */
+	hr = fat16_dir_index(drv, dir_cluster, &idx);
+	if (FAILED(hr)) goto fail;
+
+	mutex_unlock(&ctx->lock);
+
+	/* Create new kernel directory stream */
+	K_DIR_STREAM *ds = kmalloc(sizeof(K_DIR_STREAM));
+
+	/* Allocate string to hold name of the directory being opened */
+	if (!(ds->dirname = kmalloc(VFS_MAX_DIRNAME_LENGTH))) {
+		dirindex_release(idx);
+		return E_OUTOFMEM;
+	}
+
+	if (is_root_dir) {
+		ds->dirname[0] = '\0';
+	} else {
+		strcpy(ds->dirname, dirname);
+	}
+
+	ds->priv_data = idx;
+	ds->len = idx->count;
+	ds->pos = 0;
+
+	/* Assign ops */
+	ds->readdir 	= fat16_readdir;
+	ds->rewinddir 	= fat16_rewinddir;
+	ds->closedir 	= fat16_closedir;
+
+	/* Success */
+	*out = ds;
+
+	return S_OK;
+
+fail:
+	mutex_unlock(&ctx->lock);
+	return hr;
+}
+
+/*
+ * Reads the sub-item currently pointed by `dirstr`'s position. Then moves position
+ * to the next one.
+ */
+static HRESULT fat16_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info)
+{
+	K_DIRINDEX		*idx = dirstr->priv_data;
+	FAT16_DIR_LOC	*loc;
+	const char		*name;
+	uint32_t		pos = dirstr->pos;
+	HRESULT			hr;
+
+	/* Moves position too */
+	hr = dirindex_next(idx, &pos, &name, (void**)&loc);
+	dirstr->pos = pos;
+
+	if (FAILED(hr)) return hr;
+
+	/* Found */
+	strcpy(filename, (char*)name);
+	info->node_type = (loc->entry.attributes & FAT_ATTR_DIRECTORY) == 0 ? NODE_TYPE_FILE : NODE_TYPE_DIRECTORY;
+	info->size = loc->entry.size;
+
+	return S_OK;
+}
+
+/*
+ * Rewinds the directory stream position.
+ */
+static HRESULT fat16_rewinddir(K_DIR_STREAM *dirstr)
+{
+	dirstr->pos = 0;
+	return S_OK;
+}
+
+/*
+ * Closes directory stream and deallocates it's related resources.
+ */
+static HRESULT fat16_closedir(K_DIR_STREAM **dirstr)
+{
+	K_DIR_STREAM *d = *dirstr;
+
+	kfree(d->dirname);
+
+	if (d->priv_data) {
+		dirindex_release(d->priv_data);
+	}
+
+	kfree(d);
+
+	*dirstr = NULL;
+	return S_OK;
+}
+
+/*
+ * Creates a directory.
+ */
+static HRESULT fat16_mkdir(K_FS_DRIVER *drv, char *path, uint32_t mode)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_ENTRY		entry, dots[2];
+	FAT16_DIR_LOC		loc;
+	char				name[MAX_FILENAME_LENGTH];
+	uint32_t			dir_cluster, cluster;
+	HRESULT				hr;
+
+	UNUSED_ARG(mode);
+
+	if (ctx->read_only) {
+		return E_ACCESSDENIED;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	hr = fat16_parse_parent(drv, path, &dir_cluster, name);
+	if (FAILED(hr)) goto finally;
+
+	/* Assert name is not taken */
+	hr = fat16_lookup(drv, dir_cluster, name, 0, &loc);
+	if (hr != E_NOTFOUND) {
+		if (SUCCEEDED(hr)) hr = E_FAIL;
+		goto finally;
+	}
+
+	/* Directories hold at least the "." and ".." entries */
+	hr = fat16_alloc_clusters(drv, 0, 1, &cluster, NULL);
+	if (FAILED(hr)) goto finally;
+
+	hr = fat16_zero_cluster(drv, cluster);
+	if (FAILED(hr)) goto fail;
+
+	memset(dots, 0, sizeof(dots));
+	memset(dots[0].filename, ' ', 11);
+	memset(dots[1].filename, ' ', 11);
+
+	dots[0].filename[0] = '.';
+	dots[0].attributes	= FAT_ATTR_DIRECTORY;
+	fat_set_first_cluster(drv, &dots[0], cluster);
+
+	/* ".." refers to the root directory as cluster 0, even on FAT32 */
+	dots[1].filename[0] = '.';
+	dots[1].filename[1] = '.';
+	dots[1].attributes	= FAT_ATTR_DIRECTORY;
+	fat_set_first_cluster(drv, &dots[1], dir_cluster == fat_get_root_cluster(drv) ? 0 : dir_cluster);
+
+	hr = fat16_write_dir_entries(drv, cluster, 0, 2, dots);
+	if (FAILED(hr)) goto fail;
+
+	/* Add it to the parent */
+	memset(&entry, 0, sizeof(FAT16_DIR_ENTRY));
+	entry.attributes = FAT_ATTR_DIRECTORY;
+	fat_set_first_cluster(drv, &entry, cluster);
+
+	hr = fat16_dir_add(drv, dir_cluster, name, &entry, &loc);
+	if (FAILED(hr)) goto fail;
+
+	hr = fat16_flush_fat(drv);
+	goto finally;
+
+fail:
+	fat16_free_chain(drv, cluster);
+
+finally:
+	mutex_unlock(&ctx->lock);
+	return hr;
+}
+
+/*
+ * Creates an empty file.
+ */
+static HRESULT fat16_create(K_FS_DRIVER *drv, char *filename, uint32_t perm)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_ENTRY		entry;
+	FAT16_DIR_LOC		loc;
+	char				name[MAX_FILENAME_LENGTH];
+	uint32_t			dir_cluster;
+	HRESULT				hr;
+
+	UNUSED_ARG(perm);
+
+	if (ctx->read_only) {
+		return E_ACCESSDENIED;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	hr = fat16_parse_parent(drv, filename, &dir_cluster, name);
+	if (FAILED(hr)) goto finally;
+
+	/* Assert name is not taken */
+	hr = fat16_lookup(drv, dir_cluster, name, 0, &loc);
+	if (hr != E_NOTFOUND) {
+		if (SUCCEEDED(hr)) hr = E_FAIL;
+		goto finally;
+	}
+
+	/* Empty files have no clusters */
+	memset(&entry, 0, sizeof(FAT16_DIR_ENTRY));
+	entry.attributes = FAT_ATTR_ARCHIVE;
+
+	hr = fat16_dir_add(drv, dir_cluster, name, &entry, &loc);
+
+finally:
+	mutex_unlock(&ctx->lock);
+	return hr;
+}
+
+/*
+ * Deletes a file or an empty directory.
+ */
+static HRESULT fat16_unlink(K_FS_DRIVER *drv, char *path)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_LOC		loc;
+	uint32_t			first_cluster;
+	HRESULT				hr;
+
+	if (ctx->read_only) {
+		return E_ACCESSDENIED;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	hr = fat16_parse_url(drv, path, &loc);
+	if (FAILED(hr)) goto finally;
+
+	if ((loc.entry.attributes & FAT_ATTR_READONLY) != 0) {
+		hr = E_ACCESSDENIED;
+		goto finally;
+	}
+
+	first_cluster = fat_get_first_cluster(drv, &loc.entry);
+
+	if ((loc.entry.attributes & FAT_ATTR_DIRECTORY) != 0) {
+		hr = fat16_dir_is_empty(drv, first_cluster);
+		if (FAILED(hr)) goto finally;
+	}
+
+	/* Remove the entry first, so an interrupted unlink only leaks clusters */
+	hr = fat16_dir_remove(drv, &loc);
+	if (FAILED(hr)) goto finally;
+
+	if (first_cluster != 0) {
+		hr = fat16_free_chain(drv, first_cluster);
+		if (FAILED(hr)) goto finally;
+	}
+
+	if ((loc.entry.attributes & FAT_ATTR_DIRECTORY) != 0) {
+		fat16_dir_changed(drv, first_cluster);
+	}
+
+	pagecache_invalidate(drv, fat_get_inode_id(loc.dir_cluster, loc.index));
+
+	hr = fat16_flush_fat(drv);
+
+finally:
+	mutex_unlock(&ctx->lock);
+	return hr;
+}
+
+/*
+ * Renames or moves a file or a directory within the volume. An existing
+ * file named `new_path` is replaced, directories are not.
+ */
+static HRESULT fat16_rename(K_FS_DRIVER *drv, char *old_path, char *new_path)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	FAT16_DIR_LOC		src, dst, added;
+	FAT16_DIR_ENTRY		dotdot;
+	FAT16_DIR_ENTRY		*entries;
+	char				name[MAX_FILENAME_LENGTH];
+	uint32_t			dir_cluster, first_cluster, count;
+	BOOL				is_dir;
+	HRESULT				hr;
+
+	if (ctx->read_only) {
+		return E_ACCESSDENIED;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	hr = fat16_parse_url(drv, old_path, &src);
+	if (FAILED(hr)) goto finally;
+
+	hr = fat16_parse_parent(drv, new_path, &dir_cluster, name);
+	if (FAILED(hr)) goto finally;
+
+	first_cluster	= fat_get_first_cluster(drv, &src.entry);
+	is_dir			= (src.entry.attributes & FAT_ATTR_DIRECTORY) != 0;
+
+	/* Handle an existing target, unless it is the same entry (case change) */
+	hr = fat16_lookup(drv, dir_cluster, name, 0, &dst);
+
+	if (SUCCEEDED(hr) && (dst.dir_cluster != src.dir_cluster || dst.index != src.index)) {
+		if ((dst.entry.attributes & FAT_ATTR_DIRECTORY) != 0 || is_dir) {
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		hr = fat16_dir_remove(drv, &dst);
+		if (FAILED(hr)) goto finally;
+
+		if (fat_get_first_cluster(drv, &dst.entry) != 0) {
+			fat16_free_chain(drv, fat_get_first_cluster(drv, &dst.entry));
+		}
+
+		pagecache_invalidate(drv, fat_get_inode_id(dst.dir_cluster, dst.index));
+	} else if (FAILED(hr) && hr != E_NOTFOUND) {
+		goto finally;
+	}
+
+	/* A directory can't be moved below itself */
+	if (is_dir && dir_cluster != src.dir_cluster) {
+		hr = fat16_check_not_below(drv, dir_cluster, first_cluster);
+		if (FAILED(hr)) goto finally;
+	}
+
+	/* Add the new entry before removing the old one, so nothing is lost if
+	 * the target directory is full */
+	hr = fat16_dir_add(drv, dir_cluster, name, &src.entry, &added);
+	if (FAILED(hr)) goto finally;
+
+	hr = fat16_dir_remove(drv, &src);
+	if (FAILED(hr)) goto finally;
+
+	/* Update ".." of moved directories */
+	if (is_dir && dir_cluster != src.dir_cluster) {
+		hr = fat16_read_dir(drv, first_cluster, &entries, &count);
+		if (FAILED(hr)) goto finally;
+
+		dotdot = entries[1];
+		kfree(entries);
+
+		if (count < 2 || dotdot.filename[0] != '.' || dotdot.filename[1] != '.') {
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		fat_set_first_cluster(drv, &dotdot, dir_cluster == fat_get_root_cluster(drv) ? 0 : dir_cluster);
+
+		hr = fat16_write_dir_entries(drv, first_cluster, 1, 1, &dotdot);
+		if (FAILED(hr)) goto finally;
+	}
+
+	/* Pages are cached by entry location */
+	pagecache_invalidate(drv, fat_get_inode_id(src.dir_cluster, src.index));
+
+	hr = fat16_flush_fat(drv);
+
+finally:
+	mutex_unlock(&ctx->lock);
+	return hr;
+}
+
+/*
+ * Writes modified FAT sectors and flushes the buffer cache of the device.
+ */
+static HRESULT fat16_sync(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	HRESULT				hr;
+
+	if (ctx->read_only) {
+		return S_OK;
+	}
+
+	mutex_lock(&ctx->lock);
+	hr = fat16_flush_fat(drv);
+	mutex_unlock(&ctx->lock);
+
+	if (FAILED(hr)) return hr;
+
+	return bcache_fsync(ctx->storage_drv);
+}
+
+/*
+ * Opens handle to a file stream.
+ */
+static HRESULT fat16_open(K_FS_DRIVER *drv, char *filename, uint32_t flags, K_STREAM **out)
+{
+	FAT16_DRV_CONTEXT 		*ctx = drv->priv_data;
+	FAT16_DIR_LOC			loc;
+	FAT16_STR_CONTEXT 		*strctx = NULL;
+	K_STREAM 				*stream = NULL;
+	HRESULT					hr;
+
+	/* Find target directory and read it's DIR ENTRY */
+	mutex_lock(&ctx->lock);
+	hr = fat16_parse_url(drv, filename, &loc);
+	mutex_unlock(&ctx->lock);
+
+	if (FAILED(hr)) return hr;
+
+	/* Assert item is a file */
+	if ((loc.entry.attributes & (FAT_ATTR_DIRECTORY | FAT_ATTR_VOLUMEL)) != 0) {
+		return E_FAIL;
+	}
+
+	if ((flags & FILE_OPEN_WRITE) != 0 && (ctx->read_only || (loc.entry.attributes & FAT_ATTR_READONLY) != 0)) {
+		return E_ACCESSDENIED;
+	}
+
+	/* Create new file stream */
+	if (!(stream = kcalloc(sizeof(K_STREAM)))) {
+		hr = E_OUTOFMEM;
+		goto fail;
+	}
+
+	if (!(strctx = kcalloc(sizeof(FAT16_STR_CONTEXT)))) {
+		hr = E_OUTOFMEM;
+		goto fail;
+	}
+
+	/* Setup stream. No need to set cache params since they
+	 * are initially zeroed. */
+	stream->mode = flags;
+	stream->fs_driver = drv;
+	stream->priv_data = strctx;
+
+	memcpy(&strctx->entry, &loc.entry, sizeof(FAT16_DIR_ENTRY));
+	strctx->dir_cluster	= loc.dir_cluster;
+	strctx->dir_index	= loc.index;
+	fat_extent_map_init(&strctx->extents, fat_get_first_cluster(drv, &loc.entry));
+
+	/* Streams of the same file share cached pages. Empty files have no first
+	 * cluster, so the inode is identified by the location of the entry. Reads
+	 * go directly to the device if this fails. */
+	if (FAILED(pagecache_open_inode(drv, fat_get_inode_id(loc.dir_cluster, loc.index), loc.entry.size, fat16_page_fill, &strctx->inode))) {
+		strctx->inode = NULL;
+	} else {
+		pagecache_ra_init(&strctx->ra, strctx->inode);
+	}
+
+	/* Create mutex */
+	mutex_create(&stream->lock);
+
+	/* Assign file ops */
+	stream->read 	= fat16_file_read;
+	stream->write 	= fat16_file_write;
+	stream->ioctl	= fat16_file_ioctl;
+	stream->seek	= fat16_file_seek;
+	stream->tell	= fat16_file_tell;
+	stream->close	= fat16_file_close;
+	stream->readv	= fat16_file_readv;
+	stream->writev	= fat16_file_writev;
+	stream->pread	= fat16_file_pread;
+	stream->pwrite	= fat16_file_pwrite;
+
+	/* Success */
+	*out = stream;
+	return S_OK;
+
+fail:
+	if (stream) kfree(stream);
+	if (strctx) kfree(strctx);
+
+	return hr;
+}
+
+/*
+ * Closes file stream and frees it's related resources.
+ */
+static HRESULT fat16_file_close(K_STREAM **str)
+{
+	K_STREAM 			*s = *str;
+	FAT16_STR_CONTEXT 	*strctx = s->priv_data;
+	FAT16_DRV_CONTEXT 	*ctx = ((K_FS_DRIVER*)s->fs_driver)->priv_data;
+
+	/* Read-ahead takes the stream lock, so it has to finish first */
+	if (strctx->inode) {
+		pagecache_ra_cancel(&strctx->ra);
+	}
+
+	/* Allocations made while writing are lazily flushed */
+	if (strctx->written) {
+		mutex_lock(&ctx->lock);
+		fat16_flush_fat(s->fs_driver);
+		mutex_unlock(&ctx->lock);
+	}
+
+	/* Free mutex */
+	mutex_destroy(&s->lock);
+
+	/* Free cache buffer*/
+	if (strctx->cache_buff) {
+		kfree(strctx->cache_buff);
+	}
+
+	if (strctx->inode) {
+		pagecache_close_inode(strctx->inode);
+	}
+
+	fat_extent_map_free(&strctx->extents);
+
+	/* Free private data and stream itself */
+	kfree(s->priv_data);
+	kfree(s);
+
+	*str = NULL;
+	return S_OK;
+}
+
+/*
+ * Reads non-sector-aligned memory blocks from a file stream.
+ */
+static HRESULT fat16_read_subblock(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t size, void *dst)
+{
+	FAT16_STR_CONTEXT 	*sc 		= s->priv_data;
+	K_FS_DRIVER			*drv 		= s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
+	uint32_t			write_index	= 0;
+	uint32_t			read_index  = start_addr;
+	uint32_t			block_size	= ctx->bpb.bytes_per_sector;
+	uint8_t				*dst_buff 	= dst;
+	uint32_t			block_count;
+	HRESULT				hr;
+
+	/* Check if requested sub-block is already cached */
+	if (!sc->cache_invalid && start_addr >= sc->cache_start_addr && start_addr <= (sc->cache_start_addr + sc->cache_size)) {
+		uint32_t cache_offs = start_addr - sc->cache_start_addr;
+
+		if ((start_addr+size) <= (sc->cache_start_addr + sc->cache_size)) {
+			/* Fully cached (cache hit) */
+			memcpy(dst_buff, sc->cache_buff + cache_offs, size);
+			return S_OK;
+		}
+		else {
+			/* Partially cached (beginning part overlaps) */
+			memcpy(dst_buff, sc->cache_buff + cache_offs, sc->cache_size - cache_offs);
+
+			write_index = sc->cache_size - cache_offs;
+			read_index	+= write_index;
+			size 		-= write_index;
+		}
+	}
+
+	/* Since we got here, this is a cache miss.
+	 *
+	 * If first block is not aligned read it in separate manner. So the
+	 * remaining blocks (if any) will be block-aligned.
+	 */
+	if (read_index % block_size != 0) {
+		uint32_t offs = read_index % ctx->bpb.bytes_per_sector;
+
+		hr = fat16_cache_blocks(s, entry, read_index - offs, 1);
+		if (FAILED(hr)) return hr;
+
+		/* Copy sub-block to destination buffer */
+		memcpy(dst_buff + write_index, sc->cache_buff + offs, block_size - offs);
+
+		write_index += block_size - offs;
+		read_index += block_size - offs;
+		size -= block_size - offs;
+	}
+
+	/* Sanity check */
+	if (read_index % block_size != 0) {
+		HalKernelPanic("fat16_read_subblock(): unexpected.");
+		return E_FAIL;
+	}
+
+	/* Calculate the remaining _aligned_ block count. */
+	block_count = size / block_size;
+
+	/* Read aligned blocks */
+	hr = fat16_read_file_content(drv, fat_get_first_cluster(drv, entry), &sc->extents, read_index, block_count * block_size, dst_buff + write_index);
+	if (FAILED(hr)) return hr;
+
+	/* Move read and write indices */
+	read_index += block_count * block_size;
+	write_index += block_count * block_size;
+	size -= block_count * block_size;
+
+	/* Sanity check */
+	if (size >= block_size) {
+		HalKernelPanic("fat16_read_subblock(): unexpected(2).");
+		return E_FAIL;
+	}
+
+	/* Read last _unaligned_ block (if remained). As first unaligned block,
+	 * this too requires different treatment.
+	 */
+	if (size > 0) {
+		/* Cache whole block */
+		hr = fat16_cache_blocks(s, entry, read_index, 1);
+		if (FAILED(hr)) return hr;
+
+		/* Write it to destination buffer */
+		memcpy(dst_buff + write_index, sc->cache_buff, size);
+	}
+
+	/* Success */
+	return S_OK;
+}
+
+/*
+ * Reads `block_cnt` blocks from the content of a file/directory and stores them
+ * in the cache buffer.
+ */
+static HRESULT fat16_cache_blocks(K_STREAM *s, FAT16_DIR_ENTRY *entry, uint32_t start_addr, uint32_t block_cnt)
+{
+	FAT16_STR_CONTEXT 	*sc			= s->priv_data;
+	K_FS_DRIVER			*drv 		= s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx 		= drv->priv_data;
+	uint32_t			block_size	= ctx->bpb.bytes_per_sector;
+	HRESULT				hr;
+
+	/* Validate input arguments */
+	if (start_addr % block_size != 0 || block_cnt == 0) {
+		return E_INVALIDARG;
+	}
+
+	/* Assert cache buffer is big enough */
+	if (sc->cache_cap < block_cnt * block_size) {
+		if (sc->cache_buff) {
 			kfree(sc->cache_buff);
 		}
 
-		if (!(sc->cache_buff = kmalloc(block_cnt * block_size))) {
-			return E_OUTOFMEM;
+		if (!(sc->cache_buff = kmalloc(block_cnt * block_size))) {
+			return E_OUTOFMEM;
+		}
+
+		sc->cache_cap = block_cnt * block_size;
+		sc->cache_invalid = TRUE;
+	}
+
+	/* Read blocks */
+	hr = fat16_read_file_content(drv, fat_get_first_cluster(drv, entry), &sc->extents, start_addr, block_cnt * block_size, sc->cache_buff);
+	if (FAILED(hr)) return hr;
+
+	/* Update cache parameters */
+	sc->cache_start_addr = start_addr;
+	sc->cache_size = block_cnt * block_size;
+	sc->cache_invalid = FALSE;
+
+	/* Success */
+	return S_OK;
+}
+
+/*
+ * Reads up to `size` bytes starting at `pos`, without moving the position
+ * marker. Must be called with stream mutex held.
+ */
+static HRESULT fat16_file_read_at(K_STREAM *str, uint32_t pos, size_t size, void *out_buf, size_t *bytes_read)
+{
+	FAT16_STR_CONTEXT 	*strctx = str->priv_data;
+	FAT16_DIR_ENTRY		*entry = &strctx->entry;
+	uint32_t			effective_size = size;
+	HRESULT				hr;
+
+	if (bytes_read) *bytes_read = 0;
+
+	if (pos >= entry->size) {
+		effective_size = 0;
+	} else if (size + pos >= entry->size) {
+		effective_size = entry->size - pos;
+	}
+
+	if (effective_size == 0) {
+		/* End of file */
+		return E_ENDOFSTR;
+	}
+
+	/* Read content */
+	hr = fat16_read_subblock(str, entry, pos, effective_size, out_buf);
+	if (FAILED(hr)) return hr;
+
+	/* Set output parameter */
+	if (bytes_read) *bytes_read = effective_size;
+
+	return S_OK;
+}
+
+/*
+ * Page cache fill callback.
+ */
+static HRESULT fat16_page_fill(K_STREAM *s, uint64_t offset, size_t size, void *dst, size_t *bytes_read)
+{
+	HRESULT hr;
+
+	mutex_lock(&s->lock);
+	hr = fat16_file_read_at(s, (uint32_t)offset, size, dst, bytes_read);
+	mutex_unlock(&s->lock);
+
+	return hr;
+}
+
+/*
+ * Same as fat16_file_read_at(), but served from the page cache.
+ */
+static HRESULT fat16_file_read_cached(K_STREAM *str, uint32_t pos, size_t size, void *out_buf, size_t *bytes_read)
+{
+	FAT16_STR_CONTEXT *strctx = str->priv_data;
+
+	if (strctx->inode == NULL) {
+		return fat16_file_read_at(str, pos, size, out_buf, bytes_read);
+	}
+
+	return pagecache_read_ra(&strctx->ra, str, pos, size, out_buf, bytes_read);
+}
+
+/*
+ * Reads `block_size` bytes from an opened file stream.
+ */
+static HRESULT fat16_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
+{
+	size_t	done;
+	HRESULT	hr;
+
+	/* Validate input parameters */
+	if (block_size == 0) {
+		return E_INVALIDARG;
+	}
+
+	if (!out_buf) {
+		return E_POINTER;
+	}
+
+	/* Lock stream mutex */
+	mutex_lock(&str->lock);
+
+	//hr = fat16_read_file_content_DEPRECATED(drv, entry, str->pos, effective_size, out_buf);
+	hr = fat16_file_read_cached(str, str->pos, block_size, out_buf, &done);
+	if (FAILED(hr)) goto finally;
+
+	/* Move position */
+	str->pos += done;
+
+	/* Set output parameter */
+	if (bytes_read) *bytes_read = done;
+
+finally:
+	if (FAILED(hr) && bytes_read) *bytes_read = 0;
+
+	mutex_unlock(&str->lock);
+	return hr;
+}
+
+/*
+ * Scatter-reads into a vector of buffers with a single lock acquisition.
+ */
+static HRESULT fat16_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read)
+{
+	size_t	total = 0, done;
+	HRESULT	hr = S_OK;
+
+	mutex_lock(&str->lock);
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0) continue;
+
+		hr = fat16_file_read_cached(str, str->pos, iov[i].len, iov[i].base, &done);
+
+		str->pos += done;
+		total += done;
+
+		if (FAILED(hr) || done < iov[i].len) break;
+	}
+
+	mutex_unlock(&str->lock);
+
+	if (bytes_read) *bytes_read = total;
+	return total > 0 ? S_OK : hr;
+}
+
+/*
+ * Reads at given offset, leaving the position marker intact.
+ */
+static HRESULT fat16_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read)
+{
+	HRESULT hr;
+
+	if (!out_buf) {
+		return E_POINTER;
+	}
+
+	if (offset > 0xFFFFFFFF) {
+		if (bytes_read) *bytes_read = 0;
+		return E_ENDOFSTR;
+	}
+
+	mutex_lock(&str->lock);
+	hr = fat16_file_read_cached(str, (uint32_t)offset, size, out_buf, bytes_read);
+	mutex_unlock(&str->lock);
+
+	return hr;
+}
+
+/*
+ * Makes sure the length and the last cluster of the file's chain are known.
+ * Must be called with the driver lock held.
+ */
+static HRESULT fat16_file_chain_info(K_STREAM *s)
+{
+	FAT16_STR_CONTEXT 	*sc = s->priv_data;
+	K_FS_DRIVER			*drv = s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			first = fat_get_first_cluster(drv, &sc->entry);
+	HRESULT				hr;
+
+	if (sc->chain_gen == ctx->chain_gen && sc->last_cluster != 0) {
+		return S_OK;
+	}
+
+	if (first == 0) {
+		sc->clusters = 0;
+		sc->last_cluster = 0;
+		return S_OK;
+	}
+
+	hr = fat16_chain_last(drv, first, &sc->last_cluster, &sc->clusters);
+	if (FAILED(hr)) return hr;
+
+	sc->chain_gen = ctx->chain_gen;
+	return S_OK;
+}
+
+/*
+ * Extends the file's chain to at least `clusters` clusters. Must be called
+ * with the driver lock held.
+ */
+static HRESULT fat16_file_reserve(K_STREAM *s, uint32_t clusters)
+{
+	FAT16_STR_CONTEXT 	*sc = s->priv_data;
+	K_FS_DRIVER			*drv = s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			first, last;
+	HRESULT				hr;
+
+	hr = fat16_file_chain_info(s);
+	if (FAILED(hr)) return hr;
+
+	if (sc->clusters >= clusters) {
+		return S_OK;
+	}
+
+	hr = fat16_alloc_clusters(drv, sc->last_cluster, clusters - sc->clusters, &first, &last);
+	if (FAILED(hr)) return hr;
+
+	if (sc->last_cluster == 0) {
+		/* First clusters of the file, written to the entry by the caller */
+		fat_set_first_cluster(drv, &sc->entry, first);
+	}
+
+	sc->clusters		= clusters;
+	sc->last_cluster	= last;
+	sc->chain_gen		= ctx->chain_gen;
+
+	return S_OK;
+}
+
+/*
+ * Writes `size` bytes at `pos` to the clusters of the file, which have to be
+ * reserved already. Whole sectors are written directly, partial ones are read
+ * first. If `in_buf` is NULL, zeros are written. Must be called with the
+ * driver lock held.
+ */
+static HRESULT fat16_file_write_bytes(K_STREAM *s, uint32_t pos, uint32_t size, const void *in_buf)
+{
+	FAT16_STR_CONTEXT 	*sc 	= s->priv_data;
+	K_FS_DRIVER			*drv 	= s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx 	= drv->priv_data;
+	uint32_t			bps		= ctx->bpb.bytes_per_sector;
+	uint32_t			zero_cap= bps * ctx->bpb.sectors_per_cluster;
+	uint32_t			first	= fat_get_first_cluster(drv, &sc->entry);
+	const uint8_t		*src	= in_buf;
+	uint8_t				*sector = NULL, *zeros = NULL;
+	uint32_t			in_sector, n;
+	HRESULT				hr = S_OK;
+
+	while (size > 0) {
+		in_sector = pos % bps;
+
+		if (in_sector != 0 || size < bps) {
+			/* Partial sector */
+			n = bps - in_sector;
+			if (n > size) n = size;
+
+			if (!sector && !(sector = kmalloc(bps))) {
+				hr = E_OUTOFMEM;
+				break;
+			}
+
+			hr = fat16_read_file_content(drv, first, &sc->extents, pos - in_sector, bps, sector);
+			if (FAILED(hr)) break;
+
+			if (src) {
+				memcpy(sector + in_sector, src, n);
+			} else {
+				memset(sector + in_sector, 0, n);
+			}
+
+			hr = fat16_write_file_content(drv, first, &sc->extents, pos - in_sector, bps, sector);
+			if (FAILED(hr)) break;
+		} else {
+			/* Whole sectors */
+			n = size - size % bps;
+
+			if (src) {
+				hr = fat16_write_file_content(drv, first, &sc->extents, pos, n, (void*)src);
+			} else {
+				if (n > zero_cap) n = zero_cap;
+
+				if (!zeros && !(zeros = kcalloc(zero_cap))) {
+					hr = E_OUTOFMEM;
+					break;
+				}
+
+				hr = fat16_write_file_content(drv, first, &sc->extents, pos, n, zeros);
+			}
+			if (FAILED(hr)) break;
+		}
+
+		pos += n;
+		size -= n;
+		if (src) src += n;
+	}
+
+	if (sector) kfree(sector);
+	if (zeros) kfree(zeros);
+
+	return hr;
+}
+
+/*
+ * Writes the stream's copy of the entry to the directory. Nothing is written
+ * if the entry was deleted or renamed meanwhile. Must be called with the
+ * driver lock held.
+ */
+static HRESULT fat16_file_update_entry(K_STREAM *s)
+{
+	FAT16_STR_CONTEXT 	*sc = s->priv_data;
+	K_FS_DRIVER			*drv = s->fs_driver;
+	FAT16_DIR_ENTRY		*entries;
+	uint32_t			count, i;
+	HRESULT				hr;
+
+	hr = fat16_read_dir(drv, sc->dir_cluster, &entries, &count);
+	if (FAILED(hr)) return hr;
+
+	if (sc->dir_index < count) {
+		for (i=0; i<11; i++) {
+			if (((uint8_t*)entries[sc->dir_index].filename)[i] != ((uint8_t*)sc->entry.filename)[i]) break;
+		}
+	} else {
+		i = 0;
+	}
+
+	kfree(entries);
+
+	if (i < 11) {
+		return S_FALSE;
+	}
+
+	hr = fat16_write_dir_entries(drv, sc->dir_cluster, sc->dir_index, 1, &sc->entry);
+
+	/* Cached lookups hold the old size and first cluster */
+	fat16_dir_changed(drv, sc->dir_cluster);
+
+	return hr;
+}
+
+/*
+ * Writes `size` bytes at `pos`, without moving the position marker. The file
+ * is extended if needed, a gap between the end of file and `pos` is filled
+ * with zeros. If `in_buf` is NULL, zeros are written. Must be called with
+ * stream mutex held.
+ */
+static HRESULT fat16_file_write_at(K_STREAM *str, uint32_t pos, size_t size, const void *in_buf, size_t *bytes_written)
+{
+	FAT16_STR_CONTEXT 	*sc 	= str->priv_data;
+	K_FS_DRIVER			*drv 	= str->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx 	= drv->priv_data;
+	FAT16_DIR_ENTRY		*entry	= &sc->entry;
+	uint32_t			csize	= ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster;
+	uint32_t			old_size, end;
+	HRESULT				hr;
+
+	if (bytes_written) *bytes_written = 0;
+
+	if ((str->mode & FILE_OPEN_WRITE) == 0) {
+		return E_ACCESSDENIED;
+	}
+
+	if (size == 0) {
+		return S_OK;
+	}
+
+	/* Files are limited to 4 GiB - 1 */
+	if ((uint64_t)pos + size > 0xFFFFFFFF) {
+		return E_BUFFEROVERFLOW;
+	}
+
+	end = pos + size;
+
+	mutex_lock(&ctx->lock);
+
+	old_size = entry->size;
+
+	hr = fat16_file_reserve(str, (end + csize - 1) / csize);
+	if (FAILED(hr)) goto finally;
+
+	/* Fill the gap past the end of file */
+	if (pos > old_size) {
+		hr = fat16_file_write_bytes(str, old_size, pos - old_size, NULL);
+		if (FAILED(hr)) goto finally;
+	}
+
+	hr = fat16_file_write_bytes(str, pos, size, in_buf);
+	if (FAILED(hr)) goto finally;
+
+	if (end > old_size) {
+		entry->size = end;
+
+		hr = fat16_file_update_entry(str);
+		if (FAILED(hr)) goto finally;
+	}
+
+	hr = fat16_flush_fat_lazy(drv);
+
+finally:
+	mutex_unlock(&ctx->lock);
+
+	sc->cache_invalid	= TRUE;
+	sc->written			= TRUE;
+
+	if (FAILED(hr)) return hr;
+
+	/* Keep cached pages in sync. Past the old end they read as zeros. */
+	if (sc->inode) {
+		if (pos > old_size) {
+			pagecache_truncate(sc->inode, pos);
+		}
+
+		if (in_buf) {
+			pagecache_update(sc->inode, pos, size, in_buf);
+		} else if (end > old_size) {
+			pagecache_truncate(sc->inode, end);
+		}
+	}
+
+	if (bytes_written) *bytes_written = size;
+	return S_OK;
+}
+
+/*
+ * Truncates or extends (with zeros) the file. Must be called with stream
+ * mutex held.
+ */
+static HRESULT fat16_file_set_size(K_STREAM *s, uint32_t size)
+{
+	FAT16_STR_CONTEXT 	*sc 	= s->priv_data;
+	K_FS_DRIVER			*drv 	= s->fs_driver;
+	FAT16_DRV_CONTEXT 	*ctx 	= drv->priv_data;
+	FAT16_DIR_ENTRY		*entry	= &sc->entry;
+	uint32_t			csize	= ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster;
+	uint32_t			keep, cluster, next, i;
+	HRESULT				hr = S_OK;
+
+	if ((s->mode & FILE_OPEN_WRITE) == 0) {
+		return E_ACCESSDENIED;
+	}
+
+	if (size > entry->size) {
+		return fat16_file_write_at(s, entry->size, size - entry->size, NULL, NULL);
+	}
+
+	if (size == entry->size) {
+		return S_OK;
+	}
+
+	mutex_lock(&ctx->lock);
+
+	keep	= (size + csize - 1) / csize;
+	cluster = fat_get_first_cluster(drv, entry);
+
+	if (keep == 0) {
+		/* Empty files have no clusters */
+		hr = fat16_free_chain(drv, cluster);
+		if (FAILED(hr)) goto finally;
+
+		fat_set_first_cluster(drv, entry, 0);
+	} else {
+		/* Cut the chain after the `keep`-th cluster */
+		for (i=1; i<keep; i++) {
+			hr = fat16_fat_lookup(drv, cluster, &cluster);
+			if (FAILED(hr)) goto finally;
+		}
+
+		hr = fat16_fat_lookup(drv, cluster, &next);
+		if (FAILED(hr)) goto finally;
+
+		if (!fat_is_end_of_chain(drv, next)) {
+			hr = fat16_fat_set(drv, cluster, fat_get_eoc(drv));
+			if (FAILED(hr)) goto finally;
+
+			hr = fat16_free_chain(drv, next);
+			if (FAILED(hr)) goto finally;
+		}
+	}
+
+	entry->size = size;
+
+	hr = fat16_file_update_entry(s);
+	if (FAILED(hr)) goto finally;
+
+	hr = fat16_flush_fat(drv);
+
+finally:
+	/* Chain info is recomputed on the next write */
+	sc->last_cluster	= 0;
+	sc->cache_invalid	= TRUE;
+	sc->written			= TRUE;
+
+	mutex_unlock(&ctx->lock);
+
+	if (SUCCEEDED(hr) && sc->inode) {
+		pagecache_truncate(sc->inode, size);
+	}
+
+	/* Position may be past the end now */
+	if (s->pos > size) {
+		s->pos = size;
+	}
+
+	return hr;
+}
+
+/*
+ * Writes `block_size` bytes to file.
+ */
+static HRESULT fat16_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written)
+{
+	size_t	done;
+	HRESULT	hr;
+
+	/* Validate input parameters */
+	if (block_size <= 0) {
+		return E_INVALIDARG;
+	}
+
+	if (!in_buf) {
+		return E_POINTER;
+	}
+
+	mutex_lock(&str->lock);
+
+	hr = fat16_file_write_at(str, str->pos, block_size, in_buf, &done);
+	if (SUCCEEDED(hr)) {
+		str->pos += done;
+	}
+
+	mutex_unlock(&str->lock);
+
+	if (bytes_written) *bytes_written = SUCCEEDED(hr) ? done : 0;
+	return hr;
+}
+
+/*
+ * Gather-writes a vector of buffers with a single lock acquisition.
+ */
+static HRESULT fat16_file_writev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written)
+{
+	size_t	total = 0, done;
+	HRESULT	hr = S_OK;
+
+	mutex_lock(&str->lock);
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0) continue;
+
+		hr = fat16_file_write_at(str, str->pos, iov[i].len, iov[i].base, &done);
+		if (FAILED(hr)) break;
+
+		str->pos += done;
+		total += done;
+	}
+
+	mutex_unlock(&str->lock);
+
+	if (bytes_written) *bytes_written = total;
+	return total > 0 ? S_OK : hr;
+}
+
+/*
+ * Writes at given offset, leaving the position marker intact.
+ */
+static HRESULT fat16_file_pwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written)
+{
+	HRESULT hr;
+
+	if (!in_buf) {
+		return E_POINTER;
+	}
+
+	if (offset > 0xFFFFFFFF) {
+		if (bytes_written) *bytes_written = 0;
+		return E_BUFFEROVERFLOW;
+	}
+
+	mutex_lock(&str->lock);
+	hr = fat16_file_write_at(str, (uint32_t)offset, size, in_buf, bytes_written);
+	mutex_unlock(&str->lock);
+
+	return hr;
+}
+
+/*
+ * IOCTL handler. Supports IOCTL_FILE_GET_PAGECACHE and IOCTL_FILE_TRUNCATE.
+ */
+static HRESULT fat16_file_ioctl(K_STREAM *s, uint32_t code, void *arg)
+{
+	FAT16_STR_CONTEXT *strctx = s->priv_data;
+	HRESULT hr;
+
+	switch (code) {
+	case IOCTL_FILE_GET_PAGECACHE:
+		if (arg == NULL) return E_POINTER;
+		if (strctx->inode == NULL) return E_NOTSUPPORTED;
+
+		*(K_PAGECACHE_INODE**)arg = strctx->inode;
+		return S_OK;
+
+	case IOCTL_FILE_TRUNCATE:
+		if (arg == NULL) return E_POINTER;
+
+		/* Read-ahead in flight could fill pages past the new end */
+		if (strctx->inode) {
+			pagecache_ra_cancel(&strctx->ra);
+		}
+
+		mutex_lock(&s->lock);
+		hr = fat16_file_set_size(s, *(uint32_t*)arg);
+		mutex_unlock(&s->lock);
+
+		return hr;
+	}
+
+	return E_UNEXPECTED;
+}
+
+/*
+ * Moves the file stream position according to the given arguments.
+ */
+static uint32_t fat16_file_seek(K_STREAM *s, int64_t pos, int8_t origin)
+{
+	FAT16_STR_CONTEXT 	*strctx = s->priv_data;
+	FAT16_DIR_ENTRY		*entry 	= &strctx->entry;
+	HRESULT 			hr 		= S_OK;
+	int32_t 			new_pos;
+
+	mutex_lock(&s->lock);
+
+	switch (origin) {
+	case KSTREAM_ORIGIN_BEGINNING:
+		new_pos = pos;
+		break;
+
+	case KSTREAM_ORIGIN_CURRENT:
+		new_pos =  s->pos + pos;
+		break;
+
+	case KSTREAM_ORIGIN_END:
+		new_pos = entry->size - pos;
+		break;
+
+	default:
+		hr = E_INVALIDARG;
+		goto finally;
+	}
+
+	if (new_pos < 0 || new_pos > (int32_t)entry->size) {
+		hr = E_INVALIDARG;
+		goto finally;
+	}
+
+	s->pos = new_pos;
+
+finally:
+	mutex_unlock(&s->lock);
+	return hr;
+}
+
+/*
+ * Retrieves the current position of the file stream.
+ */
+static uint32_t fat16_file_tell(K_STREAM *s)
+{
+	uint32_t current_pos;
+
+	mutex_lock(&s->lock);
+	current_pos = s->pos;
+	mutex_unlock(&s->lock);
+
+	return current_pos;
+}
+
+/*
+ * Returns a character of a short name, lower-cased if `lower` is set.
+ */
+static char fat_short_char(uint8_t c, BOOL lower)
+{
+	return lower && c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/*
+ * Concatenates the filename with the file extension putting
+ * a dot in between.
+ */
+static void	fat_copy_short_filename(FAT16_DIR_ENTRY *entry, char *dst)
+{
+	uint32_t i, dst_index = 0;
+
+	/* Copy name. Lower case names are flagged by Windows NT. */
+	for (i=0; i<8; i++) {
+		if (entry->filename[i] != ' ') {
+			dst[dst_index++] = fat_short_char(entry->filename[i], (entry->reserved & FAT_NT_LOWER_BASE) != 0);
+		} else {
+			break;
+		}
+	}
+
+	/* Character 0x05 is escape token for 0xE5 */
+	if (dst[0] == 0x05) {
+		dst[0] = (char)0xE5;
+	}
+
+	/* Insert dot */
+	if (entry->ext[0] != ' ')
+	dst[dst_index++] = '.';
+
+	/* Copy extension */
+	for (i=0; i<3; i++) {
+		if (entry->ext[i] != ' ') {
+			dst[dst_index++] = fat_short_char(entry->ext[i], (entry->reserved & FAT_NT_LOWER_EXT) != 0);
+		} else {
+			break;
+		}
+	}
+
+	dst[dst_index++] = '\0';
+}
+
+/*
+ * Figures out the type of the FAT file system based on few parameters.
+ */
+static uint32_t
+fat_get_type(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+
+	if (ctx->total_cluster_cnt < 4085) {
+		return FS_TYPE_FAT12;
+	} else if (ctx->total_cluster_cnt < 65525) {
+		return FS_TYPE_FAT16;
+	} else if (ctx->total_cluster_cnt < 268435445) {
+		return FS_TYPE_FAT32;
+	}
+
+	return FS_TYPE_EXFAT;
+}
+
+/*
+ * Returns size of the root dir content in bytes.
+ */
+static uint32_t fat_get_rootdir_size(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	return ctx->bpb.root_entries * sizeof(FAT16_DIR_ENTRY);
+}
+
+/*
+ * Iterates all directory entries and count the actual number
+ * of sub-items (files and directories) for the given directory.
+ */
+static uint32_t fat_get_subitem_count(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry_arr, uint32_t entries_max)
+{
+	uint32_t			i, cnt=0;
+
+	UNUSED_ARG(drv);
+
+	for (i=0; i<entries_max; i++) {
+		if (entry_arr[i].filename[0] == 0xE5) {
+			/* Sub-item is deleted */
+			continue;
+		}
+
+		if (entry_arr[i].filename[0] == 0x00) {
+			/* End of list */
+			break;
+		}
+
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/*
+ * Counts clusters in a chain starting from the given cluster id.
+ */
+static uint32_t fat_count_chain(K_FS_DRIVER *drv, uint32_t first_cluster)
+{
+	FAT16_DRV_CONTEXT 	*ctx 	= drv->priv_data;
+	uint32_t			current = first_cluster;
+	uint32_t			count 	= 0;
+	HRESULT				hr;
+
+	if (first_cluster == 0x00) {
+		/* Unused cluster */
+		return 0;
+	}
+
+	while (!fat_is_end_of_chain(drv, current)) {
+		hr = fat16_fat_lookup(drv, current, &current);
+		if (FAILED(hr)) return 0;
+
+		count++;
+
+		/* Break out of defective (cyclic) chains */
+		if (count == ctx->total_cluster_cnt) {
+			count = 0;
+			break;
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Returns the first data cluster of a DIR entry.
+ */
+static uint32_t	fat_get_first_cluster(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint32_t			result = 0;
+
+	switch (ctx->fs_type) {
+		case FS_TYPE_FAT12:
+		case FS_TYPE_FAT16:
+			result = entry->first_clust_low;
+			break;
+
+		case FS_TYPE_FAT32:
+			result = (entry->first_clust_high << 16) | (entry->first_clust_low);
+			break;
+
+		default:
+			HalKernelPanic("fat_get_entry_start_cluster(): unsupported fs.");
+	}
+
+	return result;
+}
+
+/*
+ * Sets the first data cluster of a DIR entry.
+ */
+static void fat_set_first_cluster(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry, uint32_t cluster)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+
+	entry->first_clust_low	= cluster & 0xFFFF;
+	entry->first_clust_high	= ctx->fs_type == FS_TYPE_FAT32 ? cluster >> 16 : 0;
+}
+
+/*
+ * Returns the first cluster of the root directory, or 0 for the fixed root
+ * directory region of FAT12/16.
+ */
+static uint32_t fat_get_root_cluster(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+
+	return ctx->fs_type == FS_TYPE_FAT32 ? ctx->root_cluster : 0;
+}
+
+/*
+ * Page cache id of a file. Empty files have no first cluster, so files are
+ * identified by the location of their entry.
+ */
+static uint64_t	fat_get_inode_id(uint32_t dir_cluster, uint32_t index)
+{
+	return ((uint64_t)dir_cluster << 32) | index;
+}
+
+/*
+ * Prepares an empty extent map for the chain starting at `first_cluster`.
+ */
+static void fat_extent_map_init(FAT16_EXTENT_MAP *map, uint32_t first_cluster)
+{
+	memset(map, 0, sizeof(FAT16_EXTENT_MAP));
+	map->first_cluster = first_cluster;
+	map->next_cluster = first_cluster;
+}
+
+static void fat_extent_map_free(FAT16_EXTENT_MAP *map)
+{
+	if (map->extents) {
+		kfree(map->extents);
+	}
+
+	memset(map, 0, sizeof(FAT16_EXTENT_MAP));
+}
+
+/*
+ * Parses the BIOS Parameter Block from the Boot Record.
+ */
+static HRESULT
+fat16_parse_bpb(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	HRESULT 			hr;
+	size_t				block_size;
+	uint8_t				*buff;
+	uint32_t			root_dir_sectors;
+	uint32_t			fat_capacity;
+	FAT32_EBPB			*ebpb32;
+
+	hr = storage_get_block_size(ctx->storage_drv, &block_size);
+	if (FAILED(hr)) return hr;
+
+	/* Allocate temporary buffer */
+	if (!(buff = kmalloc(block_size))) {
+		return E_OUTOFMEM;
+	}
+
+	/* Read boot record */
+	hr = storage_read_blocks(ctx->storage_drv, 0, 1, buff);
+	if (FAILED(hr)) goto finally;
+
+	/* Copy appropriate data to BPB buffer */
+	memcpy(&ctx->bpb, buff, sizeof(FAT16_BPB));
+
+	if (ctx->bpb.bytes_per_sector == 0 || ctx->bpb.sectors_per_cluster == 0) {
+		hr = E_INVALIDDATA;
+		goto finally;
+	}
+
+	if (ctx->bpb.sectors_per_FAT == 0) {
+		/* FAT32 has a different EBPB, which ends like the FAT12/16 one */
+		ebpb32 = (FAT32_EBPB*)(buff + sizeof(FAT16_BPB));
+
+		ctx->sectors_per_fat	= ebpb32->sectors_per_FAT;
+		ctx->root_cluster		= ebpb32->root_cluster;
+		ctx->fsinfo_sector		= ebpb32->fsinfo_sector;
+
+		memcpy(&ctx->ebpb, &ebpb32->drive_number, sizeof(FAT16_EBPB));
+	} else {
+		ctx->sectors_per_fat	= ctx->bpb.sectors_per_FAT;
+		memcpy(&ctx->ebpb, buff+sizeof(FAT16_BPB), sizeof(FAT16_EBPB));
+	}
+
+	/* Initialize remaining fields */
+	ctx->total_sectors 		= ctx->bpb.num_sectors_16 > 0 ? ctx->bpb.num_sectors_16 : ctx->bpb.num_sectors_32;
+
+	root_dir_sectors 		= (fat_get_rootdir_size(drv) + (ctx->bpb.bytes_per_sector - 1)) / ctx->bpb.bytes_per_sector;
+	ctx->first_data_sector 	= ctx->bpb.reserved_sectors + (ctx->bpb.FAT_count * ctx->sectors_per_fat) + root_dir_sectors;
+	ctx->first_fat_sector  	= ctx->bpb.reserved_sectors;
+	ctx->first_root_sector	= ctx->first_fat_sector + ctx->bpb.FAT_count * ctx->sectors_per_fat; //sector
+
+	ctx->data_sector_cnt 	= ctx->total_sectors - ctx->bpb.reserved_sectors - ctx->bpb.FAT_count * ctx->sectors_per_fat - root_dir_sectors;
+	ctx->total_cluster_cnt	= ctx->data_sector_cnt / ctx->bpb.sectors_per_cluster;
+
+	/* fat_get_type() uses `ctx->total_cluster_cnt` field, so it has to be invoked
+	 * after it is properly evaluated. Volumes with a FAT32 EBPB are FAT32
+	 * regardless of their size.
+	 */
+	ctx->fs_type 			= ctx->bpb.sectors_per_FAT == 0 ? FS_TYPE_FAT32 : fat_get_type(drv);
+
+	if (ctx->fs_type == FS_TYPE_FAT32 && ctx->root_cluster < 2) {
+		hr = E_INVALIDDATA;
+		goto finally;
+	}
+
+	/* Clusters past the end of the FAT can't be used */
+	switch (ctx->fs_type) {
+		case FS_TYPE_FAT12:
+			fat_capacity = ctx->sectors_per_fat * ctx->bpb.bytes_per_sector * 2 / 3;
+			break;
+
+		case FS_TYPE_FAT16:
+			fat_capacity = ctx->sectors_per_fat * ctx->bpb.bytes_per_sector / 2;
+			break;
+
+		default:
+			fat_capacity = ctx->sectors_per_fat * ctx->bpb.bytes_per_sector / 4;
+			break;
+	}
+
+	if (fat_capacity < 2) {
+		hr = E_INVALIDDATA;
+		goto finally;
+	}
+
+	if (ctx->total_cluster_cnt > fat_capacity - 2) {
+		ctx->total_cluster_cnt = fat_capacity - 2;
+	}
+
+finally:
+	kfree(buff);
+	return hr;
+}
+
+/*
+ * Retrieves the index of the directory starting at `dir_cluster` (0 for the
+ * FAT12/16 root directory), building it from the directory content if it isn't
+ * cached. Each entry holds a FAT16_DIR_LOC. Sub-items are indexed by their
+ * long name, and by their short name as an alias if it differs. Release it
+ * with dirindex_release().
+ */
+static HRESULT fat16_dir_index(K_FS_DRIVER *drv, uint32_t dir_cluster, K_DIRINDEX **out)
+{
+	FAT16_DIR_ENTRY		*buf;
+	FAT16_DIR_LOC		loc;
+	K_DIRINDEX			*idx;
+	uint32_t			entry_cnt;
+	char				fn_buff[MAX_FILENAME_LENGTH];
+	char				short_name[13];
+	uint32_t			pos = 0, lfn_index;
+	HRESULT				hr;
+
+	hr = dirindex_get(drv, dir_cluster, out);
+	if (hr != S_FALSE) return hr;
+
+	/* Read content */
+	hr = fat16_read_dir(drv, dir_cluster, &buf, &entry_cnt);
+	if (FAILED(hr)) return hr;
+
+	hr = dirindex_create(drv, dir_cluster, sizeof(FAT16_DIR_LOC), &idx);
+	if (FAILED(hr)) goto finally;
+
+	/* Iterate sub-entries */
+	while (fat_dir_next(buf, entry_cnt, &pos, &lfn_index, fn_buff) == S_OK) {
+		FAT16_DIR_ENTRY *e = &buf[pos];
+
+		loc.entry		= *e;
+		loc.dir_cluster	= dir_cluster;
+		loc.index		= pos++;
+		loc.lfn_index	= lfn_index;
+
+		hr = dirindex_add(idx, fn_buff, &loc, 0);
+		if (FAILED(hr)) break;
+
+		/* The short name is valid as well */
+		fat_copy_short_filename(e, short_name);
+
+		if (stricmp(short_name, fn_buff) != 0) {
+			hr = dirindex_add(idx, short_name, &loc, DIRINDEX_ALIAS);
+			if (FAILED(hr)) break;
+		}
+	}
+
+	if (SUCCEEDED(hr)) {
+		hr = dirindex_publish(idx);
+	}
+
+	if (FAILED(hr)) {
+		dirindex_release(idx);
+		goto finally;
+	}
+
+	*out = idx;
+	hr = S_OK;
+
+finally:
+	kfree(buf);
+	return hr;
+}
+
+/*
+ * Drops cached lookups and the index of a directory, after it was modified.
+ */
+static void fat16_dir_changed(K_FS_DRIVER *drv, uint32_t dir_cluster)
+{
+	dcache_invalidate_dir(drv, dir_cluster);
+	dirindex_invalidate(drv, dir_cluster);
+}
+
+/*
+ * Finds a sub-item of the directory starting at `dir_cluster` (0 for the
+ * FAT12/16 root directory) with given filename and flags, using the directory
+ * index. Both long and short names are matched.
+ *
+ * If a match is found, it is returned copied to `dst` along with it's location.
+ */
+static HRESULT fat16_find_subentry(K_FS_DRIVER *drv, uint32_t dir_cluster, char *filename, uint32_t flagmask, FAT16_DIR_LOC *dst)
+{
+	FAT16_DIR_LOC		loc;
+	K_DIRINDEX			*idx;
+	HRESULT				hr;
+
+	hr = fat16_dir_index(drv, dir_cluster, &idx);
+	if (FAILED(hr)) return hr;
+
+	hr = dirindex_find(idx, filename, &loc);
+	dirindex_release(idx);
+
+	if (FAILED(hr)) return hr;
+
+	/* Match flags */
+	if (flagmask != 0 && (loc.entry.attributes & flagmask) != flagmask) {
+		return E_NOTFOUND;
+	}
+
+	*dst = loc;
+	return S_OK;
+}
+
+/*
+ * Same as fat16_find_subentry(), but goes through the dentry cache first.
+ * Entries are keyed by the first cluster of the directory and the upper-cased
+ * name, since names are case-insensitive. Must be called with the driver lock
+ * held, so the cache doesn't see stale locations.
+ */
+static HRESULT fat16_lookup(K_FS_DRIVER *drv, uint32_t dir_cluster, char *filename, uint32_t flagmask, FAT16_DIR_LOC *dst)
+{
+	FAT16_DIR_LOC		loc;
+	char				key[DCACHE_MAX_NAME];
+	uint32_t			i;
+	HRESULT				hr;
+
+	if (strlen(filename) >= DCACHE_MAX_NAME) {
+		/* Can't be cached */
+		return fat16_find_subentry(drv, dir_cluster, filename, flagmask, dst);
+	}
+
+	for (i=0; filename[i] != '\0'; i++) {
+		char c = filename[i];
+		key[i] = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+	}
+	key[i] = '\0';
+
+	hr = dcache_lookup(drv, dir_cluster, key, &loc, sizeof(FAT16_DIR_LOC));
+
+	if (hr == S_FALSE) {
+		/* Not cached. Scan without a flag mask, so the result can be used for
+		 * any later lookup of the same name.
+		 */
+		hr = fat16_find_subentry(drv, dir_cluster, filename, 0, &loc);
+
+		if (SUCCEEDED(hr)) {
+			dcache_insert(drv, dir_cluster, key, &loc, sizeof(FAT16_DIR_LOC));
+		} else if (hr == E_NOTFOUND) {
+			dcache_insert(drv, dir_cluster, key, NULL, 0);
+		}
+	}
+
+	if (FAILED(hr)) return hr;
+
+	/* Match flags */
+	if (flagmask != 0 && (loc.entry.attributes & flagmask) != flagmask) {
+		return E_NOTFOUND;
+	}
+
+	*dst = loc;
+	return S_OK;
+}
+
+/*
+ * Descends the file system according to the given URL and tries to find and retrieve
+ * the DIR ENTRY (and it's location) for the specified file. Must be called with the
+ * driver lock held.
+ */
+static HRESULT fat16_parse_url(K_FS_DRIVER *drv, char *url, FAT16_DIR_LOC *out)
+{
+	uint32_t 			comp_count = 0;
+	uint32_t 			url_len = strlen(url);
+	FAT16_DIR_LOC		curr;
+	uint32_t			dir_cluster = fat_get_root_cluster(drv);
+	uint32_t 			i, len, flagmask;
+	HRESULT				hr;
+	char				comp_name[MAX_FILENAME_LENGTH];
+
+	/* Count number of path delimiters */
+	for (i=0; i<url_len; i++) {
+		if (url[i] == VFS_PATH_DELIMITER) {
+			comp_count++;
+		}
+	}
+
+	if (comp_count == 0) {
+		return E_NOTFOUND;
+	}
+
+	/* Create array to hold the names of each component */
+	uint32_t comp_id = 0;
+	char *components[comp_count];
+
+	/* Split URL to components */
+	for (i=0; i<url_len; i++) {
+		if (url[i] == VFS_PATH_DELIMITER) {
+			components[comp_id++] = &url[i+1];
+		}
+	}
+
+	/* Iterate components */
+	for (i=0; i<comp_count; i++) {
+		/* Find length of the component name */
+		char *s = strchr(components[i], VFS_PATH_DELIMITER);
+		len	= !s ? strlen(components[i]) : (uint32_t)(s - components[i]);
+
+		if (len >= MAX_FILENAME_LENGTH) {
+			return E_NOTFOUND;
 		}
 
-		sc->cache_cap = block_cnt * block_size;
-		sc->cache_invalid = TRUE;
-	}
+		/* Copy component name to local variable */
+		memcpy(comp_name, components[i], len);
+		comp_name[len] = '\0';
+
+		/* If this is last component it could be either file or a folder,
+		 * but otherwise it is mandatory to be a directory.
+		 */
+		flagmask = (comp_count - i == 1) ? 0x00 : FAT_ATTR_DIRECTORY;
+
+		/* Search */
+		hr = fat16_lookup(drv, dir_cluster, comp_name, flagmask, &curr);
+		if (FAILED(hr)) goto finally;
+
+		dir_cluster = fat_get_first_cluster(drv, &curr.entry);
+	}
+
+	/* Found */
+	*out = curr;
+	hr = S_OK;
+
+finally:
+	return hr;
+}
+
+/*
+ * Splits `path` to it's parent directory, which has to exist, and the name of
+ * the last component (`name` has to hold MAX_FILENAME_LENGTH characters).
+ * Must be called with the driver lock held.
+ */
+static HRESULT fat16_parse_parent(K_FS_DRIVER *drv, char *path, uint32_t *dir_cluster, char *name)
+{
+	FAT16_DIR_LOC		loc;
+	char				parent[VFS_MAX_DIRNAME_LENGTH + 1];
+	char				*s = strrchr(path, VFS_PATH_DELIMITER);
+	uint32_t			len;
+	HRESULT				hr;
+
+	if (s == NULL || strlen(s + 1) >= MAX_FILENAME_LENGTH) {
+		return E_INVALIDARG;
+	}
+
+	strcpy(name, s + 1);
+	len = s - path;
+
+	if (len == 0) {
+		/* Item is in the root directory */
+		*dir_cluster = fat_get_root_cluster(drv);
+		return S_OK;
+	}
+
+	if (len > VFS_MAX_DIRNAME_LENGTH) {
+		return E_INVALIDARG;
+	}
+
+	memcpy(parent, path, len);
+	parent[len] = '\0';
+
+	hr = fat16_parse_url(drv, parent, &loc);
+	if (FAILED(hr)) return hr;
+
+	if ((loc.entry.attributes & FAT_ATTR_DIRECTORY) == 0) {
+		return E_NOTFOUND;
+	}
+
+	*dir_cluster = fat_get_first_cluster(drv, &loc.entry);
+	return S_OK;
+}
+
+/*
+ * Creates new instance of the FAT12/16/32 driver.
+ */
+static HRESULT
+fat16_init(K_FS_DRIVER *drv, char *storage_drv)
+{
+	FAT16_DRV_CONTEXT 	*c;
+	HRESULT				hr;
+
+	if (drv->priv_data != NULL) {
+		/* Driver already initialized, or uninitialized memory */
+		return E_FAIL;
+	}
+
+	/* Create driver context */
+	if (!(drv->priv_data = kcalloc(sizeof(FAT16_DRV_CONTEXT)))) {
+		return E_OUTOFMEM;
+	}
+
+	c = drv->priv_data;
+
+	/* Mount read-only if the device can't be written */
+	hr = k_fopen(storage_drv, FILE_OPEN_READWRITE, &c->storage_drv);
+	if (FAILED(hr)) {
+		hr = k_fopen(storage_drv, FILE_OPEN_READ, &c->storage_drv);
+		if (FAILED(hr)) return hr;
+
+		c->read_only = TRUE;
+	}
+
+	mutex_create(&c->lock);
+
+	/* Read BPB info */
+	hr = fat16_parse_bpb(drv);
+	if (FAILED(hr)) return E_FAIL;
+
+	if (c->fs_type == FS_TYPE_EXFAT) {
+		return E_NOTSUPPORTED;
+	}
+
+	/* Cache FAT table */
+	hr = fat16_cache_fat_table(drv);
+	if (FAILED(hr)) return hr;
+
+	if (!(c->fat_dirty = kcalloc(c->sectors_per_fat))) {
+		return E_OUTOFMEM;
+	}
+
+	/* Free cluster bitmap, then FSInfo, which is checked against it */
+	hr = fat16_build_free_map(drv);
+	if (FAILED(hr)) return hr;
+
+	hr = fat16_read_fsinfo(drv);
+	if (FAILED(hr)) return hr;
+
+	/* Assign FS ops */
+	drv->create 	= fat16_create;
+	drv->open 		= fat16_open;
+	drv->mkdir 		= fat16_mkdir;
+	drv->opendir 	= fat16_opendir;
+	drv->unlink		= fat16_unlink;
+	drv->rename		= fat16_rename;
+	drv->sync		= fat16_sync;
+	drv->finalize 	= fat16_fini;
+
+	/* Avoid warning for unused function */
+	UNUSED_ARG(fat_get_subitem_count); //TODO: remove if used.
+
+	return S_OK;
+}
+
+/*
+ * Cleans up before the FS driver is being destroyed.
+ */
+static HRESULT
+fat16_fini(K_FS_DRIVER *drv)
+{
+	FAT16_DRV_CONTEXT 	*ctx;
+
+	if (drv->priv_data == NULL) {
+		return E_FAIL;
+	}
+
+	ctx = drv->priv_data;
+
+	/* Write back the FAT and buffered sectors */
+	if (ctx->storage_drv != NULL && ctx->fat_cache != NULL && !ctx->read_only) {
+		mutex_lock(&ctx->lock);
+		fat16_flush_fat(drv);
+		mutex_unlock(&ctx->lock);
+
+		bcache_fsync(ctx->storage_drv);
+	}
+
+	/* Free FAT cache */
+	if (ctx->fat_cache) {
+		kfree(ctx->fat_cache);
+	}
+
+	if (ctx->fat_dirty) {
+		kfree(ctx->fat_dirty);
+	}
+
+	if (ctx->free_map) {
+		kfree(ctx->free_map);
+	}
+
+	/* Close storage driver handle */
+	if (ctx->storage_drv != NULL) {
+		k_fclose(&ctx->storage_drv);
+	}
+
+	mutex_destroy(&ctx->lock);
+
+	/* Cached directory entries, indexes and pages refer to this instance */
+	dcache_invalidate_owner(drv);
+	dirindex_invalidate_owner(drv);
+	pagecache_invalidate_owner(drv);
+
+	/* Free driver context */
+	kfree(drv->priv_data);
+
+	return S_OK;
+}
+
+K_FS_CONSTRUCTOR fat16_get_constructor()
+{
+	return fat16_init;
+}
+
+/*
+ * Self-test. Volumes are formatted on a RAM disk, a script of namespace and
+ * file operations is run through a driver instance, with remounts in between,
+ * and the image is checked for consistency after each unmount: chains against
+ * file sizes, cross-linked and lost clusters, FAT copies, long name sequences,
+ * "." and ".." entries and the FSInfo free count, like fsck.fat -n does.
+ */
+#define FAT_TEST_DEVICE			"/dev/fatram"
+#define FAT_TEST_MAX_SECTORS	4608
+#define FAT_TEST_CHUNK			700
+#define FAT_TEST_MAX_DEPTH		16
+
+typedef struct FAT_TEST_GEOMETRY FAT_TEST_GEOMETRY;
+struct FAT_TEST_GEOMETRY {
+	char		*name;
+	uint32_t	fat_bits;
+	uint32_t	sectors;
+	uint8_t		sectors_per_cluster;
+	uint16_t	reserved_sectors;
+	uint16_t	root_entries;
+	uint8_t		media;
+};
+
+static const FAT_TEST_GEOMETRY fat_test_volumes[] = {
+	/* 1.44 MB floppy */
+	{ "FAT12", 12, 2880, 1, 1, 224, 0xF0 },
+	{ "FAT16", 16, 4608, 1, 1, 512, 0xF8 },
+
+	/* Far below the 65525 clusters the specification asks for. The driver
+	 * tells FAT32 apart by the BPB, not by the cluster count. */
+	{ "FAT32", 32, 4608, 2, 32, 0, 0xF8 },
+};
+
+/* Image the RAM disk currently serves */
+static struct {
+	uint8_t		*data;
+	uint32_t	sectors;
+} fat_test_disk;
+
+static BOOL fat_test_disk_mounted = FALSE;
+
+#define FAT_TEST_MKDIR			0x01
+#define FAT_TEST_WRITE			0x02
+#define FAT_TEST_APPEND			0x03
+#define FAT_TEST_TRUNCATE		0x04
+#define FAT_TEST_RENAME			0x05
+#define FAT_TEST_UNLINK			0x06
+#define FAT_TEST_REMOUNT		0x07
+#define FAT_TEST_EXPECT			0x08
+#define FAT_TEST_MISSING		0x09
+#define FAT_TEST_COUNT			0x0A
+#define FAT_TEST_FILL			0x0B
+#define FAT_TEST_FILL_UNLINK	0x0C
+#define FAT_TEST_FILL_EXPECT	0x0D
+
+/*
+ * Step of the script. Written files hold fat_test_byte(seed, offset), files
+ * expected to have been grown by truncation hold zeroes from `zero_from` on.
+ * FILL steps work on `size` files named by the `path` format, the i-th one
+ * having i * 37 bytes. Those with an index of the parity in `seed` are
+ * unlinked, or expected to be missing.
+ */
+typedef struct FAT_TEST_OP FAT_TEST_OP;
+struct FAT_TEST_OP {
+	uint32_t	op;
+	char		*path;
+	char		*path2;
+	uint32_t	size;
+	uint32_t	seed;
+	uint32_t	zero_from;
+};
+
+static const FAT_TEST_OP fat_test_script[] = {
+	{ FAT_TEST_MKDIR,		"/Docs", NULL, 0, 0, 0 },
+	{ FAT_TEST_WRITE,		"/Docs/A long file name.txt", NULL, 3000, 1, 0 },
+	{ FAT_TEST_APPEND,		"/Docs/A long file name.txt", NULL, 6000, 1, 0 },
+	{ FAT_TEST_TRUNCATE,	"/Docs/A long file name.txt", NULL, 5000, 0, 0 },
+	{ FAT_TEST_TRUNCATE,	"/Docs/A long file name.txt", NULL, 6500, 0, 0 },
+	{ FAT_TEST_WRITE,		"/KEEP.BIN", NULL, 1000, 2, 0 },
+	{ FAT_TEST_WRITE,		"/gone.txt", NULL, 4000, 3, 0 },
+	{ FAT_TEST_UNLINK,		"/gone.txt", NULL, 0, 0, 0 },
+
+	/* Grows /Docs past a cluster, then leaves holes in it */
+	{ FAT_TEST_FILL,		"/Docs/Entry number %d.dat", NULL, 24, 0, 0 },
+	{ FAT_TEST_FILL_UNLINK,	"/Docs/Entry number %d.dat", NULL, 24, 0, 0 },
+
+	{ FAT_TEST_RENAME,		"/Docs/A long file name.txt", "/Moved file.txt", 0, 0, 0 },
+	{ FAT_TEST_RENAME,		"/KEEP.BIN", "/Docs/keep.bin", 0, 0, 0 },
+	{ FAT_TEST_MKDIR,		"/Docs/Sub", NULL, 0, 0, 0 },
+	{ FAT_TEST_WRITE,		"/Docs/Sub/inner.txt", NULL, 1500, 4, 0 },
+	{ FAT_TEST_RENAME,		"/Docs/Sub", "/Sub", 0, 0, 0 },
+
+	/* Everything has to be read back from the image */
+	{ FAT_TEST_REMOUNT,		"/", NULL, 0, 0, 0 },
+	{ FAT_TEST_EXPECT,		"/Moved file.txt", NULL, 6500, 1, 5000 },
+	{ FAT_TEST_EXPECT,		"/Docs/keep.bin", NULL, 1000, 2, 1000 },
+	{ FAT_TEST_EXPECT,		"/Sub/inner.txt", NULL, 1500, 4, 1500 },
+	{ FAT_TEST_MISSING,		"/Docs/A long file name.txt", NULL, 0, 0, 0 },
+	{ FAT_TEST_MISSING,		"/KEEP.BIN", NULL, 0, 0, 0 },
+	{ FAT_TEST_MISSING,		"/gone.txt", NULL, 0, 0, 0 },
+	{ FAT_TEST_MISSING,		"/Docs/Sub", NULL, 0, 0, 0 },
+	{ FAT_TEST_FILL_EXPECT,	"/Docs/Entry number %d.dat", NULL, 24, 0, 0 },
+	{ FAT_TEST_COUNT,		"/Docs", NULL, 13, 0, 0 },
+
+	/* Delete everything, the volume has to end up empty */
+	{ FAT_TEST_UNLINK,		"/Moved file.txt", NULL, 0, 0, 0 },
+	{ FAT_TEST_UNLINK,		"/Docs/keep.bin", NULL, 0, 0, 0 },
+	{ FAT_TEST_FILL_UNLINK,	"/Docs/Entry number %d.dat", NULL, 24, 1, 0 },
+	{ FAT_TEST_UNLINK,		"/Sub/inner.txt", NULL, 0, 0, 0 },
+	{ FAT_TEST_UNLINK,		"/Sub", NULL, 0, 0, 0 },
+	{ FAT_TEST_UNLINK,		"/Docs", NULL, 0, 0, 0 },
+	{ FAT_TEST_COUNT,		"/", NULL, 0, 0, 0 },
+};
+
+static const char *fat_test_op_names[] = {
+	"", "mkdir", "write", "append", "truncate", "rename", "unlink", "remount",
+	"read back", "lookup", "readdir", "fill", "unlink", "read back"
+};
+
+static uint8_t fat_test_byte(uint32_t seed, uint32_t offset)
+{
+	return (uint8_t)(seed * 0x9D + offset * 7 + (offset >> 8));
+}
+
+/*
+ * RAM disk IOCTL handler.
+ */
+static HRESULT fat_test_disk_ioctl(K_STREAM *s, uint32_t code, void *arg)
+{
+	IOCTL_STORAGE_READWRITE *rw = arg;
+
+	UNUSED_ARG(s);
+
+	switch (code) {
+		case IOCTL_STORAGE_READ_BLOCKS:
+		case IOCTL_STORAGE_WRITE_BLOCKS:
+			if (fat_test_disk.data == NULL || rw->start > fat_test_disk.sectors || rw->count > fat_test_disk.sectors - rw->start) {
+				return E_INVALIDARG;
+			}
+
+			if (code == IOCTL_STORAGE_READ_BLOCKS) {
+				memcpy(rw->buffer, fat_test_disk.data + rw->start * 512, rw->count * 512);
+			} else {
+				memcpy(fat_test_disk.data + rw->start * 512, rw->buffer, rw->count * 512);
+			}
+			break;
+
+		case IOCTL_STORAGE_GET_BLOCK_SIZE:
+			*(size_t*)arg = 512;
+			break;
+
+		case IOCTL_STORAGE_GET_BLOCK_COUNT:
+			*(size_t*)arg = fat_test_disk.sectors;
+			break;
 
-	/* Read blocks */
-	hr = fat16_read_file_content(drv, entry, start_addr, block_cnt * block_size, sc->cache_buff);
-	if (FAILED(hr)) return hr;
+		case DEVIO_OPEN:
+		case DEVIO_CLOSE:
+			return S_OK;
 
-	/* Update cache parameters */
-	sc->cache_start_addr = start_addr;
-	sc->cache_size = block_cnt * block_size;
-	sc->cache_invalid = FALSE;
+		default:
+			return E_NOTSUPPORTED;
+	}
 
-	/* Success */
 	return S_OK;
 }
 
 /*
- * Reads `block_size` bytes from an opened file stream.
+ * The RAM disk is mounted once and serves whatever image is assigned to it,
+ * since devices can't be unmounted.
  */
-static HRESULT fat16_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
+static HRESULT fat_test_disk_mount()
 {
-	FAT16_STR_CONTEXT 	*strctx = str->priv_data;
-	FAT16_DIR_ENTRY		*entry = &strctx->entry;
-	uint32_t			effective_size = block_size;
-	HRESULT				hr;
-
-	/* Validate input parameters */
-	if (block_size == 0) {
-		return E_INVALIDARG;
-	}
+	K_DEVICE	dev;
+	HRESULT		hr;
 
-	if (!out_buf) {
-		return E_POINTER;
+	if (fat_test_disk_mounted) {
+		return S_OK;
 	}
 
-	/* Lock stream mutex */
-	mutex_lock(&str->lock);
-
-	if (block_size + str->pos >= entry->size) {
-		effective_size = entry->size - str->pos;
-	}
+	memset(&dev, 0, sizeof(dev));
+	dev.default_url = FAT_TEST_DEVICE;
+	dev.type		= DEVICE_TYPE_BLOCK;
+	dev.class		= DEVICE_CLASS_STORAGE;
+	dev.ioctl		= fat_test_disk_ioctl;
 
-	if (effective_size == 0) {
-		/* End of file */
-		if (bytes_read) *bytes_read = 0;
-		hr = E_ENDOFSTR;
+	hr = vfs_mount_device(&dev, dev.default_url);
+	if (FAILED(hr)) return hr;
 
-		goto finally;
-	}
+	fat_test_disk_mounted = TRUE;
+	return S_OK;
+}
 
-	/* Read content */
-	//hr = fat16_read_file_content_DEPRECATED(drv, entry, str->pos, effective_size, out_buf);
-	hr = fat16_read_subblock(str, entry, str->pos, effective_size, out_buf);
-	if (FAILED(hr)) goto finally;
+/*
+ * Drops buffered sectors of the RAM disk, so the next mount reads the image.
+ */
+static HRESULT fat_test_disk_forget()
+{
+	K_STREAM	*s;
+	HRESULT		hr;
 
-	/* Move position */
-	str->pos += effective_size;
+	hr = k_fopen(FAT_TEST_DEVICE, FILE_OPEN_READWRITE, &s);
+	if (FAILED(hr)) return hr;
 
-	/* Set output parameter */
-	if (bytes_read) *bytes_read = effective_size;
+	hr = bcache_invalidate(s);
+	k_fclose(&s);
 
-finally:
-	mutex_unlock(&str->lock);
 	return hr;
 }
 
-/*
- * Writes `block_size` bytes to file.
- */
-static HRESULT fat16_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written)
+static uint32_t fat_test_get(uint8_t *fat, uint32_t bits, uint32_t n)
 {
-	UNUSED_ARG(str);
-	UNUSED_ARG(block_size);
-	UNUSED_ARG(in_buf);
-	UNUSED_ARG(bytes_written);
+	switch (bits) {
+		case 12:
+			if (n & 1) return (fat[n + n / 2] | (fat[n + n / 2 + 1] << 8)) >> 4;
+			return (fat[n + n / 2] | (fat[n + n / 2 + 1] << 8)) & 0x0FFF;
+
+		case 16:
+			return ((uint16_t*)fat)[n];
 
-	return E_NOTIMPL;
+		default:
+			return ((uint32_t*)fat)[n] & 0x0FFFFFFF;
+	}
 }
 
-/*
- * IOCTL stub. Doesn't do anything, since IOCTL is used only for
- * devices/drivers.
- */
-static HRESULT fat16_file_ioctl(K_STREAM *s, uint32_t code, void *arg)
+static void fat_test_set(uint8_t *fat, uint32_t bits, uint32_t n, uint32_t value)
 {
-	UNUSED_ARG(s);
-	UNUSED_ARG(code);
-	UNUSED_ARG(arg);
+	uint8_t *p;
+
+	switch (bits) {
+		case 12:
+			p = &fat[n + n / 2];
+
+			if (n & 1) {
+				p[0] = (p[0] & 0x0F) | ((value << 4) & 0xF0);
+				p[1] = (uint8_t)(value >> 4);
+			} else {
+				p[0] = (uint8_t)value;
+				p[1] = (p[1] & 0xF0) | ((value >> 8) & 0x0F);
+			}
+			break;
 
-	return E_UNEXPECTED;
+		case 16:
+			((uint16_t*)fat)[n] = (uint16_t)value;
+			break;
+
+		default:
+			((uint32_t*)fat)[n] = value & 0x0FFFFFFF;
+			break;
+	}
 }
 
 /*
- * Moves the file stream position according to the given arguments.
+ * Formats an image the way mkfs.fat would with the given geometry.
  */
-static uint32_t fat16_file_seek(K_STREAM *s, int64_t pos, int8_t origin)
+static void fat_test_format(const FAT_TEST_GEOMETRY *g, uint8_t *img)
 {
-	FAT16_STR_CONTEXT 	*strctx = s->priv_data;
-	FAT16_DIR_ENTRY		*entry 	= &strctx->entry;
-	HRESULT 			hr 		= S_OK;
-	int32_t 			new_pos;
-
-	mutex_lock(&s->lock);
+	FAT16_BPB	*bpb = (FAT16_BPB*)img;
+	uint32_t	root_sectors = (g->root_entries * sizeof(FAT16_DIR_ENTRY) + 511) / 512;
+	uint32_t	fat_sectors = 1, clusters, need, i;
+	uint8_t		*fat;
 
-	switch (origin) {
-	case KSTREAM_ORIGIN_BEGINNING:
-		new_pos = pos;
-		break;
+	memset(img, 0, g->sectors * 512);
 
-	case KSTREAM_ORIGIN_CURRENT:
-		new_pos =  s->pos + pos;
-		break;
+	/* Smallest FAT which maps all clusters */
+	for (;;) {
+		clusters = (g->sectors - g->reserved_sectors - 2 * fat_sectors - root_sectors) / g->sectors_per_cluster;
+		need = (((clusters + 2) * g->fat_bits + 7) / 8 + 511) / 512;
 
-	case KSTREAM_ORIGIN_END:
-		new_pos = entry->size - pos;
-		break;
+		if (need <= fat_sectors) break;
+		fat_sectors = need;
+	}
 
-	default:
-		hr = E_INVALIDARG;
-		goto finally;
+	bpb->magic[0] = 0xEB;
+	bpb->magic[1] = g->fat_bits == 32 ? 0x58 : 0x3C;
+	bpb->magic[2] = 0x90;
+	memcpy(bpb->OEM_ID, "ANTONIX ", 8);
+
+	bpb->bytes_per_sector		= 512;
+	bpb->sectors_per_cluster	= g->sectors_per_cluster;
+	bpb->reserved_sectors		= g->reserved_sectors;
+	bpb->FAT_count				= 2;
+	bpb->root_entries			= g->root_entries;
+	bpb->num_sectors_16			= g->sectors;
+	bpb->media_descriptor		= g->media;
+	bpb->sectors_per_track		= 18;
+	bpb->heads					= 2;
+
+	if (g->fat_bits == 32) {
+		FAT32_EBPB		*ebpb = (FAT32_EBPB*)(img + sizeof(FAT16_BPB));
+		FAT32_FSINFO	*fsinfo = (FAT32_FSINFO*)(img + 512);
+
+		ebpb->sectors_per_FAT		= fat_sectors;
+		ebpb->root_cluster			= 2;
+		ebpb->fsinfo_sector			= 1;
+		ebpb->backup_boot_sector	= 6;
+		ebpb->drive_number			= 0x80;
+		ebpb->signature				= 0x29;
+		ebpb->volume_id				= 0x20160923;
+		memcpy(ebpb->volume_label, "NO NAME    ", 11);
+		memcpy(ebpb->fs_identifier, "FAT32   ", 8);
+
+		/* The root directory takes the first cluster */
+		fsinfo->lead_signature	= FAT32_FSINFO_LEAD_SIG;
+		fsinfo->struc_signature	= FAT32_FSINFO_STRUC_SIG;
+		fsinfo->free_count		= clusters - 1;
+		fsinfo->next_free		= 3;
+		fsinfo->trail_signature	= FAT32_FSINFO_TRAIL_SIG;
+	} else {
+		FAT16_EBPB		*ebpb = (FAT16_EBPB*)(img + sizeof(FAT16_BPB));
+
+		bpb->sectors_per_FAT		= fat_sectors;
+		ebpb->drive_number			= g->media == 0xF0 ? 0x00 : 0x80;
+		ebpb->signature				= 0x29;
+		ebpb->volume_id				= 0x20160923;
+		memcpy(ebpb->volume_label, "NO NAME    ", 11);
+		memcpy(ebpb->fs_identifier, g->fat_bits == 12 ? "FAT12   " : "FAT16   ", 8);
 	}
 
-	if (new_pos < 0 || new_pos > (int32_t)entry->size) {
-		hr = E_INVALIDARG;
-		goto finally;
+	img[510] = 0x55;
+	img[511] = 0xAA;
+
+	if (g->fat_bits == 32) {
+		/* Backup boot sector and FSInfo */
+		memcpy(img + 6 * 512, img, 2 * 512);
 	}
 
-	s->pos = new_pos;
+	for (i=0; i<2; i++) {
+		fat = img + (g->reserved_sectors + i * fat_sectors) * 512;
 
-finally:
-	mutex_unlock(&s->lock);
-	return hr;
+		fat_test_set(fat, g->fat_bits, 0, 0x0FFFFF00 | g->media);
+		fat_test_set(fat, g->fat_bits, 1, 0x0FFFFFFF);
+
+		if (g->fat_bits == 32) {
+			fat_test_set(fat, g->fat_bits, 2, 0x0FFFFFFF);
+		}
+	}
 }
 
 /*
- * Retrieves the current position of the file stream.
+ * State of a consistency check.
  */
-static uint32_t fat16_file_tell(K_STREAM *s)
+typedef struct FAT_TEST_CHECK FAT_TEST_CHECK;
+struct FAT_TEST_CHECK {
+	const char	*name;
+	uint8_t		*img;
+	uint8_t		*fat;
+	uint32_t	bits;
+	uint32_t	cluster_size;
+	uint32_t	data_sector;
+	uint32_t	root_sector;
+	uint32_t	root_entries;
+	uint32_t	root_cluster;
+	uint32_t	clusters;
+
+	/* One flag per cluster, set once a chain was found to use it */
+	uint8_t		*used;
+	uint32_t	errors;
+};
+
+static BOOL fat_test_is_eoc(FAT_TEST_CHECK *chk, uint32_t value)
 {
-	uint32_t current_pos;
-
-	mutex_lock(&s->lock);
-	current_pos = s->pos;
-	mutex_unlock(&s->lock);
-
-	return current_pos;
+	switch (chk->bits) {
+		case 12:	return value >= 0xFF8;
+		case 16:	return value >= 0xFFF8;
+		default:	return value >= 0x0FFFFFF8;
+	}
 }
 
 /*
- * Concatenates the filename with the file extension putting
- * a dot in between.
+ * Follows a chain, marking it's clusters as used. Returns the number of
+ * clusters up to the first error.
  */
-static void	fat_copy_short_filename(FAT16_DIR_ENTRY *entry, char *dst)
+static uint32_t fat_test_walk(FAT_TEST_CHECK *chk, const char *path, uint32_t cluster)
 {
-	uint32_t i, dst_index = 0;
+	uint32_t count = 0;
 
-	/* Copy name */
-	for (i=0; i<8; i++) {
-		if (entry->filename[i] != ' ') {
-			dst[dst_index++] = entry->filename[i];
-		} else {
+	for (;;) {
+		if (cluster < 2 || cluster > chk->clusters + 1) {
+			k_printf("%s: %s: chain runs into cluster %d\n", chk->name, path, cluster);
+			chk->errors++;
 			break;
 		}
-	}
-
-	/* Insert dot */
-	if (entry->ext[0] != ' ')
-	dst[dst_index++] = '.';
 
-	/* Copy extension */
-	for (i=0; i<3; i++) {
-		if (entry->ext[i] != ' ') {
-			dst[dst_index++] = entry->ext[i];
-		} else {
+		if (chk->used[cluster]) {
+			k_printf("%s: %s: cluster %d is cross-linked\n", chk->name, path, cluster);
+			chk->errors++;
 			break;
 		}
+
+		chk->used[cluster] = 1;
+		count++;
+
+		cluster = fat_test_get(chk->fat, chk->bits, cluster);
+		if (fat_test_is_eoc(chk, cluster)) break;
 	}
 
-	dst[dst_index++] = '\0';
+	return count;
 }
 
-/*
- * Figures out the type of the FAT file system based on few parameters.
- */
-static uint32_t
-fat_get_type(K_FS_DRIVER *drv)
+static uint8_t fat_test_lfn_checksum(const uint8_t *short_name)
 {
-	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
+	uint8_t		sum = 0;
+	uint32_t	i;
 
-	if (ctx->total_cluster_cnt < 4085) {
-		return FS_TYPE_FAT12;
-	} else if (ctx->total_cluster_cnt < 65525) {
-		return FS_TYPE_FAT16;
-	} else if (ctx->total_cluster_cnt < 268435445) {
-		return FS_TYPE_FAT32;
+	for (i=0; i<11; i++) {
+		sum = ((sum & 1) << 7) + (sum >> 1) + short_name[i];
 	}
 
-	return FS_TYPE_EXFAT;
+	return sum;
 }
 
-/*
- * Returns size of the root dir content in bytes.
- */
-static uint32_t fat_get_rootdir_size(K_FS_DRIVER *drv)
+static uint32_t fat_test_first_cluster(FAT_TEST_CHECK *chk, FAT16_DIR_ENTRY *e)
 {
-	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
-	return ctx->bpb.root_entries * sizeof(FAT16_DIR_ENTRY);
+	return (chk->bits == 32 ? (uint32_t)e->first_clust_high << 16 : 0) | e->first_clust_low;
 }
 
 /*
- * Iterates all directory entries and count the actual number
- * of sub-items (files and directories) for the given directory.
+ * Checks the entries of a directory, and the directories below it.
+ * `cluster` is 0 for the FAT12/16 root directory.
  */
-static uint32_t fat_get_subitem_count(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry_arr, uint32_t entries_max)
+static void fat_test_check_dir(FAT_TEST_CHECK *chk, const char *path, uint32_t cluster, uint32_t parent, uint32_t depth)
 {
-	uint32_t			i, cnt=0;
+	FAT16_DIR_ENTRY		*entries, *e;
+	FAT_LFN_ENTRY		*lfn;
+	char				child[128], short_name[13];
+	BOOL				is_root = depth == 0;
+	BOOL				in_lfn = FALSE;
+	uint32_t			count, n, i, j, c, first, lfn_next = 0;
+	uint8_t				lfn_sum = 0;
+
+	if (cluster == 0) {
+		entries = (FAT16_DIR_ENTRY*)(chk->img + chk->root_sector * 512);
+		count	= chk->root_entries;
+	} else {
+		n = fat_test_walk(chk, path, cluster);
 
-	UNUSED_ARG(drv);
+		if (!(entries = kmalloc(n * chk->cluster_size))) {
+			chk->errors++;
+			return;
+		}
 
-	for (i=0; i<entries_max; i++) {
-		if (entry_arr[i].filename[0] == 0xE5) {
-			/* Sub-item is deleted */
+		/* The chain was just walked, so it's good for `n` clusters */
+		for (i=0, c=cluster; i<n; i++) {
+			memcpy((uint8_t*)entries + i * chk->cluster_size, chk->img + (chk->data_sector + (c - 2) * (chk->cluster_size / 512)) * 512, chk->cluster_size);
+			c = fat_test_get(chk->fat, chk->bits, c);
+		}
+
+		count = n * chk->cluster_size / sizeof(FAT16_DIR_ENTRY);
+	}
+
+	for (i=0; i<count; i++) {
+		e = &entries[i];
+
+		if (e->filename[0] == 0x00) break;
+
+		if (e->filename[0] == 0xE5 || e->attributes == FAT_ATTR_LFN || (e->attributes & FAT_ATTR_VOLUMEL) != 0) {
+			if (e->filename[0] != 0xE5 && e->attributes == FAT_ATTR_LFN) {
+				lfn = (FAT_LFN_ENTRY*)e;
+
+				if ((lfn->order & FAT_LFN_LAST) != 0) {
+					if (in_lfn) goto bad_lfn;
+
+					in_lfn		= TRUE;
+					lfn_next	= (lfn->order & 0x1F) - 1;
+					lfn_sum		= lfn->checksum;
+				} else if (!in_lfn || lfn->order != lfn_next || lfn->checksum != lfn_sum) {
+					goto bad_lfn;
+				} else {
+					lfn_next--;
+				}
+
+				continue;
+			}
+
+			if (in_lfn) goto bad_lfn;
 			continue;
 		}
 
-		if (entry_arr[i].filename[0] == 0x00) {
-			/* End of list */
-			break;
+		/* "." and ".." lead every directory but the root */
+		if (!is_root && i < 2) {
+			if (memcmp(e->filename, i == 0 ? ".          " : "..         ", 11) != 0 ||
+					fat_test_first_cluster(chk, e) != (i == 0 ? cluster : parent)) {
+				k_printf("%s: %s: bad \"%s\" entry\n", chk->name, path, i == 0 ? "." : "..");
+				chk->errors++;
+			}
+
+			continue;
 		}
 
-		cnt++;
+		if (in_lfn && (lfn_next != 0 || fat_test_lfn_checksum(e->filename) != lfn_sum)) {
+			goto bad_lfn;
+		}
+
+		in_lfn = FALSE;
+
+		/* Short names are upper case */
+		for (j=0; j<11; j++) {
+			c = e->filename[j];
+
+			if ((c < 0x20 && !(j == 0 && c == 0x05)) || (c >= 'a' && c <= 'z')) {
+				k_printf("%s: %s: bad short name in entry %d\n", chk->name, path, i);
+				chk->errors++;
+				break;
+			}
+		}
+
+		for (j=is_root ? 0 : 2; j<i; j++) {
+			if (entries[j].filename[0] != 0xE5 && (entries[j].attributes & FAT_ATTR_VOLUMEL) == 0 &&
+					memcmp(entries[j].filename, e->filename, 11) == 0) {
+				k_printf("%s: %s: entries %d and %d have the same short name\n", chk->name, path, j, i);
+				chk->errors++;
+			}
+		}
+
+		fat_copy_short_filename(e, short_name);
+		snprintf(child, sizeof(child), "%s/%s", path, short_name);
+		first = fat_test_first_cluster(chk, e);
+
+		if ((e->attributes & FAT_ATTR_DIRECTORY) != 0) {
+			if (first == 0 || e->size != 0 || depth >= FAT_TEST_MAX_DEPTH) {
+				k_printf("%s: %s: bad directory entry\n", chk->name, child);
+				chk->errors++;
+				continue;
+			}
+
+			fat_test_check_dir(chk, child, first, is_root ? 0 : cluster, depth + 1);
+			continue;
+		}
+
+		n = first == 0 ? 0 : fat_test_walk(chk, child, first);
+
+		if (n != (e->size + chk->cluster_size - 1) / chk->cluster_size) {
+			k_printf("%s: %s: %d clusters for %d bytes\n", chk->name, child, n, e->size);
+			chk->errors++;
+		}
+
+		continue;
+
+bad_lfn:
+		k_printf("%s: %s: broken long name sequence at entry %d\n", chk->name, path, i);
+		chk->errors++;
+		in_lfn = FALSE;
 	}
 
-	return cnt;
+	if (in_lfn) {
+		k_printf("%s: %s: long name without a short entry\n", chk->name, path);
+		chk->errors++;
+	}
+
+	if (cluster != 0) {
+		kfree(entries);
+	}
 }
 
 /*
- * Counts clusters in a chain starting from the given cluster id.
+ * Checks the image, returning the number of free and usable clusters.
  */
-static uint32_t fat_count_chain(K_FS_DRIVER *drv, uint32_t first_cluster)
+static HRESULT fat_test_check(const char *name, uint8_t *img, uint32_t *free_out, uint32_t *usable_out)
 {
-	FAT16_DRV_CONTEXT 	*ctx 	= drv->priv_data;
-	uint32_t			current = first_cluster;
-	uint32_t			count 	= 0;
-	HRESULT				hr;
+	FAT16_BPB			*bpb = (FAT16_BPB*)img;
+	FAT32_EBPB			*ebpb32 = (FAT32_EBPB*)(img + sizeof(FAT16_BPB));
+	FAT32_FSINFO		*fsinfo;
+	FAT_TEST_CHECK		chk;
+	uint32_t			fat_sectors, sectors, i, lost = 0, free = 0;
+
+	memset(&chk, 0, sizeof(chk));
+
+	fat_sectors		= bpb->sectors_per_FAT != 0 ? bpb->sectors_per_FAT : ebpb32->sectors_per_FAT;
+	sectors			= bpb->num_sectors_16 != 0 ? bpb->num_sectors_16 : bpb->num_sectors_32;
+
+	chk.name			= name;
+	chk.img				= img;
+	chk.fat				= img + bpb->reserved_sectors * 512;
+	chk.cluster_size	= bpb->sectors_per_cluster * 512;
+	chk.root_sector		= bpb->reserved_sectors + bpb->FAT_count * fat_sectors;
+	chk.root_entries	= bpb->root_entries;
+	chk.data_sector		= chk.root_sector + (bpb->root_entries * sizeof(FAT16_DIR_ENTRY) + 511) / 512;
+	chk.clusters		= (sectors - chk.data_sector) / bpb->sectors_per_cluster;
+
+	if (bpb->sectors_per_FAT == 0) {
+		chk.bits			= 32;
+		chk.root_cluster	= ebpb32->root_cluster;
+	} else {
+		chk.bits			= chk.clusters < 4085 ? 12 : 16;
+	}
 
-	if (first_cluster == 0x00) {
-		/* Unused cluster */
-		return 0;
+	if (!(chk.used = kcalloc(chk.clusters + 2))) {
+		return E_OUTOFMEM;
 	}
 
-	while (!fat_is_end_of_chain(drv, current)) {
-		hr = fat16_fat_lookup(drv, current, &current);
-		if (FAILED(hr)) return 0;
+	/* Copies of the FAT */
+	for (i=1; i<bpb->FAT_count; i++) {
+		if (memcmp(chk.fat, chk.fat + i * fat_sectors * 512, fat_sectors * 512) != 0) {
+			k_printf("%s: FAT copy %d differs\n", name, i + 1);
+			chk.errors++;
+		}
+	}
 
-		count++;
+	/* Directory tree */
+	fat_test_check_dir(&chk, "", chk.root_cluster, 0, 0);
 
-		/* Break out of defective (cyclic) chains */
-		if (count == ctx->total_cluster_cnt) {
-			count = 0;
-			break;
+	for (i=2; i<chk.clusters + 2; i++) {
+		if (fat_test_get(chk.fat, chk.bits, i) == 0) {
+			free++;
+		} else if (!chk.used[i]) {
+			lost++;
+		}
+	}
+
+	if (lost > 0) {
+		k_printf("%s: %d lost clusters\n", name, lost);
+		chk.errors++;
+	}
+
+	if (chk.bits == 32) {
+		fsinfo = (FAT32_FSINFO*)(img + ebpb32->fsinfo_sector * 512);
+
+		if (fsinfo->lead_signature != FAT32_FSINFO_LEAD_SIG || fsinfo->struc_signature != FAT32_FSINFO_STRUC_SIG ||
+				fsinfo->trail_signature != FAT32_FSINFO_TRAIL_SIG) {
+			k_printf("%s: bad FSInfo signature\n", name);
+			chk.errors++;
+		} else if (fsinfo->free_count != FAT32_FSINFO_UNKNOWN && fsinfo->free_count != free) {
+			k_printf("%s: FSInfo has %d free clusters, FAT has %d\n", name, fsinfo->free_count, free);
+			chk.errors++;
 		}
 	}
 
-	return count;
+	kfree(chk.used);
+
+	*free_out	= free;
+	*usable_out	= chk.clusters - (chk.bits == 32 ? 1 : 0);
+
+	return chk.errors == 0 ? S_OK : E_FAIL;
+}
+
+static HRESULT fat_test_mount(K_FS_DRIVER **out)
+{
+	K_FS_DRIVER	*drv;
+	HRESULT		hr;
+
+	if (!(drv = kcalloc(sizeof(K_FS_DRIVER)))) {
+		return E_OUTOFMEM;
+	}
+
+	hr = fat16_init(drv, FAT_TEST_DEVICE);
+	if (FAILED(hr)) {
+		if (drv->priv_data) fat16_fini(drv);
+		kfree(drv);
+		return hr;
+	}
+
+	*out = drv;
+	return S_OK;
+}
+
+static VOID fat_test_unmount(K_FS_DRIVER **drv)
+{
+	fat16_fini(*drv);
+	kfree(*drv);
+
+	*drv = NULL;
 }
 
 /*
- * Returns the first data cluster of a DIR entry.
+ * Writes `size` bytes of pattern `seed` at `offset`, in chunks which don't
+ * line up with sectors.
  */
-static uint32_t	fat_get_first_cluster(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *entry)
+static HRESULT fat_test_write(K_STREAM *s, uint32_t offset, uint32_t size, uint32_t seed, uint8_t *buf)
 {
-	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
-	uint32_t			result = 0;
+	uint32_t	pos, n, i;
+	size_t		done;
+	HRESULT		hr;
 
-	switch (ctx->fs_type) {
-		case FS_TYPE_FAT12:
-		case FS_TYPE_FAT16:
-			result = entry->first_clust_low;
-			break;
+	for (pos=offset; pos<offset + size; pos+=n) {
+		n = offset + size - pos < FAT_TEST_CHUNK ? offset + size - pos : FAT_TEST_CHUNK;
 
-		case FS_TYPE_FAT32:
-			result = (entry->first_clust_high << 16) | (entry->first_clust_low);
-			break;
+		for (i=0; i<n; i++) {
+			buf[i] = fat_test_byte(seed, pos + i);
+		}
 
-		default:
-			HalKernelPanic("fat_get_entry_start_cluster(): unsupported fs.");
+		hr = k_fpwrite(s, pos, n, buf, &done);
+		if (FAILED(hr)) return hr;
+		if (done != n) return E_FAIL;
 	}
 
-	return result;
+	return S_OK;
 }
 
 /*
- * Parses the BIOS Parameter Block from the Boot Record.
+ * Reads a file back. Has to be `size` bytes long, pattern `seed` followed
+ * by zeroes from `zero_from` on.
  */
-static HRESULT
-fat16_parse_bpb(K_FS_DRIVER *drv)
+static HRESULT fat_test_verify(K_FS_DRIVER *drv, char *path, uint32_t size, uint32_t seed, uint32_t zero_from, uint8_t *buf)
 {
-	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
-	HRESULT 			hr;
-	size_t				block_size;
-	uint8_t				*buff;
-	uint32_t			root_dir_sectors;
+	K_STREAM	*s;
+	uint32_t	pos, i;
+	size_t		done;
+	HRESULT		hr;
 
-	hr = storage_get_block_size(ctx->storage_drv, &block_size);
+	hr = drv->open(drv, path, FILE_OPEN_READ, &s);
 	if (FAILED(hr)) return hr;
 
-	/* Allocate temporary buffer */
-	if (!(buff = kmalloc(block_size))) {
-		return E_OUTOFMEM;
+	for (pos=0; pos<size; pos+=done) {
+		hr = k_fpread(s, pos, FAT_TEST_CHUNK, buf, &done);
+		if (FAILED(hr)) goto finally;
+
+		if (done == 0 || pos + done > size) {
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		for (i=0; i<done; i++) {
+			if (buf[i] != (pos + i >= zero_from ? 0 : fat_test_byte(seed, pos + i))) {
+				hr = E_FAIL;
+				goto finally;
+			}
+		}
 	}
 
-	/* Read boot record */
-	hr = storage_read_blocks(ctx->storage_drv, 0, 1, buff);
-	if (FAILED(hr)) goto finally;
+	/* Nothing past the end */
+	hr = k_fpread(s, size, FAT_TEST_CHUNK, buf, &done);
+	hr = (hr == S_OK || hr == E_ENDOFSTR) && done == 0 ? S_OK : E_FAIL;
 
-	/* Copy appropriate data to BPB buffer */
-	memcpy(&ctx->bpb, buff, sizeof(FAT16_BPB));
-	memcpy(&ctx->ebpb, buff+sizeof(FAT16_BPB), sizeof(FAT16_EBPB));
+finally:
+	k_fclose(&s);
+	return hr;
+}
 
-	/* Initialize remaining fields */
-	ctx->total_sectors 		= ctx->bpb.num_sectors_16 > 0 ? ctx->bpb.num_sectors_16 : ctx->bpb.num_sectors_32;
+static HRESULT fat_test_count(K_FS_DRIVER *drv, char *path, uint32_t expected)
+{
+	K_DIR_STREAM	*ds;
+	K_FS_NODE_INFO	info;
+	char			name[MAX_FILENAME_LENGTH];
+	uint32_t		count = 0;
+	HRESULT			hr;
 
-	root_dir_sectors 		= (fat_get_rootdir_size(drv) + (ctx->bpb.bytes_per_sector - 1)) / ctx->bpb.bytes_per_sector;
-	ctx->first_data_sector 	= ctx->bpb.reserved_sectors + (ctx->bpb.FAT_count * ctx->bpb.sectors_per_FAT) + root_dir_sectors;
-	ctx->first_fat_sector  	= ctx->bpb.reserved_sectors;
-	ctx->first_root_sector	= ctx->first_fat_sector + ctx->bpb.FAT_count * ctx->bpb.sectors_per_FAT; //sector
+	hr = drv->opendir(drv, path, &ds);
+	if (FAILED(hr)) return hr;
 
-	ctx->data_sector_cnt 	= ctx->total_sectors - ctx->bpb.reserved_sectors - ctx->bpb.FAT_count * ctx->bpb.sectors_per_FAT - root_dir_sectors;
-	ctx->total_cluster_cnt	= ctx->data_sector_cnt / ctx->bpb.sectors_per_cluster;
+	while (k_readdir(ds, name, &info) == S_OK) {
+		if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0) {
+			count++;
+		}
+	}
 
-	/* fat_get_type() uses `ctx->total_cluster_cnt` field, so it has to be invoked
-	 * after it is properly evaluated.
-	 */
-	ctx->fs_type 			= fat_get_type(drv);
+	k_closedir(&ds);
 
-finally:
-	kfree(buff);
-	return hr;
+	return count == expected ? S_OK : E_FAIL;
 }
 
-/*
- * Retrieves directory content for `dir` and iterates it's sub-items to find a specific
- * one with given filename and flags.
- *
- * If a match is found, it is returned copied to `dst`.
- */
-static HRESULT fat16_find_subentry(K_FS_DRIVER *drv, FAT16_DIR_ENTRY *dir, char *filename, uint32_t flagmask, BOOL skip_vlabel, FAT16_DIR_ENTRY *dst)
+static HRESULT fat_test_step(K_FS_DRIVER **drv, const FAT_TEST_OP *op, const char *name, uint8_t *img, uint8_t *buf)
 {
-	FAT16_DRV_CONTEXT 	*ctx = drv->priv_data;
-	FAT16_DIR_ENTRY		*buf;
-	uint32_t			entry_cnt;
-	uint32_t			content_size;
-	char				fn_buff[13] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-	uint32_t			i;
-	HRESULT				hr;
+	K_FS_DRIVER	*d = *drv;
+	K_STREAM	*s;
+	char		path[MAX_DIRNAME_LENGTH];
+	uint32_t	i, size, free, usable;
+	HRESULT		hr;
 
-	/* If `dir` is NULL, we have to list the root directory */
-	if (dir == NULL) {
-		/* Allocate temporary buffer to store directory content */
-		if (!(buf = kmalloc(ctx->bpb.root_entries & sizeof(FAT16_DIR_ENTRY)))) {
-			return E_OUTOFMEM;
-		}
+	switch (op->op) {
+		case FAT_TEST_MKDIR:
+			return d->mkdir(d, op->path, 0);
 
-		/* Read content */
-		hr = fat16_read_rootdir_content(drv, buf);
-		if (FAILED(hr)) goto finally;
+		case FAT_TEST_WRITE:
+			hr = d->create(d, op->path, 0);
+			if (FAILED(hr)) return hr;
 
-		entry_cnt = ctx->bpb.root_entries;
-	} else {
-		content_size = fat_count_chain(drv, fat_get_first_cluster(drv, dir)) * ctx->bpb.bytes_per_sector * ctx->bpb.sectors_per_cluster;
+			/* Fall through */
+		case FAT_TEST_APPEND:
+		case FAT_TEST_TRUNCATE:
+			hr = d->open(d, op->path, FILE_OPEN_READWRITE, &s);
+			if (FAILED(hr)) return hr;
 
-		/* Only directories can be listed for subentries */
-		if ((dir->attributes & FAT_ATTR_DIRECTORY) == 0) {
-			return E_INVALIDARG;
-		}
+			if (op->op == FAT_TEST_TRUNCATE) {
+				size = op->size;
+				hr = k_ioctl(s, IOCTL_FILE_TRUNCATE, &size);
+			} else {
+				hr = fat_test_write(s, ((FAT16_STR_CONTEXT*)s->priv_data)->entry.size, op->size, op->seed, buf);
+			}
 
-		/* Allocate temporary buffer to store directory content */
-		if (!(buf = kmalloc(content_size))) {
-			return E_OUTOFMEM;
-		}
+			k_fclose(&s);
+			return hr;
 
-		/* Read content */
-		hr = fat16_read_file_content(drv, dir, 0, content_size, buf);
-		if (FAILED(hr)) goto finally;
+		case FAT_TEST_RENAME:
+			return d->rename(d, op->path, op->path2);
 
-		entry_cnt = content_size / sizeof(FAT16_DIR_ENTRY);
-	}
+		case FAT_TEST_UNLINK:
+			return d->unlink(d, op->path);
 
-	/* Iterate sub-entries */
-	for (i=0; i<entry_cnt; i++) {
-		/* Skip entries for deleted files/directories */
-		if (buf[i].filename[0] == 0xE5) {
-			continue;
-		}
+		case FAT_TEST_REMOUNT:
+			fat_test_unmount(drv);
 
-		/* Character 0x05 is escape token for 0xE5 */
-		if (buf[i].filename[0] == 0x05) {
-			buf[i].filename[0] = 0xE5;
-		}
+			hr = fat_test_disk_forget();
+			if (FAILED(hr)) return hr;
 
-		/* Handle end of directory */
-		if (buf[i].filename[0] == 0x00) {
-			break;
-		}
+			hr = fat_test_check(name, img, &free, &usable);
+			if (FAILED(hr)) return hr;
 
-		/* Skip volume label entries */
-		if (skip_vlabel && (buf[i].attributes & FAT_ATTR_VOLUMEL) != 0) {
-			continue;
-		}
+			return fat_test_mount(drv);
 
-		/* Match flags */
-		if (flagmask != 0 && (buf[i].attributes & flagmask) != flagmask) {
-			/* Flags does not match */
-			continue;
-		}
+		case FAT_TEST_EXPECT:
+			return fat_test_verify(d, op->path, op->size, op->seed, op->zero_from, buf);
 
-		fat_copy_short_filename(&buf[i], fn_buff);
+		case FAT_TEST_MISSING:
+			hr = d->open(d, op->path, FILE_OPEN_READ, &s);
 
-		/* Match file names */
-		if (stricmp(fn_buff, filename) != 0) {
-			continue;
-		}
+			if (SUCCEEDED(hr)) {
+				k_fclose(&s);
+				return E_FAIL;
+			}
 
-		/* Found */
-		*dst = buf[i];
-		goto finally;
-	}
+			return hr == E_NOTFOUND ? S_OK : hr;
+
+		case FAT_TEST_COUNT:
+			return fat_test_count(d, op->path, op->size);
+
+		case FAT_TEST_FILL:
+		case FAT_TEST_FILL_UNLINK:
+		case FAT_TEST_FILL_EXPECT:
+			for (i=0; i<op->size; i++) {
+				snprintf(path, sizeof(path), op->path, i);
+
+				if (op->op == FAT_TEST_FILL) {
+					hr = d->create(d, path, 0);
+					if (FAILED(hr)) return hr;
+
+					hr = d->open(d, path, FILE_OPEN_READWRITE, &s);
+					if (FAILED(hr)) return hr;
+
+					hr = fat_test_write(s, 0, i * 37, 16 + i, buf);
+					k_fclose(&s);
+				} else if (op->op == FAT_TEST_FILL_UNLINK) {
+					hr = i % 2 == op->seed ? d->unlink(d, path) : S_OK;
+				} else if (i % 2 == op->seed) {
+					/* Unlinked half has to be gone */
+					hr = d->open(d, path, FILE_OPEN_READ, &s);
+
+					if (SUCCEEDED(hr)) {
+						k_fclose(&s);
+						hr = E_FAIL;
+					} else if (hr == E_NOTFOUND) {
+						hr = S_OK;
+					}
+				} else {
+					hr = fat_test_verify(d, path, i * 37, 16 + i, i * 37, buf);
+				}
+
+				if (FAILED(hr)) return hr;
+			}
 
-	/* Not found */
-	hr = E_NOTFOUND;
+			return S_OK;
+	}
 
-finally:
-	kfree(buf);
-	return hr;
+	return E_UNEXPECTED;
 }
 
 /*
- * Descends the file system according to the given URL and tries to find and retrieve
- * FAT16_DIR_ENTRY data for the specified file.
+ * Formats a volume, runs the script on it and checks the final image.
  */
-static HRESULT fat16_parse_url(K_FS_DRIVER *drv, char *url, FAT16_DIR_ENTRY *out_entry)
+static HRESULT fat_test_volume(const FAT_TEST_GEOMETRY *g, uint8_t *img, uint8_t *buf)
 {
-	uint32_t 			comp_count = 0;
-	uint32_t 			url_len = strlen(url);
-	FAT16_DIR_ENTRY		curr_entry;
-	uint32_t 			i, len, flagmask;
-	HRESULT				hr;
-	char				comp_name[256];
+	K_FS_DRIVER	*drv = NULL;
+	uint32_t	i, free, usable;
+	HRESULT		hr;
 
-	/* Count number of path delimiters */
-	for (i=0; i<url_len; i++) {
-		if (url[i] == VFS_PATH_DELIMITER) {
-			comp_count++;
-		}
+	fat_test_format(g, img);
+	fat_test_disk.data		= img;
+	fat_test_disk.sectors	= g->sectors;
+
+	/* The previous volume was served from the same device */
+	hr = fat_test_disk_forget();
+	if (FAILED(hr)) return hr;
+
+	hr = fat_test_check(g->name, img, &free, &usable);
+	if (FAILED(hr)) return hr;
+
+	hr = fat_test_mount(&drv);
+	if (FAILED(hr)) {
+		k_printf("%s: mount failed (hr=0x%X)\n", g->name, hr);
+		return hr;
 	}
 
-	/* Create array to hold the names of each component */
-	uint32_t comp_id = 0;
-	char *components[comp_count];
+	for (i=0; i<sizeof(fat_test_script) / sizeof(fat_test_script[0]); i++) {
+		const FAT_TEST_OP *op = &fat_test_script[i];
 
-	/* Split URL to components */
-	for (i=0; i<url_len; i++) {
-		if (url[i] == VFS_PATH_DELIMITER) {
-			components[comp_id++] = &url[i+1];
+		hr = fat_test_step(&drv, op, g->name, img, buf);
+		if (FAILED(hr)) {
+			k_printf("%s: step %d, %s %s failed (hr=0x%X)\n", g->name, i + 1, fat_test_op_names[op->op], op->path, hr);
+			break;
 		}
 	}
 
-	/* Iterate components */
-	for (i=0; i<comp_count; i++) {
-		/* Find length of the component name */
-		char *s = strchr(components[i], VFS_PATH_DELIMITER);
-		len	= !s ? strlen(components[i]) : (uint32_t)(s - components[i]);
+	if (drv != NULL) {
+		fat_test_unmount(&drv);
+	}
 
-		/* Copy component name to local variable */
-		memcpy(comp_name, components[i], len);
-		comp_name[len] = '\0';
+	if (FAILED(hr)) return hr;
 
-		/* If this is last component it could be either file or a folder,
-		 * but otherwise it is mandatory to be a directory.
-		 */
-		flagmask = (comp_count - i == 1) ? 0x00 : FAT_ATTR_DIRECTORY;
+	hr = fat_test_disk_forget();
+	if (FAILED(hr)) return hr;
 
-		/* Search */
-		if (i == 0) {
-			hr = fat16_find_subentry(drv, NULL, comp_name, flagmask, TRUE, &curr_entry);
-		} else {
-			hr = fat16_find_subentry(drv, &curr_entry, comp_name, flagmask, TRUE, &curr_entry);
-		}
-		if (FAILED(hr)) goto finally;
+	hr = fat_test_check(g->name, img, &free, &usable);
+	if (FAILED(hr)) return hr;
+
+	if (free != usable) {
+		k_printf("%s: %d of %d clusters free after deleting everything\n", g->name, free, usable);
+		return E_FAIL;
 	}
 
-	/* Found */
-	*out_entry = curr_entry;
-	hr = S_OK;
+	return S_OK;
+}
+
+HRESULT fat16_selftest()
+{
+	uint8_t		*img, *buf;
+	uint32_t	i, passed = 0, total = 0;
+	HRESULT		hr;
+
+	img = kmalloc(FAT_TEST_MAX_SECTORS * 512);
+	buf = kmalloc(FAT_TEST_CHUNK);
+
+	if (!img || !buf) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	hr = fat_test_disk_mount();
+	if (FAILED(hr)) goto finally;
+
+	for (i=0; i<sizeof(fat_test_volumes) / sizeof(fat_test_volumes[0]); i++) {
+		total++;
+
+		hr = fat_test_volume(&fat_test_volumes[i], img, buf);
+		if (SUCCEEDED(hr)) passed++;
+
+		hr = S_OK;
+	}
+
+	/* Leave the RAM disk empty, the image is freed */
+	fat_test_disk_forget();
+	fat_test_disk.data		= NULL;
+	fat_test_disk.sectors	= 0;
+
+	k_printf("RAM disk: %d/%d FAT volumes passed\n", passed, total);
+
+	if (passed != total) {
+		hr = E_FAIL;
+	}
 
 finally:
+	if (img) kfree(img);
+	if (buf) kfree(buf);
+
 	return hr;
 }
 
 /*
- * Creates new instance of the FAT12/16 driver.
+ * Extent map benchmark. The file should be large and fragmented, so walking
+ * the chain on every read shows.
  */
-static HRESULT
-fat16_init(K_FS_DRIVER *drv, char *storage_drv)
+#define FAT_BENCH_DIR		"/drives/a"
+#define FAT_BENCH_CHUNK		4096
+#define FAT_BENCH_TAIL		32
+
+/*
+ * Reads the file sequentially, then a chunk at each of the last
+ * FAT_BENCH_TAIL multiples of 64 KiB from a newly opened stream.
+ */
+static HRESULT fat16_extent_bench_pass(char *path, uint8_t *buf, size_t *total, uint32_t *seq_ms, uint32_t *tail_ms)
 {
-	FAT16_DRV_CONTEXT 	*c;
-	HRESULT				hr;
+	K_STREAM	*s;
+	size_t		bytes, size = 0;
+	uint32_t	t, i;
+	HRESULT		hr;
 
-	if (drv->priv_data != NULL) {
-		/* Driver already initialized, or uninitialized memory */
-		return E_FAIL;
-	}
+	*total = 0;
 
-	/* Create driver context */
-	if (!(drv->priv_data = kcalloc(sizeof(FAT16_DRV_CONTEXT)))) {
-		return E_OUTOFMEM;
-	}
+	/* Sequential */
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(hr)) return hr;
 
-	c = drv->priv_data;
+	pagecache_invalidate_owner(s->fs_driver);
+	t = timer_gettickcount();
 
-	hr = k_fopen(storage_drv, FILE_OPEN_READ, &c->storage_drv);
-	if (FAILED(hr)) return hr;
+	while ((hr = k_fread(s, FAT_BENCH_CHUNK, buf, &bytes)) == S_OK && bytes > 0) {
+		*total += bytes;
+	}
 
-	/* Read BPB info */
-	hr = fat16_parse_bpb(drv);
-	if (FAILED(hr)) return E_FAIL;
+	*seq_ms = timer_gettickcount() - t;
+	k_fclose(&s);
 
-	/* Cache FAT table */
-	hr = fat16_cache_fat_table(drv);
+	if (FAILED(hr) && hr != E_ENDOFSTR) return hr;
+
+	/* Offsets from the end, on a stream which hasn't mapped anything yet */
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
 	if (FAILED(hr)) return hr;
 
-	/* Assign FS ops */
-	drv->create 	= fat16_create;
-	drv->open 		= fat16_open;
-	drv->mkdir 		= fat16_mkdir;
-	drv->opendir 	= fat16_opendir;
-	drv->finalize 	= fat16_fini;
+	pagecache_invalidate_owner(s->fs_driver);
+	size = *total;
+	t = timer_gettickcount();
 
-	/* Avoid warning for unused function */
-	UNUSED_ARG(fat_get_subitem_count); //TODO: remove if used.
+	for (i=1; i<=FAT_BENCH_TAIL && i * 0x10000 <= size; i++) {
+		hr = k_fpread(s, size - i * 0x10000, FAT_BENCH_CHUNK, buf, &bytes);
+		if (FAILED(hr)) break;
+	}
 
-	return S_OK;
+	*tail_ms = timer_gettickcount() - t;
+	k_fclose(&s);
+
+	return hr;
 }
 
-/*
- * Cleans up before the FS driver is being destroyed.
- */
-static HRESULT
-fat16_fini(K_FS_DRIVER *drv)
+HRESULT fat16_extent_benchmark()
 {
-	FAT16_DRV_CONTEXT 	*ctx;
+	K_DIR_STREAM	*ds;
+	K_FS_NODE_INFO	info;
+	char			name[MAX_FILENAME_LENGTH];
+	char			best[MAX_FILENAME_LENGTH];
+	char			path[MAX_DIRNAME_LENGTH];
+	uint8_t			*buf;
+	size_t			best_size = 0, total;
+	uint32_t		pass, seq_ms, tail_ms;
+	HRESULT			hr;
+
+	hr = fat16_selftest();
+	if (FAILED(hr)) return hr;
 
-	if (drv->priv_data == NULL) {
-		return E_FAIL;
+	if (FAILED(k_opendir(FAT_BENCH_DIR, &ds))) {
+		k_printf("%s: not mounted, skipped.\n", FAT_BENCH_DIR);
+		return S_OK;
 	}
 
-	ctx = drv->priv_data;
+	/* Largest file of the directory */
+	best[0] = '\0';
 
-	/* Free FAT cache */
-	if (ctx->fat_cache) {
-		kfree(ctx->fat_cache);
+	while (k_readdir(ds, name, &info) == S_OK) {
+		if (info.node_type == FS_NODE_TYPE_FILE && info.size > best_size) {
+			strcpy(best, name);
+			best_size = info.size;
+		}
 	}
 
-	/* Close storage driver handle */
-	if (ctx->storage_drv != NULL) {
-		k_fclose(&ctx->storage_drv);
+	k_closedir(&ds);
+
+	if (best[0] == '\0') {
+		k_printf("%s: no files, skipped.\n", FAT_BENCH_DIR);
+		return S_OK;
 	}
 
-	/* Free driver context */
-	kfree(drv->priv_data);
+	if (!(buf = kmalloc(FAT_BENCH_CHUNK))) {
+		return E_OUTOFMEM;
+	}
 
-	return S_OK;
-}
+	snprintf(path, sizeof(path), "%s/%s", FAT_BENCH_DIR, best);
 
-K_FS_CONSTRUCTOR fat16_get_constructor()
-{
-	return fat16_init;
+	for (pass=0; pass<2; pass++) {
+		fat16_extents_enabled = pass == 1;
+
+		hr = fat16_extent_bench_pass(path, buf, &total, &seq_ms, &tail_ms);
+		if (FAILED(hr)) {
+			k_printf("%s: read failed (hr=0x%X).\n", path, hr);
+			break;
+		}
+
+		k_printf("%s: %d KiB in %d ms (%d KiB/s), %d reads near the end in %d ms, extent map %s\n",
+				path, total / 1024, seq_ms, seq_ms > 0 ? (uint32_t)(total / 1024 * 1000 / seq_ms) : 0,
+				FAT_BENCH_TAIL, tail_ms, pass == 1 ? "on" : "off");
+	}
+
+	fat16_extents_enabled = TRUE;
+
+	kfree(buf);
+	return hr;
 }
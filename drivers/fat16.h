@@ -2,8 +2,8 @@
  * fat16.h
  *
  *	Note:
- *		- This can potentially be expanded to support vFAT / FAT32, since there
- *		  are a lot of similarities.
+ *		- Despite the name, the driver handles FAT12, FAT16 and FAT32, with
+ *		  VFAT long filenames.
  *
  *  Created on: 23.09.2016 .
  *      Author: Anton Angelov
@@ -30,6 +30,24 @@
 #define FAT_ATTR_ARCHIVE	0x20
 #define FAT_ATTR_DEVICE		0x60
 
+/* Attribute value of long filename entries */
+#define FAT_ATTR_LFN		0x0F
+
+/* Flags in the `reserved` field of FAT16_DIR_ENTRY, set by Windows NT for
+ * short names with lower case base name / extension. */
+#define FAT_NT_LOWER_BASE	0x08
+#define FAT_NT_LOWER_EXT	0x10
+
+/* Long filename entries */
+#define FAT_LFN_CHARS		13
+#define FAT_LFN_LAST		0x40
+
+/* FSInfo sector signatures */
+#define FAT32_FSINFO_LEAD_SIG	0x41615252
+#define FAT32_FSINFO_STRUC_SIG	0x61417272
+#define FAT32_FSINFO_TRAIL_SIG	0xAA550000
+#define FAT32_FSINFO_UNKNOWN	0xFFFFFFFF
+
 /**
  * Describes a BIOS parameter block inside a FAT Boot
  * Sector.
@@ -65,6 +83,41 @@ struct FAT16_EBPB {
 	uint8_t		fs_identifier[8];
 } __packed;
 
+/**
+ * FAT32 Extended BIOS parameter block.
+ */
+typedef struct FAT32_EBPB FAT32_EBPB;
+struct FAT32_EBPB {
+	uint32_t	sectors_per_FAT;
+	uint16_t	flags;
+	uint16_t	version;
+	uint32_t	root_cluster;
+	uint16_t	fsinfo_sector;
+	uint16_t	backup_boot_sector;
+	uint8_t		reserved[12];
+	uint8_t		drive_number;
+	uint8_t		nt_flags;
+	uint8_t		signature;
+	uint32_t	volume_id;
+	uint8_t		volume_label[11];
+	uint8_t		fs_identifier[8];
+} __packed;
+
+/**
+ * FAT32 FSInfo sector, which caches the free cluster count and a hint where to
+ * look for free clusters.
+ */
+typedef struct FAT32_FSINFO FAT32_FSINFO;
+struct FAT32_FSINFO {
+	uint32_t	lead_signature;
+	uint8_t		reserved1[480];
+	uint32_t	struc_signature;
+	uint32_t	free_count;
+	uint32_t	next_free;
+	uint8_t		reserved2[12];
+	uint32_t	trail_signature;
+} __packed;
+
 /**
  * Stores metadata for files and directories.
  */
@@ -82,6 +135,70 @@ struct FAT16_DIR_ENTRY {
 	uint32_t	size;
 } __packed;
 
+/**
+ * Long filename entry. A long name is stored in UCS-2 in a sequence of these,
+ * in reverse order, right before the short entry of the file.
+ */
+typedef struct FAT_LFN_ENTRY FAT_LFN_ENTRY;
+struct FAT_LFN_ENTRY {
+	/* Sequence number, FAT_LFN_LAST is set on the first entry on disk */
+	uint8_t		order;
+	uint16_t	name1[5];
+	uint8_t		attributes;
+	uint8_t		type;
+	uint8_t		checksum;
+	uint16_t	name2[6];
+	uint16_t	first_clust_low;
+	uint16_t	name3[2];
+} __packed;
+
+/**
+ * Directory entry along with it's location, so it can be written back.
+ */
+typedef struct FAT16_DIR_LOC FAT16_DIR_LOC;
+struct FAT16_DIR_LOC {
+	FAT16_DIR_ENTRY	entry;
+
+	/* First cluster of the parent directory, 0 for the FAT12/16 root directory */
+	uint32_t		dir_cluster;
+
+	/* Index of the entry within the directory, and of the first long
+	 * filename entry belonging to it (same as `index` if there is none) */
+	uint32_t		index;
+	uint32_t		lfn_index;
+};
+
+/**
+ * Run of physically contiguous clusters of a file.
+ */
+typedef struct FAT16_EXTENT FAT16_EXTENT;
+struct FAT16_EXTENT {
+	/* Index of the first cluster within the file */
+	uint32_t	file_cluster;
+
+	/* First cluster on disk and length in clusters */
+	uint32_t	cluster;
+	uint32_t	length;
+};
+
+/**
+ * Extents of a cluster chain, mapped lazily as far as reads reach.
+ */
+typedef struct FAT16_EXTENT_MAP FAT16_EXTENT_MAP;
+struct FAT16_EXTENT_MAP {
+	FAT16_EXTENT	*extents;
+	uint32_t		count;
+	uint32_t		capacity;
+
+	/* Clusters mapped so far and the cluster following them */
+	uint32_t		clusters;
+	uint32_t		next_cluster;
+
+	/* Chain the map was built for. It is rebuilt once the chain changes. */
+	uint32_t		first_cluster;
+	uint32_t		generation;
+};
+
 typedef struct FAT16_DRV_CONTEXT FAT16_DRV_CONTEXT;
 struct FAT16_DRV_CONTEXT {
 	/** Handle to storage driver */
@@ -98,12 +215,39 @@ struct FAT16_DRV_CONTEXT {
 	uint8_t		*fat_cache;
 	uint8_t		fat_cache_dirty;
 
+	/* One flag per FAT sector, set if the sector was modified since the last
+	 * flush, and the tick count of the first such modification */
+	uint8_t		*fat_dirty;
+	uint32_t	dirty_since;
+
 	uint32_t	first_data_sector;
 	uint32_t	first_fat_sector;
 	uint32_t	first_root_sector;
 	uint32_t	total_sectors;
 	uint32_t	data_sector_cnt;
 	uint32_t	total_cluster_cnt;
+	uint32_t	sectors_per_fat;
+
+	/* FAT32 only (0 otherwise) */
+	uint32_t	root_cluster;
+	uint32_t	fsinfo_sector;
+	uint8_t		fsinfo_dirty;
+
+	/* Serializes updates of the FAT and directories */
+	K_MUTEX		lock;
+
+	/* Storage device could only be opened for reading */
+	BOOL		read_only;
+
+	/* Free cluster bitmap (bit set if free), built at mount time */
+	uint32_t	*free_map;
+	uint32_t	free_count;
+
+	/* Cluster the next allocation starts looking at */
+	uint32_t	next_free;
+
+	/* Incremented whenever a cluster chain changes */
+	uint32_t	chain_gen;
 };
 
 
@@ -114,12 +258,35 @@ typedef struct FAT16_STR_CONTEXT FAT16_STR_CONTEXT;
 struct FAT16_STR_CONTEXT {
 	FAT16_DIR_ENTRY entry;
 
+	/* Location of the entry, see FAT16_DIR_LOC */
+	uint32_t	dir_cluster;
+	uint32_t	dir_index;
+
+	/* Length and last cluster of the chain, valid while `chain_gen` matches
+	 * the driver context */
+	uint32_t	clusters;
+	uint32_t	last_cluster;
+	uint32_t	chain_gen;
+
+	/* Set once the stream has written to the file */
+	BOOL		written;
+
 	/* Cache */
 	uint32_t 	cache_cap;
 	uint32_t 	cache_start_addr;
 	uint32_t 	cache_size;
 	uint8_t		*cache_buff;
 	uint8_t		cache_invalid;
+
+	/* Page cache inode shared by all streams of the file, NULL if the page
+	 * cache is unavailable */
+	K_PAGECACHE_INODE *inode;
+
+	/* Sequential read detection for this stream */
+	K_READAHEAD	ra;
+
+	/* Cluster chain of the file */
+	FAT16_EXTENT_MAP extents;
 };
 
 /**
@@ -128,4 +295,18 @@ struct FAT16_STR_CONTEXT {
  */
 K_FS_CONSTRUCTOR fat16_get_constructor();
 
+/**
+ * Formats FAT12, FAT16 and FAT32 volumes on a RAM disk (/dev/fatram), then
+ * creates, writes, extends, truncates, renames and deletes files and
+ * directories, reads them back after a remount and checks the images for
+ * consistency.
+ */
+HRESULT fat16_selftest();
+
+/**
+ * Runs fat16_selftest(), then reads the largest file on /drives/a with and
+ * without the extent map, sequentially and at offsets from the end.
+ */
+HRESULT fat16_extent_benchmark();
+
 #endif /* DRIVERS_FAT16_H_ */
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <desctables.h>
 #include <kstdio.h>
+#include <aio.h>
 #include "floppy.h"
 
 /* Base addresses for FDC 1 and 2 */
@@ -45,6 +46,9 @@
 #define CMD_CONFIGURE                   19     //Initializes controller-specific values
 #define CMD_LOCK                        20
 
+/* Multi-track flag of READ/WRITE DATA, continues from head 0 to head 1 */
+#define CMD_FLAG_MT						0x80
+
 /**
  * Describes the working port addresses used with FDC.
  */
@@ -75,9 +79,29 @@ struct FDC_CTRL_CONTEXT {
 	/* Used for synchronization of the driver thread with the ISR */
 	K_EVENT 	isr_event;
 
-	/* Used to serialize access to floppy drive devices. Currently
-	 * this mechanism is not implemented. */
+	/* Serializes access to the controller and it's drives */
 	K_MUTEX		lock;
+
+	/* Asynchronous requests, served by a driver thread */
+	K_IO_QUEUE	io_queue;
+
+	/* Initialized drives, watched by the motor-off thread */
+	struct FDC_DRIVE_CONTEXT *drives[FDC_MAX_DRIVE_COUNT];
+};
+
+/**
+ * Cached cylinder.
+ */
+typedef struct FDC_TRACK FDC_TRACK;
+struct FDC_TRACK {
+	BOOL		valid;
+	uint8_t		cylinder;
+
+	/* Value of the drive's track clock when last used */
+	uint32_t	last_used;
+
+	/* FDC_CYLINDER_SIZE bytes */
+	uint8_t		*data;
 };
 
 /**
@@ -100,14 +124,26 @@ struct FDC_DRIVE_CONTEXT {
 	/* Status from last operation */
 	uint8_t 			cur_status;
 
+	/* Tick count of the last transfer, for the motor-off thread */
+	QWORD				last_access;
+
 	/* DMA buffer */
 	uint8_t				*dma_buffer;
 	uintptr_t			dma_buffer_phys;
+
+	/* Track cache, in LRU order by `last_used` */
+	FDC_TRACK			tracks[FDC_TRACK_CACHE_SIZE];
+	uint32_t			track_clock;
+	uint32_t			track_hits;
+	uint32_t			track_misses;
 };
 
 /* FDC controller state */
 static FDC_CTRL_CONTEXT controller = {0};
 
+/* Turned off by the self test to measure uncached throughput */
+static BOOL fdc_track_cache_enabled = TRUE;
+
 /* Prototypes */
 static void fdc_delay_short();
 static void lba_to_chs(uint32_t lba, uint8_t *c, uint8_t *h, uint8_t *s);
@@ -122,15 +158,22 @@ static HRESULT fdc_reset(FDC_CTRL_CONTEXT *ctx);
 static HRESULT fdc_recalibrate(FDC_DRIVE_CONTEXT *drive);
 static HRESULT fdc_seek(FDC_DRIVE_CONTEXT *drive, uint8_t cylinder, uint8_t head);
 static HRESULT fdc_set_motor_state(FDC_DRIVE_CONTEXT *drive, BOOL enabled, BOOL wait_to_spinup);
+static HRESULT fdc_motor_on(FDC_DRIVE_CONTEXT *drive);
+static void __nxapi fdc_motor_thread();
 
 static HRESULT fdc_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args);
 static HRESULT fdc_write_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args);
 
-static HRESULT fdc_read_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *dst, uint32_t retry_attempts);
-static HRESULT fdc_write_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *src, uint32_t retry_attempts);
+static HRESULT fdc_transfer(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *buffer, BOOL write, uint32_t retry_attempts);
+static HRESULT fdc_get_track(FDC_DRIVE_CONTEXT *drive, uint8_t cylinder, FDC_TRACK **out);
+static void fdc_invalidate_tracks(FDC_DRIVE_CONTEXT *drive);
+static HRESULT fdc_read(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *dst, uint32_t *done);
+static HRESULT fdc_write(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *src, uint32_t *done);
 static HRESULT fdc_driver_init(K_DEVICE *self);
 static HRESULT fdc_driver_fini(K_DEVICE *self);
 static HRESULT fdc_ioctl(K_STREAM *s, uint32_t code, void *arg);
+static HRESULT fdc_submit(K_STREAM *s, K_IO_REQUEST *req);
+static HRESULT __nxapi fdc_aio_service(K_IO_QUEUE *q, K_IO_REQUEST *req);
 
 static VOID __cdecl fdc_isr(K_REGISTERS regs);
 
@@ -299,7 +342,7 @@ static HRESULT fdc_reset(FDC_CTRL_CONTEXT *ctx)
 		/* The FDC is a legacy controller and we can't
 		 * support it
 		 */
-		k_printf("b=%x ", (uint32_t)b);
+		k_printf("b=0x%X ", (uint32_t)b);
 		HalKernelPanic("Unknown FDC type.");
 		return E_FAIL;
 	}
@@ -381,10 +424,10 @@ static HRESULT fdc_set_motor_state(FDC_DRIVE_CONTEXT *drive, BOOL enabled, BOOL
 			delay = wait_to_spinup ? FDC_SPINUP_TIMEOUT : 0;
 			break;
 
-		/* Turn off */
+		/* Turn off. Nothing has to wait for the motor to stop. */
 		case FALSE:
 			dor_state &= ~(0x10 << drive->id);
-			delay = FDC_SPINDOWN_TIMEOUT;
+			delay = 0;
 			break;
 
 		default:
@@ -405,6 +448,22 @@ static HRESULT fdc_set_motor_state(FDC_DRIVE_CONTEXT *drive, BOOL enabled, BOOL
 	return S_OK;
 }
 
+/**
+ * Turns the motor on, unless it is still running from a previous transfer,
+ * and marks the drive as used.
+ */
+static HRESULT fdc_motor_on(FDC_DRIVE_CONTEXT *drive)
+{
+	HRESULT hr = S_OK;
+
+	if (!drive->motor_state) {
+		hr = fdc_set_motor_state(drive, TRUE, TRUE);
+	}
+
+	drive->last_access = timer_gettickcount();
+	return hr;
+}
+
 /**
  * Recalibrate causes the read/write head to retract to
  * track position 0. Sometimes more than one recalibrate is
@@ -514,27 +573,32 @@ msr_check_success:
 }
 
 /**
- * Reads a single sector from a floppy disk device and writes it to
- * memory location pointed by `dst`.
+ * Transfers `count` sectors starting at `lba` between the medium and memory
+ * pointed by `buffer`, with a single READ/WRITE DATA command. The command runs
+ * in multi-track mode, so the transfer may continue from head 0 to head 1, but
+ * it must not leave the cylinder. Must be called with the controller lock held.
  */
-static HRESULT fdc_read_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *dst, uint32_t retry_attempts)
+static HRESULT fdc_transfer(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *buffer, BOOL write, uint32_t retry_attempts)
 {
 	HRESULT 	hr;
 	uint8_t		cylinder;
 	uint8_t		head;
 	uint8_t		sector;
+	uint32_t	size = count * FDC_SECTOR_SIZE;
 	uint32_t	force_retry = FALSE;
 
+	/* Validate range */
+	if (count == 0 || lba % FDC_CYLINDER_SECTORS + count > FDC_CYLINDER_SECTORS) {
+		return E_INVALIDARG;
+	}
+
 	/*
 	 * Select drive and turn motor on.
 	 */
 	hr = fdc_select_drive(drive);
 	if (FAILED(hr)) return hr;
 
-	/* Seems for read operations we don't need to wait for
-	 * the motor to spin up.
-	 */
-	hr = fdc_set_motor_state(drive, TRUE, FALSE); //FALSE is also good
+	hr = fdc_motor_on(drive);
 	if (FAILED(hr)) return hr;
 
 	/* Convert LBA to CHS */
@@ -554,25 +618,33 @@ static HRESULT fdc_read_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *dst
 	}
 
 	/*
-	 * Open DMA channel
+	 * Open DMA channel. The controller stops at terminal count, after
+	 * `count` sectors.
 	 */
 	hr = isadma_open_channel(
 			FDC_DMA_CHANNEL,
 			(void*)drive->dma_buffer_phys,
-			FDC_SECTOR_SIZE,
-			DMA_TRANSFER_WRITE,
+			size,
+			write ? DMA_TRANSFER_READ : DMA_TRANSFER_WRITE,
 			DMA_MODE_SINGLE,
 			FALSE
 	);
 	if (FAILED(hr)) return hr;
 
+	/*
+	 * Copy `buffer` to DMA memory.
+	 */
+	if (write) {
+		memcpy(drive->dma_buffer, buffer, size);
+	}
+
 	/* Reset ISR event */
 	event_reset(&drive->ctrl->isr_event);
 
 	/*
-	 * Issue READ command
+	 * Issue READ or WRITE command
 	 */
-	fdc_fifo_write(drive->ctrl, CMD_READ);
+	fdc_fifo_write(drive->ctrl, (write ? CMD_WRITE : CMD_READ) | CMD_FLAG_MT);
 	fdc_fifo_write(drive->ctrl, (head << 2) | (drive->id & 0x3));
 	fdc_fifo_write(drive->ctrl, cylinder);
 	fdc_fifo_write(drive->ctrl, head);
@@ -583,7 +655,7 @@ static HRESULT fdc_read_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *dst
 	fdc_fifo_write(drive->ctrl, 0xFF);
 
 	/* Wait for IRQ */
-	hr = event_waitfor(&drive->ctrl->isr_event, FDC_DEFAULT_TIMEOUT + 1000);
+	hr = event_waitfor(&drive->ctrl->isr_event, FDC_TRANSFER_TIMEOUT);
 	if (FAILED(hr)) {
 		goto finally;
 	}
@@ -604,11 +676,17 @@ static HRESULT fdc_read_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *dst
 		 * later using recursive call to this routine.  */
 		force_retry = TRUE;
 		hr = E_FAIL;
+
+		/* TODO: If the operation has failed due to write protection there is
+		 * no need for additional retry attempts.
+		 */
 		goto finally;
 	}
 
 	/* Copy DMA buffer to target buffer */
-	memcpy(dst, drive->dma_buffer, FDC_SECTOR_SIZE);
+	if (!write) {
+		memcpy(buffer, drive->dma_buffer, size);
+	}
 
 	/* Success */
 
@@ -618,130 +696,192 @@ finally:
 
 	/* Retry, if retry counter is non-null */
 	if (force_retry && (retry_attempts > 0)) {
-		hr = fdc_read_sector(drive, lba, dst, retry_attempts-1);
+		hr = fdc_transfer(drive, lba, count, buffer, write, retry_attempts-1);
 	}
 
 	return hr;
 }
 
 /**
- * Writes a sector (512 bytes) from memory to disk drive medium.
- * The code in this routine is mostly similar to `fdc_read_sector()`
+ * Retrieves cylinder `cylinder` from the track cache, reading it from the
+ * medium if it isn't cached. The least recently used cylinder is replaced.
+ * Must be called with the controller lock held.
  */
-static HRESULT fdc_write_sector(FDC_DRIVE_CONTEXT *drive, uint32_t lba, void *src, uint32_t retry_attempts)
+static HRESULT fdc_get_track(FDC_DRIVE_CONTEXT *drive, uint8_t cylinder, FDC_TRACK **out)
 {
-	HRESULT 	hr;
-	uint8_t		cylinder;
-	uint8_t		head;
-	uint8_t		sector;
-	uint32_t	force_retry = FALSE;
-
-	/*
-	 * Select drive and turn motor on.
-	 */
-	hr = fdc_select_drive(drive);
-	if (FAILED(hr)) return hr;
+	FDC_TRACK	*t, *victim = NULL;
+	uint32_t	i;
+	HRESULT		hr;
 
-	hr = fdc_set_motor_state(drive, TRUE, TRUE);
-	if (FAILED(hr)) return hr;
+	for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+		t = &drive->tracks[i];
 
-	/* Convert LBA to CHS */
-	lba_to_chs(lba, &cylinder, &head, &sector);
+		if (t->valid && t->cylinder == cylinder) {
+			t->last_used = ++drive->track_clock;
+			drive->track_hits++;
 
-	/*
-	 * Seek to position
-	 */
-	hr = fdc_seek(drive, cylinder, head);
-	if (FAILED(hr)) {
-		/* We will try to recalibrate and seek again */
-		hr = fdc_recalibrate(drive);
-		if (FAILED(hr)) return hr;
+			*out = t;
+			return S_OK;
+		}
 
-		hr = fdc_seek(drive, cylinder, head);
-		if (FAILED(hr)) return hr;
+		/* Prefer empty slots, then the least recently used one */
+		if (victim == NULL || (victim->valid && (!t->valid || t->last_used < victim->last_used))) {
+			victim = t;
+		}
 	}
 
-	/*
-	 * Open DMA channel
-	 */
-	hr = isadma_open_channel(
-			FDC_DMA_CHANNEL,
-			(void*)drive->dma_buffer_phys,
-			FDC_SECTOR_SIZE,
-			DMA_TRANSFER_READ,
-			DMA_MODE_SINGLE,
-			FALSE
-	);
+	drive->track_misses++;
+	victim->valid = FALSE;
+
+	hr = fdc_transfer(drive, cylinder * FDC_CYLINDER_SECTORS, FDC_CYLINDER_SECTORS, victim->data, FALSE, FDC_DEFAULT_COMMAND_RETRIES);
 	if (FAILED(hr)) return hr;
 
-	/*
-	 * Copy `src` buffer to DMA memory.
-	 */
-	memcpy(drive->dma_buffer, src, FDC_SECTOR_SIZE);
+	victim->cylinder	= cylinder;
+	victim->last_used	= ++drive->track_clock;
+	victim->valid		= TRUE;
 
-	/* Reset ISR event */
-	event_reset(&drive->ctrl->isr_event);
+	*out = victim;
+	return S_OK;
+}
 
-	/*
-	 * Issue WRITE command
-	 */
-	fdc_fifo_write(drive->ctrl, CMD_WRITE);
-	fdc_fifo_write(drive->ctrl, (head << 2) | (drive->id & 0x3));
-	fdc_fifo_write(drive->ctrl, cylinder);
-	fdc_fifo_write(drive->ctrl, head);
-	fdc_fifo_write(drive->ctrl, sector);
-	fdc_fifo_write(drive->ctrl, 2); //512 bytes/sector
-	fdc_fifo_write(drive->ctrl, FLOPPY_144_SECTORS_PER_TRACK);
-	fdc_fifo_write(drive->ctrl, 0x1B); //GAP1 default size
-	fdc_fifo_write(drive->ctrl, 0xFF);
+/**
+ * Drops all cached cylinders of a drive.
+ */
+static void fdc_invalidate_tracks(FDC_DRIVE_CONTEXT *drive)
+{
+	uint32_t i;
 
-	/* Wait for IRQ */
-	hr = event_waitfor(&drive->ctrl->isr_event, FDC_DEFAULT_TIMEOUT);
-	if (FAILED(hr)) {
-		goto finally;
+	for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+		drive->tracks[i].valid = FALSE;
 	}
+}
 
-	uint8_t	result[7];
+/**
+ * Reads `count` sectors starting at `lba`. Sectors are served from the track
+ * cache, unless it is disabled, in which case each cylinder's part is read
+ * directly.
+ */
+static HRESULT fdc_read(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *dst, uint32_t *done)
+{
+	FDC_TRACK	*t;
+	uint8_t		*ptr = dst;
+	uint32_t	offs, n;
+	HRESULT		hr = S_OK;
+
+	mutex_lock(&drive->ctrl->lock);
+
+	while (count > 0) {
+		/* Sectors up to the end of the cylinder */
+		offs = lba % FDC_CYLINDER_SECTORS;
+		n = FDC_CYLINDER_SECTORS - offs;
+		if (n > count) n = count;
+
+		if (fdc_track_cache_enabled) {
+			hr = fdc_get_track(drive, lba / FDC_CYLINDER_SECTORS, &t);
+			if (FAILED(hr)) break;
+
+			memcpy(ptr, t->data + offs * FDC_SECTOR_SIZE, n * FDC_SECTOR_SIZE);
+		} else {
+			hr = fdc_transfer(drive, lba, n, ptr, FALSE, FDC_DEFAULT_COMMAND_RETRIES);
+			if (FAILED(hr)) break;
+		}
 
-	/* Read back 7 result bytes */
-	for (uint32_t i=0; i<7; i++) {
-		hr = fdc_fifo_read(drive->ctrl, &result[i]);
-		if (FAILED(hr)) goto finally;
+		lba += n;
+		count -= n;
+		ptr += n * FDC_SECTOR_SIZE;
+
+		if (done) *done += n;
 	}
 
-	/* Validate st0. If top 2 bits are cleared, then operation
-	 * was successful. */
-	if (result[0] & 0xC0) {
-		/* Fail. For real hardware we have to retry most operations
-		 * since it's common for FDC hardware to fail. Retrial is performed
-		 * later using recursive call to this routine.  */
-		force_retry = TRUE;
-		hr = E_FAIL;
+	drive->last_access = timer_gettickcount();
 
-		/* TODO: If the operation has failed due to write protection there is
-		 * no need for additional retry attempts.
-		 */
-		goto finally;
-	}
+	mutex_unlock(&drive->ctrl->lock);
+	return hr;
+}
 
-finally:
-	/* Close DMA channel */
-	isadma_close_channel(FDC_DMA_CHANNEL);
+/**
+ * Writes `count` sectors starting at `lba`, one command per cylinder. The
+ * track cache is write-through: cached copies are updated after the medium.
+ */
+static HRESULT fdc_write(FDC_DRIVE_CONTEXT *drive, uint32_t lba, uint32_t count, void *src, uint32_t *done)
+{
+	FDC_TRACK	*t;
+	uint8_t		*ptr = src;
+	uint32_t	offs, n, i;
+	HRESULT		hr = S_OK;
+
+	mutex_lock(&drive->ctrl->lock);
+
+	while (count > 0) {
+		offs = lba % FDC_CYLINDER_SECTORS;
+		n = FDC_CYLINDER_SECTORS - offs;
+		if (n > count) n = count;
+
+		hr = fdc_transfer(drive, lba, n, ptr, TRUE, FDC_DEFAULT_COMMAND_RETRIES);
+
+		/* Update the cached cylinder. If the write failed, the medium's
+		 * content is unknown, so drop it. */
+		for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+			t = &drive->tracks[i];
+
+			if (t->valid && t->cylinder == lba / FDC_CYLINDER_SECTORS) {
+				if (SUCCEEDED(hr)) {
+					memcpy(t->data + offs * FDC_SECTOR_SIZE, ptr, n * FDC_SECTOR_SIZE);
+				} else {
+					t->valid = FALSE;
+				}
+			}
+		}
 
-	/* Retry, if retry counter is non-null */
-	if (force_retry && (retry_attempts > 0)) {
-		hr = fdc_write_sector(drive, lba, src, retry_attempts-1);
+		if (FAILED(hr)) break;
+
+		lba += n;
+		count -= n;
+		ptr += n * FDC_SECTOR_SIZE;
+
+		if (done) *done += n;
 	}
 
+	drive->last_access = timer_gettickcount();
+
+	mutex_unlock(&drive->ctrl->lock);
 	return hr;
 }
 
+/**
+ * Turns the motor off once the drive has been idle for FDC_MOTOR_OFF_DELAY,
+ * so consecutive requests don't wait for it to spin up again.
+ */
+static void __nxapi fdc_motor_thread()
+{
+	FDC_CTRL_CONTEXT	*ctrl = &controller;
+	FDC_DRIVE_CONTEXT	*drive;
+	uint32_t			i;
+
+	while (ctrl->ready) {
+		timer_sleep(FDC_MOTOR_OFF_DELAY / 2);
+
+		mutex_lock(&ctrl->lock);
+
+		for (i=0; i<FDC_MAX_DRIVE_COUNT; i++) {
+			drive = ctrl->drives[i];
+
+			if (drive && drive->motor_state && timer_gettickcount() - drive->last_access >= FDC_MOTOR_OFF_DELAY) {
+				fdc_set_motor_state(drive, FALSE, FALSE);
+			}
+		}
+
+		mutex_unlock(&ctrl->lock);
+	}
+}
+
 /**
  * Initializes the driver (called when mounting the driver to VFS)
  */
 static HRESULT fdc_driver_init(K_DEVICE *self)
 {
 	FDC_DRIVE_CONTEXT 	*drive;
+	uint32_t			i;
 	HRESULT				hr;
 
 	/* Make sure the driver is not initialized */
@@ -766,9 +906,17 @@ static HRESULT fdc_driver_init(K_DEVICE *self)
 	hr = vmm_get_region_phys_addr(NULL, (uintptr_t)drive->dma_buffer, &drive->dma_buffer_phys);
 	if (FAILED(hr)) goto fail;
 
-	/* Make sure physical memory is aligned at 64kb boundary. */
-	if ((drive->dma_buffer_phys & 0xFFFF) != 0) {
-		HalKernelPanic("FDC: DMA buffer is not on 64k physical boundary.");
+	/* Make sure the buffer doesn't cross a 64kb physical boundary. */
+	if ((drive->dma_buffer_phys & 0xFFFF) + FDC_CYLINDER_SIZE > 0x10000) {
+		HalKernelPanic("FDC: DMA buffer crosses a 64k physical boundary.");
+	}
+
+	/* Allocate track cache */
+	for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+		if (!(drive->tracks[i].data = kmalloc(FDC_CYLINDER_SIZE))) {
+			hr = E_OUTOFMEM;
+			goto fail;
+		}
 	}
 
 	hr = fdc_select_drive(drive);
@@ -780,15 +928,38 @@ static HRESULT fdc_driver_init(K_DEVICE *self)
 
 	/* Success */
 	self->opaque = drive;
+
+	mutex_lock(&controller.lock);
+	controller.drives[drive->id] = drive;
+	mutex_unlock(&controller.lock);
+
 	return S_OK;
 
 fail:
+	for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+		if (drive->tracks[i].data) kfree(drive->tracks[i].data);
+	}
+
 	return E_FAIL;
 }
 
 static HRESULT fdc_driver_fini(K_DEVICE *self)
 {
 	FDC_DRIVE_CONTEXT 	*drive = self->opaque;
+	uint32_t			i;
+
+	mutex_lock(&controller.lock);
+	controller.drives[drive->id] = NULL;
+
+	if (drive->motor_state) {
+		fdc_set_motor_state(drive, FALSE, FALSE);
+	}
+
+	mutex_unlock(&controller.lock);
+
+	for (i=0; i<FDC_TRACK_CACHE_SIZE; i++) {
+		kfree(drive->tracks[i].data);
+	}
 
 	vmm_unmap_region(NULL, (uintptr_t)drive->dma_buffer, 1);
 	self->opaque = NULL;
@@ -815,24 +986,13 @@ static VOID __cdecl fdc_isr(K_REGISTERS regs)
 static HRESULT fdc_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
 {
 	FDC_DRIVE_CONTEXT 	*ctx = GET_DRV_CTX(s);
-	uint32_t 			i;
-	HRESULT				hr;
-	uint8_t				*dst = args->buffer;
 
 	/* Validate arguments */
-	if (args->count == 0 || args->buffer == NULL) {
+	if (args->count == 0 || args->buffer == NULL || args->start + args->count > FDC_SECTOR_COUNT) {
 		return E_INVALIDARG;
 	}
 
-	/* Perform sequential read */
-	for (i=0; i<args->count; i++) {
-		hr = fdc_read_sector(ctx, args->start + i, dst, FDC_DEFAULT_COMMAND_RETRIES);
-		if (FAILED(hr)) return hr;
-
-		dst += FDC_SECTOR_SIZE;
-	}
-
-	return S_OK;
+	return fdc_read(ctx, args->start, args->count, args->buffer, NULL);
 }
 
 /**
@@ -841,24 +1001,63 @@ static HRESULT fdc_read_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
 static HRESULT fdc_write_blocks(K_STREAM *s, IOCTL_STORAGE_READWRITE *args)
 {
 	FDC_DRIVE_CONTEXT 	*ctx = GET_DRV_CTX(s);
-	uint32_t 			i;
-	HRESULT				hr;
-	uint8_t				*src = args->buffer;
 
 	/* Validate arguments */
-	if (args->count == 0 || args->buffer == NULL) {
+	if (args->count == 0 || args->buffer == NULL || args->start + args->count > FDC_SECTOR_COUNT) {
 		return E_INVALIDARG;
 	}
 
-	/* Perform sequential read */
-	for (i=0; i<args->count; i++) {
-		hr = fdc_write_sector(ctx, args->start + i, src, FDC_DEFAULT_COMMAND_RETRIES);
-		if (FAILED(hr)) return hr;
+	return fdc_write(ctx, args->start, args->count, args->buffer, NULL);
+}
 
-		src += FDC_SECTOR_SIZE;
+/**
+ * Queues an asynchronous request. Only whole sectors can be transferred.
+ */
+static HRESULT fdc_submit(K_STREAM *s, K_IO_REQUEST *req)
+{
+	FDC_DRIVE_CONTEXT *ctx = GET_DRV_CTX(s);
+
+	if (req->offset % FDC_SECTOR_SIZE != 0 || req->size % FDC_SECTOR_SIZE != 0) {
+		return E_INVALIDARG;
 	}
 
-	return S_OK;
+	if (req->offset + req->size > (uint64_t)FDC_SECTOR_COUNT * FDC_SECTOR_SIZE) {
+		return E_INVALIDARG;
+	}
+
+	req->driver_data = ctx;
+	return aio_queue_push(&ctx->ctrl->io_queue, req);
+}
+
+/**
+ * Serves a request on behalf of the queue thread. Transfers already sleep
+ * on the ISR event, so the CPU is free while the drive works.
+ */
+static HRESULT __nxapi fdc_aio_service(K_IO_QUEUE *q, K_IO_REQUEST *req)
+{
+	FDC_DRIVE_CONTEXT 	*ctx = req->driver_data;
+	uint32_t			lba = req->offset / FDC_SECTOR_SIZE;
+	uint32_t			count = (req->size - req->bytes) / FDC_SECTOR_SIZE;
+	uint8_t				*ptr = (uint8_t*)req->buffer + req->bytes;
+	uint32_t			done = 0;
+	HRESULT				hr;
+
+	UNUSED_ARG(q);
+
+	if (count == 0) {
+		return S_OK;
+	}
+
+	lba += req->bytes / FDC_SECTOR_SIZE;
+
+	if (req->op == AIO_OP_READ) {
+		hr = fdc_read(ctx, lba, count, ptr, &done);
+	} else {
+		hr = fdc_write(ctx, lba, count, ptr, &done);
+	}
+
+	req->bytes += done * FDC_SECTOR_SIZE;
+	return hr;
 }
 
 /**
@@ -938,11 +1137,20 @@ HRESULT __nxapi fdc_install()
 	hr = fdc_reset(ctrl);
 	if (FAILED(hr)) return hr;
 
+	/* Start asynchronous request queue */
+	hr = aio_queue_create(&ctrl->io_queue, AIO_DEFAULT_QUEUE_DEPTH, fdc_aio_service, ctrl, 1);
+	if (FAILED(hr)) return hr;
+
+	/* Turns idle motors off, runs while the controller is ready */
+	hr = sched_create_thread(NULL, fdc_motor_thread, NULL);
+	if (FAILED(hr)) return hr;
+
 	/* Populate device struct */
 	memset(&dev, 0, sizeof(dev));
 	dev.default_url = "/dev/fdd0";
 	dev.type 		= DEVICE_TYPE_BLOCK;
 	dev.ioctl 		= fdc_ioctl;
+	dev.submit		= fdc_submit;
 	dev.initialize 	= fdc_driver_init;
 	dev.finalize 	= fdc_driver_fini;
 
@@ -975,12 +1183,49 @@ HRESULT __nxapi fdc_uninstall()
 	return S_OK;
 }
 
+#define FDC_SELFTEST_SECTORS	(10 * FDC_CYLINDER_SECTORS)
+
+/*
+ * Reads the first FDC_SELFTEST_SECTORS sectors one at a time, the way file
+ * systems do, and prints the throughput.
+ */
+static HRESULT fdc_selftest_throughput(K_STREAM *hdrv, const char *label, void *buff)
+{
+	IOCTL_STORAGE_READWRITE rw_desc;
+	QWORD					t;
+	uint32_t				i, ms;
+	HRESULT					hr = S_OK;
+
+	t = timer_gettickcount();
+
+	for (i=0; i<FDC_SELFTEST_SECTORS && SUCCEEDED(hr); i++) {
+		rw_desc.start = i;
+		rw_desc.count = 1;
+		rw_desc.buffer= buff;
+
+		hr = k_ioctl(hdrv, IOCTL_STORAGE_READ_BLOCKS, &rw_desc);
+	}
+
+	ms = (uint32_t)(timer_gettickcount() - t);
+
+	if (FAILED(hr)) {
+		k_printf("%s: read failed at sector %d (hr=0x%X).\n", label, i - 1, hr);
+		return hr;
+	}
+
+	k_printf("%s: %d KiB in %d ms (%d KiB/s)\n", label, FDC_SELFTEST_SECTORS * FDC_SECTOR_SIZE / 1024,
+			ms, ms ? FDC_SELFTEST_SECTORS * FDC_SECTOR_SIZE / ms * 1000 / 1024 : 0);
+
+	return S_OK;
+}
+
 /*
  * Performs simple self test
  */
 HRESULT fdc_selftest()
 {
 	IOCTL_STORAGE_READWRITE rw_desc;
+	FDC_DRIVE_CONTEXT		*drive;
 	uint8_t					*buff = kmalloc(FDC_SECTOR_SIZE);
 	K_STREAM 				*hdrv;
 	HRESULT					hr;
@@ -1000,13 +1245,13 @@ HRESULT fdc_selftest()
 	/* Perform block read - read the boot sector */
 	hr = k_ioctl(hdrv, IOCTL_STORAGE_READ_BLOCKS, &rw_desc);
 	if (FAILED(hr))	{
-		k_printf("fdc_selftest(): failed to read block via ioctl (hr=%x).", hr);
+		k_printf("fdc_selftest(): failed to read block via ioctl (hr=0x%X).", hr);
 		goto finally;
 	}
 
 	/* Print first 128 bytes of boot sector */
 	for (i=0; i<128; i++) {
-		k_printf("%x ", (uint32_t)buff[i]);
+		k_printf("0x%X ", (uint32_t)buff[i]);
 
 		if (buff[i] <= 0xF) {
 			k_printf(" ");
@@ -1017,6 +1262,33 @@ HRESULT fdc_selftest()
 		}
 	}
 
+	/*
+	 * Throughput, per sector commands vs. whole cylinders through the
+	 * track cache
+	 */
+	drive = GET_DRV_CTX(hdrv);
+
+	mutex_lock(&controller.lock);
+	fdc_track_cache_enabled = FALSE;
+	mutex_unlock(&controller.lock);
+
+	hr = fdc_selftest_throughput(hdrv, "uncached", buff);
+
+	mutex_lock(&controller.lock);
+	fdc_track_cache_enabled = TRUE;
+	fdc_invalidate_tracks(drive);
+	drive->track_hits = drive->track_misses = 0;
+	mutex_unlock(&controller.lock);
+
+	if (SUCCEEDED(hr)) hr = fdc_selftest_throughput(hdrv, "track cache, cold", buff);
+	if (SUCCEEDED(hr)) hr = fdc_selftest_throughput(hdrv, "track cache, warm", buff);
+
+	k_printf("track cache: %d hits, %d misses\n", drive->track_hits, drive->track_misses);
+
+	/* Let the motor-off timer stop the motor */
+	timer_sleep(FDC_MOTOR_OFF_DELAY * 2);
+	k_printf("motor %s after %d ms idle\n", drive->motor_state ? "still on" : "off", FDC_MOTOR_OFF_DELAY * 2);
+
 finally:
 	kfree(buff);
 	hr = k_fclose(&hdrv);
@@ -14,6 +14,14 @@
 
 #define FLOPPY_144_SECTORS_PER_TRACK 18
 
+/* A cylinder holds a track on each head. It is read by a single multi-track
+ * command, so the track cache works with whole cylinders. */
+#define FDC_CYLINDER_SECTORS			(2 * FLOPPY_144_SECTORS_PER_TRACK)
+#define FDC_CYLINDER_SIZE				(FDC_CYLINDER_SECTORS * FDC_SECTOR_SIZE)
+
+/* Number of cylinders kept in the track cache, per drive */
+#define FDC_TRACK_CACHE_SIZE			8
+
 /* Time out for FIFO operations in milliseconds */
 #define FDC_FIFO_TIMEOUT				200
 #define FDC_RESET_TIMEOUT				200
@@ -23,6 +31,12 @@
 #define FDC_DEFAULT_TIMEOUT				200
 #define FDC_IRQ_TIMEOUT					500
 
+/* A cylinder takes two revolutions (400 ms at 300 RPM) */
+#define FDC_TRANSFER_TIMEOUT			1200
+
+/* The motor is turned off after being idle for this long */
+#define FDC_MOTOR_OFF_DELAY				2000
+
 #define FDC_SEEK_DELAY					15
 #define FDC_DEFAULT_COMMAND_RETRIES		2
 
@@ -30,10 +44,10 @@
 #define FDC_SECTOR_SIZE					512
 #define FDC_SECTOR_COUNT				2880
 
-/* Due to the fact that we can't map memory less than 4kb size,
- * we have to use bigger DMA buffer size than the actual sector size.
+/* Holds a whole cylinder, rounded up to pages. Must not cross a 64 KiB
+ * physical boundary, which ISA DMA can't do.
  */
-#define FDC_DMA_BUFFER_SIZE				4096
+#define FDC_DMA_BUFFER_SIZE				20480
 
 /* Define symbolic constants for registers */
 #define REG_STATUS_A					0x03F0 //SRA (read-only)
@@ -52,7 +66,8 @@ HRESULT __nxapi fdc_install();
 /* Uninstalls driver */
 HRESULT __nxapi fdc_uninstall();
 
-/* Performs simple self test */
+/* Performs simple self test and measures read throughput with and
+ * without the track cache */
 HRESULT fdc_selftest();
 
 #endif /* DRIVERS_FLOPPY_H_ */
@@ -9,6 +9,8 @@
 #include <kstdio.h>
 #include <hal.h>
 #include <mm.h>
+#include <dcache.h>
+#include <dirindex.h>
 
 /*
  * Prototypes
@@ -17,7 +19,9 @@ static HRESULT iso9660_parse_superblock(ISO9660_DRV_CONTEXT *ctx);
 static HRESULT iso9660_validate_vd_header(char *hdr);
 static HRESULT iso9660_extract_filename(ISO9660_DIR_ENTRY *entry, char *target);
 
+static HRESULT iso9660_dir_index(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, K_DIRINDEX **out);
 static HRESULT iso9660_find_subentry(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint32_t flagmask, ISO9660_DIR_ENTRY *dst);
+static HRESULT iso9660_lookup(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint32_t flagmask, ISO9660_DIR_ENTRY *dst);
 static HRESULT iso9660_parse_url(K_FS_DRIVER *drv, char *url, ISO9660_DIR_ENTRY *out_entry);
 static HRESULT iso9660_file_read_block(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *entry, uint32_t start, uint32_t count, void *dst);
 static HRESULT iso9660_file_read_buffer(K_STREAM *s, ISO9660_DIR_ENTRY *entry, uint32_t start_addr, uint32_t size, void *dst);
@@ -35,6 +39,8 @@ static HRESULT iso9660_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_I
 static HRESULT iso9660_rewinddir(K_DIR_STREAM *dirstr);
 static HRESULT iso9660_closedir(K_DIR_STREAM **dirstr);
 static HRESULT iso9660_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read);
+static HRESULT iso9660_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+static HRESULT iso9660_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
 static HRESULT iso9660_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written);
 static HRESULT iso9660_file_ioctl(K_STREAM *s, uint32_t code, void *arg);
 static uint32_t iso9660_file_seek(K_STREAM *s, int64_t pos, int8_t origin);
@@ -112,6 +118,10 @@ iso9660_fini(K_FS_DRIVER *drv)
 		k_fclose(&ctx->storage_drv);
 	}
 
+	/* Cached directory entries and indexes refer to this instance */
+	dcache_invalidate_owner(drv);
+	dirindex_invalidate_owner(drv);
+
 	kfree(ctx->pvd);
 
 	/* Free driver context */
@@ -157,28 +167,29 @@ iso9660_validate_vd_header(char *hdr)
 	return memcmp(hdr, h, 5) == 0 ? S_OK : E_FAIL;
 }
 
+/*
+ * Retrieves the index of directory `dir`, keyed by the first sector of it's
+ * extent, reading and decoding the directory if it isn't cached. Each entry
+ * holds the fixed part of the directory record. Hidden entries, "." and ".."
+ * are left out.
+ */
 static HRESULT
-iso9660_find_subentry(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint32_t flagmask, ISO9660_DIR_ENTRY *dst)
+iso9660_dir_index(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, K_DIRINDEX **out)
 {
 	ISO9660_DRV_CONTEXT *c = drv->priv_data;
 	uint8_t				*content;
 	uint32_t			content_size;
+	uint32_t			size = dir->extent_size.lsb;
 	uint32_t			offset = 0;
 	ISO9660_DIR_ENTRY	*entry;
-	HRESULT				hr = S_OK;
+	K_DIRINDEX			*idx;
+	HRESULT				hr;
 
-	/* If dir is 'NULL' we expected to search in root directory */
-	if (dir == NULL) {
-		dir = (ISO9660_DIR_ENTRY*)c->pvd->root_dir_entry;
-	}
-
-	/* Make sure this entry is a directory */
-	if ((dir->flags & FLAG_DIRECTORY) == 0) {
-		return E_INVALIDARG;
-	}
+	hr = dirindex_get(drv, dir->extent_start.lsb, out);
+	if (hr != S_FALSE) return hr;
 
 	/* Round up to size multiple of sector size */
-	content_size = dir->extent_size.lsb + (ISO9660_SECTOR_SIZE - dir->extent_size.lsb % ISO9660_SECTOR_SIZE);
+	content_size = (size + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE * ISO9660_SECTOR_SIZE;
 
 	/* Allocate buffer to store directory's content */
 	if (!(content = kmalloc(content_size))) {
@@ -187,63 +198,141 @@ iso9660_find_subentry(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint
 
 	/* Read directory content from storage */
 	hr = storage_read_blocks(c->storage_drv, dir->extent_start.lsb, content_size / ISO9660_SECTOR_SIZE, content);
-	if (FAILED(hr)) return hr;
+	if (FAILED(hr)) goto finally;
 
-	while (offset != content_size) {
-		if (offset > content_size) {
-			/* Totally unexpected */
-			HalKernelPanic("iso9660_find_subentry(): unexpected case of reaching out of content buffer.");
-		}
+	hr = dirindex_create(drv, dir->extent_start.lsb, sizeof(ISO9660_DIR_ENTRY), &idx);
+	if (FAILED(hr)) goto finally;
 
+	while (offset < size) {
 		/* ECMA-119 Directory Record format can hold composed names of up to 222 characters. */
 		char filename[223];
 
 		/* Read single subentry */
 		entry = (ISO9660_DIR_ENTRY*)(content + offset);
 
-		/* Skip hidden files */
-		if (entry->flags & FLAG_HIDDEN) {
-			goto next;
+		/* Handle gaps, records don't cross sector boundaries */
+		if (entry->length == 0) {
+			offset += ISO9660_SECTOR_SIZE - offset % ISO9660_SECTOR_SIZE;
+			continue;
 		}
 
-		/* Extract current subentry name to local char string */
-		hr = iso9660_extract_filename(entry, filename);
-		if (FAILED(hr)) return hr;
-
-		/* Compare names */
-		if (strcmp(name, filename) == 0) {
-			/* Enforce flag mask */
-			if (flagmask != 0 && (entry->flags & flagmask) != flagmask) {
-				/* Flags don't match */
-				hr = E_NOTFOUND;
-				goto finally;
-			}
+		if (offset + entry->length > size) {
+			/* Corrupted record */
+			hr = E_FAIL;
+			break;
+		}
 
-			/* Found */
-			memcpy(dst, entry, sizeof(ISO9660_DIR_ENTRY));
+		/* Skip hidden files, "." and ".." */
+		if ((entry->flags & FLAG_HIDDEN) == 0 &&
+			!(entry->name_length == 1 && (entry->name[0] == '\0' || entry->name[0] == '\1')))
+		{
+			/* Extract current subentry name to local char string */
+			iso9660_extract_filename(entry, filename);
 
-			hr =  S_OK;
-			goto finally;
+			hr = dirindex_add(idx, filename, entry, 0);
+			if (FAILED(hr)) break;
 		}
 
-next:
 		/* Next entry */
 		offset += entry->length;
+	}
 
-		/* Handle gaps */
-		if (content[offset] == 0) {
-			offset += ISO9660_SECTOR_SIZE - offset % ISO9660_SECTOR_SIZE;
-		}
+	if (SUCCEEDED(hr)) {
+		hr = dirindex_publish(idx);
 	}
 
-	/* If we have reached here, then the requested entry is not found */
-	hr = E_NOTFOUND;
+	if (FAILED(hr)) {
+		dirindex_release(idx);
+		goto finally;
+	}
+
+	*out = idx;
+	hr = S_OK;
 
 finally:
 	kfree(content);
 	return hr;
 }
 
+/*
+ * Finds a subentry of directory `dir` (NULL for the root directory) by name,
+ * using the directory index.
+ */
+static HRESULT
+iso9660_find_subentry(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint32_t flagmask, ISO9660_DIR_ENTRY *dst)
+{
+	ISO9660_DRV_CONTEXT *c = drv->priv_data;
+	ISO9660_DIR_ENTRY	entry;
+	K_DIRINDEX			*idx;
+	HRESULT				hr;
+
+	/* If dir is 'NULL' we expected to search in root directory */
+	if (dir == NULL) {
+		dir = (ISO9660_DIR_ENTRY*)c->pvd->root_dir_entry;
+	}
+
+	/* Make sure this entry is a directory */
+	if ((dir->flags & FLAG_DIRECTORY) == 0) {
+		return E_INVALIDARG;
+	}
+
+	hr = iso9660_dir_index(drv, dir, &idx);
+	if (FAILED(hr)) return hr;
+
+	hr = dirindex_find(idx, name, &entry);
+	dirindex_release(idx);
+
+	if (FAILED(hr)) return hr;
+
+	/* Enforce flag mask */
+	if (flagmask != 0 && (entry.flags & flagmask) != flagmask) {
+		/* Flags don't match */
+		return E_NOTFOUND;
+	}
+
+	/* Found */
+	memcpy(dst, &entry, sizeof(ISO9660_DIR_ENTRY));
+	return S_OK;
+}
+
+/*
+ * Cached version of iso9660_find_subentry(). Entries are keyed by the first
+ * sector of the directory's extent. Only the fixed part of the directory record
+ * is cached, which is all that iso9660_find_subentry() returns anyway.
+ */
+static HRESULT
+iso9660_lookup(K_FS_DRIVER *drv, ISO9660_DIR_ENTRY *dir, char *name, uint32_t flagmask, ISO9660_DIR_ENTRY *dst)
+{
+	ISO9660_DRV_CONTEXT *c = drv->priv_data;
+	ISO9660_DIR_ENTRY	entry;
+	uint64_t			parent;
+	HRESULT				hr;
+
+	parent = (dir == NULL ? (ISO9660_DIR_ENTRY*)c->pvd->root_dir_entry : dir)->extent_start.lsb;
+
+	hr = dcache_lookup(drv, parent, name, &entry, sizeof(ISO9660_DIR_ENTRY));
+
+	if (hr == S_FALSE) {
+		hr = iso9660_find_subentry(drv, dir, name, 0, &entry);
+
+		if (SUCCEEDED(hr)) {
+			dcache_insert(drv, parent, name, &entry, sizeof(ISO9660_DIR_ENTRY));
+		} else if (hr == E_NOTFOUND) {
+			dcache_insert(drv, parent, name, NULL, 0);
+		}
+	}
+
+	if (FAILED(hr)) return hr;
+
+	/* Enforce flag mask */
+	if (flagmask != 0 && (entry.flags & flagmask) != flagmask) {
+		return E_NOTFOUND;
+	}
+
+	*dst = entry;
+	return S_OK;
+}
+
 static HRESULT
 iso9660_extract_filename(ISO9660_DIR_ENTRY *entry, char *target)
 {
@@ -340,6 +429,8 @@ iso9660_open(K_FS_DRIVER *drv, char *filename, uint32_t flags, K_STREAM **out)
 	stream->seek	= iso9660_file_seek;
 	stream->tell	= iso9660_file_tell;
 	stream->close	= iso9660_file_close;
+	stream->readv	= iso9660_file_readv;
+	stream->pread	= iso9660_file_pread;
 
 	/* Success */
 	*out = stream;
@@ -404,9 +495,9 @@ iso9660_parse_url(K_FS_DRIVER *drv, char *url, ISO9660_DIR_ENTRY *out_entry)
 
 		/* Search */
 		if (i == 0) {
-			hr = iso9660_find_subentry(drv, NULL, comp_name, flagmask, &curr_entry);
+			hr = iso9660_lookup(drv, NULL, comp_name, flagmask, &curr_entry);
 		} else {
-			hr = iso9660_find_subentry(drv, &curr_entry, comp_name, flagmask, &curr_entry);
+			hr = iso9660_lookup(drv, &curr_entry, comp_name, flagmask, &curr_entry);
 		}
 		if (FAILED(hr)) goto finally;
 	}
@@ -420,16 +511,49 @@ finally:
 }
 
 /*
- * Reads `block_size` bytes from a file stream.
+ * Reads up to `size` bytes starting at `pos`, without moving the position
+ * marker. Must be called with stream mutex held.
  */
 static HRESULT
-iso9660_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
+iso9660_file_read_at(K_STREAM *str, uint32_t pos, size_t size, void *out_buf, size_t *bytes_read)
 {
 	ISO9660_STR_CONTEXT *strctx = str->priv_data;
 	ISO9660_DIR_ENTRY	*entry = &strctx->entry;
-	uint32_t			effective_size = block_size;
+	uint32_t			effective_size = size;
 	HRESULT				hr;
 
+	if (bytes_read) *bytes_read = 0;
+
+	if (pos >= entry->extent_size.lsb) {
+		effective_size = 0;
+	} else if (size + pos >= entry->extent_size.lsb) {
+		effective_size = entry->extent_size.lsb - pos;
+	}
+
+	if (effective_size == 0) {
+		/* End of file */
+		return E_ENDOFSTR;
+	}
+
+	/* Read content */
+	hr = iso9660_file_read_buffer(str, entry, pos, effective_size, out_buf);
+	if (FAILED(hr)) return hr;
+
+	/* Set output parameter */
+	if (bytes_read) *bytes_read = effective_size;
+
+	return S_OK;
+}
+
+/*
+ * Reads `block_size` bytes from a file stream.
+ */
+static HRESULT
+iso9660_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
+{
+	size_t	done;
+	HRESULT	hr;
+
 	/* Validate input parameters */
 	if (block_size == 0) {
 		return E_INVALIDARG;
@@ -442,33 +566,74 @@ iso9660_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t
 	/* Lock stream mutex */
 	mutex_lock(&str->lock);
 
-	if (block_size + str->pos >= entry->extent_size.lsb) {
-		effective_size = entry->extent_size.lsb - str->pos;
-	}
-
-	if (effective_size == 0) {
-		/* End of file */
-		if (bytes_read) *bytes_read = 0;
-		hr = E_ENDOFSTR;
-
-		goto finally;
-	}
-
-	/* Read content */
-	hr = iso9660_file_read_buffer(str, entry, str->pos, effective_size, out_buf);
+	hr = iso9660_file_read_at(str, str->pos, block_size, out_buf, &done);
 	if (FAILED(hr)) goto finally;
 
 	/* Move position */
-	str->pos += effective_size;
+	str->pos += done;
 
 	/* Set output parameter */
-	if (bytes_read) *bytes_read = effective_size;
+	if (bytes_read) *bytes_read = done;
 
 finally:
+	if (FAILED(hr) && bytes_read) *bytes_read = 0;
+
 	mutex_unlock(&str->lock);
 	return hr;
 }
 
+/*
+ * Scatter-reads into a vector of buffers with a single lock acquisition.
+ */
+static HRESULT
+iso9660_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read)
+{
+	size_t	total = 0, done;
+	HRESULT	hr = S_OK;
+
+	mutex_lock(&str->lock);
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0) continue;
+
+		hr = iso9660_file_read_at(str, str->pos, iov[i].len, iov[i].base, &done);
+
+		str->pos += done;
+		total += done;
+
+		if (FAILED(hr) || done < iov[i].len) break;
+	}
+
+	mutex_unlock(&str->lock);
+
+	if (bytes_read) *bytes_read = total;
+	return total > 0 ? S_OK : hr;
+}
+
+/*
+ * Reads at given offset, leaving the position marker intact.
+ */
+static HRESULT
+iso9660_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read)
+{
+	HRESULT hr;
+
+	if (!out_buf) {
+		return E_POINTER;
+	}
+
+	if (offset > 0xFFFFFFFF) {
+		if (bytes_read) *bytes_read = 0;
+		return E_ENDOFSTR;
+	}
+
+	mutex_lock(&str->lock);
+	hr = iso9660_file_read_at(str, (uint32_t)offset, size, out_buf, bytes_read);
+	mutex_unlock(&str->lock);
+
+	return hr;
+}
+
 /*
  * Reads sector-aligned file content.
  *
@@ -726,10 +891,9 @@ iso9660_file_close(K_STREAM **str)
 static HRESULT
 iso9660_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out)
 {
-	ISO9660_DRV_CONTEXT	*c = drv->priv_data;
 	ISO9660_DIR_ENTRY	entry;
-	uint32_t			size;
-	void				*dir_content;
+	K_DIRINDEX			*idx;
+	K_DIR_STREAM		*ds;
 	HRESULT				hr;
 
 	hr = iso9660_parse_url(drv, dirname, &entry);
@@ -740,36 +904,27 @@ iso9660_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out)
 		return E_FAIL;
 	}
 
-	/* Allocate a memory buffer to load the directory content */
-	size = entry.extent_size.lsb + ISO9660_SECTOR_SIZE - entry.extent_size.lsb % ISO9660_SECTOR_SIZE;
-
-	if (!(dir_content = kmalloc(size))) {
-		return E_OUTOFMEM;
-	}
-
-	/* Read directory content */
-	hr = storage_read_blocks(c->storage_drv, entry.extent_start.lsb, (size + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE, dir_content);
-	if (FAILED(hr)) goto finally;
+	/* Index directory content, the stream iterates the index */
+	hr = iso9660_dir_index(drv, &entry, &idx);
+	if (FAILED(hr)) return hr;
 
 	/* Create new kernel directory stream */
-	K_DIR_STREAM *ds;
-
 	if (!(ds = kmalloc(sizeof(K_DIR_STREAM)))) {
-		hr = E_OUTOFMEM;
-		goto finally;
+		dirindex_release(idx);
+		return E_OUTOFMEM;
 	}
 
 	/* Allocate string to hold name of the directory being opened */
 	if (!(ds->dirname = kcalloc(VFS_MAX_DIRNAME_LENGTH))) {
-		hr = E_OUTOFMEM;
-		goto finally;
+		dirindex_release(idx);
+		kfree(ds);
+		return E_OUTOFMEM;
 	}
 
-	mutex_create(&ds->lock);
 	strcpy(ds->dirname, dirname);
 
-	ds->priv_data = dir_content;
-	ds->len = entry.extent_size.lsb; //iso9660_get_subentry_count(dir_content, entry->extent_size.lsb);
+	ds->priv_data = idx;
+	ds->len = idx->count;
 	ds->pos = 0;
 
 	/* Assign ops */
@@ -779,13 +934,7 @@ iso9660_opendir(K_FS_DRIVER *drv, char *dirname, K_DIR_STREAM **out)
 
 	/* Success */
 	*out = ds;
-
-finally:
-	if (FAILED(hr)) {
-		kfree(dir_content);
-	}
-
-	return hr;
+	return S_OK;
 }
 
 /**
@@ -831,64 +980,29 @@ next:
 static HRESULT
 iso9660_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info)
 {
+	K_DIRINDEX			*idx = dirstr->priv_data;
 	ISO9660_DIR_ENTRY	*entry;
-	uint32_t			new_offs = dirstr->pos;
-	uint8_t				*content = dirstr->priv_data;
+	const char			*name;
+	uint32_t			pos = dirstr->pos;
 	HRESULT				hr;
 
-	mutex_lock(&dirstr->lock);
-
-	while (TRUE) {
-		/* We will use dirstr->pos as offset */
-		entry = (ISO9660_DIR_ENTRY*)(content + new_offs);
-
-		/* Handle gaps */
-		if (content[new_offs] == 0) {
-			new_offs += ISO9660_SECTOR_SIZE - new_offs % ISO9660_SECTOR_SIZE;
-			continue;
-		}
-
-		if (new_offs >= (uint32_t)dirstr->len) {
-			hr = E_ENDOFSTR;
-			goto finally;
-		}
-
-		/* Skip "." and ".." entries */
-		if (entry->name_length == 1 && (entry->name[0] == '\0' || entry->name[0] == '\1')) {
-			/* Move to next one */
-			new_offs += entry->length;
-			continue;
-		}
-
-		/* Skip hiddne subentries */
-		if ((entry->flags & FLAG_HIDDEN) != 0) {
-			/* Move to next one */
-			new_offs += entry->length;
-			continue;
-		}
+	/* Moves position too */
+	hr = dirindex_next(idx, &pos, &name, (void**)&entry);
+	dirstr->pos = pos;
 
-		break;
-	}
+	if (FAILED(hr)) return hr;
 
 	info->node_type	= (entry->flags & FLAG_DIRECTORY) == 0 ? NODE_TYPE_FILE : NODE_TYPE_DIRECTORY;
 	info->size 		= entry->extent_size.lsb;
-	iso9660_extract_filename(entry, filename);
-
-	dirstr->pos = new_offs += entry->length;
-	hr 			= S_OK;
+	strcpy(filename, (char*)name);
 
-finally:
-	mutex_unlock(&dirstr->lock);
-	return hr;
+	return S_OK;
 }
 
 static HRESULT
 iso9660_rewinddir(K_DIR_STREAM *dirstr)
 {
-	mutex_lock(&dirstr->lock);
 	dirstr->pos = 0;
-	mutex_unlock(&dirstr->lock);
-
 	return S_OK;
 }
 
@@ -899,12 +1013,11 @@ iso9660_closedir(K_DIR_STREAM **dirstr)
 
 	kfree(d->dirname);
 
-	/* Free content */
+	/* Release index */
 	if (d->priv_data) {
-		kfree(d->priv_data);
+		dirindex_release(d->priv_data);
 	}
 
-	mutex_destroy(&d->lock);
 	kfree(d);
 
 	*dirstr = NULL;
@@ -271,3 +271,31 @@ HRESULT __nxapi pci_find_device(uint32_t vendor_id, uint32_t device_id, K_PCI_CO
 	hr = pci_scan(&p);
 	return hr == E_TERMINATED ? S_OK : E_NOTFOUND;
 }
+
+static HRESULT __nxapi pci_find_class_cb(K_PCI_CONFIG_ADDRESS addr, uint32_t vendor_id, uint32_t device_id, void *user)
+{
+	UNUSED_ARG(vendor_id);
+	UNUSED_ARG(device_id);
+
+	/* Class is matched by the scanner, so the first call is the one */
+	*(K_PCI_CONFIG_ADDRESS*)user = addr;
+	return E_TERMINATED;
+}
+
+/*
+ * Finds the first function of given class and subclass, like the IDE
+ * controller (PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE).
+ */
+HRESULT __nxapi pci_find_class(uint32_t class, uint32_t subclass, K_PCI_CONFIG_ADDRESS *addr_out)
+{
+	K_PCI_SCAN_PARAMS p;
+	HRESULT hr;
+
+	p.cb = pci_find_class_cb;
+	p.user = addr_out;
+	p.class_selector = class;
+	p.subclass_selector = subclass;
+
+	hr = pci_scan(&p);
+	return hr == E_TERMINATED ? S_OK : E_NOTFOUND;
+}
@@ -47,8 +47,17 @@
 #define PCI_SECONADRY_BUS		0x19 //1
 
 /* PCI class */
+#define PCI_CLASS_STORAGE		0x01
 #define PCI_CLASS_BRIDGE		0x06
 
+/* Storage subclasses */
+#define PCI_SUBCLASS_IDE		0x01
+
+/* Command register bits */
+#define PCI_COMMAND_IO			0x0001
+#define PCI_COMMAND_MEMORY		0x0002
+#define PCI_COMMAND_BUS_MASTER	0x0004
+
 /* Class/subclass selectors */
 #define PCI_CLASS_SELECTOR_ALL		0xFFFFFFFF
 #define PCI_SUBCLASS_SELECTOR_ALL 	0xFFFFFFFF
@@ -113,5 +122,6 @@ HRESULT __nxapi pci_scan_slot(uint32_t bus_id, uint32_t device_id, K_PCI_SCAN_PA
 HRESULT __nxapi pci_scan_function(uint32_t bus_id, uint32_t device_id, uint32_t func_id, K_PCI_SCAN_PARAMS *params);
 HRESULT __nxapi pci_scan(K_PCI_SCAN_PARAMS *params);
 HRESULT __nxapi pci_find_device(uint32_t vendor_id, uint32_t device_id, K_PCI_CONFIG_ADDRESS *addr_out);
+HRESULT __nxapi pci_find_class(uint32_t class, uint32_t subclass, K_PCI_CONFIG_ADDRESS *addr_out);
 
 #endif /* DRIVERS_PCI_BUS_H_ */
@@ -826,7 +826,7 @@ static HRESULT sb16_begin_playback(K_STREAM *s)
 				DMA_MODE_SINGLE,
 				TRUE
 		);
-		//k_printf("isadma_open_channel(): hr=%x\n", hr);
+		//k_printf("isadma_open_channel(): hr=0x%X\n", hr);
 		if (FAILED(hr))	return hr;
 	}
 
@@ -991,7 +991,7 @@ static HRESULT sb16_device_init(K_DEVICE *self)
 	hr = sb_get_version(&vmaj, &vmin);
 	if (FAILED(hr)) goto fail;
 
-//	vga_printf("SoundBlater 16 card found with base port %x; version:%d.%d\n", base_ports[i], vmaj, vmin);
+//	vga_printf("SoundBlater 16 card found with base port 0x%X; version:%d.%d\n", base_ports[i], vmaj, vmin);
 	if (vmaj < 4) {
 		vga_printf("Version below 4.0 are not supported by driver.");
 		return E_FAIL;
@@ -1110,7 +1110,7 @@ static HRESULT sb16_write(K_STREAM *str, const int32_t block_size, void *in_buf,
 	hr = rb_write(ctx, in_buf, block_size);
 	if (FAILED(hr)) goto unlock;
 
-//	k_printf("write successful! block_size=%x rp=%x wp=%x cap=%x\n",
+//	k_printf("write successful! block_size=0x%X rp=0x%X wp=0x%X cap=0x%X\n",
 //				block_size, ctx->audio_rp, ctx->audio_wp, ctx->audio_buffer_capacity);
 
 	if (bytes_written) *bytes_written = block_size;
@@ -86,9 +86,26 @@ HRESULT __nxapi bga_set_mode(K_VIDEO_DRIVER_IFACE *this, K_VIDEO_MODE_DESC *desc
 	desc->bpp = video_format_to_bpp(desc->format);
 	desc->stride = desc->width * desc->bpp / 8;
 
-	hr = bga_set_mode_inner(desc->width, desc->height, desc->bpp, TRUE);
+	if (desc->bpp == 0) {
+		return E_INVALIDARG;
+	}
+
+	/* BGA tells 15 and 16 bpp modes apart by depth */
+	hr = bga_set_mode_inner(desc->width, desc->height, desc->format == VIDEO_FORMAT_RGB555 ? 15 : desc->bpp, TRUE);
 	if (FAILED(hr)) return hr;
 
+	/* Two pages stacked vertically, if video memory is large enough */
+	vc->pages = 1;
+
+	if (2 * desc->stride * desc->height <= vc->lfb_size && SUCCEEDED(bga_set_virtual_height(2 * desc->height))) {
+		vc->pages = 2;
+	}
+
+	bga_set_display_offset(0, 0);
+	vc->front = 0;
+	vc->prev_count = 0;
+	vc->prev_full = TRUE;
+
 	vc->mode = *desc;
 	return S_OK;
 }
@@ -120,6 +137,20 @@ HRESULT __nxapi bga_select_bank(uint32_t bank_id)
 	return bga_read(VBE_DISPI_INDEX_BANK) == bank_id ? S_OK : E_FAIL;
 }
 
+HRESULT __nxapi bga_set_virtual_height(uint32_t height)
+{
+	bga_write(VBE_DISPI_INDEX_VIRT_HEIGHT, height);
+
+	/* BGA clamps it to the available video memory */
+	return bga_read(VBE_DISPI_INDEX_VIRT_HEIGHT) == height ? S_OK : E_FAIL;
+}
+
+VOID __nxapi bga_set_display_offset(uint32_t x, uint32_t y)
+{
+	bga_write(VBE_DISPI_INDEX_X_OFFSET, x);
+	bga_write(VBE_DISPI_INDEX_Y_OFFSET, y);
+}
+
 HRESULT __nxapi bga_enum_modes(K_VIDEO_DRIVER_IFACE *this, K_VIDEO_MODE_DESC *desc_arr, uint32_t *count)
 {
 	K_VIDEO_MODE_DESC	*d;
@@ -82,6 +82,18 @@ HRESULT __nxapi bga_get_lfb_addr(uintptr_t *start_addr);
  */
 HRESULT __nxapi bga_select_bank(uint32_t bank_id);
 
+/**
+ * Sets the height of video memory the display can scroll over. Fails if
+ * there isn't enough video memory for it.
+ */
+HRESULT __nxapi bga_set_virtual_height(uint32_t height);
+
+/**
+ * Sets the position in video memory of the displayed area's top left
+ * corner. Used for page flipping.
+ */
+VOID	__nxapi bga_set_display_offset(uint32_t x, uint32_t y);
+
 /**
  * Sets a particular video mode
  */
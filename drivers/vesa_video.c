@@ -11,6 +11,8 @@
 #include <string.h>
 #include <mm_virt.h>
 #include <mm.h>
+#include <../subsystems/nxgi_span.h>
+#include <../subsystems/nxgi_convert.h>
 #include "vesa_video.h"
 #include "vesa_bga.h"
 #include "pci_bus.h"
@@ -20,7 +22,7 @@
  */
 static HRESULT vesa_lock_fb(K_VIDEO_DRIVER_IFACE *this, uint32_t lock_flags, void **ptr_out, uint32_t *stride_out);
 static HRESULT vesa_unlock_fb(K_VIDEO_DRIVER_IFACE *this);
-static HRESULT __nxapi vesa_present(K_VIDEO_DRIVER_IFACE *this, BOOL sync);
+static HRESULT __nxapi vesa_present(K_VIDEO_DRIVER_IFACE *this, K_VIDEO_PRESENT_DESC *desc, BOOL sync);
 
 static HRESULT vesa_init(K_DEVICE *device);
 static HRESULT vesa_fini(K_DEVICE *dev);
@@ -156,7 +158,8 @@ static HRESULT vesa_lock_fb(K_VIDEO_DRIVER_IFACE *this, uint32_t lock_flags, voi
 	UNUSED_ARG(lock_flags);
 	mutex_lock(&vc->lock);
 
-	*ptr_out = (void*)vc->lfb_addr;
+	/* The page being displayed */
+	*ptr_out = (void*)(vc->lfb_addr + vc->front * vc->mode.stride * vc->mode.height);
 	*stride_out = vc->mode.stride;
 
 	return S_OK;
@@ -170,14 +173,112 @@ static HRESULT vesa_unlock_fb(K_VIDEO_DRIVER_IFACE *this)
 	return S_OK;
 }
 
-static HRESULT __nxapi vesa_present(K_VIDEO_DRIVER_IFACE *this, BOOL sync)
+/*
+ * Copies a rectangle of the back buffer to a page of the frame buffer.
+ * The frame buffer is write-combined and never read, so 32-bit pixels are
+ * written with non-temporal stores. Other formats are converted.
+ */
+static void vesa_present_rect(VESA_DRV_CONTEXT *vc, uint8_t *page, K_VIDEO_PRESENT_DESC *desc, K_VIDEO_RECT r)
+{
+	K_VIDEO_MODE_DESC	*m = &vc->mode;
+	uint32_t			w, h;
+	const uint8_t		*src;
+	uint8_t				*dst;
+
+	/* Clip to the screen */
+	if (r.x1 < 0) r.x1 = 0;
+	if (r.y1 < 0) r.y1 = 0;
+	if (r.x2 > (int32_t)m->width) r.x2 = m->width;
+	if (r.y2 > (int32_t)m->height) r.y2 = m->height;
+
+	if (r.x1 >= r.x2 || r.y1 >= r.y2) {
+		return;
+	}
+
+	w = r.x2 - r.x1;
+	h = r.y2 - r.y1;
+	dst = page + r.y1 * m->stride + r.x1 * m->bpp / 8;
+	src = (const uint8_t*)desc->bits + r.y1 * desc->stride + r.x1 * video_format_to_bpp(desc->format) / 8;
+
+	if (desc->format == m->format && m->bpp == 32) {
+		nxgi_span_copy_rect(dst, m->stride, src, desc->stride, w, h, NXGI_SPAN_NT);
+	} else {
+		nxgi_convert_rect(dst, m->stride, (NXGI_FORMAT)m->format, src, desc->stride, (NXGI_FORMAT)desc->format, w, h);
+	}
+
+	desc->bytes_written += w * h * m->bpp / 8;
+}
+
+static HRESULT __nxapi vesa_present(K_VIDEO_DRIVER_IFACE *this, K_VIDEO_PRESENT_DESC *desc, BOOL sync)
 {
+	VESA_DRV_CONTEXT 	*vc = (VESA_DRV_CONTEXT*)this;
+	K_VIDEO_RECT		full;
+	uint32_t			i, back;
+	uint8_t				*page;
+
+	/* BGA has no vertical retrace to wait for */
+	UNUSED_ARG(sync);
+
+	if (vc->mode.width == 0 || desc->bits == NULL) {
+		return E_INVALIDSTATE;
+	}
+
+	desc->bytes_written = 0;
+	full.x1 = 0;
+	full.y1 = 0;
+	full.x2 = vc->mode.width;
+	full.y2 = vc->mode.height;
+
+	mutex_lock(&vc->lock);
+
+	if (vc->pages < 2) {
+		/* Single page, updated in place */
+		page = (uint8_t*)vc->lfb_addr;
+
+		for (i=0; i<desc->rect_count; i++) {
+			vesa_present_rect(vc, page, desc, desc->rects[i]);
+		}
+
+		mutex_unlock(&vc->lock);
+		return S_OK;
+	}
+
 	/*
-	 * We can implement this later if we use double buffering (framebuffer chain).
+	 * The hidden page was last drawn two frames ago, so it gets both the
+	 * previous frame's rectangles and the new ones before it is shown.
+	 * Where they overlap, pixels are just written twice.
 	 */
-	UNUSED_ARG(this);
-	UNUSED_ARG(sync);
+	back = vc->front ^ 1;
+	page = (uint8_t*)vc->lfb_addr + back * vc->mode.stride * vc->mode.height;
 
+	if (vc->prev_full) {
+		vesa_present_rect(vc, page, desc, full);
+	} else {
+		for (i=0; i<vc->prev_count; i++) {
+			vesa_present_rect(vc, page, desc, vc->prev_rects[i]);
+		}
+
+		for (i=0; i<desc->rect_count; i++) {
+			vesa_present_rect(vc, page, desc, desc->rects[i]);
+		}
+	}
+
+	/* Flip */
+	if (vc->is_bga) {
+		bga_set_display_offset(0, back * vc->mode.height);
+	}
+
+	vc->front = back;
+
+	/* Remember what the other page misses now */
+	vc->prev_full = desc->rect_count > VESA_MAX_PRESENT_RECTS;
+	vc->prev_count = vc->prev_full ? 0 : desc->rect_count;
+
+	for (i=0; i<vc->prev_count; i++) {
+		vc->prev_rects[i] = desc->rects[i];
+	}
+
+	mutex_unlock(&vc->lock);
 	return S_OK;
 }
 
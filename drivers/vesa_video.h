@@ -15,6 +15,9 @@
 #include <devices.h>
 #include <devices_video.h>
 
+/* Rectangles remembered for the page that isn't displayed */
+#define VESA_MAX_PRESENT_RECTS	64
+
 typedef struct VESA_DRV_CONTEXT VESA_DRV_CONTEXT;
 struct VESA_DRV_CONTEXT {
 	/**
@@ -40,6 +43,20 @@ struct VESA_DRV_CONTEXT {
 	uintptr_t			lfb_phys_addr;
 	uintptr_t			lfb_addr;
 	uint32_t			lfb_size;
+
+	/** Pages in the frame buffer chain, 2 if we can flip them */
+	uint32_t			pages;
+
+	/** Page being displayed */
+	uint32_t			front;
+
+	/**
+	 * Rectangles presented to the front page, which the other page still
+	 * lacks. If there were too many, the whole page is out of date.
+	 */
+	K_VIDEO_RECT		prev_rects[VESA_MAX_PRESENT_RECTS];
+	uint32_t			prev_count;
+	BOOL				prev_full;
 };
 
 HRESULT __nxapi vesa_install();
@@ -11,6 +11,7 @@
 #include "mm.h"
 #include "hal.h"
 #include "vga.h"
+#include "vfs.h"
 
 HRESULT elf_probe(K_STREAM *s)
 {
@@ -184,6 +185,7 @@ HRESULT elf_load_from_memory(uint8_t *buff, uint32_t *pid_out)
 HRESULT elf_execute(K_STREAM *s, uint32_t *pid)
 {
 	uint32_t pos, endpos, size, bytes;
+	void *image;
 	HRESULT hr;
 
 	/* Test if stream is valid ELF format */
@@ -200,6 +202,14 @@ HRESULT elf_execute(K_STREAM *s, uint32_t *pid)
 
 	size = endpos - pos;
 
+	/* Load straight from the page cache, if the file system supports it */
+	if (pos == 0 && SUCCEEDED(vfs_mmap(s, 0, size, VFS_MMAP_SHARED, NULL, &image))) {
+		hr = elf_load_from_memory(image, pid);
+		vfs_munmap(NULL, image);
+
+		return hr;
+	}
+
 	/* Allocate buffer to download the elf content from stream */
 	uint8_t 		*buff = kmalloc(size);
 
@@ -274,6 +274,41 @@ _hal_get_eflags:
 
 	ret
 
+#
+# Enables SSE instructions: clears CR0.EM, sets CR0.MP and
+# CR4.OSFXSR/OSXMMEXCPT.
+#
+.global _hal_enable_sse
+_hal_enable_sse:
+	mov	eax, cr0
+	and	eax, 0xFFFFFFFB
+	or	eax, 0x2
+	mov	cr0, eax
+
+	mov	eax, cr4
+	or	eax, 0x600
+	mov	cr4, eax
+
+	ret
+
+#
+# Enables AVX instructions: sets CR4.OSXSAVE and turns on x87, SSE
+# and AVX state in XCR0. Must be called after _hal_enable_sse and
+# only if CPUID reports XSAVE and AVX.
+#
+.global _hal_enable_avx
+_hal_enable_avx:
+	mov	eax, cr4
+	or	eax, 0x40000
+	mov	cr4, eax
+
+	xor	ecx, ecx
+	xgetbv
+	or	eax, 0x7
+	xsetbv
+
+	ret
+
 .set MAGIC, 0xB001B001
 
 .global _hal_enter_userspace
@@ -0,0 +1,172 @@
+/*
+ * aio.h
+ *
+ *	Asynchronous I/O requests.
+ *
+ *	A K_IO_REQUEST describes a positional read or write. It is submitted to a
+ *	stream by aio_submit() and, once finished, is posted to a completion queue
+ *	owned by the caller.
+ *
+ *	Streams with a submit() operation queue the request to the K_IO_QUEUE of
+ *	their device, which is served by a driver thread sleeping on the device IRQ.
+ *	All other streams are served by a pool of kernel worker threads, which carry
+ *	out the request with the regular stream operations.
+ *
+ *	A stream must not be used synchronously while it has requests in flight.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_AIO_H_
+#define INCLUDE_AIO_H_
+
+#include "types.h"
+#include "kstream.h"
+#include "syncobjs.h"
+
+#define AIO_OP_READ					0x01
+#define AIO_OP_WRITE				0x02
+
+#define AIO_STATE_IDLE				0x00
+#define AIO_STATE_QUEUED			0x01
+#define AIO_STATE_ACTIVE			0x02
+#define AIO_STATE_COMPLETED			0x03
+
+/** Maximum number of queues, served by threads */
+#define AIO_MAX_QUEUES				8
+
+#define AIO_DEFAULT_QUEUE_DEPTH		32
+
+/** Number of threads serving the generic queue */
+#define AIO_WORKER_THREADS			2
+
+typedef struct K_IO_QUEUE K_IO_QUEUE;
+typedef struct K_IO_COMPLETION_QUEUE K_IO_COMPLETION_QUEUE;
+
+/**
+ * Carries out a single request on behalf of a queue thread. Sets req->bytes
+ * and returns the completion status.
+ */
+typedef HRESULT __nxapi (*K_IO_SERVICE)(K_IO_QUEUE *q, K_IO_REQUEST *req);
+
+struct K_IO_REQUEST {
+	/** [in] AIO_OP_* code, target stream and absolute offset */
+	uint32_t				op;
+	K_STREAM				*stream;
+	uint64_t				offset;
+
+	/** [in] Data buffer, which must stay valid until completion */
+	void					*buffer;
+	size_t					size;
+
+	/** [in] Not used by the kernel */
+	void					*user_data;
+
+	/** [out] Completion status (E_TERMINATED when cancelled) and bytes transferred */
+	HRESULT					status;
+	size_t					bytes;
+	volatile uint32_t		state;
+
+	/* Private to aio and the serving driver */
+	K_IO_QUEUE				*queue;
+	K_IO_COMPLETION_QUEUE	*cq;
+	void					*driver_data;
+	K_EVENT					done;
+	K_IO_REQUEST			*next;
+};
+
+/**
+ * FIFO of pending requests with bounded depth.
+ */
+struct K_IO_QUEUE {
+	K_IO_REQUEST	*head;
+	K_IO_REQUEST	*tail;
+	uint32_t		depth;
+	uint32_t		max_depth;
+
+	/** Signaled while the queue is not empty */
+	K_EVENT			event;
+	K_SPINLOCK		lock;
+
+	K_IO_SERVICE	service;
+	void			*context;
+
+	/* Threads requested and actually serving the queue */
+	uint32_t		threads_wanted;
+	uint32_t		threads_running;
+};
+
+/**
+ * Ring of finished requests. Each in-flight request holds a reserved slot,
+ * so completion never overflows the ring.
+ */
+struct K_IO_COMPLETION_QUEUE {
+	K_IO_REQUEST	**ring;
+	uint32_t		capacity;
+	uint32_t		head;
+	uint32_t		count;
+	uint32_t		reserved;
+
+	/** Signaled while the ring is not empty */
+	K_EVENT			event;
+	K_SPINLOCK		lock;
+};
+
+/**
+ * Creates the generic queue and it's worker threads. Must be called
+ * after the scheduler is running.
+ */
+HRESULT __nxapi aio_initialize();
+
+/**
+ * Initializes a queue and starts _thread_count_ threads, which pass
+ * requests to _service_.
+ */
+HRESULT __nxapi aio_queue_create(K_IO_QUEUE *q, uint32_t max_depth, K_IO_SERVICE service, void *context, uint32_t thread_count);
+
+/**
+ * Appends a request to a queue. Used by submit() implementations of drivers.
+ * Returns E_BUFFEROVERFLOW if the queue is full.
+ */
+HRESULT __nxapi aio_queue_push(K_IO_QUEUE *q, K_IO_REQUEST *req);
+
+HRESULT __nxapi aio_cq_create(uint32_t capacity, K_IO_COMPLETION_QUEUE **out);
+HRESULT __nxapi aio_cq_destroy(K_IO_COMPLETION_QUEUE **cq);
+
+/**
+ * Waits for the next finished request of a completion queue.
+ */
+HRESULT __nxapi aio_cq_wait(K_IO_COMPLETION_QUEUE *cq, uint32_t timeout, K_IO_REQUEST **out);
+
+/**
+ * Submits a request. _cq_ may be NULL, in which case the caller uses
+ * aio_wait(). Returns E_BUFFEROVERFLOW if either the device queue or
+ * the completion queue is full.
+ */
+HRESULT __nxapi aio_submit(K_STREAM *str, K_IO_REQUEST *req, K_IO_COMPLETION_QUEUE *cq);
+
+/**
+ * Cancels a request which is still queued. Requests already being served
+ * can't be cancelled (E_INVALIDSTATE).
+ */
+HRESULT __nxapi aio_cancel(K_IO_REQUEST *req);
+
+/**
+ * Waits for a particular request and returns it's completion status.
+ */
+HRESULT __nxapi aio_wait(K_IO_REQUEST *req, uint32_t timeout);
+
+/**
+ * Marks a request as finished and posts it to it's completion queue.
+ * Safe to call from an ISR.
+ */
+void __nxapi aio_complete(K_IO_REQUEST *req, HRESULT status, size_t bytes);
+
+/**
+ * Streams from the first IDE disk, synchronously and asynchronously,
+ * while a CPU-bound thread runs.
+ */
+HRESULT __nxapi aio_benchmark();
+
+#endif /* INCLUDE_AIO_H_ */
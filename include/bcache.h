@@ -0,0 +1,149 @@
+/*
+ * bcache.h
+ *
+ *	Block buffer cache.
+ *
+ *	Sits between file systems and storage drivers. storage_read_blocks() and
+ *	storage_write_blocks() are served from buffers, keyed by device and block
+ *	number, which are recycled in LRU order once the memory budget is used up.
+ *	Writes only dirty the buffers; a flusher thread writes them back
+ *	periodically, or when bcache_sync()/bcache_fsync() is called.
+ *
+ *	A device is identified by the VFS node behind the stream, so all streams
+ *	opened on the same device share buffers. The cache opens it's own stream
+ *	to each device, used for write-back after the caller's stream is closed.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_BCACHE_H_
+#define INCLUDE_BCACHE_H_
+
+#include "types.h"
+#include "devices.h"
+
+/** Memory used for buffer data, unless another budget is given to bcache_initialize() */
+#define BCACHE_DEFAULT_BUDGET		(512 * 1024)
+
+/** Number of hash buckets, must be a power of two */
+#define BCACHE_BUCKETS				256
+
+#define BCACHE_MAX_DEVICES			8
+
+/** Transfers of this many blocks or more bypass the cache */
+#define BCACHE_BYPASS_BLOCKS		32
+
+/** Period of the flusher thread, in milliseconds */
+#define BCACHE_FLUSH_INTERVAL		2000
+
+/** Flusher is woken early when this many buffers are dirty */
+#define BCACHE_DIRTY_THRESHOLD		64
+
+/* Buffer flags */
+#define BCACHE_BUF_VALID			0x01
+#define BCACHE_BUF_DIRTY			0x02
+
+/**
+ * Device known to the cache.
+ */
+typedef struct K_BCACHE_DEVICE K_BCACHE_DEVICE;
+struct K_BCACHE_DEVICE {
+	/** VFS node of the device, NULL for free slots */
+	void		*key;
+
+	/** Stream opened by the cache, used for all transfers */
+	K_STREAM	*io;
+	size_t		block_size;
+};
+
+/**
+ * Buffer head. Describes a single cached block.
+ */
+typedef struct K_BUFFER_HEAD K_BUFFER_HEAD;
+struct K_BUFFER_HEAD {
+	K_BCACHE_DEVICE	*dev;
+	uint32_t		block;
+
+	/** BCACHE_BUF_* */
+	uint32_t		flags;
+
+	/** Buffers with references are never recycled */
+	uint32_t		ref_count;
+
+	uint8_t			*data;
+	size_t			size;
+
+	/* Bucket chain */
+	K_BUFFER_HEAD	*hash_next;
+
+	/* LRU list, most recently used first */
+	K_BUFFER_HEAD	*lru_prev;
+	K_BUFFER_HEAD	*lru_next;
+};
+
+typedef struct {
+	uint32_t	hits;
+	uint32_t	misses;
+	uint32_t	bypassed;
+	uint32_t	evictions;
+	uint32_t	writebacks;
+	uint32_t	buffers;
+	uint32_t	dirty;
+	size_t		budget;
+} K_BCACHE_STATS;
+
+/**
+ * Initializes the cache and starts the flusher thread. `budget` is the number
+ * of bytes to use for buffer data (0 selects BCACHE_DEFAULT_BUDGET).
+ */
+HRESULT		__nxapi bcache_initialize(size_t budget);
+
+/**
+ * Retrieves a referenced buffer for `block` of the device behind `drv`, reading
+ * it from the device if it isn't cached. Release it with bcache_put().
+ */
+HRESULT		__nxapi bcache_get(K_STREAM *drv, uint32_t block, K_BUFFER_HEAD **out);
+
+/**
+ * Drops a reference taken by bcache_get().
+ */
+VOID		__nxapi bcache_put(K_BUFFER_HEAD *bh);
+
+/**
+ * Marks a referenced buffer as modified. It's written back by the flusher.
+ */
+VOID		__nxapi bcache_mark_dirty(K_BUFFER_HEAD *bh);
+
+/**
+ * Reads (writes) `count` blocks through the cache. With STORAGE_IO_BYPASS,
+ * or for BCACHE_BYPASS_BLOCKS blocks or more, data is transferred directly,
+ * but cached blocks are kept coherent.
+ */
+HRESULT		__nxapi bcache_read(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags);
+HRESULT		__nxapi bcache_write(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags);
+
+/**
+ * Writes back all dirty buffers.
+ */
+HRESULT		__nxapi bcache_sync();
+
+/**
+ * Writes back dirty buffers of the device behind `drv`.
+ */
+HRESULT		__nxapi bcache_fsync(K_STREAM *drv);
+
+/**
+ * Writes back and drops all buffers of the device behind `drv`. Must be called
+ * before a device is removed (or it's media changed).
+ */
+HRESULT		__nxapi bcache_invalidate(K_STREAM *drv);
+
+VOID		__nxapi bcache_get_stats(K_BCACHE_STATS *stats);
+
+/**
+ * Compares cold and repeated reads from storage devices and FAT files.
+ */
+HRESULT		__nxapi bcache_benchmark();
+
+#endif /* INCLUDE_BCACHE_H_ */
@@ -0,0 +1,243 @@
+/*
+ * blkq.h
+ *
+ *	Block I/O request queue.
+ *
+ *	Sits between storage drivers and their callers (devices.c, through the
+ *	driver's READ_BLOCKS/WRITE_BLOCKS ioctls). A transfer is described by one
+ *	or more K_BIO structures, each covering a range of sectors with a small
+ *	scatter-gather list. Bios are queued to the K_BLK_QUEUE of a device,
+ *	where they are merged into adjacent requests (at the back or the front)
+ *	and ordered by a pluggable scheduler. A thread per queue hands the
+ *	requests to the driver and completes the bios with their callbacks.
+ *
+ *	While a queue is plugged, requests are collected but not dispatched, so
+ *	a burst of bios has a chance to merge. Plugs expire after
+ *	BLKQ_UNPLUG_DELAY, in case the owner forgets to unplug.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_BLKQ_H_
+#define INCLUDE_BLKQ_H_
+
+#include "types.h"
+#include "kstream.h"
+#include "syncobjs.h"
+
+#define BIO_OP_READ					0x01
+#define BIO_OP_WRITE				0x02
+
+/** Segments of a single bio */
+#define BIO_MAX_SEGMENTS			4
+
+/** Segments of a request, which limits merging */
+#define BLKQ_MAX_SEGMENTS			32
+
+/** Requests per queue. Submitters sleep while all are in use. */
+#define BLKQ_MAX_REQUESTS			64
+
+/** Maximum number of queues, each served by a thread */
+#define BLKQ_MAX_QUEUES				8
+
+/** Plugged queues are dispatched after this many milliseconds anyway */
+#define BLKQ_UNPLUG_DELAY			10
+
+typedef struct K_BIO K_BIO;
+typedef struct K_BLK_REQUEST K_BLK_REQUEST;
+typedef struct K_BLK_QUEUE K_BLK_QUEUE;
+typedef struct K_BLK_SCHEDULER K_BLK_SCHEDULER;
+
+/**
+ * Called by the queue thread once the bio is finished. bio->status holds the
+ * result of the transfer.
+ */
+typedef VOID (*K_BIO_END_IO)(K_BIO *bio);
+
+/**
+ * Transfers a request on behalf of the queue thread. blkq_request_iov()
+ * collects it's segments.
+ */
+typedef HRESULT (*K_BLK_TRANSFER)(K_BLK_QUEUE *q, K_BLK_REQUEST *rq);
+
+struct K_BIO {
+	/** [in] BIO_OP_*, first sector and number of sectors */
+	uint32_t		op;
+	uint64_t		sector;
+	uint32_t		count;
+
+	/** [in] Data, segment lengths are multiples of the sector size */
+	K_IOVEC			segs[BIO_MAX_SEGMENTS];
+	uint32_t		seg_count;
+
+	/** [in] Completion callback and it's context */
+	K_BIO_END_IO	end_io;
+	void			*private;
+
+	/** [out] */
+	HRESULT			status;
+
+	/* Next bio of the same request */
+	K_BIO			*next;
+};
+
+/**
+ * Contiguous range of sectors, made of one or more merged bios.
+ */
+struct K_BLK_REQUEST {
+	uint32_t		op;
+	uint64_t		sector;
+	uint32_t		count;
+	uint32_t		seg_count;
+
+	K_BIO			*bio_head;
+	K_BIO			*bio_tail;
+
+	/** Tick count by which the request should be dispatched */
+	uint32_t		deadline;
+
+	/* Scheduler lists: sorted by sector and in arrival order */
+	K_BLK_REQUEST	*sort_prev;
+	K_BLK_REQUEST	*sort_next;
+	K_BLK_REQUEST	*fifo_prev;
+	K_BLK_REQUEST	*fifo_next;
+};
+
+/**
+ * I/O scheduler. All callbacks are called with the queue lock held.
+ */
+struct K_BLK_SCHEDULER {
+	const char		*name;
+
+	HRESULT			(*init)(K_BLK_QUEUE *q);
+	VOID			(*exit)(K_BLK_QUEUE *q);
+
+	/** Queues a new request */
+	VOID			(*add)(K_BLK_QUEUE *q, K_BLK_REQUEST *rq);
+
+	/** Finds a request `bio` can be merged into (see blkq_can_merge()) */
+	K_BLK_REQUEST	*(*find_merge)(K_BLK_QUEUE *q, K_BIO *bio, BOOL *front);
+
+	/** Called after a bio was merged into `rq` */
+	VOID			(*merged)(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, BOOL front);
+
+	/** Removes and returns the next request to serve */
+	K_BLK_REQUEST	*(*dispatch)(K_BLK_QUEUE *q);
+};
+
+typedef struct {
+	uint32_t	bios;
+	uint32_t	requests;
+	uint32_t	back_merges;
+	uint32_t	front_merges;
+	uint32_t	dispatched;
+	uint32_t	sectors;
+	uint32_t	plug_timeouts;
+} K_BLK_STATS;
+
+struct K_BLK_QUEUE {
+	K_MUTEX				lock;
+
+	/** Signaled when there is something to dispatch */
+	K_EVENT				event;
+
+	/** Signaled when a request is freed */
+	K_EVENT				rq_event;
+
+	/* Driver */
+	K_BLK_TRANSFER		transfer;
+	void				*context;
+	uint32_t			sector_size;
+	uint32_t			max_sectors;
+
+	/* Scheduler and it's private data */
+	const K_BLK_SCHEDULER	*sched;
+	void				*sched_data;
+
+	/* Requests held by the scheduler */
+	uint32_t			queued;
+
+	/* Plugging */
+	uint32_t			plug_count;
+	uint32_t			plug_time;
+
+	K_BLK_REQUEST		rq_pool[BLKQ_MAX_REQUESTS];
+	K_BLK_REQUEST		*rq_free;
+
+	K_BLK_STATS			stats;
+
+	/* Queue thread, which exits once the queue is dying and drained */
+	BOOL				has_thread;
+	BOOL				dying;
+};
+
+/** Deadline elevator, the default */
+extern const K_BLK_SCHEDULER blk_deadline_scheduler;
+
+/** Plain FIFO, only merges with the last request */
+extern const K_BLK_SCHEDULER blk_noop_scheduler;
+
+HRESULT		__nxapi blkq_initialize();
+
+/**
+ * Initializes a queue with the deadline scheduler and starts it's thread.
+ * Requests are at most `max_sectors` long.
+ */
+HRESULT		__nxapi blkq_create(K_BLK_QUEUE *q, K_BLK_TRANSFER transfer, void *context, uint32_t sector_size, uint32_t max_sectors);
+
+/**
+ * Drains the queue and stops it's thread.
+ */
+HRESULT		__nxapi blkq_destroy(K_BLK_QUEUE *q);
+
+/**
+ * Replaces the scheduler. Waits until the queue is drained.
+ */
+HRESULT		__nxapi blkq_set_scheduler(K_BLK_QUEUE *q, const K_BLK_SCHEDULER *sched);
+
+/**
+ * Queues a bio. It is completed through bio->end_io.
+ */
+HRESULT		__nxapi blkq_submit(K_BLK_QUEUE *q, K_BIO *bio);
+
+/**
+ * Holds back dispatching until the matching blkq_unplug(), so bios submitted
+ * in between can be merged.
+ */
+VOID		__nxapi blkq_plug(K_BLK_QUEUE *q);
+VOID		__nxapi blkq_unplug(K_BLK_QUEUE *q);
+
+/**
+ * Synchronous transfer of `count` sectors. It is split into bios of at most
+ * max_sectors, which are submitted plugged and waited for.
+ */
+HRESULT		__nxapi blkq_transfer(K_BLK_QUEUE *q, uint32_t op, uint64_t sector, uint32_t count, void *buffer);
+
+/**
+ * Returns TRUE if `bio` can be merged at the front or back of `rq`.
+ * Used by schedulers.
+ */
+BOOL		__nxapi blkq_can_merge(K_BLK_QUEUE *q, K_BLK_REQUEST *rq, K_BIO *bio, BOOL front);
+
+/**
+ * Collects the segments of a request into `iov`, which holds at least
+ * BLKQ_MAX_SEGMENTS entries. Returns the number of segments.
+ */
+uint32_t	__nxapi blkq_request_iov(K_BLK_REQUEST *rq, K_IOVEC *iov);
+
+VOID		__nxapi blkq_get_stats(K_BLK_QUEUE *q, K_BLK_STATS *stats);
+
+/**
+ * Checks merging and dispatch order of both schedulers, and the data moved,
+ * on a queue backed by a RAM disk.
+ */
+HRESULT		__nxapi blkq_selftest();
+
+/**
+ * Runs blkq_selftest(), then several threads doing sequential and random
+ * reads on the first IDE disk, with the deadline and noop schedulers.
+ */
+HRESULT		__nxapi blkq_benchmark();
+
+#endif /* INCLUDE_BLKQ_H_ */
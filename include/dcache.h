@@ -0,0 +1,122 @@
+/*
+ * dcache.h
+ *
+ *	Directory entry cache.
+ *
+ *	Remembers the result of looking up a name in a directory of a mounted
+ *	file system, so repeated path walks don't have to read and scan the
+ *	directory on the storage device again. Entries are keyed by the file
+ *	system instance (owner), an owner-defined id of the parent directory and
+ *	the component name. Names which were not found are cached as negative
+ *	entries.
+ *
+ *	The value of an entry is an opaque blob (typically the on-disk directory
+ *	entry). File systems must invalidate entries when they create, delete or
+ *	rename names, and all entries of an owner when it is unmounted.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_DCACHE_H_
+#define INCLUDE_DCACHE_H_
+
+#include "types.h"
+
+/** Number of hash buckets, must be a power of two */
+#define DCACHE_BUCKETS			256
+
+/** Entries are recycled in LRU order once this many are in use */
+#define DCACHE_MAX_ENTRIES		1024
+
+/** Longer names bypass the cache */
+#define DCACHE_MAX_NAME			64
+
+/** Largest value an entry can hold */
+#define DCACHE_MAX_VALUE		48
+
+typedef struct K_DENTRY K_DENTRY;
+struct K_DENTRY {
+	/** File system instance, NULL for free entries */
+	void		*owner;
+	uint64_t	parent;
+	uint32_t	hash;
+
+	/** Name was looked up, but does not exist */
+	BOOL		negative;
+
+	char		name[DCACHE_MAX_NAME];
+	uint8_t		value[DCACHE_MAX_VALUE];
+	uint32_t	value_size;
+
+	/* Bucket chain (free list for unused entries) */
+	K_DENTRY	*hash_next;
+
+	/* LRU list, most recently used first */
+	K_DENTRY	*lru_prev;
+	K_DENTRY	*lru_next;
+};
+
+typedef struct {
+	uint32_t	hits;
+	uint32_t	negative_hits;
+	uint32_t	misses;
+	uint32_t	evictions;
+	uint32_t	entries;
+} K_DCACHE_STATS;
+
+/**
+ * Hashes `len` characters of a name (FNV-1a).
+ */
+uint32_t	__nxapi dcache_hash_name(const char *name, size_t len);
+
+/**
+ * Initializes the cache. Must be called before any file system is mounted.
+ */
+HRESULT		__nxapi dcache_initialize();
+
+/**
+ * Looks up `name` in directory `parent` of `owner`. On a positive hit, the
+ * value is copied to `value` (up to `size` bytes) and S_OK is returned. A
+ * negative hit returns E_NOTFOUND and a miss returns S_FALSE.
+ */
+HRESULT		__nxapi dcache_lookup(void *owner, uint64_t parent, const char *name, void *value, size_t size);
+
+/**
+ * Caches the result of a lookup. Passing NULL `value` inserts a negative
+ * entry. An existing entry with the same key is replaced.
+ */
+HRESULT		__nxapi dcache_insert(void *owner, uint64_t parent, const char *name, const void *value, size_t size);
+
+/**
+ * Drops the entry for `name` in directory `parent`, if cached.
+ */
+VOID		__nxapi dcache_invalidate(void *owner, uint64_t parent, const char *name);
+
+/**
+ * Drops all entries of directory `parent`.
+ */
+VOID		__nxapi dcache_invalidate_dir(void *owner, uint64_t parent);
+
+/**
+ * Drops all entries of a file system instance. Called upon unmounting.
+ */
+VOID		__nxapi dcache_invalidate_owner(void *owner);
+
+/**
+ * Retrieves the hit/miss counters.
+ */
+VOID		__nxapi dcache_get_stats(K_DCACHE_STATS *stats);
+
+/**
+ * Resets the hit/miss counters.
+ */
+VOID		__nxapi dcache_reset_stats();
+
+/**
+ * Times deep path lookups on the VFS and on a FAT floppy (if present) and
+ * prints the cache hit rates.
+ */
+HRESULT		__nxapi dcache_benchmark();
+
+#endif /* INCLUDE_DCACHE_H_ */
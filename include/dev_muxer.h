@@ -3,6 +3,20 @@
  *
  *	Device Multiplexor
  *
+ *	Multiplexes up to DEV_MUXER_MAX_DEVICES virtual streams over a single
+ *	primary link. Every call on a virtual stream is sent as a CALL frame,
+ *	tagged with it's slot and a sequence number, and the peer (see
+ *	devmux_serve()) answers with a REPLY frame carrying the same tag.
+ *
+ *	A demultiplexer thread blocks on the receiving side of the link and hands
+ *	each reply directly to the waiting call, so a virtual stream can have up to
+ *	DEVMUX_MAX_INFLIGHT calls outstanding. The number of calls a virtual stream
+ *	may send ahead is limited by credits, which the peer returns with every
+ *	reply or grants explicitly with CREDIT frames.
+ *
+ *	ioctl() arguments are passed by value, since the peer is expected to share
+ *	the kernel address space.
+ *
  *  Created on: 13.04.2017 .
  *      Author: Anton Angelov
  */
@@ -16,24 +30,111 @@
 #define DEV_MUXER_MAX_DEVICES 	16
 #define DEV_MUXER_INVALID_SLOT	DEV_MUXER_MAX_DEVICES
 
-typedef enum {
-	DEVMUX_DIRECTION_INPUT,
-	DEVMUX_DIRECTION_OUTPUT,
-	DEVMUX_DIRECTION_BIDIRECTION,
-} K_DEVMUX_DIRECTION;
+/** Maximum number of muxers (each has it's own demultiplexer thread) */
+#define DEVMUX_MAX_MUXERS		4
+
+/** Outstanding calls per virtual stream */
+#define DEVMUX_MAX_INFLIGHT		4
+
+/** Credits a virtual stream starts with */
+#define DEVMUX_INITIAL_CREDITS	DEVMUX_MAX_INFLIGHT
+
+/** Largest payload of a single frame. Larger writes are split. */
+#define DEVMUX_MAX_PAYLOAD		4096
+
+#define DEVMUX_FRAME_MAGIC		0x584D
+
+/* Frame types */
+#define DEVMUX_FRAME_CALL		0x01
+#define DEVMUX_FRAME_REPLY		0x02
+#define DEVMUX_FRAME_CREDIT		0x03
+
+/* Forwarded operations */
+#define DEVMUX_CALL_READ		0x01
+#define DEVMUX_CALL_WRITE		0x02
+#define DEVMUX_CALL_TELL		0x03
+#define DEVMUX_CALL_SEEK		0x04
+#define DEVMUX_CALL_IOCTL		0x05
+
+/* States of a response slot */
+#define DEVMUX_SLOT_FREE		0x00
+#define DEVMUX_SLOT_PENDING		0x01
+#define DEVMUX_SLOT_FILLING		0x02
+#define DEVMUX_SLOT_DONE		0x03
+
+/**
+ * Header, which precedes every frame on the link.
+ */
+typedef struct K_DEVMUX_FRAME K_DEVMUX_FRAME;
+struct __attribute__((packed)) K_DEVMUX_FRAME {
+	uint16_t	magic;
+	uint8_t		type;
+	uint8_t		slot;
+	uint32_t	seq;
+
+	/** DEVMUX_CALL_* code (CALL frames) */
+	uint32_t	op;
+
+	/** Completion status (REPLY frames) */
+	uint32_t	status;
+
+	/** Call arguments (size; seek position and origin; ioctl code and argument) */
+	uint32_t	arg[3];
+
+	/** Result of tell()/seek() and bytes transferred (REPLY frames) */
+	uint32_t	result;
+	uint32_t	bytes;
+
+	/** Credits returned to the slot (REPLY and CREDIT frames) */
+	uint32_t	credits;
+
+	/** Number of payload bytes following the header */
+	uint32_t	payload_size;
+};
+
+/**
+ * Response slot of a call in flight.
+ */
+typedef struct K_DEVMUX_CALL K_DEVMUX_CALL;
+struct K_DEVMUX_CALL {
+	/** DEVMUX_SLOT_* */
+	uint32_t	state;
+	uint32_t	seq;
+
+	/** Where to place the payload of the reply */
+	void		*out_buf;
+	size_t		out_size;
+
+	/* Filled by the demultiplexer */
+	HRESULT		status;
+	uint32_t	result;
+	size_t		bytes;
+
+	/** Signaled when the reply arrives */
+	K_EVENT		done;
+};
 
 /**
  * Device descriptor
  */
 typedef struct K_DEV_DESC K_DEV_DESC;
 struct K_DEV_DESC {
-	uint32_t		ref_count;
 	BOOL			initialized;
 	K_STREAM		*stream;
-	K_MUTEX			lock;
-	K_EVENT			activation_ev;
-	K_EVENT			destruction_ev;
 	void			*muxer;
+
+	/** Calls executing on the virtual stream. It's freed when this drops to zero. */
+	uint32_t		ref_count;
+
+	/* Guards calls, credits and next_seq; taken by the demultiplexer too */
+	K_SPINLOCK		lock;
+
+	K_DEVMUX_CALL	calls[DEVMUX_MAX_INFLIGHT];
+	uint32_t		next_seq;
+	uint32_t		credits;
+
+	/** Signaled when a response slot is freed or credits are returned */
+	K_EVENT			ready_ev;
 };
 
 /**
@@ -41,13 +142,29 @@ struct K_DEV_DESC {
  */
 typedef struct K_DEV_MUXER K_DEV_MUXER;
 struct K_DEV_MUXER {
-	K_DEVMUX_DIRECTION	direction;
-	uint32_t		active_slot;
-	K_DEV_DESC		prim_device;
+	/* Primary link. Both may refer to the same stream. */
+	K_STREAM		*tx;
+	K_STREAM		*rx;
 	BOOL			prim_auto_close;
+
+	/* Readiness events of the link, NULL if the streams have none */
+	K_EVENT			*rx_ev;
+	K_EVENT			*tx_ev;
+
+	/** Serializes frames written to the link */
+	K_MUTEX			tx_lock;
+
 	K_DEV_DESC		sec_devices[DEV_MUXER_MAX_DEVICES];
 	uint32_t		sec_device_count;
 	K_MUTEX			sec_devices_lock;
+
+	/* Demultiplexer thread state */
+	BOOL			demux_claimed;
+	volatile BOOL	stopping;
+	K_EVENT			demux_done;
+
+	/** S_OK while the link is usable, otherwise the status calls fail with */
+	volatile HRESULT link_status;
 };
 
 /**
@@ -55,26 +172,32 @@ struct K_DEV_MUXER {
  */
 typedef struct K_DEV_STREAM K_DEV_STREAM;
 struct K_DEV_STREAM {
-	uint32_t	slot;
+	/* Must be first, since K_STREAM pointers are cast to K_DEV_STREAM */
 	K_STREAM	stream;
+	uint32_t	slot;
 	K_DEV_MUXER	*dm;
 };
 
+/**
+ * Initializes the table of muxers, served by demultiplexer threads.
+ */
+HRESULT		__nxapi devmux_initialize();
+
 /**
  * Creates new device multiplexer object using primary device from the virtual
- * file system, denoted by `primary_device`. For it's internal use, this
- * constructor opens a stream to the primary device and closes it upon it's
- * destruction.
+ * file system, denoted by `primary_device`, which is opened for both reading
+ * and writing. The stream is closed upon the muxer's destruction.
  */
-K_DEV_MUXER	__nxapi	*devmux_create(K_DEVMUX_DIRECTION dir, char	*primary_device);
+K_DEV_MUXER	__nxapi	*devmux_create(char	*primary_device);
 
 /**
- * Creates new device multiplexer object using opened stream.
+ * Creates new device multiplexer object using opened streams for the sending
+ * and receiving side of the link.
  */
-K_DEV_MUXER	__nxapi	*devmux_create2(K_DEVMUX_DIRECTION dir, K_STREAM *stream);
+K_DEV_MUXER	__nxapi	*devmux_create2(K_STREAM *tx, K_STREAM *rx);
 
 /**
- * Device multiplexer destructor.
+ * Device multiplexer destructor. Calls still in flight fail with E_TERMINATED.
  */
 VOID		__nxapi	devmux_destroy(K_DEV_MUXER *dm);
 
@@ -84,8 +207,7 @@ VOID		__nxapi	devmux_destroy(K_DEV_MUXER *dm);
 HRESULT		__nxapi devmux_add_device(K_DEV_MUXER *dm, int32_t slot_id, uint32_t *slot_id_out, K_STREAM **stream_out);
 
 /**
- * Removes a secondary device. In order this function to succeed, the device at that
- * particular slot must be inactive.
+ * Removes a secondary device. Calls still in flight fail with E_TERMINATED.
  */
 HRESULT		__nxapi devmux_remove_device(K_DEV_MUXER *dm, uint32_t slot_id);
 
@@ -95,12 +217,20 @@ HRESULT		__nxapi devmux_remove_device(K_DEV_MUXER *dm, uint32_t slot_id);
 HRESULT		__nxapi devmux_get_device_stream(K_DEV_MUXER *dm, uint32_t slot_id, K_STREAM **stream_out);
 
 /**
- * Switches the active secondary device to the one pointer by `slot`.
+ * Peer side of the protocol. Executes CALL frames read from `rx` on
+ * `targets[slot]` and writes REPLY frames to `tx`, until `stop` is set. A NULL
+ * target behaves as a null device: reads return zeroes and writes are discarded.
+ */
+HRESULT		__nxapi devmux_serve(K_STREAM *rx, K_STREAM *tx, K_STREAM **targets, volatile BOOL *stop);
+
+/**
+ * Wakes whoever waits for the link to become readable or writable, so
+ * devmux_serve() notices `stop` was set.
  */
-HRESULT		__nxapi devmux_switch_to(K_DEV_MUXER *dm, uint32_t slot);
+VOID		__nxapi devmux_wake(K_STREAM *rx, K_STREAM *tx);
 
 /**
- * Performs basic testing on the device multiplexer object.
+ * Measures call latency and write throughput over a pipe-backed link.
  */
 HRESULT		__nxapi devmux_test();
 
@@ -30,7 +30,9 @@ typedef enum {
 typedef enum {
 	DEVICE_SUBCLASS_NONE = 0,
 	DEVICE_SUBCLASS_FLOPPY,
-	DEVICE_SUBCLASS_MOUSE
+	DEVICE_SUBCLASS_MOUSE,
+	DEVICE_SUBCLASS_HARDDISK,
+	DEVICE_SUBCLASS_CDROM
 } K_DEVICE_SUBCLASS;
 
 /**
@@ -58,15 +60,32 @@ struct K_DEVICE {
 	uint32_t (*seek)(K_STREAM *str, int64_t pos, int8_t origin);
 	uint32_t (*tell)(K_STREAM *str);
 
+	/* Vectored and positional I/O are optional (see K_STREAM) */
+	HRESULT (*readv)(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+	HRESULT (*writev)(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+	HRESULT (*pread)(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
+	HRESULT (*pwrite)(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
+
+	/* Native asynchronous I/O is optional (see aio.h) */
+	HRESULT (*submit)(K_STREAM *str, K_IO_REQUEST *req);
+
 	HRESULT (*initialize)(K_DEVICE *self);
 	HRESULT (*finalize)(K_DEVICE *self);
 	HRESULT (*open)(K_STREAM *str);
 	HRESULT (*close)(K_STREAM *str);
 };
 
+/* Flags of storage_read_blocks_ex() and storage_write_blocks_ex() */
+#define STORAGE_IO_DEFAULT	0x00
+
+/* Transfer directly, without going through the buffer cache (see bcache.h) */
+#define STORAGE_IO_BYPASS	0x01
+
 /* Storage driver helper functions */
 HRESULT storage_read_blocks(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer);
 HRESULT storage_write_blocks(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer);
+HRESULT storage_read_blocks_ex(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags);
+HRESULT storage_write_blocks_ex(K_STREAM *drv, uint32_t start, uint32_t count, void *buffer, uint32_t flags);
 HRESULT storage_get_block_size(K_STREAM *drv, size_t *size);
 HRESULT storage_get_block_count(K_STREAM *drv, size_t *count);
 
@@ -15,11 +15,17 @@
 #define VIDEO_LOCK_WRITE	0x02
 
 /**
- * Pixel formats
+ * Pixel formats. Packed formats are named after their value, most
+ * significant channel first, so RGB24 is stored as B, G, R bytes and
+ * RGB565 has blue in it's low bits. RGB555 leaves the top bit unused.
  */
 typedef enum {
 	VIDEO_FORMAT_RGBA32,
-	VIDEO_FORMAT_BGRA32
+	VIDEO_FORMAT_BGRA32,
+	VIDEO_FORMAT_RGB24,
+	VIDEO_FORMAT_RGB565,
+	VIDEO_FORMAT_RGB555,
+	VIDEO_FORMAT_COUNT
 } K_VIDEO_FORMAT;
 
 /**
@@ -34,6 +40,35 @@ struct K_VIDEO_MODE_DESC {
 	K_VIDEO_FORMAT	format;
 };
 
+/**
+ * Rectangle of the frame buffer, x2 and y2 exclusive.
+ */
+typedef struct K_VIDEO_RECT K_VIDEO_RECT;
+struct K_VIDEO_RECT {
+	int32_t			x1;
+	int32_t			y1;
+	int32_t			x2;
+	int32_t			y2;
+};
+
+/**
+ * Parameters of K_VIDEO_DRIVER_IFACE->present().
+ */
+typedef struct K_VIDEO_PRESENT_DESC K_VIDEO_PRESENT_DESC;
+struct K_VIDEO_PRESENT_DESC {
+	/** Back buffer in system memory, with the same size as the video mode */
+	const void		*bits;
+	uint32_t		stride;
+	K_VIDEO_FORMAT	format;
+
+	/** Disjoint rectangles which changed since the last present */
+	const K_VIDEO_RECT *rects;
+	uint32_t		rect_count;
+
+	/** Out: bytes written to video memory */
+	uint32_t		bytes_written;
+};
+
 /**
  * Functions exported by a graphics driver.
  */
@@ -58,10 +93,12 @@ struct K_VIDEO_DRIVER_IFACE {
 	HRESULT __nxapi (*unlock_fb)(K_VIDEO_DRIVER_IFACE *this);
 
 	/**
-	 * Switches to next framebuffer inside the framebuffer chain, which makes
-	 * last modifications of the framebuffer visible.
+	 * Copies the changed rectangles of a back buffer to the framebuffer and
+	 * makes them visible, converting the pixel format if it differs. With
+	 * page flipping, the next framebuffer of the chain is shown. `sync`
+	 * waits for vertical retrace, where the adapter can tell it.
 	 */
-	HRESULT __nxapi (*present)(K_VIDEO_DRIVER_IFACE *this, BOOL sync);
+	HRESULT __nxapi (*present)(K_VIDEO_DRIVER_IFACE *this, K_VIDEO_PRESENT_DESC *desc, BOOL sync);
 };
 
 static inline uint32_t video_format_to_bpp(K_VIDEO_FORMAT fmt)
@@ -71,6 +108,13 @@ static inline uint32_t video_format_to_bpp(K_VIDEO_FORMAT fmt)
 		case VIDEO_FORMAT_RGBA32:
 			return 32;
 
+		case VIDEO_FORMAT_RGB24:
+			return 24;
+
+		case VIDEO_FORMAT_RGB565:
+		case VIDEO_FORMAT_RGB555:
+			return 16;
+
 		default:
 			return 0;
 	}
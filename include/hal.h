@@ -50,6 +50,10 @@ void __nxapi hal_sti();
 void __nxapi hal_flush_pagedir(void *page_dir);
 uint32_t __nxapi	hal_get_eflags(void);
 
+/* Enable SSE/AVX instructions. The scheduler doesn't save their state. */
+void __nxapi	hal_enable_sse(void);
+void __nxapi	hal_enable_avx(void);
+
 /* Enters userspace (ring3) */
 void __nxapi hal_enter_userspace(uintptr_t location, uintptr_t stack);
 
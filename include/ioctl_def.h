@@ -56,6 +56,10 @@
 #define IOCTL_STORAGE_GET_BLOCK_SIZE	(IOCTL_STORAGE + 0x02)
 //Returns capacity of device in blocks (use uint32_t for arg)
 #define IOCTL_STORAGE_GET_BLOCK_COUNT	(IOCTL_STORAGE + 0x03)
+//Returns the block request queue of the device (use K_BLK_QUEUE* for arg)
+#define IOCTL_STORAGE_GET_QUEUE			(IOCTL_STORAGE + 0x04)
+//Ejects the medium of removable drives (arg is unused)
+#define IOCTL_STORAGE_EJECT				(IOCTL_STORAGE + 0x05)
 
 /*
  * IOCTL codes for GRAPHICS drivers
@@ -72,6 +76,24 @@
 #define IOCTL_POINTING_SET_SENSITIVITY	(IOCTL_POINTING + 0x03)
 #define IOCTL_POINTING_GET_SENSITIVITY	(IOCTL_POINTING + 0x04)
 
+/*
+ * IOCTL codes for FILE streams, handled by file system drivers
+ */
+#define IOCTL_FILE						0x400
+//Returns the page cache inode of the file (arg is K_PAGECACHE_INODE**). The inode is valid while the stream is open.
+#define IOCTL_FILE_GET_PAGECACHE		(IOCTL_FILE + 0x01)
+//Sets the file size (arg is uint32_t*). Extended files are zero-filled.
+#define IOCTL_FILE_TRUNCATE				(IOCTL_FILE + 0x02)
+
+/*
+ * IOCTL codes for CHARACTER streams, like pipes, which refuse transfers they can't complete
+ */
+#define IOCTL_STREAM					0x480
+//Returns an event (arg is K_EVENT**), signaled whenever data arrives. The event is valid while the stream is open.
+#define IOCTL_STREAM_GET_READ_EVENT		(IOCTL_STREAM + 0x01)
+//Returns an event (arg is K_EVENT**), signaled whenever space is freed. The event is valid while the stream is open.
+#define IOCTL_STREAM_GET_WRITE_EVENT	(IOCTL_STREAM + 0x02)
+
 /**
  * Device-specific IOCTL calls should range from DEVIO_CUSTOM up
  */
@@ -33,5 +33,7 @@ HRESULT __cmd_play(char *cmd_line, char **args, uint32_t argc);
 HRESULT __cmd_cd(char *cmd_line, char **args, uint32_t argc);
 HRESULT __cmd_startwcs(char *cmd_line, char **args, uint32_t argc);
 HRESULT __cmd_scanpci(char *cmd_line, char **args, uint32_t argc);
+HRESULT __cmd_bench(char *cmd_line, char **args, uint32_t argc);
+HRESULT __cmd_sync(char *cmd_line, char **args, uint32_t argc);
 
 #endif /* INCLUDE_KCONSOLE_H_ */
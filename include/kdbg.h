@@ -15,6 +15,7 @@
 HRESULT __nxapi kdbg_init();
 HRESULT __nxapi kdbg_fini();
 void __nxapi dbg_print(char *string);
+void __nxapi dbg_write(const char *str, size_t len);
 void __nxapi dbg_printf(char *fmt, ...);
 void __nxapi dbg_break();
 
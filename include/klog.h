@@ -0,0 +1,73 @@
+/*
+ * klog.h
+ *
+ *	Kernel log ring.
+ *
+ *	Messages are formatted by the caller and appended to a per-CPU ring
+ *	without taking locks, so logging is cheap and safe from any context.
+ *	A kernel thread drains the rings to their targets (the debug port and
+ *	the VGA console). Until the thread is started, messages are written
+ *	out synchronously.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_KLOG_H_
+#define INCLUDE_KLOG_H_
+
+#include "types.h"
+#include <stdarg.h>
+
+/** Ring size per CPU, must be a power of two */
+#define KLOG_RING_SIZE			(16 * 1024)
+
+/** The kernel runs on a single CPU for now */
+#define KLOG_MAX_CPUS			1
+
+/** Longer messages are truncated */
+#define KLOG_MAX_RECORD			512
+
+/** Records drained before the thread yields */
+#define KLOG_DRAIN_BATCH		16
+
+#define KLOG_TARGET_DEBUG		0x01
+#define KLOG_TARGET_CONSOLE		0x02
+
+typedef struct {
+	uint8_t				data[KLOG_RING_SIZE];
+
+	/* Free-running byte counters; producers reserve at head, the drainer consumes at tail */
+	volatile uint32_t	head;
+	volatile uint32_t	tail;
+
+	/** Messages lost because the ring was full */
+	volatile uint32_t	dropped;
+} K_KLOG_RING;
+
+/**
+ * Starts the drainer thread. Must be called after the scheduler is running.
+ */
+HRESULT __nxapi klog_initialize();
+
+/**
+ * Formats a message and appends it to the log ring for _targets_ (KLOG_TARGET_*).
+ */
+void __nxapi vklog(uint32_t targets, const char *fmt, va_list args);
+
+/**
+ * Logs to both the debug port and the console.
+ */
+void __nxapi printk(const char *fmt, ...);
+
+/**
+ * Writes out all pending messages from the calling thread.
+ */
+void __nxapi klog_flush();
+
+/**
+ * Measures formatting and logging costs.
+ */
+HRESULT __nxapi klog_benchmark();
+
+#endif /* INCLUDE_KLOG_H_ */
@@ -21,13 +21,27 @@ uint32_t k_ftell(K_STREAM *str);
 uint32_t k_fseek(K_STREAM *str, int64_t pos, int8_t origin);
 HRESULT k_ioctl(K_STREAM *s, uint32_t code, void *arg);
 
+/* Vectored and positional I/O */
+HRESULT k_freadv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+HRESULT k_fwritev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+HRESULT k_fpread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
+HRESULT k_fpwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
+
 HRESULT k_opendir(char *dirname, K_DIR_STREAM **out);
 HRESULT k_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info);
 HRESULT k_rewinddir(K_DIR_STREAM *dirstr);
 HRESULT k_closedir(K_DIR_STREAM **dirstr);
 HRESULT k_mkdir(char *path, uint32_t mode);
+HRESULT k_unlink(char *path);
+HRESULT k_rename(char *old_path, char *new_path);
+HRESULT k_sync();
 
 void __nxapi k_print(char *str);
 void __nxapi k_printf(char *fmt, ...);
 
+/**
+ * Compares a loop of small writes against a single writev().
+ */
+HRESULT __nxapi kstream_benchmark();
+
 #endif /* INCLUDE_KSTDIO_H_ */
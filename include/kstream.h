@@ -36,6 +36,18 @@
 
 #define NODE_MODE_ALL_RWE	  0xFFFF
 
+/**
+ * Scatter-gather descriptor, used by readv() and writev().
+ */
+typedef struct K_IOVEC K_IOVEC;
+struct K_IOVEC {
+	void	*base;
+	size_t	len;
+};
+
+/* Asynchronous I/O request (see aio.h) */
+typedef struct K_IO_REQUEST K_IO_REQUEST;
+
 /**
  * NTX base stream. It's purpose is to be used by the kernel for different kind
  * of data streaming, like accessing files, devices, pipes and probably other resources.
@@ -97,6 +109,28 @@ struct K_STREAM {
 	 */
 	HRESULT (*close)(K_STREAM **str);
 
+	/**
+	 * Reads into (writes from) 'iov_cnt' buffers in sequence, starting at the position
+	 * marker, as a single operation. Optional - when NULL, k_freadv()/k_fwritev() fall
+	 * back to a loop of read()/write() calls under the stream lock.
+	 */
+	HRESULT (*readv)(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+	HRESULT (*writev)(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+
+	/**
+	 * Reads (writes) 'size' bytes at an explicit offset, without moving the position
+	 * marker. Optional - when NULL, k_fpread()/k_fpwrite() seek, transfer and restore
+	 * the position under the stream lock.
+	 */
+	HRESULT (*pread)(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
+	HRESULT (*pwrite)(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
+
+	/**
+	 * Queues an asynchronous request. Optional - streams without it, or returning
+	 * E_NOTSUPPORTED for the particular request, are served by aio worker threads.
+	 */
+	HRESULT (*submit)(K_STREAM *str, K_IO_REQUEST *req);
+
 	/**
 	 * Private data, which is attached by an implementation-specific stream
 	 * handler.
@@ -53,6 +53,18 @@
 
 #define USER_CODE_START		0x00100000
 
+/**
+ * Defines the windows in which shared memory objects and pages received
+ * through message ports are mapped (for user and kernel processes respectively).
+ */
+#define USER_IPC_START		0x40000000
+#define USER_IPC_END		0x80000000
+#define KERNEL_IPC_START	0xFC000000
+#define KERNEL_IPC_END		KERNEL_TEMP_START
+
+/** Maximum number of page fault handlers (see vmm_register_fault_handler()) */
+#define VMM_MAX_FAULT_HANDLERS	4
+
 typedef enum {
 	USAGE_RESERVED	= 	0x1,
 	USAGE_KERNEL	= 	0x2,
@@ -261,6 +273,50 @@ HRESULT __nxapi vmm_temp_map_region(void *proc_desc, uintptr_t phys_addr, uint32
  */
 HRESULT __nxapi vmm_get_region_phys_addr(void *proc_desc, uintptr_t virt_addr, uintptr_t *phys_addr);
 
+/**
+ * Finds a free, page-aligned virtual address range of _size_ bytes inside
+ * [start, limit) of given process' address space. Nothing is mapped.
+ */
+HRESULT __nxapi vmm_find_free_range(void *proc_desc, uintptr_t start, uintptr_t limit, size_t size, uintptr_t *virt_addr);
+
+/**
+ * Unmaps a region without freeing its physical memory, regardless of the
+ * AUTOFREE usage flag, and returns its descriptor. Used to transfer ownership
+ * of physical frames to another mapping.
+ */
+HRESULT __nxapi vmm_detach_region(void *proc_desc, uintptr_t virt_addr, K_VMM_REGION *out, int commit);
+
+/**
+ * Same as vmm_map_region(), but the region consists of _count_ pages, which
+ * don't have to be physically contiguous. _frames_ holds the physical address
+ * of each page. The region doesn't own the frames, so USAGE_AUTOFREE is refused.
+ */
+HRESULT __nxapi vmm_map_pages(void *proc_desc, const uintptr_t *frames, uint32_t count, uintptr_t virt_addr, K_VMM_REGION_USAGE usage, K_VMM_ACCESS_FLAG access, uint8_t commit);
+
+/**
+ * Replaces the frame behind a single page of a mapped region and changes its
+ * access. Used to break copy-on-write sharing.
+ */
+HRESULT __nxapi vmm_set_page(void *proc_desc, uintptr_t virt_addr, uintptr_t phys_addr, K_VMM_ACCESS_FLAG access, uint8_t commit);
+
+/**
+ * Translates any mapped virtual address to its physical address by walking the
+ * page tables. Unlike vmm_get_region_phys_addr(), _virt_addr_ doesn't have to
+ * be the start of a region. Used to build scatter-gather lists for bus-master DMA.
+ */
+HRESULT __nxapi vmm_virt_to_phys(void *proc_desc, uintptr_t virt_addr, uintptr_t *phys_addr);
+
+/**
+ * Page fault handler. Returns S_OK if the fault at _addr_ is resolved and the
+ * faulting instruction can be restarted; _err_code_ is the one pushed by the CPU.
+ */
+typedef HRESULT (*K_VMM_FAULT_HANDLER)(uintptr_t addr, uint32_t err_code);
+
+/**
+ * Registers a handler, which is consulted on page faults before the kernel panics.
+ */
+HRESULT __nxapi vmm_register_fault_handler(K_VMM_FAULT_HANDLER handler);
+
 void vmm_selftest();
 
 #endif /* MM_VIRT_H_ */
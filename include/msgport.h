@@ -0,0 +1,148 @@
+/*
+ * msgport.h
+ *
+ *	Synchronous port-based message passing.
+ *
+ *	A sender blocks until a receiver has taken its message. Messages up to
+ *	PORT_INLINE_MAX bytes are copied through the kernel. Larger messages must
+ *	reside in a buffer obtained by port_alloc_buffer(): the pages of that
+ *	buffer are unmapped from the sender and mapped into the receiver, so the
+ *	payload is never copied and ownership of the frames moves with it.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_MSGPORT_H_
+#define INCLUDE_MSGPORT_H_
+
+#include "types.h"
+#include "syncobjs.h"
+
+#define PORT_MAX_PORTS			32
+#define PORT_MAX_NAME_LENGTH	32
+
+/** Messages up to this size are copied, larger ones transfer pages */
+#define PORT_INLINE_MAX			512
+
+#define MSG_FLAG_INLINE			0x01
+#define MSG_FLAG_PAGES			0x02
+
+/* Sub-routine IDs of SYSCALL_ID_PORT (passed in EBX) */
+#define PORT_SYSCALL_CREATE		0x00
+#define PORT_SYSCALL_OPEN		0x01
+#define PORT_SYSCALL_CLOSE		0x02
+#define PORT_SYSCALL_SEND		0x03
+#define PORT_SYSCALL_RECEIVE	0x04
+#define PORT_SYSCALL_ALLOC		0x05
+#define PORT_SYSCALL_FREE		0x06
+
+/**
+ * In-flight message. It lives on the sender's kernel stack, since
+ * the sender is blocked until the message is delivered.
+ */
+typedef struct K_MESSAGE K_MESSAGE;
+struct K_MESSAGE {
+	uint32_t	sender_pid;
+	uint32_t	flags;
+	size_t		size;
+
+	/** Kernel copy of an inline payload */
+	void		*data;
+
+	/** Frames of a page-transfer payload */
+	uintptr_t	phys_addr;
+	size_t		region_size;
+
+	/** Signaled by the receiver when the message is taken */
+	K_EVENT		delivered;
+
+	K_MESSAGE	*next;
+};
+
+typedef struct K_MSG_PORT K_MSG_PORT;
+struct K_MSG_PORT {
+	char		name[PORT_MAX_NAME_LENGTH];
+	uint32_t	ref_count;
+
+	/* FIFO of pending messages */
+	K_MESSAGE	*head;
+	K_MESSAGE	*tail;
+	uint32_t	queue_len;
+
+	/** Signaled while the queue is not empty */
+	K_EVENT		msg_event;
+	K_SPINLOCK	lock;
+};
+
+/**
+ * Describes a received message.
+ */
+typedef struct K_PORT_RECV K_PORT_RECV;
+struct K_PORT_RECV {
+	/** [in] Buffer for inline payloads and it's size */
+	void		*buffer;
+	size_t		buffer_size;
+
+	/** [out] Payload size, flags and pid of the sender */
+	size_t		size;
+	uint32_t	flags;
+	uint32_t	sender_pid;
+
+	/**
+	 * [out] For MSG_FLAG_PAGES messages, the address at which payload was
+	 * mapped. The receiver owns it and releases it with port_free_buffer().
+	 */
+	void		*pages;
+};
+
+/**
+ * Argument block for the message port syscall. Fields not used
+ * by the particular sub-routine are ignored.
+ */
+typedef struct PORT_SYSCALL_ARGS PORT_SYSCALL_ARGS;
+struct PORT_SYSCALL_ARGS {
+	char		*name;
+	K_MSG_PORT	*handle;
+	void		*buffer;
+	size_t		size;
+	uint32_t	timeout;
+	K_PORT_RECV	recv;
+};
+
+HRESULT __nxapi port_initialize();
+
+HRESULT __nxapi port_create(char *name, K_MSG_PORT **out);
+HRESULT __nxapi port_open(char *name, K_MSG_PORT **out);
+HRESULT __nxapi port_close(K_MSG_PORT **port);
+
+/**
+ * Sends a message and waits until it is received.
+ *
+ * When _size_ exceeds PORT_INLINE_MAX, _buffer_ must be the address returned by
+ * port_alloc_buffer() (or a received r->pages); any other buffer is refused
+ * with E_INVALIDARG. On success the buffer no longer belongs to the caller.
+ * On E_TIMEDOUT the message is withdrawn and the buffer is remapped at its
+ * original address.
+ */
+HRESULT __nxapi port_send(K_MSG_PORT *port, void *buffer, size_t size, uint32_t timeout);
+
+/**
+ * Waits for a message. Returns E_BUFFEROVERFLOW (leaving the message queued)
+ * if an inline payload doesn't fit in r->buffer.
+ */
+HRESULT __nxapi port_receive(K_MSG_PORT *port, K_PORT_RECV *r, uint32_t timeout);
+
+/**
+ * Allocates page-aligned memory inside the IPC window of current
+ * process, suitable for zero-copy sending.
+ */
+HRESULT __nxapi port_alloc_buffer(size_t size, void **out);
+HRESULT __nxapi port_free_buffer(void *buffer);
+
+/**
+ * Compares port and pipe throughput for payloads from 64 bytes to 1 MiB.
+ */
+HRESULT __nxapi ipc_benchmark();
+
+#endif /* INCLUDE_MSGPORT_H_ */
@@ -0,0 +1,261 @@
+/*
+ * pagecache.h
+ *
+ *	Page cache.
+ *
+ *	File content is cached in 4 KiB pages, indexed per inode by a radix tree.
+ *	An inode is identified by it's owner (usually the FS driver) and an id
+ *	unique within the owner, so all streams opened on the same file share the
+ *	cached pages. Missing pages are read with the fill callback of the inode.
+ *
+ *	Pages are taken from a physically contiguous pool, which is mapped once in
+ *	the kernel IPC window. This lets pagecache_map() map cached pages directly
+ *	into a process: shared mappings are read-only, private mappings are
+ *	copy-on-write. Pages are recycled in LRU order, unless they are mapped.
+ *
+ *	Runs of missing pages are read with a single fill call, so the file system
+ *	can issue multi-sector requests. Streams which keep a K_READAHEAD detect
+ *	sequential access and have pages ahead of the position read by a worker
+ *	thread, in a window which doubles up to PAGECACHE_RA_MAX and shrinks again
+ *	on random access.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_PAGECACHE_H_
+#define INCLUDE_PAGECACHE_H_
+
+#include "types.h"
+#include "kstream.h"
+#include "aio.h"
+
+#define PAGECACHE_PAGE_SIZE			4096
+#define PAGECACHE_PAGE_SHIFT		12
+
+/** Size of the page pool */
+#define PAGECACHE_POOL_PAGES		512
+
+#define PAGECACHE_MAX_INODES		64
+#define PAGECACHE_MAX_MAPPINGS		32
+
+/* Radix tree fan-out, 6 bits of the page index per level */
+#define PAGECACHE_RADIX_SHIFT		6
+#define PAGECACHE_RADIX_SLOTS		(1 << PAGECACHE_RADIX_SHIFT)
+
+/* Read-ahead window bounds. The maximum is also the largest single fill. */
+#define PAGECACHE_RA_MIN			(16 * 1024)
+#define PAGECACHE_RA_MAX			(128 * 1024)
+
+/* Mapping flags */
+#define PAGECACHE_MAP_SHARED		0x01
+#define PAGECACHE_MAP_PRIVATE		0x02
+
+/**
+ * Reads up to `size` bytes of file content at `offset` into `dst`.
+ */
+typedef HRESULT (*K_PAGECACHE_FILL)(K_STREAM *s, uint64_t offset, size_t size, void *dst, size_t *bytes_read);
+
+typedef struct K_PAGECACHE_INODE K_PAGECACHE_INODE;
+
+/**
+ * Cached page.
+ */
+typedef struct K_PAGE K_PAGE;
+struct K_PAGE {
+	/** Owning inode, NULL for free pages */
+	K_PAGECACHE_INODE	*inode;
+	uint32_t			index;
+
+	/** Pages with references (mappings) are never recycled */
+	uint32_t			ref_count;
+
+	/** Kernel address of the page content */
+	uint8_t				*data;
+	uintptr_t			phys;
+
+	/* LRU list, most recently used first (or free list) */
+	K_PAGE				*lru_prev;
+	K_PAGE				*lru_next;
+};
+
+/**
+ * Radix tree node. Leaf slots point to K_PAGE.
+ */
+typedef struct K_PAGECACHE_RADIX K_PAGECACHE_RADIX;
+struct K_PAGECACHE_RADIX {
+	void		*slots[PAGECACHE_RADIX_SLOTS];
+	uint32_t	count;
+};
+
+struct K_PAGECACHE_INODE {
+	/** NULL for free inode slots */
+	void				*owner;
+	uint64_t			id;
+
+	/** File size in bytes */
+	uint64_t			size;
+	K_PAGECACHE_FILL	fill;
+
+	/** Open streams and mappings. Cached pages are kept after it drops to zero. */
+	uint32_t			ref_count;
+
+	K_PAGECACHE_RADIX	*root;
+
+	/** Height of the tree, each level adds PAGECACHE_RADIX_SHIFT bits */
+	uint32_t			height;
+	uint32_t			page_count;
+};
+
+/**
+ * File region mapped into a process.
+ */
+typedef struct K_PAGECACHE_MAPPING K_PAGECACHE_MAPPING;
+struct K_PAGECACHE_MAPPING {
+	/** NULL for free slots */
+	void				*proc;
+	uintptr_t			virt_addr;
+
+	K_PAGECACHE_INODE	*inode;
+	uint32_t			count;
+	uint32_t			flags;
+
+	/** Referenced cache pages, NULL if the mapping holds an eager private copy */
+	K_PAGE				**pages;
+
+	/** Private copies of pages, made on write faults (0 while still shared) */
+	uintptr_t			*copies;
+
+	/** Physical base of an eager private copy, see pagecache_map() */
+	uintptr_t			copy_phys;
+};
+
+/**
+ * Per-stream read-ahead state.
+ */
+typedef struct K_READAHEAD K_READAHEAD;
+struct K_READAHEAD {
+	K_PAGECACHE_INODE	*inode;
+
+	/** Offset the next read starts at, if access is sequential */
+	uint64_t			next;
+
+	/** Current window, 0 while access looks random */
+	size_t				window;
+
+	/** End of the range already read ahead */
+	uint64_t			ahead_end;
+
+	/** Asynchronous read-ahead, at most one per stream */
+	K_IO_REQUEST		req;
+};
+
+typedef struct {
+	uint32_t	hits;
+	uint32_t	misses;
+	uint32_t	readahead;
+	uint32_t	fills;
+	uint32_t	evictions;
+	uint32_t	cow_faults;
+	uint32_t	pages;
+	uint32_t	mapped;
+	uint32_t	inodes;
+} K_PAGECACHE_STATS;
+
+/**
+ * Allocates the page pool and installs the copy-on-write fault handler.
+ */
+HRESULT		__nxapi pagecache_initialize();
+
+/**
+ * Retrieves a referenced inode for (`owner`, `id`), creating it if it isn't
+ * known yet. If the cached size differs from `size`, cached pages are dropped.
+ * Release it with pagecache_close_inode().
+ */
+HRESULT		__nxapi pagecache_open_inode(void *owner, uint64_t id, uint64_t size, K_PAGECACHE_FILL fill, K_PAGECACHE_INODE **out);
+
+/**
+ * Drops a reference taken by pagecache_open_inode().
+ */
+VOID		__nxapi pagecache_close_inode(K_PAGECACHE_INODE *inode);
+
+/**
+ * Reads up to `size` bytes at `offset` through the cache. `s` is passed to the
+ * fill callback of the inode. Returns E_ENDOFSTR at end of file.
+ */
+HRESULT		__nxapi pagecache_read(K_PAGECACHE_INODE *inode, K_STREAM *s, uint64_t offset, size_t size, void *buffer, size_t *bytes_read);
+
+/**
+ * Same as pagecache_read(), but updates the read-ahead state of the stream and
+ * starts an asynchronous read-ahead when access is sequential. The caller must
+ * hold the stream lock, which the read-ahead takes too.
+ */
+HRESULT		__nxapi pagecache_read_ra(K_READAHEAD *ra, K_STREAM *s, uint64_t offset, size_t size, void *buffer, size_t *bytes_read);
+
+/**
+ * Prepares read-ahead state for a stream of `inode`.
+ */
+VOID		__nxapi pagecache_ra_init(K_READAHEAD *ra, K_PAGECACHE_INODE *inode);
+
+/**
+ * Cancels or waits for a read-ahead in flight. Must be called before the
+ * stream is closed, without holding the stream lock.
+ */
+VOID		__nxapi pagecache_ra_cancel(K_READAHEAD *ra);
+
+/**
+ * Turns read-ahead on or off for all streams. It is on by default.
+ */
+VOID		__nxapi pagecache_set_readahead(BOOL enable);
+
+/**
+ * Copies data written to the file into cached pages and extends the size.
+ * Used by file systems, which write the file content elsewhere.
+ */
+VOID		__nxapi pagecache_update(K_PAGECACHE_INODE *inode, uint64_t offset, size_t size, const void *buffer);
+
+/**
+ * Sets the size of the file. Pages past the new end are dropped (unless they
+ * are mapped) and the tail of the last page is zeroed.
+ */
+VOID		__nxapi pagecache_truncate(K_PAGECACHE_INODE *inode, uint64_t size);
+
+/**
+ * Maps `size` bytes at page aligned `offset` into process `proc` (NULL for the
+ * kernel process). PAGECACHE_MAP_SHARED maps cached pages read-only.
+ * PAGECACHE_MAP_PRIVATE maps them copy-on-write for user processes; kernel
+ * processes get a private copy right away, since the CPU doesn't protect
+ * read-only pages from supervisor writes.
+ */
+HRESULT		__nxapi pagecache_map(K_PAGECACHE_INODE *inode, K_STREAM *s, void *proc, uint64_t offset, size_t size, uint32_t flags, void **out);
+
+/**
+ * Unmaps a mapping created by pagecache_map().
+ */
+HRESULT		__nxapi pagecache_unmap(void *proc, void *addr);
+
+/**
+ * Drops all cached pages of inodes of `owner`. Called when a file system is
+ * unmounted. Mapped pages are kept until unmapped.
+ */
+VOID		__nxapi pagecache_invalidate_owner(void *owner);
+
+/**
+ * Drops the cached pages of a single inode, e.g. when the file is deleted or
+ * renamed and it's id no longer refers to it.
+ */
+VOID		__nxapi pagecache_invalidate(void *owner, uint64_t id);
+
+VOID		__nxapi pagecache_get_stats(K_PAGECACHE_STATS *stats);
+
+/**
+ * Compares repeated reads and mmap() of a file with copying it into a buffer.
+ */
+HRESULT		__nxapi pagecache_benchmark();
+
+/**
+ * Sequential read throughput of a FAT file with read-ahead on and off.
+ */
+HRESULT		__nxapi pagecache_ra_benchmark();
+
+#endif /* INCLUDE_PAGECACHE_H_ */
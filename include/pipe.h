@@ -35,6 +35,10 @@ struct PIPE_DESC {
 	 */
 	K_MUTEX		lock;
 
+	/* Signaled by writes and reads, so peers can wait instead of retrying */
+	K_EVENT		data_ev;
+	K_EVENT		space_ev;
+
 	uint32_t	flags;
 };
 
@@ -0,0 +1,107 @@
+/*
+ * shm.h
+ *
+ *	Named shared memory objects.
+ *
+ *	An object owns a physically contiguous set of page frames, which can be
+ *	mapped into any number of address spaces. Every open handle and every
+ *	mapping holds a reference to the object; the frames are returned to the
+ *	physical memory manager when the last reference is dropped.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef INCLUDE_SHM_H_
+#define INCLUDE_SHM_H_
+
+#include "types.h"
+#include "mm_virt.h"
+#include "syncobjs.h"
+
+#define SHM_MAX_OBJECTS			32
+#define SHM_MAX_MAPPINGS		16
+#define SHM_MAX_NAME_LENGTH		32
+
+#define SHM_FLAG_NONE			0x00
+
+/* Sub-routine IDs of SYSCALL_ID_SHM (passed in EBX) */
+#define SHM_SYSCALL_CREATE		0x00
+#define SHM_SYSCALL_OPEN		0x01
+#define SHM_SYSCALL_CLOSE		0x02
+#define SHM_SYSCALL_MAP			0x03
+#define SHM_SYSCALL_UNMAP		0x04
+
+typedef struct K_SHM_MAPPING K_SHM_MAPPING;
+struct K_SHM_MAPPING {
+	/** Process in which the object is mapped */
+	void		*proc;
+
+	/** Starting virtual address of the mapping */
+	uintptr_t	virt_addr;
+};
+
+typedef struct K_SHM_OBJECT K_SHM_OBJECT;
+struct K_SHM_OBJECT {
+	char			name[SHM_MAX_NAME_LENGTH];
+
+	/** Physical address and size (multiple of page size) of the frames */
+	uintptr_t		phys_addr;
+	size_t			size;
+
+	/** Number of open handles plus number of mappings */
+	uint32_t		ref_count;
+	uint32_t		flags;
+
+	K_SHM_MAPPING	mappings[SHM_MAX_MAPPINGS];
+	uint32_t		mapping_count;
+};
+
+/**
+ * Argument block for the shared memory syscall. Fields not used
+ * by the particular sub-routine are ignored.
+ */
+typedef struct SHM_SYSCALL_ARGS SHM_SYSCALL_ARGS;
+struct SHM_SYSCALL_ARGS {
+	char			*name;
+	size_t			size;
+	uint32_t		access;
+	K_SHM_OBJECT	*handle;
+	void			*address;
+};
+
+HRESULT __nxapi shm_initialize();
+
+/**
+ * Creates a new named object of at least _size_ bytes (rounded up to page size)
+ * and returns a handle to it. Fails if the name is already taken.
+ */
+HRESULT __nxapi shm_create(char *name, size_t size, uint32_t flags, K_SHM_OBJECT **out);
+
+/**
+ * Opens an existing object by name.
+ */
+HRESULT __nxapi shm_open(char *name, K_SHM_OBJECT **out);
+
+/**
+ * Releases a handle. Mappings stay valid until they are unmapped.
+ */
+HRESULT __nxapi shm_close(K_SHM_OBJECT **obj);
+
+/**
+ * Maps the object into the IPC window of process _proc_desc_ (NULL means
+ * the kernel process) and returns the virtual address of the mapping.
+ */
+HRESULT __nxapi shm_map(K_SHM_OBJECT *obj, void *proc_desc, K_VMM_ACCESS_FLAG access, void **out);
+
+/**
+ * Unmaps a mapping, created by shm_map().
+ */
+HRESULT __nxapi shm_unmap(void *proc_desc, void *addr);
+
+/**
+ * Finds a free address inside the IPC window of given process.
+ */
+HRESULT __nxapi shm_find_map_address(void *proc_desc, size_t size, uintptr_t *out);
+
+#endif /* INCLUDE_SHM_H_ */
@@ -9,9 +9,16 @@
 #define INCLUDE_STDLIB_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 int abs(int n);
 
+/*
+ * 64 by 32-bit unsigned division, without libgcc. The remainder is
+ * stored in `rem` unless it's NULL.
+ */
+uint64_t udiv64(uint64_t n, uint32_t d, uint32_t *rem);
+
 /*
  * Memory management.
  */
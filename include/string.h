@@ -16,9 +16,21 @@
 void* __nxapi memcpy (void *dst, const void *src, size_t count);
 void* __nxapi memmove (void *dst, const void *src, size_t count);
 void* __nxapi memset (void *dst, int c, size_t size);
+int	__nxapi memcmp(const void *ptr1, const void *ptr2, size_t num);
+
+/**
+ * Receives formatted output in pieces. _str_ is not null-terminated.
+ */
+typedef void (*K_PRINTF_SINK)(void *ctx, const char *str, size_t len);
 
 int __nxapi vsprintf(PCHAR target, PCHAR fmt, va_list args);
 int __nxapi sprintf(PCHAR target, PCHAR fmt, ...);
+int __nxapi vsnprintf(PCHAR target, size_t size, const char *fmt, va_list args);
+int __nxapi snprintf(PCHAR target, size_t size, const char *fmt, ...);
+
+/* Formats straight into a sink, without an intermediate buffer */
+int __nxapi vcbprintf(K_PRINTF_SINK sink, void *ctx, const char *fmt, va_list args);
+int __nxapi cbprintf(K_PRINTF_SINK sink, void *ctx, const char *fmt, ...);
 
 size_t __nxapi strlen(const char *str);
 int32_t __nxapi strcmp(const char *s1, const char *s2);
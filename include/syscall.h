@@ -13,6 +13,8 @@
 #define SYSCALL_ID_FOPEN	0x02
 #define SYSCALL_ID_FCLOSE	0x03
 #define SYSCALL_ID_MUTEX	0x04
+#define SYSCALL_ID_SHM		0x06
+#define SYSCALL_ID_PORT		0x07
 
 HRESULT syscall_init();
 
@@ -34,6 +36,27 @@ void __nxapi sys_test(K_REGISTERS *regs);
  */
 void __nxapi sys_mutex(K_REGISTERS *regs);
 
+/**
+ * Shared memory syscall. Sub-routines are denoted by EBX (SHM_SYSCALL_*
+ * constants in shm.h): create, open, close, map and unmap.
+ *
+ * @param regs->ebx ID of the subroutine.
+ * @param regs->edx Pointer to SHM_SYSCALL_ARGS structure. Output handles and
+ * 					addresses are written back to it.
+ * @return Returns HRESULT of the subroutine in regs->eax.
+ */
+void __nxapi sys_shm(K_REGISTERS *regs);
+
+/**
+ * Message port syscall. Sub-routines are denoted by EBX (PORT_SYSCALL_*
+ * constants in msgport.h): create, open, close, send, receive, alloc and free.
+ *
+ * @param regs->ebx ID of the subroutine.
+ * @param regs->edx Pointer to PORT_SYSCALL_ARGS structure.
+ * @return Returns HRESULT of the subroutine in regs->eax.
+ */
+void __nxapi sys_port(K_REGISTERS *regs);
+
 /**
  * Opens a FILE stream.
  *
@@ -13,11 +13,16 @@
 #include "devices.h"
 #include "kstream.h"
 #include "syncobjs.h"
+#include "pagecache.h"
 
 #define VFS_PATH_DELIMITER		(PATH_DELIMITER)
 #define VFS_MAX_FILENAME_LENGTH	(MAX_FILENAME_LENGTH)
 #define VFS_MAX_DIRNAME_LENGTH	(MAX_DIRNAME_LENGTH)
 
+/* vfs_mmap() flags */
+#define VFS_MMAP_SHARED			(PAGECACHE_MAP_SHARED)
+#define VFS_MMAP_PRIVATE		(PAGECACHE_MAP_PRIVATE)
+
 /**
  * @brief ANTONIX Virtual File System.
  *
@@ -53,6 +58,15 @@ struct K_FS_DRIVER {
 	/** Create new directory */
 	HRESULT (*mkdir)(K_FS_DRIVER *self, char *path, uint32_t mode);
 
+	/** Removes a file or an empty directory (NULL if not supported) */
+	HRESULT (*unlink)(K_FS_DRIVER *self, char *path);
+
+	/** Renames or moves a file or directory within the file system (NULL if not supported) */
+	HRESULT (*rename)(K_FS_DRIVER *self, char *old_path, char *new_path);
+
+	/** Writes cached metadata back to the storage device (optional) */
+	HRESULT (*sync)(K_FS_DRIVER *self);
+
 	/** File system destructor (called when unmounting) */
 	HRESULT (*finalize)(K_FS_DRIVER *self);
 
@@ -99,12 +113,25 @@ struct K_VFS_NODE {
 	int32_t		child_cnt;
 	int32_t		child_capacity;
 
+	/* Hash table of children, chained through hash_next. Allocated with
+	 * the first child and doubled when the load exceeds one.
+	 */
+	K_VFS_NODE	**child_hash;
+	uint32_t	child_hash_size;
+
+	/* Hash of desc.name (see dcache_hash_name()) */
+	uint32_t	name_hash;
+	K_VFS_NODE	*hash_next;
+
 	/* Content (for files only). For devices, this field holds
 	 * pointer to K_DEVICE struct
 	 */
 	void *content;
 	uint32_t content_capacity;
 
+	/* Page cache inode (files only), created on the first vfs_mmap() */
+	K_PAGECACHE_INODE *page_cache;
+
 	/* Number of references. When a node is being opened, it increases the reference
 	 * counter. And of course, ref. counter is decremented on close.
 	 */
@@ -139,6 +166,13 @@ HRESULT vfs_opendir(K_FS_DRIVER *self, char *dirname, K_DIR_STREAM **out);
 HRESULT vfs_mkdir(K_FS_DRIVER *self, char *path, uint32_t mode);
 HRESULT vfs_create(K_FS_DRIVER *self, char *filename, uint32_t perm);
 HRESULT vfs_open(K_FS_DRIVER *self, char *filename, uint32_t flags, K_STREAM **out);
+HRESULT vfs_unlink(K_FS_DRIVER *self, char *path);
+HRESULT vfs_rename(K_FS_DRIVER *self, char *old_path, char *new_path);
+
+/**
+ * Syncs all mounted file systems, then writes back the buffer cache.
+ */
+HRESULT vfs_sync(K_FS_DRIVER *self);
 
 /* Directory stream routines */
 HRESULT vfs_readdir(K_DIR_STREAM *dirstr, char *filename, K_FS_NODE_INFO *info);
@@ -151,8 +185,27 @@ HRESULT vfs_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, si
 HRESULT vfs_file_ioctl(K_STREAM *s, uint32_t code, void *arg);
 uint32_t vfs_file_seek(K_STREAM *s, int64_t pos, int8_t origin);
 uint32_t vfs_file_tell(K_STREAM *s);
+HRESULT vfs_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read);
+HRESULT vfs_file_writev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written);
+HRESULT vfs_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read);
+HRESULT vfs_file_pwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written);
 HRESULT vfs_close(K_STREAM **str);
 
+/**
+ * Maps `size` bytes of an opened file, starting at page aligned `offset`, into
+ * the address space of `proc` (NULL for the kernel process). The stream must
+ * be readable and it's file system must support IOCTL_FILE_GET_PAGECACHE.
+ *
+ * VFS_MMAP_SHARED maps the cached pages read-only. VFS_MMAP_PRIVATE gives a
+ * writable, copy-on-write view, changes to which never reach the file.
+ */
+HRESULT vfs_mmap(K_STREAM *s, uint64_t offset, size_t size, uint32_t flags, void *proc, void **out);
+
+/**
+ * Unmaps a mapping created by vfs_mmap(). The stream may be closed already.
+ */
+HRESULT vfs_munmap(void *proc, void *addr);
+
 /**
  * Mounts a device onto the VFS.
  */
@@ -67,6 +67,7 @@ void __nxapi vga_init_terminal();
 void __nxapi vga_scroll_vert();
 void __nxapi vga_set_color(vga_color fg, vga_color bg);
 void __nxapi vga_print(char *str);
+void __nxapi vga_write(const char *str, size_t len);
 void __nxapi vga_printf(char *fmt, ...);
 void __nxapi vga_clear();
 
@@ -23,9 +23,29 @@
 #include <scheduler.h>
 #include <vfs.h>
 #include <url_utils.h>
+#include <msgport.h>
+#include <aio.h>
+#include <dev_muxer.h>
+#include <klog.h>
+#include <dcache.h>
+#include <bcache.h>
+#include <pagecache.h>
+#include <blkq.h>
+#include <dirindex.h>
 #include "drivers/pci_bus.h"
+#include "drivers/fat16.h"
+#include "drivers/ata.h"
 #include "subsystems/nxa.h"
 #include "subsystems/nxgi.h"
+#include "subsystems/nxgi_span.h"
+#include "subsystems/nxgi_scale.h"
+#include "subsystems/nxgi_blend.h"
+#include "subsystems/nxgi_convert.h"
+#include "subsystems/nxgi_font.h"
+#include "subsystems/nxgi_geometry.h"
+#include "subsystems/nxgi_cmdlist.h"
+#include "subsystems/nxgi_raster.h"
+#include "subsystems/nxgi_image.h"
 #include "subsystems/henjin.h"
 
 typedef struct {
@@ -132,6 +152,18 @@ static K_CMD_HANDLER cmd_list[] = {
 				.usage = "scanpci",
 				.handler = __cmd_scanpci
 		},
+		{
+				.cmd = "bench",
+				.desc = "Runs a kernel benchmark and prints the results. Without arguments lists available benchmarks.",
+				.usage = "bench [name]",
+				.handler = __cmd_bench
+		},
+		{
+				.cmd = "sync",
+				.desc = "Writes modified blocks from the buffer cache to storage devices.",
+				.usage = "sync [device]",
+				.handler = __cmd_sync
+		},
 
 		{
 				.cmd = NULL,
@@ -304,10 +336,10 @@ HRESULT __cmd_kinfo(char *cmd_line, char **args, uint32_t argc)
 	/* Print kernel location in memory */
 	uint32_t k_start, k_end;
 	mm_get_kernel_physical_location(&k_start, &k_end);
-	vga_printf("Kernel physical location: [%x..%x]\n", k_start, k_end);
+	vga_printf("Kernel physical location: [0x%X..0x%X]\n", k_start, k_end);
 
 	mm_get_kernel_virtual_location(&k_start, &k_end);
-	vga_printf("Kernel virtual location:  [%x..%x]\n", k_start, k_end);
+	vga_printf("Kernel virtual location:  [0x%X..0x%X]\n", k_start, k_end);
 
 	vga_printf("Kernel image size: %dkb\n", (k_end - k_start) / 1024);
 
@@ -431,7 +463,7 @@ HRESULT __cmd_cat(char *cmd_line, char **args, uint32_t argc)
 
 	hr = k_fopen(str, FILE_OPEN_READ, &f);
 	if (FAILED(hr)) {
-		vga_printf("Failed to open file \"%s\". Error: %s (%x)\n", str, hr_to_str(hr), hr);
+		vga_printf("Failed to open file \"%s\". Error: %s (0x%X)\n", str, hr_to_str(hr), hr);
 		return S_FALSE;
 	}
 
@@ -481,7 +513,7 @@ HRESULT __cmd_hexcat(char *cmd_line, char **args, uint32_t argc)
 
 	hr = k_fopen(str, FILE_OPEN_READ, &f);
 	if (FAILED(hr)) {
-		vga_printf("Failed to open file \"%s\". Error: %s (%x)\n", str, hr_to_str(hr), hr);
+		vga_printf("Failed to open file \"%s\". Error: %s (0x%X)\n", str, hr_to_str(hr), hr);
 		return S_FALSE;
 	}
 
@@ -599,7 +631,7 @@ HRESULT __cmd_vmmapdump(char *cmd_line, char **args, uint32_t argc)
 		HRESULT hr =sched_find_proc(pid, &proc);
 
 		if (FAILED(hr)) {
-			vga_printf("Process with PID %x not found.\n", pid);
+			vga_printf("Process with PID 0x%X not found.\n", pid);
 			return S_OK;
 		}
 	} else {
@@ -639,7 +671,7 @@ HRESULT __cmd_vmmapdump(char *cmd_line, char **args, uint32_t argc)
 			default: access_str = "unknown";
 		}
 
-		vga_printf("%d. %x(phys) -> %x(virt)\n", i, r.phys_addr, r.virt_addr);
+		vga_printf("%d. 0x%X(phys) -> 0x%X(virt)\n", i, r.phys_addr, r.virt_addr);
 		vga_printf("   Size: %d (%d kb)	Usage: %s(%d) Access: %s\n", r.region_size, r.region_size / 1024, usage_str, r.usage, access_str);
 		vga_print("\n");
 	}
@@ -705,7 +737,7 @@ HRESULT __cmd_ps(char *cmd_line, char **args, uint32_t argc) {
 
 		hr = sched_get_process_by_id(i, &p);
 		if (SUCCEEDED(hr)) {
-			vga_printf("%d. \t%d \t%x        \t%x\n", i+1, p->id, p->thread_count, p->region_count);
+			vga_printf("%d. \t%d \t0x%X        \t0x%X\n", i+1, p->id, p->thread_count, p->region_count);
 		}
 	}
 
@@ -807,7 +839,7 @@ HRESULT __cmd_play(char *cmd_line, char **args, uint32_t argc)
 //		if (free_size < gran_size) {
 ////			sched_update_sw();
 //			vga_printf("buffer full.. ");
-//			//vga_printf("buffer overflow: free_size(%x) < buff_size(%x)\n", free_size, buff_size/2);
+//			//vga_printf("buffer overflow: free_size(0x%X) < buff_size(0x%X)\n", free_size, buff_size/2);
 //			continue;
 //		}
 //
@@ -828,9 +860,9 @@ HRESULT __cmd_play(char *cmd_line, char **args, uint32_t argc)
 ////		memset(buff, 0, buff_size);
 //
 //		if (bytes > 0) {
-////			vga_printf("!!queue crc=%x\n", temp_crc(buff, bytes));
+////			vga_printf("!!queue crc=0x%X\n", temp_crc(buff, bytes));
 //			hr = nxa_queue_audio(session, buff, bytes);
-////			vga_printf("audio si queued(%x bytes)\n", bytes);
+////			vga_printf("audio si queued(0x%X bytes)\n", bytes);
 //			if (FAILED(hr)) {
 //				vga_printf("Error occurred while buffering audio.\n");
 //				goto finally;
@@ -924,7 +956,7 @@ HRESULT __cmd_scanpci_cb(K_PCI_CONFIG_ADDRESS addr, uint32_t vendor_id, uint32_t
 	const char *device = pci_get_device_name(vendor_id, device_id);
 
 	if (strcmp(device, "Unknown") == 0) {
-		k_printf("Bus %d, slot %d, function %d: Unknown(%x:%x)\n",
+		k_printf("Bus %d, slot %d, function %d: Unknown(0x%X:0x%X)\n",
 					addr.bus_id,
 					addr.device_id,
 					addr.function_id,
@@ -970,6 +1002,197 @@ HRESULT __cmd_scanpci(char *cmd_line, char **args, uint32_t argc)
 	return S_OK;
 }
 
+/*
+ * List of benchmarks, available through the "bench" command.
+ */
+typedef struct {
+	char *name;
+	char *desc;
+	HRESULT __nxapi (*run)();
+} K_BENCHMARK;
+
+static K_BENCHMARK bench_list[] = {
+		{
+				.name = "ipc",
+				.desc = "Message port vs. pipe throughput, 64B to 1MiB payloads.",
+				.run = ipc_benchmark
+		},
+		{
+				.name = "iov",
+				.desc = "Small write() loop vs. a single writev() on a memory file.",
+				.run = kstream_benchmark
+		},
+		{
+				.name = "aio",
+				.desc = "Sync vs. async streaming from /dev/hd0 next to a CPU-bound thread.",
+				.run = aio_benchmark
+		},
+		{
+				.name = "ata",
+				.desc = "PIO vs. DMA sequential reads of every ATA drive, throughput and CPU busy time.",
+				.run = ata_benchmark
+		},
+		{
+				.name = "devmux",
+				.desc = "Device muxer call latency and write throughput over pipes.",
+				.run = devmux_test
+		},
+		{
+				.name = "printf",
+				.desc = "Formatting conformance checks, snprintf/cbprintf and log ring costs.",
+				.run = klog_benchmark
+		},
+		{
+				.name = "dcache",
+				.desc = "Deep path opens on the VFS and a FAT floppy, dentry cache hit rates.",
+				.run = dcache_benchmark
+		},
+		{
+				.name = "bcache",
+				.desc = "Cold vs. repeated block and FAT file reads through the buffer cache.",
+				.run = bcache_benchmark
+		},
+		{
+				.name = "pagecache",
+				.desc = "Repeated reads and mmap() vs. copying a file into a buffer.",
+				.run = pagecache_benchmark
+		},
+		{
+				.name = "readahead",
+				.desc = "Sequential file read throughput with read-ahead off and on.",
+				.run = pagecache_ra_benchmark
+		},
+		{
+				.name = "fatext",
+				.desc = "FAT12/16/32 RAM disk file operation and consistency checks, then sequential and tail reads of a large FAT file, with and without the extent map.",
+				.run = fat16_extent_benchmark
+		},
+		{
+				.name = "blkq",
+				.desc = "RAM disk merge/order checks, then concurrent sequential and random disk reads, deadline vs. noop elevator.",
+				.run = blkq_benchmark
+		},
+		{
+				.name = "dirindex",
+				.desc = "Opening every file of a 5,000 entry FAT/ISO9660 directory, with and without directory indexes.",
+				.run = dirindex_benchmark
+		},
+		{
+				.name = "span",
+				.desc = "NXGI fill/copy/blend span kernels: C vs. SSE2 vs. AVX2, checked pixel by pixel.",
+				.run = nxgi_span_benchmark
+		},
+		{
+				.name = "stretch",
+				.desc = "NXGI stretchblt golden images, 1920x1080 <-> 800x600 with each filter.",
+				.run = nxgi_scale_benchmark
+		},
+		{
+				.name = "alpha",
+				.desc = "NXGI Porter-Duff operators against a float reference, SRC_OVER/mask throughput per kernel set.",
+				.run = nxgi_blend_benchmark
+		},
+		{
+				.name = "convert",
+				.desc = "NXGI pixel format round trips of every 16/24-bit value, conversion throughput per kernel set.",
+				.run = nxgi_convert_benchmark
+		},
+		{
+				.name = "present",
+				.desc = "NXGI present of a dragged 200x150 rectangle: damaged rects vs. full screen, fps and KB/frame.",
+				.run = nxgi_present_benchmark
+		},
+		{
+				.name = "font",
+				.desc = "NXGI PSF2/BDF loading and clipped text against a reference renderer, glyphs/s per scale.",
+				.run = nxgi_font_benchmark
+		},
+		{
+				.name = "region",
+				.desc = "NXGI region operations against a bitmap reference, visible/damage regions of 8 to 128 windows.",
+				.run = nxgig_region_benchmark
+		},
+		{
+				.name = "cmdlist",
+				.desc = "NXGI immediate vs. recorded and tiled replay of Henjin-like frames: full, drag and scattered damage.",
+				.run = nxgi_cmdlist_benchmark
+		},
+		{
+				.name = "raster",
+				.desc = "NXGI anti-aliased polygons against a per-sample reference and golden images, polygons/s from 8 to 512 px.",
+				.run = nxgi_raster_benchmark
+		},
+		{
+				.name = "image",
+				.desc = "NXGI BMP and PNG decoding of PngSuite-style fixtures, C vs. SSE2 unfiltering, decode MB/s of 1024x768 files.",
+				.run = nxgi_image_benchmark
+		},
+		{
+				.name = NULL,
+				.run = NULL
+		}
+};
+
+HRESULT __cmd_bench(char *cmd_line, char **args, uint32_t argc)
+{
+	HRESULT hr;
+
+	UNUSED_ARG(cmd_line);
+
+	if (argc == 0) {
+		for (int i=0; bench_list[i].name != NULL; i++) {
+			k_printf("%s - %s\n", bench_list[i].name, bench_list[i].desc);
+		}
+
+		return S_OK;
+	}
+
+	for (int i=0; bench_list[i].name != NULL; i++) {
+		if (strcmp(args[0], bench_list[i].name) != 0) {
+			continue;
+		}
+
+		hr = bench_list[i].run();
+		if (FAILED(hr)) {
+			k_printf("Benchmark \"%s\" failed (hr=0x%X).\n", args[0], hr);
+		}
+
+		return S_OK;
+	}
+
+	return E_INVALIDARG;
+}
+
+/*
+ * Flushes the buffer cache, or the part of it belonging to a single device.
+ */
+HRESULT __cmd_sync(char *cmd_line, char **args, uint32_t argc)
+{
+	K_STREAM	*s;
+	HRESULT		hr;
+
+	UNUSED_ARG(cmd_line);
+
+	if (argc == 0) {
+		hr = bcache_sync();
+	} else {
+		hr = k_fopen(args[0], FILE_OPEN_READ, &s);
+		if (FAILED(hr)) {
+			k_printf("Failed to open %s (hr=0x%X).\n", args[0], hr);
+			return S_OK;
+		}
+
+		hr = bcache_fsync(s);
+		k_fclose(&s);
+	}
+
+	if (FAILED(hr)) {
+		k_printf("Some blocks could not be written (hr=0x%X).\n", hr);
+	}
+
+	return S_OK;
+}
+
 /*
  * Launches the experimental Window Composition Server
  */
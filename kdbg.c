@@ -5,6 +5,7 @@
  *      Author: Anton Angelov
  */
 #include <kdbg.h>
+#include <klog.h>
 #include <string.h>
 #include <hal.h>
 
@@ -26,33 +27,29 @@ HRESULT __nxapi kdbg_fini()
 	return S_OK;
 }
 
-void __nxapi dbg_print(char *string)
+void __nxapi dbg_write(const char *str, size_t len)
 {
-	char *s = string;
-
 	if (KDBG_CONTEXT.is_bochs) {
-		/* Use E9 hack */
-		while (*s) {
-			WRITE_PORT_UCHAR(0xE9, *s);
-			s++;
-		}
+		/* Use E9 hack. A single string instruction instead of a call per byte. */
+		__asm__ volatile ("rep outsb" : "+S"(str), "+c"(len) : "d"(0xE9) : "memory");
 	} else {
 		/* TODO: Implement writing through serial port. */
 		return;
 	}
 }
 
-void __nxapi dbg_printf(char *fmt, ...)
+void __nxapi dbg_print(char *string)
 {
-	char buffer[1024];
+	dbg_write(string, strlen(string));
+}
 
+void __nxapi dbg_printf(char *fmt, ...)
+{
+	/* Goes through the log ring, so callers don't wait for the port */
 	va_list args;
 	va_start(args, fmt);
-	vsprintf(buffer, fmt, args);
+	vklog(KLOG_TARGET_DEBUG, fmt, args);
 	va_end(args);
-
-	//Write formatted string with vga_print()
-	dbg_print(buffer);
 }
 
 void __nxapi dbg_break()
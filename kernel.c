@@ -23,10 +23,21 @@
 #include <kconsole.h>
 #include "scheduler.h"
 #include "syscall.h"
+#include "shm.h"
+#include "msgport.h"
+#include "aio.h"
+#include "dev_muxer.h"
+#include "klog.h"
+#include "dcache.h"
+#include "dirindex.h"
+#include "bcache.h"
+#include "pagecache.h"
+#include "blkq.h"
 #include "include/devices.h"
 #include "drivers/console.h"
 #include "drivers/sound_blaster16.h"
 #include "drivers/floppy.h"
+#include "drivers/ata.h"
 #include "drivers/fat16.h"
 #include "drivers/vesa_video.h"
 #include "subsystems/nxa.h"
@@ -63,6 +74,11 @@ void __nxapi kernel_initialize(multiboot_info_t* mbt)
 	DPRINT("Initializing syscall gateway...\n");
 	syscall_init();
 
+	DPRINT("Initializing IPC...\n");
+	shm_initialize();
+	port_initialize();
+	devmux_initialize();
+
 	DPRINT("Initializing (ISA)DMA driver...\n");
 	isadma_initialize();
 }
@@ -73,6 +89,28 @@ void __nxapi install_drivers()
 
 	DPRINT("Initializing initrd...\n");
 	initrd_init();
+
+	/* Worker threads need the scheduler, so this can't be done earlier */
+	DPRINT("Initializing async I/O...\n");
+	hr = aio_initialize();
+	if (FAILED(hr)) HalKernelPanic("Failed to initialize async I/O.");
+
+	DPRINT("Initializing block request queues...\n");
+	hr = blkq_initialize();
+	if (FAILED(hr)) HalKernelPanic("Failed to initialize block request queues.");
+
+	/* Has to be up before any storage device is accessed */
+	DPRINT("Initializing buffer cache...\n");
+	hr = bcache_initialize(BCACHE_DEFAULT_BUDGET);
+	if (FAILED(hr)) HalKernelPanic("Failed to initialize buffer cache.");
+
+	DPRINT("Initializing page cache...\n");
+	hr = pagecache_initialize();
+	if (FAILED(hr)) HalKernelPanic("Failed to initialize page cache.");
+
+	DPRINT("Starting kernel log...\n");
+	hr = klog_initialize();
+	if (FAILED(hr)) HalKernelPanic("Failed to start kernel log.");
 //	test_file_io();
 
 
@@ -96,6 +134,11 @@ void __nxapi install_drivers()
 	//hr = fdc_selftest();
 	//if (FAILED(hr)) HalKernelPanic("failed test.");
 
+	/* Drives are mounted as /dev/hd0.. and /dev/cdrom0.. */
+	DPRINT("Initializing ATA driver...\n");
+	hr = ata_driver_init();
+	if (FAILED(hr)) { k_printf("Failed (hr=%d).", hr); }
+
 	/* Graphics driver */
 	DPRINT("Initializing VESA video driver (/dev/video0).\n")
 	hr = vesa_install();
@@ -104,11 +147,11 @@ void __nxapi install_drivers()
 	/* Mount floppy to vfs */
 //	DPRINT("Mounting /dev/fdd0 to /drives/a...\n");
 //	hr = vfs_mount_fs("/drives/a", fat16_get_constructor(), "/dev/fdd0");
-//	if (FAILED(hr)) { k_printf("Failed (hr=%x).", hr); }
+//	if (FAILED(hr)) { k_printf("Failed (hr=0x%X).", hr); }
 
 	/* Initialize audio subsystem */
 	hr = nxa_initialize(NULL);
-	if (FAILED(hr)) { k_printf("%x", hr); HalKernelPanic("Failed to initialize audio subsystem."); }
+	if (FAILED(hr)) { k_printf("0x%X", hr); HalKernelPanic("Failed to initialize audio subsystem."); }
 }
 
 void __nxapi kernel_shutdown()
@@ -128,6 +171,8 @@ static void __nxapi kernel_main_thread()
 {
 	/* Initialize virtual file system */
 	DPRINT("Initializing virtual file system...\n");
+	dcache_initialize();
+	dirindex_initialize();
 	vfs_init();
 //	vfs_selftest();
 
@@ -169,11 +214,11 @@ void kernel_main(multiboot_info_t* mbt, unsigned int magic) {
 //		uint32_t length = mmap->length_low;
 //
 //		if (mmap->type == 1) {
-//			vga_printf("%d. Usable memory region [%x..%x]", ++i, base_addr, base_addr + length);
+//			vga_printf("%d. Usable memory region [0x%X..0x%X]", ++i, base_addr, base_addr + length);
 //		}else if(mmap->type == 2) {
-//			vga_printf("%d. Reserved memory region [%x..%x]", ++i, base_addr, base_addr + length);
+//			vga_printf("%d. Reserved memory region [0x%X..0x%X]", ++i, base_addr, base_addr + length);
 //		}else {
-//			vga_printf("%d. Unknown memory region [%x..%x]", ++i, base_addr, base_addr + length);
+//			vga_printf("%d. Unknown memory region [0x%X..0x%X]", ++i, base_addr, base_addr + length);
 //		}
 //		vga_printf("; size: %dKiB\n", length / 1024);
 
@@ -0,0 +1,379 @@
+/*
+ * klog.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "klog.h"
+#include "kdbg.h"
+#include "vga.h"
+#include "kstdio.h"
+#include "scheduler.h"
+#include "syncobjs.h"
+#include "timer.h"
+#include "string.h"
+#include "stdlib.h"
+
+#define KLOG_RING_MASK			(KLOG_RING_SIZE - 1)
+
+/*
+ * Each record starts with a 32 bit header: length in the low 16 bits,
+ * targets in bits 16..23 and the committed flag in the top bit. The payload
+ * follows, padded to 4 bytes, so a header never wraps around the ring end.
+ */
+#define KLOG_HDR_COMMITTED		0x80000000
+#define KLOG_HDR_LEN(h)			((h) & 0xFFFF)
+#define KLOG_HDR_TARGETS(h)		(((h) >> 16) & 0xFF)
+#define KLOG_RECORD_SIZE(len)	(4 + (((len) + 3) & ~3))
+
+static K_KLOG_RING		klog_rings[KLOG_MAX_CPUS];
+static volatile BOOL	klog_running = FALSE;
+static K_EVENT			klog_event;
+static K_SPINLOCK		klog_drain_lock;
+
+/*
+ * Prototypes
+ */
+static K_KLOG_RING *klog_current_ring();
+static BOOL klog_append(K_KLOG_RING *ring, uint32_t targets, const char *msg, uint32_t len);
+static void klog_copy_out(K_KLOG_RING *ring, uint32_t pos, void *dst, uint32_t len);
+static BOOL klog_drain_one(K_KLOG_RING *ring, BOOL emit);
+static uint32_t klog_drain(uint32_t max_records);
+static void klog_emit(uint32_t targets, const char *str, size_t len);
+static void klog_sink(void *ctx, const char *str, size_t len);
+static void __nxapi klog_thread();
+
+HRESULT __nxapi klog_initialize()
+{
+	HRESULT hr;
+
+	event_create(&klog_event, EVENT_FLAG_NONE);
+	spinlock_create(&klog_drain_lock);
+
+	hr = sched_create_thread(NULL, klog_thread, NULL);
+	if (FAILED(hr)) return hr;
+
+	/* Messages logged from now on are queued */
+	klog_running = TRUE;
+
+	return S_OK;
+}
+
+static K_KLOG_RING *klog_current_ring()
+{
+	/* No SMP support yet, everything runs on CPU 0 */
+	return &klog_rings[0];
+}
+
+static void klog_emit(uint32_t targets, const char *str, size_t len)
+{
+	if (targets & KLOG_TARGET_DEBUG) dbg_write(str, len);
+	if (targets & KLOG_TARGET_CONSOLE) vga_write(str, len);
+}
+
+static void klog_sink(void *ctx, const char *str, size_t len)
+{
+	klog_emit(*(uint32_t*)ctx, str, len);
+}
+
+/*
+ * Reserves space with compare-and-swap, so producers never block each
+ * other and may run in an ISR. Returns FALSE if the ring is full.
+ */
+static BOOL klog_append(K_KLOG_RING *ring, uint32_t targets, const char *msg, uint32_t len)
+{
+	uint32_t	size = KLOG_RECORD_SIZE(len);
+	uint32_t	head, off, pos, first;
+
+	do {
+		head = ring->head;
+
+		if (head + size - ring->tail > KLOG_RING_SIZE) {
+			__sync_fetch_and_add(&ring->dropped, 1);
+			return FALSE;
+		}
+	} while (__sync_val_compare_and_swap(&ring->head, head, head + size) != head);
+
+	off = head & KLOG_RING_MASK;
+	pos = (off + 4) & KLOG_RING_MASK;
+
+	/* Space is zeroed by the drainer, so the header reads as uncommitted
+	 * until it's written below.
+	 */
+	first = KLOG_RING_SIZE - pos;
+	if (first >= len) {
+		memcpy(ring->data + pos, msg, len);
+	} else {
+		memcpy(ring->data + pos, msg, first);
+		memcpy(ring->data, msg + first, len - first);
+	}
+
+	__sync_synchronize();
+	*(volatile uint32_t*)(ring->data + off) = KLOG_HDR_COMMITTED | (targets << 16) | len;
+
+	return TRUE;
+}
+
+static void klog_copy_out(K_KLOG_RING *ring, uint32_t pos, void *dst, uint32_t len)
+{
+	uint32_t first = KLOG_RING_SIZE - pos;
+
+	if (first >= len) {
+		memcpy(dst, ring->data + pos, len);
+	} else {
+		memcpy(dst, ring->data + pos, first);
+		memcpy((uint8_t*)dst + first, ring->data, len - first);
+	}
+}
+
+/*
+ * Takes the oldest record, if it's committed. Must be called with
+ * klog_drain_lock held.
+ */
+static BOOL klog_drain_one(K_KLOG_RING *ring, BOOL emit)
+{
+	char		msg[KLOG_MAX_RECORD];
+	uint32_t	tail = ring->tail;
+	uint32_t	off = tail & KLOG_RING_MASK;
+	uint32_t	hdr, len, size, first;
+
+	hdr = *(volatile uint32_t*)(ring->data + off);
+	if (!(hdr & KLOG_HDR_COMMITTED)) {
+		return FALSE;
+	}
+
+	__sync_synchronize();
+
+	len		= KLOG_HDR_LEN(hdr);
+	size	= KLOG_RECORD_SIZE(len);
+
+	klog_copy_out(ring, (off + 4) & KLOG_RING_MASK, msg, len);
+
+	/* Zero the record, so stale bytes never look like a committed header */
+	first = KLOG_RING_SIZE - off;
+	if (first >= size) {
+		memset(ring->data + off, 0, size);
+	} else {
+		memset(ring->data + off, 0, first);
+		memset(ring->data, 0, size - first);
+	}
+
+	__sync_synchronize();
+	ring->tail = tail + size;
+
+	if (emit) {
+		klog_emit(KLOG_HDR_TARGETS(hdr), msg, len);
+	}
+
+	return TRUE;
+}
+
+static uint32_t klog_drain(uint32_t max_records)
+{
+	K_KLOG_RING	*ring;
+	uint32_t	cnt = 0, dropped, intf, targets;
+
+	intf = spinlock_acquire(&klog_drain_lock);
+
+	for (uint32_t cpu=0; cpu<KLOG_MAX_CPUS; cpu++) {
+		ring = &klog_rings[cpu];
+
+		while (cnt < max_records && klog_drain_one(ring, TRUE)) {
+			cnt++;
+		}
+
+		if (ring->dropped && (dropped = __sync_lock_test_and_set(&ring->dropped, 0))) {
+			targets = KLOG_TARGET_DEBUG;
+			cbprintf(klog_sink, &targets, "klog: %d messages dropped\n", dropped);
+		}
+	}
+
+	spinlock_release(&klog_drain_lock, intf);
+	return cnt;
+}
+
+void __nxapi klog_flush()
+{
+	while (klog_drain(KLOG_DRAIN_BATCH) > 0);
+}
+
+static void __nxapi klog_thread()
+{
+	while (TRUE) {
+		/* Reset before draining, so a message committed meanwhile wakes us up */
+		event_reset(&klog_event);
+
+		if (klog_drain(KLOG_DRAIN_BATCH) == KLOG_DRAIN_BATCH) {
+			/* More to do, but let other threads run first */
+			sched_yield();
+			continue;
+		}
+
+		event_waitfor(&klog_event, TIMEOUT_INFINITE);
+	}
+}
+
+void __nxapi vklog(uint32_t targets, const char *fmt, va_list args)
+{
+	char		msg[KLOG_MAX_RECORD];
+	uint32_t	len;
+
+	if (!klog_running) {
+		/* No drainer yet, write out directly */
+		vcbprintf(klog_sink, &targets, fmt, args);
+		return;
+	}
+
+	len = vsnprintf(msg, sizeof(msg), fmt, args);
+	if (len >= sizeof(msg)) len = sizeof(msg) - 1;
+
+	if (klog_append(klog_current_ring(), targets, msg, len)) {
+		event_signal(&klog_event);
+	}
+}
+
+void __nxapi printk(const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	vklog(KLOG_TARGET_DEBUG | KLOG_TARGET_CONSOLE, fmt, args);
+	va_end(args);
+}
+
+/*
+ * Benchmark
+ */
+#define KLOG_BENCH_CALLS		20000
+#define KLOG_BENCH_LOG_CALLS	5000
+
+typedef struct {
+	const char	*fmt;
+	BOOL		wide;
+	int64_t		arg;
+	const char	*expected;
+} KLOG_FMT_CASE;
+
+/* Spot checks. Expected strings are what glibc printf produces for the same
+ * format and argument, wide values cover the 9-digit chunking of %llu.
+ */
+static const KLOG_FMT_CASE klog_fmt_cases[] = {
+	{ "%d", FALSE, -12345, "-12345" },
+	{ "%5d|", FALSE, 42, "   42|" },
+	{ "%-5d|", FALSE, 42, "42   |" },
+	{ "%05d", FALSE, -42, "-0042" },
+	{ "%+d", FALSE, 7, "+7" },
+	{ "%.3d", FALSE, 5, "005" },
+	{ "%.0d", FALSE, 0, "" },
+	{ "%x", FALSE, 0xBEEF, "beef" },
+	{ "%#X", FALSE, 0xBEEF, "0XBEEF" },
+	{ "%#010x", FALSE, 255, "0x000000ff" },
+	{ "%#o", FALSE, 8, "010" },
+	{ "%u", FALSE, -1, "4294967295" },
+	{ "%hhd", FALSE, 300, "44" },
+	{ "%lld", TRUE, -9223372036854775807LL, "-9223372036854775807" },
+	{ "%llx", TRUE, 0x123456789ABCDEFLL, "123456789abcdef" },
+	{ "%llu", TRUE, 10000000000LL, "10000000000" },
+	{ "%llu", TRUE, 4294967295LL, "4294967295" },
+	{ "%llu", TRUE, 4294967296LL, "4294967296" },
+	{ "%llu", TRUE, 1000000000LL, "1000000000" },
+	{ "%llu", TRUE, 999999999999LL, "999999999999" },
+	{ "%llu", TRUE, 1000000000000000000LL, "1000000000000000000" },
+	{ "%llu", TRUE, 4294967296000000001LL, "4294967296000000001" },
+	{ "%llu", TRUE, -1LL, "18446744073709551615" },
+	{ "%lld", TRUE, -9223372036854775807LL - 1, "-9223372036854775808" },
+	{ "%020llu", TRUE, 12345678901234LL, "00000012345678901234" },
+	{ "%.25llu", TRUE, 1000000000000000001LL, "0000001000000000000000001" },
+	{ "%-22lld|", TRUE, -5000000000LL, "-5000000000           |" },
+	{ "%+lld", TRUE, 9000000000000000009LL, "+9000000000000000009" },
+	{ "%llo", TRUE, 4294967296LL, "40000000000" },
+	{ "%#llX", TRUE, -1LL, "0XFFFFFFFFFFFFFFFF" },
+	{ "% d", FALSE, 42, " 42" },
+	{ "%d", FALSE, -2147483647 - 1, "-2147483648" },
+	{ "%hd", FALSE, 70000, "4464" },
+	{ "%10.4x|", FALSE, 0xAB, "      00ab|" },
+	{ "%-#8o|", FALSE, 64, "0100    |" },
+	{ "%.0x", FALSE, 0, "" },
+	{ "%#x", FALSE, 0, "0" },
+};
+
+static void klog_null_sink(void *ctx, const char *str, size_t len)
+{
+	UNUSED_ARG(str);
+	*(size_t*)ctx += len;
+}
+
+static uint32_t klog_bench_ns(uint32_t ms, uint32_t calls)
+{
+	return (uint32_t)udiv64((uint64_t)ms * 1000000, calls, NULL);
+}
+
+HRESULT __nxapi klog_benchmark()
+{
+	static K_KLOG_RING	ring;
+	char				buf[128];
+	size_t				sunk = 0;
+	uint32_t			i, t, passed = 0, len;
+	uint32_t			cnt = sizeof(klog_fmt_cases) / sizeof(klog_fmt_cases[0]);
+
+	/* Conformance spot checks */
+	for (i=0; i<cnt; i++) {
+		const KLOG_FMT_CASE *c = &klog_fmt_cases[i];
+
+		if (c->wide) {
+			snprintf(buf, sizeof(buf), c->fmt, c->arg);
+		} else {
+			snprintf(buf, sizeof(buf), c->fmt, (int32_t)c->arg);
+		}
+
+		if (strcmp(buf, c->expected) == 0) {
+			passed++;
+		} else {
+			k_printf("  \"%s\": got \"%s\", expected \"%s\"\n", c->fmt, buf, c->expected);
+		}
+	}
+
+	k_printf("Conformance: %d/%d passed\n", passed, cnt);
+
+	/* Formatting into a buffer */
+	t = timer_gettickcount();
+	for (i=0; i<KLOG_BENCH_CALLS; i++) {
+		snprintf(buf, sizeof(buf), "%s: hr=0x%X, rect=%d,%d %dx%d\n", "hj_control", 0x1F, i, -i, 640, 480);
+	}
+	t = timer_gettickcount() - t;
+	k_printf("snprintf(): %d ns/call\n", klog_bench_ns(t, KLOG_BENCH_CALLS));
+
+	/* Formatting into a sink */
+	t = timer_gettickcount();
+	for (i=0; i<KLOG_BENCH_CALLS; i++) {
+		cbprintf(klog_null_sink, &sunk, "%s: hr=0x%X, rect=%d,%d %dx%d\n", "hj_control", 0x1F, i, -i, 640, 480);
+	}
+	t = timer_gettickcount() - t;
+	k_printf("cbprintf(): %d ns/call\n", klog_bench_ns(t, KLOG_BENCH_CALLS));
+
+	/* Writing out synchronously, as dbg_printf() used to */
+	t = timer_gettickcount();
+	for (i=0; i<KLOG_BENCH_LOG_CALLS; i++) {
+		uint32_t targets = KLOG_TARGET_DEBUG;
+		cbprintf(klog_sink, &targets, "klog bench: hr=0x%X, rect=%d,%d %dx%d\n", 0x1F, i, -i, 640, 480);
+	}
+	t = timer_gettickcount() - t;
+	k_printf("Synchronous debug output: %d ns/call\n", klog_bench_ns(t, KLOG_BENCH_LOG_CALLS));
+
+	/* Appending to a private ring, which is emptied (without output) whenever it fills up */
+	memset(&ring, 0, sizeof(ring));
+
+	t = timer_gettickcount();
+	for (i=0; i<KLOG_BENCH_LOG_CALLS; i++) {
+		len = snprintf(buf, sizeof(buf), "klog bench: hr=0x%X, rect=%d,%d %dx%d\n", 0x1F, i, -i, 640, 480);
+
+		if (!klog_append(&ring, KLOG_TARGET_DEBUG, buf, len)) {
+			while (klog_drain_one(&ring, FALSE));
+			klog_append(&ring, KLOG_TARGET_DEBUG, buf, len);
+		}
+	}
+	t = timer_gettickcount() - t;
+	k_printf("Ring append (incl. draining): %d ns/call\n", klog_bench_ns(t, KLOG_BENCH_LOG_CALLS));
+
+	return passed == cnt ? S_OK : E_FAIL;
+}
@@ -8,6 +8,8 @@
 #include <string.h>
 #include <vga.h>
 #include <kdbg.h>
+#include <timer.h>
+#include <mm.h>
 
 HRESULT k_fcreate(char *filename, uint32_t perm)
 {
@@ -49,6 +51,128 @@ uint32_t k_fseek(K_STREAM *str, int64_t pos, int8_t origin)
 	return str->seek(str, pos, origin);
 }
 
+/*
+ * Default readv()/writev(): a loop of read()/write() calls. The stream lock
+ * is recursive, so holding it keeps the sequence atomic with respect to other
+ * users of the stream.
+ */
+static HRESULT k_frw_vector(K_STREAM *str, BOOL write, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes)
+{
+	size_t		total = 0, done;
+	HRESULT		hr = S_OK;
+	uint32_t	i;
+
+	if ((write && !str->write) || (!write && !str->read)) {
+		return E_NOTSUPPORTED;
+	}
+
+	mutex_lock(&str->lock);
+
+	for (i=0; i<iov_cnt; i++) {
+		if (iov[i].len == 0) {
+			continue;
+		}
+
+		done = 0;
+		hr = write ? str->write(str, iov[i].len, iov[i].base, &done) :
+					 str->read(str, iov[i].len, iov[i].base, &done);
+
+		total += done;
+
+		if (FAILED(hr) || done < iov[i].len) {
+			break;
+		}
+	}
+
+	mutex_unlock(&str->lock);
+
+	/* Partial transfer is still a success */
+	if (FAILED(hr) && total > 0) {
+		hr = S_OK;
+	}
+
+	if (bytes) *bytes = total;
+	return hr;
+}
+
+HRESULT k_freadv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read)
+{
+	if (!iov) {
+		return E_POINTER;
+	}
+
+	if (str->readv) {
+		return str->readv(str, iov, iov_cnt, bytes_read);
+	}
+
+	return k_frw_vector(str, FALSE, iov, iov_cnt, bytes_read);
+}
+
+HRESULT k_fwritev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written)
+{
+	if (!iov) {
+		return E_POINTER;
+	}
+
+	if (str->writev) {
+		return str->writev(str, iov, iov_cnt, bytes_written);
+	}
+
+	return k_frw_vector(str, TRUE, iov, iov_cnt, bytes_written);
+}
+
+/*
+ * Default pread()/pwrite(): seek, transfer and restore the position marker.
+ * Limited to 4GiB, since the position marker is 32-bit.
+ */
+static HRESULT k_frw_at(K_STREAM *str, BOOL write, uint64_t offset, size_t size, void *buf, size_t *bytes)
+{
+	uint32_t	old_pos;
+	HRESULT		hr;
+
+	if (!str->seek || !str->tell || (write && !str->write) || (!write && !str->read)) {
+		return E_NOTSUPPORTED;
+	}
+
+	if (offset > 0xFFFFFFFF) {
+		return E_INVALIDARG;
+	}
+
+	mutex_lock(&str->lock);
+
+	old_pos = str->tell(str);
+
+	hr = str->seek(str, offset, KSTREAM_ORIGIN_BEGINNING);
+	if (FAILED(hr)) goto finally;
+
+	hr = write ? str->write(str, size, buf, bytes) :
+				 str->read(str, size, buf, bytes);
+
+	str->seek(str, old_pos, KSTREAM_ORIGIN_BEGINNING);
+
+finally:
+	mutex_unlock(&str->lock);
+	return hr;
+}
+
+HRESULT k_fpread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read)
+{
+	if (str->pread) {
+		return str->pread(str, offset, size, out_buf, bytes_read);
+	}
+
+	return k_frw_at(str, FALSE, offset, size, out_buf, bytes_read);
+}
+
+HRESULT k_fpwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written)
+{
+	if (str->pwrite) {
+		return str->pwrite(str, offset, size, in_buf, bytes_written);
+	}
+
+	return k_frw_at(str, TRUE, offset, size, in_buf, bytes_written);
+}
+
 HRESULT k_opendir(char *dirname, K_DIR_STREAM **out)
 {
 	return vfs_opendir(vfs_get_driver(), dirname, out);
@@ -78,6 +202,21 @@ HRESULT k_mkdir(char *path, uint32_t mode)
 	return vfs_mkdir(vfs_get_driver(), path, mode);
 }
 
+HRESULT k_unlink(char *path)
+{
+	return vfs_unlink(vfs_get_driver(), path);
+}
+
+HRESULT k_rename(char *old_path, char *new_path)
+{
+	return vfs_rename(vfs_get_driver(), old_path, new_path);
+}
+
+HRESULT k_sync()
+{
+	return vfs_sync(vfs_get_driver());
+}
+
 HRESULT k_ioctl(K_STREAM *s, uint32_t code, void *arg)
 {
 	return s->ioctl(s, code, arg);
@@ -89,16 +228,96 @@ void __nxapi k_print(char *str)
 	vga_print(str);
 }
 
-void __nxapi k_printf(char *fmt, ...)
+static void k_print_sink(void *ctx, const char *str, size_t len)
 {
-	char buffer[1024];
+	UNUSED_ARG(ctx);
+
+	dbg_write(str, len);
+	vga_write(str, len);
+}
 
+void __nxapi k_printf(char *fmt, ...)
+{
 	va_list args;
 	va_start(args, fmt);
-	vsprintf(buffer, fmt, args);
+	vcbprintf(k_print_sink, NULL, fmt, args);
 	va_end(args);
+}
+
+#define KSTREAM_BENCH_FILE		"/iobench.tmp"
+#define KSTREAM_BENCH_PIECES	64
+#define KSTREAM_BENCH_PIECE_LEN	16
+#define KSTREAM_BENCH_ROUNDS	10000
+
+HRESULT __nxapi kstream_benchmark()
+{
+	K_IOVEC		iov[KSTREAM_BENCH_PIECES];
+	uint8_t		*frame;
+	K_STREAM	*s = NULL;
+	uint32_t	i, j, t, loop_ms, vec_ms, fallback_ms;
+	HRESULT		hr;
+
+	if (!(frame = kmalloc(KSTREAM_BENCH_PIECES * KSTREAM_BENCH_PIECE_LEN))) {
+		return E_OUTOFMEM;
+	}
+
+	for (i=0; i<KSTREAM_BENCH_PIECES; i++) {
+		iov[i].base = frame + i * KSTREAM_BENCH_PIECE_LEN;
+		iov[i].len	= KSTREAM_BENCH_PIECE_LEN;
+	}
+
+	/* File may be left over from a previous run */
+	k_fcreate(KSTREAM_BENCH_FILE, NODE_MODE_ALL_RWE);
+
+	hr = k_fopen(KSTREAM_BENCH_FILE, FILE_OPEN_WRITE, &s);
+	if (FAILED(hr)) goto finally;
+
+	/* A loop of small writes */
+	t = timer_gettickcount();
+
+	for (i=0; i<KSTREAM_BENCH_ROUNDS; i++) {
+		k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+		for (j=0; j<KSTREAM_BENCH_PIECES; j++) {
+			hr = k_fwrite(s, iov[j].len, iov[j].base, NULL);
+			if (FAILED(hr)) goto finally;
+		}
+	}
+
+	loop_ms = timer_gettickcount() - t;
+
+	/* One writev() per frame */
+	t = timer_gettickcount();
+
+	for (i=0; i<KSTREAM_BENCH_ROUNDS; i++) {
+		k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+		hr = k_fwritev(s, iov, KSTREAM_BENCH_PIECES, NULL);
+		if (FAILED(hr)) goto finally;
+	}
+
+	vec_ms = timer_gettickcount() - t;
+
+	/* Same, but through the default fallback */
+	t = timer_gettickcount();
+
+	for (i=0; i<KSTREAM_BENCH_ROUNDS; i++) {
+		k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+		hr = k_frw_vector(s, TRUE, iov, KSTREAM_BENCH_PIECES, NULL);
+		if (FAILED(hr)) goto finally;
+	}
+
+	fallback_ms = timer_gettickcount() - t;
+
+	k_printf("%d frames of %dx%d bytes:\n", KSTREAM_BENCH_ROUNDS, KSTREAM_BENCH_PIECES, KSTREAM_BENCH_PIECE_LEN);
+	k_printf("  write() loop:      %d ms\n", loop_ms);
+	k_printf("  writev() native:   %d ms\n", vec_ms);
+	k_printf("  writev() fallback: %d ms\n", fallback_ms);
+
+finally:
+	if (s) k_fclose(&s);
+	kfree(frame);
 
-	//Write formatted string with vga_print()
-	dbg_print(buffer);
-	vga_print(buffer);
+	return hr;
 }
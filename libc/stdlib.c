@@ -10,3 +10,23 @@ int abs(int n)
 {
 	return n > 0 ? n : -n;
 }
+
+/*
+ * The compiler turns 64-bit division into calls to __udivdi3 and
+ * __umoddi3, which libgcc doesn't provide under -fleading-underscore.
+ * Two divl instructions do it instead: the high word first, then the
+ * low word with the high word's remainder, which keeps the second
+ * quotient within 32 bits.
+ */
+uint64_t udiv64(uint64_t n, uint32_t d, uint32_t *rem)
+{
+	uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n, q_hi, q_lo, r;
+
+	q_hi = hi / d;
+	r = hi % d;
+
+	__asm__("divl %4" : "=a" (q_lo), "=d" (r) : "a" (lo), "d" (r), "rm" (d) : "cc");
+
+	if (rem) *rem = r;
+	return ((uint64_t)q_hi << 32) | q_lo;
+}
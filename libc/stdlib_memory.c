@@ -66,7 +66,7 @@ static MM_CONTEXT mm_contex = {
 /*
  * Prototypes
  */
-static BOOL mm_create_heap(MM_CONTEXT *ctx);
+static BOOL mm_create_heap(MM_CONTEXT *ctx, size_t min_size);
 static BOOL mm_free_heap(MM_CONTEXT *ctx, uint32_t id);
 static BOOL mm_allocate_block_from_heap(MM_HEAP_DESCRIPTOR *d, size_t size, void **ptr);
 static BOOL mm_free_block_from_heap(MM_HEAP_DESCRIPTOR *d, MM_CONTROL_BLOCK *mcb);
@@ -77,7 +77,7 @@ void mm_fini();
 /*
  * Implementation
  */
-static BOOL mm_create_heap(MM_CONTEXT *ctx)
+static BOOL mm_create_heap(MM_CONTEXT *ctx, size_t min_size)
 {
 	HRESULT	hr = S_OK;
 
@@ -94,6 +94,11 @@ static BOOL mm_create_heap(MM_CONTEXT *ctx)
 
 	d->size = DEFAULT_HEAP_SIZE;
 
+	/* Blocks larger than the default size (e.g. full HD bitmaps) get a heap of their own size */
+	if (min_size + 2 * sizeof(MM_CONTROL_BLOCK) > d->size) {
+		d->size = (min_size + 2 * sizeof(MM_CONTROL_BLOCK) + 0xFFF) & ~0xFFF;
+	}
+
 	hr = vmm_create_heap(ctx->pid, d->size, USAGE_DATA | (ctx->kernel_mode ? USAGE_KERNEL : USAGE_USER), &d->memory);
 	if (FAILED(hr)) goto unlock;
 
@@ -150,7 +155,7 @@ static BOOL mm_allocate_block_from_heap(MM_HEAP_DESCRIPTOR *d, size_t size, void
 	mutex_lock(&d->lock);
 
 	while (addr != (uint8_t*)d->memory + d->size) {
-//		k_printf("iteration: addr=%x; end_addr=%x\n", addr, (uint8_t*)d->memory + d->size);
+//		k_printf("iteration: addr=0x%X; end_addr=0x%X\n", addr, (uint8_t*)d->memory + d->size);
 		mcb = (MM_CONTROL_BLOCK*)addr;
 
 		if (mcb->magic != MM_MAGIC) {
@@ -316,7 +321,7 @@ void* malloc(size_t size)
 	 * Create new one.
 	 */
 	if (ctx->heap_count < MAX_HEAPS-1) {
-		if (!mm_create_heap(&mm_contex)) {
+		if (!mm_create_heap(&mm_contex, size)) {
 			goto unlock;
 		}
 
@@ -411,21 +416,21 @@ BOOL mm_test()
 			return FALSE;
 		}
 
-		k_printf("%x; ", blocks[i]);
+		k_printf("0x%X; ", blocks[i]);
 	}
 
 	k_printf("\nReallocing...\n");
 	/* Reallocate */
 	for (i=0; i<N; i++) {
 		blocks[i] = realloc(blocks[i], size * 2);
-		k_printf("%x; ", blocks[i]);
+		k_printf("0x%X; ", blocks[i]);
 	}
 
 	k_printf("\nReallocing (2)...\n");
 	/* Reallocate */
 	for (i=0; i<N; i++) {
 		blocks[i] = realloc(blocks[i], size);
-		k_printf("%x; ", blocks[i]);
+		k_printf("0x%X; ", blocks[i]);
 	}
 
 	k_printf("\nFreeing...\n\n");
@@ -442,7 +447,7 @@ BOOL mm_test()
 			return FALSE;
 		}
 
-		k_printf("%x; ", blocks[i]);
+		k_printf("0x%X; ", blocks[i]);
 	}
 
 	k_printf("\nFreeing...\n\n");
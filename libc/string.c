@@ -6,6 +6,7 @@
  */
 
 #include "string.h"
+#include "stdlib.h"
 #include "mm.h"
 #include "hal.h"
 
@@ -65,86 +66,450 @@ void* memset(void *dst, int c, size_t size)
 	return dst;
 }
 
-static PCHAR __sprint_hex(PCHAR target, int src)
+/*
+ * Formatting engine
+ *
+ * Output is collected in a window. For vsnprintf() the window is the target
+ * buffer itself; for vcbprintf() it's a small buffer on the stack, which is
+ * flushed to the sink whenever it fills up.
+ */
+#define FMT_FLAG_LEFT		0x01
+#define FMT_FLAG_PLUS		0x02
+#define FMT_FLAG_SPACE		0x04
+#define FMT_FLAG_ALT		0x08
+#define FMT_FLAG_ZERO		0x10
+#define FMT_FLAG_UPPER		0x20
+
+#define FMT_SINK_CHUNK		128
+
+typedef struct {
+	char			*buf;
+	size_t			pos;
+	size_t			cap;
+
+	/* NULL for vsnprintf(), where output beyond cap is only counted */
+	K_PRINTF_SINK	sink;
+	void			*ctx;
+
+	size_t			total;
+} FMT_STATE;
+
+/* Two decimal digits at a time */
+static const char fmt_digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char fmt_hex_lower[16] = "0123456789abcdef";
+static const char fmt_hex_upper[16] = "0123456789ABCDEF";
+
+static void fmt_flush(FMT_STATE *st)
+{
+	if (st->sink && st->pos > 0) {
+		st->sink(st->ctx, st->buf, st->pos);
+		st->pos = 0;
+	}
+}
+
+static void fmt_put(FMT_STATE *st, const char *s, size_t len)
 {
-	char hexmap[16] = "0123456789ABCDEF";
-	uint32_t usrc = (uint32_t)src;
+	size_t chunk;
+
+	st->total += len;
+
+	while (len > 0) {
+		if (st->pos == st->cap) {
+			if (!st->sink) return;
+			fmt_flush(st);
+		}
 
-	/* Add minus sign if number is negative */
-	/*
-	if (src<0) {
-		*(target++) = '-';
-		src *= -1;
+		chunk = st->cap - st->pos;
+		if (chunk > len) chunk = len;
+
+		memcpy(st->buf + st->pos, s, chunk);
+		st->pos	+= chunk;
+		s		+= chunk;
+		len		-= chunk;
 	}
-	*/
+}
 
-	/* Count the number of digits in the number */
-	uint32_t digits = 0, num = (uint32_t)src;
-	do {
-		digits++;
-		num /= 16;
-	} while(num>0);
+static void fmt_fill(FMT_STATE *st, char c, int32_t cnt)
+{
+	char pad[16];
 
-	/* Add 0x prefix */
-	*(target++) = '0';
-	*(target++) = 'x';
-	target += digits;
+	if (cnt <= 0) return;
 
-	do {
-		*(--target) = hexmap[usrc % 16];
-		usrc /= 16;
-	} while(usrc>0);
+	memset(pad, c, sizeof(pad));
 
-	return target + digits;
+	while (cnt > 0) {
+		int32_t n = cnt > (int32_t)sizeof(pad) ? (int32_t)sizeof(pad) : cnt;
+
+		fmt_put(st, pad, n);
+		cnt -= n;
+	}
 }
 
-static PCHAR __sprint_dec(PCHAR target, int src)
+/*
+ * Writes decimal digits of _val_ backwards, ending at _end_. Returns
+ * pointer to the first digit. 64-bit division is a libgcc call on i686,
+ * so wide values are cut into 9-digit chunks by udiv64() and each chunk
+ * is converted with 32-bit math.
+ */
+static char *fmt_utoa_dec(char *end, uint64_t val)
 {
-	/* Add minus sign if number is negative */
-	if (src<0) {
-		*(target++) = '-';
-		src *= -1;
+	uint32_t	v32, i;
+
+	while (val > 0xFFFFFFFFULL) {
+		val = udiv64(val, 1000000000, &v32);
+
+		/* Chunks other than the leading one keep their zeroes */
+		for (i=0; i<4; i++) {
+			uint32_t r = v32 % 100;
+
+			v32 /= 100;
+			end -= 2;
+			end[0] = fmt_digit_pairs[r * 2];
+			end[1] = fmt_digit_pairs[r * 2 + 1];
+		}
+
+		*(--end) = '0' + v32;
 	}
 
-	/* First we have to reverse the order of the digits */
-	int reversed = 0;
-	int cnt = 0;
+	v32 = (uint32_t)val;
 
-	while(src>0) {
-		reversed *= 10;
-		reversed += src % 10;
-		src /= 10;
+	while (v32 >= 100) {
+		uint32_t r = v32 % 100;
 
-		cnt++;
+		v32 /= 100;
+		end -= 2;
+		end[0] = fmt_digit_pairs[r * 2];
+		end[1] = fmt_digit_pairs[r * 2 + 1];
 	}
 
+	if (v32 >= 10) {
+		end -= 2;
+		end[0] = fmt_digit_pairs[v32 * 2];
+		end[1] = fmt_digit_pairs[v32 * 2 + 1];
+	} else {
+		*(--end) = '0' + v32;
+	}
+
+	return end;
+}
+
+static char *fmt_utoa_pow2(char *end, uint64_t val, uint32_t shift, BOOL upper)
+{
+	const char	*map = upper ? fmt_hex_upper : fmt_hex_lower;
+	uint32_t	mask = (1 << shift) - 1;
+
 	do {
-		*(target++) = '0' + (reversed % 10);
-		reversed /= 10;
-	} while(--cnt > 0);
+		*(--end) = map[val & mask];
+		val >>= shift;
+	} while (val > 0);
 
-	return target;
+	return end;
 }
 
-static PCHAR __sprint_str(PCHAR target, PCHAR src, BOOL inc_null)
+/*
+ * Emits an integer conversion, applying sign, prefix, precision and width.
+ */
+static void fmt_integer(FMT_STATE *st, uint64_t val, BOOL negative, uint32_t base, uint32_t flags, int32_t width, int32_t prec)
 {
+	char		digits[24];
+	char		*end = digits + sizeof(digits), *p;
+	char		prefix[2];
+	int32_t		ndigits, nprefix = 0, nzero, total;
+
+	if (val == 0 && prec == 0) {
+		/* "%.0d" of zero prints no digits */
+		p = end;
+	} else if (base == 10) {
+		p = fmt_utoa_dec(end, val);
+	} else {
+		p = fmt_utoa_pow2(end, val, base == 16 ? 4 : 3, flags & FMT_FLAG_UPPER);
+	}
+
+	ndigits = end - p;
+
+	if (base == 10) {
+		if (negative)					prefix[nprefix++] = '-';
+		else if (flags & FMT_FLAG_PLUS)	prefix[nprefix++] = '+';
+		else if (flags & FMT_FLAG_SPACE)	prefix[nprefix++] = ' ';
+	} else if (flags & FMT_FLAG_ALT) {
+		if (base == 16 && val != 0) {
+			prefix[nprefix++] = '0';
+			prefix[nprefix++] = flags & FMT_FLAG_UPPER ? 'X' : 'x';
+		}
+	}
+
+	/* Zeroes needed to reach precision */
+	nzero = prec > ndigits ? prec - ndigits : 0;
+
+	/* Octal alternate form guarantees a leading zero */
+	if (base == 8 && (flags & FMT_FLAG_ALT) && nzero == 0 && (ndigits == 0 || *p != '0')) {
+		nzero = 1;
+	}
+
+	/* The '0' flag is ignored when precision is given or output is left-justified */
+	if (prec < 0 && (flags & FMT_FLAG_ZERO) && !(flags & FMT_FLAG_LEFT)) {
+		if (width > nprefix + nzero + ndigits) {
+			nzero = width - nprefix - ndigits;
+		}
+	}
+
+	total = nprefix + nzero + ndigits;
+
+	if (!(flags & FMT_FLAG_LEFT)) fmt_fill(st, ' ', width - total);
+
+	fmt_put(st, prefix, nprefix);
+	fmt_fill(st, '0', nzero);
+	fmt_put(st, p, ndigits);
+
+	if (flags & FMT_FLAG_LEFT) fmt_fill(st, ' ', width - total);
+}
+
+static void fmt_string(FMT_STATE *st, const char *s, uint32_t flags, int32_t width, int32_t prec)
+{
+	int32_t len = 0;
+
 	/* A very good idea is to handle NULL strings. Useful for debugging */
-	if (src == NULL) {
-		*target++ = 'N';
-		*target++ = 'U';
-		*target++ = 'L';
-		*target++ = 'L';
+	if (s == NULL) {
+		s = "(null)";
+	}
+
+	/* Don't read past precision, string might not be terminated */
+	while ((prec < 0 || len < prec) && s[len] != '\0') {
+		len++;
 	}
 
-	while(*src != '\0') {
-		*(target++) = *(src++);
+	if (!(flags & FMT_FLAG_LEFT)) fmt_fill(st, ' ', width - len);
+	fmt_put(st, s, len);
+	if (flags & FMT_FLAG_LEFT) fmt_fill(st, ' ', width - len);
+}
+
+static void fmt_format(FMT_STATE *st, const char *fmt, va_list args)
+{
+	const char	*pc = fmt, *lit;
+	uint32_t	flags;
+	int32_t		width, prec, lmod, hmod;
+	uint64_t	uval;
+	int64_t		sval;
+	char		c;
+
+	while (*pc != '\0') {
+		/* Emit literal run at once */
+		lit = pc;
+		while (*pc != '\0' && *pc != '%') pc++;
+		fmt_put(st, lit, pc - lit);
+
+		if (*pc == '\0') break;
+		pc++;
+
+		/* Flags */
+		flags = 0;
+
+		while (TRUE) {
+			switch (*pc) {
+			case '-': flags |= FMT_FLAG_LEFT; pc++; continue;
+			case '+': flags |= FMT_FLAG_PLUS; pc++; continue;
+			case ' ': flags |= FMT_FLAG_SPACE; pc++; continue;
+			case '#': flags |= FMT_FLAG_ALT; pc++; continue;
+			case '0': flags |= FMT_FLAG_ZERO; pc++; continue;
+			}
+
+			break;
+		}
+
+		/* Width */
+		width = 0;
+
+		if (*pc == '*') {
+			width = va_arg(args, int);
+			if (width < 0) {
+				flags |= FMT_FLAG_LEFT;
+				width = -width;
+			}
+			pc++;
+		} else {
+			while (*pc >= '0' && *pc <= '9') width = width * 10 + (*pc++ - '0');
+		}
+
+		/* Precision; negative means none */
+		prec = -1;
+
+		if (*pc == '.') {
+			pc++;
+			prec = 0;
+
+			if (*pc == '*') {
+				prec = va_arg(args, int);
+				if (prec < 0) prec = -1;
+				pc++;
+			} else {
+				while (*pc >= '0' && *pc <= '9') prec = prec * 10 + (*pc++ - '0');
+			}
+		}
+
+		/* Length modifiers, counted in 'l's and 'h's. z/t/j map to their
+		 * size on i686.
+		 */
+		lmod = 0;
+		hmod = 0;
+
+		while (TRUE) {
+			switch (*pc) {
+			case 'h': hmod++; pc++; continue;
+			case 'l': lmod++; pc++; continue;
+			case 'z': case 't': pc++; continue;
+			case 'j': lmod = 2; pc++; continue;
+			}
+
+			break;
+		}
+
+		switch (c = *pc++) {
+		case 'd':
+		case 'i':
+			sval = lmod >= 2 ? va_arg(args, int64_t) : (int64_t)va_arg(args, int);
+
+			if (hmod == 1) sval = (short)sval;
+			else if (hmod >= 2) sval = (signed char)sval;
+			uval = sval < 0 ? (uint64_t)0 - (uint64_t)sval : (uint64_t)sval;
+
+			fmt_integer(st, uval, sval < 0, 10, flags, width, prec);
+			break;
+
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			uval = lmod >= 2 ? va_arg(args, uint64_t) : (uint64_t)va_arg(args, unsigned int);
+
+			if (hmod == 1) uval = (unsigned short)uval;
+			else if (hmod >= 2) uval = (unsigned char)uval;
+
+			if (c == 'X') flags |= FMT_FLAG_UPPER;
+			fmt_integer(st, uval, FALSE, c == 'u' ? 10 : c == 'o' ? 8 : 16, flags, width, prec);
+			break;
+
+		case 'p':
+			uval = (uintptr_t)va_arg(args, void*);
+			fmt_integer(st, uval, FALSE, 16, flags | FMT_FLAG_ALT, width, prec);
+			break;
+
+		case 'c':
+			c = (char)va_arg(args, int);
+
+			if (!(flags & FMT_FLAG_LEFT)) fmt_fill(st, ' ', width - 1);
+			fmt_put(st, &c, 1);
+			if (flags & FMT_FLAG_LEFT) fmt_fill(st, ' ', width - 1);
+			break;
+
+		case 's':
+			fmt_string(st, va_arg(args, char*), flags, width, prec);
+			break;
+
+		case '%':
+			fmt_put(st, "%", 1);
+			break;
+
+		case '\0':
+			/* Dangling '%' at the end */
+			pc--;
+			break;
+
+		default:
+			/* Unknown conversion, print it as is */
+			fmt_put(st, pc - 1, 1);
+			break;
+		}
 	}
+}
+
+/**
+ * Function: vsnprintf()
+ * Composes a string the same way as vsprintf(), but writes at most _size_
+ * characters (including the null terminator) to _target_.
+ *
+ * Return value:
+ *    Number of characters, which would have been written if _size_ was large
+ *    enough, not counting the terminator.
+ */
+int __nxapi vsnprintf(PCHAR target, size_t size, const char *fmt, va_list args)
+{
+	FMT_STATE st;
 
-	if(inc_null) {
-		*target = '\0';
+	st.buf		= target;
+	st.pos		= 0;
+	st.cap		= size > 0 ? size - 1 : 0;
+	st.sink		= NULL;
+	st.ctx		= NULL;
+	st.total	= 0;
+
+	fmt_format(&st, fmt, args);
+
+	if (size > 0) {
+		target[st.pos] = '\0';
 	}
 
-	return target;
+	return st.total;
+}
+
+int __nxapi snprintf(PCHAR target, size_t size, const char *fmt, ...)
+{
+	int retcode;
+
+	va_list args;
+	va_start(args, fmt);
+	retcode = vsnprintf(target, size, fmt, args);
+	va_end(args);
+
+	return retcode;
+}
+
+/**
+ * Function: vcbprintf()
+ * Formats the same way as vsprintf(), but passes the output to _sink_ in
+ * pieces, so no buffer is needed to hold the whole string.
+ *
+ * Return value:
+ *    Number of characters passed to the sink.
+ */
+int __nxapi vcbprintf(K_PRINTF_SINK sink, void *ctx, const char *fmt, va_list args)
+{
+	char		chunk[FMT_SINK_CHUNK];
+	FMT_STATE	st;
+
+	st.buf		= chunk;
+	st.pos		= 0;
+	st.cap		= sizeof(chunk);
+	st.sink		= sink;
+	st.ctx		= ctx;
+	st.total	= 0;
+
+	fmt_format(&st, fmt, args);
+	fmt_flush(&st);
+
+	return st.total;
+}
+
+int __nxapi cbprintf(K_PRINTF_SINK sink, void *ctx, const char *fmt, ...)
+{
+	int retcode;
+
+	va_list args;
+	va_start(args, fmt);
+	retcode = vcbprintf(sink, ctx, fmt, args);
+	va_end(args);
+
+	return retcode;
 }
 
 /**
@@ -154,10 +519,14 @@ static PCHAR __sprint_str(PCHAR target, PCHAR src, BOOL inc_null)
  * by arg instead of additional function arguments and storing the resulting
  * content as a C string in the buffer pointed by target.
  *
+ * Supports flags (-+ #0), width and precision (including *), length
+ * modifiers hh, h, l, ll, z, t, j and conversions d, i, u, x, X, o, c, s, p, %.
+ *
  * Parameters:
  * @target
  *    Pointer to a buffer where the resulting C-string is stored.
  *    The buffer should be large enough to contain the resulting string.
+ *    Prefer vsnprintf() when the size is known.
  * @fmt
  *    C string that contains a format string that follows the same specifications as format in printf (see printf for details).
  * @args
@@ -170,75 +539,7 @@ static PCHAR __sprint_str(PCHAR target, PCHAR src, BOOL inc_null)
  */
 int __nxapi vsprintf(PCHAR target, PCHAR fmt, va_list args)
 {
-	PCHAR pc = fmt;
-	PCHAR dst = target;
-
-	while (*pc != '\0') {
-		if(*pc == '%') {
-			//this might be a place holder
-			if(pc != fmt && *(pc-1) == '\\') {
-				//the % symbol is actually escaped, so
-				//TODO: implement
-			}
-
-
-			//assume this is place holder
-			BOOL ph_handled = FALSE;
-			PCHAR str;
-			int number;
-
-			//move to next char to read identifier
-			pc++;
-			char id = *pc;
-
-			switch (id) {
-			case 'd':
-				//Extract decimal parameter
-				number = va_arg(args, int);
-
-				//Write decimal to string
-				dst = __sprint_dec(dst, number);
-
-				ph_handled = TRUE;
-				break;
-			case 'x':
-				//Extract hex parameter
-				number = va_arg(args, int);
-
-				//Write decimal to string
-				dst = __sprint_hex(dst, number);
-
-				ph_handled = TRUE;
-				break;
-			case 's':
-				//Extract string pointer
-				str = va_arg(args, char*);
-
-				//Write string to target
-				dst = __sprint_str(dst, str, FALSE);
-
-				ph_handled = TRUE;
-				break;
-			}
-
-			if(ph_handled) {
-				pc++;
-				continue;
-			}
-		}
-
-		/* Write to target string */
-		*(dst++) = *pc;
-
-		/* Go to next char */
-		pc++;
-	}
-
-	/* Write null terminator */
-	*dst = '\0';
-
-	/* Return number of written chars */
-	return dst - target;
+	return vsnprintf(target, (size_t)INT32_MAX, fmt, args);
 }
 
 int __nxapi sprintf(PCHAR target, PCHAR fmt, ...)
@@ -481,6 +782,8 @@ int	__nxapi memcmp(const void *ptr1, const void *ptr2, size_t num)
 
 	while (num--) {
 		if (*p1 == *p2) {
+			p1++;
+			p2++;
 			continue;
 		}
 
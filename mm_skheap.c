@@ -198,8 +198,8 @@ HRESULT skheap_find_free_region_aligned(uint32_t size, void **addr)
 //#ifdef debug
 //	if((marker & 0xFF) != 0) {
 //		vga_printf("start_block= %d; block_cnt=%d; prealign_bits= %d\n", start_block, block_cnt, prealign_bits);
-//		vga_printf("SKHEAP start: %x\n", &skheap_region[0]);
-//		vga_printf("skheap_mark_region(%x, %d, %d)\n", start, len, in_use);
+//		vga_printf("SKHEAP start: 0x%X\n", &skheap_region[0]);
+//		vga_printf("skheap_mark_region(0x%X, %d, %d)\n", start, len, in_use);
 //		HalKernelPanic("Assert failed.");
 //	}
 //#endif
@@ -237,8 +237,8 @@ HRESULT skheap_mark_region(void *start, uint32_t len, int8_t in_use)
 	uint32_t num_blocks = len / SKHEAP_BLOCK_SIZE;
 
 //	vga_printf("start_block= %d; block_cnt=%d\n", block_id, num_blocks);
-//	vga_printf("SKHEAP start: %x\n", &skheap_region[0]);
-//	vga_printf("skheap_mark_region(%x, %d, %d)\n", start, len, in_use);
+//	vga_printf("SKHEAP start: 0x%X\n", &skheap_region[0]);
+//	vga_printf("skheap_mark_region(0x%X, %d, %d)\n", start, len, in_use);
 
 	if (offs_address % SKHEAP_BLOCK_SIZE != 0) {
 		HalKernelPanic("Trying to mark region which doesn't start on block boundary.");
@@ -486,7 +486,7 @@ void skheap_selftest()
 	for (i=0;i<TEST_COUNT;i++) {
 		p[i] = skheap_malloc(512);
 		if (p[i]) {
-			vga_printf("%d. Pointer: %x\n", i, p[i]);
+			vga_printf("%d. Pointer: 0x%X\n", i, p[i]);
 		}else {
 			vga_printf("%d. Out of mem\n", i);
 		}
@@ -502,7 +502,7 @@ void skheap_selftest()
 	for (i=0;i<TEST_COUNT;i++) {
 		p[i] = skheap_malloc(200000);
 		if (p[i]) {
-			vga_printf("%d. Pointer: %x\n", i, p[i]);
+			vga_printf("%d. Pointer: 0x%X\n", i, p[i]);
 		}else {
 			vga_printf("%d. Out of mem\n", i);
 		}
@@ -520,7 +520,7 @@ void skheap_selftest()
 	for (i=0;i<TEST_COUNT;i++) {
 		p[i] = skheap_malloc_a(200000);
 		if (p[i]) {
-			vga_printf("%d. Pointer: %x\n", i, p[i]);
+			vga_printf("%d. Pointer: 0x%X\n", i, p[i]);
 		}else {
 			vga_printf("%d. Out of mem\n", i);
 		}
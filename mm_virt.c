@@ -10,6 +10,9 @@
  *  	3GB 		% 3GB + 128MB	=> Kernel code and data
  *  	3GB + 128MB % 3GB + 950MB 	=> Kernel heap
  *  	3GB + 950MB % 4GB			=> Kernel temp usage
+ *
+ *  Shared memory and pages received through message ports are mapped inside
+ *  USER_IPC_START..USER_IPC_END or KERNEL_IPC_START..KERNEL_IPC_END.
  */
 
 #include "include/mm_virt.h"
@@ -34,7 +37,12 @@ K_VMM_PAGE_DIR 	page_dir  __attribute__((aligned(0x1000)));
 void kernel_virtual_start(void);
 void kernel_physical_start(void);
 
+/* Handlers given a chance to resolve page faults before we panic */
+static K_VMM_FAULT_HANDLER	fault_handlers[VMM_MAX_FAULT_HANDLERS];
+static uint32_t				fault_handler_cnt = 0;
+
 static HRESULT vmm_find_region(void *proc_desc, uint_ptr_t virt_addr, K_VMM_REGION *dst);
+static HRESULT vmm_map_frames(void *proc_desc, uintptr_t phys_addr, const uintptr_t *frames, uintptr_t virt_addr, size_t size, K_VMM_REGION_USAGE usage, K_VMM_ACCESS_FLAG access, uint8_t commit);
 
 /*
  * Implementation
@@ -73,13 +81,23 @@ void vmm_init_virtual_address_space() {
 
 static VOID __cdecl vmm_page_fault_handler(K_REGISTERS regs)
 {
+	uintptr_t addr = HalGetFaultingAddr();
+	uint32_t i;
+
+	for (i=0; i<fault_handler_cnt; i++) {
+		if (fault_handlers[i](addr, regs.err_code) == S_OK) {
+			/* Resolved, the instruction is restarted */
+			return;
+		}
+	}
+
 	if (regs.err_code & 0x2) {
-		k_printf("Page fault occurred by write at address %x\n", HalGetFaultingAddr());
+		k_printf("Page fault occurred by write at address 0x%X\n", HalGetFaultingAddr());
 	} else {
-		k_printf("Page fault occurred by read of address %x\n", HalGetFaultingAddr());
+		k_printf("Page fault occurred by read of address 0x%X\n", HalGetFaultingAddr());
 	}
 
-	k_printf("EIP=%x \tESP=%x \t*(ESP)=%x\n", regs.eip, regs.esp, *((uint32_t*)(regs.esp)));
+	k_printf("EIP=0x%X \tESP=0x%X \t*(ESP)=0x%X\n", regs.eip, regs.esp, *((uint32_t*)(regs.esp)));
 	k_printf("Present: %d \tWrite\\read: %d \tUser\\kernel: %d \tInstr.fetch: %d\n\n",
 					regs.err_code & 0x1 ? 1 : 0,
 					regs.err_code & 0x2 ? 1 : 0,
@@ -647,6 +665,100 @@ HRESULT	vmm_get_region_count(void *proc_desc, size_t *cnt)
 }
 
 HRESULT __nxapi vmm_map_region(void *proc_desc, uintptr_t phys_addr, uintptr_t virt_addr, size_t size, K_VMM_REGION_USAGE usage, K_VMM_ACCESS_FLAG access, uint8_t commit)
+{
+	return vmm_map_frames(proc_desc, phys_addr, NULL, virt_addr, size, usage, access, commit);
+}
+
+HRESULT __nxapi vmm_map_pages(void *proc_desc, const uintptr_t *frames, uint32_t count, uintptr_t virt_addr, K_VMM_REGION_USAGE usage, K_VMM_ACCESS_FLAG access, uint8_t commit)
+{
+	if (frames == NULL || count == 0) {
+		return E_INVALIDARG;
+	}
+
+	/* Region doesn't own the frames, so it can't free them */
+	if (usage & USAGE_AUTOFREE) {
+		return E_INVALIDARG;
+	}
+
+	return vmm_map_frames(proc_desc, frames[0], frames, virt_addr, count * VM_PAGE_FRAME_SIZE, usage, access, commit);
+}
+
+HRESULT __nxapi vmm_set_page(void *proc_desc, uintptr_t virt_addr, uintptr_t phys_addr, K_VMM_ACCESS_FLAG access, uint8_t commit)
+{
+	K_PROCESS 			*proc = proc_desc;
+	K_VMM_PAGE_TABLE	*table;
+	K_VMM_PAGE_ENTRY	*p;
+	HRESULT				hr;
+
+	if (proc_desc == NULL) {
+		hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	if (virt_addr % VM_PAGE_FRAME_SIZE != 0 || phys_addr % VM_PAGE_FRAME_SIZE != 0) {
+		return E_INVALIDARG;
+	}
+
+	hr = fetch_page_table(proc->page_dir, (virt_addr / 0x1000) / 1024, 0, 0, 0, &table);
+	if (FAILED(hr)) return hr;
+
+	p = &table->pages[(virt_addr / 0x1000) % 1024];
+
+	/* Only pages of already mapped regions can be replaced */
+	if (!p->f_present) {
+		return E_INVALIDARG;
+	}
+
+	p->frame_addr = phys_addr >> 12;
+	p->f_writable = access == ACCESS_READWRITE;
+
+	if (commit) {
+		HalInvalidatePage((void*)virt_addr);
+	}
+
+	return S_OK;
+}
+
+HRESULT __nxapi vmm_virt_to_phys(void *proc_desc, uintptr_t virt_addr, uintptr_t *phys_addr)
+{
+	K_PROCESS 			*proc = proc_desc;
+	K_VMM_PAGE_TABLE	*table;
+	K_VMM_PAGE_ENTRY	*p;
+	HRESULT				hr;
+
+	if (proc_desc == NULL) {
+		hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	hr = fetch_page_table(proc->page_dir, (virt_addr / 0x1000) / 1024, 0, 0, 0, &table);
+	if (FAILED(hr)) return E_NOTFOUND;
+
+	p = &table->pages[(virt_addr / 0x1000) % 1024];
+
+	if (!p->f_present) {
+		return E_NOTFOUND;
+	}
+
+	*phys_addr = (p->frame_addr << 12) | (virt_addr & 0xFFF);
+	return S_OK;
+}
+
+HRESULT __nxapi vmm_register_fault_handler(K_VMM_FAULT_HANDLER handler)
+{
+	if (fault_handler_cnt == VMM_MAX_FAULT_HANDLERS) {
+		return E_OUTOFMEM;
+	}
+
+	fault_handlers[fault_handler_cnt++] = handler;
+	return S_OK;
+}
+
+/*
+ * Maps a region. If `frames` is NULL the region is physically contiguous and
+ * starts at `phys_addr`, otherwise `frames` holds the address of each page.
+ */
+static HRESULT vmm_map_frames(void *proc_desc, uintptr_t phys_addr, const uintptr_t *frames, uintptr_t virt_addr, size_t size, K_VMM_REGION_USAGE usage, K_VMM_ACCESS_FLAG access, uint8_t commit)
 {
 	/* We don't allocate physical memory here (it's job of kpmm_* subsystem). We don't care
 	 * if this physical region is free or not.
@@ -673,7 +785,7 @@ HRESULT __nxapi vmm_map_region(void *proc_desc, uintptr_t phys_addr, uintptr_t v
 
 	/* Assert physical address starts at 4kb aligned address */
 	if (phys_addr % 0x1000 != 0) {
-		k_printf("phys_addr=%x  virt_addr=%x\n", phys_addr, virt_addr);
+		k_printf("phys_addr=0x%X  virt_addr=0x%X\n", phys_addr, virt_addr);
 		HalKernelPanic("Physical address must be aligned at 4KiB.");
 	}
 
@@ -681,6 +793,14 @@ HRESULT __nxapi vmm_map_region(void *proc_desc, uintptr_t phys_addr, uintptr_t v
 	uint_ptr_t range_start = virt_addr;
 	uint_ptr_t range_end = virt_addr + size;
 
+	if (frames != NULL) {
+		for (i=0; i<size / VM_PAGE_FRAME_SIZE; i++) {
+			if (frames[i] % 0x1000 != 0) {
+				HalKernelPanic("Physical address must be aligned at 4KiB.");
+			}
+		}
+	}
+
 	/* Iterate all memory regions to check if requested region
 	 * overlaps with other, already mapped, regions
 	 */
@@ -729,7 +849,7 @@ HRESULT __nxapi vmm_map_region(void *proc_desc, uintptr_t phys_addr, uintptr_t v
 
 		/* Populate page entry */
 		memset(p, 0, sizeof(K_VMM_PAGE_ENTRY));
-		p->frame_addr = phys_addr_idx >> 12;
+		p->frame_addr = (frames != NULL ? frames[i] : phys_addr_idx) >> 12;
 		p->f_user = f_us;
 		p->f_writable = f_rw;
 		p->f_present = 1;
@@ -837,7 +957,7 @@ HRESULT __nxapi vmm_alloc_and_map_limited(void *proc_desc, uintptr_t virt_addr,
 	if (proc == NULL) {
 		/* Fetch kernel process desc */
 		hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
-		//vga_printf("sched_get_proc(): hr=%x. proc=%x\n", hr, proc->name);
+		//vga_printf("sched_get_proc(): hr=0x%X. proc=0x%X\n", hr, proc->name);
 		if (FAILED(hr)) return hr;
 	}
 
@@ -929,6 +1049,12 @@ HRESULT __nxapi vmm_temp_map_region(void *proc_desc, uintptr_t phys_addr, uint32
 	K_PROCESS *proc = proc_desc;
 	uint32_t addr;
 
+	if (proc_desc == NULL) {
+		/* Fetch kernel process desc */
+		HRESULT hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
+		if (FAILED(hr)) return hr;
+	}
+
 	//TODO: Should we lock??
 
 	for (addr=KERNEL_TEMP_START; addr<(0xFFFFFFFF-region_size); addr+=KPMM_BLOCK_SIZE) {
@@ -939,7 +1065,7 @@ HRESULT __nxapi vmm_temp_map_region(void *proc_desc, uintptr_t phys_addr, uint32
 		for (uint32_t i=0; i<proc->region_count; i++) {
 			K_VMM_REGION *r = &proc->regions[i];
 
-			//k_printf("region (va=%x, pa=%x, size=%x)\n", r->virt_addr, r->phys_addr, r->region_size);
+			//k_printf("region (va=0x%X, pa=0x%X, size=0x%X)\n", r->virt_addr, r->phys_addr, r->region_size);
 
 			uint8_t overlap =
 				((r->virt_addr >= range_start && r->virt_addr < range_end) ||
@@ -955,14 +1081,14 @@ HRESULT __nxapi vmm_temp_map_region(void *proc_desc, uintptr_t phys_addr, uint32
 			}
 		}
 
-		//k_printf("testing range[%x..%x]: %s\n", addr, addr+region_size, avail ? "available" : "not available");
+		//k_printf("testing range[0x%X..0x%X]: %s\n", addr, addr+region_size, avail ? "available" : "not available");
 
 		if (!avail) {
 			continue;
 		}
 
 		/* Available */
-		HRESULT hr = vmm_map_region(proc_desc, phys_addr, addr, region_size, USAGE_TEMP, ACCESS_READWRITE, 1);
+		HRESULT hr = vmm_map_region(proc, phys_addr, addr, region_size, USAGE_TEMP, ACCESS_READWRITE, 1);
 		if (FAILED(hr)) return hr;
 
 		/* Assign output parameter */
@@ -993,3 +1119,67 @@ HRESULT __nxapi vmm_get_region_phys_addr(void *proc_desc, uintptr_t virt_addr, u
 
 	return E_NOTFOUND;
 }
+
+HRESULT __nxapi vmm_find_free_range(void *proc_desc, uintptr_t start, uintptr_t limit, size_t size, uintptr_t *virt_addr)
+{
+	K_PROCESS 	*proc = proc_desc;
+	uintptr_t	addr;
+	HRESULT		hr;
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	if (size == 0 || size % VM_PAGE_FRAME_SIZE != 0 || start % VM_PAGE_FRAME_SIZE != 0) {
+		return E_INVALIDARG;
+	}
+
+	addr = start;
+
+	while (addr < limit && limit - addr >= size) {
+		uintptr_t	range_start = addr, range_end = addr + size;
+		BOOL		avail = TRUE;
+
+		for (uint32_t i=0; i<proc->region_count; i++) {
+			K_VMM_REGION *r = &proc->regions[i];
+
+			if (r->virt_addr < range_end && r->virt_addr + r->region_size > range_start) {
+				/* Overlaps, so skip past this region */
+				addr = r->virt_addr + r->region_size;
+				avail = FALSE;
+				break;
+			}
+		}
+
+		if (avail) {
+			*virt_addr = addr;
+			return S_OK;
+		}
+	}
+
+	return E_OUTOFMEM;
+}
+
+HRESULT __nxapi vmm_detach_region(void *proc_desc, uintptr_t virt_addr, K_VMM_REGION *out, int commit)
+{
+	K_PROCESS 	*proc = proc_desc;
+	HRESULT		hr;
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, (K_PROCESS**)&proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	for (uint32_t i=0; i<proc->region_count; i++) {
+		if (proc->regions[i].virt_addr == virt_addr) {
+			/* Strip AUTOFREE, so the frames survive unmapping */
+			*out = proc->regions[i];
+			proc->regions[i].usage &= ~USAGE_AUTOFREE;
+
+			return vmm_unmap_region(proc, virt_addr, commit);
+		}
+	}
+
+	return E_NOTFOUND;
+}
@@ -0,0 +1,594 @@
+/*
+ * msgport.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "msgport.h"
+#include "shm.h"
+#include "pipe.h"
+#include "mm.h"
+#include "mm_phys.h"
+#include "mm_virt.h"
+#include "scheduler.h"
+#include "hal.h"
+#include "timer.h"
+#include "kstdio.h"
+#include "string.h"
+
+/* Table of named ports */
+static K_MSG_PORT	*ports[PORT_MAX_PORTS];
+static K_SPINLOCK	ports_lock;
+
+/*
+ * Prototypes
+ */
+static K_MSG_PORT *port_find(char *name);
+static HRESULT port_release(K_MSG_PORT *port);
+static BOOL port_unlink_message(K_MSG_PORT *port, K_MESSAGE *msg);
+static BOOL port_owns_buffer(K_PROCESS *proc, uintptr_t va, size_t size);
+
+HRESULT __nxapi port_initialize()
+{
+	memset(ports, 0, sizeof(ports));
+	spinlock_create(&ports_lock);
+
+	return S_OK;
+}
+
+/*
+ * Must be called with ports_lock held.
+ */
+static K_MSG_PORT *port_find(char *name)
+{
+	for (uint32_t i=0; i<PORT_MAX_PORTS; i++) {
+		if (ports[i] && strcmp(ports[i]->name, name) == 0) {
+			return ports[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Drops a reference and destroys the port when it was the last one.
+ * Senders hold a reference while their message is in flight, so the
+ * queue is guaranteed to be empty at that point. Must be called with
+ * ports_lock held.
+ */
+static HRESULT port_release(K_MSG_PORT *port)
+{
+	if (port->ref_count == 0) {
+		HalKernelPanic("port_release(): reference count underflow.");
+	}
+
+	if (--port->ref_count > 0) {
+		return S_OK;
+	}
+
+	for (uint32_t i=0; i<PORT_MAX_PORTS; i++) {
+		if (ports[i] == port) {
+			ports[i] = NULL;
+			break;
+		}
+	}
+
+	event_destroy(&port->msg_event);
+	spinlock_destroy(&port->lock);
+	kfree(port);
+
+	return S_OK;
+}
+
+HRESULT __nxapi port_create(char *name, K_MSG_PORT **out)
+{
+	K_MSG_PORT	*port = NULL;
+	uint32_t	slot, intf;
+	HRESULT		hr = S_OK;
+
+	if (!name || !out) {
+		return E_POINTER;
+	}
+
+	if (strlen(name) == 0 || strlen(name) >= PORT_MAX_NAME_LENGTH) {
+		return E_INVALIDARG;
+	}
+
+	intf = spinlock_acquire(&ports_lock);
+
+	if (port_find(name) != NULL) {
+		hr = E_ACCESSDENIED;
+		goto finally;
+	}
+
+	for (slot=0; slot<PORT_MAX_PORTS; slot++) {
+		if (ports[slot] == NULL) break;
+	}
+
+	if (slot == PORT_MAX_PORTS) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	if (!(port = kcalloc(sizeof(K_MSG_PORT)))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	strcpy(port->name, name);
+	port->ref_count = 1;
+
+	event_create(&port->msg_event, EVENT_FLAG_NONE);
+	spinlock_create(&port->lock);
+
+	ports[slot] = port;
+	*out = port;
+
+finally:
+	spinlock_release(&ports_lock, intf);
+	return hr;
+}
+
+HRESULT __nxapi port_open(char *name, K_MSG_PORT **out)
+{
+	K_MSG_PORT	*port;
+	uint32_t	intf;
+
+	if (!name || !out) {
+		return E_POINTER;
+	}
+
+	intf = spinlock_acquire(&ports_lock);
+
+	if ((port = port_find(name)) != NULL) {
+		port->ref_count++;
+	}
+
+	spinlock_release(&ports_lock, intf);
+
+	if (!port) {
+		return E_NOTFOUND;
+	}
+
+	*out = port;
+	return S_OK;
+}
+
+HRESULT __nxapi port_close(K_MSG_PORT **port)
+{
+	uint32_t	intf;
+	HRESULT		hr;
+
+	if (!port || !*port) {
+		return E_POINTER;
+	}
+
+	intf = spinlock_acquire(&ports_lock);
+	hr = port_release(*port);
+	spinlock_release(&ports_lock, intf);
+
+	*port = NULL;
+	return hr;
+}
+
+/*
+ * Removes a message from the queue, if it is still there.
+ * Must be called with port->lock held.
+ */
+static BOOL port_unlink_message(K_MSG_PORT *port, K_MESSAGE *msg)
+{
+	K_MESSAGE *prev = NULL, *m = port->head;
+
+	while (m && m != msg) {
+		prev = m;
+		m = m->next;
+	}
+
+	if (!m) {
+		return FALSE;
+	}
+
+	if (prev) prev->next = m->next;
+	else port->head = m->next;
+
+	if (port->tail == m) {
+		port->tail = prev;
+	}
+
+	if (--port->queue_len == 0) {
+		event_reset(&port->msg_event);
+	}
+
+	return TRUE;
+}
+
+/*
+ * Checks that _va_ starts a region which port_alloc_buffer() or port_receive()
+ * mapped: it lies in the IPC window and owns its frames. Heap, stack and
+ * shared memory mappings can't be handed over, since the receiver frees the
+ * frames when it unmaps them.
+ */
+static BOOL port_owns_buffer(K_PROCESS *proc, uintptr_t va, size_t size)
+{
+	K_VMM_REGION	r;
+	size_t			cnt, i;
+	uintptr_t		start, end;
+
+	if (proc->mode == PROCESS_MODE_KERNEL) {
+		start	= KERNEL_IPC_START;
+		end		= KERNEL_IPC_END;
+	} else {
+		start	= USER_IPC_START;
+		end		= USER_IPC_END;
+	}
+
+	vmm_get_region_count(proc, &cnt);
+
+	for (i=0; i<cnt; i++) {
+		if (FAILED(vmm_get_region(proc, i, &r)) || r.virt_addr != va) {
+			continue;
+		}
+
+		return (r.usage & USAGE_AUTOFREE) &&
+			!(r.usage & (USAGE_HEAP | USAGE_STACK | USAGE_TEMP | USAGE_CODE)) &&
+			r.virt_addr >= start && r.virt_addr + r.region_size <= end &&
+			r.region_size >= size;
+	}
+
+	return FALSE;
+}
+
+HRESULT __nxapi port_send(K_MSG_PORT *port, void *buffer, size_t size, uint32_t timeout)
+{
+	K_MESSAGE		msg;
+	K_VMM_REGION	region;
+	K_PROCESS		*proc;
+	uint32_t		intf;
+	HRESULT			hr;
+
+	if (!port || !buffer) {
+		return E_POINTER;
+	}
+
+	if (size == 0) {
+		return E_INVALIDARG;
+	}
+
+	hr = sched_get_current_proc(&proc);
+	if (FAILED(hr)) return hr;
+
+	memset(&msg, 0, sizeof(K_MESSAGE));
+	msg.size = size;
+	sched_get_current_pid(&msg.sender_pid);
+
+	if (size <= PORT_INLINE_MAX) {
+		/* Small message - copy it */
+		if (!(msg.data = kmalloc(size))) {
+			return E_OUTOFMEM;
+		}
+
+		memcpy(msg.data, buffer, size);
+		msg.flags = MSG_FLAG_INLINE;
+	} else {
+		/* Large message - take the pages away from the sender */
+		if (!port_owns_buffer(proc, (uintptr_t)buffer, size)) {
+			return E_INVALIDARG;
+		}
+
+		hr = vmm_detach_region(proc, (uintptr_t)buffer, &region, TRUE);
+		if (FAILED(hr)) return E_INVALIDARG;
+
+		msg.phys_addr	= region.phys_addr;
+		msg.region_size	= region.region_size;
+		msg.flags		= MSG_FLAG_PAGES;
+	}
+
+	event_create(&msg.delivered, EVENT_FLAG_NONE);
+
+	/* Hold a reference on the port while the message is in flight */
+	intf = spinlock_acquire(&ports_lock);
+	port->ref_count++;
+	spinlock_release(&ports_lock, intf);
+
+	/* Enqueue */
+	intf = spinlock_acquire(&port->lock);
+
+	if (port->tail) port->tail->next = &msg;
+	else port->head = &msg;
+
+	port->tail = &msg;
+	port->queue_len++;
+
+	event_signal(&port->msg_event);
+	spinlock_release(&port->lock, intf);
+
+	/* Wait for delivery */
+	hr = event_waitfor(&msg.delivered, timeout);
+
+	if (hr == E_TIMEDOUT) {
+		BOOL withdrawn;
+
+		intf = spinlock_acquire(&port->lock);
+		withdrawn = port_unlink_message(port, &msg);
+		spinlock_release(&port->lock, intf);
+
+		if (withdrawn) {
+			/* Give the pages back to the sender */
+			if (msg.flags == MSG_FLAG_PAGES) {
+				vmm_map_region(proc, region.phys_addr, region.virt_addr, region.region_size, region.usage, region.access, TRUE);
+			}
+		} else {
+			/* A receiver has just taken it, so wait for it to finish */
+			hr = event_waitfor(&msg.delivered, TIMEOUT_INFINITE);
+		}
+	}
+
+	if (msg.data) {
+		kfree(msg.data);
+	}
+
+	event_destroy(&msg.delivered);
+
+	intf = spinlock_acquire(&ports_lock);
+	port_release(port);
+	spinlock_release(&ports_lock, intf);
+
+	return hr;
+}
+
+HRESULT __nxapi port_receive(K_MSG_PORT *port, K_PORT_RECV *r, uint32_t timeout)
+{
+	K_MESSAGE	*msg;
+	K_PROCESS	*proc;
+	uint32_t	start_time = timer_gettickcount();
+	uint32_t	remaining = timeout;
+	uint32_t	intf;
+	uintptr_t	va;
+	HRESULT		hr;
+
+	if (!port || !r) {
+		return E_POINTER;
+	}
+
+	hr = sched_get_current_proc(&proc);
+	if (FAILED(hr)) return hr;
+
+	while (TRUE) {
+		if (timeout != TIMEOUT_INFINITE) {
+			uint32_t elapsed = timer_gettickcount() - start_time;
+			remaining = elapsed >= timeout ? 0 : timeout - elapsed;
+		}
+
+		hr = event_waitfor(&port->msg_event, remaining);
+		if (FAILED(hr)) return hr;
+
+		intf = spinlock_acquire(&port->lock);
+
+		if ((msg = port->head) == NULL) {
+			/* Someone else was faster */
+			spinlock_release(&port->lock, intf);
+			continue;
+		}
+
+		if (msg->flags == MSG_FLAG_INLINE && msg->size > r->buffer_size) {
+			spinlock_release(&port->lock, intf);
+			r->size = msg->size;
+
+			return E_BUFFEROVERFLOW;
+		}
+
+		port_unlink_message(port, msg);
+		spinlock_release(&port->lock, intf);
+		break;
+	}
+
+	r->size			= msg->size;
+	r->flags		= msg->flags;
+	r->sender_pid	= msg->sender_pid;
+	r->pages		= NULL;
+
+	if (msg->flags == MSG_FLAG_INLINE) {
+		memcpy(r->buffer, msg->data, msg->size);
+	} else {
+		/* Receiver becomes the owner of the frames */
+		hr = shm_find_map_address(proc, msg->region_size, &va);
+
+		if (SUCCEEDED(hr)) {
+			hr = vmm_map_region(proc, msg->phys_addr, va, msg->region_size,
+					(proc->mode == PROCESS_MODE_KERNEL ? USAGE_KERNEL : USAGE_USER) | USAGE_DATA | USAGE_AUTOFREE,
+					ACCESS_READWRITE, TRUE);
+		}
+
+		if (SUCCEEDED(hr)) {
+			r->pages = (void*)va;
+		} else {
+			/* Nobody owns the frames anymore */
+			kpmm_unmark_blocks((void*)msg->phys_addr, msg->region_size / KPMM_BLOCK_SIZE);
+		}
+	}
+
+	/* Sender may return right after this, so don't touch _msg_ anymore */
+	event_signal(&msg->delivered);
+
+	return hr;
+}
+
+HRESULT __nxapi port_alloc_buffer(size_t size, void **out)
+{
+	K_PROCESS	*proc;
+	uintptr_t	va;
+	HRESULT		hr;
+
+	if (!out) {
+		return E_POINTER;
+	}
+
+	if (size == 0) {
+		return E_INVALIDARG;
+	}
+
+	size = (size + VM_PAGE_FRAME_SIZE - 1) & ~(VM_PAGE_FRAME_SIZE - 1);
+
+	hr = sched_get_current_proc(&proc);
+	if (FAILED(hr)) return hr;
+
+	hr = shm_find_map_address(proc, size, &va);
+	if (FAILED(hr)) return hr;
+
+	hr = vmm_alloc_and_map(proc, va, size, (proc->mode == PROCESS_MODE_KERNEL ? USAGE_KERNEL : USAGE_USER) | USAGE_DATA, ACCESS_READWRITE, TRUE);
+	if (FAILED(hr)) return hr;
+
+	*out = (void*)va;
+	return S_OK;
+}
+
+HRESULT __nxapi port_free_buffer(void *buffer)
+{
+	K_PROCESS	*proc;
+	HRESULT		hr;
+
+	hr = sched_get_current_proc(&proc);
+	if (FAILED(hr)) return hr;
+
+	return vmm_unmap_region(proc, (uintptr_t)buffer, TRUE);
+}
+
+/*
+ * Benchmark
+ */
+#define IPC_BENCH_BYTES			(4 * 1024 * 1024)
+#define IPC_BENCH_MIN_ITER		16
+#define IPC_BENCH_PIPE_CHUNK	0x8000
+
+static K_MSG_PORT	*ipc_bench_port;
+static uint8_t		ipc_bench_inline_buf[PORT_INLINE_MAX];
+
+/*
+ * Receiving side of the benchmark. It runs for the lifetime of the kernel.
+ */
+static void __nxapi ipc_bench_receiver()
+{
+	K_PORT_RECV r;
+
+	while (TRUE) {
+		r.buffer		= ipc_bench_inline_buf;
+		r.buffer_size	= sizeof(ipc_bench_inline_buf);
+
+		if (FAILED(port_receive(ipc_bench_port, &r, TIMEOUT_INFINITE))) {
+			continue;
+		}
+
+		if (r.pages) {
+			port_free_buffer(r.pages);
+		}
+	}
+}
+
+static uint32_t ipc_bench_rate(uint32_t size, uint32_t iter, uint32_t ms)
+{
+	/* KiB per second */
+	return ms == 0 ? 0 : (size * iter / 1024) * 1000 / ms;
+}
+
+HRESULT __nxapi ipc_benchmark()
+{
+	static const uint32_t sizes[] = {64, 256, 1024, 4096, 16384, 65536, 262144, 1048576, 0};
+	static BOOL initialized = FALSE;
+	K_STREAM	*pipe_w = NULL, *pipe_r = NULL;
+	uint8_t		*src = NULL, *dst = NULL;
+	uint32_t	i, j, iter, t, pipe_ms, port_ms;
+	size_t		bytes;
+	void		*buf;
+	HRESULT		hr;
+
+	if (!initialized) {
+		hr = pipe_create("ipcbench", PIPE_FLAG_NONE, 2 * IPC_BENCH_PIPE_CHUNK);
+		if (FAILED(hr)) return hr;
+
+		hr = port_create("ipcbench", &ipc_bench_port);
+		if (FAILED(hr)) return hr;
+
+		hr = sched_create_thread(NULL, ipc_bench_receiver, NULL);
+		if (FAILED(hr)) return hr;
+
+		initialized = TRUE;
+	}
+
+	src = kmalloc(IPC_BENCH_PIPE_CHUNK);
+	dst = kmalloc(IPC_BENCH_PIPE_CHUNK);
+
+	if (!src || !dst) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	memset(src, 0xA5, IPC_BENCH_PIPE_CHUNK);
+
+	hr = k_fopen("/ipc/ipcbench", FILE_OPEN_WRITE, &pipe_w);
+	if (FAILED(hr)) goto finally;
+
+	hr = k_fopen("/ipc/ipcbench", FILE_OPEN_READ, &pipe_r);
+	if (FAILED(hr)) goto finally;
+
+	k_printf("size      pipe KiB/s   port KiB/s\n");
+
+	for (i=0; sizes[i] != 0; i++) {
+		uint32_t size = sizes[i];
+
+		iter = IPC_BENCH_BYTES / size;
+		if (iter < IPC_BENCH_MIN_ITER) iter = IPC_BENCH_MIN_ITER;
+
+		/* Pipe: every byte is copied into and out of the ring buffer */
+		t = timer_gettickcount();
+
+		for (j=0; j<iter; j++) {
+			uint32_t off, chunk;
+
+			for (off=0; off<size; off+=chunk) {
+				chunk = size - off > IPC_BENCH_PIPE_CHUNK ? IPC_BENCH_PIPE_CHUNK : size - off;
+
+				hr = k_fwrite(pipe_w, chunk, src, &bytes);
+				if (FAILED(hr)) goto finally;
+
+				hr = k_fread(pipe_r, chunk, dst, &bytes);
+				if (FAILED(hr)) goto finally;
+			}
+		}
+
+		pipe_ms = timer_gettickcount() - t;
+
+		/* Port: inline copy for small payloads, page transfer for large ones */
+		t = timer_gettickcount();
+
+		for (j=0; j<iter; j++) {
+			if (size <= PORT_INLINE_MAX) {
+				hr = port_send(ipc_bench_port, src, size, TIMEOUT_INFINITE);
+			} else {
+				hr = port_alloc_buffer(size, &buf);
+				if (FAILED(hr)) goto finally;
+
+				/* Touch the payload, as a real producer would */
+				*(uint32_t*)buf = j;
+
+				hr = port_send(ipc_bench_port, buf, size, TIMEOUT_INFINITE);
+			}
+
+			if (FAILED(hr)) goto finally;
+		}
+
+		port_ms = timer_gettickcount() - t;
+
+		k_printf("%d   %d   %d\n", size, ipc_bench_rate(size, iter, pipe_ms), ipc_bench_rate(size, iter, port_ms));
+	}
+
+	hr = S_OK;
+
+finally:
+	if (pipe_w) k_fclose(&pipe_w);
+	if (pipe_r) k_fclose(&pipe_r);
+	if (src) kfree(src);
+	if (dst) kfree(dst);
+
+	return hr;
+}
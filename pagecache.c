@@ -0,0 +1,1445 @@
+/*
+ * pagecache.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "pagecache.h"
+#include "mm_virt.h"
+#include "mm_phys.h"
+#include "shm.h"
+#include "vfs.h"
+#include "syncobjs.h"
+#include "scheduler.h"
+#include "kstdio.h"
+#include "timer.h"
+#include "string.h"
+#include "mm.h"
+#include "hal.h"
+
+#define PAGECACHE_PAGE_MASK		(PAGECACHE_PAGE_SIZE - 1)
+#define PAGECACHE_RADIX_MASK	(PAGECACHE_RADIX_SLOTS - 1)
+
+/* Enough levels for 32-bit page indexes */
+#define PAGECACHE_MAX_HEIGHT	6
+
+/* Longest run of pages read with one fill call */
+#define PAGECACHE_MAX_RUN		(PAGECACHE_RA_MAX / PAGECACHE_PAGE_SIZE)
+
+#define PAGECACHE_RA_DEPTH		16
+
+/* Page fault error code bits */
+#define PF_PRESENT				0x01
+#define PF_WRITE				0x02
+
+static K_PAGE				pagecache_pages[PAGECACHE_POOL_PAGES];
+static K_PAGECACHE_INODE	pagecache_inodes[PAGECACHE_MAX_INODES];
+static K_PAGECACHE_MAPPING	pagecache_mappings[PAGECACHE_MAX_MAPPINGS];
+static K_PAGE				*pagecache_free;
+static K_PAGE				*pagecache_lru_head;
+static K_PAGE				*pagecache_lru_tail;
+static K_PAGECACHE_STATS	pagecache_stats;
+
+/* Target of multi-page fills, guarded by the cache lock */
+static uint8_t				*pagecache_bounce;
+
+/* Served by a worker thread, which performs read-ahead */
+static K_IO_QUEUE			pagecache_ra_queue;
+static volatile BOOL		pagecache_ra_enabled = TRUE;
+
+/* Guards pages, inodes and radix trees */
+static K_MUTEX				pagecache_lock;
+
+/* Guards the mapping table, which is also accessed by the fault handler */
+static K_SPINLOCK			pagecache_map_lock;
+static volatile BOOL		pagecache_ready = FALSE;
+
+/*
+ * Prototypes
+ */
+static K_PAGE *radix_lookup(K_PAGECACHE_INODE *inode, uint32_t index);
+static HRESULT radix_insert(K_PAGECACHE_INODE *inode, uint32_t index, K_PAGE *page);
+static void radix_delete(K_PAGECACHE_INODE *inode, uint32_t index);
+static void pagecache_lru_unlink(K_PAGE *page);
+static void pagecache_lru_push(K_PAGE *page);
+static K_PAGE *pagecache_alloc_page();
+static void pagecache_drop_page(K_PAGE *page);
+static void pagecache_drop_inode_pages(K_PAGECACHE_INODE *inode);
+static HRESULT pagecache_fill_run(K_PAGECACHE_INODE *inode, K_STREAM *s, uint32_t index, uint32_t count, uint32_t *filled);
+static K_PAGE *pagecache_get_page(K_PAGECACHE_INODE *inode, K_STREAM *s, uint32_t index, uint32_t count, HRESULT *hr);
+static void pagecache_ra_start(K_READAHEAD *ra, K_STREAM *s);
+static HRESULT __nxapi pagecache_ra_service(K_IO_QUEUE *q, K_IO_REQUEST *req);
+static HRESULT pagecache_fault(uintptr_t addr, uint32_t err_code);
+
+HRESULT __nxapi pagecache_initialize()
+{
+	void		*phys;
+	uintptr_t	va;
+	uint32_t	i;
+	HRESULT		hr;
+
+	memset(pagecache_pages, 0, sizeof(pagecache_pages));
+	memset(pagecache_inodes, 0, sizeof(pagecache_inodes));
+	memset(pagecache_mappings, 0, sizeof(pagecache_mappings));
+	memset(&pagecache_stats, 0, sizeof(pagecache_stats));
+
+	if (!(pagecache_bounce = kmalloc(PAGECACHE_RA_MAX))) {
+		return E_OUTOFMEM;
+	}
+
+	/* Pool frames are owned by the cache for the lifetime of the kernel */
+	hr = kpmm_alloc(PAGECACHE_POOL_PAGES, &phys);
+	if (FAILED(hr)) return hr;
+
+	hr = shm_find_map_address(NULL, PAGECACHE_POOL_PAGES * PAGECACHE_PAGE_SIZE, &va);
+	if (FAILED(hr)) goto fail;
+
+	hr = vmm_map_region(NULL, (uintptr_t)phys, va, PAGECACHE_POOL_PAGES * PAGECACHE_PAGE_SIZE,
+			USAGE_KERNEL | USAGE_DATA, ACCESS_READWRITE, TRUE);
+	if (FAILED(hr)) goto fail;
+
+	/* All pages start on the free list */
+	pagecache_free = NULL;
+	pagecache_lru_head = pagecache_lru_tail = NULL;
+
+	for (i=PAGECACHE_POOL_PAGES; i>0; i--) {
+		K_PAGE *page = &pagecache_pages[i-1];
+
+		page->phys = (uintptr_t)phys + (i-1) * PAGECACHE_PAGE_SIZE;
+		page->data = (uint8_t*)(va + (i-1) * PAGECACHE_PAGE_SIZE);
+		page->lru_next = pagecache_free;
+		pagecache_free = page;
+	}
+
+	mutex_create(&pagecache_lock);
+	spinlock_create(&pagecache_map_lock);
+
+	hr = vmm_register_fault_handler(pagecache_fault);
+	if (FAILED(hr)) return hr;
+
+	hr = aio_queue_create(&pagecache_ra_queue, PAGECACHE_RA_DEPTH, pagecache_ra_service, NULL, 1);
+	if (FAILED(hr)) return hr;
+
+	pagecache_ready = TRUE;
+	return S_OK;
+
+fail:
+	kpmm_unmark_blocks(phys, PAGECACHE_POOL_PAGES);
+	return hr;
+}
+
+HRESULT __nxapi pagecache_open_inode(void *owner, uint64_t id, uint64_t size, K_PAGECACHE_FILL fill, K_PAGECACHE_INODE **out)
+{
+	K_PAGECACHE_INODE	*inode = NULL, *unused = NULL;
+	uint32_t			i;
+	HRESULT				hr = S_OK;
+
+	if (!pagecache_ready) {
+		return E_FAIL;
+	}
+
+	if (owner == NULL || fill == NULL || out == NULL) {
+		return E_POINTER;
+	}
+
+	mutex_lock(&pagecache_lock);
+
+	for (i=0; i<PAGECACHE_MAX_INODES; i++) {
+		K_PAGECACHE_INODE *n = &pagecache_inodes[i];
+
+		if (n->owner == owner && n->id == id) {
+			inode = n;
+			break;
+		}
+
+		/* Prefer a free slot, otherwise recycle an unreferenced inode */
+		if (n->owner == NULL) {
+			if (unused == NULL || unused->owner != NULL) unused = n;
+		} else if (n->ref_count == 0 && unused == NULL) {
+			unused = n;
+		}
+	}
+
+	if (inode != NULL) {
+		if (inode->size != size) {
+			/* File has changed behind our back */
+			pagecache_drop_inode_pages(inode);
+			inode->size = size;
+		}
+	} else {
+		if (unused == NULL) {
+			hr = E_OUTOFMEM;
+			goto finally;
+		}
+
+		inode = unused;
+
+		if (inode->owner != NULL) {
+			pagecache_drop_inode_pages(inode);
+			pagecache_stats.inodes--;
+		}
+
+		/* Tree is empty at this point */
+		inode->owner	= owner;
+		inode->id		= id;
+		inode->size		= size;
+		inode->fill		= fill;
+		inode->root		= NULL;
+		inode->height	= 0;
+
+		pagecache_stats.inodes++;
+	}
+
+	inode->ref_count++;
+	*out = inode;
+
+finally:
+	mutex_unlock(&pagecache_lock);
+	return hr;
+}
+
+VOID __nxapi pagecache_close_inode(K_PAGECACHE_INODE *inode)
+{
+	mutex_lock(&pagecache_lock);
+
+	assert_msg(inode->ref_count > 0, "pagecache_close_inode(): inode is not referenced.");
+	inode->ref_count--;
+
+	mutex_unlock(&pagecache_lock);
+}
+
+HRESULT __nxapi pagecache_read(K_PAGECACHE_INODE *inode, K_STREAM *s, uint64_t offset, size_t size, void *buffer, size_t *bytes_read)
+{
+	uint8_t		*dst = buffer;
+	size_t		done = 0;
+	HRESULT		hr = S_OK;
+
+	if (bytes_read) *bytes_read = 0;
+
+	mutex_lock(&pagecache_lock);
+
+	if (offset >= inode->size) {
+		mutex_unlock(&pagecache_lock);
+		return E_ENDOFSTR;
+	}
+
+	if (offset + size > inode->size) {
+		size = inode->size - offset;
+	}
+
+	while (done < size) {
+		uint64_t	pos = offset + done;
+		uint32_t	in_page = pos & PAGECACHE_PAGE_MASK;
+		uint32_t	index = (uint32_t)(pos >> PAGECACHE_PAGE_SHIFT);
+		size_t		n = PAGECACHE_PAGE_SIZE - in_page;
+		K_PAGE		*page;
+
+		if (n > size - done) n = size - done;
+
+		/* A miss reads the missing part of the request in one go */
+		page = pagecache_get_page(inode, s, index, (uint32_t)((offset + size - 1) >> PAGECACHE_PAGE_SHIFT) - index + 1, &hr);
+		if (page == NULL) break;
+
+		memcpy(dst + done, page->data + in_page, n);
+		done += n;
+	}
+
+	mutex_unlock(&pagecache_lock);
+
+	if (bytes_read) *bytes_read = done;
+	return done > 0 ? S_OK : hr;
+}
+
+VOID __nxapi pagecache_update(K_PAGECACHE_INODE *inode, uint64_t offset, size_t size, const void *buffer)
+{
+	const uint8_t	*src = buffer;
+	size_t			done = 0;
+
+	mutex_lock(&pagecache_lock);
+
+	while (done < size) {
+		uint64_t	pos = offset + done;
+		uint32_t	in_page = pos & PAGECACHE_PAGE_MASK;
+		size_t		n = PAGECACHE_PAGE_SIZE - in_page;
+		K_PAGE		*page;
+
+		if (n > size - done) n = size - done;
+
+		/* Pages which aren't cached will be filled with the new content */
+		page = radix_lookup(inode, (uint32_t)(pos >> PAGECACHE_PAGE_SHIFT));
+		if (page != NULL) {
+			memcpy(page->data + in_page, src + done, n);
+		}
+
+		done += n;
+	}
+
+	if (offset + size > inode->size) {
+		inode->size = offset + size;
+	}
+
+	mutex_unlock(&pagecache_lock);
+}
+
+VOID __nxapi pagecache_truncate(K_PAGECACHE_INODE *inode, uint64_t size)
+{
+	uint32_t	keep = (uint32_t)((size + PAGECACHE_PAGE_SIZE - 1) >> PAGECACHE_PAGE_SHIFT);
+	uint32_t	in_page = size & PAGECACHE_PAGE_MASK;
+	K_PAGE		*page, *prev;
+
+	mutex_lock(&pagecache_lock);
+
+	for (page = pagecache_lru_tail; page != NULL; page = prev) {
+		prev = page->lru_prev;
+
+		if (page->inode == inode && page->index >= keep && page->ref_count == 0) {
+			pagecache_drop_page(page);
+		}
+	}
+
+	/* Extending reads zeroes past the old end, which the page may still hold */
+	if (in_page != 0) {
+		page = radix_lookup(inode, (uint32_t)(size >> PAGECACHE_PAGE_SHIFT));
+		if (page != NULL) {
+			memset(page->data + in_page, 0, PAGECACHE_PAGE_SIZE - in_page);
+		}
+	}
+
+	inode->size = size;
+
+	mutex_unlock(&pagecache_lock);
+}
+
+HRESULT __nxapi pagecache_map(K_PAGECACHE_INODE *inode, K_STREAM *s, void *proc_desc, uint64_t offset, size_t size, uint32_t flags, void **out)
+{
+	K_PROCESS			*proc = proc_desc;
+	K_PROCESS			*kproc;
+	K_PAGECACHE_MAPPING	*m = NULL;
+	K_PAGE				**pages = NULL;
+	uintptr_t			*frames = NULL;
+	uintptr_t			*copies = NULL;
+	uintptr_t			va, tmp, copy_phys = 0;
+	uint32_t			count, first, pinned = 0, i, intf;
+	void				*phys;
+	HRESULT				hr;
+
+	if (!pagecache_ready) {
+		return E_FAIL;
+	}
+
+	if (out == NULL) {
+		return E_POINTER;
+	}
+
+	if ((offset & PAGECACHE_PAGE_MASK) != 0 || size == 0 ||
+		(flags != PAGECACHE_MAP_SHARED && flags != PAGECACHE_MAP_PRIVATE))
+	{
+		return E_INVALIDARG;
+	}
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, &proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	first = (uint32_t)(offset >> PAGECACHE_PAGE_SHIFT);
+	count = (size + PAGECACHE_PAGE_MASK) / PAGECACHE_PAGE_SIZE;
+
+	if (!(pages = kcalloc(count * sizeof(K_PAGE*))) || !(frames = kmalloc(count * sizeof(uintptr_t)))) {
+		hr = E_OUTOFMEM;
+		goto fail;
+	}
+
+	/* Reserve a mapping slot */
+	intf = spinlock_acquire(&pagecache_map_lock);
+
+	for (i=0; i<PAGECACHE_MAX_MAPPINGS; i++) {
+		if (pagecache_mappings[i].proc == NULL) {
+			m = &pagecache_mappings[i];
+			m->proc = proc;
+			m->virt_addr = 0;
+			break;
+		}
+	}
+
+	spinlock_release(&pagecache_map_lock, intf);
+
+	if (m == NULL) {
+		hr = E_OUTOFMEM;
+		goto fail;
+	}
+
+	mutex_lock(&pagecache_lock);
+
+	if (offset >= inode->size) {
+		hr = E_INVALIDARG;
+		goto fail_locked;
+	}
+
+	/* Bring in and pin every page, so the later ones don't evict the earlier */
+	for (pinned=0; pinned<count; pinned++) {
+		pages[pinned] = pagecache_get_page(inode, s, first + pinned, count - pinned, &hr);
+		if (pages[pinned] == NULL) goto fail_locked;
+
+		pages[pinned]->ref_count++;
+		frames[pinned] = pages[pinned]->phys;
+	}
+
+	hr = shm_find_map_address(proc, count * PAGECACHE_PAGE_SIZE, &va);
+	if (FAILED(hr)) goto fail_locked;
+
+	if (flags == PAGECACHE_MAP_PRIVATE && proc->mode == PROCESS_MODE_KERNEL) {
+		/* Read-only pages don't fault on supervisor writes (CR0.WP is clear),
+		 * so kernel processes get a private copy upfront.
+		 */
+		hr = kpmm_alloc(count, &phys);
+		if (FAILED(hr)) goto fail_locked;
+
+		copy_phys = (uintptr_t)phys;
+
+		/* Fill the copy through a temporary kernel mapping */
+		hr = sched_get_process_by_id(0, &kproc);
+		if (FAILED(hr)) goto fail_locked;
+
+		hr = vmm_temp_map_region(kproc, copy_phys, count * PAGECACHE_PAGE_SIZE, &tmp);
+		if (FAILED(hr)) goto fail_locked;
+
+		for (i=0; i<count; i++) {
+			memcpy((uint8_t*)tmp + i * PAGECACHE_PAGE_SIZE, pages[i]->data, PAGECACHE_PAGE_SIZE);
+			pages[i]->ref_count--;
+		}
+
+		vmm_unmap_region(kproc, tmp, TRUE);
+
+		kfree(pages);
+		pages = NULL;
+		pinned = 0;
+
+		hr = vmm_map_region(proc, copy_phys, va, count * PAGECACHE_PAGE_SIZE,
+				USAGE_KERNEL | USAGE_DATA, ACCESS_READWRITE, TRUE);
+		if (FAILED(hr)) goto fail_locked;
+	} else {
+		if (flags == PAGECACHE_MAP_PRIVATE && !(copies = kcalloc(count * sizeof(uintptr_t)))) {
+			hr = E_OUTOFMEM;
+			goto fail_locked;
+		}
+
+		/* Writes to private mappings fault and are resolved by pagecache_fault() */
+		hr = vmm_map_pages(proc, frames, count, va,
+				proc->mode == PROCESS_MODE_KERNEL ? USAGE_KERNEL | USAGE_DATA : USAGE_USER | USAGE_DATA,
+				ACCESS_READ, TRUE);
+		if (FAILED(hr)) goto fail_locked;
+
+		pagecache_stats.mapped += count;
+	}
+
+	inode->ref_count++;
+	mutex_unlock(&pagecache_lock);
+
+	/* Publish the mapping */
+	intf = spinlock_acquire(&pagecache_map_lock);
+
+	m->virt_addr	= va;
+	m->inode		= inode;
+	m->count		= count;
+	m->flags		= flags;
+	m->pages		= pages;
+	m->copies		= copies;
+	m->copy_phys	= copy_phys;
+
+	spinlock_release(&pagecache_map_lock, intf);
+
+	kfree(frames);
+
+	*out = (void*)va;
+	return S_OK;
+
+fail_locked:
+	for (i=0; i<pinned; i++) {
+		pages[i]->ref_count--;
+	}
+
+	mutex_unlock(&pagecache_lock);
+
+	if (copy_phys) {
+		kpmm_unmark_blocks((void*)copy_phys, count);
+	}
+
+fail:
+	if (m != NULL) {
+		intf = spinlock_acquire(&pagecache_map_lock);
+		m->proc = NULL;
+		spinlock_release(&pagecache_map_lock, intf);
+	}
+
+	if (pages) kfree(pages);
+	if (frames) kfree(frames);
+	if (copies) kfree(copies);
+
+	return hr;
+}
+
+HRESULT __nxapi pagecache_unmap(void *proc_desc, void *addr)
+{
+	K_PROCESS			*proc = proc_desc;
+	K_PAGECACHE_MAPPING	m;
+	uint32_t			i, intf;
+	HRESULT				hr = E_INVALIDARG;
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, &proc);
+		if (FAILED(hr)) return hr;
+
+		hr = E_INVALIDARG;
+	}
+
+	intf = spinlock_acquire(&pagecache_map_lock);
+
+	for (i=0; i<PAGECACHE_MAX_MAPPINGS; i++) {
+		K_PAGECACHE_MAPPING *mp = &pagecache_mappings[i];
+
+		if (mp->proc == proc && mp->virt_addr == (uintptr_t)addr && mp->inode != NULL) {
+			m = *mp;
+			memset(mp, 0, sizeof(K_PAGECACHE_MAPPING));
+
+			hr = S_OK;
+			break;
+		}
+	}
+
+	spinlock_release(&pagecache_map_lock, intf);
+
+	if (FAILED(hr)) return hr;
+
+	/* The region doesn't own it's frames, so nothing is freed here */
+	vmm_unmap_region(proc, m.virt_addr, TRUE);
+
+	if (m.copy_phys) {
+		kpmm_unmark_blocks((void*)m.copy_phys, m.count);
+	}
+
+	if (m.copies) {
+		for (i=0; i<m.count; i++) {
+			if (m.copies[i]) kpmm_unmark_blocks((void*)m.copies[i], 1);
+		}
+
+		kfree(m.copies);
+	}
+
+	mutex_lock(&pagecache_lock);
+
+	if (m.pages) {
+		for (i=0; i<m.count; i++) {
+			m.pages[i]->ref_count--;
+		}
+
+		pagecache_stats.mapped -= m.count;
+	}
+
+	m.inode->ref_count--;
+
+	mutex_unlock(&pagecache_lock);
+
+	if (m.pages) kfree(m.pages);
+
+	return S_OK;
+}
+
+VOID __nxapi pagecache_invalidate_owner(void *owner)
+{
+	uint32_t i;
+
+	if (!pagecache_ready) {
+		return;
+	}
+
+	mutex_lock(&pagecache_lock);
+
+	for (i=0; i<PAGECACHE_MAX_INODES; i++) {
+		K_PAGECACHE_INODE *inode = &pagecache_inodes[i];
+
+		if (inode->owner != owner) continue;
+
+		pagecache_drop_inode_pages(inode);
+
+		if (inode->ref_count == 0 && inode->page_count == 0) {
+			inode->owner = NULL;
+			pagecache_stats.inodes--;
+		}
+	}
+
+	mutex_unlock(&pagecache_lock);
+}
+
+VOID __nxapi pagecache_invalidate(void *owner, uint64_t id)
+{
+	uint32_t i;
+
+	if (!pagecache_ready) {
+		return;
+	}
+
+	mutex_lock(&pagecache_lock);
+
+	for (i=0; i<PAGECACHE_MAX_INODES; i++) {
+		K_PAGECACHE_INODE *inode = &pagecache_inodes[i];
+
+		if (inode->owner != owner || inode->id != id) continue;
+
+		pagecache_drop_inode_pages(inode);
+
+		if (inode->ref_count == 0 && inode->page_count == 0) {
+			inode->owner = NULL;
+			pagecache_stats.inodes--;
+		}
+
+		break;
+	}
+
+	mutex_unlock(&pagecache_lock);
+}
+
+VOID __nxapi pagecache_get_stats(K_PAGECACHE_STATS *stats)
+{
+	mutex_lock(&pagecache_lock);
+	*stats = pagecache_stats;
+	mutex_unlock(&pagecache_lock);
+}
+
+/*
+ * Returns a cached page, reading it with the fill callback if necessary. On a
+ * miss, up to `count` missing pages starting at `index` are read together.
+ * Must be called with the cache lock held.
+ */
+static K_PAGE *pagecache_get_page(K_PAGECACHE_INODE *inode, K_STREAM *s, uint32_t index, uint32_t count, HRESULT *hr)
+{
+	K_PAGE		*page;
+	uint32_t	filled;
+
+	if ((page = radix_lookup(inode, index)) != NULL) {
+		pagecache_stats.hits++;
+
+		pagecache_lru_unlink(page);
+		pagecache_lru_push(page);
+
+		return page;
+	}
+
+	*hr = pagecache_fill_run(inode, s, index, count, &filled);
+	if (FAILED(*hr)) return NULL;
+
+	pagecache_stats.misses += filled;
+
+	return radix_lookup(inode, index);
+}
+
+/*
+ * Reads a run of up to `count` missing pages, starting at `index`, with a
+ * single fill call. The run ends before the first page, which is cached
+ * already. Must be called with the cache lock held.
+ */
+static HRESULT pagecache_fill_run(K_PAGECACHE_INODE *inode, K_STREAM *s, uint32_t index, uint32_t count, uint32_t *filled)
+{
+	K_PAGE		*pages[PAGECACHE_MAX_RUN];
+	uint64_t	pos = (uint64_t)index << PAGECACHE_PAGE_SHIFT;
+	size_t		size, got = 0, n_copy;
+	uint8_t		*dst;
+	uint32_t	n, i;
+	HRESULT		hr = S_OK;
+
+	*filled = 0;
+
+	if (count > PAGECACHE_MAX_RUN) {
+		count = PAGECACHE_MAX_RUN;
+	}
+
+	for (n=0; n<count; n++) {
+		if (radix_lookup(inode, index + n) != NULL) break;
+		if (!(pages[n] = pagecache_alloc_page())) break;
+	}
+
+	if (n == 0) {
+		/* Either cached already, or every page is mapped */
+		return radix_lookup(inode, index) != NULL ? S_OK : E_OUTOFMEM;
+	}
+
+	if (pos < inode->size) {
+		size = inode->size - pos;
+		if (size > n * PAGECACHE_PAGE_SIZE) size = n * PAGECACHE_PAGE_SIZE;
+
+		/* A single page is read in place */
+		dst = n == 1 ? pages[0]->data : pagecache_bounce;
+
+		hr = inode->fill(s, pos, size, dst, &got);
+		if (hr == E_ENDOFSTR) {
+			got = 0;
+			hr = S_OK;
+		}
+
+		if (FAILED(hr)) {
+			for (i=0; i<n; i++) {
+				pages[i]->lru_next = pagecache_free;
+				pagecache_free = pages[i];
+			}
+
+			return hr;
+		}
+
+		pagecache_stats.fills++;
+	}
+
+	for (i=0; i<n; i++) {
+		K_PAGE	*page = pages[i];
+		size_t	offs = i * PAGECACHE_PAGE_SIZE;
+
+		n_copy = got > offs ? got - offs : 0;
+		if (n_copy > PAGECACHE_PAGE_SIZE) n_copy = PAGECACHE_PAGE_SIZE;
+
+		if (n > 1 && n_copy > 0) {
+			memcpy(page->data, pagecache_bounce + offs, n_copy);
+		}
+
+		/* Tail of the last page (and pages past the end of file) read as zeroes */
+		if (n_copy < PAGECACHE_PAGE_SIZE) {
+			memset(page->data + n_copy, 0, PAGECACHE_PAGE_SIZE - n_copy);
+		}
+
+		hr = radix_insert(inode, index + i, page);
+		if (FAILED(hr)) {
+			for (; i<n; i++) {
+				pages[i]->lru_next = pagecache_free;
+				pagecache_free = pages[i];
+			}
+
+			break;
+		}
+
+		page->inode = inode;
+		page->index = index + i;
+		page->ref_count = 0;
+
+		inode->page_count++;
+		pagecache_stats.pages++;
+		(*filled)++;
+
+		pagecache_lru_push(page);
+	}
+
+	return *filled > 0 ? S_OK : hr;
+}
+
+VOID __nxapi pagecache_ra_init(K_READAHEAD *ra, K_PAGECACHE_INODE *inode)
+{
+	memset(ra, 0, sizeof(K_READAHEAD));
+
+	ra->inode = inode;
+	ra->req.state = AIO_STATE_IDLE;
+	event_create(&ra->req.done, EVENT_FLAG_NONE);
+}
+
+HRESULT __nxapi pagecache_read_ra(K_READAHEAD *ra, K_STREAM *s, uint64_t offset, size_t size, void *buffer, size_t *bytes_read)
+{
+	BOOL	sequential = offset == ra->next;
+	size_t	done = 0;
+	HRESULT	hr;
+
+	hr = pagecache_read(ra->inode, s, offset, size, buffer, &done);
+	if (bytes_read) *bytes_read = done;
+
+	if (!sequential) {
+		/* Random access, back off */
+		ra->window /= 2;
+		if (ra->window < PAGECACHE_RA_MIN) ra->window = 0;
+
+		ra->ahead_end = 0;
+	}
+
+	ra->next = offset + done;
+
+	if (sequential && done > 0 && pagecache_ra_enabled) {
+		if (ra->window == 0) ra->window = PAGECACHE_RA_MIN;
+		pagecache_ra_start(ra, s);
+	}
+
+	return hr;
+}
+
+VOID __nxapi pagecache_ra_cancel(K_READAHEAD *ra)
+{
+	if (ra->req.state == AIO_STATE_QUEUED && SUCCEEDED(aio_cancel(&ra->req))) {
+		return;
+	}
+
+	/* Already being served */
+	if (ra->req.state == AIO_STATE_QUEUED || ra->req.state == AIO_STATE_ACTIVE) {
+		aio_wait(&ra->req, TIMEOUT_INFINITE);
+	}
+}
+
+VOID __nxapi pagecache_set_readahead(BOOL enable)
+{
+	pagecache_ra_enabled = enable;
+}
+
+/*
+ * Queues a read-ahead, unless at least half a window is read ahead already.
+ */
+static void pagecache_ra_start(K_READAHEAD *ra, K_STREAM *s)
+{
+	uint64_t	start, end, size;
+
+	if (ra->ahead_end >= ra->next + ra->window / 2) {
+		return;
+	}
+
+	if (ra->req.state == AIO_STATE_QUEUED || ra->req.state == AIO_STATE_ACTIVE) {
+		return;
+	}
+
+	mutex_lock(&pagecache_lock);
+	size = ra->inode->size;
+	mutex_unlock(&pagecache_lock);
+
+	start = ra->ahead_end > ra->next ? ra->ahead_end : ra->next;
+	start &= ~(uint64_t)PAGECACHE_PAGE_MASK;
+
+	end = ra->next + ra->window;
+	if (end > size) end = size;
+
+	if (start >= end) {
+		return;
+	}
+
+	ra->req.op			= AIO_OP_READ;
+	ra->req.stream		= s;
+	ra->req.offset		= start;
+	ra->req.buffer		= NULL;
+	ra->req.size		= end - start;
+	ra->req.user_data	= ra;
+	ra->req.cq			= NULL;
+	ra->req.status		= S_OK;
+	ra->req.bytes		= 0;
+	ra->req.driver_data	= NULL;
+	event_create(&ra->req.done, EVENT_FLAG_NONE);
+
+	if (FAILED(aio_queue_push(&pagecache_ra_queue, &ra->req))) {
+		return;
+	}
+
+	ra->ahead_end = end;
+
+	/* Next round reads further ahead */
+	ra->window *= 2;
+	if (ra->window > PAGECACHE_RA_MAX) ra->window = PAGECACHE_RA_MAX;
+}
+
+static HRESULT __nxapi pagecache_ra_service(K_IO_QUEUE *q, K_IO_REQUEST *req)
+{
+	K_READAHEAD	*ra = req->user_data;
+	uint32_t	index = (uint32_t)(req->offset >> PAGECACHE_PAGE_SHIFT);
+	uint32_t	last = (uint32_t)((req->offset + req->size - 1) >> PAGECACHE_PAGE_SHIFT);
+	uint32_t	filled;
+	HRESULT		hr = S_OK;
+
+	UNUSED_ARG(q);
+
+	/* Same lock order as readers: stream, then cache */
+	mutex_lock(&req->stream->lock);
+	mutex_lock(&pagecache_lock);
+
+	while (index <= last) {
+		if (radix_lookup(ra->inode, index) != NULL) {
+			index++;
+			continue;
+		}
+
+		hr = pagecache_fill_run(ra->inode, req->stream, index, last - index + 1, &filled);
+		if (FAILED(hr) || filled == 0) break;
+
+		pagecache_stats.readahead += filled;
+		index += filled;
+	}
+
+	mutex_unlock(&pagecache_lock);
+	mutex_unlock(&req->stream->lock);
+
+	if (SUCCEEDED(hr)) req->bytes = req->size;
+	return hr;
+}
+
+/*
+ * Takes a page from the free list, or evicts the least recently used page,
+ * which isn't mapped.
+ */
+static K_PAGE *pagecache_alloc_page()
+{
+	K_PAGE *page;
+
+	if ((page = pagecache_free) != NULL) {
+		pagecache_free = page->lru_next;
+		page->lru_next = NULL;
+
+		return page;
+	}
+
+	for (page = pagecache_lru_tail; page != NULL; page = page->lru_prev) {
+		if (page->ref_count == 0) break;
+	}
+
+	if (page == NULL) {
+		return NULL;
+	}
+
+	pagecache_drop_page(page);
+	pagecache_stats.evictions++;
+
+	/* Dropped page went to the free list */
+	pagecache_free = page->lru_next;
+	page->lru_next = NULL;
+
+	return page;
+}
+
+/*
+ * Removes a page from it's inode and moves it to the free list.
+ */
+static void pagecache_drop_page(K_PAGE *page)
+{
+	radix_delete(page->inode, page->index);
+	page->inode->page_count--;
+	pagecache_stats.pages--;
+
+	pagecache_lru_unlink(page);
+
+	page->inode = NULL;
+	page->lru_next = pagecache_free;
+	pagecache_free = page;
+}
+
+/*
+ * Drops all pages of an inode, except the mapped ones.
+ */
+static void pagecache_drop_inode_pages(K_PAGECACHE_INODE *inode)
+{
+	K_PAGE *page, *prev;
+
+	for (page = pagecache_lru_tail; page != NULL; page = prev) {
+		prev = page->lru_prev;
+
+		if (page->inode == inode && page->ref_count == 0) {
+			pagecache_drop_page(page);
+		}
+	}
+}
+
+static void pagecache_lru_unlink(K_PAGE *page)
+{
+	if (page->lru_prev) page->lru_prev->lru_next = page->lru_next;
+	else pagecache_lru_head = page->lru_next;
+
+	if (page->lru_next) page->lru_next->lru_prev = page->lru_prev;
+	else pagecache_lru_tail = page->lru_prev;
+
+	page->lru_prev = page->lru_next = NULL;
+}
+
+static void pagecache_lru_push(K_PAGE *page)
+{
+	page->lru_prev = NULL;
+	page->lru_next = pagecache_lru_head;
+
+	if (pagecache_lru_head) pagecache_lru_head->lru_prev = page;
+	else pagecache_lru_tail = page;
+
+	pagecache_lru_head = page;
+}
+
+/*
+ * Radix tree. A tree of height h indexes 64^h pages; it grows by adding a new
+ * root above the old one, and shrinks to nothing once it's last page is gone.
+ */
+static uint32_t radix_capacity_bits(uint32_t height)
+{
+	return height * PAGECACHE_RADIX_SHIFT;
+}
+
+static K_PAGE *radix_lookup(K_PAGECACHE_INODE *inode, uint32_t index)
+{
+	K_PAGECACHE_RADIX	*node = inode->root;
+	uint32_t			level;
+
+	if (node == NULL) {
+		return NULL;
+	}
+
+	if (radix_capacity_bits(inode->height) < 32 && (index >> radix_capacity_bits(inode->height)) != 0) {
+		return NULL;
+	}
+
+	for (level = inode->height; level > 1; level--) {
+		node = node->slots[(index >> radix_capacity_bits(level-1)) & PAGECACHE_RADIX_MASK];
+		if (node == NULL) return NULL;
+	}
+
+	return node->slots[index & PAGECACHE_RADIX_MASK];
+}
+
+static HRESULT radix_insert(K_PAGECACHE_INODE *inode, uint32_t index, K_PAGE *page)
+{
+	K_PAGECACHE_RADIX	*node, *child;
+	uint32_t			level, slot;
+
+	/* Grow until the index fits */
+	while (inode->root == NULL || (radix_capacity_bits(inode->height) < 32 &&
+			(index >> radix_capacity_bits(inode->height)) != 0))
+	{
+		if (!(node = kcalloc(sizeof(K_PAGECACHE_RADIX)))) {
+			return E_OUTOFMEM;
+		}
+
+		if (inode->root != NULL) {
+			node->slots[0] = inode->root;
+			node->count = 1;
+		}
+
+		inode->root = node;
+		inode->height++;
+	}
+
+	node = inode->root;
+
+	for (level = inode->height; level > 1; level--) {
+		slot = (index >> radix_capacity_bits(level-1)) & PAGECACHE_RADIX_MASK;
+
+		if ((child = node->slots[slot]) == NULL) {
+			if (!(child = kcalloc(sizeof(K_PAGECACHE_RADIX)))) {
+				return E_OUTOFMEM;
+			}
+
+			node->slots[slot] = child;
+			node->count++;
+		}
+
+		node = child;
+	}
+
+	slot = index & PAGECACHE_RADIX_MASK;
+	assert_msg(node->slots[slot] == NULL, "radix_insert(): page is already cached.");
+
+	node->slots[slot] = page;
+	node->count++;
+
+	return S_OK;
+}
+
+static void radix_delete(K_PAGECACHE_INODE *inode, uint32_t index)
+{
+	K_PAGECACHE_RADIX	*path[PAGECACHE_MAX_HEIGHT];
+	K_PAGECACHE_RADIX	*node = inode->root;
+	uint32_t			level, depth = 0, slot;
+
+	for (level = inode->height; level > 0; level--) {
+		if (node == NULL) return;
+
+		path[depth++] = node;
+
+		if (level > 1) {
+			node = node->slots[(index >> radix_capacity_bits(level-1)) & PAGECACHE_RADIX_MASK];
+		}
+	}
+
+	/* Clear the leaf slot, then free nodes left empty, bottom-up */
+	for (level = 1; depth > 0; level++) {
+		node = path[--depth];
+		slot = (index >> radix_capacity_bits(level-1)) & PAGECACHE_RADIX_MASK;
+
+		if (node->slots[slot] == NULL) return;
+
+		node->slots[slot] = NULL;
+		if (--node->count > 0) return;
+
+		kfree(node);
+	}
+
+	inode->root = NULL;
+	inode->height = 0;
+}
+
+/*
+ * Resolves write faults on private mappings of user processes, by giving the
+ * process it's own copy of the page.
+ */
+static HRESULT pagecache_fault(uintptr_t addr, uint32_t err_code)
+{
+	K_PROCESS			*proc;
+	K_PAGECACHE_MAPPING	*m = NULL;
+	uintptr_t			page_va = addr & ~PAGECACHE_PAGE_MASK;
+	uintptr_t			tmp;
+	uint32_t			i, intf;
+	void				*phys;
+	HRESULT				hr = E_FAIL;
+
+	if ((err_code & (PF_PRESENT | PF_WRITE)) != (PF_PRESENT | PF_WRITE)) {
+		return E_FAIL;
+	}
+
+	if (FAILED(sched_get_current_proc(&proc))) {
+		return E_FAIL;
+	}
+
+	intf = spinlock_acquire(&pagecache_map_lock);
+
+	for (i=0; i<PAGECACHE_MAX_MAPPINGS; i++) {
+		K_PAGECACHE_MAPPING *mp = &pagecache_mappings[i];
+
+		if (mp->proc == proc && mp->copies != NULL && page_va >= mp->virt_addr &&
+			page_va < mp->virt_addr + mp->count * PAGECACHE_PAGE_SIZE)
+		{
+			m = mp;
+			break;
+		}
+	}
+
+	if (m == NULL) goto finally;
+
+	i = (page_va - m->virt_addr) / PAGECACHE_PAGE_SIZE;
+
+	/* Already private, so it's a genuine fault */
+	if (m->copies[i] != 0) goto finally;
+
+	if (FAILED(kpmm_alloc(1, &phys))) goto finally;
+
+	if (FAILED(vmm_temp_map_region(proc, (uintptr_t)phys, PAGECACHE_PAGE_SIZE, &tmp))) {
+		kpmm_unmark_blocks(phys, 1);
+		goto finally;
+	}
+
+	/* Shared page is still mapped read-only at the faulting address */
+	memcpy((void*)tmp, (void*)page_va, PAGECACHE_PAGE_SIZE);
+	vmm_unmap_region(proc, tmp, TRUE);
+
+	hr = vmm_set_page(proc, page_va, (uintptr_t)phys, ACCESS_READWRITE, TRUE);
+	if (FAILED(hr)) {
+		kpmm_unmark_blocks(phys, 1);
+		goto finally;
+	}
+
+	m->copies[i] = (uintptr_t)phys;
+	pagecache_stats.cow_faults++;
+
+finally:
+	spinlock_release(&pagecache_map_lock, intf);
+	return hr;
+}
+
+/*
+ * Benchmark
+ */
+#define PAGECACHE_BENCH_FILE		"/pcbench.tmp"
+#define PAGECACHE_BENCH_SIZE		(256 * 1024)
+#define PAGECACHE_BENCH_PASSES		3
+
+static uint32_t pagecache_bench_sum(const uint8_t *p, size_t size)
+{
+	uint32_t	sum = 0;
+	size_t		i;
+
+	for (i=0; i<size; i += 64) {
+		sum += p[i];
+	}
+
+	return sum;
+}
+
+/*
+ * Copies the whole file into a buffer, like elf_execute() used to.
+ */
+static uint32_t pagecache_bench_copy(char *path, uint32_t *sum, HRESULT *hr)
+{
+	K_STREAM	*s;
+	uint8_t		*buf;
+	size_t		size, bytes;
+	uint32_t	t = timer_gettickcount();
+
+	*hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(*hr)) return 0;
+
+	k_fseek(s, 0, KSTREAM_ORIGIN_END);
+	size = k_ftell(s);
+	k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+	if (!(buf = kmalloc(size))) {
+		*hr = E_OUTOFMEM;
+	} else {
+		*hr = k_fread(s, size, buf, &bytes);
+		if (SUCCEEDED(*hr)) *sum = pagecache_bench_sum(buf, bytes);
+
+		kfree(buf);
+	}
+
+	k_fclose(&s);
+	return timer_gettickcount() - t;
+}
+
+/*
+ * Maps the whole file shared and touches it.
+ */
+static uint32_t pagecache_bench_mmap(char *path, uint32_t *sum, HRESULT *hr)
+{
+	K_STREAM	*s;
+	void		*p;
+	size_t		size;
+	uint32_t	t = timer_gettickcount();
+
+	*hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(*hr)) return 0;
+
+	k_fseek(s, 0, KSTREAM_ORIGIN_END);
+	size = k_ftell(s);
+	k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+	*hr = vfs_mmap(s, 0, size, VFS_MMAP_SHARED, NULL, &p);
+	if (SUCCEEDED(*hr)) {
+		*sum = pagecache_bench_sum(p, size);
+		vfs_munmap(NULL, p);
+	}
+
+	k_fclose(&s);
+	return timer_gettickcount() - t;
+}
+
+static void pagecache_bench_file(char *path)
+{
+	uint32_t	pass, ms, sum_copy = 0, sum_map = 0;
+	HRESULT		hr;
+
+	for (pass=0; pass<PAGECACHE_BENCH_PASSES; pass++) {
+		ms = pagecache_bench_copy(path, &sum_copy, &hr);
+		if (FAILED(hr)) {
+			k_printf("%s: read failed (hr=0x%X).\n", path, hr);
+			return;
+		}
+
+		k_printf("%s: %s read into a buffer in %d ms\n", path, pass == 0 ? "first" : "repeat", ms);
+	}
+
+	for (pass=0; pass<PAGECACHE_BENCH_PASSES; pass++) {
+		ms = pagecache_bench_mmap(path, &sum_map, &hr);
+		if (FAILED(hr)) {
+			k_printf("%s: mmap failed (hr=0x%X).\n", path, hr);
+			return;
+		}
+
+		k_printf("%s: mmap and touch in %d ms\n", path, ms);
+	}
+
+	if (sum_copy != sum_map) {
+		k_printf("%s: mapped content differs from read content!\n", path);
+	}
+}
+
+/*
+ * Writes through a private mapping and checks the file stays intact.
+ */
+static HRESULT pagecache_bench_private(char *path)
+{
+	K_STREAM	*s;
+	uint8_t		*priv, *shared;
+	HRESULT		hr;
+
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(hr)) return hr;
+
+	hr = vfs_mmap(s, 0, PAGECACHE_PAGE_SIZE, VFS_MMAP_PRIVATE, NULL, (void**)&priv);
+	if (FAILED(hr)) goto finally;
+
+	hr = vfs_mmap(s, 0, PAGECACHE_PAGE_SIZE, VFS_MMAP_SHARED, NULL, (void**)&shared);
+	if (FAILED(hr)) {
+		vfs_munmap(NULL, priv);
+		goto finally;
+	}
+
+	priv[0] = ~shared[0];
+	k_printf("Private mapping: %s\n", priv[0] != shared[0] ? "isolated" : "LEAKED INTO THE FILE");
+
+	vfs_munmap(NULL, shared);
+	vfs_munmap(NULL, priv);
+
+finally:
+	k_fclose(&s);
+	return hr;
+}
+
+HRESULT __nxapi pagecache_benchmark()
+{
+	K_PAGECACHE_STATS	st;
+	K_DIR_STREAM		*ds;
+	K_FS_NODE_INFO		info;
+	K_STREAM			*s;
+	char				name[MAX_FILENAME_LENGTH];
+	char				path[MAX_DIRNAME_LENGTH];
+	uint8_t				*buf;
+	uint32_t			i;
+	HRESULT				hr;
+
+	/* Memory file */
+	if (!(buf = kmalloc(PAGECACHE_BENCH_SIZE))) {
+		return E_OUTOFMEM;
+	}
+
+	for (i=0; i<PAGECACHE_BENCH_SIZE; i++) {
+		buf[i] = (uint8_t)(i * 7);
+	}
+
+	/* File may be left over from a previous run */
+	k_fcreate(PAGECACHE_BENCH_FILE, NODE_MODE_ALL_RWE);
+
+	hr = k_fopen(PAGECACHE_BENCH_FILE, FILE_OPEN_WRITE, &s);
+	if (SUCCEEDED(hr)) {
+		hr = k_fwrite(s, PAGECACHE_BENCH_SIZE, buf, NULL);
+		k_fclose(&s);
+	}
+
+	kfree(buf);
+	if (FAILED(hr)) return hr;
+
+	pagecache_bench_file(PAGECACHE_BENCH_FILE);
+
+	hr = pagecache_bench_private(PAGECACHE_BENCH_FILE);
+	if (FAILED(hr)) {
+		k_printf("Private mapping failed (hr=0x%X).\n", hr);
+	}
+
+	/* First file on the FAT floppy, if mounted */
+	if (SUCCEEDED(k_opendir("/drives/a", &ds))) {
+		name[0] = '\0';
+		while (k_readdir(ds, name, &info) == S_OK) {
+			if (info.node_type == FS_NODE_TYPE_FILE && info.size > 0) break;
+			name[0] = '\0';
+		}
+		k_closedir(&ds);
+
+		if (name[0] != '\0') {
+			snprintf(path, sizeof(path), "/drives/a/%s", name);
+			pagecache_bench_file(path);
+		}
+	} else {
+		k_printf("/drives/a: not mounted, FAT test skipped.\n");
+	}
+
+	pagecache_get_stats(&st);
+	k_printf("Page cache: %d hits, %d misses, %d evictions, %d COW faults, %d pages (%d mapped), %d inodes\n",
+			st.hits, st.misses, st.evictions, st.cow_faults, st.pages, st.mapped, st.inodes);
+
+	return S_OK;
+}
+
+/*
+ * Read-ahead benchmark. Files should be larger than the buffer cache, so
+ * every pass starts cold.
+ */
+#define PAGECACHE_RA_BENCH_CHUNK	4096
+
+static const char *pagecache_ra_bench_dirs[] = {
+	"/drives/a",
+	NULL
+};
+
+/*
+ * Reads a file sequentially in small chunks, like a media player would.
+ */
+static uint32_t pagecache_ra_bench_read(char *path, uint8_t *buf, size_t *total, HRESULT *hr)
+{
+	K_STREAM	*s;
+	size_t		bytes;
+	uint32_t	t;
+
+	*total = 0;
+
+	*hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(*hr)) return 0;
+
+	/* Drop pages left by the previous pass */
+	pagecache_invalidate_owner(s->fs_driver);
+
+	t = timer_gettickcount();
+
+	while ((*hr = k_fread(s, PAGECACHE_RA_BENCH_CHUNK, buf, &bytes)) == S_OK && bytes > 0) {
+		*total += bytes;
+	}
+
+	t = timer_gettickcount() - t;
+
+	if (*hr == E_ENDOFSTR) *hr = S_OK;
+
+	k_fclose(&s);
+	return t;
+}
+
+HRESULT __nxapi pagecache_ra_benchmark()
+{
+	K_PAGECACHE_STATS	st;
+	K_DIR_STREAM		*ds;
+	K_FS_NODE_INFO		info;
+	char				name[MAX_FILENAME_LENGTH];
+	char				best[MAX_FILENAME_LENGTH];
+	char				path[MAX_DIRNAME_LENGTH];
+	uint8_t				*buf;
+	size_t				best_size, total;
+	uint32_t			i, pass, ms;
+	HRESULT				hr = S_OK;
+
+	if (!(buf = kmalloc(PAGECACHE_RA_BENCH_CHUNK))) {
+		return E_OUTOFMEM;
+	}
+
+	for (i=0; pagecache_ra_bench_dirs[i] != NULL; i++) {
+		if (FAILED(k_opendir((char*)pagecache_ra_bench_dirs[i], &ds))) {
+			k_printf("%s: not mounted, skipped.\n", pagecache_ra_bench_dirs[i]);
+			continue;
+		}
+
+		/* Largest file of the directory */
+		best[0] = '\0';
+		best_size = 0;
+
+		while (k_readdir(ds, name, &info) == S_OK) {
+			if (info.node_type == FS_NODE_TYPE_FILE && info.size > best_size) {
+				strcpy(best, name);
+				best_size = info.size;
+			}
+		}
+
+		k_closedir(&ds);
+
+		if (best[0] == '\0') {
+			k_printf("%s: no files, skipped.\n", pagecache_ra_bench_dirs[i]);
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/%s", pagecache_ra_bench_dirs[i], best);
+
+		/* Off first, so a warm buffer cache can only favour it */
+		for (pass=0; pass<2; pass++) {
+			pagecache_set_readahead(pass == 1);
+
+			ms = pagecache_ra_bench_read(path, buf, &total, &hr);
+			if (FAILED(hr)) {
+				k_printf("%s: read failed (hr=0x%X).\n", path, hr);
+				break;
+			}
+
+			k_printf("%s: %d KiB in %d ms (%d KiB/s), read-ahead %s\n", path, total / 1024, ms,
+					ms > 0 ? (uint32_t)(total / 1024 * 1000 / ms) : 0, pass == 1 ? "on" : "off");
+		}
+	}
+
+	pagecache_set_readahead(TRUE);
+
+	pagecache_get_stats(&st);
+	k_printf("Page cache: %d fills, %d pages read ahead, %d misses\n", st.fills, st.readahead, st.misses);
+
+	kfree(buf);
+	return hr;
+}
@@ -5,6 +5,10 @@
  *      Author: Anton Angeloff
  */
 
+#include <mm.h>
+#include <hal.h>
+#include <string.h>
+#include <kstdio.h>
 #include "pipe.h"
 #include "vfs.h"
 
@@ -48,6 +52,8 @@ static HRESULT pipe_read(K_STREAM *str, const size_t block_size, void *out_buf,
 	}
 
 	mutex_unlock(&desc->lock);
+	event_signal(&desc->space_ev);
+
 	if (bytes_read) *bytes_read = block_size;
 
 	return S_OK;
@@ -57,7 +63,7 @@ static HRESULT pipe_read(K_STREAM *str, const size_t block_size, void *out_buf,
  * Tries to write _block_size_ bytes to the pipe. If the buffer cannot accommodate them
  * then the function fails while writing 0 bytes.
  */
-static HRESULT pipe_write(K_STREAM *str, const size_t block_size, void *in_buf, size_t *bytes_written)
+static HRESULT pipe_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written)
 {
 	K_VFS_NODE 	*node = str->priv_data;
 	K_DEVICE 	*dev  = node->content;
@@ -76,7 +82,7 @@ static HRESULT pipe_write(K_STREAM *str, const size_t block_size, void *in_buf,
 	 */
 	free_size--;
 
-	if (free_size < block_size) {
+	if (block_size < 0 || free_size < (uint32_t)block_size) {
 		/* No space to write. */
 		if (bytes_written) *bytes_written = 0;
 		mutex_unlock(&desc->lock);
@@ -84,7 +90,7 @@ static HRESULT pipe_write(K_STREAM *str, const size_t block_size, void *in_buf,
 		return E_FAIL;
 	}
 
-	uint8_t overlap = block_size > (desc->buffer_size - desc->write_pos) ? TRUE : FALSE;
+	uint8_t overlap = (uint32_t)block_size > (desc->buffer_size - desc->write_pos) ? TRUE : FALSE;
 
 	if (overlap) {
 		/* Copy in two iterations */
@@ -108,6 +114,8 @@ static HRESULT pipe_write(K_STREAM *str, const size_t block_size, void *in_buf,
 	}
 
 	mutex_unlock(&desc->lock);
+	event_signal(&desc->data_ev);
+
 	if (bytes_written) *bytes_written = block_size;
 
 	return S_OK;
@@ -119,6 +127,8 @@ static HRESULT destroy_pipe_desc(K_PIPE_DESC **desc)
 
 	kfree(d->ring_buffer);
 	mutex_destroy(&d->lock);
+	event_destroy(&d->data_ev);
+	event_destroy(&d->space_ev);
 
 	kfree(d);
 	*desc = NULL;
@@ -132,24 +142,30 @@ static HRESULT pipe_ioctl(K_STREAM *s, uint32_t code, void *arg)
 	K_DEVICE 	*dev  = node->content;
 	K_PIPE_DESC *desc = dev->opaque;
 
-	UNUSED_ARG(arg);
-
 	switch (code) {
 	case DEVIO_OPEN:
 		desc->ref_cnt++;
 		break;
 
 	case DEVIO_CLOSE:
-		if ((desc->ref_cnt--) == 0) {
+		if (--desc->ref_cnt == 0) {
 			if (desc->flags == PIPE_FLAG_DELETE_ON_CLOSE) {
 				/* Unmount pipe */
-				destroy_pipe_desc(&dev->opaque);
+				destroy_pipe_desc((K_PIPE_DESC**)&dev->opaque);
 				return vfs_unmount_device(s->filename);
 			}
 		}
 
 		break;
 
+	case IOCTL_STREAM_GET_READ_EVENT:
+		*(K_EVENT**)arg = &desc->data_ev;
+		break;
+
+	case IOCTL_STREAM_GET_WRITE_EVENT:
+		*(K_EVENT**)arg = &desc->space_ev;
+		break;
+
 	default:
 		/* Unsupported code */
 		return E_INVALIDARG;
@@ -166,12 +182,14 @@ HRESULT pipe_create(char *name, uint32_t flags, size_t buff_size)
 	}
 
 	/* Create pipe descriptor struct */
-	K_PIPE_DESC *pipe_desc 	= kmalloc(sizeof(K_PIPE_DESC));
+	K_PIPE_DESC *pipe_desc 	= kcalloc(sizeof(K_PIPE_DESC));
 	pipe_desc->buffer_size 	= buff_size;
 	pipe_desc->ring_buffer	= kmalloc(buff_size);
 	pipe_desc->flags 		= flags;
 
 	mutex_create(&pipe_desc->lock);
+	event_create(&pipe_desc->data_ev, EVENT_FLAG_NONE);
+	event_create(&pipe_desc->space_ev, EVENT_FLAG_NONE);
 
 	/* Set pipe url */
 	dev->default_url = kmalloc(1024);
@@ -194,17 +212,17 @@ void pipe_test()
 	/* Tests the pipe system */
 	pipe_create("pipe1", PIPE_FLAG_NONE, 1024*16);
 
-	K_STREAM 	*s_read, s_write;
+	K_STREAM 	*s_read, *s_write;
 	uint8_t 	*buff = kmalloc(1024);
 	uint8_t		*buff_2 = kmalloc(1024);
-	uint32_t	bytes;
+	size_t		bytes;
 
-	CHECK(k_fopen("/ipc/pipe1", FILE_OPEN_WRITE, s_write), "Failed to open pipe for writing.");
+	CHECK(k_fopen("/ipc/pipe1", FILE_OPEN_WRITE, &s_write), "Failed to open pipe for writing.");
 	CHECK(k_fwrite(s_write, 1024, buff, &bytes), "Failed to write to pipe.");
 	if (bytes != 1024) { HalKernelPanic("bytes != 1024."); }
 
-	CHECK(k_fopen("/ipc/pipe1", FILE_OPEN_READ, s_read), "Failed to open pipe for reading.");
-	CHECK(k_fread(s_read, 1024, buff_2, &bytes), "Failed to write to pipe.");
+	CHECK(k_fopen("/ipc/pipe1", FILE_OPEN_READ, &s_read), "Failed to open pipe for reading.");
+	CHECK(k_fread(s_read, 1024, buff_2, &bytes), "Failed to read from pipe.");
 	if (bytes != 1024) { HalKernelPanic("bytes != 1024."); }
 
 	for (int i=0; i<1024; i++) {
@@ -213,6 +231,9 @@ void pipe_test()
 		}
 	}
 
-	CHECK(fclose(s_read), "Failed to close reading handle.");
-	CHECK(fclose(s_write), "Failed to close writing handle.");
+	CHECK(k_fclose(&s_read), "Failed to close reading handle.");
+	CHECK(k_fclose(&s_write), "Failed to close writing handle.");
+
+	kfree(buff);
+	kfree(buff_2);
 }
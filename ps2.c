@@ -266,7 +266,7 @@ void __nxapi keyboard_irq_handler(K_REGISTERS regs)
 	if(b[0] & 0x80) {
 		//Key is released
 		keyboard_driver_state.keydown_map[b[0]&0x7F] = FALSE;
-		//vga_printf("(rl: %x)(%x)\t", b[0], b[0]&0x7F);
+		//vga_printf("(rl: 0x%X)(0x%X)\t", b[0], b[0]&0x7F);
 		return;
 	} else {
 		keyboard_driver_state.keydown_map[b[0]] = TRUE;
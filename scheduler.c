@@ -251,7 +251,7 @@ HRESULT	__nxapi sched_setup_thread_stack(K_THREAD *t)
 	K_PROCESS *current_proc = sched_state.current == NULL ? &kernel_proc : sched_state.current->process;
 
 	hr = vmm_temp_map_region(current_proc, stack_phys_location, t->stack_size, &stack_temp_ptr);
-	//k_printf("temp_map: hr=%x\n", hr);
+	//k_printf("temp_map: hr=0x%X\n", hr);
 	if (FAILED(hr)) return hr;
 
 	uint32_t *stack = (uint32_t*)(stack_temp_ptr + t->stack_size);
@@ -308,7 +308,7 @@ HRESULT	__nxapi sched_setup_thread_stack(K_THREAD *t)
 
 	/* We finished writing to thread's kernel stack, so remove the temporary mapping */
 	hr = vmm_unmap_region(current_proc, stack_temp_ptr, 1);
-//	vga_printf("vmm_unmap_region(current_proc=%x, stack_temp_ptr=%x, 1); hr=%x\n", current_proc, stack_temp_ptr, hr);
+//	vga_printf("vmm_unmap_region(current_proc=0x%X, stack_temp_ptr=0x%X, 1); hr=0x%X\n", current_proc, stack_temp_ptr, hr);
 	assert(SUCCEEDED(hr));
 
 	/* This should be all fine and enough to just IRET to the new thread, later
@@ -357,7 +357,7 @@ HRESULT	__nxapi sched_create_thread(K_PROCESS *proc, void *entry_point, uint32_t
 
 //	vga_printf("t->id=%d\n", t->id);
 	hr = vmm_alloc_and_map(proc, virt_addr, size, USAGE_KERNELSTACK, ACCESS_READWRITE, 0);
-	//vga_printf("virt_addr=%x, size=%x  hr=%x\n", virt_addr, size, hr);
+	//vga_printf("virt_addr=0x%X, size=0x%X  hr=0x%X\n", virt_addr, size, hr);
 	if (FAILED(hr)) {
 		HalKernelPanic("Failed to allocate kernel space stack.");
 	}
@@ -599,7 +599,7 @@ HRESULT __nxapi sched_update()
 	asm volatile ("mov %%ebp, %0" : "=r" (ebp));
 	eip = HalRetrieveEIP(); //this actually returns pointer to the _next_ instruction's addr (probably assignment)
 
-//	vga_printf("esp=%x ebp=%x eip=%x return_irq_ptr=%x\n", esp, ebp, eip, return_to_irq_handler);
+//	vga_printf("esp=0x%X ebp=0x%X eip=0x%X return_irq_ptr=0x%X\n", esp, ebp, eip, return_to_irq_handler);
 
 	/* HERE IT'S PROPER TO CITE PonyOS's author:
 	 * 			"Kernels are magic!"
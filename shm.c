@@ -0,0 +1,297 @@
+/*
+ * shm.c
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#include "shm.h"
+#include "mm.h"
+#include "mm_phys.h"
+#include "scheduler.h"
+#include "hal.h"
+#include "string.h"
+
+/* Table of named objects */
+static K_SHM_OBJECT	*shm_objects[SHM_MAX_OBJECTS];
+static K_SPINLOCK	shm_lock;
+
+/*
+ * Prototypes
+ */
+static K_SHM_OBJECT *shm_find_object(char *name);
+static HRESULT shm_release(K_SHM_OBJECT *obj);
+
+HRESULT __nxapi shm_initialize()
+{
+	memset(shm_objects, 0, sizeof(shm_objects));
+	spinlock_create(&shm_lock);
+
+	return S_OK;
+}
+
+/*
+ * Must be called with shm_lock held.
+ */
+static K_SHM_OBJECT *shm_find_object(char *name)
+{
+	for (uint32_t i=0; i<SHM_MAX_OBJECTS; i++) {
+		if (shm_objects[i] && strcmp(shm_objects[i]->name, name) == 0) {
+			return shm_objects[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Drops a reference. When it was the last one, the object is removed from
+ * the table and it's frames are returned to the physical memory manager.
+ * Must be called with shm_lock held.
+ */
+static HRESULT shm_release(K_SHM_OBJECT *obj)
+{
+	HRESULT hr;
+
+	if (obj->ref_count == 0) {
+		HalKernelPanic("shm_release(): reference count underflow.");
+	}
+
+	if (--obj->ref_count > 0) {
+		return S_OK;
+	}
+
+	for (uint32_t i=0; i<SHM_MAX_OBJECTS; i++) {
+		if (shm_objects[i] == obj) {
+			shm_objects[i] = NULL;
+			break;
+		}
+	}
+
+	hr = kpmm_unmark_blocks((void*)obj->phys_addr, obj->size / KPMM_BLOCK_SIZE);
+	kfree(obj);
+
+	return hr;
+}
+
+HRESULT __nxapi shm_find_map_address(void *proc_desc, size_t size, uintptr_t *out)
+{
+	K_PROCESS	*proc = proc_desc;
+	HRESULT		hr;
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, &proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	if (proc->mode == PROCESS_MODE_KERNEL) {
+		return vmm_find_free_range(proc, KERNEL_IPC_START, KERNEL_IPC_END, size, out);
+	}
+
+	return vmm_find_free_range(proc, USER_IPC_START, USER_IPC_END, size, out);
+}
+
+HRESULT __nxapi shm_create(char *name, size_t size, uint32_t flags, K_SHM_OBJECT **out)
+{
+	K_SHM_OBJECT	*obj = NULL;
+	void			*phys;
+	uint32_t		slot, intf;
+	HRESULT			hr;
+
+	if (!name || !out) {
+		return E_POINTER;
+	}
+
+	if (size == 0 || strlen(name) == 0 || strlen(name) >= SHM_MAX_NAME_LENGTH) {
+		return E_INVALIDARG;
+	}
+
+	/* Round up to page size */
+	size = (size + VM_PAGE_FRAME_SIZE - 1) & ~(VM_PAGE_FRAME_SIZE - 1);
+
+	intf = spinlock_acquire(&shm_lock);
+
+	if (shm_find_object(name) != NULL) {
+		hr = E_ACCESSDENIED;
+		goto finally;
+	}
+
+	/* Find a free slot */
+	for (slot=0; slot<SHM_MAX_OBJECTS; slot++) {
+		if (shm_objects[slot] == NULL) break;
+	}
+
+	if (slot == SHM_MAX_OBJECTS) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	if (!(obj = kcalloc(sizeof(K_SHM_OBJECT)))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	/* Allocate the frames */
+	hr = kpmm_alloc(size / KPMM_BLOCK_SIZE, &phys);
+	if (FAILED(hr)) goto finally;
+
+	strcpy(obj->name, name);
+	obj->phys_addr	= (uintptr_t)phys;
+	obj->size		= size;
+	obj->flags		= flags;
+	obj->ref_count	= 1;
+
+	shm_objects[slot] = obj;
+	*out = obj;
+
+finally:
+	if (FAILED(hr) && obj) {
+		kfree(obj);
+	}
+
+	spinlock_release(&shm_lock, intf);
+
+	/* Physical memory manager doesn't clear frames, so do it here
+	 * in order not to leak stale data between processes.
+	 */
+	if (SUCCEEDED(hr)) {
+		uintptr_t	va;
+
+		if (SUCCEEDED(vmm_temp_map_region(NULL, obj->phys_addr, obj->size, &va))) {
+			memset((void*)va, 0, obj->size);
+			vmm_unmap_region(NULL, va, 1);
+		}
+	}
+
+	return hr;
+}
+
+HRESULT __nxapi shm_open(char *name, K_SHM_OBJECT **out)
+{
+	K_SHM_OBJECT	*obj;
+	uint32_t		intf;
+
+	if (!name || !out) {
+		return E_POINTER;
+	}
+
+	intf = spinlock_acquire(&shm_lock);
+
+	if ((obj = shm_find_object(name)) != NULL) {
+		obj->ref_count++;
+	}
+
+	spinlock_release(&shm_lock, intf);
+
+	if (!obj) {
+		return E_NOTFOUND;
+	}
+
+	*out = obj;
+	return S_OK;
+}
+
+HRESULT __nxapi shm_close(K_SHM_OBJECT **obj)
+{
+	uint32_t	intf;
+	HRESULT		hr;
+
+	if (!obj || !*obj) {
+		return E_POINTER;
+	}
+
+	intf = spinlock_acquire(&shm_lock);
+	hr = shm_release(*obj);
+	spinlock_release(&shm_lock, intf);
+
+	*obj = NULL;
+	return hr;
+}
+
+HRESULT __nxapi shm_map(K_SHM_OBJECT *obj, void *proc_desc, K_VMM_ACCESS_FLAG access, void **out)
+{
+	K_PROCESS	*proc = proc_desc;
+	uintptr_t	va;
+	uint32_t	intf;
+	HRESULT		hr;
+
+	if (!obj || !out) {
+		return E_POINTER;
+	}
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, &proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	intf = spinlock_acquire(&shm_lock);
+
+	if (obj->mapping_count == SHM_MAX_MAPPINGS) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	hr = shm_find_map_address(proc, obj->size, &va);
+	if (FAILED(hr)) goto finally;
+
+	/* Map shared frames. The region is not AUTOFREE, since frames are
+	 * owned by the object.
+	 */
+	hr = vmm_map_region(proc, obj->phys_addr, va, obj->size,
+			proc->mode == PROCESS_MODE_KERNEL ? USAGE_KERNEL | USAGE_DATA : USAGE_USER | USAGE_DATA,
+			access, TRUE);
+	if (FAILED(hr)) goto finally;
+
+	obj->mappings[obj->mapping_count].proc		= proc;
+	obj->mappings[obj->mapping_count].virt_addr	= va;
+	obj->mapping_count++;
+	obj->ref_count++;
+
+	*out = (void*)va;
+
+finally:
+	spinlock_release(&shm_lock, intf);
+	return hr;
+}
+
+HRESULT __nxapi shm_unmap(void *proc_desc, void *addr)
+{
+	K_PROCESS	*proc = proc_desc;
+	uint32_t	intf;
+	HRESULT		hr;
+
+	if (proc == NULL) {
+		hr = sched_get_process_by_id(0, &proc);
+		if (FAILED(hr)) return hr;
+	}
+
+	intf = spinlock_acquire(&shm_lock);
+
+	/* Find the object, which owns this mapping */
+	for (uint32_t i=0; i<SHM_MAX_OBJECTS; i++) {
+		K_SHM_OBJECT *obj = shm_objects[i];
+
+		if (!obj) continue;
+
+		for (uint32_t j=0; j<obj->mapping_count; j++) {
+			if (obj->mappings[j].proc != proc || obj->mappings[j].virt_addr != (uintptr_t)addr) {
+				continue;
+			}
+
+			hr = vmm_unmap_region(proc, (uintptr_t)addr, TRUE);
+			if (FAILED(hr)) goto finally;
+
+			/* Remove mapping entry */
+			obj->mappings[j] = obj->mappings[--obj->mapping_count];
+
+			hr = shm_release(obj);
+			goto finally;
+		}
+	}
+
+	hr = E_NOTFOUND;
+
+finally:
+	spinlock_release(&shm_lock, intf);
+	return hr;
+}
@@ -5,6 +5,7 @@
  *      Author: Anton Angelov
  */
 #include <mm.h>
+#include <kdbg.h>
 #include "henjin_control.h"
 
 /*
@@ -157,6 +158,22 @@ HRESULT __nxapi hj_control_invalidate_rect2(HJ_CONTROL *control, HJ_RECT rect, N
 	return hj_queue_message(control, &msg);
 }
 
+HRESULT __nxapi hj_control_invalidate_region(HJ_CONTROL *control, const NXGI_REGION *rgn)
+{
+	const NXGI_RECT	*rects;
+	uint32_t		count;
+	uint32_t		i;
+	HRESULT			hr = S_OK;
+
+	rects = nxgig_region_rects(rgn, &count);
+
+	for (i=0; i<count && SUCCEEDED(hr); i++) {
+		hr = hj_control_invalidate_rect(control, rects[i]);
+	}
+
+	return hr;
+}
+
 HRESULT __nxapi hj_control_resize(HJ_CONTROL *control, HJ_SIZE new_size)
 {
 	HJ_MESSAGE msg = { 0 };
@@ -469,7 +486,7 @@ HRESULT __nxapi hj_control_request_parent_repaint(HJ_CONTROL *this, HJ_RECT *dir
 	HRESULT				hr;
 
 	if (!this->parent_feedback) {
-		k_printf("no parent feedback func\n");
+		dbg_printf("no parent feedback func\n");
 		return E_NOTSUPPORTED;
 	}
 
@@ -483,7 +500,7 @@ HRESULT __nxapi hj_control_request_parent_repaint(HJ_CONTROL *this, HJ_RECT *dir
 	}
 
 	hr = this->parent_feedback(this->parent, this, &msg);
-	k_printf("parent feedback func: hr=%x\n", hr);
+	dbg_printf("parent feedback func: hr=0x%X\n", hr);
 	return hr;
 }
 
@@ -517,7 +534,25 @@ finally:
 	mutex_unlock(&target->children_lock);
 	return index;
 }
-HRESULT __nxapi hj_control_get_unoccluded_region(HJ_CONTROL *ctrl, DOUBLE_LIST *target)
+HRESULT __nxapi hj_control_get_unoccluded_region(HJ_CONTROL *ctrl, NXGI_REGION *target)
 {
-	//todo
+	HJ_SIZE		s = hj_control_get_size(ctrl);
+	uint32_t	cnt;
+	uint32_t	i;
+	HRESULT		hr;
+
+	hr = nxgig_region_set_rect(target, RECT(0, 0, s.width, s.height));
+	if (FAILED(hr)) return hr;
+
+	mutex_lock(&ctrl->children_lock);
+
+	cnt = dlist_get_count(ctrl->children);
+
+	for (i=0; i<cnt && !nxgig_region_empty(target); i++) {
+		hr = nxgig_region_subtract_rect(target, target, hj_get_child_boundsrect(ctrl, i));
+		if (FAILED(hr)) break;
+	}
+
+	mutex_unlock(&ctrl->children_lock);
+	return hr;
 }
@@ -221,6 +221,11 @@ int32_t __nxapi hj_child_find(HJ_CONTROL *target, HJ_CONTROL *child);
  */
 HRESULT __nxapi hj_control_invalidate_rect(HJ_CONTROL *control, HJ_RECT rect);
 HRESULT __nxapi hj_control_invalidate_rect2(HJ_CONTROL *control, HJ_RECT rect, NXGI_GRAPHICS_CONTEXT *gc);
+
+/**
+ * Sends a REPAINT message for each rectangle of the region.
+ */
+HRESULT __nxapi hj_control_invalidate_region(HJ_CONTROL *control, const NXGI_REGION *rgn);
 HRESULT __nxapi hj_control_resize(HJ_CONTROL *control, HJ_SIZE new_size);
 NXGI_GRAPHICS_CONTEXT __nxapi *hj_control_get_gc(HJ_CONTROL *control);
 HRESULT __nxapi hj_control_get_theme(HJ_CONTROL *control, HJ_COLOR_PRESET *theme);
@@ -242,9 +247,10 @@ HRESULT __nxapi hj_control_free_surface(HJ_CONTROL *control);
  * by any child control. The region is described in local (client)
  * space coordinates.
  *
- * Region is described as list of axis-aligned rectangles.
+ * The region is written to `target`, which must be initialized
+ * (see nxgig_region_init()).
  */
-HRESULT __nxapi hj_control_get_unoccluded_region(HJ_CONTROL *ctrl, DOUBLE_LIST *target);
+HRESULT __nxapi hj_control_get_unoccluded_region(HJ_CONTROL *ctrl, NXGI_REGION *target);
 
 HRESULT __nxapi hj_control_request_parent_repaint(HJ_CONTROL *this, HJ_RECT *dirty_rect);
 
@@ -13,6 +13,9 @@
 #include "henjin_desktop.h"
 #include "henjin_taskpanel.h"
 
+/* Longest time (ms) damage may wait for present while messages keep coming */
+#define DESKTOP_PRESENT_INTERVAL	50
+
 /*
  * Prototypes
  */
@@ -107,7 +110,9 @@ static HRESULT desktop_allocate_graphics_context(HJ_DESKTOP *this)
 {
 	HRESULT hr;
 
-	/* We will draw directly to the frame-buffer */
+	/* We draw to the screen's back buffer, nxgi_present() copies the
+	 * damaged parts of it to the frame-buffer.
+	 */
 	hr = nxgi_get_screen(&this->control.surface);
 	if (FAILED(hr)) return hr;
 
@@ -160,6 +165,7 @@ VOID hj_desktop_thread_proc()
 	HJ_DESKTOP	*desktop;
 	HJ_MESSAGE	msg;
 	HRESULT 	hr;
+	uint32_t	last_present = 0;
 
 	extern
 	HJ_SERVER_CONTEXT __hj_server;
@@ -174,7 +180,10 @@ VOID hj_desktop_thread_proc()
 		hr = hj_get_message(&desktop->control, &msg);
 
 		if (hr == E_BUFFERUNDERFLOW) {
-			/* Queue is empty */
+			/* Queue is empty, show what was drawn */
+			nxgi_present(FALSE);
+			last_present = timer_gettickcount();
+
 			sched_yield();
 			continue;
 		}else if (FAILED(hr)) {
@@ -183,9 +192,15 @@ VOID hj_desktop_thread_proc()
 
 		hr = hj_process_message(&desktop->control, &msg);
 		if (FAILED(hr)) {
-			k_printf("msg type=%x\n", msg.type);
+			k_printf("msg type=0x%X\n", msg.type);
 			HalKernelPanic("hj_desktop_thread_proc(): failed to process message.");
 		}
+
+		/* Don't let a flood of messages (e.g. dragging) hold back the screen */
+		if (timer_gettickcount() - last_present >= DESKTOP_PRESENT_INTERVAL) {
+			nxgi_present(FALSE);
+			last_present = timer_gettickcount();
+		}
 	}
 }
 
@@ -225,8 +240,8 @@ static HRESULT desktop_message_handler(HJ_OBJECT *this, HJ_MESSAGE *msg)
 				}
 
 				if (msg->lock.event) {
-					k_printf("before signal event=%x; sizeof(msg) = %d\n", msg->lock.event, sizeof(HJ_MESSAGE));
-					k_printf("&sl=%x; autoreset=%x, sl_state=%x; owner=%x\n", &msg->lock.event->lock, (uint32_t)msg->lock.event->autoreset, msg->lock.event->lock.lock, (uint32_t)msg->lock.event->owner_pid);
+					k_printf("before signal event=0x%X; sizeof(msg) = %d\n", msg->lock.event, sizeof(HJ_MESSAGE));
+					k_printf("&sl=0x%X; autoreset=0x%X, sl_state=0x%X; owner=0x%X\n", &msg->lock.event->lock, (uint32_t)msg->lock.event->autoreset, msg->lock.event->lock.lock, (uint32_t)msg->lock.event->owner_pid);
 					event_signal(msg->lock.event);
 					k_printf("after signal..");
 				}
@@ -293,13 +308,25 @@ static HRESULT desktop_repaint(HJ_DESKTOP *d, HJ_RECT rect)
 	hr = desktop_repaint_subcontrols(d, rect);
 	if (FAILED(hr)) return hr;
 
-	/* Print draw time */
-	char draw_time_str[256];
-	sprintf(draw_time_str, "Draw time: %d ms", (uint32_t)(timer_gettickcount()-draw_time));
+	/* Print draw time and present rate */
+	char				draw_time_str[256];
+	NXGI_PRESENT_STATS	stats = {0};
+	NXGI_SIZE			text_size;
+
+	nxgi_get_present_stats(&stats);
+	sprintf(draw_time_str, "Draw time: %d ms, %d fps, %d KB/frame", (uint32_t)(timer_gettickcount()-draw_time),
+			stats.fps, stats.last_bytes / 1024);
 	nxgi_set_clip_rect(d->gc, d->bounds_rect);
 	nxgi_draw_text(d->gc, POINT(25, 70), draw_time_str);
 	nxgi_set_clip_rect(d->gc, rect);
 
+	/* Mark what we've drawn for presenting */
+	nxgi_invalidate_screen(rect);
+
+	if (SUCCEEDED(nxgi_text_size(d->gc, draw_time_str, &text_size))) {
+		nxgi_invalidate_screen(RECT(25, 70, 25 + text_size.width, 70 + text_size.height));
+	}
+
 	/* Draw mouse pointer */
 	NXGI_RECT mouse_rect = RECT(d->mouse_pos.x + 4, d->mouse_pos.y + 4, d->mouse_pos.x + 12, d->mouse_pos.y + 12);
 	nxgi_set_color(d->gc, COLOR(255, 0, 0, 255));
@@ -334,6 +361,27 @@ static HRESULT desktop_repaint(HJ_DESKTOP *d, HJ_RECT rect)
 	return S_OK;
 }
 
+/*
+ * Repaints the pixels covered by either area. Unlike their bounding rect,
+ * the union doesn't include the corners outside both of them.
+ */
+static void desktop_invalidate_areas(HJ_CONTROL *c, HJ_RECT a, HJ_RECT b)
+{
+	NXGI_REGION dirty;
+
+	nxgig_region_init(&dirty);
+
+	if (SUCCEEDED(nxgig_region_set_rect(&dirty, a)) && SUCCEEDED(nxgig_region_union_rect(&dirty, &dirty, b))) {
+		hj_control_invalidate_region(c, &dirty);
+	} else {
+		/* Out of memory */
+		hj_control_invalidate_rect(c, a);
+		hj_control_invalidate_rect(c, b);
+	}
+
+	nxgig_region_fini(&dirty);
+}
+
 static HRESULT desktop_mouse_move(HJ_DESKTOP *d, HJ_POINT pos)
 {
 	HJ_RECT old_area = RECT(d->mouse_pos.x, d->mouse_pos.y, d->mouse_pos.x + 16, d->mouse_pos.y + 16);
@@ -341,19 +389,7 @@ static HRESULT desktop_mouse_move(HJ_DESKTOP *d, HJ_POINT pos)
 
 	d->mouse_pos = pos;
 
-	/* Unify both dirty rects */
-	NXGI_RECT unified_dirty_rect = nxgig_rects_union(old_area, new_area);
-
-	if (nxgig_rect_area(unified_dirty_rect) < nxgig_rect_area(old_area) + nxgig_rect_area(new_area)) {
-		/* It's more feasible to draw the unified area as a whole, since this
-		 * will modify less square pixels.
-		 */
-		hj_control_invalidate_rect(&d->control, unified_dirty_rect);
-	} else {
-		/* Repaint both areas separately */
-		hj_control_invalidate_rect(&d->control, old_area);
-		hj_control_invalidate_rect(&d->control, new_area);
-	}
+	desktop_invalidate_areas(&d->control, old_area, new_area);
 
 	/* Move windows, if dragged */
 	desktop_mouse_move_handle_dragging(d, pos);
@@ -659,7 +695,7 @@ static HRESULT desktop_mouse_move_handle_dragging(HJ_DESKTOP *d, HJ_POINT pos)
 		hj_control_set_child_position(c, k, new_pos);
 
 		new_br = hj_get_child_boundsrect(c, k);
-		hj_control_invalidate_rect(c, nxgig_rects_union(br, new_br));
+		desktop_invalidate_areas(c, br, new_br);
 	}
 
 unlock:
@@ -695,10 +731,9 @@ static HRESULT desktop_mouse_up(HJ_DESKTOP *d, HJ_POINT pos)
 
 static HRESULT desktop_load_wallpaper1(HJ_DESKTOP *this, HJ_COLOR c1, HJ_COLOR c2, HJ_COLOR c3, HJ_COLOR c4)
 {
-//	NXGI_GRAPHICS_CONTEXT	*temp_gc;
-	NXGI_BITMAP				*b;
-	uint8_t					*ptr;
-	uint32_t				i, j;
+	NXGI_GRAPHICS_CONTEXT	*temp_gc = NULL;
+	NXGI_BITMAP				*corners = NULL;
+	NXGI_COLOR				*px;
 	HRESULT 				hr;
 
 	if (RECT_WIDTH(this->bounds_rect) == 0 || RECT_HEIGHT(this->bounds_rect) == 0) {
@@ -712,42 +747,33 @@ static HRESULT desktop_load_wallpaper1(HJ_DESKTOP *this, HJ_COLOR c1, HJ_COLOR c
 	hr = nxgi_create_bitmap(RECT_WIDTH(this->bounds_rect), RECT_HEIGHT(this->bounds_rect), nxgi_internal_format(), &this->wallpaper);
 	if (FAILED(hr)) return hr;
 
-//	hr = nxgi_create_graphics_context(&temp_gc);
-//	if (FAILED(hr)) return hr;
-
-	b = this->wallpaper;
-//
-//	hr = nxgi_set_target(temp_gc, this->wallpaper);
-//	if (FAILED(hr)) goto finally;
+	/* The gradient is a 2x2 bitmap of the corner colors, stretched
+	 * bilinearly over the whole wallpaper.
+	 */
+	hr = nxgi_create_bitmap(2, 2, nxgi_internal_format(), &corners);
+	if (FAILED(hr)) goto finally;
 
-	for (j=0; j<b->height; j++) {
-		NXGI_COLOR cl, cr, c;
+	px = corners->pBits;
+	px[0] = c1;
+	px[1] = c2;
+	px[2] = c3;
+	px[3] = c4;
 
-		ptr = (uint8_t*)b->pBits + b->stride * j;
+	hr = nxgi_create_graphics_context(&temp_gc);
+	if (FAILED(hr)) goto finally;
 
-		cl.r = (int32_t)c1.r + ((int32_t)c3.r - c1.r) * ((float)j / b->height);
-		cl.g = (int32_t)c1.g + ((int32_t)c3.g - c1.g) * ((float)j / b->height);
-		cl.b = (int32_t)c1.b + ((int32_t)c3.b - c1.b) * ((float)j / b->height);
-		cl.a = (int32_t)c1.a + ((int32_t)c3.a - c1.a) * ((float)j / b->height);
+	hr = nxgi_set_target(temp_gc, this->wallpaper);
+	if (FAILED(hr)) goto finally;
 
-		cr.r = (int32_t)c2.r + ((int32_t)c4.r - c2.r) * ((float)j / b->height);
-		cr.g = (int32_t)c2.g + ((int32_t)c4.g - c2.g) * ((float)j / b->height);
-		cr.b = (int32_t)c2.b + ((int32_t)c4.b - c2.b) * ((float)j / b->height);
-		cr.a = (int32_t)c2.a + ((int32_t)c4.a - c2.a) * ((float)j / b->height);
+	hr = nxgi_set_filter(temp_gc, NXGI_FILTER_BILINEAR);
+	if (FAILED(hr)) goto finally;
 
-		for (i=0; i<b->width; i++) {
-			c.r = (int32_t)cl.r + ((int32_t)cr.r - cl.r) * ((float)i/b->width);
-			c.g = (int32_t)cl.g + ((int32_t)cr.g - cl.g) * ((float)i/b->width);
-			c.b = (int32_t)cl.b + ((int32_t)cr.b - cl.b) * ((float)i/b->width);
-			c.a = (int32_t)cl.a + ((int32_t)cr.a - cl.a) * ((float)i/b->width);
-
-			*(NXGI_COLOR*)ptr = c;
-			ptr += b->bits_per_pixel / 4;
-		}
-	}
+	hr = nxgi_stretchblt(temp_gc, RECT(0, 0, this->wallpaper->width, this->wallpaper->height), corners, RECT(0, 0, 2, 2));
 
 finally:
-//	nxgi_destroy_graphics_context(temp_gc);
+	if (temp_gc) nxgi_destroy_graphics_context(temp_gc);
+	if (corners) nxgi_destroy_bitmap(&corners);
+
 	return hr;
 }
 
@@ -84,7 +84,7 @@ static HRESULT taskpan_resize(HJ_TASKPANEL *this, HJ_SIZE new_size, NXGI_FORMAT
 //		/* Nothing to worry about. Anything at all... */
 //		return S_OK;
 //	}
-//	k_printf("0: hr=%x\n", 0);
+//	k_printf("0: hr=0x%X\n", 0);
 //
 //
 //	if (this->control.gc) {
@@ -106,15 +106,15 @@ static HRESULT taskpan_resize(HJ_TASKPANEL *this, HJ_SIZE new_size, NXGI_FORMAT
 //
 //	/* Allocate */
 //	hr = nxgi_create_bitmap(new_size.width, new_size.height, pixel_format, &this->control.surface);
-//	k_printf("1: hr=%x\n", hr);
+//	k_printf("1: hr=0x%X\n", hr);
 //	if (FAILED(hr)) return hr;
 //
 //	hr = nxgi_create_graphics_context(&this->control.gc);
-//	k_printf("2: hr=%x\n", hr);
+//	k_printf("2: hr=0x%X\n", hr);
 //	if (FAILED(hr)) return hr;
 //
 //	hr = nxgi_set_target(this->control.gc, this->control.surface);
-//	k_printf("3: hr=%x\n", hr);
+//	k_printf("3: hr=0x%X\n", hr);
 //	if (FAILED(hr)) return hr;
 //
 //	/* Update size */
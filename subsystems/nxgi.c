@@ -7,9 +7,15 @@
  *      Author: Anton Angelov
  */
 #include <mm.h>
+#include <string.h>
+#include <stdlib.h>
+#include <timer.h>
 #include <kstdio.h>
 #include "nxgi.h"
 #include "nxgi_graphics.h"
+#include "nxgi_span.h"
+#include "nxgi_blend.h"
+#include "nxgi_convert.h"
 
 static NXGI_CONTEXT nxgi_context;
 
@@ -92,7 +98,7 @@ HRESULT __nxapi nxgi_destroy_bitmap_impl(NXGI_BITMAP **ppBmp)
 
 HRESULT __nxapi nxgi_destroy_screensurf_impl(NXGI_BITMAP **ppBmp)
 {
-	/* Do nothing */
+	/* Do nothing, it's freed by nxgi_fini() */
 	UNUSED_ARG(ppBmp);
 
 	*ppBmp = NULL;
@@ -108,6 +114,43 @@ HRESULT __nxapi nxgi_destroy_bitmap(NXGI_BITMAP **ppBmp)
 	return bmp->destroy(ppBmp);
 }
 
+/*
+ * Converts a bitmap to premultiplied alpha, which alphablend expects.
+ */
+HRESULT __nxapi nxgi_premultiply_bitmap(NXGI_BITMAP *pBmp)
+{
+	uint8_t 	*row = pBmp->pBits;
+	uint32_t	y;
+
+	if (pBmp->format != NXGI_FORMAT_BGRA32) {
+		return E_NOTIMPL;
+	}
+
+	for (y=0; y<pBmp->height; y++) {
+		nxgi_blend_premultiply((uint32_t*)row, pBmp->width);
+		row += pBmp->stride;
+	}
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_unpremultiply_bitmap(NXGI_BITMAP *pBmp)
+{
+	uint8_t 	*row = pBmp->pBits;
+	uint32_t	y;
+
+	if (pBmp->format != NXGI_FORMAT_BGRA32) {
+		return E_NOTIMPL;
+	}
+
+	for (y=0; y<pBmp->height; y++) {
+		nxgi_blend_unpremultiply((uint32_t*)row, pBmp->width);
+		row += pBmp->stride;
+	}
+
+	return S_OK;
+}
+
 /*
  * NXGI Graphics Context dispatch methods
  */
@@ -143,16 +186,23 @@ HRESULT __nxapi nxgi_get_color(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COLOR *pColor)
 
 HRESULT __nxapi nxgi_draw_line(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
 {
+	/* Not every target format can be drawn on */
+	if (!gc->draw_line) return E_NOTIMPL;
+
 	return gc->draw_line(gc, x1, y1, x2, y2);
 }
 
 HRESULT __nxapi nxgi_draw_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect)
 {
+	if (!gc->draw_rect) return E_NOTIMPL;
+
 	return gc->draw_rect(gc, rect);
 }
 
 HRESULT __nxapi nxgi_fill_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect)
 {
+	if (!gc->fill_rect) return E_NOTIMPL;
+
 	return gc->fill_rect(gc, rect);
 }
 
@@ -163,14 +213,25 @@ HRESULT __nxapi nxgi_bitblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_
 
 HRESULT __nxapi nxgi_stretchblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
 {
+	if (!gc->stretchblt) return E_NOTIMPL;
+
 	return gc->stretchblt(gc, dst_rect, pSrcBitmap, src_rect);
 }
 
 HRESULT __nxapi nxgi_alphablend(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
 {
+	if (!gc->alphablend) return E_NOTIMPL;
+
 	return gc->alphablend(gc, dst_pos, pSrcBitmap, src_rect);
 }
 
+HRESULT __nxapi nxgi_fill_mask(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size)
+{
+	if (!gc->fill_mask) return E_NOTIMPL;
+
+	return gc->fill_mask(gc, dst_pos, mask, mask_stride, size);
+}
+
 HRESULT __nxapi nxgi_set_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT offset)
 {
 	return gc->set_offset(gc, offset);
@@ -214,6 +275,10 @@ HRESULT __nxapi nxgi_init(uint32_t xres, uint32_t yres, NXGI_FORMAT fmt)
 	K_VIDEO_MODE_DESC 	desc;
 	HRESULT				hr;
 
+	/* Pick span kernels and format converters for the CPU */
+	nxgi_span_initialize();
+	nxgi_convert_initialize();
+
 	/* Open handle to video driver */
 	hr = k_fopen("/dev/video0", FILE_OPEN_READ, &c->graphics_drv);
 	if (FAILED(hr)) {
@@ -235,28 +300,30 @@ HRESULT __nxapi nxgi_init(uint32_t xres, uint32_t yres, NXGI_FORMAT fmt)
 	/* Get effective video mode */
 	get_graphics_iface()->get_mode(get_graphics_iface(), &desc);
 
-	/* Create screen surface */
+	/*
+	 * Create screen surface. We draw into a back buffer in cached memory,
+	 * since the frame buffer is slow to read. It is BGRA32 whatever the
+	 * mode's format is, the driver converts when presenting.
+	 */
 	NXGI_BITMAP *ss;
-	if (!(ss = kcalloc(sizeof(NXGI_BITMAP)))) {
+
+	hr = nxgi_create_bitmap(desc.width, desc.height, NXGI_FORMAT_BGRA32, &ss);
+	if (FAILED(hr)) {
 		k_fclose(&nxgi_context.graphics_drv);
-		return E_OUTOFMEM;
+		return hr;
 	}
 
-	/* Populate fields */
-	ss->width = desc.width;
-	ss->height = desc.height;
-	ss->format = desc.format;
-	ss->bits_per_pixel = desc.bpp;
+	memset(ss->pBits, 0, ss->stride * ss->height);
 	ss->tag = NXGI_BITMAP_TAG_SCREEN_SURFACE;
 	ss->destroy = nxgi_destroy_screensurf_impl;
 
-	/* Get LFB pointer */
-	hr = get_graphics_iface()->lock_fb(get_graphics_iface(), VIDEO_LOCK_WRITE | VIDEO_LOCK_READ, &ss->pBits, &ss->stride);
-	if (FAILED(hr)) {
-		kfree(ss);
-		k_fclose(&nxgi_context.graphics_drv);
-		return hr;
-	}
+	/* The frame buffer holds garbage, so all of it is damaged */
+	mutex_create(&c->damage_lock);
+	memset(&c->stats, 0, sizeof(c->stats));
+	c->stats_time = timer_gettickcount();
+	c->stats_frames = 0;
+	c->damage[0] = RECT(0, 0, desc.width, desc.height);
+	c->damage_count = 1;
 
 	nxgi_context.screen_surf = ss;
 	return S_OK;
@@ -264,14 +331,11 @@ HRESULT __nxapi nxgi_init(uint32_t xres, uint32_t yres, NXGI_FORMAT fmt)
 
 HRESULT __nxapi nxgi_fini()
 {
-	if (nxgi_context.graphics_drv != NULL) {
-		get_graphics_iface()->unlock_fb(get_graphics_iface());
-	}
-
 	if (nxgi_context.screen_surf != NULL) {
 		/* Free screen surface */
-		kfree(nxgi_context.screen_surf);
-		nxgi_context.screen_surf = NULL;
+		mutex_destroy(&nxgi_context.damage_lock);
+		nxgi_destroy_bitmap_impl(&nxgi_context.screen_surf);
+		nxgi_context.damage_count = 0;
 	}
 
 	if (nxgi_context.graphics_drv != NULL) {
@@ -337,6 +401,8 @@ NXGI_COLOR COLOR(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 
 HRESULT __nxapi nxgi_draw_text(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, char *text)
 {
+	if (!gc->draw_text) return E_NOTIMPL;
+
 	return gc->draw_text(gc, pos, text);
 }
 
@@ -355,6 +421,264 @@ HRESULT __nxapi nxgi_get_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_
 	return gc->get_font(gc, font_params_out);
 }
 
+HRESULT __nxapi nxgi_set_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER filter)
+{
+	return gc->set_filter(gc, filter);
+}
+
+HRESULT __nxapi nxgi_get_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER *filter_out)
+{
+	return gc->get_filter(gc, filter_out);
+}
+
+HRESULT __nxapi nxgi_set_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE op, uint8_t alpha)
+{
+	return gc->set_composite(gc, op, alpha);
+}
+
+HRESULT __nxapi nxgi_get_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE *op_out, uint8_t *alpha_out)
+{
+	return gc->get_composite(gc, op_out, alpha_out);
+}
+
+/*
+ * Adds a rectangle to the damage list, keeping the list disjoint: only the
+ * parts not already damaged are added. If the list overflows, it's
+ * replaced by the bounding rectangle of everything.
+ */
+HRESULT __nxapi nxgi_invalidate_screen(NXGI_RECT rect)
+{
+	NXGI_CONTEXT	*c = &nxgi_context;
+	NXGI_RECT		frag[NXGI_MAX_DAMAGE_RECTS], out[4], bounds;
+	uint32_t		i, j, k, n, cnt = 1;
+
+	if (c->screen_surf == NULL) {
+		return E_INVALIDSTATE;
+	}
+
+	rect = nxgig_rect_intersection(rect, RECT(0, 0, c->screen_surf->width, c->screen_surf->height));
+	if (nxgig_rect_empty(rect)) {
+		return S_FALSE;
+	}
+
+	mutex_lock(&c->damage_lock);
+
+	/* Cut the damaged rects out of the new one */
+	frag[0] = rect;
+
+	for (i=0; i<c->damage_count && cnt > 0; i++) {
+		for (j=0, k=cnt; j<k; j++) {
+			n = nxgig_rect_subtract(frag[j], c->damage[i], out);
+
+			if (cnt + n > NXGI_MAX_DAMAGE_RECTS) {
+				goto merge;
+			}
+
+			/* The first piece replaces the fragment, the rest are appended */
+			if (n == 0) {
+				frag[j] = RECT(0, 0, 0, 0);
+			} else {
+				frag[j] = out[0];
+				while (--n > 0) frag[cnt++] = out[n];
+			}
+		}
+	}
+
+	for (j=0; j<cnt; j++) {
+		if (nxgig_rect_empty(frag[j])) continue;
+
+		if (c->damage_count == NXGI_MAX_DAMAGE_RECTS) {
+			goto merge;
+		}
+
+		c->damage[c->damage_count++] = frag[j];
+	}
+
+	mutex_unlock(&c->damage_lock);
+	return S_OK;
+
+merge:
+	bounds = rect;
+
+	for (i=0; i<c->damage_count; i++) {
+		bounds = nxgig_rects_union(bounds, c->damage[i]);
+	}
+
+	c->damage[0] = bounds;
+	c->damage_count = 1;
+
+	mutex_unlock(&c->damage_lock);
+	return S_OK;
+}
+
+/*
+ * Hands the damaged rectangles of the screen surface to the driver, which
+ * copies them to the frame buffer.
+ */
+HRESULT __nxapi nxgi_present(BOOL sync)
+{
+	NXGI_CONTEXT			*c = &nxgi_context;
+	K_VIDEO_DRIVER_IFACE	*iface;
+	K_VIDEO_RECT			rects[NXGI_MAX_DAMAGE_RECTS];
+	K_VIDEO_PRESENT_DESC	desc;
+	uint32_t				i, now;
+	HRESULT					hr;
+
+	if (c->screen_surf == NULL || (iface = get_graphics_iface()) == NULL) {
+		return E_INVALIDSTATE;
+	}
+
+	mutex_lock(&c->damage_lock);
+
+	if (c->damage_count == 0) {
+		mutex_unlock(&c->damage_lock);
+		return S_FALSE;
+	}
+
+	for (i=0; i<c->damage_count; i++) {
+		rects[i].x1 = c->damage[i].x1;
+		rects[i].y1 = c->damage[i].y1;
+		rects[i].x2 = c->damage[i].x2;
+		rects[i].y2 = c->damage[i].y2;
+	}
+
+	desc.bits = c->screen_surf->pBits;
+	desc.stride = c->screen_surf->stride;
+	desc.format = (K_VIDEO_FORMAT)c->screen_surf->format;
+	desc.rects = rects;
+	desc.rect_count = c->damage_count;
+	desc.bytes_written = 0;
+
+	hr = iface->present(iface, &desc, sync);
+	if (FAILED(hr)) {
+		mutex_unlock(&c->damage_lock);
+		return hr;
+	}
+
+	c->damage_count = 0;
+
+	/* Statistics */
+	c->stats.frames++;
+	c->stats.last_bytes = desc.bytes_written;
+	c->stats.total_bytes += desc.bytes_written;
+	c->stats_frames++;
+
+	now = timer_gettickcount();
+	if (now - c->stats_time >= 1000) {
+		c->stats.fps = c->stats_frames * 1000 / (now - c->stats_time);
+		c->stats_frames = 0;
+		c->stats_time = now;
+	}
+
+	mutex_unlock(&c->damage_lock);
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_get_present_stats(NXGI_PRESENT_STATS *stats_out)
+{
+	if (nxgi_context.screen_surf == NULL) {
+		return E_INVALIDSTATE;
+	}
+
+	mutex_lock(&nxgi_context.damage_lock);
+	*stats_out = nxgi_context.stats;
+	mutex_unlock(&nxgi_context.damage_lock);
+
+	return S_OK;
+}
+
+#define PRESENT_BENCH_TIME	1000
+#define PRESENT_BENCH_W		200
+#define PRESENT_BENCH_H		150
+
+/*
+ * Drags a window-sized rectangle across the screen, invalidating either
+ * the rectangles it moved between or the whole screen every frame.
+ */
+static HRESULT present_bench_run(uint8_t *saved, BOOL full, uint32_t *fps_out, uint32_t *bytes_out)
+{
+	NXGI_BITMAP	*ss = nxgi_context.screen_surf;
+	NXGI_RECT	old, cur;
+	uint32_t	start, elapsed, frames = 0, flags = nxgi_span_flags(ss);
+	uint64_t	bytes_before = nxgi_context.stats.total_bytes;
+	int32_t		x = 0, y = 0, dx = 3, dy = 3;
+	HRESULT		hr;
+
+	cur = RECT(0, 0, PRESENT_BENCH_W, PRESENT_BENCH_H);
+	start = timer_gettickcount();
+
+	do {
+		old = cur;
+
+		/* Bounce off the edges */
+		if (x + dx < 0 || x + dx + PRESENT_BENCH_W > (int32_t)ss->width) dx = -dx;
+		if (y + dy < 0 || y + dy + PRESENT_BENCH_H > (int32_t)ss->height) dy = -dy;
+		x += dx;
+		y += dy;
+		cur = RECT(x, y, x + PRESENT_BENCH_W, y + PRESENT_BENCH_H);
+
+		/* Restore the background under the old position and draw the new one */
+		nxgi_span_copy_rect((uint8_t*)ss->pBits + old.y1 * ss->stride + old.x1 * 4, ss->stride,
+				saved + old.y1 * ss->stride + old.x1 * 4, ss->stride, PRESENT_BENCH_W, PRESENT_BENCH_H, flags);
+		nxgi_span_fill_rect((uint8_t*)ss->pBits + cur.y1 * ss->stride + cur.x1 * 4, ss->stride,
+				PRESENT_BENCH_W, PRESENT_BENCH_H, 0xFF3060C0, flags);
+
+		if (full) {
+			nxgi_invalidate_screen(RECT(0, 0, ss->width, ss->height));
+		} else {
+			nxgi_invalidate_screen(old);
+			nxgi_invalidate_screen(cur);
+		}
+
+		hr = nxgi_present(FALSE);
+		if (FAILED(hr)) return hr;
+
+		frames++;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < PRESENT_BENCH_TIME);
+
+	*fps_out = frames * 1000 / elapsed;
+	*bytes_out = (uint32_t)udiv64(nxgi_context.stats.total_bytes - bytes_before, frames, NULL);
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_present_benchmark()
+{
+	NXGI_BITMAP	*ss = nxgi_context.screen_surf;
+	uint8_t		*saved;
+	uint32_t	fps, bytes;
+	HRESULT		hr;
+
+	if (ss == NULL || ss->width < PRESENT_BENCH_W || ss->height < PRESENT_BENCH_H) {
+		return E_INVALIDSTATE;
+	}
+
+	if (!(saved = kmalloc(ss->stride * ss->height))) {
+		return E_OUTOFMEM;
+	}
+
+	memcpy(saved, ss->pBits, ss->stride * ss->height);
+
+	hr = present_bench_run(saved, FALSE, &fps, &bytes);
+	if (FAILED(hr)) goto finally;
+	k_printf("damage: %d fps, %d KB/frame\n", fps, bytes / 1024);
+
+	hr = present_bench_run(saved, TRUE, &fps, &bytes);
+	if (FAILED(hr)) goto finally;
+	k_printf("full: %d fps, %d KB/frame\n", fps, bytes / 1024);
+
+finally:
+	/* Put back what was on the screen */
+	memcpy(ss->pBits, saved, ss->stride * ss->height);
+	kfree(saved);
+
+	nxgi_invalidate_screen(RECT(0, 0, ss->width, ss->height));
+	nxgi_present(FALSE);
+
+	return hr;
+}
+
 NXGI_FORMAT	__nxapi nxgi_internal_format()
 {
 	//TODO: use locks
@@ -10,6 +10,7 @@
 #include <types.h>
 #include <kstream.h>
 #include <devices_video.h>
+#include <syncobjs.h>
 #include "nxgi_geometry.h"
 
 #ifndef SUBSYSTEMS_NXGI_H_
@@ -21,11 +22,20 @@
 typedef enum {
 	NXGI_FORMAT_BGRA32 = VIDEO_FORMAT_BGRA32,
 	NXGI_FORMAT_RGBA32 = VIDEO_FORMAT_RGBA32,
+	NXGI_FORMAT_RGB24 = VIDEO_FORMAT_RGB24,
+	NXGI_FORMAT_RGB565 = VIDEO_FORMAT_RGB565,
+	NXGI_FORMAT_RGB555 = VIDEO_FORMAT_RGB555,
+	NXGI_FORMAT_COUNT = VIDEO_FORMAT_COUNT
 } NXGI_FORMAT;
 
 typedef enum {
 	NXGI_BITMAP_TAG_DEFAULT	= 0x00,
-	NXGI_BITMAP_TAG_SCREEN_SURFACE
+
+	/** Back buffer of the screen, in system memory */
+	NXGI_BITMAP_TAG_SCREEN_SURFACE,
+
+	/** Maps video memory directly, written with non-temporal stores */
+	NXGI_BITMAP_TAG_FRAME_BUFFER
 } NXGI_BITMAP_TAG;
 
 /* Alignment */
@@ -41,6 +51,35 @@ typedef enum {
 	NXGI_VALIGN_BOTTOM
 } NXGI_VALIGN;
 
+/**
+ * Filtering used by stretchblt.
+ */
+typedef enum {
+	NXGI_FILTER_NEAREST = 0,
+	NXGI_FILTER_BILINEAR,
+	NXGI_FILTER_BOX
+} NXGI_FILTER;
+
+/**
+ * Porter-Duff operators used by alphablend. Both source and destination
+ * are premultiplied by alpha.
+ */
+typedef enum {
+	NXGI_COMPOSITE_CLEAR = 0,
+	NXGI_COMPOSITE_SRC,
+	NXGI_COMPOSITE_DST,
+	NXGI_COMPOSITE_SRC_OVER,
+	NXGI_COMPOSITE_DST_OVER,
+	NXGI_COMPOSITE_SRC_IN,
+	NXGI_COMPOSITE_DST_IN,
+	NXGI_COMPOSITE_SRC_OUT,
+	NXGI_COMPOSITE_DST_OUT,
+	NXGI_COMPOSITE_SRC_ATOP,
+	NXGI_COMPOSITE_DST_ATOP,
+	NXGI_COMPOSITE_XOR,
+	NXGI_COMPOSITE_COUNT
+} NXGI_COMPOSITE;
+
 /**
  * Color
  */
@@ -135,6 +174,12 @@ struct NXGI_FONT {
 	uint32_t	reserved;
 };
 
+/* Glyphs of a font at some size, see nxgi_font.h */
+typedef struct NXGI_GLYPH_CACHE NXGI_GLYPH_CACHE;
+
+/* Recorded drawing calls, see nxgi_cmdlist.h */
+typedef struct NXGI_COMMAND_LIST NXGI_COMMAND_LIST;
+
 /**
  * Think of this as some sort of a canvas.
  */
@@ -176,6 +221,9 @@ struct NXGI_GRAPHICS_CONTEXT {
 	//alphablend
 	HRESULT __nxapi (*alphablend)(NXGI_GRAPHICS_CONTEXT *this, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
 
+	//fillmask
+	HRESULT __nxapi (*fill_mask)(NXGI_GRAPHICS_CONTEXT *this, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size);
+
 	//setoffset
 	HRESULT __nxapi (*set_offset)(NXGI_GRAPHICS_CONTEXT *this, NXGI_POINT offset);
 
@@ -200,15 +248,53 @@ struct NXGI_GRAPHICS_CONTEXT {
 	//getfont
 	HRESULT __nxapi (*get_font)(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_out);
 
+	//setfilter
+	HRESULT __nxapi (*set_filter)(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER filter);
+
+	//getfilter
+	HRESULT __nxapi (*get_filter)(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER *filter_out);
+
+	//setcomposite
+	HRESULT __nxapi (*set_composite)(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE op, uint8_t alpha);
+
+	//getcomposite
+	HRESULT __nxapi (*get_composite)(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE *op_out, uint8_t *alpha_out);
+
 	//destructor
 	void __nxapi (*destroy)(NXGI_GRAPHICS_CONTEXT *this);
 
 	/* Fields */
 	NXGI_BITMAP	*target;
 	NXGI_FONT	font;
+	NXGI_GLYPH_CACHE *glyphs;
 	NXGI_POINT	offset;
 	NXGI_COLOR	color;
 	NXGI_RECT	clip_rect;
+	NXGI_FILTER	filter;
+	NXGI_COMPOSITE composite;
+	uint8_t		alpha;
+
+	/** List the drawing calls go to, NULL when drawing */
+	NXGI_COMMAND_LIST *record;
+};
+
+/* Damaged rectangles tracked before they are merged into one */
+#define NXGI_MAX_DAMAGE_RECTS	32
+
+/**
+ * Presentation statistics.
+ */
+typedef struct NXGI_PRESENT_STATS NXGI_PRESENT_STATS;
+struct NXGI_PRESENT_STATS {
+	/** Frames presented since the video mode was set */
+	uint32_t	frames;
+
+	/** Frames presented during the last whole second */
+	uint32_t	fps;
+
+	/** Bytes written to video memory by the last frame, and in total */
+	uint32_t	last_bytes;
+	uint64_t	total_bytes;
 };
 
 /**
@@ -219,8 +305,21 @@ struct NXGI_CONTEXT {
 	/** File stream handle to video driver */
 	K_STREAM				*graphics_drv;
 
-	/** Screen surface */
+	/**
+	 * Screen surface. This is a back buffer in system memory, always in
+	 * BGRA32, whose damaged parts are copied to the frame buffer by
+	 * nxgi_present().
+	 */
 	NXGI_BITMAP				*screen_surf;
+
+	/** Disjoint rectangles of the screen surface changed since last present */
+	NXGI_RECT				damage[NXGI_MAX_DAMAGE_RECTS];
+	uint32_t				damage_count;
+	K_MUTEX					damage_lock;
+
+	NXGI_PRESENT_STATS		stats;
+	uint32_t				stats_time;
+	uint32_t				stats_frames;
 };
 
 /*
@@ -237,6 +336,21 @@ HRESULT __nxapi nxgi_create_bitmap(uint32_t width, uint32_t height, NXGI_FORMAT
 HRESULT __nxapi nxgi_create_graphics_context(NXGI_GRAPHICS_CONTEXT **ppGC);
 HRESULT __nxapi nxgi_get_screen(NXGI_BITMAP **ppBmp);
 
+/*
+ * Screen presentation. Drawing onto the screen surface becomes visible
+ * once the changed area is invalidated and presented.
+ */
+HRESULT __nxapi nxgi_invalidate_screen(NXGI_RECT rect);
+HRESULT __nxapi nxgi_present(BOOL sync);
+HRESULT __nxapi nxgi_get_present_stats(NXGI_PRESENT_STATS *stats_out);
+
+/**
+ * Drags a window-sized rectangle across the screen, presenting the damaged
+ * area vs. the whole screen, and reports frames per second and bytes
+ * written per frame.
+ */
+HRESULT __nxapi nxgi_present_benchmark();
+
 /*
  * Graphics Context methods
  */
@@ -250,6 +364,7 @@ HRESULT __nxapi nxgi_fill_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect);
 HRESULT __nxapi nxgi_bitblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
 HRESULT __nxapi nxgi_stretchblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
 HRESULT __nxapi nxgi_alphablend(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
+HRESULT __nxapi nxgi_fill_mask(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size);
 HRESULT __nxapi nxgi_set_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT offset);
 HRESULT __nxapi nxgi_get_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT *pOffset);
 HRESULT __nxapi nxgi_set_clip_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT clip_rect);
@@ -258,6 +373,10 @@ HRESULT __nxapi nxgi_draw_text(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, char *
 HRESULT __nxapi nxgi_text_size(NXGI_GRAPHICS_CONTEXT *gc, char *text, NXGI_SIZE *size_out);
 HRESULT __nxapi nxgi_set_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT font_params);
 HRESULT __nxapi nxgi_get_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_out);
+HRESULT __nxapi nxgi_set_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER filter);
+HRESULT __nxapi nxgi_get_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER *filter_out);
+HRESULT __nxapi nxgi_set_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE op, uint8_t alpha);
+HRESULT __nxapi nxgi_get_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE *op_out, uint8_t *alpha_out);
 void 	__nxapi nxgi_destroy_graphics_context(NXGI_GRAPHICS_CONTEXT *gc);
 
 HRESULT __nxapi nxgi_draw_aligned_text(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT box, NXGI_HALIGN halign, NXGI_VALIGN valign, char *text);
@@ -266,6 +385,8 @@ HRESULT __nxapi nxgi_draw_aligned_text(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT box,
  * Bitmap methods
  */
 HRESULT __nxapi nxgi_destroy_bitmap(NXGI_BITMAP **ppBmp);
+HRESULT __nxapi nxgi_premultiply_bitmap(NXGI_BITMAP *pBmp);
+HRESULT __nxapi nxgi_unpremultiply_bitmap(NXGI_BITMAP *pBmp);
 
 /* Helpers (todo: move to nxgi_geometry.h */
 NXGI_RECT RECT(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
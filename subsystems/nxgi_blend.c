@@ -0,0 +1,456 @@
+/*
+ * nxgi_blend.c
+ *
+ *	Alpha blending and Porter-Duff compositing.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <mm.h>
+#include <hal.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_blend.h"
+#include "nxgi_span.h"
+
+/* EFLAGS interrupt flag */
+#define EFLAGS_IF				0x200
+
+/**
+ * Porter-Duff blending factors.
+ */
+typedef enum {
+	BLEND_ZERO = 0,
+	BLEND_ONE,
+	BLEND_SRC_ALPHA,
+	BLEND_INV_SRC_ALPHA,
+	BLEND_DST_ALPHA,
+	BLEND_INV_DST_ALPHA
+} BLEND_FACTOR;
+
+/* Source and destination factor of each operator */
+static const uint8_t blend_factors[NXGI_COMPOSITE_COUNT][2] = {
+		[NXGI_COMPOSITE_CLEAR]		= { BLEND_ZERO,				BLEND_ZERO },
+		[NXGI_COMPOSITE_SRC]		= { BLEND_ONE,				BLEND_ZERO },
+		[NXGI_COMPOSITE_DST]		= { BLEND_ZERO,				BLEND_ONE },
+		[NXGI_COMPOSITE_SRC_OVER]	= { BLEND_ONE,				BLEND_INV_SRC_ALPHA },
+		[NXGI_COMPOSITE_DST_OVER]	= { BLEND_INV_DST_ALPHA,	BLEND_ONE },
+		[NXGI_COMPOSITE_SRC_IN]		= { BLEND_DST_ALPHA,		BLEND_ZERO },
+		[NXGI_COMPOSITE_DST_IN]		= { BLEND_ZERO,				BLEND_SRC_ALPHA },
+		[NXGI_COMPOSITE_SRC_OUT]	= { BLEND_INV_DST_ALPHA,	BLEND_ZERO },
+		[NXGI_COMPOSITE_DST_OUT]	= { BLEND_ZERO,				BLEND_INV_SRC_ALPHA },
+		[NXGI_COMPOSITE_SRC_ATOP]	= { BLEND_DST_ALPHA,		BLEND_INV_SRC_ALPHA },
+		[NXGI_COMPOSITE_DST_ATOP]	= { BLEND_INV_DST_ALPHA,	BLEND_SRC_ALPHA },
+		[NXGI_COMPOSITE_XOR]		= { BLEND_INV_DST_ALPHA,	BLEND_INV_SRC_ALPHA }
+};
+
+static inline uint32_t blend_factor(uint32_t f, uint32_t sa, uint32_t da)
+{
+	switch (f) {
+		case BLEND_ONE: return 255;
+		case BLEND_SRC_ALPHA: return sa;
+		case BLEND_INV_SRC_ALPHA: return 255 - sa;
+		case BLEND_DST_ALPHA: return da;
+		case BLEND_INV_DST_ALPHA: return 255 - da;
+		default: return 0;
+	}
+}
+
+static void blend_span_c(uint32_t *dst, const uint32_t *src, uint32_t count, NXGI_COMPOSITE op, uint32_t alpha)
+{
+	const uint8_t	*f = blend_factors[op];
+	uint32_t		s, d, fa, fb, i, c, r;
+
+	while (count--) {
+		s = *src++;
+		d = *dst;
+
+		if (alpha != 255) {
+			s = nxgi_span_scale(s, alpha);
+		}
+
+		fa = blend_factor(f[0], s >> 24, d >> 24);
+		fb = blend_factor(f[1], s >> 24, d >> 24);
+
+		for (i=0, r=0; i<32; i+=8) {
+			c = nxgi_span_mul255((s >> i) & 0xFF, fa) + nxgi_span_mul255((d >> i) & 0xFF, fb);
+			r |= (c > 255 ? 255 : c) << i;
+		}
+
+		*dst++ = r;
+	}
+}
+
+VOID __nxapi nxgi_blend_span(uint32_t *dst, const uint32_t *src, uint32_t count, NXGI_COMPOSITE op, uint32_t alpha, uint32_t flags)
+{
+	switch (op) {
+		case NXGI_COMPOSITE_DST:
+			return;
+
+		case NXGI_COMPOSITE_CLEAR:
+			nxgi_span_fill(dst, 0, count, flags);
+			return;
+
+		case NXGI_COMPOSITE_SRC:
+			if (alpha == 255) {
+				nxgi_span_copy(dst, src, count, flags);
+				return;
+			}
+			break;
+
+		case NXGI_COMPOSITE_SRC_OVER:
+			nxgi_span_over(dst, src, alpha, count);
+			return;
+
+		default:
+			break;
+	}
+
+	blend_span_c(dst, src, count, op, alpha);
+}
+
+VOID __nxapi nxgi_blend_premultiply(uint32_t *p, uint32_t count)
+{
+	uint32_t a;
+
+	while (count--) {
+		a = *p >> 24;
+
+		if (a == 0) {
+			*p = 0;
+		} else if (a != 255) {
+			*p = nxgi_span_premultiply(*p);
+		}
+
+		p++;
+	}
+}
+
+VOID __nxapi nxgi_blend_unpremultiply(uint32_t *p, uint32_t count)
+{
+	uint32_t a, i, c, r;
+
+	while (count--) {
+		a = *p >> 24;
+
+		/* Opaque pixels are the same either way */
+		if (a == 0) {
+			*p = 0;
+		} else if (a != 255) {
+			for (i=0, r=a << 24; i<24; i+=8) {
+				c = (((*p >> i) & 0xFF) * 255 + a / 2) / a;
+				r |= (c > 255 ? 255 : c) << i;
+			}
+
+			*p = r;
+		}
+
+		p++;
+	}
+}
+
+/*
+ * Benchmark. Every operator is checked against a floating point reference,
+ * through nxgi_blend_span() with each kernel set, then the throughput of
+ * SRC_OVER on typical sources is measured.
+ */
+#define BLEND_BENCH_WIDTH		1024
+#define BLEND_BENCH_HEIGHT		256
+#define BLEND_BENCH_TIME		1000
+
+/* Two roundings (constant alpha, then the operator) against one */
+#define BLEND_BENCH_TOLERANCE	1
+
+static const uint32_t blend_bench_alphas[] = { 255, 254, 128, 1, 0 };
+
+static const char *blend_op_names[NXGI_COMPOSITE_COUNT] = {
+		"clear", "src", "dst", "src-over", "dst-over", "src-in", "dst-in",
+		"src-out", "dst-out", "src-atop", "dst-atop", "xor"
+};
+
+typedef enum {
+	BLEND_BENCH_OVER,
+	BLEND_BENCH_OVER_OPAQUE,
+	BLEND_BENCH_OVER_CLEAR,
+	BLEND_BENCH_OVER_HALF,
+	BLEND_BENCH_MASK,
+	BLEND_BENCH_ATOP,
+	BLEND_BENCH_PREMULTIPLY
+} BLEND_BENCH_OP;
+
+static const char *blend_isa_names[NXGI_SPAN_ISA_COUNT] = { "C", "SSE2", "AVX2" };
+
+static const char *blend_bench_names[] = {
+		"over", "over/opaque", "over/clear", "over/50%", "mask", "atop", "premultiply"
+};
+
+static uint32_t blend_bench_random(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed ^ (*seed >> 16);
+}
+
+/*
+ * Premultiplied pixels. A quarter of them transparent and a quarter
+ * opaque, so that the edge cases are well covered.
+ */
+static void blend_bench_pattern(uint32_t *p, uint32_t count, uint32_t seed)
+{
+	uint32_t i, v;
+
+	for (i=0; i<count; i++) {
+		v = blend_bench_random(&seed);
+
+		switch (v & 3) {
+			case 0: v &= 0x00FFFFFF; break;
+			case 1: v |= 0xFF000000; break;
+		}
+
+		p[i] = nxgi_span_premultiply(v);
+	}
+}
+
+static double blend_ref_factor(uint32_t f, double sa, double da)
+{
+	switch (f) {
+		case BLEND_ONE: return 1.0;
+		case BLEND_SRC_ALPHA: return sa;
+		case BLEND_INV_SRC_ALPHA: return 1.0 - sa;
+		case BLEND_DST_ALPHA: return da;
+		case BLEND_INV_DST_ALPHA: return 1.0 - da;
+		default: return 0.0;
+	}
+}
+
+/*
+ * Floating point reference, channels normalized to [0..1].
+ */
+static uint32_t blend_ref_pixel(uint32_t d, uint32_t s, NXGI_COMPOSITE op, uint32_t alpha)
+{
+	double		k = alpha / 255.0, sa, da, fa, fb, c;
+	uint32_t	i, r = 0;
+
+	sa = (s >> 24) / 255.0 * k;
+	da = (d >> 24) / 255.0;
+	fa = blend_ref_factor(blend_factors[op][0], sa, da);
+	fb = blend_ref_factor(blend_factors[op][1], sa, da);
+
+	for (i=0; i<32; i+=8) {
+		c = ((s >> i) & 0xFF) / 255.0 * k * fa + ((d >> i) & 0xFF) / 255.0 * fb;
+		if (c > 1.0) c = 1.0;
+
+		r |= (uint32_t)(c * 255.0 + 0.5) << i;
+	}
+
+	return r;
+}
+
+static uint32_t blend_bench_error(uint32_t a, uint32_t b)
+{
+	uint32_t i, e, max = 0;
+
+	for (i=0; i<32; i+=8) {
+		e = (a >> i) & 0xFF;
+		e = e > ((b >> i) & 0xFF) ? e - ((b >> i) & 0xFF) : ((b >> i) & 0xFF) - e;
+		if (e > max) max = e;
+	}
+
+	return max;
+}
+
+/*
+ * The scheduler doesn't save FPU state either, so this runs with
+ * interrupts disabled.
+ */
+static HRESULT blend_bench_verify(uint32_t *dst, uint32_t *src, uint32_t *ref, uint32_t count)
+{
+	uint32_t	intf, op, a, i, x, e, max;
+	HRESULT		hr = S_OK;
+
+	intf = hal_get_eflags() & EFLAGS_IF;
+	hal_cli();
+
+	/* The division itself has to be exact */
+	for (x=0; x<256; x++) {
+		for (a=0; a<256; a++) {
+			if (nxgi_span_mul255(x, a) != (uint32_t)(x * a / 255.0 + 0.5)) {
+				k_printf("%d * %d / 255 is %d.\n", x, a, nxgi_span_mul255(x, a));
+				hr = E_FAIL;
+				goto finally;
+			}
+		}
+	}
+
+	for (op=0; op<NXGI_COMPOSITE_COUNT; op++) {
+		max = 0;
+
+		for (a=0; a<sizeof(blend_bench_alphas) / sizeof(uint32_t); a++) {
+			blend_bench_pattern(dst, count, op * 16 + a);
+			blend_bench_pattern(src, count, ~(op * 16 + a));
+
+			for (i=0; i<count; i++) {
+				ref[i] = blend_ref_pixel(dst[i], src[i], op, blend_bench_alphas[a]);
+			}
+
+			/* Odd offset and length, for the scalar heads and tails */
+			nxgi_blend_span(dst + 1, src + 1, count - 2, op, blend_bench_alphas[a], 0);
+
+			for (i=1; i<count-1; i++) {
+				e = blend_bench_error(dst[i], ref[i]);
+
+				if (e > BLEND_BENCH_TOLERANCE) {
+					k_printf("%s, alpha %d: pixel %d is 0x%X instead of 0x%X.\n",
+							blend_op_names[op], blend_bench_alphas[a], i, dst[i], ref[i]);
+					hr = E_FAIL;
+					goto finally;
+				}
+
+				if (e > max) max = e;
+			}
+		}
+
+		k_printf("%s %d%s", blend_op_names[op], max, op + 1 < NXGI_COMPOSITE_COUNT ? ", " : "\n");
+	}
+
+finally:
+	if (intf) hal_sti();
+	return hr;
+}
+
+static void blend_bench_run(BLEND_BENCH_OP op, uint32_t *dst, const uint32_t *src, uint32_t count)
+{
+	switch (op) {
+		case BLEND_BENCH_OVER:
+		case BLEND_BENCH_OVER_OPAQUE:
+		case BLEND_BENCH_OVER_CLEAR:
+			nxgi_blend_span(dst, src, count, NXGI_COMPOSITE_SRC_OVER, 255, 0);
+			break;
+
+		case BLEND_BENCH_OVER_HALF:
+			nxgi_blend_span(dst, src, count, NXGI_COMPOSITE_SRC_OVER, 128, 0);
+			break;
+
+		case BLEND_BENCH_MASK:
+			nxgi_span_mask(dst, 0xFF204080, (const uint8_t*)src, count);
+			break;
+
+		case BLEND_BENCH_ATOP:
+			nxgi_blend_span(dst, src, count, NXGI_COMPOSITE_SRC_ATOP, 255, 0);
+			break;
+
+		case BLEND_BENCH_PREMULTIPLY:
+			nxgi_blend_premultiply(dst, count);
+			break;
+	}
+}
+
+/*
+ * Composites rows of `src` onto `dst` until BLEND_BENCH_TIME elapses and
+ * returns the throughput in Mpixels/s.
+ */
+static uint32_t blend_bench_rate(BLEND_BENCH_OP op, uint32_t *dst, const uint32_t *src)
+{
+	uint32_t start, elapsed, y;
+	uint64_t pixels = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		for (y=0; y<BLEND_BENCH_HEIGHT; y++) {
+			blend_bench_run(op, dst + y * BLEND_BENCH_WIDTH, src + y * BLEND_BENCH_WIDTH, BLEND_BENCH_WIDTH);
+		}
+
+		pixels += BLEND_BENCH_WIDTH * BLEND_BENCH_HEIGHT;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < BLEND_BENCH_TIME);
+
+	return (uint32_t)udiv64(pixels, elapsed * 1000, NULL);
+}
+
+/*
+ * Sources for the throughput runs: random, opaque and transparent
+ * premultiplied pixels, and an anti-aliased-text-like mask, mostly empty
+ * with full coverage runs and a few partial edges.
+ */
+static void blend_bench_source(BLEND_BENCH_OP op, uint32_t *src, uint32_t count)
+{
+	uint32_t	i, seed = 11;
+	uint8_t		*m = (uint8_t*)src;
+
+	switch (op) {
+		case BLEND_BENCH_OVER_OPAQUE:
+			for (i=0; i<count; i++) src[i] = blend_bench_random(&seed) | 0xFF000000;
+			break;
+
+		case BLEND_BENCH_OVER_CLEAR:
+			for (i=0; i<count; i++) src[i] = 0;
+			break;
+
+		case BLEND_BENCH_MASK:
+			for (i=0; i<count * 4; i++) {
+				switch (blend_bench_random(&seed) % 8) {
+					case 0: case 1: m[i] = 255; break;
+					case 2: m[i] = (uint8_t)blend_bench_random(&seed); break;
+					default: m[i] = 0; break;
+				}
+			}
+			break;
+
+		default:
+			blend_bench_pattern(src, count, 11);
+			break;
+	}
+}
+
+HRESULT __nxapi nxgi_blend_benchmark()
+{
+	uint32_t		*dst = NULL, *src = NULL, *ref = NULL;
+	uint32_t		isa, op, count = BLEND_BENCH_WIDTH * BLEND_BENCH_HEIGHT;
+	NXGI_SPAN_ISA	saved_isa;
+	HRESULT			hr = S_OK;
+
+	nxgi_span_initialize();
+	saved_isa = nxgi_span_get_isa();
+
+	dst = kmalloc(count * 4);
+	src = kmalloc(count * 4);
+	ref = kmalloc(BLEND_BENCH_WIDTH * 4);
+
+	if (!dst || !src || !ref) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (isa=NXGI_SPAN_ISA_C; isa<NXGI_SPAN_ISA_COUNT; isa++) {
+		if (FAILED(nxgi_span_set_isa(isa))) continue;
+
+		/* Correctness, maximum error per operator */
+		k_printf("%s: maximum error ", blend_isa_names[isa]);
+
+		hr = blend_bench_verify(dst, src, ref, BLEND_BENCH_WIDTH);
+		if (FAILED(hr)) goto finally;
+
+		/* Throughput */
+		for (op=BLEND_BENCH_OVER; op<=BLEND_BENCH_PREMULTIPLY; op++) {
+			/* These don't depend on the kernel set */
+			if (isa != NXGI_SPAN_ISA_C && op >= BLEND_BENCH_ATOP) break;
+
+			blend_bench_source(op, src, count);
+			blend_bench_pattern(dst, count, 5);
+
+			k_printf(" %s %d", blend_bench_names[op], blend_bench_rate(op, dst, src));
+		}
+
+		k_printf(" Mpixels/s\n");
+	}
+
+finally:
+	nxgi_span_set_isa(saved_isa);
+
+	if (dst) kfree(dst);
+	if (src) kfree(src);
+	if (ref) kfree(ref);
+
+	return hr;
+}
@@ -0,0 +1,46 @@
+/*
+ * nxgi_blend.h
+ *
+ *	Alpha blending and Porter-Duff compositing of BGRA32 pixels.
+ *
+ *	Pixels are premultiplied by alpha. Every operator computes
+ *	dst = src * Fa + dst * Fb per channel, the factors being 0, 1, or the
+ *	source or destination alpha or it's inverse. Products are divided by
+ *	255 as ((x * a + 128) * 257) >> 16, which rounds exactly for 8-bit
+ *	operands. A constant alpha scales the source before compositing.
+ *
+ *	SRC_OVER and solid color masks run on the SSE2/AVX2 span kernels, which
+ *	skip transparent and copy opaque source pixels. The other operators are
+ *	done in C.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_BLEND_H_
+#define SUBSYSTEMS_NXGI_BLEND_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/**
+ * Composites `count` premultiplied pixels of `src` onto `dst` with operator
+ * `op`, the source scaled by `alpha` in [0..255]. `flags` are span flags
+ * (NXGI_SPAN_*), used by operators which only write.
+ */
+VOID		__nxapi nxgi_blend_span(uint32_t *dst, const uint32_t *src, uint32_t count, NXGI_COMPOSITE op, uint32_t alpha, uint32_t flags);
+
+/**
+ * Converts pixels between straight and premultiplied alpha, in place.
+ * Unpremultiplying loses precision for low alpha values.
+ */
+VOID		__nxapi nxgi_blend_premultiply(uint32_t *p, uint32_t count);
+VOID		__nxapi nxgi_blend_unpremultiply(uint32_t *p, uint32_t count);
+
+/**
+ * Checks every operator against a floating point reference and measures
+ * the throughput of compositing.
+ */
+HRESULT		__nxapi nxgi_blend_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_BLEND_H_ */
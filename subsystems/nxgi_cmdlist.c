@@ -0,0 +1,925 @@
+/*
+ * nxgi_cmdlist.c
+ *
+ *	Recording of drawing calls and their tiled execution.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <string.h>
+#include <mm.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_cmdlist.h"
+#include "nxgi_graphics.h"
+#include "nxgi_span.h"
+#include "nxgi_font.h"
+
+/* Commands allocated for the first frame */
+#define CMDLIST_INITIAL_ITEMS	256
+
+/* Later fills remembered while looking for commands they cover */
+#define CMDLIST_COVERS			16
+
+/* Type of culled commands during execution */
+#define CMDLIST_DEAD			0xFF
+
+/*
+ * Grows an array to hold `count` items of `size` bytes.
+ */
+static HRESULT cmdlist_reserve(void **array, uint32_t *capacity, uint32_t count, uint32_t size)
+{
+	void		*p;
+	uint32_t	c;
+
+	if (count <= *capacity) {
+		return S_OK;
+	}
+
+	c = *capacity ? *capacity : CMDLIST_INITIAL_ITEMS;
+	while (c < count) {
+		c *= 2;
+	}
+
+	if (!(p = krealloc(*array, c * size))) {
+		return E_OUTOFMEM;
+	}
+
+	*array = p;
+	*capacity = c;
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_create_command_list(NXGI_COMMAND_LIST **list_out)
+{
+	NXGI_COMMAND_LIST *list;
+
+	if (!(list = kcalloc(sizeof(NXGI_COMMAND_LIST)))) {
+		return E_OUTOFMEM;
+	}
+
+	*list_out = list;
+	return S_OK;
+}
+
+void __nxapi nxgi_destroy_command_list(NXGI_COMMAND_LIST *list)
+{
+	if (list->gc) nxgi_destroy_graphics_context(list->gc);
+	if (list->cmds) kfree(list->cmds);
+	if (list->text) kfree(list->text);
+	if (list->live) kfree(list->live);
+	if (list->bins) kfree(list->bins);
+	if (list->bin_start) kfree(list->bin_start);
+
+	kfree(list);
+}
+
+void __nxapi nxgi_reset_command_list(NXGI_COMMAND_LIST *list)
+{
+	list->count = 0;
+	list->text_size = 0;
+}
+
+/*
+ * Recording
+ */
+
+/* Appends a command with the context's state, NULL if out of memory */
+static NXGI_CMD *record_append(NXGI_GRAPHICS_CONTEXT *gc, NXGI_CMD_TYPE type, NXGI_RECT bounds)
+{
+	NXGI_COMMAND_LIST	*list = gc->record;
+	NXGI_CMD			*cmd;
+
+	if (FAILED(cmdlist_reserve((void**)&list->cmds, &list->capacity, list->count + 1, sizeof(NXGI_CMD)))) {
+		return NULL;
+	}
+
+	cmd = &list->cmds[list->count++];
+	memset(cmd, 0, sizeof(NXGI_CMD));
+
+	cmd->type = type;
+	cmd->composite = gc->composite;
+	cmd->alpha = gc->alpha;
+	cmd->filter = gc->filter;
+	cmd->color = gc->color;
+	cmd->bounds = bounds;
+
+	return cmd;
+}
+
+/* Offsets and clips a rect, returns FALSE if nothing is left */
+static BOOL record_clip(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT r, NXGI_RECT *bounds_out)
+{
+	*bounds_out = nxgig_rect_intersection(nxgig_rect_offset(r, gc->offset), gc->clip_rect);
+	return !nxgig_rect_empty(*bounds_out);
+}
+
+static HRESULT __nxapi record_fill_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect)
+{
+	NXGI_RECT bounds;
+
+	/* Corners may come in any order */
+	rect = RECT(rect.x1 < rect.x2 ? rect.x1 : rect.x2, rect.y1 < rect.y2 ? rect.y1 : rect.y2,
+			rect.x1 < rect.x2 ? rect.x2 : rect.x1, rect.y1 < rect.y2 ? rect.y2 : rect.y1);
+
+	if (!record_clip(gc, rect, &bounds)) {
+		return S_FALSE;
+	}
+
+	return record_append(gc, NXGI_CMD_FILL, bounds) ? S_OK : E_OUTOFMEM;
+}
+
+/*
+ * Axis-aligned lines become fills, see graphics_draw_line_bgra32().
+ */
+static HRESULT __nxapi record_draw_line(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+	NXGI_POINT	p1 = {x1, y1};
+	NXGI_POINT	p2 = {x2, y2};
+	NXGI_RECT	r, bounds;
+	NXGI_CMD	*cmd;
+
+	r = RECT(p1.x < p2.x ? p1.x : p2.x, p1.y < p2.y ? p1.y : p2.y, p1.x < p2.x ? p2.x : p1.x, p1.y < p2.y ? p2.y : p1.y);
+
+	if (p1.x == p2.x) {
+		r.x2++;
+	} else if (p1.y == p2.y) {
+		r.y2++;
+	} else {
+		/* End points are drawn */
+		r.x2++;
+		r.y2++;
+	}
+
+	if (!record_clip(gc, r, &bounds)) {
+		return S_OK;
+	}
+
+	if (p1.x == p2.x || p1.y == p2.y) {
+		return record_append(gc, NXGI_CMD_FILL, bounds) ? S_OK : E_OUTOFMEM;
+	}
+
+	if (!(cmd = record_append(gc, NXGI_CMD_LINE, bounds))) {
+		return E_OUTOFMEM;
+	}
+
+	cmd->line.p1 = nxgig_point_add(p1, gc->offset);
+	cmd->line.p2 = nxgig_point_add(p2, gc->offset);
+
+	return S_OK;
+}
+
+static HRESULT __nxapi record_draw_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect)
+{
+	HRESULT hr;
+
+	/* Same lines as graphics_draw_rect_bgra32() */
+	if (rect.x1 == rect.x2 || rect.y1 == rect.y2) {
+		return S_FALSE;
+	}
+
+	rect.x2 -= 1;
+	rect.y2 -= 1;
+
+	if (rect.x1 == rect.x2 || rect.y1 == rect.y2) {
+		return S_FALSE;
+	}
+
+	hr = record_draw_line(gc, rect.x1, rect.y1, rect.x2, rect.y1);
+	if (SUCCEEDED(hr)) hr = record_draw_line(gc, rect.x2, rect.y1, rect.x2, rect.y2);
+	if (SUCCEEDED(hr)) hr = record_draw_line(gc, rect.x2, rect.y2, rect.x1, rect.y2);
+	if (SUCCEEDED(hr)) hr = record_draw_line(gc, rect.x1, rect.y2, rect.x1, rect.y1);
+
+	return hr;
+}
+
+/* Checks and records bitblt, stretchblt and alphablend */
+static HRESULT record_blit(NXGI_GRAPHICS_CONTEXT *gc, NXGI_CMD_TYPE type, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
+{
+	NXGI_RECT	bounds;
+	NXGI_CMD	*cmd;
+
+	/* Only bitblt converts between formats */
+	if (type != NXGI_CMD_BITBLT && pSrcBitmap->format != gc->target->format) {
+		return E_NOTIMPL;
+	}
+
+	if (!nxgig_rect_contains_rect(src_rect, RECT(0, 0, pSrcBitmap->width, pSrcBitmap->height))) {
+		return E_INVALIDARG;
+	}
+
+	if (RECT_WIDTH(src_rect) <= 0 || RECT_HEIGHT(src_rect) <= 0 || !record_clip(gc, dst_rect, &bounds)) {
+		return S_FALSE;
+	}
+
+	if (!(cmd = record_append(gc, type, bounds))) {
+		return E_OUTOFMEM;
+	}
+
+	cmd->blit.dst = nxgig_rect_offset(dst_rect, gc->offset);
+	cmd->blit.src_rect = src_rect;
+	cmd->blit.src = pSrcBitmap;
+
+	return S_OK;
+}
+
+static HRESULT __nxapi record_bitblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
+{
+	NXGI_RECT dst_rect = RECT(dst_pos.x, dst_pos.y, dst_pos.x + RECT_WIDTH(src_rect), dst_pos.y + RECT_HEIGHT(src_rect));
+	return record_blit(gc, NXGI_CMD_BITBLT, dst_rect, pSrcBitmap, src_rect);
+}
+
+static HRESULT __nxapi record_stretchblt(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
+{
+	if (RECT_WIDTH(dst_rect) <= 0 || RECT_HEIGHT(dst_rect) <= 0) {
+		return S_FALSE;
+	}
+
+	return record_blit(gc, NXGI_CMD_STRETCHBLT, dst_rect, pSrcBitmap, src_rect);
+}
+
+static HRESULT __nxapi record_alphablend(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
+{
+	NXGI_RECT dst_rect = RECT(dst_pos.x, dst_pos.y, dst_pos.x + RECT_WIDTH(src_rect), dst_pos.y + RECT_HEIGHT(src_rect));
+	return record_blit(gc, NXGI_CMD_ALPHABLEND, dst_rect, pSrcBitmap, src_rect);
+}
+
+static HRESULT __nxapi record_fill_mask(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size)
+{
+	NXGI_RECT	bounds;
+	NXGI_CMD	*cmd;
+
+	if (size.width <= 0 || size.height <= 0 ||
+		!record_clip(gc, RECT(dst_pos.x, dst_pos.y, dst_pos.x + size.width, dst_pos.y + size.height), &bounds)) {
+		return S_FALSE;
+	}
+
+	if (!(cmd = record_append(gc, NXGI_CMD_FILL_MASK, bounds))) {
+		return E_OUTOFMEM;
+	}
+
+	cmd->mask.pos = nxgig_point_add(dst_pos, gc->offset);
+	cmd->mask.size = size;
+	cmd->mask.mask = mask;
+	cmd->mask.stride = mask_stride;
+
+	return S_OK;
+}
+
+/*
+ * Text is bounded by the ink of it's glyphs, which may reach past the
+ * advance.
+ */
+static HRESULT __nxapi record_draw_text(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, char *text)
+{
+	NXGI_COMMAND_LIST	*list = gc->record;
+	NXGI_GLYPH_CACHE	*cache = gc->glyphs;
+	NXGI_RECT			ink = RECT(0, 0, 0, 0), r, bounds;
+	NXGI_GLYPH			*g;
+	NXGI_CMD			*cmd;
+	uint8_t				*s;
+	uint32_t			len;
+	int32_t				x;
+	HRESULT				hr;
+
+	if (!cache) {
+		return E_INVALIDSTATE;
+	}
+
+	for (s=(uint8_t*)text, x=pos.x; *s; x+=cache->advance[*s], s++) {
+		if (!(g = nxgi_font_get_glyph(cache, *s))) {
+			return E_OUTOFMEM;
+		}
+
+		if (g->width == 0) {
+			continue;
+		}
+
+		r = RECT(x + g->x, pos.y + g->y, x + g->x + g->width, pos.y + g->y + g->height);
+		ink = nxgig_rect_empty(ink) ? r : nxgig_rects_union(ink, r);
+	}
+
+	if (nxgig_rect_empty(ink) || !record_clip(gc, ink, &bounds)) {
+		return S_OK;
+	}
+
+	len = (uint8_t*)s - (uint8_t*)text + 1;
+
+	hr = cmdlist_reserve((void**)&list->text, &list->text_capacity, list->text_size + len, 1);
+	if (FAILED(hr)) return hr;
+
+	if (!(cmd = record_append(gc, NXGI_CMD_TEXT, bounds))) {
+		return E_OUTOFMEM;
+	}
+
+	cmd->color = gc->font.color;
+	cmd->text.pos = nxgig_point_add(pos, gc->offset);
+	cmd->text.glyphs = cache;
+	cmd->text.offset = list->text_size;
+
+	memcpy(list->text + list->text_size, text, len);
+	list->text_size += len;
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_begin_record(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMMAND_LIST *list)
+{
+	if (!gc->target || gc->record) {
+		return E_INVALIDSTATE;
+	}
+
+	if (gc->target->format != NXGI_FORMAT_BGRA32) {
+		return E_NOTIMPL;
+	}
+
+	gc->record = list;
+
+	gc->set_pixel = NULL;
+	gc->get_pixel = NULL;
+	gc->draw_line = record_draw_line;
+	gc->draw_rect = record_draw_rect;
+	gc->fill_rect = record_fill_rect;
+	gc->bitblt = record_bitblt;
+	gc->stretchblt = record_stretchblt;
+	gc->alphablend = record_alphablend;
+	gc->fill_mask = record_fill_mask;
+	gc->draw_text = record_draw_text;
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_end_record(NXGI_GRAPHICS_CONTEXT *gc)
+{
+	if (!gc->record) {
+		return E_INVALIDSTATE;
+	}
+
+	gc->record = NULL;
+
+	/* Target may have been detached while recording */
+	return gc->target ? graphics_set_ops(gc) : S_OK;
+}
+
+/*
+ * Execution
+ */
+
+/*
+ * Merges fill `b` into fill `a`, drawn right before it with the same
+ * color, if both make up a rectangle.
+ */
+static BOOL cmdlist_merge_fill(NXGI_RECT *a, NXGI_RECT b)
+{
+	if (nxgig_rect_contains_rect(b, *a)) {
+		return TRUE;
+	}
+
+	if (nxgig_rect_contains_rect(*a, b) ||
+		(a->x1 == b.x1 && a->x2 == b.x2 && b.y1 <= a->y2 && a->y1 <= b.y2) ||
+		(a->y1 == b.y1 && a->y2 == b.y2 && b.x1 <= a->x2 && a->x1 <= b.x2)) {
+		*a = nxgig_rects_union(*a, b);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Copies the commands touching the damaged area to `live`, merging fills
+ * on the way, then drops those covered by a later fill. Fills overwrite
+ * every pixel of their bounds, whatever the composite mode.
+ */
+static HRESULT cmdlist_cull(NXGI_COMMAND_LIST *list, const NXGI_RECT *rects, uint32_t rect_count, uint32_t *count_out)
+{
+	NXGI_RECT	covers[CMDLIST_COVERS];
+	uint32_t	cover_count = 0;
+	uint32_t	i, k, n = 0, smallest;
+	NXGI_CMD	*cmd, *last;
+	HRESULT		hr;
+
+	hr = cmdlist_reserve((void**)&list->live, &list->live_capacity, list->count, sizeof(NXGI_CMD));
+	if (FAILED(hr)) return hr;
+
+	for (i=0; i<list->count; i++) {
+		cmd = &list->cmds[i];
+
+		for (k=0; k<rect_count; k++) {
+			if (nxgig_rect_intersect(cmd->bounds, rects[k])) break;
+		}
+
+		if (k == rect_count) {
+			list->stats.culled++;
+			continue;
+		}
+
+		last = n > 0 ? &list->live[n - 1] : NULL;
+
+		if (last && cmd->type == NXGI_CMD_FILL && last->type == NXGI_CMD_FILL &&
+			nxgi_span_color(cmd->color) == nxgi_span_color(last->color) && cmdlist_merge_fill(&last->bounds, cmd->bounds)) {
+			list->stats.merged++;
+			continue;
+		}
+
+		list->live[n++] = *cmd;
+	}
+
+	/* Walk back, remembering the largest fills drawn after the command */
+	for (i=n; i-->0; ) {
+		cmd = &list->live[i];
+
+		for (k=0; k<cover_count; k++) {
+			if (nxgig_rect_contains_rect(cmd->bounds, covers[k])) break;
+		}
+
+		if (k < cover_count) {
+			cmd->type = CMDLIST_DEAD;
+			list->stats.culled++;
+			continue;
+		}
+
+		if (cmd->type != NXGI_CMD_FILL) {
+			continue;
+		}
+
+		if (cover_count < CMDLIST_COVERS) {
+			covers[cover_count++] = cmd->bounds;
+			continue;
+		}
+
+		for (smallest=0, k=1; k<CMDLIST_COVERS; k++) {
+			if (nxgig_rect_area(covers[k]) < nxgig_rect_area(covers[smallest])) smallest = k;
+		}
+
+		if (nxgig_rect_area(cmd->bounds) > nxgig_rect_area(covers[smallest])) {
+			covers[smallest] = cmd->bounds;
+		}
+	}
+
+	for (i=0, k=0; i<n; i++) {
+		if (list->live[i].type != CMDLIST_DEAD) {
+			list->live[k++] = list->live[i];
+		}
+	}
+
+	*count_out = k;
+	return S_OK;
+}
+
+/*
+ * Sorts the live commands into tiles within `area`, keeping their order
+ * within a tile. Commands of tile `t` are bins[bin_start[t-1]..bin_start[t]),
+ * starting from 0 for the first one.
+ */
+static HRESULT cmdlist_bin(NXGI_COMMAND_LIST *list, uint32_t count, NXGI_RECT area, uint32_t tiles_x, uint32_t tiles)
+{
+	NXGI_RECT	r;
+	uint32_t	i, total = 0, tx, ty;
+	HRESULT		hr;
+
+	hr = cmdlist_reserve((void**)&list->bin_start, &list->bin_start_capacity, tiles, sizeof(uint32_t));
+	if (FAILED(hr)) return hr;
+
+	memset(list->bin_start, 0, tiles * sizeof(uint32_t));
+
+	/* Count the commands of each tile */
+	for (i=0; i<count; i++) {
+		r = nxgig_rect_intersection(list->live[i].bounds, area);
+		if (nxgig_rect_empty(r)) continue;
+
+		for (ty=r.y1/NXGI_CMD_TILE_SIZE; ty<=(uint32_t)(r.y2-1)/NXGI_CMD_TILE_SIZE; ty++) {
+			for (tx=r.x1/NXGI_CMD_TILE_SIZE; tx<=(uint32_t)(r.x2-1)/NXGI_CMD_TILE_SIZE; tx++) {
+				list->bin_start[ty * tiles_x + tx]++;
+				total++;
+			}
+		}
+	}
+
+	hr = cmdlist_reserve((void**)&list->bins, &list->bins_capacity, total, sizeof(uint32_t));
+	if (FAILED(hr)) return hr;
+
+	/* Turn counts into starts, then advance each start past it's commands */
+	for (i=0, total=0; i<tiles; i++) {
+		total += list->bin_start[i];
+		list->bin_start[i] = total - list->bin_start[i];
+	}
+
+	for (i=0; i<count; i++) {
+		r = nxgig_rect_intersection(list->live[i].bounds, area);
+		if (nxgig_rect_empty(r)) continue;
+
+		for (ty=r.y1/NXGI_CMD_TILE_SIZE; ty<=(uint32_t)(r.y2-1)/NXGI_CMD_TILE_SIZE; ty++) {
+			for (tx=r.x1/NXGI_CMD_TILE_SIZE; tx<=(uint32_t)(r.x2-1)/NXGI_CMD_TILE_SIZE; tx++) {
+				list->bins[list->bin_start[ty * tiles_x + tx]++] = i;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Draws the part of a command within `r`, which is inside it's bounds.
+ * Everything but fills goes through the drawing ops with `r` as the clip
+ * rect. Their output doesn't depend on the clip rect beyond that.
+ */
+static HRESULT cmdlist_run(NXGI_COMMAND_LIST *list, NXGI_CMD *cmd, NXGI_RECT r)
+{
+	NXGI_GRAPHICS_CONTEXT	*gc = list->gc;
+	NXGI_BITMAP				*t = gc->target;
+
+	gc->clip_rect = r;
+	gc->color = cmd->color;
+	gc->alpha = cmd->alpha;
+
+	switch (cmd->type) {
+	case NXGI_CMD_FILL:
+		nxgi_span_fill_rect((uint8_t*)t->pBits + r.y1 * t->stride + r.x1 * 4, t->stride, RECT_WIDTH(r), RECT_HEIGHT(r),
+				nxgi_span_color(cmd->color), nxgi_span_flags(t));
+		return S_OK;
+
+	case NXGI_CMD_LINE:
+		return graphics_draw_line_bgra32(gc, cmd->line.p1.x, cmd->line.p1.y, cmd->line.p2.x, cmd->line.p2.y);
+
+	case NXGI_CMD_BITBLT:
+		return graphics_bitblt_bgra32(gc, cmd->blit.dst.p1, cmd->blit.src, cmd->blit.src_rect);
+
+	case NXGI_CMD_STRETCHBLT:
+		gc->filter = cmd->filter;
+		return graphics_stretchblt_bgra32(gc, cmd->blit.dst, cmd->blit.src, cmd->blit.src_rect);
+
+	case NXGI_CMD_ALPHABLEND:
+		gc->composite = cmd->composite;
+		return graphics_alphablend_bgra32(gc, cmd->blit.dst.p1, cmd->blit.src, cmd->blit.src_rect);
+
+	case NXGI_CMD_FILL_MASK:
+		return graphics_fill_mask_bgra32(gc, cmd->mask.pos, cmd->mask.mask, cmd->mask.stride, cmd->mask.size);
+
+	case NXGI_CMD_TEXT:
+		gc->glyphs = cmd->text.glyphs;
+		gc->font.color = cmd->color;
+		return graphics_draw_text_bgra32(gc, cmd->text.pos, list->text + cmd->text.offset);
+
+	default:
+		return E_FAIL;
+	}
+}
+
+HRESULT __nxapi nxgi_execute_command_list(NXGI_COMMAND_LIST *list, NXGI_BITMAP *target, const NXGI_REGION *damage)
+{
+	NXGI_RECT		screen = RECT(0, 0, target->width, target->height);
+	NXGI_RECT		area, d, scissor, r;
+	const NXGI_RECT	*rects;
+	uint32_t		rect_count, count, tiles_x, tiles, i, k, t, tx, ty;
+	NXGI_CMD		*cmd;
+	HRESULT			hr;
+
+	if (target->format != NXGI_FORMAT_BGRA32) {
+		return E_NOTIMPL;
+	}
+
+	memset(&list->stats, 0, sizeof(NXGI_CMD_STATS));
+
+	if (damage) {
+		rects = nxgig_region_rects(damage, &rect_count);
+		area = nxgig_rect_intersection(nxgig_region_bounds(damage), screen);
+	} else {
+		rects = &screen;
+		rect_count = 1;
+		area = screen;
+	}
+
+	if (list->count == 0 || rect_count == 0 || nxgig_rect_empty(area)) {
+		return S_OK;
+	}
+
+	if (!list->gc) {
+		hr = nxgi_create_graphics_context(&list->gc);
+		if (FAILED(hr)) return hr;
+	}
+
+	hr = nxgi_set_target(list->gc, target);
+	if (FAILED(hr)) return hr;
+
+	list->gc->offset = POINT(0, 0);
+
+	hr = cmdlist_cull(list, rects, rect_count, &count);
+	if (FAILED(hr)) goto finally;
+
+	tiles_x = (target->width + NXGI_CMD_TILE_SIZE - 1) / NXGI_CMD_TILE_SIZE;
+	tiles = tiles_x * ((target->height + NXGI_CMD_TILE_SIZE - 1) / NXGI_CMD_TILE_SIZE);
+
+	hr = cmdlist_bin(list, count, area, tiles_x, tiles);
+	if (FAILED(hr)) goto finally;
+
+	/* Damaged rects are disjoint, so no pixel is drawn twice */
+	for (i=0; i<rect_count; i++) {
+		d = nxgig_rect_intersection(rects[i], screen);
+		if (nxgig_rect_empty(d)) continue;
+
+		for (ty=d.y1/NXGI_CMD_TILE_SIZE; ty<=(uint32_t)(d.y2-1)/NXGI_CMD_TILE_SIZE; ty++) {
+			for (tx=d.x1/NXGI_CMD_TILE_SIZE; tx<=(uint32_t)(d.x2-1)/NXGI_CMD_TILE_SIZE; tx++) {
+				t = ty * tiles_x + tx;
+				scissor = RECT(tx * NXGI_CMD_TILE_SIZE, ty * NXGI_CMD_TILE_SIZE, (tx + 1) * NXGI_CMD_TILE_SIZE, (ty + 1) * NXGI_CMD_TILE_SIZE);
+				scissor = nxgig_rect_intersection(scissor, d);
+
+				list->stats.tiles++;
+
+				for (k=t ? list->bin_start[t - 1] : 0; k<list->bin_start[t]; k++) {
+					cmd = &list->live[list->bins[k]];
+
+					r = nxgig_rect_intersection(cmd->bounds, scissor);
+					if (nxgig_rect_empty(r)) continue;
+
+					list->stats.runs++;
+
+					hr = cmdlist_run(list, cmd, r);
+					if (FAILED(hr)) goto finally;
+				}
+			}
+		}
+	}
+
+	hr = S_OK;
+
+finally:
+	nxgi_set_target(list->gc, NULL);
+	return hr;
+}
+
+/*
+ * Command list benchmark
+ */
+
+#define CMD_BENCH_WIDTH		1024
+#define CMD_BENCH_HEIGHT	768
+#define CMD_BENCH_WINDOWS	12
+#define CMD_BENCH_BUTTONS	16
+#define CMD_BENCH_TITLE		26
+
+/* Time per measurement, in milliseconds */
+#define CMD_BENCH_TIME		500
+
+static NXGI_RECT	cmd_bench_windows[CMD_BENCH_WINDOWS];
+static uint8_t		cmd_bench_mask[16 * 16];
+static NXGI_BITMAP	*cmd_bench_surface, *cmd_bench_icon;
+
+static uint32_t cmd_bench_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed ^ (*seed >> 16);
+}
+
+/*
+ * Draws a desktop the way Henjin does: the background, then every window's
+ * surface, decoration and controls, within `clip`.
+ */
+static void cmd_bench_frame(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT clip)
+{
+	NXGI_RECT	w, client, inner, b;
+	char		label[16];
+	uint32_t	i, k;
+
+	nxgi_set_offset(gc, POINT(0, 0));
+	nxgi_set_clip_rect(gc, clip);
+
+	nxgi_set_color(gc, COLOR(0, 64, 128, 255));
+	nxgi_fill_rect(gc, RECT(0, 0, CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT - 30));
+
+	nxgi_set_font(gc, FONT_PARAMS("System", 1, 0, COLOR(255, 255, 255, 255)));
+	nxgi_draw_text(gc, POINT(25, 25), "ANTONIX kernel v0.1 BUILD-07102016");
+	nxgi_draw_text(gc, POINT(25, 40), "Henjin Window Compositor");
+
+	for (i=0; i<CMD_BENCH_WINDOWS; i++) {
+		w = cmd_bench_windows[i];
+		client = RECT(w.x1 + 2, w.y1 + CMD_BENCH_TITLE + 2, w.x2 - 2, w.y2 - 2);
+
+		/* Window surface and decoration, as desktop_blit_subcontrol() */
+		nxgi_set_offset(gc, POINT(0, 0));
+		nxgi_set_clip_rect(gc, clip);
+
+		nxgi_bitblt(gc, client.p1, cmd_bench_surface, RECT(0, 0, RECT_WIDTH(client), RECT_HEIGHT(client)));
+
+		nxgi_set_color(gc, COLOR(40, 40, 60, 255));
+		nxgi_fill_rect(gc, RECT(w.x1, w.y1, w.x2, w.y1 + CMD_BENCH_TITLE));
+		nxgi_set_color(gc, COLOR(80, 80, 110, 255));
+		nxgi_draw_line(gc, w.x1 + 1, w.y1 + CMD_BENCH_TITLE - 1, w.x1 + 1, w.y1 + 1);
+		nxgi_draw_line(gc, w.x1 + 1, w.y1 + 1, w.x2 - 1, w.y1 + 1);
+
+		nxgi_set_composite(gc, NXGI_COMPOSITE_SRC_OVER, 255);
+		nxgi_alphablend(gc, POINT(client.x1 + 4, w.y1 + 5), cmd_bench_icon, RECT(0, 0, 16, 16));
+		nxgi_draw_aligned_text(gc, RECT(client.x1 + 25, w.y1 + 5, client.x1 + 160, w.y1 + 21), NXGI_HALIGN_CENTER,
+				NXGI_VALIGN_MIDDLE, "Demo application");
+
+		nxgi_set_color(gc, COLOR(40, 40, 60, 255));
+		nxgi_draw_rect(gc, nxgig_rect_inflate(client, 2));
+		nxgi_set_color(gc, COLOR(80, 80, 110, 255));
+		nxgi_draw_rect(gc, nxgig_rect_inflate(client, 1));
+
+		/* Controls of the window, clipped to it's client area */
+		inner = nxgig_rect_intersection(client, clip);
+		if (nxgig_rect_empty(inner)) {
+			continue;
+		}
+
+		nxgi_set_clip_rect(gc, inner);
+		nxgi_set_offset(gc, client.p1);
+
+		for (k=0; k<CMD_BENCH_BUTTONS; k++) {
+			b = RECT((k % 4) * 76 + 4, (k / 4) * 30 + 4, (k % 4) * 76 + 76, (k / 4) * 30 + 30);
+			sprintf(label, "Button %d", k);
+
+			nxgi_set_color(gc, COLOR(192, 192, 192, 255));
+			nxgi_fill_rect(gc, b);
+			nxgi_set_color(gc, COLOR(64, 64, 64, 255));
+			nxgi_draw_rect(gc, b);
+			nxgi_draw_aligned_text(gc, b, NXGI_HALIGN_CENTER, NXGI_VALIGN_MIDDLE, label);
+		}
+
+		nxgi_set_color(gc, COLOR(255, 255, 0, 255));
+		nxgi_draw_line(gc, 4, 130, 150, 170);
+		nxgi_fill_mask(gc, POINT(160, 130), cmd_bench_mask, 16, SIZE(16, 16));
+		nxgi_set_filter(gc, NXGI_FILTER_BILINEAR);
+		nxgi_stretchblt(gc, RECT(190, 128, 254, 176), cmd_bench_surface, RECT(0, 0, 320, 240));
+	}
+
+	nxgi_set_offset(gc, POINT(0, 0));
+	nxgi_set_clip_rect(gc, clip);
+
+	/* Taskbar and mouse pointer */
+	nxgi_set_color(gc, COLOR(30, 30, 30, 255));
+	nxgi_fill_rect(gc, RECT(0, CMD_BENCH_HEIGHT - 30, CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT));
+	nxgi_draw_text(gc, POINT(25, 70), "Draw time: 3 ms, 60 fps, 412 KB/frame");
+	nxgi_set_color(gc, COLOR(255, 0, 0, 255));
+	nxgi_fill_rect(gc, RECT(504, 388, 512, 396));
+}
+
+/* Draws the frame once per damaged rect, as Henjin repaints */
+static void cmd_bench_immediate(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_REGION *damage)
+{
+	const NXGI_RECT	*rects;
+	uint32_t		count, i;
+
+	if (!damage) {
+		cmd_bench_frame(gc, RECT(0, 0, CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT));
+		return;
+	}
+
+	rects = nxgig_region_rects(damage, &count);
+
+	for (i=0; i<count; i++) {
+		cmd_bench_frame(gc, rects[i]);
+	}
+}
+
+/* Records the whole frame and executes it within the damage */
+static HRESULT cmd_bench_deferred(NXGI_GRAPHICS_CONTEXT *rec, NXGI_COMMAND_LIST *list, NXGI_BITMAP *target, const NXGI_REGION *damage)
+{
+	HRESULT hr;
+
+	nxgi_reset_command_list(list);
+
+	hr = nxgi_begin_record(rec, list);
+	if (FAILED(hr)) return hr;
+
+	cmd_bench_frame(rec, RECT(0, 0, CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT));
+
+	hr = nxgi_end_record(rec);
+	if (FAILED(hr)) return hr;
+
+	return nxgi_execute_command_list(list, target, damage);
+}
+
+/* Microseconds per call of the immediate (list == NULL) or deferred frame */
+static uint32_t cmd_bench_time(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMMAND_LIST *list, NXGI_BITMAP *target, const NXGI_REGION *damage)
+{
+	uint32_t start, elapsed, frames = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		if (list) {
+			cmd_bench_deferred(gc, list, target, damage);
+		} else {
+			cmd_bench_immediate(gc, damage);
+		}
+
+		frames++;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < CMD_BENCH_TIME);
+
+	return elapsed * 1000 / frames;
+}
+
+HRESULT __nxapi nxgi_cmdlist_benchmark()
+{
+	static const char		*case_names[] = {"full frame", "window drag", "scattered damage"};
+	NXGI_BITMAP				*imm = NULL, *def = NULL;
+	NXGI_GRAPHICS_CONTEXT	*gc = NULL, *rec = NULL;
+	NXGI_COMMAND_LIST		*list = NULL;
+	NXGI_REGION				damage;
+	uint32_t				seed = 0xC0DE, i, c, x, y, t_imm, t_def;
+	uint32_t				*p;
+	HRESULT					hr;
+
+	nxgi_span_initialize();
+	nxgig_region_init(&damage);
+
+	hr = nxgi_create_bitmap(CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT, NXGI_FORMAT_BGRA32, &imm);
+	if (SUCCEEDED(hr)) hr = nxgi_create_bitmap(CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT, NXGI_FORMAT_BGRA32, &def);
+	if (SUCCEEDED(hr)) hr = nxgi_create_bitmap(320, 240, NXGI_FORMAT_BGRA32, &cmd_bench_surface);
+	if (SUCCEEDED(hr)) hr = nxgi_create_bitmap(16, 16, NXGI_FORMAT_BGRA32, &cmd_bench_icon);
+	if (SUCCEEDED(hr)) hr = nxgi_create_graphics_context(&gc);
+	if (SUCCEEDED(hr)) hr = nxgi_create_graphics_context(&rec);
+	if (SUCCEEDED(hr)) hr = nxgi_create_command_list(&list);
+	if (FAILED(hr)) goto finally;
+
+	nxgi_set_target(gc, imm);
+	nxgi_set_target(rec, def);
+
+	/* Window contents, a translucent icon and a round mask */
+	for (y=0, p=cmd_bench_surface->pBits; y<240; y++) {
+		for (x=0; x<320; x++) {
+			*p++ = 0xFF000000 | (x * 255 / 320) << 16 | (y * 255 / 240) << 8 | ((x ^ y) & 0xFF);
+		}
+	}
+
+	for (y=0, p=cmd_bench_icon->pBits; y<16; y++) {
+		for (x=0; x<16; x++) {
+			*p++ = (x + y) * 8 << 24 | 0x00FFC040;
+			cmd_bench_mask[y * 16 + x] = (x - 8) * (x - 8) + (y - 8) * (y - 8) < 64 ? 255 : (x + y) * 8;
+		}
+	}
+
+	nxgi_premultiply_bitmap(cmd_bench_icon);
+
+	for (i=0; i<CMD_BENCH_WINDOWS; i++) {
+		x = cmd_bench_rand(&seed) % (CMD_BENCH_WIDTH - 340);
+		y = cmd_bench_rand(&seed) % (CMD_BENCH_HEIGHT - 300);
+
+		cmd_bench_windows[i] = RECT(x, y, x + 200 + cmd_bench_rand(&seed) % 120, y + 190 + cmd_bench_rand(&seed) % 70);
+	}
+
+	for (c=0; c<3; c++) {
+		/* Both start from the same frame */
+		cmd_bench_immediate(gc, NULL);
+		memcpy(def->pBits, imm->pBits, def->stride * def->height);
+
+		switch (c) {
+		case 0:
+			nxgig_region_clear(&damage);
+			hr = nxgig_region_set_rect(&damage, RECT(0, 0, CMD_BENCH_WIDTH, CMD_BENCH_HEIGHT));
+			break;
+
+		case 1:
+			/* Move the top window, damaging where it was and where it is */
+			hr = nxgig_region_set_rect(&damage, cmd_bench_windows[CMD_BENCH_WINDOWS - 1]);
+			cmd_bench_windows[CMD_BENCH_WINDOWS - 1] = nxgig_rect_offset(cmd_bench_windows[CMD_BENCH_WINDOWS - 1], POINT(23, 11));
+			if (SUCCEEDED(hr)) hr = nxgig_region_union_rect(&damage, &damage, cmd_bench_windows[CMD_BENCH_WINDOWS - 1]);
+			break;
+
+		case 2:
+			nxgig_region_clear(&damage);
+
+			for (i=0; i<24 && SUCCEEDED(hr); i++) {
+				x = cmd_bench_rand(&seed) % CMD_BENCH_WIDTH;
+				y = cmd_bench_rand(&seed) % CMD_BENCH_HEIGHT;
+				hr = nxgig_region_union_rect(&damage, &damage, RECT(x, y, x + 8 + cmd_bench_rand(&seed) % 90, y + 8 + cmd_bench_rand(&seed) % 60));
+			}
+			break;
+		}
+
+		if (FAILED(hr)) goto finally;
+
+		cmd_bench_immediate(gc, &damage);
+
+		hr = cmd_bench_deferred(rec, list, def, &damage);
+		if (FAILED(hr)) goto finally;
+
+		if (memcmp(imm->pBits, def->pBits, imm->stride * imm->height) != 0) {
+			k_printf("%s: deferred output differs from immediate.\n", case_names[c]);
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		t_imm = cmd_bench_time(gc, NULL, imm, &damage);
+		t_def = cmd_bench_time(rec, list, def, &damage);
+
+		k_printf("%s, %d rects: immediate %d us, deferred %d us; %d commands, %d culled, %d merged, %d tiles, %d runs\n",
+				case_names[c], damage.count, t_imm, t_def, list->count, list->stats.culled, list->stats.merged,
+				list->stats.tiles, list->stats.runs);
+	}
+
+finally:
+	nxgig_region_fini(&damage);
+	if (list) nxgi_destroy_command_list(list);
+	if (gc) nxgi_destroy_graphics_context(gc);
+	if (rec) nxgi_destroy_graphics_context(rec);
+	if (imm) nxgi_destroy_bitmap(&imm);
+	if (def) nxgi_destroy_bitmap(&def);
+	if (cmd_bench_surface) nxgi_destroy_bitmap(&cmd_bench_surface);
+	if (cmd_bench_icon) nxgi_destroy_bitmap(&cmd_bench_icon);
+
+	return hr;
+}
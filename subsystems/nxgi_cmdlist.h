@@ -0,0 +1,164 @@
+/*
+ * nxgi_cmdlist.h
+ *
+ *	Deferred drawing.
+ *
+ *	A graphics context can record it's drawing calls into a command list
+ *	instead of executing them (nxgi_begin_record()). Offset, clip rect,
+ *	color and the other state are resolved while recording, so every
+ *	command stands on it's own. It keeps the area of the target it draws
+ *	to, already clipped, and the clip rect isn't needed any more.
+ *
+ *	nxgi_execute_command_list() replays a list into a bitmap. It drops the
+ *	commands outside the damaged region and those covered by later fills,
+ *	merges neighbouring fills of the same color, sorts the commands into
+ *	tiles of the target and draws tile by tile, so the pixels of a tile
+ *	stay in cache while all of it's commands run. The result is the same as
+ *	drawing the calls right away, clipped to the damaged region.
+ *
+ *	Bitmaps and masks used by recorded commands are referenced, not copied.
+ *	They must not change until the list is executed. Text is copied.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_CMDLIST_H_
+#define SUBSYSTEMS_NXGI_CMDLIST_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/* Side of the square tiles commands are executed in, in pixels */
+#define NXGI_CMD_TILE_SIZE		64
+
+typedef enum {
+	NXGI_CMD_FILL = 0,
+	NXGI_CMD_LINE,
+	NXGI_CMD_BITBLT,
+	NXGI_CMD_STRETCHBLT,
+	NXGI_CMD_ALPHABLEND,
+	NXGI_CMD_FILL_MASK,
+	NXGI_CMD_TEXT
+} NXGI_CMD_TYPE;
+
+/**
+ * Recorded drawing call. Coordinates are in target space.
+ */
+typedef struct NXGI_CMD NXGI_CMD;
+struct NXGI_CMD {
+	uint8_t		type;
+	uint8_t		composite;
+	uint8_t		alpha;
+	uint8_t		filter;
+	NXGI_COLOR	color;
+
+	/**
+	 * Pixels the command may change, clipped. Fills change all of them.
+	 * Axis-aligned lines are recorded as fills.
+	 */
+	NXGI_RECT	bounds;
+
+	union {
+		/** Diagonal line, endpoints already clipped as draw_line does */
+		struct {
+			NXGI_POINT	p1;
+			NXGI_POINT	p2;
+		} line;
+
+		/** bitblt, stretchblt and alphablend */
+		struct {
+			NXGI_RECT	dst;
+			NXGI_RECT	src_rect;
+			NXGI_BITMAP	*src;
+		} blit;
+
+		struct {
+			NXGI_POINT		pos;
+			NXGI_SIZE		size;
+			const uint8_t	*mask;
+			uint32_t		stride;
+		} mask;
+
+		/** Text is kept in the list's text buffer, at `offset` */
+		struct {
+			NXGI_POINT			pos;
+			NXGI_GLYPH_CACHE	*glyphs;
+			uint32_t			offset;
+		} text;
+	};
+};
+
+/**
+ * Counters of the last execution.
+ */
+typedef struct NXGI_CMD_STATS NXGI_CMD_STATS;
+struct NXGI_CMD_STATS {
+	/** Commands outside the damaged region or covered by later fills */
+	uint32_t	culled;
+
+	/** Fills merged into the one before */
+	uint32_t	merged;
+
+	/** Tiles drawn, and commands run summed over all tiles */
+	uint32_t	tiles;
+	uint32_t	runs;
+};
+
+/**
+ * Recorded commands. Typedef'd in nxgi.h.
+ */
+struct NXGI_COMMAND_LIST {
+	NXGI_CMD	*cmds;
+	uint32_t	count;
+	uint32_t	capacity;
+
+	char		*text;
+	uint32_t	text_size;
+	uint32_t	text_capacity;
+
+	/* Execution scratch: surviving commands, and their indexes binned by tile */
+	NXGI_CMD	*live;
+	uint32_t	live_capacity;
+	uint32_t	*bins;
+	uint32_t	bins_capacity;
+	uint32_t	*bin_start;
+	uint32_t	bin_start_capacity;
+
+	/** Context used to replay blits and text */
+	NXGI_GRAPHICS_CONTEXT	*gc;
+
+	NXGI_CMD_STATS	stats;
+};
+
+HRESULT	__nxapi nxgi_create_command_list(NXGI_COMMAND_LIST **list_out);
+void	__nxapi nxgi_destroy_command_list(NXGI_COMMAND_LIST *list);
+
+/**
+ * Drops all recorded commands, keeping the memory for the next frame.
+ */
+void	__nxapi nxgi_reset_command_list(NXGI_COMMAND_LIST *list);
+
+/**
+ * Makes `gc` append its drawing calls to `list`, until nxgi_end_record().
+ * The context must have a BGRA32 target, which gives the clip rect's
+ * bounds but isn't drawn to. set_pixel and get_pixel aren't available
+ * while recording and the target can't be changed.
+ */
+HRESULT	__nxapi nxgi_begin_record(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMMAND_LIST *list);
+HRESULT	__nxapi nxgi_end_record(NXGI_GRAPHICS_CONTEXT *gc);
+
+/**
+ * Draws the recorded commands onto a BGRA32 bitmap, only within
+ * `damage` or everywhere if it's NULL. The list is left unchanged, so it
+ * can be executed again.
+ */
+HRESULT	__nxapi nxgi_execute_command_list(NXGI_COMMAND_LIST *list, NXGI_BITMAP *target, const NXGI_REGION *damage);
+
+/**
+ * Replays Henjin-like frames immediately and through a command list,
+ * comparing the output and time per frame.
+ */
+HRESULT	__nxapi nxgi_cmdlist_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_CMDLIST_H_ */
@@ -0,0 +1,939 @@
+/*
+ * nxgi_convert.c
+ *
+ *	Pixel format conversion.
+ *
+ *	Converters are kept in tables indexed by destination and source format.
+ *	The vector tables only hold the pairs they speed up, the rest fall back
+ *	to C when the tables are merged by convert_select().
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <cpuid.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <mm.h>
+#include <hal.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_convert.h"
+#include "nxgi_span.h"
+
+/* EFLAGS interrupt flag */
+#define EFLAGS_IF				0x200
+
+/* CPUID feature bits */
+#define CPUID_1_ECX_SSSE3		(1 << 9)
+
+/* Pixels converted at once by two-step conversions */
+#define CONVERT_CHUNK			256
+
+typedef void (*CONVERT_SPAN)(void *dst, const void *src, uint32_t count);
+
+typedef enum {
+	CONVERT_ISA_C = 0,
+	CONVERT_ISA_SSE2,
+	CONVERT_ISA_SSSE3,
+	CONVERT_ISA_COUNT
+} CONVERT_ISA;
+
+typedef struct {
+	CONVERT_SPAN	span;
+	BOOL			vector;
+} CONVERT_KERNEL;
+
+/*
+ * Constants of the vector kernels.
+ */
+static const struct {
+	uint32_t	ag[4];
+	uint32_t	rb[4];
+	uint32_t	alpha32[4];
+	uint32_t	low16[4];
+	uint16_t	mask5[8];
+	uint16_t	mul5[8];
+	uint16_t	alpha16[8];
+	uint16_t	round[8];
+	uint16_t	mul[8];
+	uint8_t		swizzle[16];
+	uint8_t		pack24[16];
+	uint8_t		expand24[16];
+} __attribute__((aligned(16))) convert_k = {
+		.ag = { [0 ... 3] = 0xFF00FF00 },
+		.rb = { [0 ... 3] = 0x00FF00FF },
+		.alpha32 = { [0 ... 3] = 0xFF000000 },
+		.low16 = { 0xFFFF, 0, 0xFFFF, 0 },
+		.mask5 = { [0 ... 7] = 0x1F },
+		.mul5 = { [0 ... 7] = 33 },
+		.alpha16 = { [0 ... 7] = 0xFF00 },
+		.round = { [0 ... 7] = 0x80 },
+		.mul = { [0 ... 7] = 0x101 },
+		.swizzle = { 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 },
+		.pack24 = { 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0x80, 0x80, 0x80, 0x80 },
+		.expand24 = { 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80 }
+};
+
+/*
+ * The parts of a 16-bit format which differ between RGB565 and RGB555.
+ * Blue and red are always 5 bits wide.
+ */
+typedef struct {
+	/** Green mask, after shifting it down */
+	uint16_t	g_mask[8];
+
+	/** Expands green to 8 bits, together with g_norm */
+	uint16_t	g_mul[8];
+	uint64_t	g_norm[2];
+
+	uint64_t	g_shift[2];
+	uint64_t	r_shift[2];
+
+	/** Channel maximums, blue, green, red, alpha */
+	uint16_t	pack_max[8];
+
+	/** Channel positions, as multipliers */
+	uint16_t	pack_shl[8];
+} __attribute__((aligned(16))) CONVERT_K16;
+
+static const CONVERT_K16 convert_k565 = {
+		.g_mask = { [0 ... 7] = 0x3F },
+		.g_mul = { [0 ... 7] = 65 },
+		.g_norm = { 4, 0 },
+		.g_shift = { 5, 0 },
+		.r_shift = { 11, 0 },
+		.pack_max = { 31, 63, 31, 0, 31, 63, 31, 0 },
+		.pack_shl = { 1, 1 << 5, 1 << 11, 0, 1, 1 << 5, 1 << 11, 0 }
+};
+
+static const CONVERT_K16 convert_k555 = {
+		.g_mask = { [0 ... 7] = 0x1F },
+		.g_mul = { [0 ... 7] = 33 },
+		.g_norm = { 2, 0 },
+		.g_shift = { 5, 0 },
+		.r_shift = { 10, 0 },
+		.pack_max = { 31, 31, 31, 0, 31, 31, 31, 0 },
+		.pack_shl = { 1, 1 << 5, 1 << 10, 0, 1, 1 << 5, 1 << 10, 0 }
+};
+
+static const char *convert_isa_names[CONVERT_ISA_COUNT] = { "C", "SSE2", "SSSE3" };
+
+static BOOL				convert_supported[CONVERT_ISA_COUNT] = { TRUE, FALSE, FALSE };
+static BOOL				convert_initialized = FALSE;
+static CONVERT_ISA		convert_isa = CONVERT_ISA_C;
+static CONVERT_KERNEL	convert_cur[NXGI_FORMAT_COUNT][NXGI_FORMAT_COUNT];
+
+static inline uint32_t convert_bytes(NXGI_FORMAT fmt)
+{
+	return video_format_to_bpp((K_VIDEO_FORMAT)fmt) / 8;
+}
+
+/*
+ * C kernels
+ */
+static void convert_copy32_c(void *dst, const void *src, uint32_t count)
+{
+	memcpy(dst, src, count * 4);
+}
+
+static void convert_copy24_c(void *dst, const void *src, uint32_t count)
+{
+	memcpy(dst, src, count * 3);
+}
+
+static void convert_copy16_c(void *dst, const void *src, uint32_t count)
+{
+	memcpy(dst, src, count * 2);
+}
+
+/* BGRA32 <-> RGBA32, the same both ways */
+static void convert_swizzle_c(void *dst, const void *src, uint32_t count)
+{
+	const uint32_t	*s = src;
+	uint32_t		*d = dst, p;
+
+	while (count--) {
+		p = *s++;
+		*d++ = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+	}
+}
+
+static void convert_unpack24_c(void *dst, const void *src, uint32_t count)
+{
+	const uint8_t	*s = src;
+	uint32_t		*d = dst;
+
+	while (count--) {
+		*d++ = (uint32_t)s[0] | ((uint32_t)s[1] << 8) | ((uint32_t)s[2] << 16) | 0xFF000000;
+		s += 3;
+	}
+}
+
+static void convert_pack24_c(void *dst, const void *src, uint32_t count)
+{
+	const uint32_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		p;
+
+	while (count--) {
+		p = *s++;
+		d[0] = (uint8_t)p;
+		d[1] = (uint8_t)(p >> 8);
+		d[2] = (uint8_t)(p >> 16);
+		d += 3;
+	}
+}
+
+static inline uint32_t convert_expand5(uint32_t v)
+{
+	return (v << 3) | (v >> 2);
+}
+
+static inline uint32_t convert_expand6(uint32_t v)
+{
+	return (v << 2) | (v >> 4);
+}
+
+static void convert_unpack565_c(void *dst, const void *src, uint32_t count)
+{
+	const uint16_t	*s = src;
+	uint32_t		*d = dst, v;
+
+	while (count--) {
+		v = *s++;
+		*d++ = convert_expand5(v & 0x1F) | (convert_expand6((v >> 5) & 0x3F) << 8) |
+				(convert_expand5(v >> 11) << 16) | 0xFF000000;
+	}
+}
+
+static void convert_pack565_c(void *dst, const void *src, uint32_t count)
+{
+	const uint32_t	*s = src;
+	uint16_t		*d = dst;
+	uint32_t		p;
+
+	while (count--) {
+		p = *s++;
+		*d++ = (uint16_t)(nxgi_span_mul255(p & 0xFF, 31) | (nxgi_span_mul255((p >> 8) & 0xFF, 63) << 5) |
+				(nxgi_span_mul255((p >> 16) & 0xFF, 31) << 11));
+	}
+}
+
+static void convert_unpack555_c(void *dst, const void *src, uint32_t count)
+{
+	const uint16_t	*s = src;
+	uint32_t		*d = dst, v;
+
+	while (count--) {
+		v = *s++;
+		*d++ = convert_expand5(v & 0x1F) | (convert_expand5((v >> 5) & 0x1F) << 8) |
+				(convert_expand5((v >> 10) & 0x1F) << 16) | 0xFF000000;
+	}
+}
+
+static void convert_pack555_c(void *dst, const void *src, uint32_t count)
+{
+	const uint32_t	*s = src;
+	uint16_t		*d = dst;
+	uint32_t		p;
+
+	while (count--) {
+		p = *s++;
+		*d++ = (uint16_t)(nxgi_span_mul255(p & 0xFF, 31) | (nxgi_span_mul255((p >> 8) & 0xFF, 31) << 5) |
+				(nxgi_span_mul255((p >> 16) & 0xFF, 31) << 10));
+	}
+}
+
+/*
+ * SSE2 kernels. Loads and stores are unaligned, 24-bit and 16-bit rows
+ * rarely are.
+ */
+static void __attribute__((target("sse2"))) convert_swizzle_sse2(void *dst, const void *src, uint32_t count)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	/* Red and blue are swapped by swapping the words of each pixel */
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"movdqa		%[ag], %%xmm6\n\t"
+				"movdqa		%[rb], %%xmm7\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"pand		%%xmm6, %%xmm0\n\t"
+				"pand		%%xmm7, %%xmm1\n\t"
+				"pshuflw	$0xB1, %%xmm1, %%xmm1\n\t"
+				"pshufhw	$0xB1, %%xmm1, %%xmm1\n\t"
+				"por		%%xmm1, %%xmm0\n\t"
+				"movdqu		%%xmm0, (%[d])\n\t"
+				"add		$16, %[s]\n\t"
+				"add		$16, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [ag] "m" (convert_k.ag), [rb] "m" (convert_k.rb)
+				: "xmm0", "xmm1", "xmm6", "xmm7", "memory", "cc");
+	}
+
+	convert_swizzle_c(d, s, count % 4);
+}
+
+/*
+ * Expands 8 pixels per iteration, in 16-bit lanes. A channel of n bits is
+ * widened to 8 by multiplying it with (2^n + 1) and shifting right by
+ * (2n - 8), which replicates it's high bits into the low ones.
+ */
+static void __attribute__((target("sse2"))) convert_unpack16_sse2(void *dst, const void *src, uint32_t count, const CONVERT_K16 *k)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	if ((n = count / 8) > 0) {
+		asm volatile(
+				"movdqa		%[m5], %%xmm6\n\t"
+				"movdqa		%[mul5], %%xmm7\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				/* Blue */
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"pand		%%xmm6, %%xmm1\n\t"
+				"pmullw		%%xmm7, %%xmm1\n\t"
+				"psrlw		$2, %%xmm1\n\t"
+				/* Green */
+				"movdqa		%%xmm0, %%xmm2\n\t"
+				"psrlw		%c[gs](%[k]), %%xmm2\n\t"
+				"pand		%c[gm](%[k]), %%xmm2\n\t"
+				"pmullw		%c[gmul](%[k]), %%xmm2\n\t"
+				"psrlw		%c[gn](%[k]), %%xmm2\n\t"
+				"psllw		$8, %%xmm2\n\t"
+				"por		%%xmm2, %%xmm1\n\t"
+				/* Red and alpha */
+				"psrlw		%c[rs](%[k]), %%xmm0\n\t"
+				"pand		%%xmm6, %%xmm0\n\t"
+				"pmullw		%%xmm7, %%xmm0\n\t"
+				"psrlw		$2, %%xmm0\n\t"
+				"por		%[a16], %%xmm0\n\t"
+				/* Interleave blue/green and red/alpha words */
+				"movdqa		%%xmm1, %%xmm2\n\t"
+				"punpcklwd	%%xmm0, %%xmm1\n\t"
+				"punpckhwd	%%xmm0, %%xmm2\n\t"
+				"movdqu		%%xmm1, (%[d])\n\t"
+				"movdqu		%%xmm2, 16(%[d])\n\t"
+				"add		$16, %[s]\n\t"
+				"add		$32, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [k] "r" (k), [m5] "m" (convert_k.mask5), [mul5] "m" (convert_k.mul5), [a16] "m" (convert_k.alpha16),
+				  [gm] "i" (offsetof(CONVERT_K16, g_mask)), [gmul] "i" (offsetof(CONVERT_K16, g_mul)),
+				  [gn] "i" (offsetof(CONVERT_K16, g_norm)), [gs] "i" (offsetof(CONVERT_K16, g_shift)),
+				  [rs] "i" (offsetof(CONVERT_K16, r_shift))
+				: "xmm0", "xmm1", "xmm2", "xmm6", "xmm7", "memory", "cc");
+	}
+
+	if (k == &convert_k565) {
+		convert_unpack565_c(d, s, count % 8);
+	} else {
+		convert_unpack555_c(d, s, count % 8);
+	}
+}
+
+/*
+ * Packs 4 pixels per iteration. Channels are scaled with the same rounding
+ * as nxgi_span_mul255(), moved to their place by multiplying and or-ed
+ * together within each pixel. The 16-bit results are sign extended before
+ * packssdw, so it doesn't saturate them.
+ */
+static void __attribute__((target("sse2"))) convert_pack16_sse2(void *dst, const void *src, uint32_t count, const CONVERT_K16 *k)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"pxor		%%xmm7, %%xmm7\n\t"
+				"movdqa		%[rnd], %%xmm6\n\t"
+				"movdqa		%[mul], %%xmm5\n\t"
+				"movdqa		%[lo], %%xmm4\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"punpcklbw	%%xmm7, %%xmm0\n\t"
+				"punpckhbw	%%xmm7, %%xmm1\n\t"
+				"pmullw		%c[pm](%[k]), %%xmm0\n\t"
+				"pmullw		%c[pm](%[k]), %%xmm1\n\t"
+				"paddw		%%xmm6, %%xmm0\n\t"
+				"paddw		%%xmm6, %%xmm1\n\t"
+				"pmulhuw	%%xmm5, %%xmm0\n\t"
+				"pmulhuw	%%xmm5, %%xmm1\n\t"
+				"pmullw		%c[ps](%[k]), %%xmm0\n\t"
+				"pmullw		%c[ps](%[k]), %%xmm1\n\t"
+				/* Or the four words of each pixel into it's lowest one */
+				"movdqa		%%xmm0, %%xmm2\n\t"
+				"movdqa		%%xmm1, %%xmm3\n\t"
+				"psrlq		$32, %%xmm2\n\t"
+				"psrlq		$32, %%xmm3\n\t"
+				"por		%%xmm2, %%xmm0\n\t"
+				"por		%%xmm3, %%xmm1\n\t"
+				"movdqa		%%xmm0, %%xmm2\n\t"
+				"movdqa		%%xmm1, %%xmm3\n\t"
+				"psrlq		$16, %%xmm2\n\t"
+				"psrlq		$16, %%xmm3\n\t"
+				"por		%%xmm2, %%xmm0\n\t"
+				"por		%%xmm3, %%xmm1\n\t"
+				"pand		%%xmm4, %%xmm0\n\t"
+				"pand		%%xmm4, %%xmm1\n\t"
+				/* Gather the four pixels and narrow them to words */
+				"pshufd		$0x08, %%xmm0, %%xmm0\n\t"
+				"pshufd		$0x08, %%xmm1, %%xmm1\n\t"
+				"punpcklqdq	%%xmm1, %%xmm0\n\t"
+				"pslld		$16, %%xmm0\n\t"
+				"psrad		$16, %%xmm0\n\t"
+				"packssdw	%%xmm0, %%xmm0\n\t"
+				"movq		%%xmm0, (%[d])\n\t"
+				"add		$16, %[s]\n\t"
+				"add		$8, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [k] "r" (k), [rnd] "m" (convert_k.round), [mul] "m" (convert_k.mul), [lo] "m" (convert_k.low16),
+				  [pm] "i" (offsetof(CONVERT_K16, pack_max)), [ps] "i" (offsetof(CONVERT_K16, pack_shl))
+				: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+	}
+
+	if (k == &convert_k565) {
+		convert_pack565_c(d, s, count % 4);
+	} else {
+		convert_pack555_c(d, s, count % 4);
+	}
+}
+
+static void convert_unpack565_sse2(void *dst, const void *src, uint32_t count)
+{
+	convert_unpack16_sse2(dst, src, count, &convert_k565);
+}
+
+static void convert_pack565_sse2(void *dst, const void *src, uint32_t count)
+{
+	convert_pack16_sse2(dst, src, count, &convert_k565);
+}
+
+static void convert_unpack555_sse2(void *dst, const void *src, uint32_t count)
+{
+	convert_unpack16_sse2(dst, src, count, &convert_k555);
+}
+
+static void convert_pack555_sse2(void *dst, const void *src, uint32_t count)
+{
+	convert_pack16_sse2(dst, src, count, &convert_k555);
+}
+
+/*
+ * SSSE3 kernels
+ */
+static void __attribute__((target("ssse3"))) convert_swizzle_ssse3(void *dst, const void *src, uint32_t count)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	if ((n = count / 8) > 0) {
+		asm volatile(
+				"movdqa		%[shuf], %%xmm7\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				"movdqu		16(%[s]), %%xmm1\n\t"
+				"pshufb		%%xmm7, %%xmm0\n\t"
+				"pshufb		%%xmm7, %%xmm1\n\t"
+				"movdqu		%%xmm0, (%[d])\n\t"
+				"movdqu		%%xmm1, 16(%[d])\n\t"
+				"add		$32, %[s]\n\t"
+				"add		$32, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [shuf] "m" (convert_k.swizzle)
+				: "xmm0", "xmm1", "xmm7", "memory", "cc");
+	}
+
+	convert_swizzle_c(d, s, count % 8);
+}
+
+/*
+ * Each 16 byte load holds 5 and a third 24-bit pixels, of which 4 are used.
+ * The last load must not cross the end of the source, so there have to be
+ * at least 6 pixels left.
+ */
+static void __attribute__((target("ssse3"))) convert_unpack24_ssse3(void *dst, const void *src, uint32_t count)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	if (count >= 6 && (n = (count - 2) / 4) > 0) {
+		count -= n * 4;
+
+		asm volatile(
+				"movdqa		%[shuf], %%xmm7\n\t"
+				"movdqa		%[a32], %%xmm6\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				"pshufb		%%xmm7, %%xmm0\n\t"
+				"por		%%xmm6, %%xmm0\n\t"
+				"movdqu		%%xmm0, (%[d])\n\t"
+				"add		$12, %[s]\n\t"
+				"add		$16, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [shuf] "m" (convert_k.expand24), [a32] "m" (convert_k.alpha32)
+				: "xmm0", "xmm6", "xmm7", "memory", "cc");
+	}
+
+	convert_unpack24_c(d, s, count);
+}
+
+static void __attribute__((target("ssse3"))) convert_pack24_ssse3(void *dst, const void *src, uint32_t count)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	uint32_t		n;
+
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"movdqa		%[shuf], %%xmm7\n\t"
+				"1:\n\t"
+				"movdqu		(%[s]), %%xmm0\n\t"
+				"pshufb		%%xmm7, %%xmm0\n\t"
+				"movq		%%xmm0, (%[d])\n\t"
+				"psrldq		$8, %%xmm0\n\t"
+				"movd		%%xmm0, 8(%[d])\n\t"
+				"add		$16, %[s]\n\t"
+				"add		$12, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (d), [s] "+r" (s), [n] "+r" (n)
+				: [shuf] "m" (convert_k.pack24)
+				: "xmm0", "xmm7", "memory", "cc");
+	}
+
+	convert_pack24_c(d, s, count % 4);
+}
+
+/*
+ * Converter tables, [destination][source].
+ */
+#define F(x)	NXGI_FORMAT_##x
+
+static const CONVERT_SPAN convert_c[NXGI_FORMAT_COUNT][NXGI_FORMAT_COUNT] = {
+		[F(BGRA32)] = {
+				[F(BGRA32)] = convert_copy32_c,
+				[F(RGBA32)] = convert_swizzle_c,
+				[F(RGB24)] = convert_unpack24_c,
+				[F(RGB565)] = convert_unpack565_c,
+				[F(RGB555)] = convert_unpack555_c
+		},
+		[F(RGBA32)] = {
+				[F(RGBA32)] = convert_copy32_c,
+				[F(BGRA32)] = convert_swizzle_c
+		},
+		[F(RGB24)] = {
+				[F(RGB24)] = convert_copy24_c,
+				[F(BGRA32)] = convert_pack24_c
+		},
+		[F(RGB565)] = {
+				[F(RGB565)] = convert_copy16_c,
+				[F(BGRA32)] = convert_pack565_c
+		},
+		[F(RGB555)] = {
+				[F(RGB555)] = convert_copy16_c,
+				[F(BGRA32)] = convert_pack555_c
+		}
+};
+
+static const CONVERT_SPAN convert_sse2[NXGI_FORMAT_COUNT][NXGI_FORMAT_COUNT] = {
+		[F(BGRA32)] = {
+				[F(RGBA32)] = convert_swizzle_sse2,
+				[F(RGB565)] = convert_unpack565_sse2,
+				[F(RGB555)] = convert_unpack555_sse2
+		},
+		[F(RGBA32)] = {
+				[F(BGRA32)] = convert_swizzle_sse2
+		},
+		[F(RGB565)] = {
+				[F(BGRA32)] = convert_pack565_sse2
+		},
+		[F(RGB555)] = {
+				[F(BGRA32)] = convert_pack555_sse2
+		}
+};
+
+static const CONVERT_SPAN convert_ssse3[NXGI_FORMAT_COUNT][NXGI_FORMAT_COUNT] = {
+		[F(BGRA32)] = {
+				[F(RGBA32)] = convert_swizzle_ssse3,
+				[F(RGB24)] = convert_unpack24_ssse3
+		},
+		[F(RGBA32)] = {
+				[F(BGRA32)] = convert_swizzle_ssse3
+		},
+		[F(RGB24)] = {
+				[F(BGRA32)] = convert_pack24_ssse3
+		}
+};
+
+#undef F
+
+static const CONVERT_SPAN (*convert_tables[CONVERT_ISA_COUNT])[NXGI_FORMAT_COUNT] = {
+		convert_c, convert_sse2, convert_ssse3
+};
+
+/*
+ * Fills convert_cur with the best converter of each pair up to `isa`.
+ */
+static void convert_select(CONVERT_ISA isa)
+{
+	uint32_t	d, s;
+	int32_t		i;
+
+	for (d=0; d<NXGI_FORMAT_COUNT; d++) {
+		for (s=0; s<NXGI_FORMAT_COUNT; s++) {
+			convert_cur[d][s].span = convert_c[d][s];
+			convert_cur[d][s].vector = FALSE;
+
+			for (i=isa; i>CONVERT_ISA_C; i--) {
+				if (convert_tables[i][d][s] != NULL) {
+					convert_cur[d][s].span = convert_tables[i][d][s];
+					convert_cur[d][s].vector = TRUE;
+					break;
+				}
+			}
+		}
+	}
+
+	convert_isa = isa;
+}
+
+/*
+ * Runs a single converter, with interrupts disabled if it uses vector
+ * registers. Short spans are done in C.
+ */
+static void convert_run(NXGI_FORMAT dst_fmt, NXGI_FORMAT src_fmt, void *dst, const void *src, uint32_t count)
+{
+	const CONVERT_KERNEL	*k = &convert_cur[dst_fmt][src_fmt];
+	uint32_t				intf;
+
+	if (!k->vector || count < NXGI_SPAN_MIN_VECTOR) {
+		convert_c[dst_fmt][src_fmt](dst, src, count);
+		return;
+	}
+
+	intf = hal_get_eflags() & EFLAGS_IF;
+	hal_cli();
+
+	k->span(dst, src, count);
+
+	if (intf) hal_sti();
+}
+
+/*
+ * Public interface
+ */
+HRESULT __nxapi nxgi_convert_initialize()
+{
+	uint32_t eax, ebx, ecx, edx;
+
+	if (convert_initialized) {
+		return S_FALSE;
+	}
+
+	convert_initialized = TRUE;
+
+	/* SSE is enabled by the span kernels */
+	nxgi_span_initialize();
+
+	if (nxgi_span_get_isa() != NXGI_SPAN_ISA_C) {
+		convert_supported[CONVERT_ISA_SSE2] = TRUE;
+
+		__cpuid(1, eax, ebx, ecx, edx);
+		if (ecx & CPUID_1_ECX_SSSE3) {
+			convert_supported[CONVERT_ISA_SSSE3] = TRUE;
+		}
+	}
+
+	convert_select(convert_supported[CONVERT_ISA_SSSE3] ? CONVERT_ISA_SSSE3 :
+			convert_supported[CONVERT_ISA_SSE2] ? CONVERT_ISA_SSE2 : CONVERT_ISA_C);
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_convert_span(void *dst, NXGI_FORMAT dst_fmt, const void *src, NXGI_FORMAT src_fmt, uint32_t count)
+{
+	uint32_t	tmp[CONVERT_CHUNK], n, src_bytes, dst_bytes;
+	const uint8_t *s = src;
+	uint8_t		*d = dst;
+
+	if ((uint32_t)dst_fmt >= NXGI_FORMAT_COUNT || (uint32_t)src_fmt >= NXGI_FORMAT_COUNT) {
+		return E_INVALIDARG;
+	}
+
+	if (!convert_initialized) {
+		nxgi_convert_initialize();
+	}
+
+	if (dst_fmt == src_fmt) {
+		memmove(dst, src, count * convert_bytes(src_fmt));
+		return S_OK;
+	}
+
+	if (convert_cur[dst_fmt][src_fmt].span != NULL) {
+		convert_run(dst_fmt, src_fmt, dst, src, count);
+		return S_OK;
+	}
+
+	/* Two steps, through BGRA32 */
+	src_bytes = convert_bytes(src_fmt);
+	dst_bytes = convert_bytes(dst_fmt);
+
+	while (count > 0) {
+		n = count < CONVERT_CHUNK ? count : CONVERT_CHUNK;
+
+		convert_run(NXGI_FORMAT_BGRA32, src_fmt, tmp, s, n);
+		convert_run(dst_fmt, NXGI_FORMAT_BGRA32, d, tmp, n);
+
+		s += n * src_bytes;
+		d += n * dst_bytes;
+		count -= n;
+	}
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_convert_rect(void *dst, uint32_t dst_stride, NXGI_FORMAT dst_fmt,
+									const void *src, uint32_t src_stride, NXGI_FORMAT src_fmt,
+									uint32_t width, uint32_t height)
+{
+	const uint8_t	*s = src;
+	uint8_t			*d = dst;
+	HRESULT			hr;
+
+	while (height--) {
+		hr = nxgi_convert_span(d, dst_fmt, s, src_fmt, width);
+		if (FAILED(hr)) return hr;
+
+		d += dst_stride;
+		s += src_stride;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Benchmark. Every 16-bit value, and every 24-bit one in chunks, is expanded
+ * to BGRA32 and packed back, which must give the same value. Then each
+ * format pair is converted from random data by every kernel set and compared
+ * with C, at an odd offset and length, and finally timed on 1024x256 pixels.
+ */
+#define CONVERT_BENCH_WIDTH		1024
+#define CONVERT_BENCH_HEIGHT	256
+#define CONVERT_BENCH_TIME		1000
+#define CONVERT_BENCH_VERIFY	1000
+
+static const char *convert_format_names[NXGI_FORMAT_COUNT] = {
+		[NXGI_FORMAT_RGBA32] = "RGBA32",
+		[NXGI_FORMAT_BGRA32] = "BGRA32",
+		[NXGI_FORMAT_RGB24] = "RGB24",
+		[NXGI_FORMAT_RGB565] = "RGB565",
+		[NXGI_FORMAT_RGB555] = "RGB555"
+};
+
+/* Timed pairs, destination and source */
+static const NXGI_FORMAT convert_bench_pairs[][2] = {
+		{ NXGI_FORMAT_RGBA32, NXGI_FORMAT_BGRA32 },
+		{ NXGI_FORMAT_RGB24, NXGI_FORMAT_BGRA32 },
+		{ NXGI_FORMAT_BGRA32, NXGI_FORMAT_RGB24 },
+		{ NXGI_FORMAT_RGB565, NXGI_FORMAT_BGRA32 },
+		{ NXGI_FORMAT_BGRA32, NXGI_FORMAT_RGB565 },
+		{ NXGI_FORMAT_RGB555, NXGI_FORMAT_BGRA32 },
+		{ NXGI_FORMAT_BGRA32, NXGI_FORMAT_RGB555 },
+		{ NXGI_FORMAT_RGB565, NXGI_FORMAT_RGB24 }
+};
+
+static void convert_bench_pattern(uint8_t *p, uint32_t count, uint32_t seed)
+{
+	while (count--) {
+		seed = seed * 1103515245 + 12345;
+		*p++ = (uint8_t)(seed >> 16);
+	}
+}
+
+/*
+ * Round trip of every value of a 16-bit format. RGB555 has no alpha, so
+ * it's top bit is expected to come back clear.
+ */
+static HRESULT convert_bench_round16(NXGI_FORMAT fmt, uint16_t *src, uint32_t *mid, uint16_t *out)
+{
+	uint32_t i, mask = fmt == NXGI_FORMAT_RGB555 ? 0x7FFF : 0xFFFF;
+
+	for (i=0; i<65536; i++) src[i] = (uint16_t)i;
+
+	nxgi_convert_rect(mid, 0, NXGI_FORMAT_BGRA32, src, 0, fmt, 65536, 1);
+	nxgi_convert_rect(out, 0, fmt, mid, 0, NXGI_FORMAT_BGRA32, 65536, 1);
+
+	for (i=0; i<65536; i++) {
+		if (out[i] != (i & mask) || (mid[i] >> 24) != 0xFF) {
+			k_printf("%s 0x%X comes back as 0x%X, via 0x%X.\n", convert_format_names[fmt], i, out[i], mid[i]);
+			return E_FAIL;
+		}
+	}
+
+	return S_OK;
+}
+
+static HRESULT convert_bench_round24(uint8_t *src, uint32_t *mid, uint8_t *out)
+{
+	uint32_t hi, i;
+
+	for (hi=0; hi<256; hi++) {
+		for (i=0; i<65536; i++) {
+			src[i * 3] = (uint8_t)i;
+			src[i * 3 + 1] = (uint8_t)(i >> 8);
+			src[i * 3 + 2] = (uint8_t)hi;
+		}
+
+		nxgi_convert_rect(mid, 0, NXGI_FORMAT_BGRA32, src, 0, NXGI_FORMAT_RGB24, 65536, 1);
+		nxgi_convert_rect(out, 0, NXGI_FORMAT_RGB24, mid, 0, NXGI_FORMAT_BGRA32, 65536, 1);
+
+		for (i=0; i<65536; i++) {
+			if (mid[i] != (0xFF000000 | (hi << 16) | i) || memcmp(out + i * 3, src + i * 3, 3) != 0) {
+				k_printf("RGB24 0x%X comes back wrong, via 0x%X.\n", (hi << 16) | i, mid[i]);
+				return E_FAIL;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Every pair, by the current kernels and by C. One pixel of each side is
+ * left out, for the heads and tails.
+ */
+static HRESULT convert_bench_compare(uint8_t *src, uint8_t *out, uint8_t *ref)
+{
+	uint32_t		d, s, bytes, count = CONVERT_BENCH_VERIFY;
+	CONVERT_ISA		isa = convert_isa;
+
+	for (d=0; d<NXGI_FORMAT_COUNT; d++) {
+		for (s=0; s<NXGI_FORMAT_COUNT; s++) {
+			bytes = convert_bytes(d);
+
+			convert_bench_pattern(src, count * 4, d * 16 + s);
+			memset(out, 0xCC, count * 4);
+			memset(ref, 0xCC, count * 4);
+
+			convert_select(CONVERT_ISA_C);
+			nxgi_convert_span(ref + bytes, d, src + convert_bytes(s), s, count - 2);
+
+			convert_select(isa);
+			nxgi_convert_span(out + bytes, d, src + convert_bytes(s), s, count - 2);
+
+			if (memcmp(out, ref, count * bytes) != 0) {
+				k_printf("%s from %s differs from C.\n", convert_format_names[d], convert_format_names[s]);
+				return E_FAIL;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Converts rows of `src` into `dst` until CONVERT_BENCH_TIME elapses and
+ * returns the throughput in Mpixels/s.
+ */
+static uint32_t convert_bench_rate(NXGI_FORMAT dst_fmt, NXGI_FORMAT src_fmt, uint8_t *dst, const uint8_t *src)
+{
+	uint32_t start, elapsed;
+	uint64_t pixels = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		nxgi_convert_rect(dst, CONVERT_BENCH_WIDTH * 4, dst_fmt, src, CONVERT_BENCH_WIDTH * 4, src_fmt,
+				CONVERT_BENCH_WIDTH, CONVERT_BENCH_HEIGHT);
+
+		pixels += CONVERT_BENCH_WIDTH * CONVERT_BENCH_HEIGHT;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < CONVERT_BENCH_TIME);
+
+	return (uint32_t)udiv64(pixels, elapsed * 1000, NULL);
+}
+
+HRESULT __nxapi nxgi_convert_benchmark()
+{
+	uint8_t		*src = NULL, *mid = NULL, *out = NULL;
+	uint32_t	isa, i, size = CONVERT_BENCH_WIDTH * CONVERT_BENCH_HEIGHT * 4;
+	CONVERT_ISA	saved_isa;
+	HRESULT		hr = S_OK;
+
+	nxgi_convert_initialize();
+	saved_isa = convert_isa;
+
+	/* Large enough for the round trips too */
+	src = kmalloc(size);
+	mid = kmalloc(size);
+	out = kmalloc(size);
+
+	if (!src || !mid || !out) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (isa=CONVERT_ISA_C; isa<CONVERT_ISA_COUNT; isa++) {
+		if (!convert_supported[isa]) continue;
+
+		convert_select(isa);
+
+		/* Correctness */
+		hr = convert_bench_round16(NXGI_FORMAT_RGB565, (uint16_t*)src, (uint32_t*)mid, (uint16_t*)out);
+		if (FAILED(hr)) goto finally;
+
+		hr = convert_bench_round16(NXGI_FORMAT_RGB555, (uint16_t*)src, (uint32_t*)mid, (uint16_t*)out);
+		if (FAILED(hr)) goto finally;
+
+		hr = convert_bench_round24(src, (uint32_t*)mid, out);
+		if (FAILED(hr)) goto finally;
+
+		if (isa != CONVERT_ISA_C) {
+			hr = convert_bench_compare(src, out, mid);
+			if (FAILED(hr)) goto finally;
+		}
+
+		k_printf("%s: round trips exact%s.\n", convert_isa_names[isa], isa != CONVERT_ISA_C ? ", output matches C" : "");
+
+		/* Throughput */
+		convert_bench_pattern(src, size, 7);
+		k_printf("%s:", convert_isa_names[isa]);
+
+		for (i=0; i<sizeof(convert_bench_pairs) / sizeof(convert_bench_pairs[0]); i++) {
+			k_printf(" %s>%s %d", convert_format_names[convert_bench_pairs[i][1]], convert_format_names[convert_bench_pairs[i][0]],
+					convert_bench_rate(convert_bench_pairs[i][0], convert_bench_pairs[i][1], out, src));
+		}
+
+		k_printf(" Mpixels/s\n");
+	}
+
+finally:
+	convert_select(saved_isa);
+
+	if (src) kfree(src);
+	if (mid) kfree(mid);
+	if (out) kfree(out);
+
+	return hr;
+}
@@ -0,0 +1,50 @@
+/*
+ * nxgi_convert.h
+ *
+ *	Pixel format conversion.
+ *
+ *	Every pair of formats has a span converter. Swizzling, expanding to and
+ *	packing from BGRA32 are done directly, other pairs go through BGRA32 in
+ *	two steps. Expanding 5/6-bit channels replicates their high bits, so
+ *	0 and 31 map to 0 and 255. Packing rounds to nearest. Formats without
+ *	alpha expand as opaque.
+ *
+ *	SSE2 kernels do the swizzle and the 16-bit formats, SSSE3 kernels swizzle
+ *	and (un)pack 24-bit pixels with pshufb. Like the span kernels, they run
+ *	with interrupts disabled.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_CONVERT_H_
+#define SUBSYSTEMS_NXGI_CONVERT_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/**
+ * Picks the converters for the CPU.
+ */
+HRESULT		__nxapi nxgi_convert_initialize();
+
+/**
+ * Converts `count` pixels of `src_fmt` to `dst_fmt`. The spans must not
+ * overlap, unless the formats are the same.
+ */
+HRESULT		__nxapi nxgi_convert_span(void *dst, NXGI_FORMAT dst_fmt, const void *src, NXGI_FORMAT src_fmt, uint32_t count);
+
+/**
+ * Converts `height` rows of `width` pixels.
+ */
+HRESULT		__nxapi nxgi_convert_rect(void *dst, uint32_t dst_stride, NXGI_FORMAT dst_fmt,
+									const void *src, uint32_t src_stride, NXGI_FORMAT src_fmt,
+									uint32_t width, uint32_t height);
+
+/**
+ * Round-trips every 16-bit and 24-bit value, checks the vector kernels
+ * against the C ones and measures the throughput of conversion.
+ */
+HRESULT		__nxapi nxgi_convert_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_CONVERT_H_ */
@@ -0,0 +1,1072 @@
+/*
+ * nxgi_font.c
+ *
+ *	Bitmap fonts: PSF2 and BDF loading, glyph caches.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <mm.h>
+#include <string.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <kstdio.h>
+#include <syncobjs.h>
+#include "nxgi_font.h"
+#include "nxgi_span.h"
+
+/* PSF2 format */
+#define PSF2_MAGIC				0x864AB572
+#define PSF2_HAS_UNICODE_TABLE	0x01
+#define PSF2_SEPARATOR			0xFF
+#define PSF2_START_SEQUENCE		0xFE
+
+/* Longest BDF line we parse, the rest is ignored */
+#define BDF_MAX_LINE			256
+
+/* Bit `x` of a 1 bpp row, MSB first */
+#define FONT_BIT(row, x)		(((row)[(x) >> 3] >> (7 - ((x) & 7))) & 1)
+
+/**
+ * PSF2 file header.
+ */
+typedef struct PSF2_HEADER PSF2_HEADER;
+struct PSF2_HEADER {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	header_size;
+	uint32_t	flags;
+	uint32_t	length;
+	uint32_t	char_size;
+	uint32_t	height;
+	uint32_t	width;
+};
+
+/**
+ * Unscaled glyph bitmap of a face.
+ */
+typedef struct FONT_BITMAP FONT_BITMAP;
+struct FONT_BITMAP {
+	/** Position relative to the pen, at the top of the line */
+	int16_t		x, y;
+	uint16_t	width, height;
+	uint16_t	advance;
+
+	/** Bytes per row and position of the first row in the face's bits */
+	uint16_t	pitch;
+	uint32_t	offset;
+};
+
+/**
+ * Font face.
+ */
+typedef struct NXGI_FONT_FACE NXGI_FONT_FACE;
+struct NXGI_FONT_FACE {
+	char				name[64];
+
+	/** Line height, in pixels */
+	uint32_t			height;
+
+	FONT_BITMAP			glyphs[NXGI_FONT_CODES];
+	const uint8_t		*bits;
+
+	/** One cache per scale factor in use */
+	NXGI_GLYPH_CACHE	*caches;
+	NXGI_FONT_FACE		*next;
+};
+
+/*
+ * System VGA font (1 bit per pixel). It takes 1 kilobyte of
+ * memory.
+ */
+static const uint8_t __sys_font[128][8] = {
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x3E, 0x41, 0x55, 0x41, 0x55, 0x49, 0x3E },
+	  { 0x00, 0x3E, 0x7F, 0x6B, 0x7F, 0x6B, 0x77, 0x3E },
+	  { 0x00, 0x22, 0x77, 0x7F, 0x7F, 0x3E, 0x1C, 0x08 },
+	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x3E, 0x1C, 0x08 },
+	  { 0x00, 0x08, 0x1C, 0x2A, 0x7F, 0x2A, 0x08, 0x1C },
+	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x3E, 0x08, 0x1C },
+	  { 0x00, 0x00, 0x1C, 0x3E, 0x3E, 0x3E, 0x1C, 0x00 },
+	  { 0xFF, 0xFF, 0xE3, 0xC1, 0xC1, 0xC1, 0xE3, 0xFF },
+	  { 0x00, 0x00, 0x1C, 0x22, 0x22, 0x22, 0x1C, 0x00 },
+	  { 0xFF, 0xFF, 0xE3, 0xDD, 0xDD, 0xDD, 0xE3, 0xFF },
+	  { 0x00, 0x0F, 0x03, 0x05, 0x39, 0x48, 0x48, 0x30 },
+	  { 0x00, 0x08, 0x3E, 0x08, 0x1C, 0x22, 0x22, 0x1C },
+	  { 0x00, 0x18, 0x14, 0x10, 0x10, 0x30, 0x70, 0x60 },
+	  { 0x00, 0x0F, 0x19, 0x11, 0x13, 0x37, 0x76, 0x60 },
+	  { 0x00, 0x08, 0x2A, 0x1C, 0x77, 0x1C, 0x2A, 0x08 },
+	  { 0x00, 0x60, 0x78, 0x7E, 0x7F, 0x7E, 0x78, 0x60 },
+	  { 0x00, 0x03, 0x0F, 0x3F, 0x7F, 0x3F, 0x0F, 0x03 },
+	  { 0x00, 0x08, 0x1C, 0x2A, 0x08, 0x2A, 0x1C, 0x08 },
+	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x00, 0x66, 0x66 },
+	  { 0x00, 0x3F, 0x65, 0x65, 0x3D, 0x05, 0x05, 0x05 },
+	  { 0x00, 0x0C, 0x32, 0x48, 0x24, 0x12, 0x4C, 0x30 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x7F, 0x7F },
+	  { 0x00, 0x08, 0x1C, 0x2A, 0x08, 0x2A, 0x1C, 0x3E },
+	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x1C, 0x1C, 0x1C },
+	  { 0x00, 0x1C, 0x1C, 0x1C, 0x7F, 0x3E, 0x1C, 0x08 },
+	  { 0x00, 0x08, 0x0C, 0x7E, 0x7F, 0x7E, 0x0C, 0x08 },
+	  { 0x00, 0x08, 0x18, 0x3F, 0x7F, 0x3F, 0x18, 0x08 },
+	  { 0x00, 0x00, 0x00, 0x70, 0x70, 0x70, 0x7F, 0x7F },
+	  { 0x00, 0x00, 0x14, 0x22, 0x7F, 0x22, 0x14, 0x00 },
+	  { 0x00, 0x08, 0x1C, 0x1C, 0x3E, 0x3E, 0x7F, 0x7F },
+	  { 0x00, 0x7F, 0x7F, 0x3E, 0x3E, 0x1C, 0x1C, 0x08 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18 },
+	  { 0x00, 0x36, 0x36, 0x14, 0x00, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36 },
+	  { 0x00, 0x08, 0x1E, 0x20, 0x1C, 0x02, 0x3C, 0x08 },
+	  { 0x00, 0x60, 0x66, 0x0C, 0x18, 0x30, 0x66, 0x06 },
+	  { 0x00, 0x3C, 0x66, 0x3C, 0x28, 0x65, 0x66, 0x3F },
+	  { 0x00, 0x18, 0x18, 0x18, 0x30, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x60, 0x30, 0x18, 0x18, 0x18, 0x30, 0x60 },
+	  { 0x00, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06 },
+	  { 0x00, 0x00, 0x36, 0x1C, 0x7F, 0x1C, 0x36, 0x00 },
+	  { 0x00, 0x00, 0x08, 0x08, 0x3E, 0x08, 0x08, 0x00 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x30, 0x60 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x60 },
+	  { 0x00, 0x00, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x00 },
+	  { 0x00, 0x3C, 0x66, 0x6E, 0x76, 0x66, 0x66, 0x3C },
+	  { 0x00, 0x18, 0x18, 0x38, 0x18, 0x18, 0x18, 0x7E },
+	  { 0x00, 0x3C, 0x66, 0x06, 0x0C, 0x30, 0x60, 0x7E },
+	  { 0x00, 0x3C, 0x66, 0x06, 0x1C, 0x06, 0x66, 0x3C },
+	  { 0x00, 0x0C, 0x1C, 0x2C, 0x4C, 0x7E, 0x0C, 0x0C },
+	  { 0x00, 0x7E, 0x60, 0x7C, 0x06, 0x06, 0x66, 0x3C },
+	  { 0x00, 0x3C, 0x66, 0x60, 0x7C, 0x66, 0x66, 0x3C },
+	  { 0x00, 0x7E, 0x66, 0x0C, 0x0C, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x3C, 0x66, 0x66, 0x3C, 0x66, 0x66, 0x3C },
+	  { 0x00, 0x3C, 0x66, 0x66, 0x3E, 0x06, 0x66, 0x3C },
+	  { 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x00 },
+	  { 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x30 },
+	  { 0x00, 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06 },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x00 },
+	  { 0x00, 0x60, 0x30, 0x18, 0x0C, 0x18, 0x30, 0x60 },
+	  { 0x00, 0x3C, 0x66, 0x06, 0x1C, 0x18, 0x00, 0x18 },
+	  { 0x00, 0x38, 0x44, 0x5C, 0x58, 0x42, 0x3C, 0x00 },
+	  { 0x00, 0x3C, 0x66, 0x66, 0x7E, 0x66, 0x66, 0x66 },
+	  { 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x66, 0x66, 0x7C },
+	  { 0x00, 0x3C, 0x66, 0x60, 0x60, 0x60, 0x66, 0x3C },
+	  { 0x00, 0x7C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7C },
+	  { 0x00, 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x7E },
+	  { 0x00, 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x60 },
+	  { 0x00, 0x3C, 0x66, 0x60, 0x60, 0x6E, 0x66, 0x3C },
+	  { 0x00, 0x66, 0x66, 0x66, 0x7E, 0x66, 0x66, 0x66 },
+	  { 0x00, 0x3C, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C },
+	  { 0x00, 0x1E, 0x0C, 0x0C, 0x0C, 0x6C, 0x6C, 0x38 },
+	  { 0x00, 0x66, 0x6C, 0x78, 0x70, 0x78, 0x6C, 0x66 },
+	  { 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7E },
+	  { 0x00, 0x63, 0x77, 0x7F, 0x6B, 0x63, 0x63, 0x63 },
+	  { 0x00, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x63, 0x63 },
+	  { 0x00, 0x3C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C },
+	  { 0x00, 0x7C, 0x66, 0x66, 0x66, 0x7C, 0x60, 0x60 },
+	  { 0x00, 0x3C, 0x66, 0x66, 0x66, 0x6E, 0x3C, 0x06 },
+	  { 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x78, 0x6C, 0x66 },
+	  { 0x00, 0x3C, 0x66, 0x60, 0x3C, 0x06, 0x66, 0x3C },
+	  { 0x00, 0x7E, 0x5A, 0x18, 0x18, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3E },
+	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C, 0x18 },
+	  { 0x00, 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63 },
+	  { 0x00, 0x63, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x63 },
+	  { 0x00, 0x66, 0x66, 0x66, 0x3C, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x7E, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x7E },
+	  { 0x00, 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E },
+	  { 0x00, 0x00, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x00 },
+	  { 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x78 },
+	  { 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F },
+	  { 0x00, 0x0C, 0x0C, 0x06, 0x00, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x06, 0x3E, 0x66, 0x3E },
+	  { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x66, 0x7C },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x60, 0x66, 0x3C },
+	  { 0x00, 0x06, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3E },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x7E, 0x60, 0x3C },
+	  { 0x00, 0x1C, 0x36, 0x30, 0x30, 0x7C, 0x30, 0x30 },
+	  { 0x00, 0x00, 0x3E, 0x66, 0x66, 0x3E, 0x06, 0x3C },
+	  { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x66, 0x66 },
+	  { 0x00, 0x00, 0x18, 0x00, 0x18, 0x18, 0x18, 0x3C },
+	  { 0x00, 0x0C, 0x00, 0x0C, 0x0C, 0x6C, 0x6C, 0x38 },
+	  { 0x00, 0x60, 0x60, 0x66, 0x6C, 0x78, 0x6C, 0x66 },
+	  { 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x00, 0x00, 0x63, 0x77, 0x7F, 0x6B, 0x6B },
+	  { 0x00, 0x00, 0x00, 0x7C, 0x7E, 0x66, 0x66, 0x66 },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x66, 0x66, 0x3C },
+	  { 0x00, 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x60, 0x60 },
+	  { 0x00, 0x00, 0x3C, 0x6C, 0x6C, 0x3C, 0x0D, 0x0F },
+	  { 0x00, 0x00, 0x00, 0x7C, 0x66, 0x66, 0x60, 0x60 },
+	  { 0x00, 0x00, 0x00, 0x3E, 0x40, 0x3C, 0x02, 0x7C },
+	  { 0x00, 0x00, 0x18, 0x18, 0x7E, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x3E },
+	  { 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x3C, 0x18 },
+	  { 0x00, 0x00, 0x00, 0x63, 0x6B, 0x6B, 0x6B, 0x3E },
+	  { 0x00, 0x00, 0x00, 0x66, 0x3C, 0x18, 0x3C, 0x66 },
+	  { 0x00, 0x00, 0x00, 0x66, 0x66, 0x3E, 0x06, 0x3C },
+	  { 0x00, 0x00, 0x00, 0x3C, 0x0C, 0x18, 0x30, 0x3C },
+	  { 0x00, 0x0E, 0x18, 0x18, 0x30, 0x18, 0x18, 0x0E },
+	  { 0x00, 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18 },
+	  { 0x00, 0x70, 0x18, 0x18, 0x0C, 0x18, 0x18, 0x70 },
+	  { 0x00, 0x00, 0x00, 0x3A, 0x6C, 0x00, 0x00, 0x00 },
+	  { 0x00, 0x08, 0x1C, 0x36, 0x63, 0x41, 0x41, 0x7F }
+};
+
+/* Registered faces, the built-in one is added on first use */
+static NXGI_FONT_FACE	font_system;
+static NXGI_FONT_FACE	*font_faces = NULL;
+
+/* Protects the face list and glyph expansion */
+static K_MUTEX			font_lock;
+
+/* Shared by glyphs without ink */
+static NXGI_GLYPH		font_blank;
+
+/*
+ * Gives codes missing from the font the glyph of `default_code`, or a
+ * blank glyph `blank_advance` pixels wide if that's missing too.
+ */
+static void font_fill_missing(NXGI_FONT_FACE *f, const BOOL *present, int32_t default_code, uint32_t blank_advance)
+{
+	FONT_BITMAP	blank = {0, 0, 0, 0, blank_advance, 1, 0};
+	uint32_t	c;
+
+	if (default_code < 0 || default_code >= NXGI_FONT_CODES || !present[default_code]) {
+		default_code = present['?'] ? '?' : -1;
+	}
+
+	for (c=0; c<NXGI_FONT_CODES; c++) {
+		if (!present[c]) {
+			f->glyphs[c] = default_code >= 0 ? f->glyphs[default_code] : blank;
+		}
+	}
+}
+
+/*
+ * Adds the built-in face to the (empty) face list. Called with the lock
+ * held.
+ */
+static void font_add_system()
+{
+	NXGI_FONT_FACE	*f = &font_system;
+	BOOL			present[NXGI_FONT_CODES];
+	uint32_t		c;
+
+	strcpy(f->name, "System");
+	f->height = 8;
+	f->bits = &__sys_font[0][0];
+
+	for (c=0; c<NXGI_FONT_CODES; c++) {
+		present[c] = c < 128;
+		if (present[c]) f->glyphs[c] = (FONT_BITMAP){0, 0, 8, 8, 8, 1, c * 8};
+	}
+
+	font_fill_missing(f, present, '?', 8);
+	font_faces = f;
+}
+
+static NXGI_FONT_FACE *font_find(const char *name)
+{
+	NXGI_FONT_FACE *f;
+
+	if (font_faces == NULL) {
+		font_add_system();
+	}
+
+	for (f=font_faces; f!=NULL; f=f->next) {
+		if (strcmp(f->name, name) == 0) {
+			return f;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Decodes an UTF-8 sequence of the PSF2 Unicode table. Returns 0xFFFFFFFF
+ * for malformed ones.
+ */
+static uint32_t font_utf8_decode(const uint8_t **p, const uint8_t *end)
+{
+	uint32_t	cp = *(*p)++;
+	uint32_t	n;
+
+	if (cp < 0x80) return cp;
+	else if ((cp & 0xE0) == 0xC0) { cp &= 0x1F; n = 1; }
+	else if ((cp & 0xF0) == 0xE0) { cp &= 0x0F; n = 2; }
+	else if ((cp & 0xF8) == 0xF0) { cp &= 0x07; n = 3; }
+	else return 0xFFFFFFFF;
+
+	while (n-- > 0) {
+		if (*p >= end || (**p & 0xC0) != 0x80) {
+			return 0xFFFFFFFF;
+		}
+
+		cp = (cp << 6) | (*(*p)++ & 0x3F);
+	}
+
+	return cp;
+}
+
+static HRESULT font_load_psf2(NXGI_FONT_FACE *f, const uint8_t *data, uint32_t size, BOOL *present)
+{
+	const PSF2_HEADER	*h = (const PSF2_HEADER*)data;
+	const uint8_t		*p, *end = data + size;
+	uint8_t				*bits;
+	uint32_t			pitch, g, c;
+	BOOL				sequence;
+
+	if (size < sizeof(PSF2_HEADER) || h->magic != PSF2_MAGIC) {
+		return E_INVALIDDATA;
+	}
+
+	pitch = (h->width + 7) / 8;
+
+	if (h->header_size < sizeof(PSF2_HEADER) || h->header_size > size ||
+		h->width == 0 || h->width > NXGI_FONT_MAX_GLYPH || h->height == 0 || h->height > NXGI_FONT_MAX_GLYPH ||
+		h->length == 0 || h->char_size < pitch * h->height || h->length > (size - h->header_size) / h->char_size) {
+		return E_INVALIDDATA;
+	}
+
+	if (!(bits = kmalloc(h->length * h->char_size))) {
+		return E_OUTOFMEM;
+	}
+
+	memcpy(bits, data + h->header_size, h->length * h->char_size);
+	f->bits = bits;
+	f->height = h->height;
+
+	if (h->flags & PSF2_HAS_UNICODE_TABLE) {
+		/* Code points of each glyph, ending with 0xFF. Sequences (0xFE) are skipped */
+		p = data + h->header_size + h->length * h->char_size;
+
+		for (g=0; g<h->length && p<end; g++) {
+			sequence = FALSE;
+
+			while (p < end && *p != PSF2_SEPARATOR) {
+				if (*p == PSF2_START_SEQUENCE) {
+					sequence = TRUE;
+					p++;
+					continue;
+				}
+
+				c = font_utf8_decode(&p, end);
+
+				if (!sequence && c < NXGI_FONT_CODES && !present[c]) {
+					f->glyphs[c] = (FONT_BITMAP){0, 0, h->width, h->height, h->width, pitch, g * h->char_size};
+					present[c] = TRUE;
+				}
+			}
+
+			p++;
+		}
+	} else {
+		for (c=0; c<h->length && c<NXGI_FONT_CODES; c++) {
+			f->glyphs[c] = (FONT_BITMAP){0, 0, h->width, h->height, h->width, pitch, c * h->char_size};
+			present[c] = TRUE;
+		}
+	}
+
+	font_fill_missing(f, present, '?', h->width);
+	return S_OK;
+}
+
+/*
+ * Copies the next line to `line`, returns FALSE at the end of the data.
+ */
+static BOOL bdf_read_line(const char **p, const char *end, char *line)
+{
+	uint32_t n = 0;
+
+	if (*p >= end) {
+		return FALSE;
+	}
+
+	while (*p < end && **p != '\n') {
+		if (**p != '\r' && n < BDF_MAX_LINE - 1) {
+			line[n++] = **p;
+		}
+
+		(*p)++;
+	}
+
+	if (*p < end) (*p)++;
+
+	line[n] = '\0';
+	return TRUE;
+}
+
+/*
+ * Tests if `line` starts with keyword `kw`, returns the arguments after it.
+ */
+static BOOL bdf_keyword(const char *line, const char *kw, const char **args)
+{
+	while (*kw) {
+		if (*line++ != *kw++) return FALSE;
+	}
+
+	if (*line != '\0' && !isspace(*line)) {
+		return FALSE;
+	}
+
+	*args = line;
+	return TRUE;
+}
+
+/*
+ * Parses up to `count` decimal integers, returns how many there were.
+ */
+static uint32_t bdf_ints(const char *s, int32_t *out, uint32_t count)
+{
+	uint32_t	n;
+	BOOL		negative;
+
+	for (n=0; n<count; n++) {
+		while (isspace(*s)) s++;
+
+		negative = *s == '-';
+		if (*s == '-' || *s == '+') s++;
+
+		if (*s < '0' || *s > '9') break;
+
+		for (out[n] = 0; *s >= '0' && *s <= '9'; s++) {
+			out[n] = out[n] * 10 + (*s - '0');
+		}
+
+		if (negative) out[n] = -out[n];
+	}
+
+	return n;
+}
+
+static uint8_t bdf_hex(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+
+	return 0;
+}
+
+static HRESULT font_load_bdf(NXGI_FONT_FACE *f, const char *data, uint32_t size, BOOL *present)
+{
+	const char	*p = data, *end = data + size, *args;
+	char		line[BDF_MAX_LINE];
+	uint8_t		*bits;
+	int32_t		fbb[4] = {8, 8, 0, 0}, bbx[4], v[2];
+	int32_t		ascent = -1, descent = -1, default_code = -1, code = -1, dwidth = 0, row = -1;
+	uint32_t	used = 0, pitch = 0, i, n, c;
+	BOOL		found = FALSE;
+
+	if (!bdf_read_line(&p, end, line) || !bdf_keyword(line, "STARTFONT", &args)) {
+		return E_INVALIDDATA;
+	}
+
+	/* Every bitmap byte takes two hex digits */
+	if (!(bits = kmalloc(size / 2 + 1))) {
+		return E_OUTOFMEM;
+	}
+
+	memcpy(bbx, fbb, sizeof(bbx));
+
+	while (bdf_read_line(&p, end, line)) {
+		if (row >= 0) {
+			/* Bitmap rows, until ENDCHAR */
+			if (!bdf_keyword(line, "ENDCHAR", &args)) {
+				if (row < bbx[1]) {
+					n = strlen(line);
+
+					for (i=0; i<pitch; i++) {
+						bits[used + row * pitch + i] =
+								(2*i < n ? bdf_hex(line[2*i]) << 4 : 0) | (2*i+1 < n ? bdf_hex(line[2*i+1]) : 0);
+					}
+				}
+
+				row++;
+				continue;
+			}
+
+			/* The glyph's top is relative to the baseline until the ascent is known */
+			f->glyphs[code] = (FONT_BITMAP){bbx[2], -(bbx[1] + bbx[3]), bbx[0], bbx[1], dwidth, pitch, used};
+			present[code] = TRUE;
+			found = TRUE;
+
+			used += pitch * bbx[1];
+			row = -1;
+		} else if (bdf_keyword(line, "FONTBOUNDINGBOX", &args)) {
+			if (bdf_ints(args, fbb, 4) != 4) break;
+		} else if (bdf_keyword(line, "FONT_ASCENT", &args)) {
+			bdf_ints(args, &ascent, 1);
+		} else if (bdf_keyword(line, "FONT_DESCENT", &args)) {
+			bdf_ints(args, &descent, 1);
+		} else if (bdf_keyword(line, "DEFAULT_CHAR", &args)) {
+			bdf_ints(args, &default_code, 1);
+		} else if (bdf_keyword(line, "STARTCHAR", &args)) {
+			code = -1;
+			dwidth = fbb[0];
+			memcpy(bbx, fbb, sizeof(bbx));
+		} else if (bdf_keyword(line, "ENCODING", &args)) {
+			bdf_ints(args, &code, 1);
+		} else if (bdf_keyword(line, "DWIDTH", &args)) {
+			if (bdf_ints(args, v, 2) >= 1) dwidth = v[0];
+		} else if (bdf_keyword(line, "BBX", &args)) {
+			if (bdf_ints(args, bbx, 4) != 4) break;
+		} else if (bdf_keyword(line, "BITMAP", &args)) {
+			/* Skip codes we don't have room for */
+			if (code < 0 || code >= NXGI_FONT_CODES || present[code]) continue;
+
+			if (bbx[0] < 0 || bbx[0] > NXGI_FONT_MAX_GLYPH || bbx[1] < 0 || bbx[1] > NXGI_FONT_MAX_GLYPH ||
+				bbx[2] < -NXGI_FONT_MAX_GLYPH || bbx[2] > NXGI_FONT_MAX_GLYPH ||
+				bbx[3] < -NXGI_FONT_MAX_GLYPH || bbx[3] > NXGI_FONT_MAX_GLYPH ||
+				dwidth < 0 || dwidth > NXGI_FONT_MAX_GLYPH * 2) {
+				continue;
+			}
+
+			pitch = (bbx[0] + 7) / 8;
+			if (used + pitch * bbx[1] > size / 2) break;
+
+			memset(bits + used, 0, pitch * bbx[1]);
+			row = 0;
+		}
+	}
+
+	if (!found) {
+		kfree(bits);
+		return E_INVALIDDATA;
+	}
+
+	/* Without the properties, the font's bounding box gives the line */
+	if (ascent < 0 || descent < 0) {
+		ascent = fbb[1] + fbb[3];
+		descent = -fbb[3];
+	}
+
+	if (ascent + descent <= 0 || ascent + descent > NXGI_FONT_MAX_GLYPH * 2) {
+		kfree(bits);
+		return E_INVALIDDATA;
+	}
+
+	for (c=0; c<NXGI_FONT_CODES; c++) {
+		if (present[c]) f->glyphs[c].y += ascent;
+	}
+
+	f->bits = bits;
+	f->height = ascent + descent;
+
+	font_fill_missing(f, present, default_code, fbb[0]);
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_font_load_memory(const void *data, uint32_t size, char *name)
+{
+	NXGI_FONT_FACE	*f;
+	BOOL			present[NXGI_FONT_CODES];
+	HRESULT			hr;
+
+	if (data == NULL || name == NULL || strlen(name) >= sizeof(f->name)) {
+		return E_INVALIDARG;
+	}
+
+	if (!(f = kcalloc(sizeof(NXGI_FONT_FACE)))) {
+		return E_OUTOFMEM;
+	}
+
+	memset(present, 0, sizeof(present));
+	strcpy(f->name, name);
+
+	if (size >= 4 && *(const uint32_t*)data == PSF2_MAGIC) {
+		hr = font_load_psf2(f, data, size, present);
+	} else {
+		hr = font_load_bdf(f, data, size, present);
+	}
+
+	if (FAILED(hr)) {
+		kfree(f);
+		return hr;
+	}
+
+	mutex_lock(&font_lock);
+
+	if (font_find(name) != NULL) {
+		/* Name is taken */
+		mutex_unlock(&font_lock);
+
+		kfree((void*)f->bits);
+		kfree(f);
+		return E_INVALIDARG;
+	}
+
+	f->next = font_faces;
+	font_faces = f;
+
+	mutex_unlock(&font_lock);
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_font_load(char *path, char *name)
+{
+	K_STREAM	*s;
+	uint32_t	size;
+	size_t		bytes;
+	void		*data;
+	HRESULT		hr;
+
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(hr)) return hr;
+
+	k_fseek(s, 0, KSTREAM_ORIGIN_END);
+	size = k_ftell(s);
+	k_fseek(s, 0, KSTREAM_ORIGIN_BEGINNING);
+
+	if (!(data = kmalloc(size))) {
+		k_fclose(&s);
+		return E_OUTOFMEM;
+	}
+
+	hr = k_fread(s, size, data, &bytes);
+	if (SUCCEEDED(hr)) {
+		hr = bytes == size ? nxgi_font_load_memory(data, size, name) : E_FAIL;
+	}
+
+	kfree(data);
+	k_fclose(&s);
+
+	return hr;
+}
+
+HRESULT __nxapi nxgi_font_get_cache(const char *name, uint32_t scale, NXGI_GLYPH_CACHE **cache_out)
+{
+	NXGI_FONT_FACE		*f;
+	NXGI_GLYPH_CACHE	*cache;
+	uint32_t			c;
+
+	if (scale == 0 || scale > NXGI_FONT_MAX_SCALE) {
+		return E_INVALIDARG;
+	}
+
+	mutex_lock(&font_lock);
+
+	if (!(f = font_find(name))) {
+		mutex_unlock(&font_lock);
+		return E_NOTFOUND;
+	}
+
+	for (cache=f->caches; cache!=NULL; cache=cache->next) {
+		if (cache->scale == scale) {
+			goto done;
+		}
+	}
+
+	if (!(cache = kcalloc(sizeof(NXGI_GLYPH_CACHE)))) {
+		mutex_unlock(&font_lock);
+		return E_OUTOFMEM;
+	}
+
+	cache->scale = scale;
+	cache->height = f->height * scale;
+	cache->face = f;
+
+	for (c=0; c<NXGI_FONT_CODES; c++) {
+		cache->advance[c] = f->glyphs[c].advance * scale;
+	}
+
+	cache->next = f->caches;
+	f->caches = cache;
+
+done:
+	mutex_unlock(&font_lock);
+
+	*cache_out = cache;
+	return S_OK;
+}
+
+/*
+ * Expands a glyph bitmap to a coverage mask `scale` times it's size,
+ * trimmed to the ink.
+ */
+static NXGI_GLYPH *font_expand_glyph(NXGI_FONT_FACE *f, FONT_BITMAP *b, uint32_t scale)
+{
+	const uint8_t	*bits = f->bits + b->offset, *src;
+	int32_t			x0 = b->width, x1 = -1, y0 = b->height, y1 = -1, x, y;
+	uint32_t		w, i, k;
+	uint8_t			*row, v;
+	NXGI_GLYPH		*g;
+
+	/* Find the ink */
+	for (y=0; y<b->height; y++) {
+		for (x=0; x<b->width; x++) {
+			if (FONT_BIT(bits + y * b->pitch, x)) {
+				if (x < x0) x0 = x;
+				if (x > x1) x1 = x;
+				if (y < y0) y0 = y;
+				y1 = y;
+			}
+		}
+	}
+
+	if (x1 < 0) {
+		return &font_blank;
+	}
+
+	w = (x1 - x0 + 1) * scale;
+
+	if (!(g = kmalloc(sizeof(NXGI_GLYPH) + w * (y1 - y0 + 1) * scale))) {
+		return NULL;
+	}
+
+	g->x = (b->x + x0) * scale;
+	g->y = (b->y + y0) * scale;
+	g->width = w;
+	g->height = (y1 - y0 + 1) * scale;
+
+	/* Each bit becomes a `scale` x `scale` square */
+	for (y=y0, row=g->mask; y<=y1; y++, row+=w*scale) {
+		src = bits + y * b->pitch;
+
+		for (x=x0, i=0; x<=x1; x++) {
+			v = FONT_BIT(src, x) ? 255 : 0;
+			for (k=0; k<scale; k++) row[i++] = v;
+		}
+
+		for (k=1; k<scale; k++) {
+			memcpy(row + k * w, row, w);
+		}
+	}
+
+	return g;
+}
+
+NXGI_GLYPH* __nxapi nxgi_font_get_glyph(NXGI_GLYPH_CACHE *cache, uint8_t code)
+{
+	NXGI_GLYPH *g = cache->glyphs[code];
+
+	if (g != NULL) {
+		return g;
+	}
+
+	mutex_lock(&font_lock);
+
+	if (!(g = cache->glyphs[code])) {
+		g = font_expand_glyph(cache->face, &cache->face->glyphs[code], cache->scale);
+		cache->glyphs[code] = g;
+	}
+
+	mutex_unlock(&font_lock);
+	return g;
+}
+
+/*
+ * Benchmark
+ */
+
+#define FONT_BENCH_TIME		1000
+#define FONT_BENCH_WIDTH	640
+#define FONT_BENCH_HEIGHT	480
+
+static const char font_bench_text[] = "The quick brown fox jumps over the lazy dog. 0123456789 {|}~";
+
+/*
+ * Builds a PSF2 copy of the system font. Its Unicode table also maps
+ * U+00C4 to 'A' and has a sequence for 'B', which must be ignored.
+ */
+static uint8_t *font_bench_psf2(uint32_t *size_out)
+{
+	PSF2_HEADER	h = {PSF2_MAGIC, 0, sizeof(PSF2_HEADER), PSF2_HAS_UNICODE_TABLE, 128, 8, 8, 8};
+	uint8_t		*data, *p;
+	uint32_t	c;
+
+	if (!(data = kmalloc(sizeof(h) + sizeof(__sys_font) + 128 * 2 + 8))) {
+		return NULL;
+	}
+
+	memcpy(data, &h, sizeof(h));
+	memcpy(data + sizeof(h), __sys_font, sizeof(__sys_font));
+	p = data + sizeof(h) + sizeof(__sys_font);
+
+	for (c=0; c<128; c++) {
+		*p++ = c;
+
+		if (c == 'A') {
+			*p++ = 0xC3;
+			*p++ = 0x84;
+		} else if (c == 'B') {
+			*p++ = PSF2_START_SEQUENCE;
+			*p++ = 0xC3;
+			*p++ = 0x85;
+		}
+
+		*p++ = PSF2_SEPARATOR;
+	}
+
+	*size_out = p - data;
+	return data;
+}
+
+/*
+ * Writes the system font as BDF, each glyph's bounding box trimmed to
+ * it's ink.
+ */
+static char *font_bench_bdf(uint32_t *size_out)
+{
+	char		*data, *p;
+	int32_t		x0, x1, y0, y1, x, y;
+	uint32_t	c;
+
+	if (!(data = kmalloc(128 * 256 + 256))) {
+		return NULL;
+	}
+
+	p = data;
+	p += sprintf(p, "STARTFONT 2.1\nFONTBOUNDINGBOX 8 8 0 -1\nSTARTPROPERTIES 2\nFONT_ASCENT 7\nFONT_DESCENT 1\nENDPROPERTIES\nCHARS 128\n");
+
+	for (c=0; c<128; c++) {
+		x0 = 8; x1 = -1; y0 = 8; y1 = -1;
+
+		for (y=0; y<8; y++) {
+			for (x=0; x<8; x++) {
+				if (FONT_BIT(&__sys_font[c][y], x)) {
+					if (x < x0) x0 = x;
+					if (x > x1) x1 = x;
+					if (y < y0) y0 = y;
+					y1 = y;
+				}
+			}
+		}
+
+		if (x1 < 0) {
+			x0 = x1 = y0 = y1 = 0;
+		}
+
+		p += sprintf(p, "STARTCHAR c%d\r\nENCODING %d\r\nDWIDTH 8 0\r\nBBX %d %d %d %d\r\nBITMAP\r\n",
+				c, c, x1 - x0 + 1, y1 - y0 + 1, x0, 6 - y1);
+
+		for (y=y0; y<=y1; y++) {
+			p += sprintf(p, "%02X\r\n", (uint8_t)(__sys_font[c][y] << x0));
+		}
+
+		p += sprintf(p, "ENDCHAR\r\n");
+	}
+
+	p += sprintf(p, "ENDFONT\n");
+
+	*size_out = p - data;
+	return data;
+}
+
+/*
+ * Compares every glyph of face `name` against the system font's. `psf2`
+ * tells whether the face is the one with the Unicode table.
+ */
+static HRESULT font_bench_compare(char *name, uint32_t scale, BOOL psf2)
+{
+	NXGI_GLYPH_CACHE	*sys, *cache;
+	NXGI_GLYPH			*a, *b;
+	uint32_t			c, code;
+	HRESULT				hr;
+
+	hr = nxgi_font_get_cache("System", scale, &sys);
+	if (FAILED(hr)) return hr;
+
+	hr = nxgi_font_get_cache(name, scale, &cache);
+	if (FAILED(hr)) return hr;
+
+	for (c=0; c<NXGI_FONT_CODES; c++) {
+		/* The PSF2 table maps U+00C4 to 'A' */
+		code = psf2 && c == 0xC4 ? 'A' : (c < 128 ? c : '?');
+
+		a = nxgi_font_get_glyph(sys, code);
+		b = nxgi_font_get_glyph(cache, c);
+
+		if (!a || !b) return E_OUTOFMEM;
+
+		if (a->x != b->x || a->y != b->y || a->width != b->width || a->height != b->height ||
+			memcmp(a->mask, b->mask, a->width * a->height) != 0 || sys->advance[code] != cache->advance[c]) {
+			k_printf("%s: glyph %d at scale %d differs\n", name, c, scale);
+			return E_FAIL;
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Draws text the slow way, testing every bit of the system font.
+ */
+static void font_bench_reference(NXGI_BITMAP *bmp, NXGI_POINT pos, NXGI_RECT clip, uint32_t scale, const char *text, uint32_t color)
+{
+	uint32_t	*pix;
+	int32_t		x, y, px, py;
+
+	for (; *text; text++, pos.x+=8*scale) {
+		if (*text < 0) continue;
+
+		for (y=0; y<8*(int32_t)scale; y++) {
+			for (x=0; x<8*(int32_t)scale; x++) {
+				px = pos.x + x;
+				py = pos.y + y;
+
+				if (px < clip.x1 || px >= clip.x2 || py < clip.y1 || py >= clip.y2) continue;
+				if (!FONT_BIT(&__sys_font[(uint8_t)*text][y / scale], x / scale)) continue;
+
+				pix = (uint32_t*)((uint8_t*)bmp->pBits + py * bmp->stride) + px;
+				*pix = color;
+			}
+		}
+	}
+}
+
+/*
+ * Draws clipped text with a graphics context and compares it with the
+ * reference renderer.
+ */
+static HRESULT font_bench_golden(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *out, NXGI_BITMAP *ref)
+{
+	static const struct {
+		NXGI_RECT	clip;
+		NXGI_POINT	pos;
+		uint32_t	scale;
+	} cases[] = {
+		{ { .x1 = 0,  .y1 = 0,  .x2 = 200, .y2 = 64 },	{ .x = 0,    .y = 0 },	1 },
+		{ { .x1 = 13, .y1 = 5,  .x2 = 131, .y2 = 29 },	{ .x = -5,   .y = 3 },	2 },
+		{ { .x1 = 7,  .y1 = 9,  .x2 = 8,   .y2 = 40 },	{ .x = 1,    .y = 2 },	3 },
+		{ { .x1 = 40, .y1 = 0,  .x2 = 200, .y2 = 11 },	{ .x = -100, .y = -6 },	3 },
+		{ { .x1 = 0,  .y1 = 20, .x2 = 200, .y2 = 21 },	{ .x = 150,  .y = 13 },	1 },
+	};
+	NXGI_COLOR	text_color = COLOR(0xE0, 0xC0, 0x40, 0xFF);
+	NXGI_POINT	offset = POINT(3, 2);
+	uint32_t	i;
+	NXGI_RECT	clip;
+	HRESULT		hr;
+
+	for (i=0; i<sizeof(cases)/sizeof(cases[0]); i++) {
+		memset(out->pBits, 0x20, out->stride * out->height);
+		memset(ref->pBits, 0x20, ref->stride * ref->height);
+
+		hr = nxgi_set_font(gc, FONT_PARAMS("System", cases[i].scale, 0, text_color));
+		if (FAILED(hr)) return hr;
+
+		nxgi_set_offset(gc, offset);
+		nxgi_set_clip_rect(gc, cases[i].clip);
+		nxgi_get_clip_rect(gc, &clip);
+
+		hr = nxgi_draw_text(gc, cases[i].pos, (char*)font_bench_text);
+		if (FAILED(hr)) return hr;
+
+		font_bench_reference(ref, POINT(cases[i].pos.x + offset.x, cases[i].pos.y + offset.y), clip, cases[i].scale, font_bench_text, nxgi_span_color(text_color));
+
+		if (memcmp(out->pBits, ref->pBits, out->stride * out->height) != 0) {
+			k_printf("clipped text case %d differs from the reference\n", i);
+			return E_FAIL;
+		}
+	}
+
+	return S_OK;
+}
+
+static uint32_t font_bench_rate(NXGI_GRAPHICS_CONTEXT *gc, uint32_t scale)
+{
+	char		line[sizeof(font_bench_text)];
+	uint32_t	start, elapsed, len = strlen(font_bench_text);
+	uint64_t	glyphs = 0;
+	int32_t		y = 0;
+
+	/* Only as much as fits in a line */
+	if (len > FONT_BENCH_WIDTH / (8 * scale)) {
+		len = FONT_BENCH_WIDTH / (8 * scale);
+	}
+
+	memcpy(line, font_bench_text, len);
+	line[len] = '\0';
+
+	nxgi_set_font(gc, FONT_PARAMS("System", scale, 0, COLOR(255, 255, 255, 255)));
+	nxgi_set_offset(gc, POINT(0, 0));
+	nxgi_set_clip_rect(gc, RECT(0, 0, FONT_BENCH_WIDTH, FONT_BENCH_HEIGHT));
+
+	start = timer_gettickcount();
+
+	do {
+		nxgi_draw_text(gc, POINT(0, y), line);
+
+		y = (y + 8 * scale) % (FONT_BENCH_HEIGHT - 8 * scale);
+		glyphs += len;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < FONT_BENCH_TIME);
+
+	return (uint32_t)udiv64(glyphs * 1000, elapsed, NULL);
+}
+
+HRESULT __nxapi nxgi_font_benchmark()
+{
+	NXGI_GRAPHICS_CONTEXT	*gc = NULL;
+	NXGI_BITMAP				*out = NULL, *ref = NULL, *big = NULL;
+	uint8_t					*psf2 = NULL;
+	char					*bdf = NULL;
+	uint32_t				size, scale;
+	HRESULT					hr;
+
+	nxgi_span_initialize();
+
+	/* Loaders */
+	if (!(psf2 = font_bench_psf2(&size))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	hr = nxgi_font_load_memory(psf2, size, "bench-psf2");
+	if (FAILED(hr) && hr != E_INVALIDARG) goto finally;
+
+	if (!(bdf = font_bench_bdf(&size))) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	hr = nxgi_font_load_memory(bdf, size, "bench-bdf");
+	if (FAILED(hr) && hr != E_INVALIDARG) goto finally;
+
+	for (scale=1; scale<=3; scale++) {
+		hr = font_bench_compare("bench-psf2", scale, TRUE);
+		if (FAILED(hr)) goto finally;
+
+		hr = font_bench_compare("bench-bdf", scale, FALSE);
+		if (FAILED(hr)) goto finally;
+	}
+
+	k_printf("PSF2 and BDF glyphs match the system font\n");
+
+	/* Clipped text */
+	hr = nxgi_create_bitmap(200, 64, NXGI_FORMAT_BGRA32, &out);
+	if (FAILED(hr)) goto finally;
+
+	hr = nxgi_create_bitmap(200, 64, NXGI_FORMAT_BGRA32, &ref);
+	if (FAILED(hr)) goto finally;
+
+	hr = nxgi_create_graphics_context(&gc);
+	if (FAILED(hr)) goto finally;
+
+	hr = nxgi_set_target(gc, out);
+	if (FAILED(hr)) goto finally;
+
+	hr = font_bench_golden(gc, out, ref);
+	if (FAILED(hr)) goto finally;
+
+	k_printf("clipped text matches the reference\n");
+
+	/* Throughput */
+	hr = nxgi_create_bitmap(FONT_BENCH_WIDTH, FONT_BENCH_HEIGHT, NXGI_FORMAT_BGRA32, &big);
+	if (FAILED(hr)) goto finally;
+
+	hr = nxgi_set_target(gc, big);
+	if (FAILED(hr)) goto finally;
+
+	for (scale=1; scale<=3; scale++) {
+		k_printf("scale %d: %d glyphs/s\n", scale, font_bench_rate(gc, scale));
+	}
+
+finally:
+	if (gc) nxgi_destroy_graphics_context(gc);
+	if (out) nxgi_destroy_bitmap(&out);
+	if (ref) nxgi_destroy_bitmap(&ref);
+	if (big) nxgi_destroy_bitmap(&big);
+	if (psf2) kfree(psf2);
+	if (bdf) kfree(bdf);
+
+	return hr;
+}
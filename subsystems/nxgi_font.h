@@ -0,0 +1,100 @@
+/*
+ * nxgi_font.h
+ *
+ *	Bitmap fonts.
+ *
+ *	Font faces are loaded from PSF2 or BDF files and registered under a
+ *	name. The 8x8 "System" face is built in. A face covers the character
+ *	codes 0..255, which are Latin-1 for BDF fonts and PSF2 fonts with a
+ *	Unicode table. Codes missing from the font are drawn as it's default
+ *	character. Glyph bitmaps are kept at 1 bit per pixel.
+ *
+ *	Faces are drawn at integer scale factors. For every scale in use a face
+ *	has a glyph cache, holding the advance of each code and 8-bit coverage
+ *	masks, which are trimmed to the glyph's ink and expanded the first time
+ *	the glyph is drawn. Text is drawn by blending the font color through the
+ *	masks (nxgi_span_mask()).
+ *
+ *	Faces and their caches stay in memory once loaded.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_FONT_H_
+#define SUBSYSTEMS_NXGI_FONT_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/* Number of character codes in a face */
+#define NXGI_FONT_CODES			256
+
+/* Largest scale factor */
+#define NXGI_FONT_MAX_SCALE		8
+
+/* Largest glyph bitmap, in pixels, before scaling */
+#define NXGI_FONT_MAX_GLYPH		64
+
+/**
+ * Scaled glyph.
+ */
+typedef struct NXGI_GLYPH NXGI_GLYPH;
+struct NXGI_GLYPH {
+	/** Position of the mask relative to the pen, which is at the top of the line */
+	int32_t		x, y;
+
+	/** Mask size. Both are 0 for glyphs without ink, e.g. space */
+	uint32_t	width, height;
+
+	/** Coverage, `width` bytes per row */
+	uint8_t		mask[];
+};
+
+/**
+ * Glyphs of a face at a scale factor. Typedef'd in nxgi.h.
+ */
+struct NXGI_GLYPH_CACHE {
+	/** Scale factor and line height, in pixels */
+	uint32_t			scale;
+	uint32_t			height;
+
+	/** Horizontal advance of each code, in pixels */
+	uint16_t			advance[NXGI_FONT_CODES];
+
+	/** Glyphs expanded so far, NULL when not yet */
+	NXGI_GLYPH			*glyphs[NXGI_FONT_CODES];
+
+	struct NXGI_FONT_FACE	*face;
+	NXGI_GLYPH_CACHE	*next;
+};
+
+/**
+ * Loads a PSF2 or BDF font file and registers it as `name`. Fails with
+ * E_INVALIDARG if the name is taken.
+ */
+HRESULT		__nxapi nxgi_font_load(char *path, char *name);
+
+/**
+ * Same as nxgi_font_load(), but parses a font already in memory.
+ */
+HRESULT		__nxapi nxgi_font_load_memory(const void *data, uint32_t size, char *name);
+
+/**
+ * Finds the glyph cache of face `name` at `scale`, creating it if needed.
+ */
+HRESULT		__nxapi nxgi_font_get_cache(const char *name, uint32_t scale, NXGI_GLYPH_CACHE **cache_out);
+
+/**
+ * Returns the scaled glyph of `code`, expanding it on first use. Returns
+ * NULL if it can't be allocated.
+ */
+NXGI_GLYPH*	__nxapi nxgi_font_get_glyph(NXGI_GLYPH_CACHE *cache, uint8_t code);
+
+/**
+ * Checks PSF2 and BDF loading and clipped text against a per-pixel
+ * reference renderer, and measures glyphs drawn per second.
+ */
+HRESULT		__nxapi nxgi_font_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_FONT_H_ */
@@ -4,6 +4,10 @@
  *  Created on: 7.10.2016 .
  *      Author: Anton Angelov
  */
+#include <mm.h>
+#include <string.h>
+#include <timer.h>
+#include <kstdio.h>
 #include "nxgi_geometry.h"
 
 NXGI_POINT nxgig_clip_point(NXGI_POINT p, NXGI_RECT r)
@@ -84,6 +88,707 @@ NXGI_RECT nxgig_rect_offset(NXGI_RECT r, NXGI_POINT vector)
 	return r;
 }
 
+NXGI_RECT nxgig_rect_intersection(NXGI_RECT r1, NXGI_RECT r2)
+{
+	NXGI_RECT result;
+
+	result.x1 = r1.x1 > r2.x1 ? r1.x1 : r2.x1;
+	result.y1 = r1.y1 > r2.y1 ? r1.y1 : r2.y1;
+	result.x2 = r1.x2 < r2.x2 ? r1.x2 : r2.x2;
+	result.y2 = r1.y2 < r2.y2 ? r1.y2 : r2.y2;
+
+	return result;
+}
+
+BOOL nxgig_rect_empty(NXGI_RECT r)
+{
+	return r.x1 >= r.x2 || r.y1 >= r.y2;
+}
+
+uint32_t nxgig_rect_subtract(NXGI_RECT r, NXGI_RECT cut, NXGI_RECT out[4])
+{
+	NXGI_RECT	c = nxgig_rect_intersection(r, cut);
+	uint32_t	n = 0;
+
+	if (nxgig_rect_empty(c)) {
+		out[0] = r;
+		return nxgig_rect_empty(r) ? 0 : 1;
+	}
+
+	if (r.y1 < c.y1) out[n++] = RECT(r.x1, r.y1, r.x2, c.y1);
+	if (c.y2 < r.y2) out[n++] = RECT(r.x1, c.y2, r.x2, r.y2);
+	if (r.x1 < c.x1) out[n++] = RECT(r.x1, c.y1, c.x1, c.y2);
+	if (c.x2 < r.x2) out[n++] = RECT(c.x2, c.y1, r.x2, c.y2);
+
+	return n;
+}
+
+/*
+ * Regions
+ */
+
+/* Rectangles allocated for a region's first band */
+#define REGION_INITIAL_RECTS	8
+
+typedef enum {
+	REGION_OP_UNION,
+	REGION_OP_INTERSECT,
+	REGION_OP_SUBTRACT
+} REGION_OP;
+
+static HRESULT region_reserve(NXGI_REGION *rgn, uint32_t count)
+{
+	NXGI_RECT	*rects;
+	uint32_t	capacity;
+
+	if (count <= rgn->capacity) {
+		return S_OK;
+	}
+
+	capacity = rgn->capacity ? rgn->capacity : REGION_INITIAL_RECTS;
+	while (capacity < count) {
+		capacity *= 2;
+	}
+
+	rects = krealloc(rgn->rects, capacity * sizeof(NXGI_RECT));
+	if (rects == NULL) {
+		return E_OUTOFMEM;
+	}
+
+	rgn->rects = rects;
+	rgn->capacity = capacity;
+
+	return S_OK;
+}
+
+static void region_update_bounds(NXGI_REGION *rgn)
+{
+	uint32_t i;
+
+	if (rgn->count == 0) {
+		rgn->bounds = RECT(0, 0, 0, 0);
+		return;
+	}
+
+	rgn->bounds = RECT(rgn->rects[0].x1, rgn->rects[0].y1, rgn->rects[0].x2, rgn->rects[rgn->count - 1].y2);
+
+	for (i=1; i<rgn->count; i++) {
+		if (rgn->rects[i].x1 < rgn->bounds.x1) rgn->bounds.x1 = rgn->rects[i].x1;
+		if (rgn->rects[i].x2 > rgn->bounds.x2) rgn->bounds.x2 = rgn->rects[i].x2;
+	}
+}
+
+/* Index past the last rectangle of the band starting at `i` */
+static uint32_t region_band_end(const NXGI_REGION *rgn, uint32_t i)
+{
+	int32_t y1 = rgn->rects[i].y1;
+
+	while (++i < rgn->count && rgn->rects[i].y1 == y1);
+
+	return i;
+}
+
+/*
+ * Adds span x1..x2 to the band being built, which starts at index `band`.
+ * Spans come sorted by x1. A span touching the previous one extends it.
+ * Space has been reserved by the caller.
+ */
+static void region_append(NXGI_REGION *rgn, uint32_t band, int32_t x1, int32_t x2, int32_t y1, int32_t y2)
+{
+	NXGI_RECT *last;
+
+	if (rgn->count > band) {
+		last = &rgn->rects[rgn->count - 1];
+
+		if (last->x2 >= x1) {
+			if (x2 > last->x2) last->x2 = x2;
+			return;
+		}
+	}
+
+	rgn->rects[rgn->count++] = RECT(x1, y1, x2, y2);
+}
+
+/*
+ * Combines the spans of two bands, a[0..na) and b[0..nb), into a band of
+ * `dst` covering y1..y2.
+ */
+static void region_band_op(NXGI_REGION *dst, REGION_OP op, const NXGI_RECT *a, uint32_t na,
+		const NXGI_RECT *b, uint32_t nb, int32_t y1, int32_t y2)
+{
+	uint32_t	band = dst->count;
+	uint32_t	i = 0, j = 0;
+	int32_t		x1, x2;
+
+	switch (op) {
+	case REGION_OP_UNION:
+		while (i < na || j < nb) {
+			if (j >= nb || (i < na && a[i].x1 <= b[j].x1)) {
+				region_append(dst, band, a[i].x1, a[i].x2, y1, y2);
+				i++;
+			} else {
+				region_append(dst, band, b[j].x1, b[j].x2, y1, y2);
+				j++;
+			}
+		}
+		break;
+
+	case REGION_OP_INTERSECT:
+		while (i < na && j < nb) {
+			x1 = a[i].x1 > b[j].x1 ? a[i].x1 : b[j].x1;
+			x2 = a[i].x2 < b[j].x2 ? a[i].x2 : b[j].x2;
+
+			if (x1 < x2) {
+				region_append(dst, band, x1, x2, y1, y2);
+			}
+
+			if (a[i].x2 < b[j].x2) i++; else j++;
+		}
+		break;
+
+	case REGION_OP_SUBTRACT:
+		for (i=0; i<na; i++) {
+			x1 = a[i].x1;
+
+			/* Spans of b left of the remaining part can't cut it, nor the next spans of a */
+			while (j < nb && b[j].x2 <= x1) j++;
+
+			while (j < nb && b[j].x1 < a[i].x2) {
+				if (b[j].x1 > x1) {
+					region_append(dst, band, x1, b[j].x1, y1, y2);
+				}
+
+				x1 = b[j].x2;
+				if (x1 >= a[i].x2) break;
+				j++;
+			}
+
+			if (x1 < a[i].x2) {
+				region_append(dst, band, x1, a[i].x2, y1, y2);
+			}
+		}
+		break;
+	}
+}
+
+/*
+ * Sweeps the bands of `a` and `b` top to bottom. Each step takes the rows
+ * up to the next band edge of either region, where neither changes, and
+ * combines the spans covering them. A band equal to the one right above is
+ * merged into it.
+ */
+static HRESULT region_op(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b, REGION_OP op)
+{
+	NXGI_REGION	tmp;
+	uint32_t	ia = 0, ib = 0, ea = 0, eb = 0;
+	uint32_t	band, prev = 0;
+	BOOL		in_a, in_b, has_prev = FALSE;
+	BOOL		in_place = dst != a && dst != b;
+	int32_t		y = INT32_MIN, ay1, by1, top, bot;
+	HRESULT		hr;
+
+	/* Build in dst's own array unless it's an operand */
+	if (in_place) {
+		tmp = *dst;
+	} else {
+		nxgig_region_init(&tmp);
+	}
+
+	tmp.count = 0;
+
+	while (TRUE) {
+		if (op == REGION_OP_INTERSECT && (ia >= a->count || ib >= b->count)) break;
+		if (op == REGION_OP_SUBTRACT && ia >= a->count) break;
+		if (ia >= a->count && ib >= b->count) break;
+
+		/* Rows of the current bands above y are done */
+		if (ia < a->count) {
+			ea = region_band_end(a, ia);
+			ay1 = a->rects[ia].y1 > y ? a->rects[ia].y1 : y;
+		} else {
+			ay1 = INT32_MAX;
+		}
+
+		if (ib < b->count) {
+			eb = region_band_end(b, ib);
+			by1 = b->rects[ib].y1 > y ? b->rects[ib].y1 : y;
+		} else {
+			by1 = INT32_MAX;
+		}
+
+		top = ay1 < by1 ? ay1 : by1;
+		in_a = ay1 == top;
+		in_b = by1 == top;
+
+		bot = in_a ? a->rects[ia].y2 : ay1;
+		if (in_b) {
+			if (b->rects[ib].y2 < bot) bot = b->rects[ib].y2;
+		} else if (by1 < bot) {
+			bot = by1;
+		}
+
+		hr = region_reserve(&tmp, tmp.count + (in_a ? ea - ia : 0) + (in_b ? eb - ib : 0));
+		if (FAILED(hr)) {
+			if (in_place) {
+				*dst = tmp;
+				nxgig_region_clear(dst);
+			} else {
+				nxgig_region_fini(&tmp);
+			}
+
+			return hr;
+		}
+
+		band = tmp.count;
+		region_band_op(&tmp, op, in_a ? &a->rects[ia] : NULL, in_a ? ea - ia : 0,
+				in_b ? &b->rects[ib] : NULL, in_b ? eb - ib : 0, top, bot);
+
+		if (tmp.count > band) {
+			if (has_prev && tmp.rects[prev].y2 == top && band - prev == tmp.count - band) {
+				uint32_t i;
+
+				for (i=0; i<band-prev; i++) {
+					if (tmp.rects[prev + i].x1 != tmp.rects[band + i].x1 ||
+						tmp.rects[prev + i].x2 != tmp.rects[band + i].x2) break;
+				}
+
+				if (i == band - prev) {
+					for (i=prev; i<band; i++) {
+						tmp.rects[i].y2 = bot;
+					}
+
+					tmp.count = band;
+					band = prev;
+				}
+			}
+
+			prev = band;
+			has_prev = TRUE;
+		}
+
+		y = bot;
+		if (in_a && a->rects[ia].y2 == bot) ia = ea;
+		if (in_b && b->rects[ib].y2 == bot) ib = eb;
+	}
+
+	if (!in_place) {
+		nxgig_region_fini(dst);
+	}
+
+	*dst = tmp;
+	region_update_bounds(dst);
+
+	return S_OK;
+}
+
+void nxgig_region_init(NXGI_REGION *rgn)
+{
+	memset(rgn, 0, sizeof(NXGI_REGION));
+}
+
+void nxgig_region_fini(NXGI_REGION *rgn)
+{
+	if (rgn->rects != NULL) {
+		kfree(rgn->rects);
+	}
+
+	nxgig_region_init(rgn);
+}
+
+void nxgig_region_clear(NXGI_REGION *rgn)
+{
+	rgn->count = 0;
+	rgn->bounds = RECT(0, 0, 0, 0);
+}
+
+HRESULT nxgig_region_set_rect(NXGI_REGION *rgn, NXGI_RECT r)
+{
+	HRESULT hr;
+
+	if (nxgig_rect_empty(r)) {
+		nxgig_region_clear(rgn);
+		return S_OK;
+	}
+
+	hr = region_reserve(rgn, 1);
+	if (FAILED(hr)) return hr;
+
+	rgn->rects[0] = r;
+	rgn->count = 1;
+	rgn->bounds = r;
+
+	return S_OK;
+}
+
+HRESULT nxgig_region_copy(NXGI_REGION *dst, const NXGI_REGION *src)
+{
+	HRESULT hr;
+
+	if (dst == src) {
+		return S_OK;
+	}
+
+	hr = region_reserve(dst, src->count);
+	if (FAILED(hr)) return hr;
+
+	if (src->count > 0) {
+		memcpy(dst->rects, src->rects, src->count * sizeof(NXGI_RECT));
+	}
+
+	dst->count = src->count;
+	dst->bounds = src->bounds;
+
+	return S_OK;
+}
+
+HRESULT nxgig_region_union(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b)
+{
+	if (b->count == 0) return nxgig_region_copy(dst, a);
+	if (a->count == 0) return nxgig_region_copy(dst, b);
+
+	return region_op(dst, a, b, REGION_OP_UNION);
+}
+
+HRESULT nxgig_region_intersect(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b)
+{
+	if (a->count == 0 || b->count == 0 || !nxgig_rect_intersect(a->bounds, b->bounds)) {
+		nxgig_region_clear(dst);
+		return S_OK;
+	}
+
+	return region_op(dst, a, b, REGION_OP_INTERSECT);
+}
+
+HRESULT nxgig_region_subtract(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b)
+{
+	if (a->count == 0 || b->count == 0 || !nxgig_rect_intersect(a->bounds, b->bounds)) {
+		return nxgig_region_copy(dst, a);
+	}
+
+	return region_op(dst, a, b, REGION_OP_SUBTRACT);
+}
+
+/* Wraps a rectangle in a region without allocating */
+static NXGI_REGION region_from_rect(NXGI_RECT *r)
+{
+	NXGI_REGION rgn;
+
+	rgn.bounds = *r;
+	rgn.count = nxgig_rect_empty(*r) ? 0 : 1;
+	rgn.capacity = 1;
+	rgn.rects = r;
+
+	return rgn;
+}
+
+HRESULT nxgig_region_union_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r)
+{
+	NXGI_REGION b = region_from_rect(&r);
+	return nxgig_region_union(dst, a, &b);
+}
+
+HRESULT nxgig_region_intersect_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r)
+{
+	NXGI_REGION b = region_from_rect(&r);
+	return nxgig_region_intersect(dst, a, &b);
+}
+
+HRESULT nxgig_region_subtract_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r)
+{
+	NXGI_REGION b = region_from_rect(&r);
+	return nxgig_region_subtract(dst, a, &b);
+}
+
+void nxgig_region_translate(NXGI_REGION *rgn, NXGI_POINT vector)
+{
+	uint32_t i;
+
+	if (rgn->count == 0) {
+		return;
+	}
+
+	for (i=0; i<rgn->count; i++) {
+		rgn->rects[i] = nxgig_rect_offset(rgn->rects[i], vector);
+	}
+
+	rgn->bounds = nxgig_rect_offset(rgn->bounds, vector);
+}
+
+BOOL nxgig_region_empty(const NXGI_REGION *rgn)
+{
+	return rgn->count == 0;
+}
+
+NXGI_RECT nxgig_region_bounds(const NXGI_REGION *rgn)
+{
+	return rgn->bounds;
+}
+
+const NXGI_RECT *nxgig_region_rects(const NXGI_REGION *rgn, uint32_t *count_out)
+{
+	*count_out = rgn->count;
+	return rgn->rects;
+}
+
+/*
+ * Region benchmark
+ */
+
+/* Side of the reference bitmap of the property checks */
+#define REGION_BENCH_SIDE		96
+#define REGION_BENCH_CHECKS		2000
+
+/* Time per measurement, in milliseconds */
+#define REGION_BENCH_TIME		500
+
+static uint8_t region_bench_map[3][REGION_BENCH_SIDE * REGION_BENCH_SIDE];
+
+static uint32_t region_bench_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed ^ (*seed >> 16);
+}
+
+static NXGI_RECT region_bench_rect(uint32_t *seed, int32_t w, int32_t h, int32_t max_w, int32_t max_h)
+{
+	int32_t x = region_bench_rand(seed) % w;
+	int32_t y = region_bench_rand(seed) % h;
+
+	return RECT(x, y, x + 1 + region_bench_rand(seed) % max_w, y + 1 + region_bench_rand(seed) % max_h);
+}
+
+/* Sets the pixels of `rgn` in `map`, which is cleared first */
+static void region_bench_paint(const NXGI_REGION *rgn, uint8_t *map)
+{
+	uint32_t	i;
+	int32_t		x, y;
+
+	memset(map, 0, REGION_BENCH_SIDE * REGION_BENCH_SIDE);
+
+	for (i=0; i<rgn->count; i++) {
+		for (y=rgn->rects[i].y1; y<rgn->rects[i].y2; y++) {
+			for (x=rgn->rects[i].x1; x<rgn->rects[i].x2; x++) {
+				if (x >= 0 && y >= 0 && x < REGION_BENCH_SIDE && y < REGION_BENCH_SIDE) {
+					map[y * REGION_BENCH_SIDE + x] = 1;
+				}
+			}
+		}
+	}
+}
+
+/* Checks the banded form and bounds, see NXGI_REGION */
+static BOOL region_bench_valid(const NXGI_REGION *rgn)
+{
+	NXGI_REGION	check;
+	uint32_t	i, k, band = 0, n;
+
+	for (i=0; i<rgn->count; i++) {
+		NXGI_RECT r = rgn->rects[i], p;
+
+		if (nxgig_rect_empty(r)) return FALSE;
+		if (i == 0) continue;
+
+		p = rgn->rects[i - 1];
+
+		/* Same band, right of the previous span without touching it */
+		if (r.y1 == p.y1) {
+			if (r.y2 != p.y2 || r.x1 <= p.x2) return FALSE;
+			continue;
+		}
+
+		/* New band, below the previous one */
+		if (r.y1 < p.y2) return FALSE;
+
+		/* A band right under an equal one should have been merged into it */
+		n = region_band_end(rgn, i) - i;
+		if (p.y2 == r.y1 && i - band == n) {
+			for (k=0; k<n; k++) {
+				if (rgn->rects[band + k].x1 != rgn->rects[i + k].x1 ||
+					rgn->rects[band + k].x2 != rgn->rects[i + k].x2) break;
+			}
+
+			if (k == n) return FALSE;
+		}
+
+		band = i;
+	}
+
+	check = *rgn;
+	region_update_bounds(&check);
+
+	return memcmp(&check.bounds, &rgn->bounds, sizeof(NXGI_RECT)) == 0;
+}
+
+static HRESULT region_bench_check()
+{
+	static const char *op_names[] = {"union", "intersect", "subtract"};
+	NXGI_REGION	a, b, c;
+	uint32_t	seed = 0x5EED, i, k, n, op;
+	HRESULT		hr = S_OK;
+
+	nxgig_region_init(&a);
+	nxgig_region_init(&b);
+	nxgig_region_init(&c);
+
+	for (i=0; i<REGION_BENCH_CHECKS; i++) {
+		/* Random regions, built with every operation so the inputs vary in shape */
+		for (k=0; k<2; k++) {
+			NXGI_REGION *r = k ? &b : &a;
+
+			nxgig_region_clear(r);
+			n = 1 + region_bench_rand(&seed) % 8;
+
+			while (n--) {
+				NXGI_RECT rect = region_bench_rect(&seed, REGION_BENCH_SIDE, REGION_BENCH_SIDE, 48, 48);
+
+				switch (region_bench_rand(&seed) % 4) {
+				case 0: hr = nxgig_region_subtract_rect(r, r, rect); break;
+				case 1: hr = nxgig_region_intersect_rect(r, r, nxgig_rect_inflate(rect, 16)); break;
+				default: hr = nxgig_region_union_rect(r, r, rect); break;
+				}
+
+				if (FAILED(hr)) goto finally;
+			}
+		}
+
+		op = region_bench_rand(&seed) % 3;
+
+		switch (op) {
+		case 0: hr = nxgig_region_union(&c, &a, &b); break;
+		case 1: hr = nxgig_region_intersect(&c, &a, &b); break;
+		case 2: hr = nxgig_region_subtract(&c, &a, &b); break;
+		}
+
+		if (FAILED(hr)) goto finally;
+
+		region_bench_paint(&a, region_bench_map[0]);
+		region_bench_paint(&b, region_bench_map[1]);
+
+		for (k=0; k<REGION_BENCH_SIDE * REGION_BENCH_SIDE; k++) {
+			uint8_t pa = region_bench_map[0][k], pb = region_bench_map[1][k];
+			region_bench_map[0][k] = op == 0 ? (pa | pb) : op == 1 ? (pa & pb) : (pa & !pb);
+		}
+
+		region_bench_paint(&c, region_bench_map[2]);
+
+		if (!region_bench_valid(&a) || !region_bench_valid(&b) || !region_bench_valid(&c) ||
+			memcmp(region_bench_map[0], region_bench_map[2], REGION_BENCH_SIDE * REGION_BENCH_SIDE) != 0) {
+			k_printf("region %s: result differs from the reference, check %d.\n", op_names[op], i);
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		/* Moving there and back must give the same rectangles */
+		hr = nxgig_region_copy(&b, &c);
+		if (FAILED(hr)) goto finally;
+
+		nxgig_region_translate(&c, POINT(-37, 11));
+		nxgig_region_translate(&c, POINT(37, -11));
+
+		if (b.count != c.count || memcmp(&b.bounds, &c.bounds, sizeof(NXGI_RECT)) != 0 ||
+			(c.count > 0 && memcmp(b.rects, c.rects, c.count * sizeof(NXGI_RECT)) != 0)) {
+			k_printf("region translate: result differs, check %d.\n", i);
+			hr = E_FAIL;
+			goto finally;
+		}
+	}
+
+finally:
+	nxgig_region_fini(&a);
+	nxgig_region_fini(&b);
+	nxgig_region_fini(&c);
+
+	return hr;
+}
+
+/*
+ * One repaint of a desktop with `n` windows, top one last: the visible
+ * region of every window, and the damage of moving each of them by a few
+ * pixels. Returns the number of rectangles produced.
+ */
+static HRESULT region_bench_desktop(const NXGI_RECT *windows, uint32_t n, NXGI_REGION *above,
+		NXGI_REGION *visible, NXGI_REGION *damage, uint32_t *rects_out)
+{
+	uint32_t	i;
+	HRESULT		hr;
+
+	nxgig_region_clear(above);
+	nxgig_region_clear(damage);
+	*rects_out = 0;
+
+	for (i=n; i-->0; ) {
+		hr = nxgig_region_set_rect(visible, windows[i]);
+		if (FAILED(hr)) return hr;
+
+		hr = nxgig_region_subtract(visible, visible, above);
+		if (FAILED(hr)) return hr;
+
+		*rects_out += visible->count;
+
+		hr = nxgig_region_union_rect(above, above, windows[i]);
+		if (FAILED(hr)) return hr;
+
+		hr = nxgig_region_union_rect(damage, damage, nxgig_rect_offset(windows[i], POINT(6, 4)));
+		if (FAILED(hr)) return hr;
+	}
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgig_region_benchmark()
+{
+	static const uint32_t	window_counts[] = {8, 32, 128};
+	NXGI_RECT				*windows = NULL;
+	NXGI_REGION				above, visible, damage;
+	uint32_t				seed = 0xDE5C, i, k, passes, rects, start, elapsed;
+	HRESULT					hr;
+
+	hr = region_bench_check();
+	if (FAILED(hr)) return hr;
+
+	k_printf("region: %d random operations match the reference.\n", REGION_BENCH_CHECKS);
+
+	nxgig_region_init(&above);
+	nxgig_region_init(&visible);
+	nxgig_region_init(&damage);
+
+	windows = kmalloc(128 * sizeof(NXGI_RECT));
+	if (windows == NULL) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (k=0; k<sizeof(window_counts) / sizeof(window_counts[0]); k++) {
+		for (i=0; i<window_counts[k]; i++) {
+			windows[i] = region_bench_rect(&seed, 1920 - 200, 1080 - 150, 600, 450);
+			windows[i].x2 += 200;
+			windows[i].y2 += 150;
+		}
+
+		passes = 0;
+		start = timer_gettickcount();
+
+		do {
+			hr = region_bench_desktop(windows, window_counts[k], &above, &visible, &damage, &rects);
+			if (FAILED(hr)) goto finally;
+
+			passes++;
+			elapsed = timer_gettickcount() - start;
+		} while (elapsed < REGION_BENCH_TIME);
+
+		k_printf("%d windows: %d us per repaint, %d visible rects, %d damage rects\n", window_counts[k],
+				elapsed * 1000 / passes, rects, damage.count);
+	}
+
+finally:
+	if (windows) kfree(windows);
+	nxgig_region_fini(&above);
+	nxgig_region_fini(&visible);
+	nxgig_region_fini(&damage);
+
+	return hr;
+}
+
 BOOL nxgig_line_rect_intersect(NXGI_POINT l1, NXGI_POINT l2, NXGI_RECT r2)
 {
 	/* Test for intersection with the four corners */
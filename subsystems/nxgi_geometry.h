@@ -35,4 +35,67 @@ NXGI_RECT	nxgig_rect_offset(NXGI_RECT r, NXGI_POINT vector);
  */
 uint32_t	nxgig_rect_area(NXGI_RECT r);
 
+/**
+ * Returns the common part of two rectangles, which is empty (x1 >= x2 or
+ * y1 >= y2) if they don't overlap. Unlike nxgig_rect_intersect(), x2 and y2
+ * are exclusive, so touching rectangles don't overlap.
+ */
+NXGI_RECT	nxgig_rect_intersection(NXGI_RECT r1, NXGI_RECT r2);
+BOOL		nxgig_rect_empty(NXGI_RECT r);
+
+/**
+ * Splits the part of `r` outside of `cut` into up to 4 disjoint rectangles:
+ * full-width bands above and below `cut`, and the pieces left and right of
+ * it. Returns their count.
+ */
+uint32_t	nxgig_rect_subtract(NXGI_RECT r, NXGI_RECT cut, NXGI_RECT out[4]);
+
+/**
+ * Set of pixels, made of rectangles in y-x banded order. Rectangles form
+ * bands of equal y1 and y2, sorted top to bottom and not overlapping.
+ * Within a band, rectangles are sorted left to right and neither overlap
+ * nor touch. Touching bands with the same spans are coalesced, so every
+ * set of pixels has exactly one representation.
+ *
+ * Operations take their result in `dst`, which may be one of the operands.
+ */
+typedef struct NXGI_REGION NXGI_REGION;
+struct NXGI_REGION {
+	/** Bounding rectangle, empty for an empty region */
+	NXGI_RECT	bounds;
+
+	uint32_t	count;
+	uint32_t	capacity;
+	NXGI_RECT	*rects;
+};
+
+void		nxgig_region_init(NXGI_REGION *rgn);
+void		nxgig_region_fini(NXGI_REGION *rgn);
+void		nxgig_region_clear(NXGI_REGION *rgn);
+HRESULT		nxgig_region_set_rect(NXGI_REGION *rgn, NXGI_RECT r);
+HRESULT		nxgig_region_copy(NXGI_REGION *dst, const NXGI_REGION *src);
+
+HRESULT		nxgig_region_union(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b);
+HRESULT		nxgig_region_intersect(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b);
+HRESULT		nxgig_region_subtract(NXGI_REGION *dst, const NXGI_REGION *a, const NXGI_REGION *b);
+HRESULT		nxgig_region_union_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r);
+HRESULT		nxgig_region_intersect_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r);
+HRESULT		nxgig_region_subtract_rect(NXGI_REGION *dst, const NXGI_REGION *a, NXGI_RECT r);
+void		nxgig_region_translate(NXGI_REGION *rgn, NXGI_POINT vector);
+
+BOOL		nxgig_region_empty(const NXGI_REGION *rgn);
+NXGI_RECT	nxgig_region_bounds(const NXGI_REGION *rgn);
+
+/**
+ * Returns the region's rectangles in banded order, for iterating over them.
+ * The pointer is valid until the region changes.
+ */
+const NXGI_RECT *nxgig_region_rects(const NXGI_REGION *rgn, uint32_t *count_out);
+
+/**
+ * Checks region operations on random rectangles against a bitmap and
+ * measures them with desktop-like window counts.
+ */
+HRESULT		__nxapi nxgig_region_benchmark();
+
 #endif /* SUBSYSTEMS_NXGI_GEOMETRY_H_ */
@@ -10,6 +10,11 @@
 #include <string.h>
 #include <mm.h>
 #include "nxgi_graphics.h"
+#include "nxgi_span.h"
+#include "nxgi_scale.h"
+#include "nxgi_blend.h"
+#include "nxgi_convert.h"
+#include "nxgi_font.h"
 
 /*
  * Prototypes
@@ -18,156 +23,20 @@ static HRESULT 		__nxapi intrnl_draw_hline_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uin
 static HRESULT		__nxapi intrnl_draw_vline_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x, uint32_t y1, uint32_t y2);
 static void 		__nxapi intrnl_transform_point(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT *p);
 static void 		__nxapi intrnl_apply_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT *p);
-static inline void 	__nxapi intrnl_draw_char_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x, uint32_t y, NXGI_FONT *font, char c);
-static inline void 	__nxapi intrnl_draw_char_segment_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x, uint32_t y, NXGI_RECT clip_rect, NXGI_FONT *font, char c);
-static NXGI_SIZE 	__nxapi intrnl_get_char_size(NXGI_GRAPHICS_CONTEXT *gc, char c);
+static BOOL			__nxapi intrnl_clip_blit(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, NXGI_SIZE size, NXGI_RECT *rect_out, NXGI_POINT *skip_out);
 
 static inline void	intrnl_swap_ints(int32_t *i1, int32_t *i2);
 
-/* System font dimensions */
-#define SYS_FONT_WIDTH 		8
-#define SYS_FONT_HEIGHT 	8
-
-/*
- * System VGA font (1 bit per pixel). It takes 1 kilobyte of
- * memory.
- */
-static char __sys_font[128][8] = {
-	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x3E, 0x41, 0x55, 0x41, 0x55, 0x49, 0x3E },
-	  { 0x00, 0x3E, 0x7F, 0x6B, 0x7F, 0x6B, 0x77, 0x3E },
-	  { 0x00, 0x22, 0x77, 0x7F, 0x7F, 0x3E, 0x1C, 0x08 },
-	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x3E, 0x1C, 0x08 },
-	  { 0x00, 0x08, 0x1C, 0x2A, 0x7F, 0x2A, 0x08, 0x1C },
-	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x3E, 0x08, 0x1C },
-	  { 0x00, 0x00, 0x1C, 0x3E, 0x3E, 0x3E, 0x1C, 0x00 },
-	  { 0xFF, 0xFF, 0xE3, 0xC1, 0xC1, 0xC1, 0xE3, 0xFF },
-	  { 0x00, 0x00, 0x1C, 0x22, 0x22, 0x22, 0x1C, 0x00 },
-	  { 0xFF, 0xFF, 0xE3, 0xDD, 0xDD, 0xDD, 0xE3, 0xFF },
-	  { 0x00, 0x0F, 0x03, 0x05, 0x39, 0x48, 0x48, 0x30 },
-	  { 0x00, 0x08, 0x3E, 0x08, 0x1C, 0x22, 0x22, 0x1C },
-	  { 0x00, 0x18, 0x14, 0x10, 0x10, 0x30, 0x70, 0x60 },
-	  { 0x00, 0x0F, 0x19, 0x11, 0x13, 0x37, 0x76, 0x60 },
-	  { 0x00, 0x08, 0x2A, 0x1C, 0x77, 0x1C, 0x2A, 0x08 },
-	  { 0x00, 0x60, 0x78, 0x7E, 0x7F, 0x7E, 0x78, 0x60 },
-	  { 0x00, 0x03, 0x0F, 0x3F, 0x7F, 0x3F, 0x0F, 0x03 },
-	  { 0x00, 0x08, 0x1C, 0x2A, 0x08, 0x2A, 0x1C, 0x08 },
-	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x00, 0x66, 0x66 },
-	  { 0x00, 0x3F, 0x65, 0x65, 0x3D, 0x05, 0x05, 0x05 },
-	  { 0x00, 0x0C, 0x32, 0x48, 0x24, 0x12, 0x4C, 0x30 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x7F, 0x7F },
-	  { 0x00, 0x08, 0x1C, 0x2A, 0x08, 0x2A, 0x1C, 0x3E },
-	  { 0x00, 0x08, 0x1C, 0x3E, 0x7F, 0x1C, 0x1C, 0x1C },
-	  { 0x00, 0x1C, 0x1C, 0x1C, 0x7F, 0x3E, 0x1C, 0x08 },
-	  { 0x00, 0x08, 0x0C, 0x7E, 0x7F, 0x7E, 0x0C, 0x08 },
-	  { 0x00, 0x08, 0x18, 0x3F, 0x7F, 0x3F, 0x18, 0x08 },
-	  { 0x00, 0x00, 0x00, 0x70, 0x70, 0x70, 0x7F, 0x7F },
-	  { 0x00, 0x00, 0x14, 0x22, 0x7F, 0x22, 0x14, 0x00 },
-	  { 0x00, 0x08, 0x1C, 0x1C, 0x3E, 0x3E, 0x7F, 0x7F },
-	  { 0x00, 0x7F, 0x7F, 0x3E, 0x3E, 0x1C, 0x1C, 0x08 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18 },
-	  { 0x00, 0x36, 0x36, 0x14, 0x00, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36 },
-	  { 0x00, 0x08, 0x1E, 0x20, 0x1C, 0x02, 0x3C, 0x08 },
-	  { 0x00, 0x60, 0x66, 0x0C, 0x18, 0x30, 0x66, 0x06 },
-	  { 0x00, 0x3C, 0x66, 0x3C, 0x28, 0x65, 0x66, 0x3F },
-	  { 0x00, 0x18, 0x18, 0x18, 0x30, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x60, 0x30, 0x18, 0x18, 0x18, 0x30, 0x60 },
-	  { 0x00, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06 },
-	  { 0x00, 0x00, 0x36, 0x1C, 0x7F, 0x1C, 0x36, 0x00 },
-	  { 0x00, 0x00, 0x08, 0x08, 0x3E, 0x08, 0x08, 0x00 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x30, 0x60 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x60 },
-	  { 0x00, 0x00, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x00 },
-	  { 0x00, 0x3C, 0x66, 0x6E, 0x76, 0x66, 0x66, 0x3C },
-	  { 0x00, 0x18, 0x18, 0x38, 0x18, 0x18, 0x18, 0x7E },
-	  { 0x00, 0x3C, 0x66, 0x06, 0x0C, 0x30, 0x60, 0x7E },
-	  { 0x00, 0x3C, 0x66, 0x06, 0x1C, 0x06, 0x66, 0x3C },
-	  { 0x00, 0x0C, 0x1C, 0x2C, 0x4C, 0x7E, 0x0C, 0x0C },
-	  { 0x00, 0x7E, 0x60, 0x7C, 0x06, 0x06, 0x66, 0x3C },
-	  { 0x00, 0x3C, 0x66, 0x60, 0x7C, 0x66, 0x66, 0x3C },
-	  { 0x00, 0x7E, 0x66, 0x0C, 0x0C, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x3C, 0x66, 0x66, 0x3C, 0x66, 0x66, 0x3C },
-	  { 0x00, 0x3C, 0x66, 0x66, 0x3E, 0x06, 0x66, 0x3C },
-	  { 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x00 },
-	  { 0x00, 0x00, 0x18, 0x18, 0x00, 0x18, 0x18, 0x30 },
-	  { 0x00, 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06 },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x00, 0x3C, 0x00, 0x00 },
-	  { 0x00, 0x60, 0x30, 0x18, 0x0C, 0x18, 0x30, 0x60 },
-	  { 0x00, 0x3C, 0x66, 0x06, 0x1C, 0x18, 0x00, 0x18 },
-	  { 0x00, 0x38, 0x44, 0x5C, 0x58, 0x42, 0x3C, 0x00 },
-	  { 0x00, 0x3C, 0x66, 0x66, 0x7E, 0x66, 0x66, 0x66 },
-	  { 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x66, 0x66, 0x7C },
-	  { 0x00, 0x3C, 0x66, 0x60, 0x60, 0x60, 0x66, 0x3C },
-	  { 0x00, 0x7C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7C },
-	  { 0x00, 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x7E },
-	  { 0x00, 0x7E, 0x60, 0x60, 0x7C, 0x60, 0x60, 0x60 },
-	  { 0x00, 0x3C, 0x66, 0x60, 0x60, 0x6E, 0x66, 0x3C },
-	  { 0x00, 0x66, 0x66, 0x66, 0x7E, 0x66, 0x66, 0x66 },
-	  { 0x00, 0x3C, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C },
-	  { 0x00, 0x1E, 0x0C, 0x0C, 0x0C, 0x6C, 0x6C, 0x38 },
-	  { 0x00, 0x66, 0x6C, 0x78, 0x70, 0x78, 0x6C, 0x66 },
-	  { 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7E },
-	  { 0x00, 0x63, 0x77, 0x7F, 0x6B, 0x63, 0x63, 0x63 },
-	  { 0x00, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x63, 0x63 },
-	  { 0x00, 0x3C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C },
-	  { 0x00, 0x7C, 0x66, 0x66, 0x66, 0x7C, 0x60, 0x60 },
-	  { 0x00, 0x3C, 0x66, 0x66, 0x66, 0x6E, 0x3C, 0x06 },
-	  { 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x78, 0x6C, 0x66 },
-	  { 0x00, 0x3C, 0x66, 0x60, 0x3C, 0x06, 0x66, 0x3C },
-	  { 0x00, 0x7E, 0x5A, 0x18, 0x18, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3E },
-	  { 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C, 0x18 },
-	  { 0x00, 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63 },
-	  { 0x00, 0x63, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x63 },
-	  { 0x00, 0x66, 0x66, 0x66, 0x3C, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x7E, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x7E },
-	  { 0x00, 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E },
-	  { 0x00, 0x00, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x00 },
-	  { 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x78 },
-	  { 0x00, 0x08, 0x14, 0x22, 0x41, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F },
-	  { 0x00, 0x0C, 0x0C, 0x06, 0x00, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x06, 0x3E, 0x66, 0x3E },
-	  { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x66, 0x7C },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x60, 0x66, 0x3C },
-	  { 0x00, 0x06, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3E },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x7E, 0x60, 0x3C },
-	  { 0x00, 0x1C, 0x36, 0x30, 0x30, 0x7C, 0x30, 0x30 },
-	  { 0x00, 0x00, 0x3E, 0x66, 0x66, 0x3E, 0x06, 0x3C },
-	  { 0x00, 0x60, 0x60, 0x60, 0x7C, 0x66, 0x66, 0x66 },
-	  { 0x00, 0x00, 0x18, 0x00, 0x18, 0x18, 0x18, 0x3C },
-	  { 0x00, 0x0C, 0x00, 0x0C, 0x0C, 0x6C, 0x6C, 0x38 },
-	  { 0x00, 0x60, 0x60, 0x66, 0x6C, 0x78, 0x6C, 0x66 },
-	  { 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x00, 0x00, 0x63, 0x77, 0x7F, 0x6B, 0x6B },
-	  { 0x00, 0x00, 0x00, 0x7C, 0x7E, 0x66, 0x66, 0x66 },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x66, 0x66, 0x66, 0x3C },
-	  { 0x00, 0x00, 0x7C, 0x66, 0x66, 0x7C, 0x60, 0x60 },
-	  { 0x00, 0x00, 0x3C, 0x6C, 0x6C, 0x3C, 0x0D, 0x0F },
-	  { 0x00, 0x00, 0x00, 0x7C, 0x66, 0x66, 0x60, 0x60 },
-	  { 0x00, 0x00, 0x00, 0x3E, 0x40, 0x3C, 0x02, 0x7C },
-	  { 0x00, 0x00, 0x18, 0x18, 0x7E, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x3E },
-	  { 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x3C, 0x18 },
-	  { 0x00, 0x00, 0x00, 0x63, 0x6B, 0x6B, 0x6B, 0x3E },
-	  { 0x00, 0x00, 0x00, 0x66, 0x3C, 0x18, 0x3C, 0x66 },
-	  { 0x00, 0x00, 0x00, 0x66, 0x66, 0x3E, 0x06, 0x3C },
-	  { 0x00, 0x00, 0x00, 0x3C, 0x0C, 0x18, 0x30, 0x3C },
-	  { 0x00, 0x0E, 0x18, 0x18, 0x30, 0x18, 0x18, 0x0E },
-	  { 0x00, 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18 },
-	  { 0x00, 0x70, 0x18, 0x18, 0x0C, 0x18, 0x18, 0x70 },
-	  { 0x00, 0x00, 0x00, 0x3A, 0x6C, 0x00, 0x00, 0x00 },
-	  { 0x00, 0x08, 0x1C, 0x36, 0x63, 0x41, 0x41, 0x7F }
-};
-
 /*
  * Implementation
  */
 HRESULT __nxapi graphics_set_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *pTarget)
 {
+	/* Recorded coordinates are relative to the target */
+	if (gc->record && pTarget) {
+		return E_INVALIDSTATE;
+	}
+
 	/* Unreference and detach old target */
 	if (gc->target) {
 		gc->target->ref_count--;
@@ -179,7 +48,8 @@ HRESULT __nxapi graphics_set_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *pTar
 	}
 
 	/* This graphical engine can handle on software bitmaps */
-	if (pTarget->tag != NXGI_BITMAP_TAG_DEFAULT && pTarget->tag != NXGI_BITMAP_TAG_SCREEN_SURFACE) {
+	if (pTarget->tag != NXGI_BITMAP_TAG_DEFAULT && pTarget->tag != NXGI_BITMAP_TAG_SCREEN_SURFACE &&
+			pTarget->tag != NXGI_BITMAP_TAG_FRAME_BUFFER) {
 		return E_FAIL;
 	}
 
@@ -196,7 +66,14 @@ HRESULT __nxapi graphics_set_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *pTar
 
 	gc->set_clip_rect(gc, cr);
 
-	/* Assign new drawing ops, depending of bitmap format */
+	return graphics_set_ops(gc);
+}
+
+/*
+ * Assigns the drawing ops, depending of target's format.
+ */
+HRESULT __nxapi graphics_set_ops(NXGI_GRAPHICS_CONTEXT *gc)
+{
 	switch (gc->target->format) {
 		case NXGI_FORMAT_BGRA32:
 			gc->set_pixel = graphics_set_pixel_bgra32;
@@ -207,9 +84,27 @@ HRESULT __nxapi graphics_set_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *pTar
 			gc->bitblt	= graphics_bitblt_bgra32;
 			gc->stretchblt = graphics_stretchblt_bgra32;
 			gc->alphablend = graphics_alphablend_bgra32;
+			gc->fill_mask = graphics_fill_mask_bgra32;
 			gc->draw_text = graphics_draw_text_bgra32;
 			break;
 
+		case NXGI_FORMAT_RGBA32:
+		case NXGI_FORMAT_RGB24:
+		case NXGI_FORMAT_RGB565:
+		case NXGI_FORMAT_RGB555:
+			/* Other formats can only be blitted onto, converting the source */
+			gc->set_pixel = NULL;
+			gc->get_pixel = NULL;
+			gc->draw_line = NULL;
+			gc->draw_rect = NULL;
+			gc->fill_rect = NULL;
+			gc->bitblt	= graphics_bitblt_bgra32;
+			gc->stretchblt = NULL;
+			gc->alphablend = NULL;
+			gc->fill_mask = NULL;
+			gc->draw_text = NULL;
+			break;
+
 		default:
 			/* Unsupported pixel format */
 			return E_FAIL;
@@ -301,22 +196,131 @@ HRESULT __nxapi graphics_draw_rect_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT r
 
 HRESULT __nxapi graphics_stretchblt_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
 {
-	UNUSED_ARG(gc);
-	UNUSED_ARG(dst_rect);
-	UNUSED_ARG(pSrcBitmap);
-	UNUSED_ARG(src_rect);
+	NXGI_RECT	dst_clipped_rect, clip;
+	uint8_t		*pdst, *psrc;
+
+	/* Check if target is attached */
+	if (!gc->target) {
+		return E_INVALIDSTATE;
+	}
+
+	if (pSrcBitmap->format != gc->target->format) {
+		return E_NOTIMPL;
+	}
 
-	return E_NOTIMPL;
+	/* Make sure source position is in bounds */
+	if (!nxgig_rect_contains_rect(src_rect, RECT(0, 0, pSrcBitmap->width, pSrcBitmap->height))) {
+		return E_INVALIDARG;
+	}
+
+	/* Mirroring isn't supported */
+	if (RECT_WIDTH(src_rect) <= 0 || RECT_HEIGHT(src_rect) <= 0 || RECT_WIDTH(dst_rect) <= 0 || RECT_HEIGHT(dst_rect) <= 0) {
+		return S_FALSE;
+	}
+
+	dst_clipped_rect = dst_rect;
+
+	/* Apply offset for unclipped rect (dst_rect) */
+	intrnl_apply_offset(gc, &dst_rect.p1);
+	intrnl_apply_offset(gc, &dst_rect.p2);
+
+	/* Apply offset and clipping */
+	intrnl_transform_point(gc, &dst_clipped_rect.p1);
+	intrnl_transform_point(gc, &dst_clipped_rect.p2);
+
+	if (RECT_WIDTH(dst_clipped_rect) <= 0 || RECT_HEIGHT(dst_clipped_rect) <= 0) {
+		/* Clipped out */
+		return S_FALSE;
+	}
+
+	/* The scaler works on the whole destination rect, writing only the clipped part */
+	clip = nxgig_rect_offset(dst_clipped_rect, POINT(-dst_rect.x1, -dst_rect.y1));
+
+	pdst = (uint8_t*)gc->target->pBits + dst_clipped_rect.y1 * gc->target->stride + dst_clipped_rect.x1 * gc->target->bits_per_pixel / 8;
+	psrc = (uint8_t*)pSrcBitmap->pBits + src_rect.y1 * pSrcBitmap->stride + src_rect.x1 * pSrcBitmap->bits_per_pixel / 8;
+
+	return nxgi_scale(pdst, gc->target->stride, RECT_WIDTH(dst_rect), RECT_HEIGHT(dst_rect), clip,
+			psrc, pSrcBitmap->stride, RECT_WIDTH(src_rect), RECT_HEIGHT(src_rect), gc->filter, nxgi_span_flags(gc->target));
 }
 
+/*
+ * Composites a premultiplied source bitmap onto the target, using the
+ * operator and constant alpha set by set_composite().
+ */
 HRESULT __nxapi graphics_alphablend_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect)
 {
-	UNUSED_ARG(gc);
-	UNUSED_ARG(dst_pos);
-	UNUSED_ARG(pSrcBitmap);
-	UNUSED_ARG(src_rect);
+	NXGI_RECT	dst_rect;
+	NXGI_POINT	skip;
+	uint8_t		*psrc, *pdst;
+	uint32_t	flags;
+	int32_t		h;
 
-	return E_NOTIMPL;
+	/* Check if target is attached */
+	if (!gc->target) {
+		return E_INVALIDSTATE;
+	}
+
+	if (pSrcBitmap->format != gc->target->format) {
+		return E_NOTIMPL;
+	}
+
+	/* Make sure source position is in bounds */
+	if (!nxgig_rect_contains_rect(src_rect, RECT(0, 0, pSrcBitmap->width, pSrcBitmap->height))) {
+		return E_INVALIDARG;
+	}
+
+	if (!intrnl_clip_blit(gc, dst_pos, SIZE(RECT_WIDTH(src_rect), RECT_HEIGHT(src_rect)), &dst_rect, &skip)) {
+		return S_FALSE;
+	}
+
+	pdst = (uint8_t*)gc->target->pBits + dst_rect.y1 * gc->target->stride + dst_rect.x1 * gc->target->bits_per_pixel / 8;
+	psrc = (uint8_t*)pSrcBitmap->pBits + (src_rect.y1 + skip.y) * pSrcBitmap->stride + (src_rect.x1 + skip.x) * pSrcBitmap->bits_per_pixel / 8;
+	flags = nxgi_span_flags(gc->target);
+
+	for (h=RECT_HEIGHT(dst_rect); h>0; h--) {
+		nxgi_blend_span((uint32_t*)pdst, (const uint32_t*)psrc, RECT_WIDTH(dst_rect), gc->composite, gc->alpha, flags);
+
+		pdst += gc->target->stride;
+		psrc += pSrcBitmap->stride;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Fills with the current color through a mask of 8-bit coverage values,
+ * `mask_stride` bytes per row. Always composites with SRC_OVER, scaled by
+ * the constant alpha.
+ */
+HRESULT __nxapi graphics_fill_mask_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size)
+{
+	NXGI_RECT	dst_rect;
+	NXGI_POINT	skip;
+	uint8_t		*pdst;
+	uint32_t	color;
+	int32_t		h;
+
+	if (!gc->target) {
+		return E_INVALIDSTATE;
+	}
+
+	if (!intrnl_clip_blit(gc, dst_pos, size, &dst_rect, &skip)) {
+		return S_FALSE;
+	}
+
+	color = nxgi_span_scale(nxgi_span_premultiply(nxgi_span_color(gc->color)), gc->alpha);
+
+	pdst = (uint8_t*)gc->target->pBits + dst_rect.y1 * gc->target->stride + dst_rect.x1 * gc->target->bits_per_pixel / 8;
+	mask += skip.y * mask_stride + skip.x;
+
+	for (h=RECT_HEIGHT(dst_rect); h>0; h--) {
+		nxgi_span_mask((uint32_t*)pdst, color, mask, RECT_WIDTH(dst_rect));
+
+		pdst += gc->target->stride;
+		mask += mask_stride;
+	}
+
+	return S_OK;
 }
 
 static HRESULT __nxapi intrnl_draw_hline_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1, uint32_t y, uint32_t x2)
@@ -331,13 +335,9 @@ static HRESULT __nxapi intrnl_draw_hline_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint3
 		x2 = tmp;
 	}
 
-	uint32_t width = x2 - x1;
-	NXGI_COLOR *pixel = (NXGI_COLOR*)((uint8_t*)gc->target->pBits + (y * gc->target->stride) + (x1 * gc->target->bits_per_pixel / 8));
+	uint32_t *pixel = (uint32_t*)((uint8_t*)gc->target->pBits + (y * gc->target->stride) + (x1 * gc->target->bits_per_pixel / 8));
 
-	while (width--) {
-		*pixel = gc->color;
-		pixel++;
-	}
+	nxgi_span_fill(pixel, nxgi_span_color(gc->color), x2 - x1, nxgi_span_flags(gc->target));
 
 	return S_OK;
 }
@@ -351,13 +351,10 @@ static HRESULT __nxapi intrnl_draw_vline_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint3
 		y2 = tmp;
 	}
 
-	uint32_t height = y2 - y1;
 	uint8_t *pixel = (uint8_t*)gc->target->pBits + (y1 * gc->target->stride) + (x * gc->target->bits_per_pixel / 8);
 
-	while (height--) {
-		*(NXGI_COLOR*)pixel = gc->color;
-		pixel += gc->target->stride;
-	}
+	/* One pixel wide spans, so this ends up in the C kernel */
+	nxgi_span_fill_rect(pixel, gc->target->stride, 1, y2 - y1, nxgi_span_color(gc->color), nxgi_span_flags(gc->target));
 
 	return S_OK;
 }
@@ -391,6 +388,36 @@ static void __nxapi intrnl_apply_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT *p
 	p->y += gc->offset.y;
 }
 
+/*
+ * Offsets and clips a blit of `size` pixels at `pos`. Returns the clipped
+ * rect and how far clipping moved it's top-left corner, which is where
+ * reading starts within the source. Returns FALSE if nothing is left.
+ */
+static BOOL __nxapi intrnl_clip_blit(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, NXGI_SIZE size, NXGI_RECT *rect_out, NXGI_POINT *skip_out)
+{
+	NXGI_RECT r;
+
+	if (size.width <= 0 || size.height <= 0) {
+		return FALSE;
+	}
+
+	r.p1 = pos;
+	r.p2 = POINT(pos.x + size.width, pos.y + size.height);
+
+	intrnl_apply_offset(gc, &pos);
+	intrnl_transform_point(gc, &r.p1);
+	intrnl_transform_point(gc, &r.p2);
+
+	if (RECT_WIDTH(r) <= 0 || RECT_HEIGHT(r) <= 0) {
+		return FALSE;
+	}
+
+	*rect_out = r;
+	*skip_out = POINT(r.x1 - pos.x, r.y1 - pos.y);
+
+	return TRUE;
+}
+
 static inline void intrnl_swap_ints(int32_t *i1, int32_t *i2)
 {
 	int32_t t = *i1;
@@ -399,8 +426,10 @@ static inline void intrnl_swap_ints(int32_t *i1, int32_t *i2)
 }
 
 /*
- * Draws a line using Bresenham's line algorithm. Clipping is performed
- * before drawing take places.
+ * Draws a line using Bresenham's line algorithm. Axis-aligned lines don't
+ * include their end point. Pixels outside the clipping rect are skipped,
+ * rather than moving the end points onto it, so a line looks the same
+ * however the drawing is split into clip rects.
  */
 HRESULT __nxapi graphics_draw_line_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
 {
@@ -410,29 +439,42 @@ HRESULT __nxapi graphics_draw_line_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1
 	}
 
 	NXGI_RECT 	r = gc->clip_rect;
+	NXGI_RECT	l;
 	NXGI_POINT 	p1 = {x1, y1};
 	NXGI_POINT 	p2 = {x2, y2};
+	BOOL		inside;
 
 	/* For lines, we need additional clipping logic. If the line
 	 * is totally outside of the clipping rect, just do nothing.
+	 * Pixels are up to half a pixel off the line, hence the margin.
 	 */
-	NXGI_RECT unoffs_r = nxgig_rect_offset(r, POINT(-gc->offset.x, -gc->offset.y));
+	NXGI_RECT unoffs_r = nxgig_rect_offset(nxgig_rect_inflate(r, 1), POINT(-gc->offset.x, -gc->offset.y));
 	if (!nxgig_line_rect_intersect(POINT(x1, y1), POINT(x2, y2), unoffs_r)) {
 		/* Out of clipping rect */
 		return S_OK;
 	}
 
-	/* Clip points */
-	intrnl_transform_point(gc, &p1);
-	intrnl_transform_point(gc, &p2);
+	intrnl_apply_offset(gc, &p1);
+	intrnl_apply_offset(gc, &p2);
 
 	/* Handle axis-aligned lines. */
-	if (p1.x == p2.x) {
-		return intrnl_draw_vline_bgra32(gc, p1.x, p1.y, p2.y);
-	}
+	if (p1.x == p2.x || p1.y == p2.y) {
+		if (p1.x == p2.x) {
+			l = RECT(p1.x, p1.y < p2.y ? p1.y : p2.y, p1.x + 1, p1.y < p2.y ? p2.y : p1.y);
+		} else {
+			l = RECT(p1.x < p2.x ? p1.x : p2.x, p1.y, p1.x < p2.x ? p2.x : p1.x, p1.y + 1);
+		}
+
+		l = nxgig_rect_intersection(l, r);
+		if (nxgig_rect_empty(l)) {
+			return S_OK;
+		}
 
-	if (p1.y == p2.y) {
-		return intrnl_draw_hline_bgra32(gc, p1.x, p1.y, p2.x);
+		if (p1.x == p2.x) {
+			return intrnl_draw_vline_bgra32(gc, l.x1, l.y1, l.y2);
+		}
+
+		return intrnl_draw_hline_bgra32(gc, l.x1, l.y1, l.x2);
 	}
 
 	/* Draw non-axis-aligned line */
@@ -443,9 +485,15 @@ HRESULT __nxapi graphics_draw_line_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x1
 	int32_t err = (dx>dy ? dx : -dy) / 2;
 	int32_t e2;
 
+	/* Test every pixel only if the line leaves the clipping rect */
+	inside = p1.x >= r.x1 && p1.x < r.x2 && p1.y >= r.y1 && p1.y < r.y2 &&
+			p2.x >= r.x1 && p2.x < r.x2 && p2.y >= r.y1 && p2.y < r.y2;
+
 	while (TRUE) {
-		NXGI_COLOR *pixel = (NXGI_COLOR*)((uint8_t*)gc->target->pBits + (p1.x * gc->target->bits_per_pixel / 8) + (p1.y * gc->target->stride));
-		*pixel = gc->color;
+		if (inside || (p1.x >= r.x1 && p1.x < r.x2 && p1.y >= r.y1 && p1.y < r.y2)) {
+			NXGI_COLOR *pixel = (NXGI_COLOR*)((uint8_t*)gc->target->pBits + (p1.x * gc->target->bits_per_pixel / 8) + (p1.y * gc->target->stride));
+			*pixel = gc->color;
+		}
 
 		if (p1.x == p2.x && p1.y == p2.y) {
 			break;
@@ -504,7 +552,7 @@ HRESULT __nxapi graphics_get_pixel_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT
 
 HRESULT __nxapi graphics_fill_rect_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect)
 {
-	int32_t y;
+	uint8_t *pixel;
 
 	if (!gc->target) {
 		return E_INVALIDSTATE;
@@ -520,13 +568,16 @@ HRESULT __nxapi graphics_fill_rect_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT r
 		return S_FALSE;
 	}
 
+	if (rect.x1 > rect.x2) {
+		intrnl_swap_ints(&rect.x1, &rect.x2);
+	}
+
 	if (rect.y1 > rect.y2) {
 		intrnl_swap_ints(&rect.y1, &rect.y2);
 	}
 
-	for (y=rect.y1; y<rect.y2; y++) {
-		intrnl_draw_hline_bgra32(gc, rect.x1, y, rect.x2);
-	}
+	pixel = (uint8_t*)gc->target->pBits + (rect.y1 * gc->target->stride) + (rect.x1 * gc->target->bits_per_pixel / 8);
+	nxgi_span_fill_rect(pixel, gc->target->stride, RECT_WIDTH(rect), RECT_HEIGHT(rect), nxgi_span_color(gc->color), nxgi_span_flags(gc->target));
 
 	return S_OK;
 }
@@ -538,11 +589,6 @@ HRESULT __nxapi graphics_bitblt_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst
 		return E_INVALIDSTATE;
 	}
 
-	/* We don't support format conversion at this point. */
-	if (pSrcBitmap->format != gc->target->format) {
-		return E_NOTIMPL;
-	}
-
 	/* Make sure source position is in bounds */
 	if (!nxgig_rect_contains_rect(src_rect, RECT(0, 0, pSrcBitmap->width, pSrcBitmap->height))) {
 		return E_INVALIDARG;
@@ -574,22 +620,26 @@ HRESULT __nxapi graphics_bitblt_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst
 		return S_FALSE;
 	}
 
+	int32_t 	w = RECT_WIDTH(dst_clipped_rect);
 	int32_t 	h = RECT_HEIGHT(dst_clipped_rect);
-	uint32_t 	line_size = (uint32_t)RECT_WIDTH(dst_clipped_rect) * pSrcBitmap->bits_per_pixel / 8;
 	uint32_t 	horiz_offs = dst_clipped_rect.x1 * gc->target->bits_per_pixel / 8;
-	uint32_t 	src_horiz_offs = (src_rect.x1 + clip_offset.x) * gc->target->bits_per_pixel / 8;
+	uint32_t 	src_horiz_offs = (src_rect.x1 + clip_offset.x) * pSrcBitmap->bits_per_pixel / 8;
 	uint8_t 	*psrc, *pdst;
-	int32_t 	j;
-	uint32_t	byte_cntr = 0;
 
-	for (j=0; j<h; j++) {
-		pdst = (uint8_t*)gc->target->pBits + (dst_clipped_rect.y1 + j) * gc->target->stride + horiz_offs;
-		psrc = (uint8_t*)pSrcBitmap->pBits + (src_rect.y1 + clip_offset.y + j) * pSrcBitmap->stride + src_horiz_offs;
+	if (w <= 0 || h <= 0) {
+		return S_FALSE;
+	}
+
+	pdst = (uint8_t*)gc->target->pBits + dst_clipped_rect.y1 * gc->target->stride + horiz_offs;
+	psrc = (uint8_t*)pSrcBitmap->pBits + (src_rect.y1 + clip_offset.y) * pSrcBitmap->stride + src_horiz_offs;
 
-		memcpy(pdst, psrc, line_size);
-		byte_cntr += line_size;
+	/* Span kernels only copy 32-bit pixels, anything else is converted */
+	if (pSrcBitmap->format != gc->target->format || gc->target->bits_per_pixel != 32) {
+		return nxgi_convert_rect(pdst, gc->target->stride, gc->target->format, psrc, pSrcBitmap->stride, pSrcBitmap->format, w, h);
 	}
 
+	nxgi_span_copy_rect(pdst, gc->target->stride, psrc, pSrcBitmap->stride, w, h, nxgi_span_flags(gc->target));
+
 	return S_OK;
 }
 
@@ -615,6 +665,10 @@ HRESULT __nxapi graphics_create_context(NXGI_GRAPHICS_CONTEXT **ppGC)
 	gc->text_size = graphics_text_size;
 	gc->set_font = graphics_set_font;
 	gc->get_font = graphics_get_font;
+	gc->set_filter = graphics_set_filter;
+	gc->get_filter = graphics_get_filter;
+	gc->set_composite = graphics_set_composite;
+	gc->get_composite = graphics_get_composite;
 	gc->destroy = graphics_destroy_context;
 
 	/* Set default font */
@@ -627,6 +681,9 @@ HRESULT __nxapi graphics_create_context(NXGI_GRAPHICS_CONTEXT **ppGC)
 	default_font.reserved = 0;
 
 	gc->set_font(gc, default_font);
+	gc->filter = NXGI_FILTER_BILINEAR;
+	gc->composite = NXGI_COMPOSITE_SRC_OVER;
+	gc->alpha = 255;
 
 	/* Success */
 	*ppGC = gc;
@@ -642,211 +699,139 @@ void 	__nxapi graphics_destroy_context(NXGI_GRAPHICS_CONTEXT *gc)
 	kfree(gc);
 }
 
-static inline void __nxapi intrnl_draw_char_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x, uint32_t y, NXGI_FONT *font, char c)
+HRESULT __nxapi graphics_set_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT font_params)
 {
-	uint32_t	i, j;
-	NXGI_COLOR  *pix_ptr;
-	char		glyph, glyph_offs;
-
-	/* We don't check input arguments here. `c` is exception. */
-	if (c < 0) {
-		return;
-	}
-
-	/* Iterate rows */
-	for (j=0; j<SYS_FONT_HEIGHT; j++) {
-		glyph = __sys_font[(uint8_t)c][j];
-
-		if (glyph == 0) {
-			/* Empty line */
-			continue;
-		}
-
-		pix_ptr = (NXGI_COLOR*)((uint8_t*)gc->target->pBits + x * gc->target->bits_per_pixel / 8 + (y+j) * gc->target->stride);
-
-		for (i=0; i<SYS_FONT_WIDTH; i++) {
-			glyph_offs = glyph >> i;
+	NXGI_GLYPH_CACHE	*cache;
+	HRESULT				hr;
 
-			if (glyph_offs & 1) {
-				pix_ptr[SYS_FONT_WIDTH - i] = font->color;
-			}
+	/* Size is the scale factor of the bitmap font */
+	hr = nxgi_font_get_cache(font_params.name, font_params.size, &cache);
+	if (FAILED(hr)) return hr;
 
-			if (glyph_offs <= 1) {
-				/* No pixels remain in row */
-				break;
-			}
-		}
-	}
+	gc->font = font_params;
+	gc->glyphs = cache;
+	return S_OK;
 }
 
-static inline void 	__nxapi intrnl_draw_char_segment_bgra32(NXGI_GRAPHICS_CONTEXT *gc, uint32_t x, uint32_t y, NXGI_RECT clip_rect, NXGI_FONT *font, char c)
+HRESULT __nxapi graphics_get_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_out)
 {
-	uint32_t	i, j;
-	NXGI_COLOR  *pix_ptr;
-	char		glyph, glyph_offs;
+	*font_params_out = gc->font;
+	return S_OK;
+}
 
-	/* We don't check input arguments here. `c` is exception. */
-	if (c < 0) {
-		return;
+HRESULT __nxapi graphics_set_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER filter)
+{
+	if (filter > NXGI_FILTER_BOX) {
+		return E_INVALIDARG;
 	}
 
-	/* Iterate rows */
-	for (j=0; j<SYS_FONT_HEIGHT; j++) {
-		int32_t ly = y + (int32_t)j;
-		if (ly < clip_rect.y1 || ly > clip_rect.y2) {
-			continue;
-		}
-
-		glyph = __sys_font[(uint8_t)c][j];
-
-		if (glyph == 0) {
-			/* Empty line */
-			continue;
-		}
-
-		pix_ptr = (NXGI_COLOR*)((uint8_t*)gc->target->pBits + x * gc->target->bits_per_pixel / 8 + (y+j) * gc->target->stride);
-
-		for (i=0; i<SYS_FONT_WIDTH; i++) {
-			int32_t lx = x + SYS_FONT_WIDTH - (int32_t)i;
-			if (lx < clip_rect.x1 || lx > clip_rect.x2) {
-				continue;
-			}
-
-			glyph_offs = glyph >> i;
-
-			if (glyph_offs & 1) {
-				pix_ptr[SYS_FONT_WIDTH - i] = font->color;
-			}
-
-			if (glyph_offs <= 1) {
-				/* No pixels remain in row */
-				break;
-			}
-		}
-	}
+	gc->filter = filter;
+	return S_OK;
 }
 
-HRESULT __nxapi graphics_set_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT font_params)
+HRESULT __nxapi graphics_get_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER *filter_out)
 {
-	/* Validate */
-	if (strcmp(font_params.name, "System") != 0) {
-		/* We don't support other fonts at this time */
-		return E_INVALIDARG;
-	}
+	*filter_out = gc->filter;
+	return S_OK;
+}
 
-	if (font_params.size != 1) {
-		/* We don't support scaling */
+HRESULT __nxapi graphics_set_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE op, uint8_t alpha)
+{
+	if (op >= NXGI_COMPOSITE_COUNT) {
 		return E_INVALIDARG;
 	}
 
-	gc->font = font_params;
+	gc->composite = op;
+	gc->alpha = alpha;
 	return S_OK;
 }
 
-HRESULT __nxapi graphics_get_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_out)
+HRESULT __nxapi graphics_get_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE *op_out, uint8_t *alpha_out)
 {
-	*font_params_out = gc->font;
+	*op_out = gc->composite;
+	*alpha_out = gc->alpha;
 	return S_OK;
 }
 
 HRESULT __nxapi graphics_text_size(NXGI_GRAPHICS_CONTEXT *gc, char *text, NXGI_SIZE *size_out)
 {
-	char *s = text;
+	NXGI_GLYPH_CACHE	*cache = gc->glyphs;
+	uint8_t				*s = (uint8_t*)text;
+
+	if (!cache) {
+		return E_INVALIDSTATE;
+	}
 
 	size_out->width = 0;
 
 	while (*s) {
-		//size_out->width += intrnl_get_char_size(gc, *s).width;
-		size_out->width++;
+		size_out->width += cache->advance[*s];
 		s++;
 	}
 
-	size_out->width *= intrnl_get_char_size(gc, ' ').width;
-
-	/* Supposedly, every symbol has sample height */
-	size_out->height = intrnl_get_char_size(gc, ' ').height;
+	/* Height of the line, not of the glyphs */
+	size_out->height = cache->height;
 
 	return S_OK;
 }
 
-static NXGI_SIZE 	__nxapi intrnl_get_char_size(NXGI_GRAPHICS_CONTEXT *gc, char c)
-{
-	NXGI_SIZE p = {SYS_FONT_WIDTH, SYS_FONT_HEIGHT};
-	UNUSED_ARG(c);
-
-	if (gc->font.size != 1) {
-		p = (NXGI_SIZE){0, 0};
-	}
-
-	return p;
-}
-
-
+/*
+ * Blends the font color through the glyph masks. Each mask row is clipped
+ * as a run, glyphs past the right edge of the clip rect end the text.
+ */
 HRESULT __nxapi graphics_draw_text_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT pos, char *text)
 {
-	NXGI_BITMAP *t = gc->target;
-	NXGI_RECT	bounds; //bounds rect
-	NXGI_SIZE	text_size;
-	uint32_t	len = strlen(text);
-	uint32_t	draw_cntr = 0;
-	uint32_t	i;
-	HRESULT		hr;
-
-	if (!t) {
+	NXGI_BITMAP			*t = gc->target;
+	NXGI_GLYPH_CACHE	*cache = gc->glyphs;
+	NXGI_RECT			clip = gc->clip_rect, r;
+	NXGI_GLYPH			*g;
+	const uint8_t		*mask;
+	uint8_t				*pdst, *s = (uint8_t*)text;
+	uint32_t			color;
+	int32_t				y, reach;
+
+	if (!t || !cache) {
 		return E_INVALIDSTATE;
 	}
 
-	/* Find text bounds rect */
-	hr = graphics_text_size(gc, text, &text_size);
-	if (FAILED(hr)) return hr;
-
-	bounds.p1 = pos;
-	bounds.p2 = (NXGI_POINT){pos.x + text_size.width, pos.y + text_size.height};
-
-	/* Clip bounds rect */
-	intrnl_transform_point(gc, &bounds.p1);
-	intrnl_transform_point(gc, &bounds.p2);
+	intrnl_apply_offset(gc, &pos);
 
-	/* If the whole text is clipped out, then do nothing */
-	if (bounds.p2.x - bounds.p1.x == 0 || bounds.p2.y - bounds.p1.y == 0) {
-		/* Fully clipped out */
+	/* Whole line above or below the clip rect */
+	if (pos.y >= clip.y2 || pos.y + (int32_t)cache->height <= clip.y1) {
 		return S_OK;
 	}
 
-	for (i=0; i<len; i++) {
-		NXGI_SIZE char_size = intrnl_get_char_size(gc, text[i]);
-		NXGI_RECT char_rect = RECT(pos.x, pos.y, pos.x + char_size.width, pos.y + char_size.height);
+	color = nxgi_span_scale(nxgi_span_premultiply(nxgi_span_color(gc->font.color)), gc->alpha);
 
-		/* Offset and clip char rect */
-		intrnl_transform_point(gc, &char_rect.p1);
-		intrnl_transform_point(gc, &char_rect.p2);
+	/* How far a glyph may reach from the pen */
+	reach = NXGI_FONT_MAX_GLYPH * 2 * cache->scale;
+
+	for (; *s && pos.x - reach < clip.x2; pos.x += cache->advance[*s], s++) {
+		/* Not visible yet */
+		if (pos.x + reach <= clip.x1) {
+			continue;
+		}
 
-		/* Clip test */
-		if (char_rect.p2.x - char_rect.p1.x >= char_size.width && char_rect.p2.y - char_rect.p1.y >= char_size.height) {
-			/* Visible */
-			intrnl_draw_char_bgra32(gc, char_rect.x1, char_rect.y1, &gc->font, text[i]);
+		if (!(g = nxgi_font_get_glyph(cache, *s))) {
+			return E_OUTOFMEM;
+		}
 
-			/* One more character.. Phuu */
-			draw_cntr++;
-		} else if (char_rect.p2.x - char_rect.p1.x > 0 && char_rect.p2.y - char_rect.p1.y > 0) {
-			/* Partially clipped */
-			intrnl_draw_char_segment_bgra32(gc, pos.x + gc->offset.x, pos.y + gc->offset.y, char_rect, &gc->font, text[i]);
+		r = RECT(pos.x + g->x, pos.y + g->y, pos.x + g->x + g->width, pos.y + g->y + g->height);
+		r = nxgig_rect_intersection(r, clip);
 
-			/* One more character.. Phuu */
-			draw_cntr++;
-		} else {
-			/* Clipped out */
-			if (draw_cntr > 0) {
-				/* If the current character is clipped, while the previous was visible,
-				 * this means we have left the clip rect, and none of the remaining
-				 * characters will be visible.
-				 */
-				break;
-			}
+		if (nxgig_rect_empty(r)) {
+			continue;
 		}
 
-		/* Move position */
-		pos.x += char_size.width;
+		pdst = (uint8_t*)t->pBits + r.y1 * t->stride + r.x1 * 4;
+		mask = g->mask + (r.y1 - pos.y - g->y) * g->width + (r.x1 - pos.x - g->x);
+
+		for (y=r.y1; y<r.y2; y++) {
+			nxgi_span_mask((uint32_t*)pdst, color, mask, RECT_WIDTH(r));
+
+			pdst += t->stride;
+			mask += g->width;
+		}
 	}
 
 	return S_OK;
@@ -16,6 +16,7 @@
  */
 HRESULT __nxapi graphics_create_context(NXGI_GRAPHICS_CONTEXT **ppGC);
 HRESULT __nxapi graphics_set_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP *pTarget);
+HRESULT __nxapi graphics_set_ops(NXGI_GRAPHICS_CONTEXT *gc);
 HRESULT __nxapi graphics_get_target(NXGI_GRAPHICS_CONTEXT *gc, NXGI_BITMAP **ppTarget);
 HRESULT __nxapi graphics_set_color(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COLOR color);
 HRESULT __nxapi graphics_get_color(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COLOR *pColor);
@@ -27,6 +28,7 @@ HRESULT __nxapi graphics_fill_rect_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT r
 HRESULT __nxapi graphics_bitblt_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
 HRESULT __nxapi graphics_stretchblt_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT dst_rect, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
 HRESULT __nxapi graphics_alphablend_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, NXGI_BITMAP *pSrcBitmap, NXGI_RECT src_rect);
+HRESULT __nxapi graphics_fill_mask_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT dst_pos, const uint8_t *mask, uint32_t mask_stride, NXGI_SIZE size);
 HRESULT __nxapi graphics_set_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT offset);
 HRESULT __nxapi graphics_get_offset(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT *pOffset);
 HRESULT __nxapi graphics_set_clip_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT clip_rect);
@@ -35,6 +37,10 @@ HRESULT __nxapi graphics_draw_text_bgra32(NXGI_GRAPHICS_CONTEXT *gc, NXGI_POINT
 HRESULT __nxapi graphics_text_size(NXGI_GRAPHICS_CONTEXT *gc, char *text, NXGI_SIZE *size_out);
 HRESULT __nxapi graphics_set_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT font_params);
 HRESULT __nxapi graphics_get_font(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FONT *font_params_out);
+HRESULT __nxapi graphics_set_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER filter);
+HRESULT __nxapi graphics_get_filter(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FILTER *filter_out);
+HRESULT __nxapi graphics_set_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE op, uint8_t alpha);
+HRESULT __nxapi graphics_get_composite(NXGI_GRAPHICS_CONTEXT *gc, NXGI_COMPOSITE *op_out, uint8_t *alpha_out);
 void 	__nxapi graphics_destroy_context(NXGI_GRAPHICS_CONTEXT *gc);
 
 //TODO
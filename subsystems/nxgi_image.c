@@ -0,0 +1,2540 @@
+/*
+ * nxgi_image.c
+ *
+ *	BMP and PNG decoders, with the inflate and unfilter stages of PNG.
+ *
+ *  Created on: 19.10.2026
+ *      Author: Anton Angelov
+ */
+#include <mm.h>
+#include <hal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_image.h"
+#include "nxgi_span.h"
+
+/* EFLAGS interrupt flag */
+#define EFLAGS_IF				0x200
+
+/* Size of the buffer files are read through */
+#define IMAGE_READ_BUFFER		4096
+
+/* Deflate history, and the bits of a code resolved by a single table lookup */
+#define INFLATE_WINDOW			32768
+#define INFLATE_FAST_BITS		9
+#define INFLATE_MAX_BITS		15
+
+/* Zero bytes before each unfilter row, standing for the pixel left of the first, and slack after it */
+#define PNG_ROW_LEAD			8
+#define PNG_ROW_TAIL			16
+
+/* PNG chunk types */
+#define PNG_CHUNK(a, b, c, d)	(((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+#define PNG_IHDR				PNG_CHUNK('I', 'H', 'D', 'R')
+#define PNG_PLTE				PNG_CHUNK('P', 'L', 'T', 'E')
+#define PNG_IDAT				PNG_CHUNK('I', 'D', 'A', 'T')
+#define PNG_IEND				PNG_CHUNK('I', 'E', 'N', 'D')
+#define PNG_TRNS				PNG_CHUNK('t', 'R', 'N', 'S')
+
+/* Chunks with a lowercase first letter can be skipped */
+#define PNG_CHUNK_ANCILLARY(t)	((t) & 0x20000000)
+
+/* PNG color types */
+#define PNG_GRAY				0
+#define PNG_RGB					2
+#define PNG_PALETTE				3
+#define PNG_GRAY_ALPHA			4
+#define PNG_RGBA				6
+
+/* BMP compression methods */
+#define BMP_RGB					0
+#define BMP_RLE8				1
+#define BMP_RLE4				2
+#define BMP_BITFIELDS			3
+#define BMP_ALPHABITFIELDS		6
+
+/* Sizes of the BMP file header and of the OS/2 and Windows info headers */
+#define BMP_FILE_HEADER			14
+#define BMP_CORE_HEADER			12
+#define BMP_INFO_HEADER			40
+#define BMP_MAX_HEADER			124
+
+#define IMAGE_PIXEL(r, g, b, a)	((uint32_t)(b) | ((uint32_t)(g) << 8) | ((uint32_t)(r) << 16) | ((uint32_t)(a) << 24))
+
+/**
+ * Buffered reading of the source stream.
+ */
+typedef struct IMAGE_READER IMAGE_READER;
+struct IMAGE_READER {
+	K_STREAM	*s;
+	uint32_t	pos;
+	uint32_t	len;
+	uint8_t		buf[IMAGE_READ_BUFFER];
+};
+
+/**
+ * Gives the inflater the next run of compressed bytes. Returns S_FALSE when
+ * there are no more.
+ */
+typedef HRESULT (*INFLATE_FILL)(void *ctx, const uint8_t **in, const uint8_t **in_end);
+
+/**
+ * Canonical Huffman code. Codes of up to INFLATE_FAST_BITS bits are found
+ * in `fast`, indexed by the next input bits, as (symbol << 4) | length.
+ * Longer codes are decoded bit by bit from the counts of each length.
+ */
+typedef struct INFLATE_HUFFMAN INFLATE_HUFFMAN;
+struct INFLATE_HUFFMAN {
+	uint16_t	fast[1 << INFLATE_FAST_BITS];
+	uint16_t	count[INFLATE_MAX_BITS + 1];
+	uint16_t	symbol[288];
+};
+
+typedef enum {
+	INFLATE_BLOCK = 0,
+	INFLATE_STORED,
+	INFLATE_CODES,
+	INFLATE_DONE
+} INFLATE_STATE;
+
+/**
+ * Zlib stream decoder. Decompresses just as many bytes as asked for, so
+ * a PNG is inflated row by row, and carries the state of the current
+ * block over to the next call.
+ */
+typedef struct INFLATE INFLATE;
+struct INFLATE {
+	INFLATE_FILL	fill;
+	void			*ctx;
+	const uint8_t	*in;
+	const uint8_t	*in_end;
+	BOOL			in_done;
+
+	/* Bit buffer, next bit lowest */
+	uint32_t		bits;
+	uint32_t		nbits;
+
+	INFLATE_STATE	state;
+	BOOL			final;
+	uint32_t		stored_left;
+
+	/** Match not fully copied by the last call */
+	uint32_t		copy_len;
+	uint32_t		copy_dist;
+
+	/** Bytes produced, capped at the window size, and the next window position */
+	uint32_t		total;
+	uint32_t		wpos;
+
+	uint32_t		adler;
+
+	INFLATE_HUFFMAN	lit;
+	INFLATE_HUFFMAN	dist;
+	uint8_t			window[INFLATE_WINDOW];
+};
+
+typedef struct PNG_DECODER PNG_DECODER;
+struct PNG_DECODER {
+	IMAGE_READER	*r;
+
+	/* Current chunk and the CRC of it's type and data read so far */
+	uint32_t		chunk_len;
+	uint32_t		chunk_type;
+	uint32_t		crc;
+
+	/** Data left in the current IDAT, and whether the IDATs are over */
+	uint32_t		idat_left;
+	BOOL			idat_done;
+
+	uint32_t		width;
+	uint32_t		height;
+	uint8_t			depth;
+	uint8_t			color_type;
+	uint8_t			interlace;
+
+	/** Bits per pixel, and bytes per pixel rounded up, for filtering */
+	uint32_t		pixel_bits;
+	uint32_t		bpp;
+
+	uint32_t		palette[256];
+	uint8_t			palette_alpha[256];
+	uint32_t		palette_size;
+
+	/** tRNS color key, compared to the raw samples */
+	BOOL			has_key;
+	uint16_t		key[3];
+
+	INFLATE			z;
+};
+
+/**
+ * BMP channel of a bit field pixel.
+ */
+typedef struct BMP_CHANNEL BMP_CHANNEL;
+struct BMP_CHANNEL {
+	uint32_t	shift;
+	uint32_t	bits;
+};
+
+/**
+ * File in memory, read through a K_STREAM by nxgi_image_load_memory().
+ */
+typedef struct IMAGE_MEMORY IMAGE_MEMORY;
+struct IMAGE_MEMORY {
+	const uint8_t	*data;
+	uint32_t		size;
+};
+
+static const uint16_t inflate_length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t inflate_length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t inflate_dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t inflate_dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* Order code length code lengths are stored in */
+static const uint8_t inflate_clen_order[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/* Adam7 passes: first column and row, and the step between them */
+static const uint8_t png_adam7[7][4] = {
+	{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+	{ 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+
+static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+/* Constants of the SSE2 unfilter kernels */
+static const struct {
+	uint8_t	ones[16];
+} __attribute__((aligned(16))) png_k = {
+	{ 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 }
+};
+
+static uint32_t	image_crc_table[256];
+static BOOL		image_initialized = FALSE;
+
+/** Unfilter with SSE2 when it's available */
+static BOOL		image_vector = FALSE;
+
+static void image_initialize()
+{
+	uint32_t	i, j, c;
+
+	if (image_initialized) {
+		return;
+	}
+
+	for (i=0; i<256; i++) {
+		c = i;
+
+		for (j=0; j<8; j++) {
+			c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		}
+
+		image_crc_table[i] = c;
+	}
+
+	nxgi_span_initialize();
+	image_vector = nxgi_span_get_isa() != NXGI_SPAN_ISA_C;
+
+	image_initialized = TRUE;
+}
+
+static inline uint32_t image_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint32_t image_le32(const uint8_t *p)
+{
+	return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t image_le16(const uint8_t *p)
+{
+	return p[0] | ((uint32_t)p[1] << 8);
+}
+
+/* CRC-32 register update, the register starts at and is finished by inverting all bits */
+static uint32_t image_crc_update(uint32_t crc, const uint8_t *p, uint32_t size)
+{
+	while (size--) {
+		crc = image_crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+static uint32_t image_adler_update(uint32_t adler, const uint8_t *p, uint32_t size)
+{
+	uint32_t	a = adler & 0xFFFF, b = adler >> 16, n;
+
+	while (size > 0) {
+		/* Largest run which can't overflow b */
+		n = size < 5552 ? size : 5552;
+		size -= n;
+
+		while (n--) {
+			a += *p++;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return a | (b << 16);
+}
+
+/*
+ * Reader
+ */
+static HRESULT image_fill(IMAGE_READER *r)
+{
+	size_t	bytes = 0;
+	HRESULT	hr;
+
+	if (r->pos < r->len) {
+		return S_OK;
+	}
+
+	hr = k_fread(r->s, IMAGE_READ_BUFFER, r->buf, &bytes);
+	if (FAILED(hr) && hr != E_ENDOFSTR) {
+		return hr;
+	}
+
+	r->pos = 0;
+	r->len = bytes;
+
+	return bytes > 0 ? S_OK : E_ENDOFSTR;
+}
+
+static HRESULT image_read(IMAGE_READER *r, void *dst, uint32_t size)
+{
+	uint8_t		*d = dst;
+	uint32_t	n;
+	HRESULT		hr;
+
+	while (size > 0) {
+		hr = image_fill(r);
+		if (FAILED(hr)) return hr;
+
+		n = r->len - r->pos;
+		if (n > size) n = size;
+
+		memcpy(d, r->buf + r->pos, n);
+		r->pos += n;
+		d += n;
+		size -= n;
+	}
+
+	return S_OK;
+}
+
+static HRESULT image_skip(IMAGE_READER *r, uint32_t size)
+{
+	uint32_t	n;
+	HRESULT		hr;
+
+	while (size > 0) {
+		hr = image_fill(r);
+		if (FAILED(hr)) return hr;
+
+		n = r->len - r->pos;
+		if (n > size) n = size;
+
+		r->pos += n;
+		size -= n;
+	}
+
+	return S_OK;
+}
+
+static inline uint32_t *image_row(NXGI_BITMAP *bmp, uint32_t y)
+{
+	return (uint32_t*)((uint8_t*)bmp->pBits + y * bmp->stride);
+}
+
+/*
+ * Inflate
+ */
+static HRESULT inflate_build(INFLATE_HUFFMAN *h, const uint8_t *lengths, uint32_t n)
+{
+	uint16_t	offs[INFLATE_MAX_BITS + 1], next[INFLATE_MAX_BITS + 1];
+	uint32_t	sym, len, code, r, i, left;
+
+	memset(h->count, 0, sizeof(h->count));
+	memset(h->fast, 0, sizeof(h->fast));
+
+	for (sym=0; sym<n; sym++) {
+		h->count[lengths[sym]]++;
+	}
+
+	h->count[0] = 0;
+
+	/* Over-subscribed codes are broken. Incomplete ones fail when a missing code turns up. */
+	left = 1;
+	for (len=1; len<=INFLATE_MAX_BITS; len++) {
+		left <<= 1;
+		if (h->count[len] > left) return E_INVALIDDATA;
+		left -= h->count[len];
+	}
+
+	offs[1] = 0;
+	code = 0;
+	for (len=1; len<=INFLATE_MAX_BITS; len++) {
+		if (len < INFLATE_MAX_BITS) offs[len + 1] = offs[len] + h->count[len];
+
+		code = (code + h->count[len - 1]) << 1;
+		next[len] = code;
+	}
+
+	for (sym=0; sym<n; sym++) {
+		if ((len = lengths[sym]) == 0) {
+			continue;
+		}
+
+		h->symbol[offs[len]++] = sym;
+
+		/* Codes are sent most significant bit first, the table is indexed by them reversed */
+		code = next[len]++;
+		if (len <= INFLATE_FAST_BITS) {
+			for (r=0, i=0; i<len; i++) {
+				r = (r << 1) | ((code >> i) & 1);
+			}
+
+			for (; r<(1 << INFLATE_FAST_BITS); r+=1 << len) {
+				h->fast[r] = (sym << 4) | len;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+/* Gets at least `n` bits, up to 24, into the bit buffer */
+static HRESULT inflate_need(INFLATE *z, uint32_t n)
+{
+	HRESULT hr;
+
+	while (z->nbits < n) {
+		if (z->in == z->in_end) {
+			if (z->in_done) return E_ENDOFSTR;
+
+			hr = z->fill(z->ctx, &z->in, &z->in_end);
+			if (FAILED(hr)) return hr;
+
+			if (hr == S_FALSE) {
+				z->in_done = TRUE;
+				return E_ENDOFSTR;
+			}
+
+			continue;
+		}
+
+		z->bits |= (uint32_t)*z->in++ << z->nbits;
+		z->nbits += 8;
+	}
+
+	return S_OK;
+}
+
+/* Tops up the bit buffer as far as input is available */
+static HRESULT inflate_peek(INFLATE *z)
+{
+	HRESULT hr;
+
+	while (z->nbits <= 24) {
+		if (z->in == z->in_end) {
+			if (z->in_done) return S_OK;
+
+			hr = z->fill(z->ctx, &z->in, &z->in_end);
+			if (FAILED(hr)) return hr;
+
+			if (hr == S_FALSE) {
+				z->in_done = TRUE;
+				return S_OK;
+			}
+
+			continue;
+		}
+
+		z->bits |= (uint32_t)*z->in++ << z->nbits;
+		z->nbits += 8;
+	}
+
+	return S_OK;
+}
+
+static inline uint32_t inflate_take(INFLATE *z, uint32_t n)
+{
+	uint32_t v = z->bits & ((1 << n) - 1);
+
+	z->bits >>= n;
+	z->nbits -= n;
+
+	return v;
+}
+
+static HRESULT inflate_bits(INFLATE *z, uint32_t n, uint32_t *v)
+{
+	HRESULT hr;
+
+	hr = inflate_need(z, n);
+	if (FAILED(hr)) return hr;
+
+	*v = inflate_take(z, n);
+	return S_OK;
+}
+
+static inline HRESULT inflate_decode(INFLATE *z, const INFLATE_HUFFMAN *h, uint32_t *sym)
+{
+	uint32_t	e, len, code, first, index;
+	HRESULT		hr;
+
+	/* Two bytes make sure a whole code is in the buffer, near the end of a run it's topped up byte by byte */
+	if (z->nbits < INFLATE_MAX_BITS) {
+		if (z->in_end - z->in >= 2) {
+			z->bits |= ((uint32_t)z->in[0] | ((uint32_t)z->in[1] << 8)) << z->nbits;
+			z->in += 2;
+			z->nbits += 16;
+		} else {
+			hr = inflate_peek(z);
+			if (FAILED(hr)) return hr;
+		}
+	}
+
+	e = h->fast[z->bits & ((1 << INFLATE_FAST_BITS) - 1)];
+	if (e != 0 && (e & 15) <= z->nbits) {
+		inflate_take(z, e & 15);
+		*sym = e >> 4;
+		return S_OK;
+	}
+
+	/* Long code, one bit at a time */
+	code = first = index = 0;
+	for (len=1; len<=INFLATE_MAX_BITS; len++) {
+		hr = inflate_need(z, 1);
+		if (FAILED(hr)) return hr;
+
+		code |= inflate_take(z, 1);
+
+		if (code < first + h->count[len]) {
+			*sym = h->symbol[index + code - first];
+			return S_OK;
+		}
+
+		index += h->count[len];
+		first = (first + h->count[len]) << 1;
+		code <<= 1;
+	}
+
+	return E_INVALIDDATA;
+}
+
+static HRESULT inflate_fixed(INFLATE *z)
+{
+	uint8_t		lengths[288];
+	HRESULT		hr;
+
+	memset(lengths, 8, 144);
+	memset(lengths + 144, 9, 112);
+	memset(lengths + 256, 7, 24);
+	memset(lengths + 280, 8, 8);
+
+	hr = inflate_build(&z->lit, lengths, 288);
+	if (FAILED(hr)) return hr;
+
+	memset(lengths, 5, 30);
+	return inflate_build(&z->dist, lengths, 30);
+}
+
+static HRESULT inflate_dynamic(INFLATE *z)
+{
+	uint8_t		lengths[286 + 30];
+	uint32_t	hlit, hdist, hclen, i, sym, rep, v;
+	uint8_t		fill;
+	HRESULT		hr;
+
+	hr = inflate_bits(z, 5, &hlit);
+	if (FAILED(hr)) return hr;
+	hr = inflate_bits(z, 5, &hdist);
+	if (FAILED(hr)) return hr;
+	hr = inflate_bits(z, 4, &hclen);
+	if (FAILED(hr)) return hr;
+
+	hlit += 257;
+	hdist += 1;
+	hclen += 4;
+
+	if (hlit > 286 || hdist > 30) {
+		return E_INVALIDDATA;
+	}
+
+	/* Code length code, built into the distance table until the real one comes */
+	memset(lengths, 0, 19);
+	for (i=0; i<hclen; i++) {
+		hr = inflate_bits(z, 3, &v);
+		if (FAILED(hr)) return hr;
+		lengths[inflate_clen_order[i]] = v;
+	}
+
+	hr = inflate_build(&z->dist, lengths, 19);
+	if (FAILED(hr)) return hr;
+
+	for (i=0; i<hlit + hdist; ) {
+		hr = inflate_decode(z, &z->dist, &sym);
+		if (FAILED(hr)) return hr;
+
+		if (sym < 16) {
+			lengths[i++] = sym;
+			continue;
+		}
+
+		if (sym == 16) {
+			if (i == 0) return E_INVALIDDATA;
+			fill = lengths[i - 1];
+			hr = inflate_bits(z, 2, &rep);
+			rep += 3;
+		} else if (sym == 17) {
+			fill = 0;
+			hr = inflate_bits(z, 3, &rep);
+			rep += 3;
+		} else {
+			fill = 0;
+			hr = inflate_bits(z, 7, &rep);
+			rep += 11;
+		}
+
+		if (FAILED(hr)) return hr;
+
+		if (i + rep > hlit + hdist) {
+			return E_INVALIDDATA;
+		}
+
+		while (rep--) {
+			lengths[i++] = fill;
+		}
+	}
+
+	/* A block without an end code can't end */
+	if (lengths[256] == 0) {
+		return E_INVALIDDATA;
+	}
+
+	hr = inflate_build(&z->lit, lengths, hlit);
+	if (FAILED(hr)) return hr;
+
+	return inflate_build(&z->dist, lengths + hlit, hdist);
+}
+
+static HRESULT inflate_block(INFLATE *z)
+{
+	uint32_t	v, len, nlen;
+	HRESULT		hr;
+
+	if (z->final) {
+		z->state = INFLATE_DONE;
+		return S_OK;
+	}
+
+	hr = inflate_bits(z, 3, &v);
+	if (FAILED(hr)) return hr;
+
+	z->final = v & 1;
+
+	switch (v >> 1) {
+	case 0:
+		/* Stored, from the next byte boundary */
+		inflate_take(z, z->nbits & 7);
+
+		hr = inflate_bits(z, 16, &len);
+		if (FAILED(hr)) return hr;
+		hr = inflate_bits(z, 16, &nlen);
+		if (FAILED(hr)) return hr;
+
+		if (len != (~nlen & 0xFFFF)) {
+			return E_INVALIDDATA;
+		}
+
+		z->stored_left = len;
+		z->state = INFLATE_STORED;
+		return S_OK;
+
+	case 1:
+		hr = inflate_fixed(z);
+		break;
+
+	case 2:
+		hr = inflate_dynamic(z);
+		break;
+
+	default:
+		return E_INVALIDDATA;
+	}
+
+	if (SUCCEEDED(hr)) {
+		z->state = INFLATE_CODES;
+	}
+
+	return hr;
+}
+
+static HRESULT inflate_init(INFLATE *z, INFLATE_FILL fill, void *ctx)
+{
+	uint32_t	cmf, flg;
+	HRESULT		hr;
+
+	z->fill = fill;
+	z->ctx = ctx;
+	z->in = z->in_end = NULL;
+	z->in_done = FALSE;
+	z->bits = z->nbits = 0;
+	z->state = INFLATE_BLOCK;
+	z->final = FALSE;
+	z->copy_len = 0;
+	z->total = z->wpos = 0;
+	z->adler = 1;
+
+	hr = inflate_bits(z, 8, &cmf);
+	if (FAILED(hr)) return hr;
+	hr = inflate_bits(z, 8, &flg);
+	if (FAILED(hr)) return hr;
+
+	/* Deflate with at most a 32 KB window, no preset dictionary */
+	if ((cmf & 15) != 8 || (cmf >> 4) > 7 || (flg & 0x20) || ((cmf << 8) | flg) % 31 != 0) {
+		return E_INVALIDDATA;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Decompresses up to `size` bytes, less only at the end of the stream.
+ */
+static HRESULT inflate_run(INFLATE *z, uint8_t *out, uint32_t size, uint32_t *done_out)
+{
+	uint32_t	done = 0, n, sym, v, len, dist;
+	uint8_t		b;
+	HRESULT		hr = S_OK;
+
+	while (done < size && z->state != INFLATE_DONE) {
+		if (z->copy_len) {
+			n = size - done;
+			if (n > z->copy_len) n = z->copy_len;
+			z->copy_len -= n;
+
+			while (n--) {
+				b = z->window[(z->wpos - z->copy_dist) & (INFLATE_WINDOW - 1)];
+				z->window[z->wpos++ & (INFLATE_WINDOW - 1)] = b;
+				out[done++] = b;
+			}
+
+			continue;
+		}
+
+		switch (z->state) {
+		case INFLATE_BLOCK:
+			hr = inflate_block(z);
+			break;
+
+		case INFLATE_STORED:
+			if (z->stored_left == 0) {
+				z->state = INFLATE_BLOCK;
+				break;
+			}
+
+			/* Whole bytes left in the bit buffer come first */
+			if (z->nbits >= 8) {
+				b = inflate_take(z, 8);
+			} else {
+				if (z->in == z->in_end) {
+					hr = inflate_need(z, 8);
+					if (FAILED(hr)) break;
+					continue;
+				}
+
+				n = z->in_end - z->in;
+				if (n > z->stored_left) n = z->stored_left;
+				if (n > size - done) n = size - done;
+
+				z->stored_left -= n;
+
+				while (n--) {
+					b = *z->in++;
+					z->window[z->wpos++ & (INFLATE_WINDOW - 1)] = b;
+					out[done++] = b;
+				}
+
+				break;
+			}
+
+			z->stored_left--;
+			z->window[z->wpos++ & (INFLATE_WINDOW - 1)] = b;
+			out[done++] = b;
+			break;
+
+		case INFLATE_CODES:
+			hr = inflate_decode(z, &z->lit, &sym);
+			if (FAILED(hr)) break;
+
+			if (sym < 256) {
+				z->window[z->wpos++ & (INFLATE_WINDOW - 1)] = sym;
+				out[done++] = sym;
+				break;
+			}
+
+			if (sym == 256) {
+				z->state = INFLATE_BLOCK;
+				break;
+			}
+
+			if ((sym -= 257) >= 29) {
+				hr = E_INVALIDDATA;
+				break;
+			}
+
+			hr = inflate_bits(z, inflate_length_extra[sym], &v);
+			if (FAILED(hr)) break;
+			len = inflate_length_base[sym] + v;
+
+			hr = inflate_decode(z, &z->dist, &sym);
+			if (FAILED(hr)) break;
+
+			if (sym >= 30) {
+				hr = E_INVALIDDATA;
+				break;
+			}
+
+			hr = inflate_bits(z, inflate_dist_extra[sym], &v);
+			if (FAILED(hr)) break;
+			dist = inflate_dist_base[sym] + v;
+
+			/* Can't reach back before the start */
+			if (dist > z->total + done) {
+				hr = E_INVALIDDATA;
+				break;
+			}
+
+			z->copy_len = len;
+			z->copy_dist = dist;
+			break;
+
+		default:
+			break;
+		}
+
+		if (FAILED(hr)) {
+			break;
+		}
+	}
+
+	z->total += done;
+	if (z->total > INFLATE_WINDOW) z->total = INFLATE_WINDOW;
+
+	z->adler = image_adler_update(z->adler, out, done);
+	*done_out = done;
+
+	return hr;
+}
+
+/*
+ * Decompresses exactly `size` bytes.
+ */
+static HRESULT inflate_read(INFLATE *z, uint8_t *out, uint32_t size)
+{
+	uint32_t	done;
+	HRESULT		hr;
+
+	hr = inflate_run(z, out, size, &done);
+	if (FAILED(hr)) return hr;
+
+	return done == size ? S_OK : E_ENDOFSTR;
+}
+
+/*
+ * Runs the stream to it's end, dropping any data past what was read, and
+ * checks the Adler-32 trailer.
+ */
+static HRESULT inflate_finish(INFLATE *z)
+{
+	uint8_t		scratch[256];
+	uint32_t	done, v, i, adler = 0;
+	HRESULT		hr;
+
+	while (z->state != INFLATE_DONE) {
+		hr = inflate_run(z, scratch, sizeof(scratch), &done);
+		if (FAILED(hr)) return hr;
+	}
+
+	inflate_take(z, z->nbits & 7);
+
+	for (i=0; i<4; i++) {
+		hr = inflate_bits(z, 8, &v);
+		if (FAILED(hr)) return hr;
+		adler = (adler << 8) | v;
+	}
+
+	return adler == z->adler ? S_OK : E_INVALIDDATA;
+}
+
+/*
+ * PNG
+ */
+static HRESULT png_chunk_begin(PNG_DECODER *p)
+{
+	uint8_t	hdr[8];
+	HRESULT	hr;
+
+	hr = image_read(p->r, hdr, 8);
+	if (FAILED(hr)) return hr;
+
+	p->chunk_len = image_be32(hdr);
+	p->chunk_type = image_be32(hdr + 4);
+	p->crc = image_crc_update(0xFFFFFFFF, hdr + 4, 4);
+
+	return p->chunk_len > 0x7FFFFFFF ? E_INVALIDDATA : S_OK;
+}
+
+static HRESULT png_chunk_read(PNG_DECODER *p, void *dst, uint32_t size)
+{
+	HRESULT hr;
+
+	hr = image_read(p->r, dst, size);
+	if (FAILED(hr)) return hr;
+
+	p->crc = image_crc_update(p->crc, dst, size);
+	return S_OK;
+}
+
+static HRESULT png_chunk_end(PNG_DECODER *p)
+{
+	uint8_t	crc[4];
+	HRESULT	hr;
+
+	hr = image_read(p->r, crc, 4);
+	if (FAILED(hr)) return hr;
+
+	return image_be32(crc) == (p->crc ^ 0xFFFFFFFF) ? S_OK : E_INVALIDDATA;
+}
+
+/* Passes over the rest of the chunk, still checking it's CRC */
+static HRESULT png_chunk_skip(PNG_DECODER *p, uint32_t size)
+{
+	IMAGE_READER	*r = p->r;
+	uint32_t		n;
+	HRESULT			hr;
+
+	while (size > 0) {
+		hr = image_fill(r);
+		if (FAILED(hr)) return hr;
+
+		n = r->len - r->pos;
+		if (n > size) n = size;
+
+		p->crc = image_crc_update(p->crc, r->buf + r->pos, n);
+		r->pos += n;
+		size -= n;
+	}
+
+	return png_chunk_end(p);
+}
+
+/*
+ * Hands the inflater IDAT data straight out of the read buffer, moving on
+ * through consecutive IDATs.
+ */
+static HRESULT png_idat_fill(void *ctx, const uint8_t **in, const uint8_t **in_end)
+{
+	PNG_DECODER		*p = ctx;
+	IMAGE_READER	*r = p->r;
+	uint32_t		n;
+	HRESULT			hr;
+
+	while (p->idat_left == 0) {
+		if (p->idat_done) return S_FALSE;
+
+		hr = png_chunk_end(p);
+		if (FAILED(hr)) return hr;
+		hr = png_chunk_begin(p);
+		if (FAILED(hr)) return hr;
+
+		if (p->chunk_type != PNG_IDAT) {
+			p->idat_done = TRUE;
+			return S_FALSE;
+		}
+
+		p->idat_left = p->chunk_len;
+	}
+
+	hr = image_fill(r);
+	if (FAILED(hr)) return hr;
+
+	n = r->len - r->pos;
+	if (n > p->idat_left) n = p->idat_left;
+
+	*in = r->buf + r->pos;
+	*in_end = *in + n;
+
+	p->crc = image_crc_update(p->crc, *in, n);
+	r->pos += n;
+	p->idat_left -= n;
+
+	return S_OK;
+}
+
+static HRESULT png_read_header(PNG_DECODER *p)
+{
+	uint8_t		h[13];
+	uint32_t	channels;
+	HRESULT		hr;
+
+	hr = png_chunk_begin(p);
+	if (FAILED(hr)) return hr;
+
+	if (p->chunk_type != PNG_IHDR || p->chunk_len != 13) {
+		return E_INVALIDDATA;
+	}
+
+	hr = png_chunk_read(p, h, 13);
+	if (FAILED(hr)) return hr;
+	hr = png_chunk_end(p);
+	if (FAILED(hr)) return hr;
+
+	p->width = image_be32(h);
+	p->height = image_be32(h + 4);
+	p->depth = h[8];
+	p->color_type = h[9];
+	p->interlace = h[12];
+
+	if (p->width == 0 || p->height == 0 || h[10] != 0 || h[11] != 0 || p->interlace > 1) {
+		return E_INVALIDDATA;
+	}
+
+	switch (p->color_type) {
+	case PNG_GRAY:
+		channels = 1;
+		if (p->depth != 1 && p->depth != 2 && p->depth != 4 && p->depth != 8 && p->depth != 16) return E_INVALIDDATA;
+		break;
+
+	case PNG_PALETTE:
+		channels = 1;
+		if (p->depth != 1 && p->depth != 2 && p->depth != 4 && p->depth != 8) return E_INVALIDDATA;
+		break;
+
+	case PNG_RGB:
+	case PNG_GRAY_ALPHA:
+	case PNG_RGBA:
+		channels = p->color_type == PNG_RGB ? 3 : p->color_type == PNG_RGBA ? 4 : 2;
+		if (p->depth != 8 && p->depth != 16) return E_INVALIDDATA;
+		break;
+
+	default:
+		return E_INVALIDDATA;
+	}
+
+	if (p->width > NXGI_IMAGE_MAX_SIZE || p->height > NXGI_IMAGE_MAX_SIZE) {
+		return E_NOTSUPPORTED;
+	}
+
+	p->pixel_bits = channels * p->depth;
+	p->bpp = (p->pixel_bits + 7) / 8;
+
+	return S_OK;
+}
+
+static HRESULT png_read_palette(PNG_DECODER *p)
+{
+	uint8_t		rgb[3];
+	uint32_t	i;
+	HRESULT		hr;
+
+	if (p->chunk_len % 3 != 0 || p->chunk_len > 3 * 256 || p->chunk_len == 0) {
+		return E_INVALIDDATA;
+	}
+
+	/* Only a suggestion for true color images */
+	if (p->color_type != PNG_PALETTE) {
+		return png_chunk_skip(p, p->chunk_len);
+	}
+
+	p->palette_size = p->chunk_len / 3;
+
+	if (p->palette_size > (1u << p->depth)) {
+		return E_INVALIDDATA;
+	}
+
+	for (i=0; i<p->palette_size; i++) {
+		hr = png_chunk_read(p, rgb, 3);
+		if (FAILED(hr)) return hr;
+		p->palette[i] = IMAGE_PIXEL(rgb[0], rgb[1], rgb[2], 0);
+	}
+
+	return png_chunk_end(p);
+}
+
+static HRESULT png_read_transparency(PNG_DECODER *p)
+{
+	uint8_t		key[6];
+	uint32_t	i;
+	HRESULT		hr;
+
+	switch (p->color_type) {
+	case PNG_PALETTE:
+		if (p->chunk_len > 256) return E_INVALIDDATA;
+		hr = png_chunk_read(p, p->palette_alpha, p->chunk_len);
+		if (FAILED(hr)) return hr;
+		break;
+
+	case PNG_GRAY:
+	case PNG_RGB:
+		if (p->chunk_len != (p->color_type == PNG_GRAY ? 2u : 6u)) return E_INVALIDDATA;
+		hr = png_chunk_read(p, key, p->chunk_len);
+		if (FAILED(hr)) return hr;
+
+		for (i=0; i<p->chunk_len / 2; i++) {
+			p->key[i] = (key[2 * i] << 8) | key[2 * i + 1];
+		}
+
+		p->has_key = TRUE;
+		break;
+
+	default:
+		/* Images with an alpha channel can't have one */
+		return E_INVALIDDATA;
+	}
+
+	return png_chunk_end(p);
+}
+
+static void png_unfilter_c(uint32_t filter, uint8_t *row, const uint8_t *prev, uint32_t len, uint32_t bpp)
+{
+	uint32_t	i;
+	int32_t		a, b, c, pa, pb, pc;
+
+	switch (filter) {
+	case 1:
+		for (i=0; i<len; i++) row[i] += row[i - bpp];
+		break;
+
+	case 2:
+		for (i=0; i<len; i++) row[i] += prev[i];
+		break;
+
+	case 3:
+		for (i=0; i<len; i++) row[i] += (row[i - bpp] + prev[i]) >> 1;
+		break;
+
+	case 4:
+		for (i=0; i<len; i++) {
+			a = row[i - bpp];
+			b = prev[i];
+			c = prev[i - bpp];
+
+			pa = b - c;
+			pb = a - c;
+			pc = pa + pb;
+
+			if (pa < 0) pa = -pa;
+			if (pb < 0) pb = -pb;
+			if (pc < 0) pc = -pc;
+
+			row[i] += pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * Average of 4 byte pixels, one pixel per iteration since each depends on
+ * the one before. pavgb rounds up, the low bit of a ^ b takes it back down.
+ */
+static void __attribute__((target("sse2"))) png_unfilter_avg4_sse2(uint8_t *row, const uint8_t *prev, uint32_t n)
+{
+	asm volatile(
+			"pxor		%%xmm1, %%xmm1\n\t"
+			"movdqa		%[ones], %%xmm7\n\t"
+			"1:\n\t"
+			"movd		(%[p]), %%xmm2\n\t"
+			"movdqa		%%xmm1, %%xmm3\n\t"
+			"pavgb		%%xmm2, %%xmm3\n\t"
+			"pxor		%%xmm2, %%xmm1\n\t"
+			"pand		%%xmm7, %%xmm1\n\t"
+			"psubb		%%xmm1, %%xmm3\n\t"
+			"movd		(%[r]), %%xmm1\n\t"
+			"paddb		%%xmm3, %%xmm1\n\t"
+			"movd		%%xmm1, (%[r])\n\t"
+			"add		$4, %[r]\n\t"
+			"add		$4, %[p]\n\t"
+			"dec		%[n]\n\t"
+			"jnz		1b"
+			: [r] "+r" (row), [p] "+r" (prev), [n] "+r" (n)
+			: [ones] "m" (png_k.ones)
+			: "xmm1", "xmm2", "xmm3", "xmm7", "memory", "cc");
+}
+
+/*
+ * Same for 3 byte pixels. Loads take 4 bytes, the extra one is the next
+ * pixel's or row padding and isn't stored.
+ */
+static void __attribute__((target("sse2"))) png_unfilter_avg3_sse2(uint8_t *row, const uint8_t *prev, uint32_t n)
+{
+	asm volatile(
+			"pxor		%%xmm1, %%xmm1\n\t"
+			"movdqa		%[ones], %%xmm7\n\t"
+			"1:\n\t"
+			"movd		(%[p]), %%xmm2\n\t"
+			"movdqa		%%xmm1, %%xmm3\n\t"
+			"pavgb		%%xmm2, %%xmm3\n\t"
+			"pxor		%%xmm2, %%xmm1\n\t"
+			"pand		%%xmm7, %%xmm1\n\t"
+			"psubb		%%xmm1, %%xmm3\n\t"
+			"movd		(%[r]), %%xmm1\n\t"
+			"paddb		%%xmm3, %%xmm1\n\t"
+			"movd		%%xmm1, %%eax\n\t"
+			"movw		%%ax, (%[r])\n\t"
+			"shrl		$16, %%eax\n\t"
+			"movb		%%al, 2(%[r])\n\t"
+			"add		$3, %[r]\n\t"
+			"add		$3, %[p]\n\t"
+			"dec		%[n]\n\t"
+			"jnz		1b"
+			: [r] "+r" (row), [p] "+r" (prev), [n] "+r" (n)
+			: [ones] "m" (png_k.ones)
+			: "eax", "xmm1", "xmm2", "xmm3", "xmm7", "memory", "cc");
+}
+
+/*
+ * Paeth predictor in 16-bit lanes, one pixel per iteration. With
+ * pa = |b - c|, pb = |a - c| and pc = |a + b - 2c| the predictor is a
+ * unless pa is greater than pb or pc, then b unless pb is greater than pc,
+ * and c otherwise, chosen with compare masks. xmm1 holds a, xmm3 c.
+ */
+#define PNG_PAETH_PREDICT \
+			"movd		(%[p]), %%xmm2\n\t" \
+			"pxor		%%xmm7, %%xmm7\n\t" \
+			"punpcklbw	%%xmm7, %%xmm2\n\t" \
+			"movdqa		%%xmm2, %%xmm4\n\t" \
+			"psubw		%%xmm3, %%xmm4\n\t" \
+			"movdqa		%%xmm1, %%xmm5\n\t" \
+			"psubw		%%xmm3, %%xmm5\n\t" \
+			"movdqa		%%xmm4, %%xmm6\n\t" \
+			"paddw		%%xmm5, %%xmm6\n\t" \
+			"pxor		%%xmm0, %%xmm0\n\t" \
+			"psubw		%%xmm4, %%xmm0\n\t" \
+			"pmaxsw		%%xmm0, %%xmm4\n\t" \
+			"pxor		%%xmm0, %%xmm0\n\t" \
+			"psubw		%%xmm5, %%xmm0\n\t" \
+			"pmaxsw		%%xmm0, %%xmm5\n\t" \
+			"pxor		%%xmm0, %%xmm0\n\t" \
+			"psubw		%%xmm6, %%xmm0\n\t" \
+			"pmaxsw		%%xmm0, %%xmm6\n\t" \
+			"movdqa		%%xmm5, %%xmm0\n\t" \
+			"pcmpgtw	%%xmm6, %%xmm0\n\t" \
+			"movdqa		%%xmm4, %%xmm7\n\t" \
+			"pcmpgtw	%%xmm6, %%xmm7\n\t" \
+			"pcmpgtw	%%xmm5, %%xmm4\n\t" \
+			"por		%%xmm7, %%xmm4\n\t" \
+			"movdqa		%%xmm2, %%xmm5\n\t" \
+			"pxor		%%xmm3, %%xmm5\n\t" \
+			"pand		%%xmm0, %%xmm5\n\t" \
+			"pxor		%%xmm2, %%xmm5\n\t" \
+			"pxor		%%xmm1, %%xmm5\n\t" \
+			"pand		%%xmm4, %%xmm5\n\t" \
+			"pxor		%%xmm1, %%xmm5\n\t" \
+			"packuswb	%%xmm5, %%xmm5\n\t" \
+			"movd		(%[r]), %%xmm0\n\t" \
+			"paddb		%%xmm5, %%xmm0\n\t"
+
+/* Next a from the result in xmm0, and b becomes c */
+#define PNG_PAETH_ADVANCE \
+			"pxor		%%xmm7, %%xmm7\n\t" \
+			"movdqa		%%xmm0, %%xmm1\n\t" \
+			"punpcklbw	%%xmm7, %%xmm1\n\t" \
+			"movdqa		%%xmm2, %%xmm3\n\t"
+
+static void __attribute__((target("sse2"))) png_unfilter_paeth4_sse2(uint8_t *row, const uint8_t *prev, uint32_t n)
+{
+	asm volatile(
+			"pxor		%%xmm1, %%xmm1\n\t"
+			"pxor		%%xmm3, %%xmm3\n\t"
+			"1:\n\t"
+			PNG_PAETH_PREDICT
+			"movd		%%xmm0, (%[r])\n\t"
+			PNG_PAETH_ADVANCE
+			"add		$4, %[r]\n\t"
+			"add		$4, %[p]\n\t"
+			"dec		%[n]\n\t"
+			"jnz		1b"
+			: [r] "+r" (row), [p] "+r" (prev), [n] "+r" (n)
+			:
+			: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+static void __attribute__((target("sse2"))) png_unfilter_paeth3_sse2(uint8_t *row, const uint8_t *prev, uint32_t n)
+{
+	asm volatile(
+			"pxor		%%xmm1, %%xmm1\n\t"
+			"pxor		%%xmm3, %%xmm3\n\t"
+			"1:\n\t"
+			PNG_PAETH_PREDICT
+			"movd		%%xmm0, %%eax\n\t"
+			"movw		%%ax, (%[r])\n\t"
+			"shrl		$16, %%eax\n\t"
+			"movb		%%al, 2(%[r])\n\t"
+			PNG_PAETH_ADVANCE
+			"add		$3, %[r]\n\t"
+			"add		$3, %[p]\n\t"
+			"dec		%[n]\n\t"
+			"jnz		1b"
+			: [r] "+r" (row), [p] "+r" (prev), [n] "+r" (n)
+			:
+			: "eax", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+}
+
+/*
+ * Undoes a row's filter. The PNG_ROW_LEAD bytes before `row` and `prev`
+ * are zero and at least 1 byte after them can be read. Average and Paeth
+ * of 3 and 4 byte pixels go to the SSE2 kernels, with interrupts disabled.
+ */
+static void png_unfilter(uint32_t filter, uint8_t *row, const uint8_t *prev, uint32_t len, uint32_t bpp)
+{
+	uint32_t	intf;
+
+	if (!image_vector || (filter != 3 && filter != 4) || (bpp != 3 && bpp != 4) || len < NXGI_SPAN_MIN_VECTOR * bpp) {
+		png_unfilter_c(filter, row, prev, len, bpp);
+		return;
+	}
+
+	intf = hal_get_eflags() & EFLAGS_IF;
+	hal_cli();
+
+	if (filter == 3) {
+		if (bpp == 4) png_unfilter_avg4_sse2(row, prev, len / 4);
+		else png_unfilter_avg3_sse2(row, prev, len / 3);
+	} else {
+		if (bpp == 4) png_unfilter_paeth4_sse2(row, prev, len / 4);
+		else png_unfilter_paeth3_sse2(row, prev, len / 3);
+	}
+
+	if (intf) hal_sti();
+}
+
+/*
+ * Turns `count` pixels of an unfiltered row into BGRA32, `step` pixels apart.
+ */
+static void png_expand_row(const PNG_DECODER *p, const uint8_t *src, uint32_t count, uint32_t *dst, uint32_t step)
+{
+	uint32_t	i, v, shift, mask, scale, a;
+
+	switch (p->color_type) {
+	case PNG_GRAY:
+		if (p->depth == 16) {
+			for (i=0; i<count; i++, src+=2, dst+=step) {
+				a = p->has_key && ((src[0] << 8) | src[1]) == p->key[0] ? 0 : 0xFF;
+				*dst = IMAGE_PIXEL(src[0], src[0], src[0], a);
+			}
+		} else {
+			mask = (1 << p->depth) - 1;
+			scale = 255 / mask;
+
+			for (i=0; i<count; i++, dst+=step) {
+				shift = 8 - p->depth - (i * p->depth & 7);
+				v = (src[i * p->depth >> 3] >> shift) & mask;
+				a = p->has_key && v == p->key[0] ? 0 : 0xFF;
+				*dst = IMAGE_PIXEL(v * scale, v * scale, v * scale, a);
+			}
+		}
+		break;
+
+	case PNG_PALETTE:
+		if (p->depth == 8) {
+			for (i=0; i<count; i++, dst+=step) {
+				*dst = p->palette[src[i]];
+			}
+		} else {
+			mask = (1 << p->depth) - 1;
+
+			for (i=0; i<count; i++, dst+=step) {
+				shift = 8 - p->depth - (i * p->depth & 7);
+				*dst = p->palette[(src[i * p->depth >> 3] >> shift) & mask];
+			}
+		}
+		break;
+
+	case PNG_RGB:
+		if (p->depth == 16) {
+			for (i=0; i<count; i++, src+=6, dst+=step) {
+				a = p->has_key && ((src[0] << 8) | src[1]) == p->key[0] && ((src[2] << 8) | src[3]) == p->key[1] &&
+						((src[4] << 8) | src[5]) == p->key[2] ? 0 : 0xFF;
+				*dst = IMAGE_PIXEL(src[0], src[2], src[4], a);
+			}
+		} else if (p->has_key) {
+			for (i=0; i<count; i++, src+=3, dst+=step) {
+				a = src[0] == p->key[0] && src[1] == p->key[1] && src[2] == p->key[2] ? 0 : 0xFF;
+				*dst = IMAGE_PIXEL(src[0], src[1], src[2], a);
+			}
+		} else {
+			for (i=0; i<count; i++, src+=3, dst+=step) {
+				*dst = IMAGE_PIXEL(src[0], src[1], src[2], 0xFF);
+			}
+		}
+		break;
+
+	case PNG_GRAY_ALPHA:
+		v = p->depth / 8;
+		for (i=0; i<count; i++, src+=2*v, dst+=step) {
+			*dst = IMAGE_PIXEL(src[0], src[0], src[0], src[v]);
+		}
+		break;
+
+	case PNG_RGBA:
+		v = p->depth / 8;
+		for (i=0; i<count; i++, src+=4*v, dst+=step) {
+			*dst = IMAGE_PIXEL(src[0], src[v], src[2 * v], src[3 * v]);
+		}
+		break;
+	}
+}
+
+/*
+ * Inflates, unfilters and expands the image row by row, pass by pass if
+ * it's interlaced.
+ */
+static HRESULT png_decode_rows(PNG_DECODER *p, NXGI_BITMAP *bmp)
+{
+	uint32_t	pass, passes, x0, y0, dx, dy, pw, ph, len, y, size;
+	uint8_t		*buf, *cur, *prev, *t, filter;
+	HRESULT		hr = S_OK;
+
+	size = PNG_ROW_LEAD + (p->width * p->pixel_bits + 7) / 8 + PNG_ROW_TAIL;
+
+	if (!(buf = kmalloc(2 * size))) {
+		return E_OUTOFMEM;
+	}
+
+	passes = p->interlace ? 7 : 1;
+
+	for (pass=0; pass<passes && SUCCEEDED(hr); pass++) {
+		if (p->interlace) {
+			x0 = png_adam7[pass][0];
+			y0 = png_adam7[pass][1];
+			dx = png_adam7[pass][2];
+			dy = png_adam7[pass][3];
+		} else {
+			x0 = y0 = 0;
+			dx = dy = 1;
+		}
+
+		/* Passes of small images can be empty, they don't even have filter bytes */
+		if (x0 >= p->width || y0 >= p->height) {
+			continue;
+		}
+
+		pw = (p->width - x0 + dx - 1) / dx;
+		ph = (p->height - y0 + dy - 1) / dy;
+		len = (pw * p->pixel_bits + 7) / 8;
+
+		/* The row above the first one is zero */
+		memset(buf, 0, 2 * size);
+		cur = buf + PNG_ROW_LEAD;
+		prev = buf + size + PNG_ROW_LEAD;
+
+		for (y=0; y<ph; y++) {
+			hr = inflate_read(&p->z, &filter, 1);
+			if (FAILED(hr)) break;
+			hr = inflate_read(&p->z, cur, len);
+			if (FAILED(hr)) break;
+
+			if (filter > 4) {
+				hr = E_INVALIDDATA;
+				break;
+			}
+
+			png_unfilter(filter, cur, prev, len, p->bpp);
+			png_expand_row(p, cur, pw, image_row(bmp, y0 + y * dy) + x0, dx);
+
+			t = cur;
+			cur = prev;
+			prev = t;
+		}
+	}
+
+	kfree(buf);
+	return hr;
+}
+
+static HRESULT png_decode(IMAGE_READER *r, NXGI_BITMAP **bmp_out)
+{
+	PNG_DECODER	*p;
+	NXGI_BITMAP	*bmp = NULL;
+	uint8_t		sig[6];
+	uint32_t	i;
+	const uint8_t *in, *in_end;
+	HRESULT		hr;
+
+	/* The first 2 bytes were taken by the format check */
+	hr = image_read(r, sig, 6);
+	if (FAILED(hr)) return hr;
+
+	if (memcmp(sig, png_signature + 2, 6) != 0) {
+		return E_NOTSUPPORTED;
+	}
+
+	if (!(p = kcalloc(sizeof(PNG_DECODER)))) {
+		return E_OUTOFMEM;
+	}
+
+	p->r = r;
+	memset(p->palette_alpha, 0xFF, sizeof(p->palette_alpha));
+
+	for (i=0; i<256; i++) {
+		p->palette[i] = IMAGE_PIXEL(0, 0, 0, 0);
+	}
+
+	hr = png_read_header(p);
+	if (FAILED(hr)) goto done;
+
+	/* Chunks up to the first IDAT */
+	for (;;) {
+		hr = png_chunk_begin(p);
+		if (FAILED(hr)) goto done;
+
+		if (p->chunk_type == PNG_IDAT) {
+			break;
+		}
+
+		switch (p->chunk_type) {
+		case PNG_PLTE:
+			hr = png_read_palette(p);
+			break;
+
+		case PNG_TRNS:
+			hr = png_read_transparency(p);
+			break;
+
+		case PNG_IHDR:
+		case PNG_IEND:
+			hr = E_INVALIDDATA;
+			break;
+
+		default:
+			hr = PNG_CHUNK_ANCILLARY(p->chunk_type) ? png_chunk_skip(p, p->chunk_len) : E_NOTSUPPORTED;
+			break;
+		}
+
+		if (FAILED(hr)) goto done;
+	}
+
+	if (p->color_type == PNG_PALETTE) {
+		if (p->palette_size == 0) {
+			hr = E_INVALIDDATA;
+			goto done;
+		}
+
+		for (i=0; i<p->palette_size; i++) {
+			p->palette[i] |= (uint32_t)p->palette_alpha[i] << 24;
+		}
+	}
+
+	p->idat_left = p->chunk_len;
+
+	hr = nxgi_create_bitmap(p->width, p->height, NXGI_FORMAT_BGRA32, &bmp);
+	if (FAILED(hr)) goto done;
+
+	hr = inflate_init(&p->z, png_idat_fill, p);
+	if (FAILED(hr)) goto done;
+	hr = png_decode_rows(p, bmp);
+	if (FAILED(hr)) goto done;
+	hr = inflate_finish(&p->z);
+	if (FAILED(hr)) goto done;
+
+	/* Reads the rest of the IDATs, so the last one's CRC gets checked */
+	while ((hr = png_idat_fill(p, &in, &in_end)) == S_OK);
+
+	if (SUCCEEDED(hr)) {
+		*bmp_out = bmp;
+		bmp = NULL;
+		hr = S_OK;
+	}
+
+done:
+	if (bmp) nxgi_destroy_bitmap(&bmp);
+	kfree(p);
+
+	return hr;
+}
+
+/*
+ * BMP
+ */
+static void bmp_channel_init(BMP_CHANNEL *c, uint32_t mask)
+{
+	c->shift = c->bits = 0;
+
+	if (mask == 0) {
+		return;
+	}
+
+	while (!((mask >> c->shift) & 1)) {
+		c->shift++;
+	}
+
+	while (c->shift + c->bits < 32 && ((mask >> (c->shift + c->bits)) & 1)) {
+		c->bits++;
+	}
+}
+
+/* Channel scaled to 8 bits, `none` if the mask is empty */
+static inline uint32_t bmp_channel_get(const BMP_CHANNEL *c, uint32_t pixel, uint32_t none)
+{
+	uint32_t v;
+
+	if (c->bits == 0) {
+		return none;
+	}
+
+	v = pixel >> c->shift;
+
+	if (c->bits >= 8) {
+		return (v >> (c->bits - 8)) & 0xFF;
+	}
+
+	v &= (1 << c->bits) - 1;
+	return v * 255 / ((1 << c->bits) - 1);
+}
+
+static HRESULT bmp_decode_rle(IMAGE_READER *r, NXGI_BITMAP *bmp, const uint32_t *palette, uint32_t bpp)
+{
+	uint8_t		b[2], data[128];
+	uint32_t	x = 0, y = 0, i, n, bytes, idx;
+	HRESULT		hr;
+
+	for (;;) {
+		hr = image_read(r, b, 2);
+		if (FAILED(hr)) return hr;
+
+		if (b[0] > 0) {
+			/* Run, for RLE4 of two alternating pixels */
+			for (i=0; i<b[0]; i++, x++) {
+				idx = bpp == 8 ? b[1] : i & 1 ? b[1] & 15 : b[1] >> 4;
+				if (x < bmp->width && y < bmp->height) image_row(bmp, bmp->height - 1 - y)[x] = palette[idx];
+			}
+
+			continue;
+		}
+
+		switch (b[1]) {
+		case 0:
+			x = 0;
+			y++;
+			break;
+
+		case 1:
+			return S_OK;
+
+		case 2:
+			hr = image_read(r, b, 2);
+			if (FAILED(hr)) return hr;
+			x += b[0];
+			y += b[1];
+			break;
+
+		default:
+			/* Literal pixels, padded to a word */
+			n = b[1];
+			bytes = bpp == 8 ? n : (n + 1) / 2;
+
+			hr = image_read(r, data, (bytes + 1) & ~1);
+			if (FAILED(hr)) return hr;
+
+			for (i=0; i<n; i++, x++) {
+				idx = bpp == 8 ? data[i] : i & 1 ? data[i / 2] & 15 : data[i / 2] >> 4;
+				if (x < bmp->width && y < bmp->height) image_row(bmp, bmp->height - 1 - y)[x] = palette[idx];
+			}
+			break;
+		}
+
+		/* Nothing more can be drawn */
+		if (y >= bmp->height) {
+			return S_OK;
+		}
+	}
+}
+
+static void bmp_expand_row(const uint8_t *src, uint32_t *dst, uint32_t width, uint32_t bpp, const uint32_t *palette,
+		const BMP_CHANNEL *ch, BOOL opaque)
+{
+	uint32_t	i, v, mask, shift;
+
+	switch (bpp) {
+	case 1:
+	case 4:
+	case 8:
+		mask = (1 << bpp) - 1;
+
+		for (i=0; i<width; i++) {
+			shift = 8 - bpp - (i * bpp & 7);
+			dst[i] = palette[(src[i * bpp >> 3] >> shift) & mask];
+		}
+		break;
+
+	case 16:
+		for (i=0; i<width; i++, src+=2) {
+			v = image_le16(src);
+			dst[i] = IMAGE_PIXEL(bmp_channel_get(&ch[0], v, 0), bmp_channel_get(&ch[1], v, 0),
+					bmp_channel_get(&ch[2], v, 0), bmp_channel_get(&ch[3], v, 0xFF));
+		}
+		break;
+
+	case 24:
+		for (i=0; i<width; i++, src+=3) {
+			dst[i] = IMAGE_PIXEL(src[2], src[1], src[0], 0xFF);
+		}
+		break;
+
+	case 32:
+		if (opaque) {
+			for (i=0; i<width; i++, src+=4) {
+				dst[i] = image_le32(src) | 0xFF000000;
+			}
+			break;
+		}
+
+		for (i=0; i<width; i++, src+=4) {
+			v = image_le32(src);
+			dst[i] = IMAGE_PIXEL(bmp_channel_get(&ch[0], v, 0), bmp_channel_get(&ch[1], v, 0),
+					bmp_channel_get(&ch[2], v, 0), bmp_channel_get(&ch[3], v, 0xFF));
+		}
+		break;
+	}
+}
+
+static HRESULT bmp_decode(IMAGE_READER *r, NXGI_BITMAP **bmp_out)
+{
+	NXGI_BITMAP	*bmp = NULL;
+	uint8_t		fh[BMP_FILE_HEADER - 2], h[BMP_MAX_HEADER], entry[4], *row = NULL;
+	uint32_t	palette[256], masks[4] = { 0 };
+	BMP_CHANNEL	ch[4];
+	uint32_t	hsize, offset, consumed, width, bpp, compression, colors = 0, entry_size, row_size, i, n;
+	int32_t		height;
+	BOOL		top_down, opaque;
+	HRESULT		hr;
+
+	/* The 'BM' signature was taken by the format check */
+	hr = image_read(r, fh, sizeof(fh));
+	if (FAILED(hr)) return hr;
+	hr = image_read(r, h, 4);
+	if (FAILED(hr)) return hr;
+
+	offset = image_le32(fh + 8);
+	hsize = image_le32(h);
+
+	if (hsize != BMP_CORE_HEADER && (hsize < BMP_INFO_HEADER || hsize > BMP_MAX_HEADER)) {
+		return E_NOTSUPPORTED;
+	}
+
+	hr = image_read(r, h + 4, hsize - 4);
+	if (FAILED(hr)) return hr;
+	consumed = BMP_FILE_HEADER + hsize;
+
+	if (hsize == BMP_CORE_HEADER) {
+		width = image_le16(h + 4);
+		height = (int16_t)image_le16(h + 6);
+		bpp = image_le16(h + 10);
+		compression = BMP_RGB;
+		entry_size = 3;
+
+		if (image_le16(h + 8) != 1) return E_INVALIDDATA;
+	} else {
+		width = image_le32(h + 4);
+		height = (int32_t)image_le32(h + 8);
+		bpp = image_le16(h + 14);
+		compression = image_le32(h + 16);
+		colors = image_le32(h + 32);
+		entry_size = 4;
+
+		if (image_le16(h + 12) != 1) return E_INVALIDDATA;
+
+		if (compression == BMP_BITFIELDS || compression == BMP_ALPHABITFIELDS) {
+			n = compression == BMP_BITFIELDS ? 3 : 4;
+
+			/* Masks follow the basic header, the later versions include them */
+			if (hsize == BMP_INFO_HEADER) {
+				hr = image_read(r, h + BMP_INFO_HEADER, 4 * n);
+				if (FAILED(hr)) return hr;
+				consumed += 4 * n;
+			} else if (hsize < BMP_INFO_HEADER + 4 * n) {
+				n = (hsize - BMP_INFO_HEADER) / 4;
+			} else if (hsize >= BMP_INFO_HEADER + 16) {
+				n = 4;
+			}
+
+			for (i=0; i<n; i++) {
+				masks[i] = image_le32(h + BMP_INFO_HEADER + 4 * i);
+			}
+		}
+	}
+
+	top_down = height < 0;
+	if (top_down) height = -height;
+
+	if (width == 0 || height == 0 || width > NXGI_IMAGE_MAX_SIZE || (uint32_t)height > NXGI_IMAGE_MAX_SIZE) {
+		return width == 0 || height == 0 ? E_INVALIDDATA : E_NOTSUPPORTED;
+	}
+
+	switch (compression) {
+	case BMP_RGB:
+		if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 16 && bpp != 24 && bpp != 32) return E_NOTSUPPORTED;
+		break;
+
+	case BMP_RLE8:
+	case BMP_RLE4:
+		if (bpp != (compression == BMP_RLE8 ? 8u : 4u) || top_down) return E_INVALIDDATA;
+		break;
+
+	case BMP_BITFIELDS:
+	case BMP_ALPHABITFIELDS:
+		if (bpp != 16 && bpp != 32) return E_INVALIDDATA;
+		break;
+
+	default:
+		return E_NOTSUPPORTED;
+	}
+
+	/* Defaults of uncompressed 16 and 32-bit pixels: 5:5:5 and 8:8:8, no alpha */
+	if (compression == BMP_RGB && bpp == 16) {
+		masks[0] = 0x7C00;
+		masks[1] = 0x03E0;
+		masks[2] = 0x001F;
+	}
+
+	opaque = compression == BMP_RGB && bpp == 32;
+
+	for (i=0; i<4; i++) {
+		bmp_channel_init(&ch[i], masks[i]);
+	}
+
+	/* Palette, opaque, with missing entries black */
+	for (i=0; i<256; i++) {
+		palette[i] = IMAGE_PIXEL(0, 0, 0, 0xFF);
+	}
+
+	if (bpp <= 8) {
+		if (colors == 0 || colors > (1u << bpp)) {
+			colors = 1 << bpp;
+		}
+
+		/* Writers of the OS/2 header, which has no color count, store shorter palettes too */
+		if (offset > consumed && colors > (offset - consumed) / entry_size) {
+			colors = (offset - consumed) / entry_size;
+		}
+
+		for (i=0; i<colors; i++) {
+			hr = image_read(r, entry, entry_size);
+			if (FAILED(hr)) return hr;
+			palette[i] = IMAGE_PIXEL(entry[2], entry[1], entry[0], 0xFF);
+		}
+
+		consumed += colors * entry_size;
+	}
+
+	if (offset < consumed) {
+		return E_INVALIDDATA;
+	}
+
+	hr = image_skip(r, offset - consumed);
+	if (FAILED(hr)) return hr;
+
+	hr = nxgi_create_bitmap(width, height, NXGI_FORMAT_BGRA32, &bmp);
+	if (FAILED(hr)) return hr;
+
+	if (compression == BMP_RLE8 || compression == BMP_RLE4) {
+		/* Pixels the file skips stay transparent */
+		memset(bmp->pBits, 0, bmp->stride * bmp->height);
+		hr = bmp_decode_rle(r, bmp, palette, bpp);
+	} else {
+		row_size = (width * bpp + 31) / 32 * 4;
+
+		if (!(row = kmalloc(row_size))) {
+			hr = E_OUTOFMEM;
+			goto done;
+		}
+
+		for (i=0; i<(uint32_t)height; i++) {
+			hr = image_read(r, row, row_size);
+			if (FAILED(hr)) break;
+			bmp_expand_row(row, image_row(bmp, top_down ? i : height - 1 - i), width, bpp, palette, ch, opaque);
+		}
+	}
+
+done:
+	if (row) kfree(row);
+
+	if (FAILED(hr)) {
+		nxgi_destroy_bitmap(&bmp);
+		return hr;
+	}
+
+	*bmp_out = bmp;
+	return S_OK;
+}
+
+/*
+ * Memory stream
+ */
+static HRESULT image_memory_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
+{
+	IMAGE_MEMORY	*m = str->priv_data;
+	uint32_t		n = m->size - str->pos;
+
+	if (n > block_size) n = block_size;
+
+	memcpy(out_buf, m->data + str->pos, n);
+	str->pos += n;
+	*bytes_read = n;
+
+	return S_OK;
+}
+
+/*
+ * Public interface
+ */
+HRESULT __nxapi nxgi_image_decode(K_STREAM *s, NXGI_BITMAP **bmp_out)
+{
+	IMAGE_READER	*r;
+	uint8_t			magic[2];
+	HRESULT			hr;
+
+	if (!s || !bmp_out) {
+		return E_POINTER;
+	}
+
+	image_initialize();
+
+	if (!(r = kmalloc(sizeof(IMAGE_READER)))) {
+		return E_OUTOFMEM;
+	}
+
+	r->s = s;
+	r->pos = r->len = 0;
+
+	hr = image_read(r, magic, 2);
+	if (SUCCEEDED(hr)) {
+		if (magic[0] == 'B' && magic[1] == 'M') {
+			hr = bmp_decode(r, bmp_out);
+		} else if (magic[0] == png_signature[0] && magic[1] == png_signature[1]) {
+			hr = png_decode(r, bmp_out);
+		} else {
+			hr = E_NOTSUPPORTED;
+		}
+	}
+
+	kfree(r);
+	return hr;
+}
+
+HRESULT __nxapi nxgi_image_load(char *path, NXGI_BITMAP **bmp_out)
+{
+	K_STREAM	*s;
+	HRESULT		hr;
+
+	hr = k_fopen(path, FILE_OPEN_READ, &s);
+	if (FAILED(hr)) return hr;
+
+	hr = nxgi_image_decode(s, bmp_out);
+	k_fclose(&s);
+
+	return hr;
+}
+
+HRESULT __nxapi nxgi_image_load_memory(const void *data, uint32_t size, NXGI_BITMAP **bmp_out)
+{
+	K_STREAM		s;
+	IMAGE_MEMORY	m;
+
+	if (!data) {
+		return E_POINTER;
+	}
+
+	m.data = data;
+	m.size = size;
+
+	memset(&s, 0, sizeof(s));
+	s.read = image_memory_read;
+	s.priv_data = &m;
+
+	return nxgi_image_decode(&s, bmp_out);
+}
+
+/*
+ * Benchmark
+ */
+#define IMAGE_BENCH_TIME		200
+#define IMAGE_BENCH_WIDTH		1024
+#define IMAGE_BENCH_HEIGHT		768
+
+/* Largest IDAT written by the bench encoder */
+#define IMAGE_BENCH_IDAT		8192
+
+/**
+ * Encoded file and the FNV-1a hash of it's pixels as BGRA32, or 0 if it
+ * must fail to decode.
+ */
+typedef struct IMAGE_FIXTURE IMAGE_FIXTURE;
+struct IMAGE_FIXTURE {
+	const char		*name;
+	const uint8_t	*data;
+	uint32_t		size;
+	uint32_t		hash;
+};
+
+#include "nxgi_image_fixtures.h"
+
+/**
+ * Bit writer of the bench encoder.
+ */
+typedef struct IMAGE_BENCH_WRITER IMAGE_BENCH_WRITER;
+struct IMAGE_BENCH_WRITER {
+	uint8_t		*buf;
+	uint32_t	size;
+	uint32_t	bits;
+	uint32_t	nbits;
+};
+
+typedef struct IMAGE_BENCH_CASE IMAGE_BENCH_CASE;
+struct IMAGE_BENCH_CASE {
+	const char	*name;
+	uint8_t		color_type;
+
+	/** Filter of every row, or 5 to cycle through all of them */
+	uint8_t		filter;
+};
+
+static const IMAGE_BENCH_CASE image_bench_cases[] = {
+	{ "RGBA Paeth", PNG_RGBA, 4 },
+	{ "RGBA Average", PNG_RGBA, 3 },
+	{ "RGB Paeth", PNG_RGB, 4 },
+	{ "RGB Average", PNG_RGB, 3 },
+	{ "RGBA mixed", PNG_RGBA, 5 }
+};
+
+static uint32_t image_bench_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 16;
+}
+
+static uint32_t image_bench_hash(const NXGI_BITMAP *bmp)
+{
+	const uint8_t	*p = bmp->pBits;
+	uint32_t		i, h = 2166136261u;
+
+	for (i=0; i<bmp->stride * bmp->height; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+static void image_bench_put(IMAGE_BENCH_WRITER *w, uint32_t v, uint32_t n)
+{
+	w->bits |= v << w->nbits;
+	w->nbits += n;
+
+	while (w->nbits >= 8) {
+		w->buf[w->size++] = w->bits;
+		w->bits >>= 8;
+		w->nbits -= 8;
+	}
+}
+
+/* Huffman codes go most significant bit first */
+static void image_bench_put_code(IMAGE_BENCH_WRITER *w, uint32_t code, uint32_t len)
+{
+	uint32_t i, r = 0;
+
+	for (i=0; i<len; i++) {
+		r = (r << 1) | ((code >> i) & 1);
+	}
+
+	image_bench_put(w, r, len);
+}
+
+static void image_bench_put_literal(IMAGE_BENCH_WRITER *w, uint32_t sym)
+{
+	if (sym < 144) image_bench_put_code(w, 0x30 + sym, 8);
+	else if (sym < 256) image_bench_put_code(w, 0x190 + sym - 144, 9);
+	else if (sym < 280) image_bench_put_code(w, sym - 256, 7);
+	else image_bench_put_code(w, 0xC0 + sym - 280, 8);
+}
+
+static void image_bench_put_match(IMAGE_BENCH_WRITER *w, uint32_t len, uint32_t dist)
+{
+	uint32_t i;
+
+	for (i=28; inflate_length_base[i] > len; i--);
+	image_bench_put_literal(w, 257 + i);
+	image_bench_put(w, len - inflate_length_base[i], inflate_length_extra[i]);
+
+	for (i=29; inflate_dist_base[i] > dist; i--);
+	image_bench_put_code(w, i, 5);
+	image_bench_put(w, dist - inflate_dist_base[i], inflate_dist_extra[i]);
+}
+
+/*
+ * Zlib stream of one fixed Huffman block. Matches are only looked for one
+ * pixel and one row back, which is where filtered images repeat.
+ */
+static void image_bench_deflate(IMAGE_BENCH_WRITER *w, const uint8_t *src, uint32_t size, uint32_t bpp, uint32_t stride)
+{
+	uint32_t	i, d, k, len, best, best_dist, max, adler;
+	uint32_t	dists[3] = { 1, bpp, stride };
+
+	w->buf[w->size++] = 0x78;
+	w->buf[w->size++] = 0x01;
+
+	image_bench_put(w, 3, 3);
+
+	for (i=0; i<size; ) {
+		best = best_dist = 0;
+		max = size - i < 258 ? size - i : 258;
+
+		for (k=0; k<3; k++) {
+			d = dists[k];
+			if (d > i) continue;
+
+			for (len=0; len<max && src[i + len] == src[i + len - d]; len++);
+
+			if (len > best) {
+				best = len;
+				best_dist = d;
+			}
+		}
+
+		if (best >= 3) {
+			image_bench_put_match(w, best, best_dist);
+			i += best;
+		} else {
+			image_bench_put_literal(w, src[i++]);
+		}
+	}
+
+	image_bench_put_literal(w, 256);
+	image_bench_put(w, 0, 7);
+
+	adler = image_adler_update(1, src, size);
+	for (k=0; k<4; k++) {
+		w->buf[w->size++] = adler >> (24 - 8 * k);
+	}
+}
+
+static uint8_t *image_bench_chunk(uint8_t *out, uint32_t type, const uint8_t *data, uint32_t size)
+{
+	uint32_t	crc, i;
+
+	for (i=0; i<4; i++) {
+		out[i] = size >> (24 - 8 * i);
+		out[4 + i] = type >> (24 - 8 * i);
+	}
+
+	memcpy(out + 8, data, size);
+	crc = image_crc_update(0xFFFFFFFF, out + 4, 4 + size) ^ 0xFFFFFFFF;
+
+	for (i=0; i<4; i++) {
+		out[8 + size + i] = crc >> (24 - 8 * i);
+	}
+
+	return out + 12 + size;
+}
+
+/*
+ * Encodes `pixels` as an 8-bit RGB or RGBA PNG, filtering rows with
+ * `filter`, or cycling through the filters if it's 5.
+ */
+static HRESULT image_bench_encode_png(const uint32_t *pixels, uint32_t width, uint32_t height, uint32_t color_type,
+		uint32_t filter, uint8_t **png_out, uint32_t *size_out)
+{
+	IMAGE_BENCH_WRITER	w;
+	uint8_t		*raw, *row, *orig, *png, *out, ihdr[13];
+	uint32_t	bpp = color_type == PNG_RGBA ? 4 : 3, stride = width * bpp, x, y, i, f, n;
+	int32_t		a, b, c, pa, pb, pc;
+
+	raw = kmalloc((stride + 1) * height);
+	orig = kcalloc(2 * (stride + PNG_ROW_LEAD));
+	w.buf = kmalloc((stride + 1) * height * 9 / 8 + 64);
+	png = kmalloc((stride + 1) * height * 9 / 8 + 64 + ((stride + 1) * height / IMAGE_BENCH_IDAT + 4) * 12 + 64);
+
+	if (!raw || !orig || !w.buf || !png) {
+		if (raw) kfree(raw);
+		if (orig) kfree(orig);
+		if (w.buf) kfree(w.buf);
+		if (png) kfree(png);
+		return E_OUTOFMEM;
+	}
+
+	/* orig holds the previous and current rows unfiltered, each after a zero pixel */
+	for (y=0; y<height; y++) {
+		uint8_t *prev = orig + (y & 1 ? 0 : stride + PNG_ROW_LEAD) + PNG_ROW_LEAD;
+		uint8_t *cur = orig + (y & 1 ? stride + PNG_ROW_LEAD : 0) + PNG_ROW_LEAD;
+
+		if (y == 0) memset(prev, 0, stride);
+
+		for (x=0; x<width; x++) {
+			cur[x * bpp] = pixels[y * width + x] >> 16;
+			cur[x * bpp + 1] = pixels[y * width + x] >> 8;
+			cur[x * bpp + 2] = pixels[y * width + x];
+			if (bpp == 4) cur[x * bpp + 3] = pixels[y * width + x] >> 24;
+		}
+
+		f = filter == 5 ? y % 5 : filter;
+		row = raw + y * (stride + 1);
+		row[0] = f;
+
+		for (i=0; i<stride; i++) {
+			a = cur[i - bpp];
+			b = prev[i];
+			c = prev[i - bpp];
+
+			switch (f) {
+			case 1: row[1 + i] = cur[i] - a; break;
+			case 2: row[1 + i] = cur[i] - b; break;
+			case 3: row[1 + i] = cur[i] - ((a + b) >> 1); break;
+
+			case 4:
+				pa = b - c;
+				pb = a - c;
+				pc = pa + pb;
+				if (pa < 0) pa = -pa;
+				if (pb < 0) pb = -pb;
+				if (pc < 0) pc = -pc;
+				row[1 + i] = cur[i] - (pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+				break;
+
+			default: row[1 + i] = cur[i]; break;
+			}
+		}
+	}
+
+	w.size = w.bits = w.nbits = 0;
+	image_bench_deflate(&w, raw, (stride + 1) * height, bpp, stride + 1);
+
+	memcpy(png, png_signature, 8);
+	out = png + 8;
+
+	for (i=0; i<4; i++) {
+		ihdr[i] = width >> (24 - 8 * i);
+		ihdr[4 + i] = height >> (24 - 8 * i);
+	}
+
+	ihdr[8] = 8;
+	ihdr[9] = color_type;
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+	out = image_bench_chunk(out, PNG_IHDR, ihdr, 13);
+
+	for (i=0; i<w.size; i+=n) {
+		n = w.size - i < IMAGE_BENCH_IDAT ? w.size - i : IMAGE_BENCH_IDAT;
+		out = image_bench_chunk(out, PNG_IDAT, w.buf + i, n);
+	}
+
+	out = image_bench_chunk(out, PNG_IEND, NULL, 0);
+
+	kfree(raw);
+	kfree(orig);
+	kfree(w.buf);
+
+	*png_out = png;
+	*size_out = out - png;
+
+	return S_OK;
+}
+
+/* Uncompressed 24-bit bottom-up BMP */
+static HRESULT image_bench_encode_bmp(const uint32_t *pixels, uint32_t width, uint32_t height, uint8_t **bmp_out, uint32_t *size_out)
+{
+	uint32_t	row_size = (width * 3 + 3) & ~3, size = 54 + row_size * height, x, y;
+	uint8_t		*bmp, *p;
+
+	if (!(bmp = kcalloc(size))) {
+		return E_OUTOFMEM;
+	}
+
+	bmp[0] = 'B';
+	bmp[1] = 'M';
+	*(uint32_t*)(bmp + 2) = size;
+	*(uint32_t*)(bmp + 10) = 54;
+	*(uint32_t*)(bmp + 14) = 40;
+	*(uint32_t*)(bmp + 18) = width;
+	*(uint32_t*)(bmp + 22) = height;
+	*(uint16_t*)(bmp + 26) = 1;
+	*(uint16_t*)(bmp + 28) = 24;
+
+	for (y=0; y<height; y++) {
+		p = bmp + 54 + (height - 1 - y) * row_size;
+
+		for (x=0; x<width; x++, p+=3) {
+			p[0] = pixels[y * width + x];
+			p[1] = pixels[y * width + x] >> 8;
+			p[2] = pixels[y * width + x] >> 16;
+		}
+	}
+
+	*bmp_out = bmp;
+	*size_out = size;
+
+	return S_OK;
+}
+
+/* Decoded megabytes of BGRA32 per second */
+static uint32_t image_bench_time(const uint8_t *data, uint32_t size)
+{
+	NXGI_BITMAP	*bmp;
+	uint32_t	start, elapsed, count = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		if (FAILED(nxgi_image_load_memory(data, size, &bmp))) {
+			return 0;
+		}
+
+		nxgi_destroy_bitmap(&bmp);
+
+		count++;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < IMAGE_BENCH_TIME);
+
+	return (uint32_t)udiv64((uint64_t)count * IMAGE_BENCH_WIDTH * IMAGE_BENCH_HEIGHT * 4, elapsed * 1000, NULL);
+}
+
+/* Unfiltered megabytes per second */
+static uint32_t image_bench_time_unfilter(uint8_t *row, const uint8_t *prev, uint32_t len, uint32_t filter, uint32_t bpp)
+{
+	uint32_t	start, elapsed, count = 0, i;
+
+	start = timer_gettickcount();
+
+	do {
+		for (i=0; i<64; i++) {
+			png_unfilter(filter, row, prev, len, bpp);
+		}
+
+		count += 64;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < IMAGE_BENCH_TIME);
+
+	return (uint32_t)udiv64((uint64_t)count * len, elapsed * 1000, NULL);
+}
+
+/* Decodes all fixtures, returns how many don't come out as expected */
+static uint32_t image_bench_fixtures()
+{
+	const IMAGE_FIXTURE	*fx;
+	NXGI_BITMAP			*bmp;
+	uint32_t			i, hash, failed = 0;
+	HRESULT				hr;
+
+	for (i=0; i<sizeof(image_fixtures) / sizeof(image_fixtures[0]); i++) {
+		fx = &image_fixtures[i];
+		hr = nxgi_image_load_memory(fx->data, fx->size, &bmp);
+
+		if (fx->hash == 0) {
+			if (SUCCEEDED(hr)) {
+				k_printf("%s: decoded, but the file is broken.\n", fx->name);
+				nxgi_destroy_bitmap(&bmp);
+				failed++;
+			}
+			continue;
+		}
+
+		if (FAILED(hr)) {
+			k_printf("%s: decoding failed (%x).\n", fx->name, hr);
+			failed++;
+			continue;
+		}
+
+		hash = image_bench_hash(bmp);
+		nxgi_destroy_bitmap(&bmp);
+
+		if (hash != fx->hash) {
+			k_printf("%s: image hash is %x, expected %x.\n", fx->name, hash, fx->hash);
+			failed++;
+		}
+	}
+
+	return failed;
+}
+
+/* Compares the SSE2 unfilter kernels with C on random rows of every length up to `max_len` */
+static BOOL image_bench_check_unfilter(uint8_t *buf, uint32_t max_len, uint32_t *seed)
+{
+	uint8_t		*row_c = buf + PNG_ROW_LEAD, *row_v = row_c + max_len + PNG_ROW_TAIL + PNG_ROW_LEAD;
+	uint8_t		*prev = row_v + max_len + PNG_ROW_TAIL + PNG_ROW_LEAD;
+	uint32_t	filter, bpp, len, i;
+
+	for (filter=3; filter<=4; filter++) {
+		for (bpp=3; bpp<=4; bpp++) {
+			for (len=bpp; len<=max_len; len+=bpp * 7) {
+				for (i=0; i<len; i++) {
+					row_c[i] = row_v[i] = image_bench_rand(seed);
+					prev[i] = image_bench_rand(seed);
+				}
+
+				image_vector = FALSE;
+				png_unfilter(filter, row_c, prev, len, bpp);
+				image_vector = TRUE;
+				png_unfilter(filter, row_v, prev, len, bpp);
+
+				if (memcmp(row_c, row_v, len) != 0) {
+					k_printf("SSE2 %s of %d byte pixels differs from C, %d bytes.\n", filter == 3 ? "Average" : "Paeth", bpp, len);
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+HRESULT __nxapi nxgi_image_benchmark()
+{
+	const IMAGE_BENCH_CASE	*bc;
+	NXGI_BITMAP		*bmp;
+	uint32_t		*pixels, seed = 12345, x, y, i, size, t_c, t_v, count;
+	uint8_t			*file, *buf;
+	BOOL			vector;
+	HRESULT			hr;
+
+	image_initialize();
+	vector = image_vector;
+
+	/* Fixtures, through both unfilter paths */
+	count = sizeof(image_fixtures) / sizeof(image_fixtures[0]);
+
+	image_vector = FALSE;
+	if (image_bench_fixtures() > 0) {
+		image_vector = vector;
+		return E_FAIL;
+	}
+
+	image_vector = vector;
+	if (vector && image_bench_fixtures() > 0) {
+		return E_FAIL;
+	}
+
+	k_printf("%d fixtures decode to their golden images or fail as expected%s.\n", count, vector ? ", with and without SSE2" : "");
+
+	pixels = kmalloc(IMAGE_BENCH_WIDTH * IMAGE_BENCH_HEIGHT * 4);
+	buf = kcalloc(3 * (IMAGE_BENCH_WIDTH * 4 + PNG_ROW_LEAD + PNG_ROW_TAIL));
+
+	if (!pixels || !buf) {
+		if (pixels) kfree(pixels);
+		if (buf) kfree(buf);
+		return E_OUTOFMEM;
+	}
+
+	if (vector) {
+		if (!image_bench_check_unfilter(buf, IMAGE_BENCH_WIDTH * 4, &seed)) {
+			image_vector = vector;
+			hr = E_FAIL;
+			goto done;
+		}
+
+		image_vector = vector;
+		k_printf("SSE2 unfilter kernels match C.\n");
+
+		/* Unfiltering alone, of a row of random bytes */
+		k_printf("Unfilter MB/s, C/SSE2:");
+
+		for (i=0; i<4; i++) {
+			uint8_t *row = buf + PNG_ROW_LEAD, *prev = row + 2 * (IMAGE_BENCH_WIDTH * 4 + PNG_ROW_LEAD + PNG_ROW_TAIL);
+			uint32_t bpp = i & 1 ? 3 : 4, filter = i < 2 ? 4 : 3, len = IMAGE_BENCH_WIDTH * bpp;
+
+			image_vector = FALSE;
+			t_c = image_bench_time_unfilter(row, prev, len, filter, bpp);
+			image_vector = TRUE;
+			t_v = image_bench_time_unfilter(row, prev, len, filter, bpp);
+
+			k_printf(" %s%d %d/%d", filter == 3 ? "avg" : "paeth", bpp, t_c, t_v);
+		}
+
+		k_printf("\n");
+	}
+
+	/* Smooth gradients with a little noise, and varying alpha */
+	for (y=0; y<IMAGE_BENCH_HEIGHT; y++) {
+		for (x=0; x<IMAGE_BENCH_WIDTH; x++) {
+			i = image_bench_rand(&seed) & 7;
+			pixels[y * IMAGE_BENCH_WIDTH + x] = IMAGE_PIXEL((x >> 2) + i, (y >> 2) + i, ((x + y) >> 3) + i, 255 - (x >> 3) - i);
+		}
+	}
+
+	hr = S_OK;
+
+	for (bc=image_bench_cases; bc<image_bench_cases + sizeof(image_bench_cases) / sizeof(image_bench_cases[0]); bc++) {
+		hr = image_bench_encode_png(pixels, IMAGE_BENCH_WIDTH, IMAGE_BENCH_HEIGHT, bc->color_type, bc->filter, &file, &size);
+		if (FAILED(hr)) goto done;
+
+		/* Round trip */
+		hr = nxgi_image_load_memory(file, size, &bmp);
+		if (SUCCEEDED(hr)) {
+			for (i=0; i<IMAGE_BENCH_WIDTH * IMAGE_BENCH_HEIGHT; i++) {
+				if (((uint32_t*)bmp->pBits)[i] != (bc->color_type == PNG_RGBA ? pixels[i] : pixels[i] | 0xFF000000)) {
+					break;
+				}
+			}
+
+			nxgi_destroy_bitmap(&bmp);
+			hr = i == IMAGE_BENCH_WIDTH * IMAGE_BENCH_HEIGHT ? S_OK : E_FAIL;
+		}
+
+		if (FAILED(hr)) {
+			k_printf("%s: decoded image differs from the encoded one.\n", bc->name);
+			kfree(file);
+			goto done;
+		}
+
+		image_vector = FALSE;
+		t_c = image_bench_time(file, size);
+		image_vector = vector;
+		t_v = vector ? image_bench_time(file, size) : t_c;
+
+		k_printf("%s %dx%d, %d KB: %d MB/s, %d MB/s with C unfilter\n", bc->name, IMAGE_BENCH_WIDTH, IMAGE_BENCH_HEIGHT,
+				size / 1024, t_v, t_c);
+
+		kfree(file);
+	}
+
+	hr = image_bench_encode_bmp(pixels, IMAGE_BENCH_WIDTH, IMAGE_BENCH_HEIGHT, &file, &size);
+	if (FAILED(hr)) goto done;
+
+	k_printf("BMP 24-bit %dx%d: %d MB/s\n", IMAGE_BENCH_WIDTH, IMAGE_BENCH_HEIGHT, image_bench_time(file, size));
+	kfree(file);
+
+done:
+	image_vector = vector;
+	kfree(pixels);
+	kfree(buf);
+
+	return hr;
+}
@@ -0,0 +1,59 @@
+/*
+ * nxgi_image.h
+ *
+ *	Image decoders.
+ *
+ *	BMP (1, 4, 8, 16, 24 and 32 bits per pixel, uncompressed, bit fields,
+ *	RLE4 and RLE8) and PNG (all color types and bit depths, palette and
+ *	tRNS transparency, Adam7 interlacing) are decoded into BGRA32 bitmaps.
+ *
+ *	Decoding streams: the file is read through a small buffer and every
+ *	row goes to the bitmap as soon as it's decoded, the file is never held
+ *	in memory as a whole. PNG data is inflated row by row by a decoder of
+ *	it's own, keeping just the 32 KB window. The Average and Paeth filters
+ *	of 3 and 4 byte pixels are undone with SSE2 when the CPU has it, running
+ *	with interrupts disabled like the span kernels.
+ *
+ *	Bitmaps have straight, not premultiplied, alpha. Pixels of RLE images
+ *	which the file skips are transparent. Gamma and color space chunks are
+ *	ignored. 16-bit samples are cut to their high byte.
+ *
+ *  Created on: 19.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_IMAGE_H_
+#define SUBSYSTEMS_NXGI_IMAGE_H_
+
+#include <types.h>
+#include <kstream.h>
+#include "nxgi.h"
+
+/* Largest width and height accepted */
+#define NXGI_IMAGE_MAX_SIZE		16384
+
+/**
+ * Decodes a BMP or PNG image from the stream's current position, telling
+ * them apart by their signature. Fails with E_NOTSUPPORTED for other
+ * formats, E_INVALIDDATA for broken files and E_ENDOFSTR for truncated
+ * ones.
+ */
+HRESULT		__nxapi nxgi_image_decode(K_STREAM *s, NXGI_BITMAP **bmp_out);
+
+/**
+ * Opens `path` and decodes it.
+ */
+HRESULT		__nxapi nxgi_image_load(char *path, NXGI_BITMAP **bmp_out);
+
+/**
+ * Same as nxgi_image_load(), but decodes a file already in memory.
+ */
+HRESULT		__nxapi nxgi_image_load_memory(const void *data, uint32_t size, NXGI_BITMAP **bmp_out);
+
+/**
+ * Decodes PngSuite-style fixtures and checks their pixels, with and
+ * without SSE2 unfiltering, and measures decoding throughput.
+ */
+HRESULT		__nxapi nxgi_image_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_IMAGE_H_ */
@@ -0,0 +1,884 @@
+/*
+ * nxgi_image_fixtures.h
+ *
+ *	PngSuite-style test images for nxgi_image_benchmark(), generated
+ *	independently of the decoders. Included by nxgi_image.c only.
+ *
+ *  Created on: 19.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_IMAGE_FIXTURES_H_
+#define SUBSYSTEMS_NXGI_IMAGE_FIXTURES_H_
+
+/*
+ * Fixtures, generated independently of the decoders. Names follow PngSuite:
+ * basn/basi = basic non-interlaced/interlaced, f = filter, tb = tRNS,
+ * z = deflate level, oi = split IDATs, x = broken. BMPs are bNN + kind.
+ */
+static const uint8_t image_fx_basn0g01[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x01,0x00,0x00,0x00,0x00,0xEC,0x74,0x83,0x26,0x00,0x00,0x00,0x18,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0x64,0x64,0x62,0x62,0x66,0x63,0xE1,0x60,0x90,0x67,0xB4,0x67,0x72,0x00,
+	0x00,0x02,0xA5,0x00,0xBD,0x9B,0xD1,0x35,0xE4,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,
+	0x82,
+};
+
+static const uint8_t image_fx_basn0g02[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x02,0x00,0x00,0x00,0x00,0xAB,0xD4,0xF9,0xF6,0x00,0x00,0x00,0x20,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x08,0x65,0x64,0x0C,0x65,0x62,0x61,0x61,0x16,0x36,0x66,0x71,0x70,0x60,0x08,
+	0x5B,0xCF,0x18,0x95,0xCA,0x24,0xE0,0x00,0x00,0x22,0xFF,0x03,0x9B,0x6D,0xE5,0x36,0x0B,0x00,0x00,0x00,
+	0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn0g04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x04,0x00,0x00,0x00,0x00,0x24,0x94,0x0C,0x56,0x00,0x00,0x00,0x2B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x54,0x76,0x4D,0x67,0x14,0x52,0x52,0x52,0x62,0x12,0x04,0x02,0x66,0x65,0x29,
+	0x29,0x29,0x16,0x10,0x8B,0x21,0xAC,0x62,0xD6,0x59,0xC6,0x74,0x25,0x63,0xA0,0x84,0x92,0xA0,0x20,0x00,
+	0x66,0xA8,0x05,0xB7,0x5C,0x3E,0x91,0x97,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x00,0x00,0x00,0x00,0xE1,0x64,0xE1,0x57,0x00,0x00,0x00,0x2D,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x10,0x54,0x32,0x76,0x09,0x4D,0x2B,0x67,0x14,0x12,0x84,0x00,0x26,0x21,0x28,
+	0x60,0x56,0x81,0x32,0x58,0x60,0x52,0x0C,0x51,0xD9,0x35,0xBD,0xF3,0xD6,0x1F,0xB8,0xC8,0x98,0x83,0xAE,
+	0x18,0x00,0x58,0xF1,0x0A,0x4D,0x69,0x45,0xA2,0xD2,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,
+	0x60,0x82,
+};
+
+static const uint8_t image_fx_basn0g16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x10,0x00,0x00,0x00,0x00,0xB1,0xF4,0x3D,0x14,0x00,0x00,0x00,0x42,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0x10,0x14,0x52,0x52,0x31,0x36,0x73,0xF1,0x08,0x8D,0x4A,0xCB,0x29,0xAF,
+	0x63,0x14,0x12,0x12,0x44,0x81,0x4C,0x42,0x68,0x80,0x59,0x45,0x05,0x55,0x80,0x05,0x5D,0x0B,0x43,0x54,
+	0x54,0x76,0x4E,0x4D,0x5D,0xEF,0x84,0x79,0x8B,0xD6,0x6F,0x39,0x70,0xEC,0xE2,0x0D,0xC6,0x9C,0x1C,0x02,
+	0x86,0x02,0x00,0x29,0x37,0x14,0xD9,0x7D,0xF7,0x66,0xA6,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,
+	0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x02,0x00,0x00,0x00,0x4B,0x6D,0x29,0xDC,0x00,0x00,0x00,0x64,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0xD0,0x08,0x10,0xF4,0x6A,0x56,0xCA,0xD9,0x66,0xDC,0xF7,0xD2,0x65,0x83,0x4C,
+	0xE8,0x25,0xFF,0xB4,0x2F,0x4D,0xE5,0x62,0x5B,0x19,0x85,0x9C,0x4B,0x04,0x95,0x8C,0x31,0x11,0x93,0x90,
+	0xB4,0x0A,0x56,0xC4,0xAC,0xE2,0x55,0x20,0x24,0xAF,0x83,0x89,0x58,0x80,0x92,0x82,0x20,0x64,0x2C,0x08,
+	0x65,0x40,0xB9,0x0C,0x51,0xEB,0x59,0xB2,0x2F,0x9A,0xD7,0x7C,0xCE,0xEA,0x15,0x9D,0x3B,0xCF,0xFC,0xC2,
+	0xFA,0x48,0xE6,0x03,0xD5,0x66,0x17,0xE7,0x66,0x32,0xE6,0x9C,0xD2,0x20,0xCD,0x72,0x00,0xD5,0xA8,0x28,
+	0x59,0xFE,0x17,0x90,0x7F,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn2c16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x10,0x02,0x00,0x00,0x00,0x1B,0xFD,0xF5,0x9F,0x00,0x00,0x00,0xB9,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0xD0,0xD0,0x08,0x08,0x10,0x14,0xF2,0xF2,0x6E,0x6E,0x51,0x52,0xC9,0xC9,
+	0xDB,0xB6,0xC3,0xD8,0xAC,0x6F,0xE2,0xCB,0x37,0x2E,0x1E,0x1B,0xB6,0xC8,0x28,0x84,0x46,0x5D,0xBA,0xEE,
+	0x1F,0x92,0x96,0xF3,0xE5,0x57,0x53,0x47,0x79,0x9D,0x98,0xEC,0xD6,0x3D,0x8C,0x42,0x42,0xCE,0xCE,0x25,
+	0x25,0x82,0x42,0x4A,0xCA,0xC6,0x26,0xC4,0x90,0x4C,0x42,0x42,0xD2,0xD2,0x2A,0x2A,0x08,0x52,0x55,0x05,
+	0x5D,0x04,0x55,0x96,0x59,0x45,0xC5,0xCB,0xAB,0xA0,0x40,0x48,0x48,0x5E,0x5E,0x47,0x07,0x44,0x6A,0xAF,
+	0x41,0xB0,0x31,0x49,0xED,0x35,0x2C,0x10,0xDD,0x82,0x70,0x12,0x64,0x35,0xAA,0x08,0xAA,0x2C,0x43,0x54,
+	0xD4,0xFA,0xF5,0x2C,0x2C,0xD9,0x39,0x17,0x2F,0x99,0x5B,0xD4,0xD4,0x7D,0xFE,0x9A,0x95,0xD3,0x3B,0x41,
+	0x54,0x62,0xEE,0x82,0x79,0x8B,0xCC,0xAD,0x2F,0x5C,0x59,0xBF,0x25,0x32,0x8E,0x99,0xE3,0xC0,0xB1,0xEA,
+	0x46,0x33,0x9B,0x8B,0x37,0xE6,0x2E,0xC9,0x2C,0x60,0xCC,0xC9,0x39,0x75,0x4A,0x43,0x83,0x02,0x4F,0x13,
+	0x22,0x01,0x86,0x21,0x52,0x7F,0x26,0x6C,0x0E,0xFB,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,
+	0x60,0x82,
+};
+
+static const uint8_t image_fx_basn4g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x04,0x00,0x00,0x00,0x6E,0x06,0x76,0x00,0x00,0x00,0x00,0x48,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0xD0,0x10,0xF4,0x52,0xCA,0x31,0xEE,0x73,0xD9,0x10,0x7A,0x29,0xED,0x4B,0xB9,
+	0x18,0xA3,0x90,0xB3,0xA0,0x12,0x32,0x64,0x12,0x92,0x46,0x85,0xCC,0x2A,0x5E,0x42,0xF2,0xC8,0x90,0x45,
+	0x48,0x5A,0x10,0x05,0x32,0x44,0xAD,0xCF,0xBE,0x58,0xF3,0xB9,0x57,0x74,0x9E,0xF9,0xFA,0xC8,0x03,0xD5,
+	0x17,0xE7,0x32,0xE6,0x9C,0x22,0x60,0x28,0x00,0xCA,0x26,0x19,0x09,0xE6,0xE3,0x17,0x30,0x00,0x00,0x00,
+	0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn4g16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x10,0x04,0x00,0x00,0x00,0x3E,0x96,0xAA,0x43,0x00,0x00,0x00,0x77,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0xD0,0xD0,0x10,0x14,0xF2,0xF2,0x56,0x52,0xC9,0xC9,0x33,0x36,0xEB,0x9B,
+	0xE8,0xE2,0xB1,0x61,0x4B,0x68,0xD4,0xA5,0xEB,0x69,0x39,0x5F,0x7E,0x95,0xD7,0x89,0xC9,0x32,0x0A,0x09,
+	0x39,0x3B,0x0B,0x0A,0x29,0x29,0xE3,0xC2,0x4C,0x42,0x42,0xD2,0xD2,0xF8,0x30,0xB3,0x8A,0x8A,0x97,0x97,
+	0x90,0x90,0xBC,0x3C,0x2E,0xCC,0x02,0x52,0x25,0x88,0x07,0x33,0x44,0x45,0xAD,0x5F,0x9F,0x9D,0x73,0xF1,
+	0x52,0x4D,0xDD,0xE7,0xAF,0xBD,0x13,0x44,0x25,0xE6,0x2D,0x32,0xB7,0x5E,0xBF,0x25,0x32,0xEE,0xC0,0xB1,
+	0xEA,0xC6,0x8B,0x37,0xE6,0x2E,0x61,0xCC,0xC9,0x39,0x75,0x8A,0x22,0x47,0x02,0x00,0xAA,0x6D,0x32,0x97,
+	0xAB,0x54,0xEA,0x3D,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x06,0x00,0x00,0x00,0xC4,0x0F,0xBE,0x8B,0x00,0x00,0x00,0x83,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0xD0,0x08,0xA8,0x10,0xF4,0x6A,0xDE,0xA3,0x94,0xB3,0x8D,0xC1,0xB8,0xEF,0xA5,
+	0x8B,0xCB,0x06,0x99,0x8E,0xD0,0x4B,0xFE,0x67,0xD2,0xBE,0x34,0x09,0x94,0x8B,0x6D,0x0D,0x61,0x14,0x72,
+	0x2E,0x59,0x2A,0xA8,0x64,0xEC,0x82,0x0B,0x33,0x09,0x49,0xAB,0xE8,0xE2,0xC3,0xCC,0x2A,0x5E,0x05,0xD3,
+	0x84,0xE4,0x75,0x76,0x02,0xB1,0x25,0x36,0xCC,0x02,0x52,0x25,0x28,0xAD,0xE2,0x22,0x28,0x6D,0x0C,0xA2,
+	0xD1,0xB0,0xB1,0x2E,0x43,0xD4,0x7A,0x96,0xC8,0xEC,0x8B,0xE6,0x73,0x6B,0x3E,0x67,0x3D,0xEC,0x15,0x9D,
+	0xAB,0x3A,0xCF,0xFC,0x42,0xE6,0xFA,0x48,0xE6,0xB5,0x07,0xAA,0xCD,0x3E,0x5E,0x9C,0x9B,0x69,0xCA,0x98,
+	0x73,0x4A,0xA3,0x8D,0x22,0x47,0x02,0x00,0x94,0xD9,0x3B,0x98,0x41,0x83,0xF6,0xBE,0x00,0x00,0x00,0x00,
+	0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn6a16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x10,0x06,0x00,0x00,0x00,0x94,0x9F,0x62,0xC8,0x00,0x00,0x00,0xF1,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0xD0,0xD0,0x08,0x08,0xA8,0xA8,0x10,0x14,0xF2,0xF2,0x6E,0x6E,0xD9,0xB3,
+	0x57,0x49,0x25,0x27,0x6F,0xDB,0x0E,0x06,0x26,0x63,0xB3,0xBE,0x89,0x2F,0xDF,0xB8,0xB8,0xBB,0x78,0x6C,
+	0xD8,0x22,0xA3,0xD0,0xD1,0x13,0x1A,0x75,0xE9,0xBA,0x7F,0xC8,0x99,0x8B,0x69,0x39,0x5F,0x7E,0x35,0x75,
+	0x08,0x88,0x95,0xD7,0x89,0xC9,0x6E,0xDD,0x13,0x12,0xCD,0x28,0x24,0xE4,0xEC,0x5C,0x52,0xB2,0x74,0xA9,
+	0xA0,0x90,0x92,0xB2,0xB1,0x89,0x8B,0x2B,0xA9,0x34,0x93,0x90,0x90,0xB4,0xB4,0x8A,0x8A,0xAE,0x2E,0x32,
+	0xAD,0x8A,0xC6,0xC7,0x45,0x83,0xD4,0x31,0xAB,0xA8,0x78,0x79,0x15,0x14,0x4C,0x9B,0x26,0x24,0x24,0x2F,
+	0xAF,0xA3,0xB3,0x73,0x27,0x88,0xD6,0x5E,0x63,0x69,0x09,0xE1,0xE3,0xA7,0x41,0xEA,0x58,0x60,0x26,0x0A,
+	0x82,0x69,0x90,0xD3,0xA4,0xA5,0x8D,0x4D,0x60,0x7C,0xFC,0x34,0x48,0x1D,0x43,0x54,0xD4,0xFA,0xF5,0x2C,
+	0x2C,0x91,0x91,0xD9,0x39,0x17,0x2F,0x99,0x5B,0xCC,0x9D,0x57,0x53,0xF7,0xF9,0x6B,0x56,0xCE,0xC3,0xC7,
+	0xBD,0x13,0x44,0x25,0xE6,0x2E,0x50,0xD5,0x98,0xB7,0xC8,0xDC,0xFA,0xC2,0x95,0xCC,0xDC,0xF5,0x5B,0x22,
+	0xE3,0x98,0x39,0xD6,0x6E,0x3A,0x70,0xAC,0xBA,0xD1,0xCC,0xE6,0xE3,0xF7,0x8B,0x37,0xE6,0x2E,0xC9,0x2C,
+	0x30,0xB5,0x61,0xCC,0xC9,0x39,0x75,0x4A,0x43,0xA3,0xAD,0x8D,0xAA,0x81,0x48,0x0A,0x0D,0x00,0xB8,0x72,
+	0x79,0x44,0xCB,0x4D,0xE7,0x97,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn3p01[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x01,0x03,0x00,0x00,0x00,0xFE,0xC1,0x2C,0xC8,0x00,0x00,0x00,0x06,0x50,0x4C,0x54,
+	0x45,0x44,0x20,0x82,0x3C,0xFD,0xE6,0x72,0x35,0x64,0x48,0x00,0x00,0x00,0x18,0x49,0x44,0x41,0x54,0x78,
+	0xDA,0x63,0x08,0x65,0x5C,0xC5,0xB4,0x9A,0xB9,0x81,0x65,0x35,0xC3,0x2A,0xC6,0x50,0xA6,0x50,0x00,0x23,
+	0x45,0x04,0x37,0x9F,0xC8,0x72,0x29,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn3p02[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x02,0x03,0x00,0x00,0x00,0xB9,0x61,0x56,0x18,0x00,0x00,0x00,0x0C,0x50,0x4C,0x54,
+	0x45,0x1C,0x2E,0x2B,0xB8,0x56,0x9D,0x80,0x6C,0x12,0x51,0xDC,0xC9,0xAB,0x6F,0xE1,0x25,0x00,0x00,0x00,
+	0x21,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0x90,0x96,0x66,0x3C,0xC6,0xC0,0xF4,0xFA,0x35,0xB3,0xC8,0x3D,
+	0x96,0xF5,0x0C,0x0C,0xC7,0x8E,0x31,0x6E,0x64,0x60,0xDA,0xBD,0x1B,0x00,0x58,0x5F,0x08,0x34,0xAF,0x0E,
+	0x75,0xDE,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basn3p04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x04,0x03,0x00,0x00,0x00,0x36,0x21,0xA3,0xB8,0x00,0x00,0x00,0x30,0x50,0x4C,0x54,
+	0x45,0x78,0x9B,0x34,0xCA,0xF5,0x4F,0x2E,0x22,0x0A,0xCD,0x94,0x1E,0x71,0xB8,0x8D,0x58,0x36,0x86,0x6D,
+	0x0D,0x85,0x8B,0x63,0x54,0x9E,0x94,0xBE,0x2C,0xAC,0xC6,0x7F,0x5B,0x7E,0xF2,0x8F,0x2D,0x99,0x03,0x95,
+	0x9F,0x63,0xD3,0xD8,0x93,0xDC,0xE7,0x52,0x77,0x61,0x8F,0x2B,0x32,0x00,0x00,0x00,0x2C,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x5D,0xEF,0xF9,0x98,0xF1,0xCB,0xAA,0x59,0xB3,0x98,0xDE,0x03,0x01,0x73,0xE2,
+	0xD9,0xA3,0xAE,0x2C,0x40,0xC6,0x7F,0x86,0x0D,0x51,0x5F,0xE6,0x31,0xAE,0x9F,0x35,0x6B,0x15,0x58,0x02,
+	0x00,0xBA,0xC4,0x17,0x65,0x16,0x65,0xF7,0x30,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,
+	0x82,
+};
+
+static const uint8_t image_fx_basn3p08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x03,0x00,0x00,0x00,0xF3,0xD1,0x4E,0xB9,0x00,0x00,0x00,0x48,0x50,0x4C,0x54,
+	0x45,0x74,0xBD,0xC0,0x40,0x62,0x16,0x2B,0x46,0x7E,0x6B,0xCD,0x0F,0xEB,0xF9,0xE8,0xC7,0xFD,0x62,0xCE,
+	0x2D,0xF8,0x77,0x0A,0x88,0xD0,0xF2,0xC2,0x3A,0x84,0x31,0x20,0xC5,0xC1,0x37,0x1D,0xAD,0x78,0x2C,0xFE,
+	0x6A,0x48,0x20,0x13,0xFA,0x63,0x4B,0xE9,0xE3,0x92,0xB6,0xDA,0x45,0x51,0x31,0xA0,0xB6,0xFD,0x65,0x9E,
+	0x4C,0xB6,0x91,0x24,0x70,0xB0,0x7C,0x06,0x97,0xAF,0x70,0x88,0x11,0x2E,0xC2,0x3E,0x94,0x00,0x00,0x00,
+	0x46,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0x60,0x60,0xE5,0xE2,0x17,0x61,0x64,0xE3,0x66,0xE4,0x67,0x7D,
+	0xCB,0x0A,0x04,0x6F,0x99,0xBE,0x7F,0xE7,0xE7,0xFF,0x0E,0x24,0x98,0x85,0x3E,0xFD,0xFB,0xC7,0xC5,0xF5,
+	0xE9,0x1F,0xCB,0x77,0xA0,0xDC,0x9F,0x3F,0xFC,0xAC,0x0C,0xCC,0x1C,0xBC,0x42,0xE2,0x2C,0x9C,0x7C,0x8C,
+	0x42,0x60,0xC5,0x6F,0x59,0x41,0x8A,0x41,0x6A,0xF9,0x01,0x08,0x07,0x17,0xBD,0xDD,0xEC,0xF2,0x89,0x00,
+	0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basi0g04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x0D,
+	0x00,0x00,0x00,0x0B,0x04,0x00,0x00,0x00,0x01,0x33,0x2E,0x85,0x2A,0x00,0x00,0x00,0x6E,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x63,0x00,0x9C,0xFF,0x00,0x46,0x03,0xF5,0x01,0xFC,0x04,0xED,0x02,0x7B,0x3F,0x00,
+	0x8F,0xF0,0x03,0x8B,0xDF,0x01,0x28,0x28,0x04,0xD7,0x24,0x7E,0x57,0x02,0xE1,0xCB,0xA2,0x00,0x00,0x9A,
+	0x63,0x60,0x00,0x03,0x23,0xDB,0xBA,0x01,0x0E,0x69,0x69,0x04,0xB7,0xF9,0x7B,0x02,0x1B,0x8F,0x9B,0x00,
+	0x20,0x07,0x3B,0x03,0xBD,0x1E,0x76,0x01,0xD0,0x18,0x8B,0x2D,0x60,0x0C,0x54,0x04,0x65,0x5E,0x3A,0xBC,
+	0x9F,0x22,0x2F,0x02,0xDA,0x86,0x18,0xEE,0x67,0xBB,0xC0,0x00,0xFB,0xDB,0x0A,0xE0,0x75,0x52,0x80,0x03,
+	0xA8,0xD8,0x27,0x02,0x26,0x73,0x47,0xE1,0xDF,0x24,0x5A,0xFD,0x91,0x1D,0x28,0x00,0x00,0x00,0x00,0x49,
+	0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basi2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x0B,
+	0x00,0x00,0x00,0x09,0x08,0x02,0x00,0x00,0x01,0x1C,0x01,0x71,0xEC,0x00,0x00,0x00,0xCB,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0xD0,0x08,0xE8,0xB0,0x78,0xC1,0x3C,0xE1,0x8D,0x47,0xCF,0x97,0x18,0x46,0x97,
+	0x0D,0x32,0x2C,0x13,0x6E,0x28,0x30,0x79,0x4C,0x79,0xD0,0x23,0xB3,0xE6,0xC2,0x92,0x0A,0x06,0xA5,0x9C,
+	0x6D,0x69,0x5F,0x9A,0x56,0xD5,0xF8,0x31,0x47,0x2E,0x7A,0xED,0x56,0xB5,0x0E,0x88,0x18,0x37,0xB9,0x5C,
+	0x73,0xE9,0x38,0x03,0x44,0x2C,0x2A,0x71,0x33,0x94,0x5C,0xD2,0x90,0x11,0x93,0x47,0xCE,0x04,0x34,0xC4,
+	0x20,0xE8,0xD5,0x6C,0xDC,0xF7,0x32,0xF4,0x92,0x7F,0xB9,0xD8,0xD6,0x99,0x51,0xD2,0xCC,0xBA,0xD1,0x5D,
+	0xCA,0xB6,0xE1,0x30,0x74,0x9D,0x31,0x72,0x9B,0x30,0xB2,0x11,0x2C,0x2A,0x66,0x1E,0x4A,0x40,0xE4,0x02,
+	0x24,0xD3,0x80,0x0C,0x26,0x20,0x1F,0x19,0x31,0x08,0x39,0x97,0x28,0xA7,0x2E,0x37,0x69,0xBF,0xE5,0xBA,
+	0x92,0x37,0xEC,0xB4,0x43,0xFA,0xDB,0xE2,0x0A,0xFE,0x65,0x9D,0x86,0x37,0x67,0x05,0xF3,0xAC,0x2E,0xB5,
+	0xDF,0x33,0xBD,0x88,0x59,0x37,0xA2,0x49,0x5A,0xC7,0x0E,0x81,0xD6,0xD8,0xA1,0x70,0x75,0xEC,0x18,0xA3,
+	0xD6,0xB3,0x08,0x2A,0x19,0xE3,0x41,0x20,0x57,0x40,0x39,0x66,0x10,0x21,0x0F,0x64,0x69,0xA0,0x2C,0x00,
+	0xD4,0xEE,0x5D,0x53,0x8E,0xCC,0xAA,0xD8,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basi6a16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x09,0x10,0x06,0x00,0x00,0x01,0xC7,0x06,0xEA,0xC5,0x00,0x00,0x01,0xA3,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0x60,0xD0,0xD0,0x08,0x08,0xA8,0xA8,0xE8,0x98,0x60,0xE1,0xF0,0xE2,0xC3,0x8C,
+	0x05,0xCC,0x13,0x26,0xBC,0x79,0xE3,0xE1,0xB1,0x64,0x49,0xCF,0x84,0x2F,0x3F,0x62,0x12,0x5C,0x3C,0x18,
+	0x5D,0x3C,0x36,0x6C,0x91,0x51,0xE8,0xE8,0x61,0x99,0x30,0xE1,0xC6,0x0D,0x05,0x85,0x8C,0x0C,0x26,0x0F,
+	0x8F,0x29,0x53,0x1E,0x3C,0xD0,0xD1,0xE9,0x99,0x20,0xA3,0xB0,0x66,0x83,0x8D,0xC3,0x85,0x1B,0x4B,0xD6,
+	0x54,0x34,0xF8,0x84,0x30,0x28,0xA9,0xE4,0xE4,0x6D,0xDB,0xC1,0xC0,0x94,0x96,0xF3,0xE5,0x57,0x53,0x87,
+	0x80,0x18,0x73,0x64,0xD4,0xA2,0xC5,0xAF,0xDF,0x6C,0xD9,0xEA,0xE6,0x51,0x55,0xB3,0x6E,0x43,0x52,0x0A,
+	0xE3,0xA6,0x2D,0x2E,0x6E,0xD7,0x6E,0x64,0x64,0xB9,0x78,0x74,0xF4,0x9C,0xB9,0x20,0x20,0xC2,0xA2,0xA2,
+	0x12,0x17,0x37,0x63,0xC6,0xA5,0x4B,0x4A,0x2A,0x2E,0x6E,0xE9,0x19,0x1D,0x5D,0x20,0x3A,0x15,0x4A,0xA7,
+	0x21,0xD1,0x40,0x4B,0x73,0x72,0x26,0x4C,0xD8,0xB2,0x05,0x44,0xF7,0x43,0xE9,0x09,0x58,0x68,0x06,0x41,
+	0x21,0x2F,0xEF,0xE6,0x96,0x3D,0x7B,0x8D,0xCD,0xFA,0x26,0xBE,0x7C,0xE3,0xE2,0x1E,0x1A,0x75,0xE9,0xBA,
+	0x7F,0xC8,0x99,0x8B,0xE5,0x75,0x62,0xB2,0x5B,0xF7,0x84,0x44,0x33,0xEB,0xEA,0x46,0xC7,0x74,0x75,0xED,
+	0xD8,0xA9,0xAC,0x62,0x6B,0x17,0x1E,0x51,0x58,0x84,0x4C,0x47,0x00,0x69,0xC6,0xC8,0xA8,0x6D,0xDB,0x85,
+	0x45,0x0A,0x0A,0xD1,0xDD,0x00,0xA3,0x81,0x8E,0x36,0x33,0xF3,0xF0,0x88,0x8A,0x52,0x82,0xD3,0x2E,0x6E,
+	0x1E,0x1E,0x20,0x05,0x66,0x66,0x69,0x19,0x8F,0x9E,0x30,0xC1,0x14,0xE0,0xA2,0x19,0x84,0x84,0x9C,0x9D,
+	0x4B,0x4A,0x96,0x2E,0x55,0x56,0x49,0x4D,0x5B,0xBE,0xE2,0xE5,0x2B,0x13,0xB3,0xF6,0xCE,0x5B,0x77,0x74,
+	0xF5,0x5D,0x3D,0x56,0xAE,0xE1,0x15,0x28,0x2C,0x09,0x8B,0x3A,0x7D,0xDE,0xC1,0x65,0xEB,0xCE,0xF4,0x9C,
+	0xB7,0x9F,0x8A,0x2B,0x7E,0xFE,0xAB,0xA8,0xE3,0x17,0x5D,0xB6,0xC6,0xD6,0xB9,0x73,0x82,0xA1,0xC5,0xCD,
+	0x07,0x8D,0x1D,0xB3,0x16,0x05,0x47,0xF3,0x88,0x1C,0x3D,0x0B,0xF4,0x4C,0x44,0x44,0x53,0xD3,0xDA,0xB5,
+	0xD2,0xD2,0x3A,0xBA,0x76,0x76,0xFE,0x01,0xB8,0xE9,0x35,0x6B,0xED,0xEC,0xCE,0x5F,0xC0,0x25,0xCF,0x18,
+	0x15,0xB5,0x7E,0x3D,0x0B,0x4B,0x64,0xA4,0xA0,0x90,0x92,0xB2,0xB1,0x89,0x8B,0x2B,0xB9,0x34,0x3C,0x70,
+	0x30,0x15,0x98,0x99,0x19,0x9B,0xA0,0x8A,0x7B,0x78,0xA0,0x1B,0x80,0x90,0x07,0x00,0x24,0xCE,0xE1,0xFD,
+	0x2D,0xF4,0x63,0x49,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basi4a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x04,0x00,0x00,0x01,0x19,0x01,0x46,0x96,0x00,0x00,0x00,0x6B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x63,0x60,0xD0,0x60,0x76,0xD9,0xC0,0xE8,0x31,0xC5,0xA5,0x83,0x45,0x29,0xC7,0xA5,0x83,
+	0xC9,0x23,0xC7,0x23,0x87,0x41,0x25,0xCE,0x6D,0x51,0xC6,0xB3,0x2E,0x2D,0xE6,0xA8,0xD9,0xA6,0x11,0xA6,
+	0x37,0x4C,0x23,0x18,0x05,0xBD,0x94,0x5C,0x40,0x90,0x45,0xC5,0x4C,0x09,0x04,0x5D,0x98,0x54,0xCC,0x20,
+	0x90,0xA1,0xF6,0xCD,0x7C,0x83,0x83,0x25,0x8F,0x77,0x30,0x0B,0x39,0x4B,0xB9,0x28,0x87,0x6A,0xA7,0x99,
+	0x94,0xDB,0x74,0xB8,0xCE,0xF4,0xD5,0x62,0x34,0xAB,0x14,0x54,0x42,0x86,0x40,0xCD,0x50,0x26,0x94,0x86,
+	0x1B,0x02,0x83,0x00,0x66,0xD6,0x20,0xD1,0x7A,0x84,0xC0,0x43,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,
+	0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_basi3p02[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x07,0x02,0x03,0x00,0x00,0x01,0xD0,0xF2,0xBF,0x65,0x00,0x00,0x00,0x0C,0x50,0x4C,0x54,
+	0x45,0xED,0xBF,0x88,0x46,0x5F,0x03,0xAD,0xED,0x29,0xAB,0x14,0xC2,0xEC,0x01,0x50,0xF8,0x00,0x00,0x00,
+	0x27,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0x61,0x60,0x01,0xC1,0x05,0x40,0xDC,0xF1,0x83,0x85,0x81,0x81,
+	0xA5,0x9C,0x25,0x8D,0x65,0x16,0x10,0xFB,0x31,0x7C,0x62,0x99,0xC6,0x70,0x87,0x25,0x8B,0xE1,0x13,0x00,
+	0x6F,0xC1,0x08,0x44,0xF9,0x20,0xA9,0x74,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_s01n3p01[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x01,
+	0x00,0x00,0x00,0x01,0x01,0x03,0x00,0x00,0x00,0x25,0xDB,0x56,0xCA,0x00,0x00,0x00,0x06,0x50,0x4C,0x54,
+	0x45,0x79,0x42,0xBD,0xF2,0x21,0x06,0x97,0xDD,0x6F,0xC0,0x00,0x00,0x00,0x0A,0x49,0x44,0x41,0x54,0x78,
+	0xDA,0x63,0x68,0x00,0x00,0x00,0x82,0x00,0x81,0xDA,0x45,0x08,0x3B,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,
+	0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_s01i3p01[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x01,
+	0x00,0x00,0x00,0x01,0x01,0x03,0x00,0x00,0x01,0x52,0xDC,0x66,0x5C,0x00,0x00,0x00,0x06,0x50,0x4C,0x54,
+	0x45,0x79,0x42,0xBD,0xF2,0x21,0x06,0x97,0xDD,0x6F,0xC0,0x00,0x00,0x00,0x0A,0x49,0x44,0x41,0x54,0x78,
+	0xDA,0x63,0x68,0x00,0x00,0x00,0x82,0x00,0x81,0xDA,0x45,0x08,0x3B,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,
+	0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f00n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x02,0x00,0x00,0x00,0xD3,0x6D,0x82,0x99,0x00,0x00,0x00,0x7B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x70,0x00,0x8F,0xFF,0x00,0xA5,0x4D,0xCA,0x18,0x25,0x30,0xBB,0x1D,0x6D,0x13,0x2C,
+	0xDE,0xD6,0x23,0x7B,0x2E,0xD9,0x1E,0x3F,0x72,0x1F,0xCB,0x19,0x71,0x17,0x44,0x94,0x00,0xD6,0x49,0x3C,
+	0x9D,0x5C,0x34,0x60,0xBE,0x31,0x20,0x1E,0x69,0xFE,0xDA,0xA0,0xEE,0xE8,0xB9,0x99,0x7F,0x5C,0x7C,0x29,
+	0x99,0xFD,0xAF,0xE5,0x00,0x93,0x25,0x3C,0xD6,0x54,0xAF,0x4D,0xFA,0xD7,0x14,0x27,0xA0,0xAE,0xB3,0xFE,
+	0xE9,0x23,0x2F,0x8A,0xF2,0x21,0x1F,0x9E,0xE4,0x91,0xC5,0xB1,0x00,0x0B,0xEC,0xB5,0x56,0x3B,0xFC,0x1E,
+	0x6F,0x93,0x42,0x7E,0xCB,0xC8,0xFE,0x29,0x55,0xE5,0xCD,0x8E,0x46,0xDC,0x8E,0xD4,0xB7,0xC2,0x76,0x4D,
+	0x0C,0x77,0x36,0xCE,0x97,0x73,0x1F,0xED,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f00n6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x06,0x00,0x00,0x00,0x5C,0x0F,0x15,0xCE,0x00,0x00,0x00,0x9F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x94,0x00,0x6B,0xFF,0x00,0xA5,0x4D,0xCA,0x18,0x25,0x30,0xBB,0x1D,0x6D,0x13,0x2C,
+	0xDE,0xD6,0x23,0x7B,0x2E,0xD9,0x1E,0x3F,0x72,0x1F,0xCB,0x19,0x71,0x17,0x44,0x94,0xD6,0x49,0x3C,0x9D,
+	0x5C,0x34,0x60,0xBE,0x31,0x00,0x20,0x1E,0x69,0xFE,0xDA,0xA0,0xEE,0xE8,0xB9,0x99,0x7F,0x5C,0x7C,0x29,
+	0x99,0xFD,0xAF,0xE5,0x93,0x25,0x3C,0xD6,0x54,0xAF,0x4D,0xFA,0xD7,0x14,0x27,0xA0,0xAE,0xB3,0xFE,0xE9,
+	0x23,0x2F,0x00,0x8A,0xF2,0x21,0x1F,0x9E,0xE4,0x91,0xC5,0xB1,0x0B,0xEC,0xB5,0x56,0x3B,0xFC,0x1E,0x6F,
+	0x93,0x42,0x7E,0xCB,0xC8,0xFE,0x29,0x55,0xE5,0xCD,0x8E,0x46,0xDC,0x8E,0xD4,0xB7,0xC2,0x76,0x4D,0x00,
+	0x2A,0x5A,0x4D,0x76,0x77,0x06,0xF8,0x5D,0x86,0x90,0x02,0x4A,0xD6,0xBD,0xA3,0x40,0x1B,0xE9,0xC8,0xCB,
+	0xCC,0xC9,0x35,0xF6,0xCD,0x1F,0x61,0x22,0x6A,0xE1,0x53,0x38,0xAE,0x1A,0x34,0x00,0x15,0x7A,0x47,0x57,
+	0xC4,0x12,0x2E,0x06,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f01n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x02,0x00,0x00,0x00,0xD3,0x6D,0x82,0x99,0x00,0x00,0x00,0x7B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x70,0x00,0x8F,0xFF,0x01,0x74,0xBD,0xC0,0xCC,0xA5,0x56,0xEB,0xE4,0x68,0x40,0x87,
+	0x91,0x80,0x2C,0xD9,0xDC,0x04,0x7A,0x07,0x30,0x96,0xA9,0xDD,0x90,0x59,0xE8,0x3A,0x01,0x3A,0x84,0x31,
+	0xE6,0x41,0x90,0x17,0x58,0xEC,0x41,0x0F,0x51,0xF2,0x1C,0x22,0xA9,0xB2,0x43,0x38,0xEF,0x80,0x47,0xCD,
+	0xF7,0xB3,0x9B,0x57,0x01,0xA0,0xB6,0xFD,0xC5,0xE8,0x4F,0x51,0xF3,0xD8,0xBA,0x1F,0x58,0x96,0xE7,0x33,
+	0x6A,0xF1,0x62,0x68,0xFA,0xAF,0xC0,0x53,0x99,0x32,0x66,0xFC,0x01,0x0D,0x67,0x52,0x8C,0xD4,0xB4,0x29,
+	0x74,0x51,0x1D,0xC7,0xF0,0xF2,0x6E,0x89,0x04,0x45,0x53,0xBE,0x07,0xEE,0x98,0x06,0xA7,0x23,0xC3,0x94,
+	0x6E,0xD4,0x38,0x3D,0xEF,0x7D,0x40,0x6B,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f01n6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x06,0x00,0x00,0x00,0x5C,0x0F,0x15,0xCE,0x00,0x00,0x00,0x9F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x94,0x00,0x6B,0xFF,0x01,0x74,0xBD,0xC0,0x40,0xEE,0x59,0x6B,0x06,0x1C,0x55,0xA2,
+	0xC9,0x6D,0x8E,0x1B,0xB8,0x12,0x69,0xE6,0x66,0xFB,0x15,0x3C,0x5B,0xD8,0x7B,0xB8,0xB2,0xB4,0x3F,0x5E,
+	0x8B,0x3D,0x06,0xFD,0xE8,0x01,0x78,0x2C,0xFE,0x6A,0xD0,0xF4,0x15,0x90,0x1B,0x2B,0xD6,0xE9,0x2F,0x6B,
+	0xF1,0x62,0xBF,0x7B,0xC6,0x71,0xAC,0x34,0xFE,0x96,0xB9,0x2C,0x86,0x24,0xFA,0xEB,0xE2,0x27,0xFF,0xF4,
+	0x82,0x7A,0x01,0xD8,0x82,0xC0,0x98,0xFD,0xD7,0x0A,0xA3,0x80,0xB4,0x9D,0x17,0x44,0x2E,0x9F,0x70,0x16,
+	0x1C,0xD9,0xB4,0x98,0x7A,0x05,0x5A,0x8E,0x58,0x3F,0xC3,0x5B,0xE8,0x08,0xA3,0x88,0x3D,0xCE,0x16,0x01,
+	0x20,0x61,0x08,0x47,0x8E,0x64,0x35,0x52,0x05,0xE1,0x7E,0x68,0x4C,0xC5,0x64,0x0F,0x59,0xF0,0x8D,0xCC,
+	0x8A,0xE2,0x7E,0x8A,0x90,0xC1,0xC8,0xE9,0x51,0x40,0x45,0x98,0x7D,0xA3,0xF7,0x0A,0x56,0xBF,0x49,0x0A,
+	0xB8,0x8B,0x2D,0x59,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f02n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x02,0x00,0x00,0x00,0xD3,0x6D,0x82,0x99,0x00,0x00,0x00,0x7B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x70,0x00,0x8F,0xFF,0x02,0xED,0xBF,0x88,0x46,0x5F,0x03,0xAD,0xED,0x29,0xAB,0x14,
+	0xC2,0x56,0xE7,0xD8,0x50,0x56,0x79,0x1A,0x38,0x43,0x20,0xC4,0x34,0x95,0x68,0x72,0x02,0xEA,0x6D,0x00,
+	0x25,0x6C,0x8C,0x01,0x29,0x3D,0x57,0xBE,0x5A,0x6B,0x14,0x6F,0xBC,0x23,0x60,0x1F,0xC9,0xFB,0x45,0xA3,
+	0x75,0x6F,0xC2,0xD2,0x02,0x31,0xFF,0x76,0xFA,0x0C,0x94,0x1D,0x4C,0xC9,0x48,0x86,0xF9,0x5A,0x8F,0x05,
+	0x7D,0x98,0x65,0x95,0x78,0x14,0xB1,0x54,0x83,0xAD,0x0E,0x77,0x02,0xDF,0x40,0xCF,0x00,0x32,0x9F,0xDD,
+	0x9E,0xAE,0xEF,0x15,0x5C,0xC8,0x00,0x5A,0xA4,0x8C,0x53,0x66,0xA3,0xBB,0xAD,0x20,0xD2,0x00,0x47,0x66,
+	0xC8,0xC5,0x31,0xAC,0x52,0xE9,0x5A,0x2F,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f02n6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x06,0x00,0x00,0x00,0x5C,0x0F,0x15,0xCE,0x00,0x00,0x00,0x9F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x94,0x00,0x6B,0xFF,0x02,0xED,0xBF,0x88,0x46,0x5F,0x03,0xAD,0xED,0x29,0xAB,0x14,
+	0xC2,0x56,0xE7,0xD8,0x50,0x56,0x79,0x1A,0x38,0x43,0x20,0xC4,0x34,0x95,0x68,0x72,0xD7,0x2C,0x88,0x6B,
+	0xCB,0x8F,0xAE,0x16,0x66,0x02,0x15,0x13,0x94,0x7B,0x9C,0x44,0x5F,0x8C,0xB0,0x8E,0xED,0x7C,0x0F,0x80,
+	0xD1,0xB4,0xD4,0xCB,0xEE,0xF3,0xBB,0x45,0x13,0xEF,0x36,0xFA,0xBD,0x73,0x2C,0x8D,0xB0,0xBF,0xBD,0xDB,
+	0xFB,0xD8,0x02,0xCC,0xA7,0x36,0x55,0xC0,0xE5,0xA5,0xBF,0xE2,0xAE,0x6A,0x8F,0x00,0xA2,0x19,0xA4,0xD6,
+	0x99,0x31,0x42,0x73,0x7E,0xB3,0x83,0x62,0x3B,0x62,0xEA,0xC4,0xF8,0xA8,0x51,0xB2,0x28,0x6E,0xE3,0x02,
+	0x0B,0xFD,0xDF,0xB7,0x03,0x91,0x96,0x5C,0x9C,0x9D,0xA4,0x4C,0xF3,0x7D,0x92,0x95,0x4B,0x29,0xDF,0xB2,
+	0x75,0x87,0x3D,0xF0,0xDA,0x18,0x00,0x14,0xDA,0x81,0x83,0x51,0x99,0x8B,0xA2,0xB6,0xCA,0x65,0x4C,0xA9,
+	0xEC,0x95,0x85,0x66,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f03n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x02,0x00,0x00,0x00,0xD3,0x6D,0x82,0x99,0x00,0x00,0x00,0x7B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x70,0x00,0x8F,0xFF,0x03,0x10,0xDB,0xF7,0xFF,0xFC,0x71,0xF8,0x5A,0xDC,0x94,0xB3,
+	0x7E,0x1E,0x02,0x65,0x03,0x98,0xEB,0xAA,0x58,0xB4,0x37,0x25,0x7E,0x11,0x58,0x45,0x03,0x3C,0x7C,0xFF,
+	0xBC,0x17,0x63,0x14,0xD1,0x10,0x5A,0xE2,0x46,0x36,0x13,0x2D,0x97,0x35,0x8B,0xDC,0x77,0xF6,0x38,0x0F,
+	0x65,0x7A,0x74,0x35,0x03,0x02,0xB5,0x0F,0x42,0x4B,0x1B,0xD6,0x96,0x9A,0x07,0xFB,0xE4,0x76,0x54,0x18,
+	0x9F,0xAA,0xC7,0xCA,0xCF,0x2B,0x52,0x3F,0x07,0xDD,0x8E,0x7E,0x03,0x9F,0x93,0xB8,0xB8,0x4F,0x81,0x54,
+	0x8A,0x00,0xA9,0x04,0x4E,0x4D,0xA4,0xE3,0x57,0x0D,0x03,0x4B,0xA3,0x97,0x65,0x2E,0xB2,0x76,0x9B,0xE7,
+	0x1B,0x31,0x31,0xB9,0x0A,0x43,0x67,0x8F,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f03n6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x06,0x00,0x00,0x00,0x5C,0x0F,0x15,0xCE,0x00,0x00,0x00,0x9F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x94,0x00,0x6B,0xFF,0x03,0x10,0xDB,0xF7,0x07,0x61,0x7F,0x80,0x8B,0x1E,0x9B,0x7D,
+	0x60,0xFD,0x77,0x3B,0xC3,0xC4,0x08,0x59,0xB8,0x6C,0x6E,0x2C,0x88,0xEE,0x53,0x76,0xD0,0xBD,0x2D,0x85,
+	0x9E,0xA2,0xC5,0x08,0xE4,0x03,0x5B,0x2E,0x40,0x77,0x3A,0x23,0x04,0x6C,0xA8,0x2B,0x64,0xA7,0xB0,0xE8,
+	0x8E,0xCC,0x29,0x3A,0xC1,0xC0,0x62,0x2F,0x6A,0xC3,0xE7,0x82,0x26,0x0D,0xD0,0x5D,0xFC,0x4A,0xA9,0x23,
+	0xE2,0xBD,0x03,0x2A,0xF0,0x2B,0xAC,0x1D,0xC3,0xA6,0x6E,0x98,0x34,0x53,0x78,0x8E,0x6D,0xBA,0x32,0xEB,
+	0x2E,0x0B,0x1D,0x6E,0x2F,0xDE,0x5E,0x6E,0xFB,0xF2,0x69,0x50,0x8A,0xA1,0x15,0xFB,0x7F,0xD5,0x36,0x03,
+	0x85,0xA8,0xB6,0xE0,0x3B,0xA5,0x2B,0xBB,0x16,0x6F,0x64,0xA1,0x7A,0xBE,0x32,0xD6,0x3D,0xA3,0x0D,0x8C,
+	0xF9,0x01,0x63,0xAC,0xFC,0x29,0x0B,0x91,0x85,0x29,0x92,0xC0,0x43,0x53,0x11,0xFA,0x2E,0x22,0x45,0xC1,
+	0x69,0xEB,0xC8,0x30,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f03n6a16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x10,0x06,0x00,0x00,0x00,0x0C,0x9F,0xC9,0x8D,0x00,0x00,0x01,0x2F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x24,0x01,0xDB,0xFE,0x03,0x10,0xAE,0xDB,0x97,0xF7,0x12,0x07,0x98,0x61,0x2E,0x7F,
+	0x8C,0x80,0x82,0x8B,0xCB,0x1E,0xC7,0x9B,0x32,0x7D,0xA7,0x60,0xC6,0xFD,0xF1,0x77,0xB1,0x3B,0x73,0xC3,
+	0x68,0xC4,0xC4,0x08,0x83,0x59,0x59,0xB8,0xF9,0x6C,0x90,0x6E,0x35,0x2C,0xE8,0x88,0xB5,0xEE,0x17,0x53,
+	0x15,0x76,0x7E,0xD0,0xA3,0xBD,0xBB,0x2D,0x78,0x85,0xC7,0x9E,0x15,0xA2,0x30,0xC5,0xCB,0x08,0x9B,0xE4,
+	0x89,0x03,0x5B,0x79,0x2E,0xC5,0x40,0x6E,0x77,0xAD,0x3A,0x4A,0x23,0x45,0x04,0xBE,0x6C,0x18,0xA8,0xC8,
+	0x2B,0x93,0x64,0x81,0xA7,0x1F,0xB0,0xC6,0xE8,0x6E,0x8E,0x68,0xCC,0x6E,0x29,0xF2,0x3A,0x2B,0xC1,0x07,
+	0xC0,0x21,0x62,0x2B,0x2F,0x9E,0x6A,0xFC,0xC3,0xF5,0xE7,0x48,0x82,0xF5,0x26,0x76,0x0D,0xD3,0xD0,0xE0,
+	0x5D,0x03,0xFC,0xBB,0x4A,0xDC,0xA9,0x71,0x23,0x63,0xE2,0xEA,0xBD,0x2D,0x03,0x2A,0xF7,0xF0,0x24,0x2B,
+	0x7C,0xAC,0xDA,0x1D,0x41,0xC3,0x00,0xA6,0xC3,0x6E,0xAD,0x98,0x3C,0x34,0x9D,0x53,0xCD,0x78,0x13,0x8E,
+	0xE9,0x6D,0x10,0xBA,0x6D,0x32,0x65,0xEB,0x28,0x2E,0xD8,0x0B,0x4D,0x1D,0x66,0x6E,0xD0,0x2F,0xBB,0xDE,
+	0x44,0x5E,0xA8,0x6E,0x39,0xFB,0x3E,0xF2,0x11,0x69,0x82,0x50,0x26,0x8A,0x94,0xA1,0xB1,0x15,0x84,0xFB,
+	0xB7,0x7F,0xF7,0xD5,0x1D,0x36,0xBE,0x03,0x85,0x9F,0xA8,0x7A,0xB6,0x78,0xE0,0xB8,0x3B,0x1C,0xA5,0x01,
+	0x2B,0x09,0xBB,0x90,0x16,0x8C,0x6F,0xD2,0x64,0x7B,0xA1,0x91,0x7A,0x88,0xBE,0xEE,0x32,0x87,0xD6,0xD5,
+	0x3D,0x35,0xA3,0xFF,0x0D,0x73,0x8C,0x78,0xF9,0x0D,0x01,0x9C,0x63,0x91,0xAC,0xC5,0xFC,0xF6,0x29,0xFC,
+	0x0B,0xB5,0x91,0x48,0x85,0xBD,0x29,0xF9,0x92,0xB5,0xC0,0x86,0x43,0xD5,0x53,0x5C,0x11,0xE8,0xFA,0x80,
+	0x6E,0xF1,0x91,0xE1,0xDB,0xEC,0x6E,0x97,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f04n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x02,0x00,0x00,0x00,0xD3,0x6D,0x82,0x99,0x00,0x00,0x00,0x7B,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x70,0x00,0x8F,0xFF,0x04,0xE7,0xEE,0xE7,0x7A,0x70,0x0C,0xFE,0xD2,0xF1,0x3C,0x18,
+	0x4A,0x7A,0x82,0xB9,0x3B,0x3D,0x39,0xCE,0x0B,0x41,0x5D,0xFD,0x8C,0x2C,0xD2,0x77,0x04,0x90,0xA8,0x18,
+	0xA1,0xCD,0xEB,0x8C,0xA5,0x46,0xE7,0xD1,0x4B,0x7E,0x45,0x3C,0xA4,0xC6,0x17,0x76,0xF8,0xC1,0x74,0x3B,
+	0x80,0x63,0x39,0x8C,0x04,0x49,0x35,0xD7,0xAE,0x3A,0xB4,0x1E,0x5C,0x75,0xFE,0xDB,0x32,0x92,0x3D,0x09,
+	0xFC,0x38,0xA0,0x5A,0xF4,0x3C,0xCC,0xE5,0xF4,0xD8,0xF1,0xD4,0x04,0x7B,0xFF,0x01,0x47,0x9B,0x00,0xEF,
+	0x0A,0xCC,0xC4,0xC2,0x94,0xD9,0x81,0x3A,0xCD,0x7F,0xE6,0xBA,0x9E,0x6B,0xC5,0x8F,0x69,0x45,0x56,0xA6,
+	0x8B,0x80,0x3A,0x4C,0x80,0x6C,0x43,0x8F,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f04n6a08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x08,0x06,0x00,0x00,0x00,0x5C,0x0F,0x15,0xCE,0x00,0x00,0x00,0x9F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x94,0x00,0x6B,0xFF,0x04,0xE7,0xEE,0xE7,0x61,0x77,0x05,0x78,0xCF,0x86,0xA8,0xE9,
+	0xFE,0x31,0x2F,0x9F,0x22,0xF2,0x56,0x37,0xC2,0x5A,0x5B,0xF1,0xDB,0x46,0x66,0x55,0x8A,0xEF,0x1E,0x9E,
+	0xB4,0x54,0x8F,0xCE,0xFF,0x04,0x9B,0xB3,0x8E,0x32,0xB1,0x82,0xD8,0x6C,0xD9,0x71,0x8E,0x55,0xF3,0x36,
+	0x86,0x1B,0x13,0xF0,0xA2,0xB9,0x75,0x35,0xA5,0x9D,0xD6,0xB1,0x3A,0x33,0x71,0xA5,0xD8,0xCD,0xE8,0xA5,
+	0x35,0xDA,0x04,0x6C,0x58,0xE5,0xCD,0x63,0xC0,0x0C,0x43,0xDF,0xA7,0x05,0xB5,0xA8,0x00,0x1D,0xC4,0x9E,
+	0x7B,0x9F,0xFE,0x5D,0xF0,0xEB,0xE3,0xAF,0x6F,0x65,0x1E,0x90,0xF4,0x21,0xE2,0x97,0x37,0x77,0xE9,0x04,
+	0xCE,0xC5,0x8E,0xE1,0x3B,0xE4,0xDD,0x87,0x69,0x64,0xAA,0x22,0x13,0x16,0xF0,0x47,0xED,0xBD,0x78,0x4F,
+	0x3E,0x22,0x3C,0x6A,0x98,0x44,0x7F,0x2F,0x81,0xCE,0xD6,0xFD,0xA9,0x0A,0x79,0x1E,0x3E,0x52,0x4E,0x57,
+	0xD9,0x18,0xB3,0x33,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f04n6a16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x09,
+	0x00,0x00,0x00,0x04,0x10,0x06,0x00,0x00,0x00,0x0C,0x9F,0xC9,0x8D,0x00,0x00,0x01,0x2F,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x24,0x01,0xDB,0xFE,0x04,0xE7,0x9E,0xEE,0x69,0xE7,0x56,0x61,0x3A,0x77,0xED,0x05,
+	0x2E,0x78,0xFC,0xCF,0xF6,0x86,0x1C,0xA8,0xC0,0xE9,0x47,0xFE,0x3C,0x31,0xCA,0x2F,0x7E,0x9F,0x55,0x22,
+	0x37,0xF2,0x3D,0x56,0x82,0x37,0x8F,0xC2,0x9E,0x5A,0xB4,0x5B,0x88,0xF1,0xE9,0xDB,0x47,0x46,0xAD,0x66,
+	0xAE,0x55,0x9B,0x8A,0x18,0xEF,0x8C,0x1E,0x55,0x9E,0x59,0xB4,0xE3,0x54,0x8C,0x8F,0x89,0xCE,0xEB,0xFF,
+	0x16,0x04,0x9B,0x6D,0xB3,0x03,0x8E,0x40,0x32,0xC3,0xB1,0x30,0x82,0x5D,0xD8,0xAC,0x6C,0x04,0xD9,0xF6,
+	0x71,0x5A,0x8E,0x4C,0x55,0x07,0xF3,0x74,0x36,0x56,0x86,0x62,0x1B,0xF4,0x13,0x1C,0xF0,0x5B,0xA2,0xEC,
+	0xB9,0x3A,0x75,0x8C,0x35,0x86,0xA5,0x64,0x9D,0x98,0xD6,0x1B,0xB1,0x39,0x3A,0xF0,0x33,0x28,0x71,0x26,
+	0xA5,0x10,0xD8,0x0F,0xCD,0xA1,0xE8,0xFF,0xA5,0x51,0x35,0x41,0xDA,0xC1,0x04,0x6C,0x01,0x58,0xD4,0xE5,
+	0x62,0xCD,0x77,0x63,0xD9,0xC0,0xAD,0x0C,0x78,0x43,0xA4,0xDF,0x67,0xA7,0x05,0x05,0x45,0xB5,0xC8,0xA8,
+	0x57,0x00,0xF6,0x1D,0xF8,0xC4,0x4B,0x9E,0x11,0x7B,0x40,0x9F,0xC4,0xFE,0x26,0x5D,0x51,0xF0,0xED,0xEB,
+	0x09,0xE3,0xB3,0xAF,0xB3,0x6F,0x9E,0x65,0x47,0x1E,0x24,0x90,0x3A,0xF4,0x1A,0x21,0xAD,0xE2,0x1F,0x97,
+	0xFD,0x37,0x27,0x77,0xD1,0xE9,0xE8,0x04,0xCE,0xB6,0xC5,0x0F,0x8E,0x12,0xE1,0xAF,0x3B,0xE8,0xE4,0xDE,
+	0xDD,0xA4,0x87,0x27,0x69,0x40,0x64,0xA3,0xAA,0x40,0x22,0x51,0x13,0x31,0x16,0x01,0xF0,0xB9,0x47,0x05,
+	0xED,0xFF,0xBD,0x4E,0x78,0xE3,0x4F,0x67,0x3E,0xCC,0x22,0xA5,0x3C,0x07,0x6A,0x78,0x98,0xFF,0x44,0xF2,
+	0x7F,0xC3,0x2F,0xCF,0x81,0xAD,0xCE,0x85,0xD6,0x3F,0xFD,0x2E,0xA9,0x94,0x0A,0xB3,0x79,0xD2,0x1E,0x05,
+	0x98,0x2A,0x93,0x12,0x0A,0x6E,0x65,0xB2,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_f99n0g04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x11,
+	0x00,0x00,0x00,0x09,0x04,0x00,0x00,0x00,0x00,0x34,0x73,0x75,0xD1,0x00,0x00,0x00,0x65,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x5A,0x00,0xA5,0xFF,0x01,0x42,0x41,0x7B,0xFE,0x67,0x8D,0xDD,0x41,0x72,0x03,0x52,
+	0x25,0x31,0x8E,0x36,0x59,0x85,0xFD,0xF3,0x00,0x7E,0x90,0xD3,0x59,0x3A,0xD6,0x99,0xFC,0x10,0x02,0x79,
+	0x3D,0x88,0x59,0xA9,0x86,0x26,0x13,0x00,0x04,0xA5,0xB9,0x1B,0xB5,0x19,0x62,0xC1,0xB5,0x9C,0x01,0xD1,
+	0x2A,0x72,0x8E,0xE0,0x2F,0xD6,0x95,0xDB,0x03,0xC0,0x81,0xE1,0x53,0xAA,0x3B,0xAA,0x2A,0xDF,0x00,0x58,
+	0x58,0x9E,0xAF,0xF3,0x09,0xCA,0xD6,0x80,0x02,0xE0,0x15,0x69,0x5D,0x4E,0x55,0x0D,0x11,0x80,0x09,0x16,
+	0x27,0xE6,0xDE,0x71,0x44,0x77,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_tbbn0g04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x04,0x00,0x00,0x00,0x00,0x24,0x94,0x0C,0x56,0x00,0x00,0x00,0x02,0x74,0x52,0x4E,
+	0x53,0x00,0x05,0x06,0xF9,0x39,0xB7,0x00,0x00,0x00,0x2C,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0x60,0x54,
+	0x76,0x4D,0x67,0x10,0x32,0x09,0xAB,0x60,0x00,0x32,0x3A,0x19,0x80,0x8C,0x59,0x0C,0x40,0xC6,0x6A,0x06,
+	0x20,0xE3,0x2C,0x43,0x7A,0xE7,0x9E,0x7B,0x0C,0x15,0xAB,0xCF,0xBE,0x07,0x00,0xDB,0xCE,0x0E,0x57,0xBF,
+	0xC6,0x6B,0x00,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_tbrn2c16[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x10,0x02,0x00,0x00,0x00,0x1B,0xFD,0xF5,0x9F,0x00,0x00,0x00,0x06,0x74,0x52,0x4E,
+	0x53,0x6B,0x6C,0xD1,0xD2,0x37,0x38,0xF8,0xB7,0x45,0x4C,0x00,0x00,0x00,0x5D,0x49,0x44,0x41,0x54,0x78,
+	0xDA,0x63,0x64,0x60,0xD0,0xD0,0x08,0x08,0x10,0x14,0x52,0x52,0x36,0x36,0x21,0x86,0x64,0x14,0x12,0x72,
+	0x76,0x2E,0x29,0x21,0x41,0x83,0x8A,0x4A,0x5C,0xDC,0x8C,0x19,0x08,0x21,0x13,0x30,0x69,0x84,0x43,0x83,
+	0x89,0x09,0xA3,0x99,0x59,0x65,0xE5,0x9E,0x3D,0x24,0xD8,0xE0,0xE1,0x31,0x65,0xCA,0x83,0x07,0x24,0x68,
+	0x88,0x8A,0x5A,0xBF,0x9E,0x85,0x85,0x04,0x0D,0x39,0x39,0xA7,0x4E,0x69,0x68,0x90,0xA0,0xA1,0xAE,0xEE,
+	0xE9,0x53,0x1F,0x1F,0xE2,0x35,0x00,0x00,0x1E,0xB1,0x40,0x8A,0xDF,0xD5,0x0E,0x48,0x00,0x00,0x00,0x00,
+	0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_tbbn3p04[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x04,0x03,0x00,0x00,0x00,0x36,0x21,0xA3,0xB8,0x00,0x00,0x00,0x24,0x50,0x4C,0x54,
+	0x45,0x82,0xB7,0x0E,0xEE,0x7F,0x1A,0x50,0x39,0xBE,0xF0,0x7E,0xC2,0x34,0x7F,0x06,0x6E,0xD0,0x8F,0x5D,
+	0xC7,0x51,0x24,0x47,0xE3,0x40,0x43,0x00,0x02,0x6B,0x6E,0x54,0x55,0x94,0xA0,0x65,0x68,0x84,0x50,0x96,
+	0xE3,0x00,0x00,0x00,0x0A,0x74,0x52,0x4E,0x53,0x00,0x14,0x28,0x3C,0x50,0x64,0x78,0x8C,0xA0,0xB4,0x83,
+	0x4F,0xC5,0x41,0x00,0x00,0x00,0x29,0x49,0x44,0x41,0x54,0x78,0xDA,0x63,0x60,0xD7,0xF4,0x4E,0x64,0x90,
+	0xB0,0x0A,0x28,0x62,0x00,0x32,0x9A,0x19,0x80,0x8C,0x29,0x0C,0x40,0xC6,0x52,0x06,0x20,0x63,0x1B,0x03,
+	0x90,0xC1,0xCE,0x00,0x64,0x48,0x00,0x00,0xD2,0xBC,0x0C,0x1D,0x53,0x67,0xA8,0xE6,0x00,0x00,0x00,0x00,
+	0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_z00n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x0A,
+	0x00,0x00,0x00,0x06,0x08,0x02,0x00,0x00,0x00,0x75,0x92,0x98,0x91,0x00,0x00,0x00,0xC5,0x49,0x44,0x41,
+	0x54,0x78,0x01,0x01,0xBA,0x00,0x45,0xFF,0x00,0x00,0x00,0x00,0x0A,0x00,0x00,0x14,0x00,0x00,0x1E,0x00,
+	0x00,0x28,0x00,0x00,0x32,0x00,0x00,0x3C,0x00,0x00,0x46,0x00,0x00,0x50,0x00,0x00,0x5A,0x00,0x00,0x00,
+	0x00,0x0A,0x00,0x0A,0x0A,0x01,0x14,0x0A,0x02,0x1E,0x0A,0x03,0x28,0x0A,0x04,0x32,0x0A,0x05,0x3C,0x0A,
+	0x06,0x46,0x0A,0x07,0x50,0x0A,0x08,0x5A,0x0A,0x09,0x00,0x00,0x14,0x00,0x0A,0x14,0x02,0x14,0x14,0x04,
+	0x1E,0x14,0x06,0x28,0x14,0x08,0x32,0x14,0x0A,0x3C,0x14,0x0C,0x46,0x14,0x0E,0x50,0x14,0x10,0x5A,0x14,
+	0x12,0x00,0x00,0x1E,0x00,0x0A,0x1E,0x03,0x14,0x1E,0x06,0x1E,0x1E,0x09,0x28,0x1E,0x0C,0x32,0x1E,0x0F,
+	0x3C,0x1E,0x12,0x46,0x1E,0x15,0x50,0x1E,0x18,0x5A,0x1E,0x1B,0x00,0x00,0x28,0x00,0x0A,0x28,0x04,0x14,
+	0x28,0x08,0x1E,0x28,0x0C,0x28,0x28,0x10,0x32,0x28,0x14,0x3C,0x28,0x18,0x46,0x28,0x1C,0x50,0x28,0x20,
+	0x5A,0x28,0x24,0x00,0x00,0x32,0x00,0x0A,0x32,0x05,0x14,0x32,0x0A,0x1E,0x32,0x0F,0x28,0x32,0x14,0x32,
+	0x32,0x19,0x3C,0x32,0x1E,0x46,0x32,0x23,0x50,0x32,0x28,0x5A,0x32,0x2D,0x78,0x24,0x13,0x0C,0x99,0x28,
+	0xE1,0x91,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_z03n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x18,
+	0x00,0x00,0x00,0x18,0x08,0x02,0x00,0x00,0x00,0x6F,0x15,0xAA,0xAF,0x00,0x00,0x00,0xC7,0x49,0x44,0x41,
+	0x54,0x78,0x01,0x63,0x64,0x60,0x60,0xE0,0xA2,0x06,0x62,0x04,0x12,0x5C,0x0C,0x8C,0x94,0x23,0x46,0x06,
+	0x11,0xA0,0x41,0x4C,0x94,0x23,0x46,0x06,0x39,0xA0,0x41,0xCC,0x94,0x23,0x46,0x06,0x0D,0xA0,0x41,0x2C,
+	0x94,0x23,0x46,0x06,0x23,0xA0,0x41,0xAC,0x94,0x23,0x46,0x06,0x1B,0xA0,0x41,0x6C,0x94,0x23,0x46,0x06,
+	0x37,0xA0,0x41,0xEC,0x94,0x23,0x46,0x86,0x00,0xA0,0x41,0x1C,0x94,0x23,0x46,0x86,0x28,0xA0,0x41,0x9C,
+	0x94,0x23,0x46,0x86,0x14,0x50,0x92,0xA4,0x1C,0x31,0x32,0xE4,0x01,0x0D,0xE2,0xA6,0x1C,0x31,0x32,0x54,
+	0x00,0x0D,0xE2,0xA1,0x1C,0x31,0x32,0x34,0x01,0x0D,0xE2,0xA5,0x1C,0x31,0x32,0xF4,0x00,0x0D,0xE2,0xA3,
+	0x1C,0x31,0x32,0x4C,0x03,0x1A,0xC4,0x4F,0x39,0x62,0x64,0x58,0x00,0x34,0x48,0x80,0x72,0xC4,0xC8,0xB0,
+	0x0A,0x68,0x90,0x20,0xE5,0x88,0x91,0x61,0x0B,0xD0,0x20,0x21,0xCA,0x11,0x23,0xC3,0x3E,0xA0,0x41,0xC2,
+	0x94,0x23,0x46,0x86,0x13,0x40,0x83,0x44,0x28,0x47,0x8C,0x0C,0x97,0x80,0x06,0x89,0x52,0x8E,0x18,0x19,
+	0xEE,0x00,0x0D,0x12,0xA3,0x1C,0x31,0x32,0x3C,0x03,0x1A,0x24,0x4E,0x39,0x02,0x00,0xD2,0x1A,0x39,0x3D,
+	0x21,0x01,0x93,0x0C,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_z09n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x18,
+	0x00,0x00,0x00,0x18,0x08,0x02,0x00,0x00,0x00,0x6F,0x15,0xAA,0xAF,0x00,0x00,0x00,0x98,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0xAD,0xD2,0x81,0x0E,0x82,0x20,0x10,0x80,0x61,0x4C,0x2C,0xAD,0x4C,0x45,0xC2,0xF7,0x7F,
+	0xD3,0x08,0x12,0x19,0x04,0xDC,0x1D,0x6E,0xFF,0xD8,0x31,0xE7,0x37,0x70,0x72,0xC6,0xD8,0xFD,0x8C,0xF8,
+	0x77,0x61,0x4D,0x7D,0x0E,0xBA,0x54,0xE6,0x43,0x6D,0x4D,0x01,0xC4,0xC9,0xC5,0x50,0x47,0xEB,0x2F,0x74,
+	0x25,0x94,0x82,0x6E,0xD8,0x32,0x50,0x8F,0x2A,0x0F,0x0D,0xF0,0x8A,0x10,0xF4,0xDF,0x86,0x40,0x0F,0x48,
+	0x40,0xE8,0x59,0x0C,0x0E,0x8D,0xE9,0x94,0x5E,0x51,0xD0,0x2B,0x4A,0xBA,0x19,0x0B,0x4D,0x5E,0xAB,0xBF,
+	0x25,0x40,0xB3,0x49,0xEC,0xC3,0x2F,0x1A,0xB4,0xC4,0x11,0x20,0x61,0xDE,0x14,0x41,0x58,0x68,0xDD,0x4F,
+	0x24,0xCC,0x7C,0x84,0x82,0xA4,0x77,0x35,0x0B,0x49,0x17,0xF9,0x1B,0x39,0xE8,0x6D,0x83,0x43,0x2A,0x0D,
+	0xE9,0x47,0xEA,0x94,0x13,0x69,0x68,0xFB,0x00,0x78,0xDC,0x13,0x3B,0x50,0x0F,0x38,0x35,0x00,0x00,0x00,
+	0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_oi9n2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x18,
+	0x00,0x00,0x00,0x18,0x08,0x02,0x00,0x00,0x00,0x6F,0x15,0xAA,0xAF,0x00,0x00,0x00,0x05,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0xED,0xCC,0x2B,0xA6,0x0E,0x89,0xCB,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x63,0x81,
+	0x61,0x00,0x06,0x67,0x8D,0x81,0x28,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0xD0,0xE3,0x32,0x97,0xC7,
+	0x1D,0x5C,0xB2,0x76,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x9D,0x0F,0x6D,0x59,0x96,0x0F,0x63,0x22,
+	0x21,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x97,0x65,0x79,0x59,0x96,0x0A,0x67,0x26,0x4B,0x00,0x00,
+	0x00,0x05,0x49,0x44,0x41,0x54,0x65,0x59,0x96,0x65,0x59,0x58,0xF8,0x53,0x2C,0x00,0x00,0x00,0x05,0x49,
+	0x44,0x41,0x54,0x5E,0x96,0x65,0x79,0xBF,0xB8,0xBB,0xF3,0x72,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,
+	0x63,0xFC,0x85,0xE5,0xB7,0xCF,0x5C,0x05,0xA6,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x9D,0x74,0xEA,
+	0x08,0x15,0x80,0x36,0xB6,0x36,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x9F,0xAC,0x58,0xF3,0xC5,0xAE,
+	0x57,0xB4,0xFC,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x86,0x2D,0xDF,0xEC,0xD8,0xDC,0x64,0xFF,0x13,
+	0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x73,0xE0,0xC8,0x89,0x33,0xEE,0xAC,0x07,0x02,0x00,0x00,0x00,
+	0x05,0x49,0x44,0x41,0x54,0x17,0xAE,0xDC,0xF8,0xE1,0xBC,0x03,0x09,0x62,0x00,0x00,0x00,0x05,0x49,0x44,
+	0x41,0x54,0xCE,0x83,0x27,0xBF,0xD4,0x3A,0xA4,0xE2,0x79,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0xDF,
+	0x4D,0x6A,0xF2,0x42,0xD5,0x4F,0xDC,0xD4,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x43,0x9A,0xF2,0x21,
+	0x2D,0xFE,0x22,0x94,0xB8,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x69,0x4B,0x47,0xBA,0x12,0x0C,0xFD,
+	0x3F,0xF6,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0xE9,0x49,0x5F,0x06,0x32,0x76,0x39,0x74,0x5B,0x00,
+	0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x94,0x91,0x8C,0x65,0x22,0x48,0x33,0x62,0x3A,0x00,0x00,0x00,0x05,
+	0x49,0x44,0x41,0x54,0x53,0x99,0x49,0x25,0x73,0xAD,0xC3,0x04,0xD2,0x00,0x00,0x00,0x05,0x49,0x44,0x41,
+	0x54,0x59,0xC8,0xB2,0x44,0x25,0xD3,0xBD,0x46,0xA2,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0x2A,0x51,
+	0x89,0x4A,0x54,0x3C,0x38,0x14,0xC6,0x00,0x00,0x00,0x05,0x49,0x44,0x41,0x54,0xA2,0xFF,0x47,0x7F,0x3A,
+	0x83,0x10,0xB4,0x00,0x00,0x00,0x00,0x03,0x49,0x44,0x41,0x54,0x31,0x39,0x55,0xC9,0xE6,0xE9,0xC4,0x00,
+	0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_ctzn2c08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x18,
+	0x00,0x00,0x00,0x18,0x08,0x02,0x00,0x00,0x00,0x6F,0x15,0xAA,0xAF,0x00,0x00,0x00,0x0A,0x74,0x45,0x58,
+	0x74,0x54,0x69,0x74,0x6C,0x65,0x00,0x4E,0x58,0x47,0x49,0x23,0x00,0x2C,0x8D,0x00,0x00,0x00,0x04,0x67,
+	0x41,0x4D,0x41,0x00,0x00,0xB1,0x8F,0x0B,0xFC,0x61,0x05,0x00,0x00,0x00,0x99,0x49,0x44,0x41,0x54,0x78,
+	0xDA,0xAD,0xD2,0xAB,0x16,0x41,0x01,0x00,0x44,0xD1,0x33,0xDE,0xAE,0x37,0x17,0x4D,0x96,0x65,0x59,0x96,
+	0x65,0x59,0x96,0x65,0x59,0x96,0x65,0x59,0x96,0x65,0xD9,0x77,0x18,0xDF,0x30,0xD6,0xDA,0x6B,0xE2,0x49,
+	0x23,0xA0,0xF8,0x07,0x79,0x0A,0x94,0x13,0xA5,0x43,0x95,0x9C,0x58,0x38,0x54,0xCD,0x89,0xA5,0x43,0xB5,
+	0x9C,0x58,0x39,0x54,0xCF,0x89,0xB5,0x43,0x8D,0x9C,0xD8,0x38,0xD4,0xCC,0x89,0xAD,0x43,0xAD,0x9C,0xD8,
+	0x39,0xD4,0xCE,0x89,0xFD,0xEF,0x92,0x39,0x71,0x70,0xA8,0x93,0x13,0x47,0x87,0xBA,0x39,0x71,0x72,0xA8,
+	0x97,0x13,0x67,0x87,0xFA,0x39,0x71,0x71,0x68,0x90,0x13,0x57,0x87,0x86,0x39,0x71,0x73,0x68,0x94,0x13,
+	0x77,0x87,0xC6,0x39,0xF1,0x70,0x68,0x92,0x13,0x4F,0x87,0xCA,0x9C,0x78,0x39,0x34,0xCD,0x89,0xB7,0x43,
+	0xB3,0x9C,0xF8,0x38,0x34,0xCF,0x7D,0x01,0xD2,0x1A,0x39,0x3D,0x1D,0x4B,0xBB,0x91,0x00,0x00,0x00,0x00,
+	0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_xs1n0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0B,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x00,0x00,0x00,0x00,0xE1,0x64,0xE1,0x57,0x00,0x00,0x00,0x53,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x48,0x00,0xB7,0xFF,0x00,0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x00,0x12,0x23,
+	0x34,0x45,0x56,0x67,0x78,0x89,0x00,0x24,0x35,0x46,0x57,0x68,0x79,0x8A,0x9B,0x00,0x36,0x47,0x58,0x69,
+	0x7A,0x8B,0x9C,0xAD,0x00,0x48,0x59,0x6A,0x7B,0x8C,0x9D,0xAE,0xBF,0x00,0x5A,0x6B,0x7C,0x8D,0x9E,0xAF,
+	0xC0,0xD1,0x00,0x6C,0x7D,0x8E,0x9F,0xB0,0xC1,0xD2,0xE3,0x00,0x7E,0x8F,0xA0,0xB1,0xC2,0xD3,0xE4,0xF5,
+	0x64,0x05,0x1E,0xA1,0x72,0x77,0xBB,0xF4,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_xcrn0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x00,0x00,0x00,0x00,0xE1,0x64,0xE1,0x57,0x00,0x00,0x00,0x53,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x48,0x00,0xB7,0xFF,0x00,0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x00,0x12,0x23,
+	0x34,0x45,0x56,0x67,0x78,0x89,0x00,0x24,0x35,0x46,0x57,0x68,0x79,0x8A,0x9B,0x00,0x36,0x47,0x58,0x69,
+	0x7A,0x8B,0x9C,0xAD,0x00,0x48,0x59,0x6A,0x7B,0x8C,0x9D,0xAE,0xBF,0x00,0x5A,0x6B,0x7C,0x8D,0x9E,0xAF,
+	0xC0,0xD1,0x00,0x6C,0x7D,0x8E,0x9F,0xB0,0xC1,0xD2,0xE3,0x00,0x7E,0x8F,0xA0,0xB1,0xC2,0xD3,0xE4,0xF5,
+	0x64,0x05,0x1E,0xA1,0x72,0x77,0xBB,0xF5,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_xd9n0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x09,0x00,0x00,0x00,0x00,0xDC,0x04,0xC8,0xE7,0x00,0x00,0x00,0x53,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x48,0x00,0xB7,0xFF,0x00,0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x00,0x12,0x23,
+	0x34,0x45,0x56,0x67,0x78,0x89,0x00,0x24,0x35,0x46,0x57,0x68,0x79,0x8A,0x9B,0x00,0x36,0x47,0x58,0x69,
+	0x7A,0x8B,0x9C,0xAD,0x00,0x48,0x59,0x6A,0x7B,0x8C,0x9D,0xAE,0xBF,0x00,0x5A,0x6B,0x7C,0x8D,0x9E,0xAF,
+	0xC0,0xD1,0x00,0x6C,0x7D,0x8E,0x9F,0xB0,0xC1,0xD2,0xE3,0x00,0x7E,0x8F,0xA0,0xB1,0xC2,0xD3,0xE4,0xF5,
+	0x64,0x05,0x1E,0xA1,0x72,0x77,0xBB,0xF4,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_xtrn0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x00,0x00,0x00,0x00,0xE1,0x64,0xE1,0x57,0x00,0x00,0x00,0x53,0x49,0x44,0x41,
+	0x54,0x78,0xDA,0x01,0x48,0x00,0xB7,0xFF,0x00,0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x00,0x12,0x23,
+};
+
+static const uint8_t image_fx_xcsn0g08[] = {
+	0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A,0x00,0x00,0x00,0x0D,0x49,0x48,0x44,0x52,0x00,0x00,0x00,0x08,
+	0x00,0x00,0x00,0x08,0x08,0x00,0x00,0x00,0x00,0xE1,0x64,0xE1,0x57,0x00,0x00,0x00,0x03,0x41,0x42,0x43,
+	0x44,0x78,0x79,0x7A,0x22,0x6A,0x84,0x52,0x00,0x00,0x00,0x53,0x49,0x44,0x41,0x54,0x78,0xDA,0x01,0x48,
+	0x00,0xB7,0xFF,0x00,0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x00,0x12,0x23,0x34,0x45,0x56,0x67,0x78,
+	0x89,0x00,0x24,0x35,0x46,0x57,0x68,0x79,0x8A,0x9B,0x00,0x36,0x47,0x58,0x69,0x7A,0x8B,0x9C,0xAD,0x00,
+	0x48,0x59,0x6A,0x7B,0x8C,0x9D,0xAE,0xBF,0x00,0x5A,0x6B,0x7C,0x8D,0x9E,0xAF,0xC0,0xD1,0x00,0x6C,0x7D,
+	0x8E,0x9F,0xB0,0xC1,0xD2,0xE3,0x00,0x7E,0x8F,0xA0,0xB1,0xC2,0xD3,0xE4,0xF5,0x64,0x05,0x1E,0xA1,0x72,
+	0x77,0xBB,0xF4,0x00,0x00,0x00,0x00,0x49,0x45,0x4E,0x44,0xAE,0x42,0x60,0x82,
+};
+
+static const uint8_t image_fx_b24n[] = {
+	0x42,0x4D,0x32,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x18,0x00,0x00,0x00,0x00,0x00,0xFC,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xDE,0x00,0x1E,0xDE,0x17,
+	0x3C,0xDE,0x2E,0x5A,0xDE,0x45,0x78,0xDE,0x5C,0x96,0xDE,0x73,0xB4,0xDE,0x8A,0xD2,0xDE,0xA1,0xF0,0xDE,
+	0xB8,0x0E,0xDE,0xCF,0x2C,0xDE,0xE6,0x00,0x00,0x00,0x00,0xB9,0x00,0x19,0xB9,0x17,0x32,0xB9,0x2E,0x4B,
+	0xB9,0x45,0x64,0xB9,0x5C,0x7D,0xB9,0x73,0x96,0xB9,0x8A,0xAF,0xB9,0xA1,0xC8,0xB9,0xB8,0xE1,0xB9,0xCF,
+	0xFA,0xB9,0xE6,0x00,0x00,0x00,0x00,0x94,0x00,0x14,0x94,0x17,0x28,0x94,0x2E,0x3C,0x94,0x45,0x50,0x94,
+	0x5C,0x64,0x94,0x73,0x78,0x94,0x8A,0x8C,0x94,0xA1,0xA0,0x94,0xB8,0xB4,0x94,0xCF,0xC8,0x94,0xE6,0x00,
+	0x00,0x00,0x00,0x6F,0x00,0x0F,0x6F,0x17,0x1E,0x6F,0x2E,0x2D,0x6F,0x45,0x3C,0x6F,0x5C,0x4B,0x6F,0x73,
+	0x5A,0x6F,0x8A,0x69,0x6F,0xA1,0x78,0x6F,0xB8,0x87,0x6F,0xCF,0x96,0x6F,0xE6,0x00,0x00,0x00,0x00,0x4A,
+	0x00,0x0A,0x4A,0x17,0x14,0x4A,0x2E,0x1E,0x4A,0x45,0x28,0x4A,0x5C,0x32,0x4A,0x73,0x3C,0x4A,0x8A,0x46,
+	0x4A,0xA1,0x50,0x4A,0xB8,0x5A,0x4A,0xCF,0x64,0x4A,0xE6,0x00,0x00,0x00,0x00,0x25,0x00,0x05,0x25,0x17,
+	0x0A,0x25,0x2E,0x0F,0x25,0x45,0x14,0x25,0x5C,0x19,0x25,0x73,0x1E,0x25,0x8A,0x23,0x25,0xA1,0x28,0x25,
+	0xB8,0x2D,0x25,0xCF,0x32,0x25,0xE6,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x17,0x00,0x00,0x2E,0x00,
+	0x00,0x45,0x00,0x00,0x5C,0x00,0x00,0x73,0x00,0x00,0x8A,0x00,0x00,0xA1,0x00,0x00,0xB8,0x00,0x00,0xCF,
+	0x00,0x00,0xE6,0x00,0x00,0x00,
+};
+
+static const uint8_t image_fx_b24t[] = {
+	0x42,0x4D,0x32,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0xF9,0xFF,0xFF,0xFF,0x01,0x00,0x18,0x00,0x00,0x00,0x00,0x00,0xFC,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x17,
+	0x00,0x00,0x2E,0x00,0x00,0x45,0x00,0x00,0x5C,0x00,0x00,0x73,0x00,0x00,0x8A,0x00,0x00,0xA1,0x00,0x00,
+	0xB8,0x00,0x00,0xCF,0x00,0x00,0xE6,0x00,0x00,0x00,0x00,0x25,0x00,0x05,0x25,0x17,0x0A,0x25,0x2E,0x0F,
+	0x25,0x45,0x14,0x25,0x5C,0x19,0x25,0x73,0x1E,0x25,0x8A,0x23,0x25,0xA1,0x28,0x25,0xB8,0x2D,0x25,0xCF,
+	0x32,0x25,0xE6,0x00,0x00,0x00,0x00,0x4A,0x00,0x0A,0x4A,0x17,0x14,0x4A,0x2E,0x1E,0x4A,0x45,0x28,0x4A,
+	0x5C,0x32,0x4A,0x73,0x3C,0x4A,0x8A,0x46,0x4A,0xA1,0x50,0x4A,0xB8,0x5A,0x4A,0xCF,0x64,0x4A,0xE6,0x00,
+	0x00,0x00,0x00,0x6F,0x00,0x0F,0x6F,0x17,0x1E,0x6F,0x2E,0x2D,0x6F,0x45,0x3C,0x6F,0x5C,0x4B,0x6F,0x73,
+	0x5A,0x6F,0x8A,0x69,0x6F,0xA1,0x78,0x6F,0xB8,0x87,0x6F,0xCF,0x96,0x6F,0xE6,0x00,0x00,0x00,0x00,0x94,
+	0x00,0x14,0x94,0x17,0x28,0x94,0x2E,0x3C,0x94,0x45,0x50,0x94,0x5C,0x64,0x94,0x73,0x78,0x94,0x8A,0x8C,
+	0x94,0xA1,0xA0,0x94,0xB8,0xB4,0x94,0xCF,0xC8,0x94,0xE6,0x00,0x00,0x00,0x00,0xB9,0x00,0x19,0xB9,0x17,
+	0x32,0xB9,0x2E,0x4B,0xB9,0x45,0x64,0xB9,0x5C,0x7D,0xB9,0x73,0x96,0xB9,0x8A,0xAF,0xB9,0xA1,0xC8,0xB9,
+	0xB8,0xE1,0xB9,0xCF,0xFA,0xB9,0xE6,0x00,0x00,0x00,0x00,0xDE,0x00,0x1E,0xDE,0x17,0x3C,0xDE,0x2E,0x5A,
+	0xDE,0x45,0x78,0xDE,0x5C,0x96,0xDE,0x73,0xB4,0xDE,0x8A,0xD2,0xDE,0xA1,0xF0,0xDE,0xB8,0x0E,0xDE,0xCF,
+	0x2C,0xDE,0xE6,0x00,0x00,0x00,
+};
+
+static const uint8_t image_fx_b32n[] = {
+	0x42,0x4D,0x6A,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x20,0x00,0x00,0x00,0x00,0x00,0x34,0x01,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xDE,0x00,0x5A,0x1E,0xDE,
+	0x17,0x5A,0x3C,0xDE,0x2E,0x5A,0x5A,0xDE,0x45,0x5A,0x78,0xDE,0x5C,0x5A,0x96,0xDE,0x73,0x5A,0xB4,0xDE,
+	0x8A,0x5A,0xD2,0xDE,0xA1,0x5A,0xF0,0xDE,0xB8,0x5A,0x0E,0xDE,0xCF,0x5A,0x2C,0xDE,0xE6,0x5A,0x00,0xB9,
+	0x00,0x5A,0x19,0xB9,0x17,0x5A,0x32,0xB9,0x2E,0x5A,0x4B,0xB9,0x45,0x5A,0x64,0xB9,0x5C,0x5A,0x7D,0xB9,
+	0x73,0x5A,0x96,0xB9,0x8A,0x5A,0xAF,0xB9,0xA1,0x5A,0xC8,0xB9,0xB8,0x5A,0xE1,0xB9,0xCF,0x5A,0xFA,0xB9,
+	0xE6,0x5A,0x00,0x94,0x00,0x5A,0x14,0x94,0x17,0x5A,0x28,0x94,0x2E,0x5A,0x3C,0x94,0x45,0x5A,0x50,0x94,
+	0x5C,0x5A,0x64,0x94,0x73,0x5A,0x78,0x94,0x8A,0x5A,0x8C,0x94,0xA1,0x5A,0xA0,0x94,0xB8,0x5A,0xB4,0x94,
+	0xCF,0x5A,0xC8,0x94,0xE6,0x5A,0x00,0x6F,0x00,0x5A,0x0F,0x6F,0x17,0x5A,0x1E,0x6F,0x2E,0x5A,0x2D,0x6F,
+	0x45,0x5A,0x3C,0x6F,0x5C,0x5A,0x4B,0x6F,0x73,0x5A,0x5A,0x6F,0x8A,0x5A,0x69,0x6F,0xA1,0x5A,0x78,0x6F,
+	0xB8,0x5A,0x87,0x6F,0xCF,0x5A,0x96,0x6F,0xE6,0x5A,0x00,0x4A,0x00,0x5A,0x0A,0x4A,0x17,0x5A,0x14,0x4A,
+	0x2E,0x5A,0x1E,0x4A,0x45,0x5A,0x28,0x4A,0x5C,0x5A,0x32,0x4A,0x73,0x5A,0x3C,0x4A,0x8A,0x5A,0x46,0x4A,
+	0xA1,0x5A,0x50,0x4A,0xB8,0x5A,0x5A,0x4A,0xCF,0x5A,0x64,0x4A,0xE6,0x5A,0x00,0x25,0x00,0x5A,0x05,0x25,
+	0x17,0x5A,0x0A,0x25,0x2E,0x5A,0x0F,0x25,0x45,0x5A,0x14,0x25,0x5C,0x5A,0x19,0x25,0x73,0x5A,0x1E,0x25,
+	0x8A,0x5A,0x23,0x25,0xA1,0x5A,0x28,0x25,0xB8,0x5A,0x2D,0x25,0xCF,0x5A,0x32,0x25,0xE6,0x5A,0x00,0x00,
+	0x00,0x5A,0x00,0x00,0x17,0x5A,0x00,0x00,0x2E,0x5A,0x00,0x00,0x45,0x5A,0x00,0x00,0x5C,0x5A,0x00,0x00,
+	0x73,0x5A,0x00,0x00,0x8A,0x5A,0x00,0x00,0xA1,0x5A,0x00,0x00,0xB8,0x5A,0x00,0x00,0xCF,0x5A,0x00,0x00,
+	0xE6,0x5A,
+};
+
+static const uint8_t image_fx_b32a[] = {
+	0x42,0x4D,0xAE,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x7A,0x00,0x00,0x00,0x6C,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x20,0x00,0x03,0x00,0x00,0x00,0x34,0x01,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xFF,0x00,0x00,
+	0xFF,0x00,0x00,0xFF,0x00,0x00,0xFF,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+	0x00,0x00,0x66,0x00,0xDE,0x00,0x85,0x1E,0xDE,0x17,0xA4,0x3C,0xDE,0x2E,0xC3,0x5A,0xDE,0x45,0xE2,0x78,
+	0xDE,0x5C,0x01,0x96,0xDE,0x73,0x20,0xB4,0xDE,0x8A,0x3F,0xD2,0xDE,0xA1,0x5E,0xF0,0xDE,0xB8,0x7D,0x0E,
+	0xDE,0xCF,0x9C,0x2C,0xDE,0xE6,0x55,0x00,0xB9,0x00,0x74,0x19,0xB9,0x17,0x93,0x32,0xB9,0x2E,0xB2,0x4B,
+	0xB9,0x45,0xD1,0x64,0xB9,0x5C,0xF0,0x7D,0xB9,0x73,0x0F,0x96,0xB9,0x8A,0x2E,0xAF,0xB9,0xA1,0x4D,0xC8,
+	0xB9,0xB8,0x6C,0xE1,0xB9,0xCF,0x8B,0xFA,0xB9,0xE6,0x44,0x00,0x94,0x00,0x63,0x14,0x94,0x17,0x82,0x28,
+	0x94,0x2E,0xA1,0x3C,0x94,0x45,0xC0,0x50,0x94,0x5C,0xDF,0x64,0x94,0x73,0xFE,0x78,0x94,0x8A,0x1D,0x8C,
+	0x94,0xA1,0x3C,0xA0,0x94,0xB8,0x5B,0xB4,0x94,0xCF,0x7A,0xC8,0x94,0xE6,0x33,0x00,0x6F,0x00,0x52,0x0F,
+	0x6F,0x17,0x71,0x1E,0x6F,0x2E,0x90,0x2D,0x6F,0x45,0xAF,0x3C,0x6F,0x5C,0xCE,0x4B,0x6F,0x73,0xED,0x5A,
+	0x6F,0x8A,0x0C,0x69,0x6F,0xA1,0x2B,0x78,0x6F,0xB8,0x4A,0x87,0x6F,0xCF,0x69,0x96,0x6F,0xE6,0x22,0x00,
+	0x4A,0x00,0x41,0x0A,0x4A,0x17,0x60,0x14,0x4A,0x2E,0x7F,0x1E,0x4A,0x45,0x9E,0x28,0x4A,0x5C,0xBD,0x32,
+	0x4A,0x73,0xDC,0x3C,0x4A,0x8A,0xFB,0x46,0x4A,0xA1,0x1A,0x50,0x4A,0xB8,0x39,0x5A,0x4A,0xCF,0x58,0x64,
+	0x4A,0xE6,0x11,0x00,0x25,0x00,0x30,0x05,0x25,0x17,0x4F,0x0A,0x25,0x2E,0x6E,0x0F,0x25,0x45,0x8D,0x14,
+	0x25,0x5C,0xAC,0x19,0x25,0x73,0xCB,0x1E,0x25,0x8A,0xEA,0x23,0x25,0xA1,0x09,0x28,0x25,0xB8,0x28,0x2D,
+	0x25,0xCF,0x47,0x32,0x25,0xE6,0x00,0x00,0x00,0x00,0x1F,0x00,0x00,0x17,0x3E,0x00,0x00,0x2E,0x5D,0x00,
+	0x00,0x45,0x7C,0x00,0x00,0x5C,0x9B,0x00,0x00,0x73,0xBA,0x00,0x00,0x8A,0xD9,0x00,0x00,0xA1,0xF8,0x00,
+	0x00,0xB8,0x17,0x00,0x00,0xCF,0x36,0x00,0x00,0xE6,
+};
+
+static const uint8_t image_fx_b16n[] = {
+	0x42,0x4D,0xDE,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0xA8,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xC6,0x03,0xC7,0x0F,0xC8,0x1B,
+	0xC9,0x27,0xCA,0x33,0xCB,0x3F,0xCC,0x4B,0xCD,0x57,0xCE,0x63,0xCF,0x6F,0xD0,0x7B,0x00,0x00,0x25,0x03,
+	0x26,0x0F,0x27,0x1B,0x28,0x27,0x29,0x33,0x2A,0x3F,0x2B,0x4B,0x2C,0x57,0x2D,0x63,0x2E,0x6F,0x2F,0x7B,
+	0x00,0x00,0x84,0x02,0x85,0x0E,0x86,0x1A,0x87,0x26,0x88,0x32,0x89,0x3E,0x8A,0x4A,0x8B,0x56,0x8C,0x62,
+	0x8D,0x6E,0x8E,0x7A,0x00,0x00,0xE3,0x01,0xE4,0x0D,0xE5,0x19,0xE6,0x25,0xE7,0x31,0xE8,0x3D,0xE9,0x49,
+	0xEA,0x55,0xEB,0x61,0xEC,0x6D,0xED,0x79,0x00,0x00,0x42,0x01,0x43,0x0D,0x44,0x19,0x45,0x25,0x46,0x31,
+	0x47,0x3D,0x48,0x49,0x49,0x55,0x4A,0x61,0x4B,0x6D,0x4C,0x79,0x00,0x00,0xA1,0x00,0xA2,0x0C,0xA3,0x18,
+	0xA4,0x24,0xA5,0x30,0xA6,0x3C,0xA7,0x48,0xA8,0x54,0xA9,0x60,0xAA,0x6C,0xAB,0x78,0x00,0x00,0x00,0x00,
+	0x01,0x0C,0x02,0x18,0x03,0x24,0x04,0x30,0x05,0x3C,0x06,0x48,0x07,0x54,0x08,0x60,0x09,0x6C,0x0A,0x78,
+	0x00,0x00,
+};
+
+static const uint8_t image_fx_b16f[] = {
+	0x42,0x4D,0xEA,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x42,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x10,0x00,0x03,0x00,0x00,0x00,0xA8,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xF8,0x00,0x00,0xE0,0x07,
+	0x00,0x00,0x1F,0x00,0x00,0x00,0xC6,0x06,0xC7,0x1E,0xC8,0x36,0xC9,0x4E,0xCA,0x66,0xCB,0x7E,0xCC,0x96,
+	0xCD,0xAE,0xCE,0xC6,0xCF,0xDE,0xD0,0xF6,0x00,0x00,0xA5,0x05,0xA6,0x1D,0xA7,0x35,0xA8,0x4D,0xA9,0x65,
+	0xAA,0x7D,0xAB,0x95,0xAC,0xAD,0xAD,0xC5,0xAE,0xDD,0xAF,0xF5,0x00,0x00,0x84,0x04,0x85,0x1C,0x86,0x34,
+	0x87,0x4C,0x88,0x64,0x89,0x7C,0x8A,0x94,0x8B,0xAC,0x8C,0xC4,0x8D,0xDC,0x8E,0xF4,0x00,0x00,0x63,0x03,
+	0x64,0x1B,0x65,0x33,0x66,0x4B,0x67,0x63,0x68,0x7B,0x69,0x93,0x6A,0xAB,0x6B,0xC3,0x6C,0xDB,0x6D,0xF3,
+	0x00,0x00,0x42,0x02,0x43,0x1A,0x44,0x32,0x45,0x4A,0x46,0x62,0x47,0x7A,0x48,0x92,0x49,0xAA,0x4A,0xC2,
+	0x4B,0xDA,0x4C,0xF2,0x00,0x00,0x21,0x01,0x22,0x19,0x23,0x31,0x24,0x49,0x25,0x61,0x26,0x79,0x27,0x91,
+	0x28,0xA9,0x29,0xC1,0x2A,0xD9,0x2B,0xF1,0x00,0x00,0x00,0x00,0x01,0x18,0x02,0x30,0x03,0x48,0x04,0x60,
+	0x05,0x78,0x06,0x90,0x07,0xA8,0x08,0xC0,0x09,0xD8,0x0A,0xF0,0x00,0x00,
+};
+
+static const uint8_t image_fx_b01p[] = {
+	0x42,0x4D,0x5A,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x3E,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x1C,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xD6,0xD6,0x54,0x00,0x6E,0xF5,
+	0x90,0x00,0x55,0x40,0x00,0x00,0xAA,0xA0,0x00,0x00,0x55,0x40,0x00,0x00,0xAA,0xA0,0x00,0x00,0x55,0x40,
+	0x00,0x00,0xAA,0xA0,0x00,0x00,0x55,0x40,0x00,0x00,
+};
+
+static const uint8_t image_fx_b04p[] = {
+	0x42,0x4D,0xAE,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x76,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x04,0x00,0x00,0x00,0x00,0x00,0x38,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x6F,0x5D,0xC4,0x00,0x56,0x63,
+	0x55,0x00,0x91,0x4D,0x2E,0x00,0xEF,0xE1,0x06,0x00,0x56,0x0E,0x3B,0x00,0x9B,0xE3,0xFB,0x00,0x82,0x2B,
+	0xFF,0x00,0x9C,0xA7,0x50,0x00,0x11,0xBB,0x26,0x00,0xAD,0xA1,0x6D,0x00,0x31,0x9F,0x23,0x00,0xFA,0x4E,
+	0x7D,0x00,0x8C,0x88,0x91,0x00,0xFD,0x2F,0x65,0x00,0xA6,0x49,0x4E,0x00,0x43,0x65,0xF5,0x00,0xE1,0x47,
+	0xAD,0x03,0x69,0xC0,0x00,0x00,0x9C,0xF2,0x58,0xBE,0x14,0x70,0x00,0x00,0x47,0xAD,0x03,0x69,0xCF,0x20,
+	0x00,0x00,0xF2,0x58,0xBE,0x14,0x7A,0xD0,0x00,0x00,0xAD,0x03,0x69,0xCF,0x25,0x80,0x00,0x00,0x58,0xBE,
+	0x14,0x7A,0xD0,0x30,0x00,0x00,0x03,0x69,0xCF,0x25,0x8B,0xE0,0x00,0x00,
+};
+
+static const uint8_t image_fx_b08p[] = {
+	0x42,0x4D,0xDA,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x86,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x08,0x00,0x00,0x00,0x00,0x00,0x54,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x5B,0x42,0x39,0x00,0xED,0x43,
+	0x73,0x00,0x6D,0x6B,0xD5,0x00,0x53,0xC8,0x49,0x00,0x67,0x60,0x43,0x00,0x7A,0xD0,0x0E,0x00,0xD7,0x30,
+	0x23,0x00,0x5A,0x42,0xA1,0x00,0xE5,0x77,0x8A,0x00,0x06,0x66,0x43,0x00,0x28,0x85,0x91,0x00,0xD5,0x3F,
+	0x8E,0x00,0xBC,0x67,0x55,0x00,0xDB,0x10,0x23,0x00,0x51,0xBF,0xF9,0x00,0xC5,0x83,0xC1,0x00,0x58,0x75,
+	0x59,0x00,0xD7,0x61,0x9E,0x00,0x65,0x71,0x0F,0x00,0xB7,0xA5,0x1F,0x00,0x0A,0x0D,0x10,0x13,0x02,0x05,
+	0x08,0x0B,0x0E,0x11,0x00,0x00,0x05,0x08,0x0B,0x0E,0x11,0x00,0x03,0x06,0x09,0x0C,0x0F,0x00,0x00,0x03,
+	0x06,0x09,0x0C,0x0F,0x12,0x01,0x04,0x07,0x0A,0x00,0x0F,0x12,0x01,0x04,0x07,0x0A,0x0D,0x10,0x13,0x02,
+	0x05,0x00,0x0A,0x0D,0x10,0x13,0x02,0x05,0x08,0x0B,0x0E,0x11,0x00,0x00,0x05,0x08,0x0B,0x0E,0x11,0x00,
+	0x03,0x06,0x09,0x0C,0x0F,0x00,0x00,0x03,0x06,0x09,0x0C,0x0F,0x12,0x01,0x04,0x07,0x0A,0x00,
+};
+
+static const uint8_t image_fx_b08c[] = {
+	0x42,0x4D,0xAA,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x56,0x00,0x00,0x00,0x0C,0x00,0x00,0x00,0x0B,0x00,
+	0x07,0x00,0x01,0x00,0x08,0x00,0x5B,0x42,0x39,0xED,0x43,0x73,0x6D,0x6B,0xD5,0x53,0xC8,0x49,0x67,0x60,
+	0x43,0x7A,0xD0,0x0E,0xD7,0x30,0x23,0x5A,0x42,0xA1,0xE5,0x77,0x8A,0x06,0x66,0x43,0x28,0x85,0x91,0xD5,
+	0x3F,0x8E,0xBC,0x67,0x55,0xDB,0x10,0x23,0x51,0xBF,0xF9,0xC5,0x83,0xC1,0x58,0x75,0x59,0xD7,0x61,0x9E,
+	0x65,0x71,0x0F,0xB7,0xA5,0x1F,0x0A,0x0D,0x10,0x13,0x02,0x05,0x08,0x0B,0x0E,0x11,0x00,0x00,0x05,0x08,
+	0x0B,0x0E,0x11,0x00,0x03,0x06,0x09,0x0C,0x0F,0x00,0x00,0x03,0x06,0x09,0x0C,0x0F,0x12,0x01,0x04,0x07,
+	0x0A,0x00,0x0F,0x12,0x01,0x04,0x07,0x0A,0x0D,0x10,0x13,0x02,0x05,0x00,0x0A,0x0D,0x10,0x13,0x02,0x05,
+	0x08,0x0B,0x0E,0x11,0x00,0x00,0x05,0x08,0x0B,0x0E,0x11,0x00,0x03,0x06,0x09,0x0C,0x0F,0x00,0x00,0x03,
+	0x06,0x09,0x0C,0x0F,0x12,0x01,0x04,0x07,0x0A,0x00,
+};
+
+static const uint8_t image_fx_b04r[] = {
+	0x42,0x4D,0x9C,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x76,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x04,0x00,0x02,0x00,0x00,0x00,0x26,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x5A,0x3B,0xD1,0x00,0x94,0x73,
+	0xC2,0x00,0x3B,0x73,0x0E,0x00,0x50,0x33,0x04,0x00,0xCF,0xC1,0x9B,0x00,0x25,0xB7,0xA6,0x00,0x51,0x90,
+	0xAD,0x00,0x30,0x23,0x39,0x00,0x37,0xA1,0x8A,0x00,0xB0,0x11,0x94,0x00,0xF4,0x31,0xC5,0x00,0x60,0x61,
+	0xF3,0x00,0x7E,0x84,0x42,0x00,0xDF,0x16,0x19,0x00,0xBD,0xA8,0x13,0x00,0x4D,0xE8,0xF1,0x00,0x05,0x37,
+	0x00,0x05,0x12,0x34,0x50,0x00,0x00,0x00,0x0B,0x92,0x00,0x00,0x00,0x02,0x03,0x01,0x00,0x03,0x67,0x80,
+	0x02,0x11,0x00,0x00,0x00,0x06,0xFE,0xDC,0xBA,0x00,0x00,0x00,0x04,0x56,0x00,0x01,
+};
+
+static const uint8_t image_fx_b08r[] = {
+	0x42,0x4D,0xA2,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x76,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x08,0x00,0x01,0x00,0x00,0x00,0x2C,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x10,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x9A,0x43,0xA1,0x00,0x54,0xDF,
+	0x62,0x00,0xFC,0x37,0x4F,0x00,0x4F,0x6F,0x70,0x00,0x0E,0x6F,0xF1,0x00,0x20,0xD8,0x25,0x00,0x53,0xFF,
+	0x43,0x00,0x95,0x1C,0x41,0x00,0x30,0xAC,0xAD,0x00,0x87,0x8B,0x7A,0x00,0x46,0x90,0x07,0x00,0x59,0xDF,
+	0xB4,0x00,0x8D,0xCD,0x66,0x00,0x31,0xBB,0x0D,0x00,0xFE,0x95,0x93,0x00,0x73,0x3A,0x3B,0x00,0x05,0x03,
+	0x00,0x05,0x01,0x02,0x03,0x04,0x05,0x00,0x00,0x00,0x0B,0x09,0x00,0x00,0x00,0x02,0x03,0x01,0x00,0x03,
+	0x06,0x07,0x08,0x00,0x02,0x01,0x00,0x00,0x00,0x06,0x0F,0x0E,0x0D,0x0C,0x0B,0x0A,0x00,0x00,0x04,0x05,
+	0x00,0x01,
+};
+
+static const uint8_t image_fx_b24x[] = {
+	0x42,0x4D,0x32,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x36,0x00,0x00,0x00,0x28,0x00,0x00,0x00,0x0B,0x00,
+	0x00,0x00,0x07,0x00,0x00,0x00,0x01,0x00,0x18,0x00,0x00,0x00,0x00,0x00,0xFC,0x00,0x00,0x00,0x13,0x0B,
+	0x00,0x00,0x13,0x0B,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x03,0x02,0x01,0x03,0x02,0x01,
+	0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,
+	0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x00,0x00,0x00,0x03,0x02,0x01,0x03,0x02,0x01,0x03,0x02,0x01,0x03,
+};
+
+static const IMAGE_FIXTURE image_fixtures[] = {
+	{ "basn0g01", image_fx_basn0g01, sizeof(image_fx_basn0g01), 0x8319E0C5 },
+	{ "basn0g02", image_fx_basn0g02, sizeof(image_fx_basn0g02), 0x4E74EFD2 },
+	{ "basn0g04", image_fx_basn0g04, sizeof(image_fx_basn0g04), 0x364358A9 },
+	{ "basn0g08", image_fx_basn0g08, sizeof(image_fx_basn0g08), 0x5E0B15E5 },
+	{ "basn0g16", image_fx_basn0g16, sizeof(image_fx_basn0g16), 0x5E0B15E5 },
+	{ "basn2c08", image_fx_basn2c08, sizeof(image_fx_basn2c08), 0x0C2D7F75 },
+	{ "basn2c16", image_fx_basn2c16, sizeof(image_fx_basn2c16), 0x7ED7FB87 },
+	{ "basn4g08", image_fx_basn4g08, sizeof(image_fx_basn4g08), 0xD2241725 },
+	{ "basn4g16", image_fx_basn4g16, sizeof(image_fx_basn4g16), 0xD2241725 },
+	{ "basn6a08", image_fx_basn6a08, sizeof(image_fx_basn6a08), 0x1659C075 },
+	{ "basn6a16", image_fx_basn6a16, sizeof(image_fx_basn6a16), 0x6C9BD52F },
+	{ "basn3p01", image_fx_basn3p01, sizeof(image_fx_basn3p01), 0x1028CAC5 },
+	{ "basn3p02", image_fx_basn3p02, sizeof(image_fx_basn3p02), 0xC9184885 },
+	{ "basn3p04", image_fx_basn3p04, sizeof(image_fx_basn3p04), 0x8CA38225 },
+	{ "basn3p08", image_fx_basn3p08, sizeof(image_fx_basn3p08), 0xB2C03644 },
+	{ "basi0g04", image_fx_basi0g04, sizeof(image_fx_basi0g04), 0x13FB9FAB },
+	{ "basi2c08", image_fx_basi2c08, sizeof(image_fx_basi2c08), 0x9FBD0360 },
+	{ "basi6a16", image_fx_basi6a16, sizeof(image_fx_basi6a16), 0x7899FE27 },
+	{ "basi4a08", image_fx_basi4a08, sizeof(image_fx_basi4a08), 0xD2241725 },
+	{ "basi3p02", image_fx_basi3p02, sizeof(image_fx_basi3p02), 0x9B61A965 },
+	{ "s01n3p01", image_fx_s01n3p01, sizeof(image_fx_s01n3p01), 0x60D7E3E3 },
+	{ "s01i3p01", image_fx_s01i3p01, sizeof(image_fx_s01i3p01), 0x60D7E3E3 },
+	{ "f00n2c08", image_fx_f00n2c08, sizeof(image_fx_f00n2c08), 0x607466BE },
+	{ "f00n6a08", image_fx_f00n6a08, sizeof(image_fx_f00n6a08), 0x9257AE05 },
+	{ "f01n2c08", image_fx_f01n2c08, sizeof(image_fx_f01n2c08), 0xD1F33C62 },
+	{ "f01n6a08", image_fx_f01n6a08, sizeof(image_fx_f01n6a08), 0x0685CAB1 },
+	{ "f02n2c08", image_fx_f02n2c08, sizeof(image_fx_f02n2c08), 0x127D4450 },
+	{ "f02n6a08", image_fx_f02n6a08, sizeof(image_fx_f02n6a08), 0x77DDDD44 },
+	{ "f03n2c08", image_fx_f03n2c08, sizeof(image_fx_f03n2c08), 0x5DB202BA },
+	{ "f03n6a08", image_fx_f03n6a08, sizeof(image_fx_f03n6a08), 0x655EA53E },
+	{ "f03n6a16", image_fx_f03n6a16, sizeof(image_fx_f03n6a16), 0x655EA53E },
+	{ "f04n2c08", image_fx_f04n2c08, sizeof(image_fx_f04n2c08), 0x77BF9731 },
+	{ "f04n6a08", image_fx_f04n6a08, sizeof(image_fx_f04n6a08), 0xECD97710 },
+	{ "f04n6a16", image_fx_f04n6a16, sizeof(image_fx_f04n6a16), 0xECD97710 },
+	{ "f99n0g04", image_fx_f99n0g04, sizeof(image_fx_f99n0g04), 0x51392E94 },
+	{ "tbbn0g04", image_fx_tbbn0g04, sizeof(image_fx_tbbn0g04), 0x81DBE531 },
+	{ "tbrn2c16", image_fx_tbrn2c16, sizeof(image_fx_tbrn2c16), 0x5101E09A },
+	{ "tbbn3p04", image_fx_tbbn3p04, sizeof(image_fx_tbbn3p04), 0x670ADB43 },
+	{ "z00n2c08", image_fx_z00n2c08, sizeof(image_fx_z00n2c08), 0x7EDE6710 },
+	{ "z03n2c08", image_fx_z03n2c08, sizeof(image_fx_z03n2c08), 0x1DE1DEB5 },
+	{ "z09n2c08", image_fx_z09n2c08, sizeof(image_fx_z09n2c08), 0x1DE1DEB5 },
+	{ "oi9n2c08", image_fx_oi9n2c08, sizeof(image_fx_oi9n2c08), 0x1DE1DEB5 },
+	{ "ctzn2c08", image_fx_ctzn2c08, sizeof(image_fx_ctzn2c08), 0x1DE1DEB5 },
+	{ "xs1n0g08", image_fx_xs1n0g08, sizeof(image_fx_xs1n0g08), 0 },
+	{ "xcrn0g08", image_fx_xcrn0g08, sizeof(image_fx_xcrn0g08), 0 },
+	{ "xd9n0g08", image_fx_xd9n0g08, sizeof(image_fx_xd9n0g08), 0 },
+	{ "xtrn0g08", image_fx_xtrn0g08, sizeof(image_fx_xtrn0g08), 0 },
+	{ "xcsn0g08", image_fx_xcsn0g08, sizeof(image_fx_xcsn0g08), 0 },
+	{ "b24n", image_fx_b24n, sizeof(image_fx_b24n), 0x7AF712F5 },
+	{ "b24t", image_fx_b24t, sizeof(image_fx_b24t), 0x7AF712F5 },
+	{ "b32n", image_fx_b32n, sizeof(image_fx_b32n), 0x7AF712F5 },
+	{ "b32a", image_fx_b32a, sizeof(image_fx_b32a), 0xE20343EC },
+	{ "b16n", image_fx_b16n, sizeof(image_fx_b16n), 0x65D0ABB1 },
+	{ "b16f", image_fx_b16f, sizeof(image_fx_b16f), 0xA4C3FA64 },
+	{ "b01p", image_fx_b01p, sizeof(image_fx_b01p), 0xB0DECB9C },
+	{ "b04p", image_fx_b04p, sizeof(image_fx_b04p), 0x26396721 },
+	{ "b08p", image_fx_b08p, sizeof(image_fx_b08p), 0x026BDC60 },
+	{ "b08c", image_fx_b08c, sizeof(image_fx_b08c), 0x026BDC60 },
+	{ "b04r", image_fx_b04r, sizeof(image_fx_b04r), 0x22A0E955 },
+	{ "b08r", image_fx_b08r, sizeof(image_fx_b08r), 0x1195A263 },
+	{ "b24x", image_fx_b24x, sizeof(image_fx_b24x), 0 },
+};
+
+#endif /* SUBSYSTEMS_NXGI_IMAGE_FIXTURES_H_ */
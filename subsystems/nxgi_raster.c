@@ -0,0 +1,1107 @@
+/*
+ * nxgi_raster.c
+ *
+ *	Anti-aliased polygon rasterizer: paths, shape flattening and scan
+ *	conversion.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <mm.h>
+#include <string.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_raster.h"
+#include "nxgi_span.h"
+
+/* Samples per pixel along each axis, and the distance between them in 24.8 */
+#define RASTER_SAMPLES			4
+#define RASTER_SAMPLE_SHIFT		6
+#define RASTER_SAMPLE_STEP		(1 << RASTER_SAMPLE_SHIFT)
+
+/* Index of the first sample row or column at or after `v`, in 24.8 */
+#define RASTER_SAMPLE_CEIL(v)	(((v) + RASTER_SAMPLE_STEP / 2 - 1) >> RASTER_SAMPLE_SHIFT)
+
+/* Coordinates are clamped to this, so edge deltas times a sample step fit in 32 bits */
+#define RASTER_MAX_COORD		NXGI_FIX(16384)
+
+/* Flattened quarter circles have at most this many segments */
+#define RASTER_MAX_QUARTER		256
+
+/**
+ * Edge of the active edge table. The edge's x is followed from one
+ * sample row to the next exactly, as floor(x) and a remainder over dy.
+ */
+typedef struct RASTER_EDGE RASTER_EDGE;
+struct RASTER_EDGE {
+	/** Sample rows crossed, s_end excluded, and the first one stepped to */
+	int32_t		s_first;
+	int32_t		s_end;
+
+	/** x at the current sample row is x + rem / dy */
+	int32_t		x;
+	int32_t		rem;
+	int32_t		dy;
+
+	/** Change of x per sample row, step + step_rem / dy */
+	int32_t		step;
+	int32_t		step_rem;
+
+	/** +1 for edges going down, -1 going up */
+	int32_t		dir;
+
+	RASTER_EDGE	*next;
+};
+
+/*
+ * sin() of 0..90 degrees in 256 steps, in 16.16.
+ */
+static const int32_t raster_sin[RASTER_MAX_QUARTER + 1] = {
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536,
+};
+
+/*
+ * Floor of num / den and it's remainder, den > 0.
+ */
+static int32_t raster_div_floor(int64_t num, int32_t den, int32_t *rem)
+{
+	uint64_t	q;
+	uint32_t	r;
+
+	if (num >= 0) {
+		q = udiv64((uint64_t)num, (uint32_t)den, &r);
+		*rem = (int32_t)r;
+
+		return (int32_t)q;
+	}
+
+	/* Round the magnitude up, the remainder is then counted from below */
+	q = udiv64((uint64_t)-num, (uint32_t)den, &r);
+
+	if (r != 0) {
+		q++;
+		r = (uint32_t)den - r;
+	}
+
+	*rem = (int32_t)r;
+	return -(int32_t)q;
+}
+
+/*
+ * a * b / c rounded to nearest, c > 0.
+ */
+static int32_t raster_mul_div(int32_t a, int32_t b, int32_t c)
+{
+	int64_t		n = (int64_t)a * b;
+	uint64_t	q = udiv64((n < 0 ? (uint64_t)-n : (uint64_t)n) + (uint32_t)c / 2, (uint32_t)c, NULL);
+
+	return n < 0 ? -(int32_t)q : (int32_t)q;
+}
+
+static uint32_t raster_isqrt(uint64_t v)
+{
+	uint64_t r = 0, bit = (uint64_t)1 << 62;
+
+	while (bit > v) {
+		bit >>= 2;
+	}
+
+	while (bit) {
+		if (v >= r + bit) {
+			v -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return (uint32_t)r;
+}
+
+static NXGI_FIXED raster_clamp(NXGI_FIXED v)
+{
+	return v < -RASTER_MAX_COORD ? -RASTER_MAX_COORD : (v > RASTER_MAX_COORD ? RASTER_MAX_COORD : v);
+}
+
+/*
+ * sin and cos of `angle`, in 1024ths of a turn, in 16.16.
+ */
+static void raster_sincos(uint32_t angle, int32_t *s, int32_t *c)
+{
+	uint32_t	i = angle & (RASTER_MAX_QUARTER - 1);
+	int32_t		si = raster_sin[i], co = raster_sin[RASTER_MAX_QUARTER - i];
+
+	switch ((angle >> 8) & 3) {
+	case 0: *s = si; *c = co; break;
+	case 1: *s = co; *c = -si; break;
+	case 2: *s = -si; *c = -co; break;
+	default: *s = -co; *c = si; break;
+	}
+}
+
+/*
+ * Segments per quarter of a circle of radius `r`, a power of 2. A segment
+ * spanning angle a is off the arc by r * a^2 / 8, which stays below 1/8
+ * of a pixel with pi * sqrt(r) segments.
+ */
+static uint32_t raster_quarter_steps(NXGI_FIXED r)
+{
+	uint32_t need = raster_isqrt(r) * 201 / 1024 + 1, q = 2;
+
+	while (q < need && q < RASTER_MAX_QUARTER) {
+		q <<= 1;
+	}
+
+	return q;
+}
+
+/*
+ * Point `i` of `path`, clamped and moved by `offset`.
+ */
+static NXGI_FPOINT raster_point(const NXGI_PATH *path, uint32_t i, NXGI_POINT offset)
+{
+	NXGI_FPOINT p = path->points[i];
+
+	p.x = raster_clamp(raster_clamp(p.x) + NXGI_FIX(offset.x));
+	p.y = raster_clamp(raster_clamp(p.y) + NXGI_FIX(offset.y));
+
+	return p;
+}
+
+void nxgi_path_init(NXGI_PATH *path)
+{
+	memset(path, 0, sizeof(NXGI_PATH));
+}
+
+void nxgi_path_fini(NXGI_PATH *path)
+{
+	if (path->points) kfree(path->points);
+	if (path->ends) kfree(path->ends);
+
+	memset(path, 0, sizeof(NXGI_PATH));
+}
+
+void nxgi_path_reset(NXGI_PATH *path)
+{
+	path->count = 0;
+	path->end_count = 0;
+}
+
+static uint32_t path_contour_start(const NXGI_PATH *path)
+{
+	return path->end_count ? path->ends[path->end_count - 1] : 0;
+}
+
+static HRESULT path_append(NXGI_PATH *path, NXGI_FPOINT p)
+{
+	NXGI_FPOINT	*points;
+	uint32_t	capacity;
+
+	if (path->count == path->capacity) {
+		capacity = path->capacity ? path->capacity * 2 : 32;
+		points = krealloc(path->points, capacity * sizeof(NXGI_FPOINT));
+
+		if (!points) {
+			return E_OUTOFMEM;
+		}
+
+		path->points = points;
+		path->capacity = capacity;
+	}
+
+	path->points[path->count++] = p;
+	return S_OK;
+}
+
+HRESULT nxgi_path_close(NXGI_PATH *path)
+{
+	uint32_t	*ends;
+	uint32_t	capacity;
+
+	if (path->count == path_contour_start(path)) {
+		return S_FALSE;
+	}
+
+	if (path->end_count == path->end_capacity) {
+		capacity = path->end_capacity ? path->end_capacity * 2 : 8;
+		ends = krealloc(path->ends, capacity * sizeof(uint32_t));
+
+		if (!ends) {
+			return E_OUTOFMEM;
+		}
+
+		path->ends = ends;
+		path->end_capacity = capacity;
+	}
+
+	path->ends[path->end_count++] = path->count;
+	return S_OK;
+}
+
+HRESULT nxgi_path_move_to(NXGI_PATH *path, NXGI_FPOINT p)
+{
+	HRESULT hr;
+
+	hr = nxgi_path_close(path);
+	if (FAILED(hr)) return hr;
+
+	return path_append(path, p);
+}
+
+HRESULT nxgi_path_line_to(NXGI_PATH *path, NXGI_FPOINT p)
+{
+	return path_append(path, p);
+}
+
+HRESULT nxgi_path_add_polygon(NXGI_PATH *path, const NXGI_FPOINT *points, uint32_t count)
+{
+	uint32_t	i;
+	HRESULT		hr;
+
+	hr = nxgi_path_close(path);
+
+	for (i=0; i<count && SUCCEEDED(hr); i++) {
+		hr = path_append(path, points[i]);
+	}
+
+	if (FAILED(hr)) return hr;
+
+	return nxgi_path_close(path);
+}
+
+/*
+ * Appends `count` points of an elliptic arc, starting at `angle` and
+ * going `step` 1024ths of a turn further each point.
+ */
+static HRESULT path_arc(NXGI_PATH *path, NXGI_FPOINT c, NXGI_FIXED rx, NXGI_FIXED ry, uint32_t angle, uint32_t count, uint32_t step)
+{
+	int32_t		s, co;
+	uint32_t	i;
+	HRESULT		hr = S_OK;
+
+	for (i=0; i<count && SUCCEEDED(hr); i++) {
+		raster_sincos(angle + i * step, &s, &co);
+
+		hr = path_append(path, FPOINT(c.x + (NXGI_FIXED)(((int64_t)rx * co + 32768) >> 16),
+										c.y + (NXGI_FIXED)(((int64_t)ry * s + 32768) >> 16)));
+	}
+
+	return hr;
+}
+
+HRESULT nxgi_path_add_ellipse(NXGI_PATH *path, NXGI_FPOINT center, NXGI_FIXED rx, NXGI_FIXED ry)
+{
+	uint32_t	q;
+	HRESULT		hr;
+
+	rx = raster_clamp(rx < 0 ? -rx : rx);
+	ry = raster_clamp(ry < 0 ? -ry : ry);
+
+	if (rx == 0 || ry == 0) {
+		return S_FALSE;
+	}
+
+	q = raster_quarter_steps(rx > ry ? rx : ry);
+
+	hr = nxgi_path_close(path);
+	if (SUCCEEDED(hr)) hr = path_arc(path, center, rx, ry, 0, 4 * q, RASTER_MAX_QUARTER / q);
+	if (FAILED(hr)) return hr;
+
+	return nxgi_path_close(path);
+}
+
+HRESULT nxgi_path_add_circle(NXGI_PATH *path, NXGI_FPOINT center, NXGI_FIXED r)
+{
+	return nxgi_path_add_ellipse(path, center, r, r);
+}
+
+HRESULT nxgi_path_add_round_rect(NXGI_PATH *path, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED radius)
+{
+	NXGI_FPOINT	corners[4];
+	NXGI_FIXED	t, r;
+	uint32_t	q, step;
+	HRESULT		hr;
+
+	if (p1.x > p2.x) { t = p1.x; p1.x = p2.x; p2.x = t; }
+	if (p1.y > p2.y) { t = p1.y; p1.y = p2.y; p2.y = t; }
+
+	r = radius < 0 ? 0 : radius;
+	if (r > (p2.x - p1.x) / 2) r = (p2.x - p1.x) / 2;
+	if (r > (p2.y - p1.y) / 2) r = (p2.y - p1.y) / 2;
+
+	if (r == 0) {
+		corners[0] = p1;
+		corners[1] = FPOINT(p2.x, p1.y);
+		corners[2] = p2;
+		corners[3] = FPOINT(p1.x, p2.y);
+
+		return nxgi_path_add_polygon(path, corners, 4);
+	}
+
+	q = raster_quarter_steps(r);
+	step = RASTER_MAX_QUARTER / q;
+
+	/* Clockwise on screen, from the top right corner */
+	hr = nxgi_path_close(path);
+	if (SUCCEEDED(hr)) hr = path_arc(path, FPOINT(p2.x - r, p1.y + r), r, r, 3 * RASTER_MAX_QUARTER, q + 1, step);
+	if (SUCCEEDED(hr)) hr = path_arc(path, FPOINT(p2.x - r, p2.y - r), r, r, 0, q + 1, step);
+	if (SUCCEEDED(hr)) hr = path_arc(path, FPOINT(p1.x + r, p2.y - r), r, r, RASTER_MAX_QUARTER, q + 1, step);
+	if (SUCCEEDED(hr)) hr = path_arc(path, FPOINT(p1.x + r, p1.y + r), r, r, 2 * RASTER_MAX_QUARTER, q + 1, step);
+	if (FAILED(hr)) return hr;
+
+	return nxgi_path_close(path);
+}
+
+HRESULT nxgi_path_add_line(NXGI_PATH *path, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED width)
+{
+	NXGI_FPOINT	quad[4];
+	int32_t		dx, dy, len, nx, ny, half;
+
+	p1 = FPOINT(raster_clamp(p1.x), raster_clamp(p1.y));
+	p2 = FPOINT(raster_clamp(p2.x), raster_clamp(p2.y));
+
+	dx = p2.x - p1.x;
+	dy = p2.y - p1.y;
+	len = raster_isqrt((uint64_t)((int64_t)dx * dx + (int64_t)dy * dy));
+	half = raster_clamp(width < 0 ? -width : width) / 2;
+
+	if (len == 0 || half == 0) {
+		return S_FALSE;
+	}
+
+	/* Normal, half the width long */
+	nx = raster_mul_div(-dy, half, len);
+	ny = raster_mul_div(dx, half, len);
+
+	quad[0] = FPOINT(p1.x + nx, p1.y + ny);
+	quad[1] = FPOINT(p2.x + nx, p2.y + ny);
+	quad[2] = FPOINT(p2.x - nx, p2.y - ny);
+	quad[3] = FPOINT(p1.x - nx, p1.y - ny);
+
+	return nxgi_path_add_polygon(path, quad, 4);
+}
+
+/*
+ * Sets up the edge from `a` to `b` at the first sample row within
+ * [s_lo, s_hi). Returns FALSE for edges that cross no sample row there,
+ * or lie right of `x_hi` and so don't change the winding of any sample
+ * left of it.
+ */
+static BOOL raster_edge(RASTER_EDGE *e, NXGI_FPOINT a, NXGI_FPOINT b, int32_t s_lo, int32_t s_hi, NXGI_FIXED x_hi)
+{
+	NXGI_FPOINT	t;
+	int32_t		dx, dy, sy;
+
+	if (a.y == b.y || (a.x >= x_hi && b.x >= x_hi)) {
+		return FALSE;
+	}
+
+	e->dir = 1;
+
+	if (a.y > b.y) {
+		t = a;
+		a = b;
+		b = t;
+		e->dir = -1;
+	}
+
+	e->s_first = RASTER_SAMPLE_CEIL(a.y);
+	e->s_end = RASTER_SAMPLE_CEIL(b.y);
+
+	if (e->s_first < s_lo) e->s_first = s_lo;
+	if (e->s_end > s_hi) e->s_end = s_hi;
+
+	if (e->s_first >= e->s_end) {
+		return FALSE;
+	}
+
+	dx = b.x - a.x;
+	dy = b.y - a.y;
+	sy = e->s_first * RASTER_SAMPLE_STEP + RASTER_SAMPLE_STEP / 2;
+
+	e->dy = dy;
+	e->x = a.x + raster_div_floor((int64_t)(sy - a.y) * dx, dy, &e->rem);
+	e->step = raster_div_floor((int64_t)dx * RASTER_SAMPLE_STEP, dy, &e->step_rem);
+
+	return TRUE;
+}
+
+/*
+ * Adds the samples [a, b) of a sample row to the coverage of the pixels
+ * they fall in. Coverage is kept as differences between neighbouring
+ * pixels, so pixels covered all along cost nothing.
+ */
+static inline void raster_add_span(int16_t *delta, int32_t a, int32_t b, int32_t *p_lo, int32_t *p_hi)
+{
+	int32_t pa = a / RASTER_SAMPLES, pb = b / RASTER_SAMPLES;
+
+	delta[pa] += RASTER_SAMPLES - a % RASTER_SAMPLES;
+	delta[pa + 1] += a % RASTER_SAMPLES;
+	delta[pb] -= RASTER_SAMPLES - b % RASTER_SAMPLES;
+	delta[pb + 1] -= b % RASTER_SAMPLES;
+
+	if (pa < *p_lo) *p_lo = pa;
+	if (pb + 2 > *p_hi) *p_hi = pb + 2;
+}
+
+/*
+ * Blends `color` into a row through the coverage accumulated in
+ * `delta[p_lo..p_hi)`, clearing it. Runs of an opaque color covering
+ * whole pixels are filled, the rest goes through the coverage mask.
+ */
+static void raster_emit(uint32_t *row, int16_t *delta, uint8_t *mask, int32_t p_lo, int32_t p_hi, int32_t width, uint32_t color, uint32_t flags)
+{
+	BOOL	solid = (color >> 24) == 0xFF;
+	int32_t	end = p_hi < width ? p_hi : width;
+	int32_t	p, q, sum, next;
+
+	for (p=p_lo, sum=0; p<end; ) {
+		sum += delta[p];
+		delta[p] = 0;
+
+		if (sum == 0) {
+			p++;
+			continue;
+		}
+
+		if (solid && sum == RASTER_SAMPLES * RASTER_SAMPLES) {
+			/* Covered until the coverage changes again */
+			for (q=p + 1; q<end && delta[q] == 0; q++);
+
+			nxgi_span_fill(row + p, color, q - p, flags);
+			p = q;
+			continue;
+		}
+
+		mask[p] = (sum * 255 + 8) >> 4;
+
+		for (q=p + 1; q<end; q++) {
+			next = sum + delta[q];
+
+			if (next == 0 || (solid && next == RASTER_SAMPLES * RASTER_SAMPLES)) {
+				break;
+			}
+
+			sum = next;
+			delta[q] = 0;
+			mask[q] = (sum * 255 + 8) >> 4;
+		}
+
+		nxgi_span_mask(row + p, color, mask + p, q - p);
+		p = q;
+	}
+
+	/* Past the clip rect, only the ends of spans */
+	for (p=end; p<p_hi; p++) {
+		delta[p] = 0;
+	}
+}
+
+HRESULT __nxapi nxgi_fill_path(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_PATH *path, NXGI_FILL_RULE rule)
+{
+	RASTER_EDGE	*edges = NULL, **active = NULL, **rows = NULL, *e;
+	int32_t		*cross = NULL;
+	int16_t		*delta = NULL;
+	uint8_t		*mask = NULL;
+	uint32_t	*row;
+	NXGI_RECT	clip;
+	uint32_t	i, k, start, end, n = 0, nactive = 0, ncross, color, flags;
+	int32_t		width, s_lo, s_hi, row_lo, row_hi, py, s, j, col, key, winding, span_start, p_lo, p_hi;
+	BOOL		inside, now;
+	HRESULT		hr = S_OK;
+
+	if (!gc->target || gc->record) {
+		return E_INVALIDSTATE;
+	}
+
+	if (gc->target->format != NXGI_FORMAT_BGRA32) {
+		return E_NOTIMPL;
+	}
+
+	clip = gc->clip_rect;
+
+	if (path->count < 3 || nxgig_rect_empty(clip)) {
+		return S_FALSE;
+	}
+
+	width = RECT_WIDTH(clip);
+	s_lo = clip.y1 * RASTER_SAMPLES;
+	s_hi = clip.y2 * RASTER_SAMPLES;
+	row_lo = clip.y2;
+	row_hi = clip.y1;
+
+	edges = kmalloc(path->count * sizeof(RASTER_EDGE));
+	if (!edges) {
+		return E_OUTOFMEM;
+	}
+
+	/* Edge table. The open contour, if any, is closed too */
+	for (i=0, start=0; start<path->count; start=end) {
+		end = i < path->end_count ? path->ends[i++] : path->count;
+
+		for (k=start; k<end; k++) {
+			if (raster_edge(&edges[n], raster_point(path, k, gc->offset), raster_point(path, k + 1 < end ? k + 1 : start, gc->offset),
+								s_lo, s_hi, NXGI_FIX(clip.x2))) {
+				if (edges[n].s_first / RASTER_SAMPLES < row_lo) row_lo = edges[n].s_first / RASTER_SAMPLES;
+				if ((edges[n].s_end - 1) / RASTER_SAMPLES >= row_hi) row_hi = (edges[n].s_end - 1) / RASTER_SAMPLES + 1;
+
+				n++;
+			}
+		}
+	}
+
+	if (n == 0) {
+		hr = S_FALSE;
+		goto finally;
+	}
+
+	active = kmalloc(n * sizeof(RASTER_EDGE*));
+	cross = kmalloc(n * sizeof(int32_t));
+	rows = kcalloc((row_hi - row_lo) * sizeof(RASTER_EDGE*));
+	delta = kcalloc((width + 2) * sizeof(int16_t));
+	mask = kmalloc(width);
+
+	if (!active || !cross || !rows || !delta || !mask) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	/* Edges are activated on the pixel row of their first sample row */
+	for (i=0; i<n; i++) {
+		e = &edges[i];
+		e->next = rows[e->s_first / RASTER_SAMPLES - row_lo];
+		rows[e->s_first / RASTER_SAMPLES - row_lo] = e;
+	}
+
+	color = nxgi_span_scale(nxgi_span_premultiply(nxgi_span_color(gc->color)), gc->alpha);
+	flags = nxgi_span_flags(gc->target);
+
+	for (py=row_lo; py<row_hi; py++) {
+		for (e=rows[py - row_lo]; e; e=e->next) {
+			active[nactive++] = e;
+		}
+
+		p_lo = width;
+		p_hi = 0;
+
+		for (s=py*RASTER_SAMPLES; s<(py + 1)*RASTER_SAMPLES && nactive; s++) {
+			ncross = 0;
+
+			/* Crossings of the sample row, as sample column * 2 + (going down), sorted */
+			for (i=0; i<nactive; ) {
+				e = active[i];
+
+				if (s >= e->s_end) {
+					active[i] = active[--nactive];
+					continue;
+				}
+
+				i++;
+
+				if (s < e->s_first) {
+					continue;
+				}
+
+				/* First sample at or right of the crossing */
+				col = RASTER_SAMPLE_CEIL(e->x + (e->rem != 0)) - clip.x1 * RASTER_SAMPLES;
+
+				if (col < 0) col = 0;
+				if (col > width * RASTER_SAMPLES) col = width * RASTER_SAMPLES;
+
+				key = col * 2 + (e->dir > 0);
+
+				for (j=ncross++; j>0 && cross[j - 1] > key; j--) {
+					cross[j] = cross[j - 1];
+				}
+
+				cross[j] = key;
+
+				e->x += e->step;
+				e->rem += e->step_rem;
+
+				if (e->rem >= e->dy) {
+					e->rem -= e->dy;
+					e->x++;
+				}
+			}
+
+			winding = 0;
+			inside = FALSE;
+			span_start = 0;
+
+			for (i=0; i<ncross; i++) {
+				col = cross[i] >> 1;
+				winding += cross[i] & 1 ? 1 : -1;
+				now = rule == NXGI_FILL_EVEN_ODD ? (winding & 1) != 0 : winding != 0;
+
+				if (now && !inside) {
+					span_start = col;
+				} else if (!now && inside && col > span_start) {
+					raster_add_span(delta, span_start, col, &p_lo, &p_hi);
+				}
+
+				inside = now;
+			}
+		}
+
+		if (p_lo >= p_hi) {
+			continue;
+		}
+
+		row = (uint32_t*)((uint8_t*)gc->target->pBits + py * gc->target->stride) + clip.x1;
+		raster_emit(row, delta, mask, p_lo, p_hi, width, color, flags);
+	}
+
+finally:
+	if (edges) kfree(edges);
+	if (active) kfree(active);
+	if (cross) kfree(cross);
+	if (rows) kfree(rows);
+	if (delta) kfree(delta);
+	if (mask) kfree(mask);
+
+	return hr;
+}
+
+HRESULT __nxapi nxgi_fill_polygon(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_FPOINT *points, uint32_t count, NXGI_FILL_RULE rule)
+{
+	NXGI_PATH	path;
+	HRESULT		hr;
+
+	nxgi_path_init(&path);
+
+	hr = nxgi_path_add_polygon(&path, points, count);
+	if (SUCCEEDED(hr)) hr = nxgi_fill_path(gc, &path, rule);
+
+	nxgi_path_fini(&path);
+	return hr;
+}
+
+HRESULT __nxapi nxgi_fill_ellipse(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FPOINT center, NXGI_FIXED rx, NXGI_FIXED ry)
+{
+	NXGI_PATH	path;
+	HRESULT		hr;
+
+	nxgi_path_init(&path);
+
+	hr = nxgi_path_add_ellipse(&path, center, rx, ry);
+	if (SUCCEEDED(hr)) hr = nxgi_fill_path(gc, &path, NXGI_FILL_NONZERO);
+
+	nxgi_path_fini(&path);
+	return hr;
+}
+
+HRESULT __nxapi nxgi_fill_round_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect, NXGI_FIXED radius)
+{
+	NXGI_PATH	path;
+	HRESULT		hr;
+
+	nxgi_path_init(&path);
+
+	hr = nxgi_path_add_round_rect(&path, FPOINT(NXGI_FIX(rect.x1), NXGI_FIX(rect.y1)), FPOINT(NXGI_FIX(rect.x2), NXGI_FIX(rect.y2)), radius);
+	if (SUCCEEDED(hr)) hr = nxgi_fill_path(gc, &path, NXGI_FILL_NONZERO);
+
+	nxgi_path_fini(&path);
+	return hr;
+}
+
+HRESULT __nxapi nxgi_draw_wide_line(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED width)
+{
+	NXGI_PATH	path;
+	HRESULT		hr;
+
+	nxgi_path_init(&path);
+
+	hr = nxgi_path_add_line(&path, p1, p2, width);
+	if (SUCCEEDED(hr)) hr = nxgi_fill_path(gc, &path, NXGI_FILL_NONZERO);
+
+	nxgi_path_fini(&path);
+	return hr;
+}
+
+/*
+ * Benchmark
+ */
+#define RASTER_BENCH_SIZE		256
+#define RASTER_BENCH_WIDTH		1024
+#define RASTER_BENCH_HEIGHT		768
+
+/* Time per measurement, in milliseconds */
+#define RASTER_BENCH_TIME		200
+
+#define RASTER_BENCH_BACKGROUND	0xFF203040
+
+/**
+ * Scene checked against the reference renderer, with the FNV-1a hash of
+ * it's image.
+ */
+typedef struct RASTER_SCENE RASTER_SCENE;
+struct RASTER_SCENE {
+	const char		*name;
+	NXGI_FILL_RULE	rule;
+	uint8_t			alpha;
+	NXGI_RECT		clip;
+	NXGI_POINT		offset;
+	uint32_t		hash;
+};
+
+static const RASTER_SCENE raster_scenes[] = {
+	{ "star, non-zero", NXGI_FILL_NONZERO, 255, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0xA655C013 },
+	{ "star, even-odd", NXGI_FILL_EVEN_ODD, 200, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x0D118139 },
+	{ "circle", NXGI_FILL_NONZERO, 255, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x568A10FC },
+	{ "ellipse ring", NXGI_FILL_EVEN_ODD, 200, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0xDCEBCB59 },
+	{ "rounded rects", NXGI_FILL_NONZERO, 255, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0xB02EE075 },
+	{ "wide lines", NXGI_FILL_NONZERO, 200, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x569F0A08 },
+	{ "star, clipped and moved", NXGI_FILL_NONZERO, 255, { { { 40, 50 } }, { { 180, 170 } } }, { -17, 9 }, 0x4DCBA143 },
+	{ "slivers", NXGI_FILL_NONZERO, 255, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x79425679 },
+	{ "random, non-zero", NXGI_FILL_NONZERO, 200, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x97B1A427 },
+	{ "random, even-odd", NXGI_FILL_EVEN_ODD, 255, { { { 0, 0 } }, { { 256, 256 } } }, { 0, 0 }, 0x6D3E2F0E },
+};
+
+/*
+ * Pentagram, drawn as a single self-intersecting contour.
+ */
+static HRESULT raster_bench_star(NXGI_PATH *path, NXGI_FPOINT c, NXGI_FIXED r)
+{
+	NXGI_FPOINT	points[5];
+	int32_t		s, co;
+	uint32_t	i;
+
+	for (i=0; i<5; i++) {
+		raster_sincos(3 * RASTER_MAX_QUARTER + i * 4 * RASTER_MAX_QUARTER * 2 / 5, &s, &co);
+		points[i] = FPOINT(c.x + raster_mul_div(r, co, 65536), c.y + raster_mul_div(r, s, 65536));
+	}
+
+	return nxgi_path_add_polygon(path, points, 5);
+}
+
+static uint32_t raster_bench_rand(uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed ^ (*seed >> 16);
+}
+
+static HRESULT raster_bench_scene(uint32_t scene, NXGI_PATH *path)
+{
+	NXGI_FPOINT	c = FPOINT(128 * NXGI_FIXED_ONE + 128, 127 * NXGI_FIXED_ONE + 64);
+	NXGI_FPOINT	sliver[3];
+	int32_t		s, co;
+	uint32_t	i, seed = 0xFACE;
+	HRESULT		hr = S_OK;
+
+	switch (scene) {
+	case 0:
+	case 1:
+	case 6:
+		return raster_bench_star(path, c, NXGI_FIX(110));
+
+	case 2:
+		return nxgi_path_add_circle(path, FPOINT(NXGI_FIX(128) + 64, NXGI_FIX(128) + 192), NXGI_FIX(100) + 128);
+
+	case 3:
+		hr = nxgi_path_add_ellipse(path, c, NXGI_FIX(120), NXGI_FIX(50));
+		if (SUCCEEDED(hr)) hr = nxgi_path_add_ellipse(path, c, NXGI_FIX(100) + 77, NXGI_FIX(30));
+		return hr;
+
+	case 4:
+		hr = nxgi_path_add_round_rect(path, FPOINT(NXGI_FIX(20) + 128, NXGI_FIX(30) + 64), FPOINT(NXGI_FIX(230), NXGI_FIX(200)), NXGI_FIX(24));
+		if (SUCCEEDED(hr)) hr = nxgi_path_add_round_rect(path, FPOINT(NXGI_FIX(100), NXGI_FIX(210)), FPOINT(NXGI_FIX(108) + 128, NXGI_FIX(216)), NXGI_FIX(3));
+		if (SUCCEEDED(hr)) hr = nxgi_path_add_round_rect(path, FPOINT(NXGI_FIX(150), NXGI_FIX(205)), FPOINT(NXGI_FIX(250), NXGI_FIX(245)), NXGI_FIX(40));
+		return hr;
+
+	case 5:
+		for (i=0; i<16 && SUCCEEDED(hr); i++) {
+			raster_sincos(i * 64 + 7, &s, &co);
+			hr = nxgi_path_add_line(path, c, FPOINT(c.x + raster_mul_div(NXGI_FIX(120), co, 65536), c.y + raster_mul_div(NXGI_FIX(120), s, 65536)),
+									NXGI_FIX(1) + i * 64);
+		}
+		return hr;
+
+	case 7:
+		for (i=0; i<24 && SUCCEEDED(hr); i++) {
+			sliver[0] = FPOINT(NXGI_FIX(8), NXGI_FIX(8 + i * 10) + i * 5);
+			sliver[1] = FPOINT(NXGI_FIX(248) - i * 3, NXGI_FIX(9 + i * 10));
+			sliver[2] = FPOINT(NXGI_FIX(8) + i * 7, NXGI_FIX(8 + i * 10) + 16 + i * 9);
+
+			hr = nxgi_path_add_polygon(path, sliver, 3);
+		}
+		return hr;
+
+	case 8:
+	case 9:
+		/* Two self-intersecting contours, partly outside of the image */
+		for (i=0; i<48 && SUCCEEDED(hr); i++) {
+			if (i % 24 == 0) {
+				hr = nxgi_path_close(path);
+			}
+
+			if (SUCCEEDED(hr)) {
+				hr = nxgi_path_line_to(path, FPOINT(NXGI_FIX(-40) + raster_bench_rand(&seed) % NXGI_FIX(336),
+													NXGI_FIX(-40) + raster_bench_rand(&seed) % NXGI_FIX(336)));
+			}
+		}
+		return hr;
+	}
+
+	return E_INVALIDARG;
+}
+
+/**
+ * Edge as the reference sees it, top point first.
+ */
+typedef struct RASTER_BENCH_EDGE RASTER_BENCH_EDGE;
+struct RASTER_BENCH_EDGE {
+	NXGI_FPOINT	a, b;
+	int32_t		dir;
+};
+
+/*
+ * Per sample reference: winds every sample of every pixel within `clip`
+ * around the edges of the path crossing it's sample row.
+ */
+static HRESULT raster_bench_reference(NXGI_BITMAP *bmp, const NXGI_PATH *path, const RASTER_SCENE *sc, uint32_t color)
+{
+	RASTER_BENCH_EDGE	*edges, *row, *e;
+	NXGI_FPOINT			t;
+	uint32_t			i, k, n = 0, nrow, start, end;
+	int32_t				x, y, sx, sy, xs, ys, winding;
+	uint8_t				cov[RASTER_BENCH_SIZE], m;
+
+	edges = kmalloc(path->count * sizeof(RASTER_BENCH_EDGE));
+	row = kmalloc(path->count * sizeof(RASTER_BENCH_EDGE));
+
+	if (!edges || !row) {
+		if (edges) kfree(edges);
+		if (row) kfree(row);
+
+		return E_OUTOFMEM;
+	}
+
+	for (i=0, start=0; start<path->count; start=end) {
+		end = i < path->end_count ? path->ends[i++] : path->count;
+
+		for (k=start; k<end; k++, n++) {
+			e = &edges[n];
+			e->a = raster_point(path, k, sc->offset);
+			e->b = raster_point(path, k + 1 < end ? k + 1 : start, sc->offset);
+			e->dir = 1;
+
+			if (e->a.y > e->b.y) {
+				t = e->a;
+				e->a = e->b;
+				e->b = t;
+				e->dir = -1;
+			}
+		}
+	}
+
+	for (y=sc->clip.y1; y<sc->clip.y2; y++) {
+		memset(cov, 0, sizeof(cov));
+
+		for (sy=0; sy<RASTER_SAMPLES; sy++) {
+			ys = NXGI_FIX(y) + sy * RASTER_SAMPLE_STEP + RASTER_SAMPLE_STEP / 2;
+
+			for (i=0, nrow=0; i<n; i++) {
+				if (edges[i].a.y <= ys && ys < edges[i].b.y) {
+					row[nrow++] = edges[i];
+				}
+			}
+
+			for (x=sc->clip.x1; x<sc->clip.x2; x++) {
+				for (sx=0; sx<RASTER_SAMPLES; sx++) {
+					xs = NXGI_FIX(x) + sx * RASTER_SAMPLE_STEP + RASTER_SAMPLE_STEP / 2;
+					winding = 0;
+
+					/* Edges crossing the sample row left of the sample, or through it */
+					for (i=0; i<nrow; i++) {
+						e = &row[i];
+
+						if ((int64_t)(xs - e->a.x) * (e->b.y - e->a.y) >= (int64_t)(ys - e->a.y) * (e->b.x - e->a.x)) {
+							winding += e->dir;
+						}
+					}
+
+					if (sc->rule == NXGI_FILL_EVEN_ODD ? (winding & 1) != 0 : winding != 0) {
+						cov[x]++;
+					}
+				}
+			}
+		}
+
+		for (x=sc->clip.x1; x<sc->clip.x2; x++) {
+			if (cov[x]) {
+				m = (cov[x] * 255 + 8) >> 4;
+				nxgi_span_mask((uint32_t*)((uint8_t*)bmp->pBits + y * bmp->stride) + x, color, &m, 1);
+			}
+		}
+	}
+
+	kfree(edges);
+	kfree(row);
+
+	return S_OK;
+}
+
+static uint32_t raster_bench_hash(NXGI_BITMAP *bmp)
+{
+	const uint8_t	*p = bmp->pBits;
+	uint32_t		i, h = 2166136261u;
+
+	for (i=0; i<bmp->stride * bmp->height; i++) {
+		h = (h ^ p[i]) * 16777619u;
+	}
+
+	return h;
+}
+
+/* Polygons per second filling `path` all over the target, moved by the context's offset */
+static uint32_t raster_bench_time(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_PATH *path, uint32_t size, uint32_t *seed)
+{
+	uint32_t start, elapsed, count = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		nxgi_set_offset(gc, POINT(raster_bench_rand(seed) % (RASTER_BENCH_WIDTH - size), raster_bench_rand(seed) % (RASTER_BENCH_HEIGHT - size)));
+		nxgi_fill_path(gc, path, NXGI_FILL_NONZERO);
+
+		count++;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < RASTER_BENCH_TIME);
+
+	return count * 1000 / elapsed;
+}
+
+HRESULT __nxapi nxgi_raster_benchmark()
+{
+	static const uint32_t	sizes[] = {8, 32, 128, 512};
+	NXGI_BITMAP				*img = NULL, *ref = NULL, *big = NULL;
+	NXGI_GRAPHICS_CONTEXT	*gc = NULL;
+	NXGI_PATH				path;
+	const RASTER_SCENE		*sc;
+	uint32_t				i, size, color, hash, seed = 0x5EED, t_star, t_circle, t_rrect, t_line;
+	HRESULT					hr;
+
+	nxgi_span_initialize();
+	nxgi_path_init(&path);
+
+	hr = nxgi_create_bitmap(RASTER_BENCH_SIZE, RASTER_BENCH_SIZE, NXGI_FORMAT_BGRA32, &img);
+	if (SUCCEEDED(hr)) hr = nxgi_create_bitmap(RASTER_BENCH_SIZE, RASTER_BENCH_SIZE, NXGI_FORMAT_BGRA32, &ref);
+	if (SUCCEEDED(hr)) hr = nxgi_create_bitmap(RASTER_BENCH_WIDTH, RASTER_BENCH_HEIGHT, NXGI_FORMAT_BGRA32, &big);
+	if (SUCCEEDED(hr)) hr = nxgi_create_graphics_context(&gc);
+	if (FAILED(hr)) goto finally;
+
+	nxgi_set_color(gc, COLOR(250, 200, 60, 255));
+
+	for (i=0; i<sizeof(raster_scenes) / sizeof(raster_scenes[0]); i++) {
+		sc = &raster_scenes[i];
+
+		nxgi_path_reset(&path);
+		hr = raster_bench_scene(i, &path);
+		if (FAILED(hr)) goto finally;
+
+		nxgi_span_fill_rect(img->pBits, img->stride, img->width, img->height, RASTER_BENCH_BACKGROUND, 0);
+		nxgi_span_fill_rect(ref->pBits, ref->stride, ref->width, ref->height, RASTER_BENCH_BACKGROUND, 0);
+
+		nxgi_set_target(gc, img);
+		nxgi_set_clip_rect(gc, sc->clip);
+		nxgi_set_offset(gc, sc->offset);
+		nxgi_set_composite(gc, NXGI_COMPOSITE_SRC_OVER, sc->alpha);
+
+		hr = nxgi_fill_path(gc, &path, sc->rule);
+		if (FAILED(hr)) goto finally;
+
+		color = nxgi_span_scale(nxgi_span_premultiply(nxgi_span_color(gc->color)), sc->alpha);
+		hr = raster_bench_reference(ref, &path, sc, color);
+		if (FAILED(hr)) goto finally;
+
+		if (memcmp(img->pBits, ref->pBits, img->stride * img->height) != 0) {
+			k_printf("%s: differs from the reference.\n", sc->name);
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		hash = raster_bench_hash(img);
+
+		if (hash != sc->hash) {
+			k_printf("%s: image hash is %x, expected %x.\n", sc->name, hash, sc->hash);
+			hr = E_FAIL;
+			goto finally;
+		}
+	}
+
+	k_printf("%d scenes match the reference and their golden images.\n", i);
+
+	nxgi_set_target(gc, big);
+	nxgi_set_composite(gc, NXGI_COMPOSITE_SRC_OVER, 255);
+
+	for (i=0; i<sizeof(sizes) / sizeof(sizes[0]); i++) {
+		size = sizes[i];
+
+		nxgi_path_reset(&path);
+		hr = raster_bench_star(&path, FPOINT(NXGI_FIX(size) / 2, NXGI_FIX(size) / 2), NXGI_FIX(size) / 2);
+		if (FAILED(hr)) goto finally;
+		t_star = raster_bench_time(gc, &path, size, &seed);
+
+		nxgi_path_reset(&path);
+		hr = nxgi_path_add_circle(&path, FPOINT(NXGI_FIX(size) / 2, NXGI_FIX(size) / 2), NXGI_FIX(size) / 2);
+		if (FAILED(hr)) goto finally;
+		t_circle = raster_bench_time(gc, &path, size, &seed);
+
+		nxgi_path_reset(&path);
+		hr = nxgi_path_add_round_rect(&path, FPOINT(0, 0), FPOINT(NXGI_FIX(size), NXGI_FIX(size)), NXGI_FIX(size) / 8);
+		if (FAILED(hr)) goto finally;
+		t_rrect = raster_bench_time(gc, &path, size, &seed);
+
+		nxgi_path_reset(&path);
+		hr = nxgi_path_add_line(&path, FPOINT(0, NXGI_FIX(size) / 4), FPOINT(NXGI_FIX(size), NXGI_FIX(size) * 3 / 4), NXGI_FIX(3));
+		if (FAILED(hr)) goto finally;
+		t_line = raster_bench_time(gc, &path, size, &seed);
+
+		k_printf("%d px: star %d/s, circle %d/s, rounded rect %d/s, 3 px line %d/s\n", size, t_star, t_circle, t_rrect, t_line);
+	}
+
+finally:
+	nxgi_path_fini(&path);
+	if (gc) nxgi_destroy_graphics_context(gc);
+	if (img) nxgi_destroy_bitmap(&img);
+	if (ref) nxgi_destroy_bitmap(&ref);
+	if (big) nxgi_destroy_bitmap(&big);
+
+	return hr;
+}
@@ -0,0 +1,139 @@
+/*
+ * nxgi_raster.h
+ *
+ *	Anti-aliased polygon rasterizer.
+ *
+ *	Shapes are built as paths: closed contours of straight segments, with
+ *	coordinates in 24.8 fixed point. Circles, ellipses and rounded corners
+ *	are flattened into segments, finely enough that the error stays below
+ *	1/8 of a pixel for radii up to 6000 pixels. Wide lines are quads.
+ *
+ *	nxgi_fill_path() scan converts a path with an active edge table. Every
+ *	pixel is sampled at 4x4 points, each of which is inside or outside by
+ *	the non-zero or even-odd rule, exactly, with integer arithmetic. Pixel
+ *	coverage is accumulated per scanline and the color is blended through
+ *	it with nxgi_span_mask(), fully covered runs of an opaque color are
+ *	filled.
+ *
+ *	Path coordinates are clamped to +/-16384 pixels.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_RASTER_H_
+#define SUBSYSTEMS_NXGI_RASTER_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/** 24.8 fixed point */
+typedef int32_t NXGI_FIXED;
+
+#define NXGI_FIXED_SHIFT		8
+#define NXGI_FIXED_ONE			(1 << NXGI_FIXED_SHIFT)
+
+/* Integer to 24.8 */
+#define NXGI_FIX(i)				((NXGI_FIXED)((i) * NXGI_FIXED_ONE))
+
+/**
+ * 2-D point in 24.8 fixed point.
+ */
+typedef struct NXGI_FPOINT NXGI_FPOINT;
+struct NXGI_FPOINT {
+	NXGI_FIXED	x;
+	NXGI_FIXED	y;
+};
+
+typedef enum {
+	/** Inside where the contours wind around the point at least once */
+	NXGI_FILL_NONZERO = 0,
+
+	/** Inside where the point is enclosed by an odd number of contours */
+	NXGI_FILL_EVEN_ODD
+} NXGI_FILL_RULE;
+
+/**
+ * Contours of straight segments. Every contour is closed, the last point
+ * connects back to the first.
+ */
+typedef struct NXGI_PATH NXGI_PATH;
+struct NXGI_PATH {
+	NXGI_FPOINT	*points;
+	uint32_t	count;
+	uint32_t	capacity;
+
+	/** Index past the last point of each closed contour */
+	uint32_t	*ends;
+	uint32_t	end_count;
+	uint32_t	end_capacity;
+};
+
+static inline NXGI_FPOINT FPOINT(NXGI_FIXED x, NXGI_FIXED y)
+{
+	NXGI_FPOINT p = { x, y };
+	return p;
+}
+
+void	nxgi_path_init(NXGI_PATH *path);
+void	nxgi_path_fini(NXGI_PATH *path);
+
+/**
+ * Removes all contours, keeping the memory.
+ */
+void	nxgi_path_reset(NXGI_PATH *path);
+
+/**
+ * Starts a new contour at `p`, closing the current one.
+ */
+HRESULT	nxgi_path_move_to(NXGI_PATH *path, NXGI_FPOINT p);
+
+/**
+ * Adds a segment to the current contour, which starts at `p` if there
+ * is none.
+ */
+HRESULT	nxgi_path_line_to(NXGI_PATH *path, NXGI_FPOINT p);
+HRESULT	nxgi_path_close(NXGI_PATH *path);
+
+/*
+ * Shapes, each added as a closed contour.
+ */
+HRESULT	nxgi_path_add_polygon(NXGI_PATH *path, const NXGI_FPOINT *points, uint32_t count);
+HRESULT	nxgi_path_add_ellipse(NXGI_PATH *path, NXGI_FPOINT center, NXGI_FIXED rx, NXGI_FIXED ry);
+HRESULT	nxgi_path_add_circle(NXGI_PATH *path, NXGI_FPOINT center, NXGI_FIXED r);
+
+/**
+ * Rectangle from `p1` to `p2` with corners rounded by `radius`, which is
+ * limited to half of the shorter side.
+ */
+HRESULT	nxgi_path_add_round_rect(NXGI_PATH *path, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED radius);
+
+/**
+ * Line `width` wide, with butt ends.
+ */
+HRESULT	nxgi_path_add_line(NXGI_PATH *path, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED width);
+
+/**
+ * Fills `path` with the context's color and alpha, moved by it's offset
+ * and within it's clip rect. The target has to be BGRA32. Paths can't be
+ * recorded into a command list, this fails with E_INVALIDSTATE while the
+ * context is recording.
+ */
+HRESULT	__nxapi nxgi_fill_path(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_PATH *path, NXGI_FILL_RULE rule);
+
+/*
+ * Single shape fills, using a temporary path.
+ */
+HRESULT	__nxapi nxgi_fill_polygon(NXGI_GRAPHICS_CONTEXT *gc, const NXGI_FPOINT *points, uint32_t count, NXGI_FILL_RULE rule);
+HRESULT	__nxapi nxgi_fill_ellipse(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FPOINT center, NXGI_FIXED rx, NXGI_FIXED ry);
+HRESULT	__nxapi nxgi_fill_round_rect(NXGI_GRAPHICS_CONTEXT *gc, NXGI_RECT rect, NXGI_FIXED radius);
+HRESULT	__nxapi nxgi_draw_wide_line(NXGI_GRAPHICS_CONTEXT *gc, NXGI_FPOINT p1, NXGI_FPOINT p2, NXGI_FIXED width);
+
+/**
+ * Checks scenes of polygons, circles, rounded rectangles and wide lines
+ * against a per-sample reference and their golden image hashes, and
+ * measures polygons filled per second at several sizes.
+ */
+HRESULT	__nxapi nxgi_raster_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_RASTER_H_ */
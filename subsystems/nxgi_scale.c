@@ -0,0 +1,636 @@
+/*
+ * nxgi_scale.c
+ *
+ *	Scaled blits of BGRA32 bitmaps.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <mm.h>
+#include <string.h>
+#include <stdlib.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_scale.h"
+#include "nxgi_span.h"
+
+/* Largest source dimension, so 16.16 positions fit in 31 bits */
+#define NXGI_SCALE_MAX_SRC		32767
+
+/**
+ * Box filter taps of one destination pixel along an axis.
+ */
+typedef struct NXGI_SCALE_TAP NXGI_SCALE_TAP;
+struct NXGI_SCALE_TAP {
+	/** First source pixel and number of pixels covered */
+	uint32_t	first;
+	uint32_t	count;
+
+	/** Index of the first weight. Weights of a tap sum up to 65536. */
+	uint32_t	weight;
+};
+
+typedef struct NXGI_SCALE_AXIS NXGI_SCALE_AXIS;
+struct NXGI_SCALE_AXIS {
+	NXGI_SCALE_TAP	*taps;
+	uint32_t		*weights;
+};
+
+/**
+ * Blit parameters, with the clip rect resolved.
+ */
+typedef struct NXGI_SCALE_JOB NXGI_SCALE_JOB;
+struct NXGI_SCALE_JOB {
+	uint8_t			*dst;
+	uint32_t		dst_stride;
+	uint32_t		dst_w;
+	uint32_t		dst_h;
+
+	const uint8_t	*src;
+	uint32_t		src_stride;
+	uint32_t		src_w;
+	uint32_t		src_h;
+
+	/* Part of the destination rect to write */
+	NXGI_RECT		clip;
+	uint32_t		width;
+	uint32_t		height;
+
+	uint32_t		flags;
+};
+
+/*
+ * 16.16 source step per destination pixel.
+ */
+static inline uint32_t scale_step(uint32_t src_n, uint32_t dst_n)
+{
+	return (uint32_t)udiv64((uint64_t)src_n << 16, dst_n, NULL);
+}
+
+/*
+ * Source pixel nearest to the center of destination pixel `d`.
+ */
+static inline uint32_t scale_nearest_index(uint32_t d, uint32_t step, uint32_t src_n)
+{
+	uint32_t i = (d * step + step / 2) >> 16;
+	return i < src_n ? i : src_n - 1;
+}
+
+/*
+ * Source pixel left of (or above) the center of destination pixel `d` and
+ * the 8-bit weight of the one after it.
+ */
+static inline void scale_bilinear_index(uint32_t d, uint32_t step, uint32_t src_n, uint32_t *i, uint32_t *w)
+{
+	int32_t p = (int32_t)(d * step + step / 2) - 0x8000;
+
+	if (p < 0) {
+		p = 0;
+	}
+
+	if ((uint32_t)p >= (src_n - 1) << 16) {
+		*i = src_n - 1;
+		*w = 0;
+		return;
+	}
+
+	*i = p >> 16;
+	*w = (p >> 8) & 0xFF;
+}
+
+/*
+ * Per-channel (a * (256 - w) + b * w) >> 8, two channels at a time. Each
+ * channel's sum stays within 16 bits, so they don't carry into each other.
+ */
+static inline uint32_t scale_lerp(uint32_t a, uint32_t b, uint32_t w)
+{
+	uint32_t rb = (((a & 0xFF00FF) * (256 - w) + (b & 0xFF00FF) * w) >> 8) & 0xFF00FF;
+	uint32_t ag = (((a >> 8) & 0xFF00FF) * (256 - w) + ((b >> 8) & 0xFF00FF) * w) & 0xFF00FF00;
+
+	return rb | ag;
+}
+
+static HRESULT scale_nearest(NXGI_SCALE_JOB *job)
+{
+	uint32_t		step_x = scale_step(job->src_w, job->dst_w);
+	uint32_t		step_y = scale_step(job->src_h, job->dst_h);
+	uint32_t		*xs, *drow, *prev_row = NULL;
+	const uint32_t	*srow;
+	uint32_t		x, y, sy, prev_sy = 0xFFFFFFFF;
+
+	if (!(xs = kmalloc(job->width * sizeof(uint32_t)))) {
+		return E_OUTOFMEM;
+	}
+
+	for (x=0; x<job->width; x++) {
+		xs[x] = scale_nearest_index(job->clip.x1 + x, step_x, job->src_w);
+	}
+
+	for (y=0; y<job->height; y++) {
+		drow = (uint32_t*)(job->dst + y * job->dst_stride);
+		sy = scale_nearest_index(job->clip.y1 + y, step_y, job->src_h);
+
+		/* Upscaling repeats rows. Reading back the frame buffer is slow though. */
+		if (sy == prev_sy && !(job->flags & NXGI_SPAN_NT)) {
+			nxgi_span_copy(drow, prev_row, job->width, job->flags);
+		} else {
+			srow = (const uint32_t*)(job->src + sy * job->src_stride);
+
+			for (x=0; x<job->width; x++) {
+				drow[x] = srow[xs[x]];
+			}
+		}
+
+		prev_sy = sy;
+		prev_row = drow;
+	}
+
+	kfree(xs);
+	return S_OK;
+}
+
+/*
+ * Interpolates source row `sy` horizontally. Table entries hold the left
+ * source pixel in the upper bits and it's neighbour's weight in the lowest 8.
+ */
+static void scale_bilinear_row(NXGI_SCALE_JOB *job, const uint32_t *tab, uint32_t sy, uint32_t *out)
+{
+	const uint32_t	*srow = (const uint32_t*)(job->src + sy * job->src_stride);
+	uint32_t		x, i, w;
+
+	for (x=0; x<job->width; x++) {
+		i = tab[x] >> 8;
+		w = tab[x] & 0xFF;
+
+		/* The last pixel of a row always has a zero weight */
+		out[x] = w ? scale_lerp(srow[i], srow[i + 1], w) : srow[i];
+	}
+}
+
+static HRESULT scale_bilinear(NXGI_SCALE_JOB *job)
+{
+	uint32_t	step_x = scale_step(job->src_w, job->dst_w);
+	uint32_t	step_y = scale_step(job->src_h, job->dst_h);
+	uint32_t	*tab, *rows, *r0, *r1, *tmp, *drow;
+	uint32_t	i0 = 0xFFFFFFFF, i1 = 0xFFFFFFFF;
+	uint32_t	x, y, sx, sy, wx, wy, t;
+
+	tab = kmalloc(job->width * sizeof(uint32_t));
+	rows = kmalloc(2 * job->width * sizeof(uint32_t));
+
+	if (!tab || !rows) {
+		if (tab) kfree(tab);
+		if (rows) kfree(rows);
+		return E_OUTOFMEM;
+	}
+
+	for (x=0; x<job->width; x++) {
+		scale_bilinear_index(job->clip.x1 + x, step_x, job->src_w, &sx, &wx);
+		tab[x] = (sx << 8) | wx;
+	}
+
+	/* Interpolated source rows sy (r0) and sy + 1 (r1), kept while the next
+	 * destination row needs them too.
+	 */
+	r0 = rows;
+	r1 = rows + job->width;
+
+	for (y=0; y<job->height; y++) {
+		drow = (uint32_t*)(job->dst + y * job->dst_stride);
+		scale_bilinear_index(job->clip.y1 + y, step_y, job->src_h, &sy, &wy);
+
+		if (i0 != sy) {
+			if (i1 == sy) {
+				tmp = r0; r0 = r1; r1 = tmp;
+				t = i0; i0 = i1; i1 = t;
+			} else {
+				scale_bilinear_row(job, tab, sy, r0);
+				i0 = sy;
+			}
+		}
+
+		if (wy == 0) {
+			nxgi_span_copy(drow, r0, job->width, job->flags);
+			continue;
+		}
+
+		if (i1 != sy + 1) {
+			scale_bilinear_row(job, tab, sy + 1, r1);
+			i1 = sy + 1;
+		}
+
+		nxgi_span_lerp(drow, r0, r1, wy, job->width);
+	}
+
+	kfree(tab);
+	kfree(rows);
+
+	return S_OK;
+}
+
+/*
+ * Computes box filter taps for destination pixels [d1..d2) of an axis.
+ */
+static HRESULT scale_box_axis(uint32_t src_n, uint32_t dst_n, uint32_t d1, uint32_t d2, NXGI_SCALE_AXIS *axis)
+{
+	uint32_t	step = scale_step(src_n, dst_n);
+	uint32_t	n = d2 - d1, max_weights = n * ((step >> 16) + 3);
+	uint32_t	d, i, lo, hi, start, end, total, sum, wi = 0;
+	NXGI_SCALE_TAP *tap;
+
+	axis->taps = kmalloc(n * sizeof(NXGI_SCALE_TAP));
+	axis->weights = kmalloc(max_weights * sizeof(uint32_t));
+
+	if (!axis->taps || !axis->weights) {
+		return E_OUTOFMEM;
+	}
+
+	for (d=d1; d<d2; d++) {
+		tap = &axis->taps[d - d1];
+
+		/* Source interval covered, in 16.16 */
+		start = d * step;
+		end = d == dst_n - 1 ? src_n << 16 : (d + 1) * step;
+		total = end > start ? end - start : 1;
+
+		tap->first = start >> 16;
+		tap->count = end > start ? ((end - 1) >> 16) - tap->first + 1 : 1;
+		tap->weight = wi;
+
+		if (tap->first + tap->count > src_n) {
+			tap->count = src_n - tap->first;
+		}
+
+		sum = 0;
+
+		for (i=tap->first; i<tap->first + tap->count; i++) {
+			lo = start > (i << 16) ? start : (i << 16);
+			hi = end < ((i + 1) << 16) ? end : ((i + 1) << 16);
+
+			axis->weights[wi] = hi > lo ? (uint32_t)udiv64((uint64_t)(hi - lo) << 16, total, NULL) : 0;
+			sum += axis->weights[wi++];
+		}
+
+		/* Rounding leftovers go to the first pixel */
+		axis->weights[tap->weight] += 65536 - sum;
+	}
+
+	return S_OK;
+}
+
+static void scale_box_row(NXGI_SCALE_JOB *job, NXGI_SCALE_AXIS *ax, uint32_t sy, uint32_t *out)
+{
+	const uint32_t	*srow = (const uint32_t*)(job->src + sy * job->src_stride);
+	const uint32_t	*w;
+	NXGI_SCALE_TAP	*tap;
+	uint32_t		x, k, p, b, g, r, a;
+
+	for (x=0; x<job->width; x++) {
+		tap = &ax->taps[x];
+		w = &ax->weights[tap->weight];
+		b = g = r = a = 0x8000;
+
+		for (k=0; k<tap->count; k++) {
+			p = srow[tap->first + k];
+
+			b += (p & 0xFF) * w[k];
+			g += ((p >> 8) & 0xFF) * w[k];
+			r += ((p >> 16) & 0xFF) * w[k];
+			a += (p >> 24) * w[k];
+		}
+
+		out[x] = (b >> 16) | ((g >> 16) << 8) | ((r >> 16) << 16) | ((a >> 16) << 24);
+	}
+}
+
+static HRESULT scale_box(NXGI_SCALE_JOB *job)
+{
+	NXGI_SCALE_AXIS	ax = { NULL, NULL }, ay = { NULL, NULL };
+	NXGI_SCALE_TAP	*tap;
+	uint32_t		*acc = NULL, *rows = NULL, *row, *drow;
+	uint32_t		row_idx[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+	uint32_t		x, y, k, sy, w, p, victim = 0;
+	HRESULT			hr;
+
+	hr = scale_box_axis(job->src_w, job->dst_w, job->clip.x1, job->clip.x2, &ax);
+	if (FAILED(hr)) goto finally;
+
+	hr = scale_box_axis(job->src_h, job->dst_h, job->clip.y1, job->clip.y2, &ay);
+	if (FAILED(hr)) goto finally;
+
+	acc = kmalloc(4 * job->width * sizeof(uint32_t));
+	rows = kmalloc(2 * job->width * sizeof(uint32_t));
+
+	if (!acc || !rows) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (y=0; y<job->height; y++) {
+		tap = &ay.taps[y];
+		drow = (uint32_t*)(job->dst + y * job->dst_stride);
+
+		for (x=0; x<4*job->width; x++) {
+			acc[x] = 0x8000;
+		}
+
+		for (k=0; k<tap->count; k++) {
+			sy = tap->first + k;
+			w = ay.weights[tap->weight + k];
+
+			/* Neighbouring destination rows share their boundary source row */
+			if (row_idx[0] == sy) {
+				row = rows;
+			} else if (row_idx[1] == sy) {
+				row = rows + job->width;
+			} else {
+				row = rows + victim * job->width;
+				row_idx[victim] = sy;
+				victim ^= 1;
+
+				scale_box_row(job, &ax, sy, row);
+			}
+
+			for (x=0; x<job->width; x++) {
+				p = row[x];
+
+				acc[4*x + 0] += (p & 0xFF) * w;
+				acc[4*x + 1] += ((p >> 8) & 0xFF) * w;
+				acc[4*x + 2] += ((p >> 16) & 0xFF) * w;
+				acc[4*x + 3] += (p >> 24) * w;
+			}
+		}
+
+		for (x=0; x<job->width; x++) {
+			drow[x] = (acc[4*x] >> 16) | ((acc[4*x + 1] >> 16) << 8) | ((acc[4*x + 2] >> 16) << 16) | ((acc[4*x + 3] >> 16) << 24);
+		}
+	}
+
+finally:
+	if (ax.taps) kfree(ax.taps);
+	if (ax.weights) kfree(ax.weights);
+	if (ay.taps) kfree(ay.taps);
+	if (ay.weights) kfree(ay.weights);
+	if (acc) kfree(acc);
+	if (rows) kfree(rows);
+
+	return hr;
+}
+
+HRESULT __nxapi nxgi_scale(uint8_t *dst, uint32_t dst_stride, uint32_t dst_w, uint32_t dst_h, NXGI_RECT clip,
+						const uint8_t *src, uint32_t src_stride, uint32_t src_w, uint32_t src_h,
+						NXGI_FILTER filter, uint32_t flags)
+{
+	NXGI_SCALE_JOB job;
+
+	if (dst == NULL || src == NULL) {
+		return E_POINTER;
+	}
+
+	if (src_w == 0 || src_h == 0 || dst_w == 0 || dst_h == 0) {
+		return S_FALSE;
+	}
+
+	if (src_w > NXGI_SCALE_MAX_SRC || src_h > NXGI_SCALE_MAX_SRC) {
+		return E_INVALIDARG;
+	}
+
+	if (clip.x1 < 0 || clip.y1 < 0 || clip.x2 > (int32_t)dst_w || clip.y2 > (int32_t)dst_h) {
+		return E_INVALIDARG;
+	}
+
+	if (clip.x1 >= clip.x2 || clip.y1 >= clip.y2) {
+		return S_FALSE;
+	}
+
+	job.dst = dst;
+	job.dst_stride = dst_stride;
+	job.dst_w = dst_w;
+	job.dst_h = dst_h;
+	job.src = src;
+	job.src_stride = src_stride;
+	job.src_w = src_w;
+	job.src_h = src_h;
+	job.clip = clip;
+	job.width = RECT_WIDTH(clip);
+	job.height = RECT_HEIGHT(clip);
+	job.flags = flags;
+
+	/* All filters reduce to a copy at 1:1 */
+	if (src_w == dst_w && src_h == dst_h) {
+		nxgi_span_copy_rect(dst, dst_stride, src + clip.y1 * src_stride + clip.x1 * 4, src_stride, job.width, job.height, flags);
+		return S_OK;
+	}
+
+	if (filter == NXGI_FILTER_BILINEAR && (src_w >= 2 * dst_w || src_h >= 2 * dst_h)) {
+		filter = NXGI_FILTER_BOX;
+	}
+
+	switch (filter) {
+		case NXGI_FILTER_NEAREST:
+			return scale_nearest(&job);
+
+		case NXGI_FILTER_BILINEAR:
+			return scale_bilinear(&job);
+
+		case NXGI_FILTER_BOX:
+			return scale_box(&job);
+
+		default:
+			return E_INVALIDARG;
+	}
+}
+
+/*
+ * Benchmark and self-check. Scaled test images are compared with digests of
+ * known good output (FNV-1a over the pixels). Clipped blits must match the
+ * same part of the unclipped output, uniform images must stay uniform.
+ */
+#define SCALE_BENCH_TIME		2000
+
+typedef struct {
+	uint32_t	src_w, src_h;
+	uint32_t	dst_w, dst_h;
+	NXGI_FILTER	filter;
+	uint32_t	digest;
+} SCALE_BENCH_CASE;
+
+static const SCALE_BENCH_CASE scale_bench_cases[] = {
+		{ 37, 23, 100, 61, NXGI_FILTER_NEAREST, 0xB330DB86 },
+		{ 37, 23, 100, 61, NXGI_FILTER_BILINEAR, 0x24261C0C },
+		{ 37, 23, 100, 61, NXGI_FILTER_BOX, 0x4AEF60E3 },
+		{ 200, 150, 64, 48, NXGI_FILTER_NEAREST, 0xD75CA8B2 },
+		{ 200, 150, 64, 48, NXGI_FILTER_BILINEAR, 0x7498886F },
+		{ 200, 150, 150, 113, NXGI_FILTER_BILINEAR, 0x106C7840 },
+		{ 200, 150, 21, 130, NXGI_FILTER_BOX, 0x41784174 },
+		{ 64, 64, 64, 64, NXGI_FILTER_BILINEAR, 0x92C63A99 }
+};
+
+static const char *scale_filter_names[] = { "nearest", "bilinear", "box" };
+
+static void scale_bench_image(uint32_t *p, uint32_t w, uint32_t h)
+{
+	uint32_t x, y, seed = 12345;
+
+	/* Gradients with some noise on top */
+	for (y=0; y<h; y++) {
+		for (x=0; x<w; x++) {
+			seed = seed * 1103515245 + 12345;
+			p[y * w + x] = ((x * 255 / w) ^ ((seed >> 16) & 0x0F))
+					| (((y * 255 / h) ^ ((seed >> 20) & 0x0F)) << 8)
+					| ((((x + y) * 127 / (w + h)) ^ ((seed >> 24) & 0x0F)) << 16)
+					| (((seed >> 8) & 0xFF) << 24);
+		}
+	}
+}
+
+static uint32_t scale_bench_digest(const uint32_t *p, uint32_t count)
+{
+	uint32_t h = 2166136261u;
+	uint32_t i, k;
+
+	for (i=0; i<count; i++) {
+		for (k=0; k<32; k+=8) {
+			h = (h ^ ((p[i] >> k) & 0xFF)) * 16777619u;
+		}
+	}
+
+	return h;
+}
+
+static HRESULT scale_bench_check()
+{
+	const SCALE_BENCH_CASE	*c;
+	uint32_t				*src = NULL, *dst = NULL, *part = NULL;
+	uint32_t				i, x, y, digest;
+	NXGI_RECT				clip;
+	HRESULT					hr = S_OK;
+
+	src = kmalloc(200 * 150 * 4);
+	dst = kmalloc(150 * 130 * 4);
+	part = kmalloc(150 * 130 * 4);
+
+	if (!src || !dst || !part) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	for (i=0; i<sizeof(scale_bench_cases) / sizeof(SCALE_BENCH_CASE); i++) {
+		c = &scale_bench_cases[i];
+
+		/* Golden output */
+		scale_bench_image(src, c->src_w, c->src_h);
+
+		hr = nxgi_scale((uint8_t*)dst, c->dst_w * 4, c->dst_w, c->dst_h, RECT(0, 0, c->dst_w, c->dst_h),
+				(uint8_t*)src, c->src_w * 4, c->src_w, c->src_h, c->filter, 0);
+		if (FAILED(hr)) goto finally;
+
+		digest = scale_bench_digest(dst, c->dst_w * c->dst_h);
+		if (digest != c->digest) {
+			k_printf("%dx%d -> %dx%d %s: digest 0x%X, expected 0x%X.\n", c->src_w, c->src_h, c->dst_w, c->dst_h,
+					scale_filter_names[c->filter], digest, c->digest);
+			hr = E_FAIL;
+			goto finally;
+		}
+
+		/* Clipping must not change the output */
+		clip = RECT(c->dst_w / 3, c->dst_h / 4, c->dst_w - 2, c->dst_h - c->dst_h / 5);
+
+		hr = nxgi_scale((uint8_t*)part, c->dst_w * 4, c->dst_w, c->dst_h, clip,
+				(uint8_t*)src, c->src_w * 4, c->src_w, c->src_h, c->filter, 0);
+		if (FAILED(hr)) goto finally;
+
+		for (y=0; y<(uint32_t)RECT_HEIGHT(clip); y++) {
+			for (x=0; x<(uint32_t)RECT_WIDTH(clip); x++) {
+				if (part[y * c->dst_w + x] != dst[(clip.y1 + y) * c->dst_w + clip.x1 + x]) {
+					k_printf("%s: clipped output differs at %d,%d.\n", scale_filter_names[c->filter], clip.x1 + x, clip.y1 + y);
+					hr = E_FAIL;
+					goto finally;
+				}
+			}
+		}
+
+		/* A uniform image stays uniform */
+		for (x=0; x<c->src_w * c->src_h; x++) {
+			src[x] = 0x80C03010;
+		}
+
+		hr = nxgi_scale((uint8_t*)dst, c->dst_w * 4, c->dst_w, c->dst_h, RECT(0, 0, c->dst_w, c->dst_h),
+				(uint8_t*)src, c->src_w * 4, c->src_w, c->src_h, c->filter, 0);
+		if (FAILED(hr)) goto finally;
+
+		for (x=0; x<c->dst_w * c->dst_h; x++) {
+			if (dst[x] != 0x80C03010) {
+				k_printf("%s: uniform image changed to 0x%X.\n", scale_filter_names[c->filter], dst[x]);
+				hr = E_FAIL;
+				goto finally;
+			}
+		}
+	}
+
+	k_printf("Scaler output matches %d golden images.\n", i);
+
+finally:
+	if (src) kfree(src);
+	if (dst) kfree(dst);
+	if (part) kfree(part);
+
+	return hr;
+}
+
+/*
+ * Scales `src` onto `dst` until SCALE_BENCH_TIME elapses and returns the
+ * destination Mpixels/s, times 10.
+ */
+static uint32_t scale_bench_rate(NXGI_BITMAP *dst, NXGI_BITMAP *src, NXGI_FILTER filter)
+{
+	uint32_t start, elapsed;
+	uint64_t pixels = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		nxgi_scale(dst->pBits, dst->stride, dst->width, dst->height, RECT(0, 0, dst->width, dst->height),
+				src->pBits, src->stride, src->width, src->height, filter, 0);
+
+		pixels += dst->width * dst->height;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < SCALE_BENCH_TIME);
+
+	return (uint32_t)udiv64(pixels * 10, elapsed * 1000, NULL);
+}
+
+HRESULT __nxapi nxgi_scale_benchmark()
+{
+	NXGI_BITMAP	*big = NULL, *small = NULL;
+	uint32_t	f, down, up;
+	HRESULT		hr;
+
+	nxgi_span_initialize();
+
+	hr = scale_bench_check();
+	if (FAILED(hr)) return hr;
+
+	hr = nxgi_create_bitmap(1920, 1080, NXGI_FORMAT_BGRA32, &big);
+	if (FAILED(hr)) goto finally;
+
+	hr = nxgi_create_bitmap(800, 600, NXGI_FORMAT_BGRA32, &small);
+	if (FAILED(hr)) goto finally;
+
+	scale_bench_image(big->pBits, big->width, big->height);
+
+	for (f=NXGI_FILTER_NEAREST; f<=NXGI_FILTER_BOX; f++) {
+		down = scale_bench_rate(small, big, f);
+		up = scale_bench_rate(big, small, f);
+
+		/* Bilinear 1920x1080 -> 800x600 is a box filter, see nxgi_scale() */
+		k_printf("%s: 1920x1080 -> 800x600 %d.%d, 800x600 -> 1920x1080 %d.%d Mpixels/s\n", scale_filter_names[f],
+				down / 10, down % 10, up / 10, up % 10);
+	}
+
+finally:
+	if (big) nxgi_destroy_bitmap(&big);
+	if (small) nxgi_destroy_bitmap(&small);
+
+	return hr;
+}
@@ -0,0 +1,46 @@
+/*
+ * nxgi_scale.h
+ *
+ *	Scaled blits (stretchblt) of BGRA32 bitmaps.
+ *
+ *	Source positions are stepped in 16.16 fixed point, sampling at pixel
+ *	centers. Per-column sample positions and weights are computed once per
+ *	blit into tables, so the inner loops only do table lookups.
+ *
+ *	- Nearest neighbour: one source pixel per destination pixel. Destination
+ *	  rows mapping to the same source row are copied from the previous one.
+ *	- Bilinear: each source row is interpolated horizontally once, the two
+ *	  rows around a destination row are then interpolated with the span
+ *	  lerp kernel (SSE2/AVX2). Weights have 8 bits of precision.
+ *	- Box: each destination pixel averages the source area it covers, with
+ *	  fractional coverage at the edges. Bilinear filtering switches to it
+ *	  when the source is reduced to half or less along either axis, where
+ *	  bilinear would skip source pixels.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_SCALE_H_
+#define SUBSYSTEMS_NXGI_SCALE_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/**
+ * Scales a `src_w` x `src_h` block of pixels at `src` onto a `dst_w` x
+ * `dst_h` destination rectangle. Only the part of the destination within
+ * `clip` (relative to the destination rectangle) is written; `dst` points at
+ * it's top-left pixel. `flags` are span flags (NXGI_SPAN_*).
+ */
+HRESULT		__nxapi nxgi_scale(uint8_t *dst, uint32_t dst_stride, uint32_t dst_w, uint32_t dst_h, NXGI_RECT clip,
+						const uint8_t *src, uint32_t src_stride, uint32_t src_w, uint32_t src_h,
+						NXGI_FILTER filter, uint32_t flags);
+
+/**
+ * Checks the scalers against known output and scales 1920x1080 to 800x600
+ * and back with each filter.
+ */
+HRESULT		__nxapi nxgi_scale_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_SCALE_H_ */
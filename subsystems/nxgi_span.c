@@ -0,0 +1,1363 @@
+/*
+ * nxgi_span.c
+ *
+ *	Span kernels of the BGRA32 rasterizer.
+ *
+ *	Vector kernels are written in inline assembly, since the compiler's
+ *	intrinsic headers can't be used in a freestanding kernel. Functions using
+ *	SSE/AVX registers are compiled with a target attribute, so the rest of the
+ *	kernel never touches them.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+#include <cpuid.h>
+#include <string.h>
+#include <stdlib.h>
+#include <mm.h>
+#include <hal.h>
+#include <timer.h>
+#include <kstdio.h>
+#include "nxgi_span.h"
+
+/* EFLAGS interrupt flag */
+#define EFLAGS_IF				0x200
+
+/* CPUID feature bits */
+#define CPUID_1_EDX_SSE2		(1 << 26)
+#define CPUID_1_ECX_XSAVE		(1 << 26)
+#define CPUID_1_ECX_AVX			(1 << 28)
+#define CPUID_7_EBX_AVX2		(1 << 5)
+
+/*
+ * Prototypes
+ */
+static void span_fill_c(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags);
+static void span_copy_c(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags);
+static void span_blend_c(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count);
+static void span_lerp_c(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count);
+static void span_over_c(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count);
+static void span_mask_c(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count);
+static void span_fill_sse2(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags);
+static void span_copy_sse2(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags);
+static void span_blend_sse2(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count);
+static void span_lerp_sse2(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count);
+static void span_over_sse2(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count);
+static void span_mask_sse2(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count);
+static void span_fill_avx2(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags);
+static void span_copy_avx2(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags);
+static void span_blend_avx2(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count);
+static void span_lerp_avx2(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count);
+static void span_over_avx2(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count);
+static void span_mask_avx2(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count);
+
+static const NXGI_SPAN_OPS span_ops[NXGI_SPAN_ISA_COUNT] = {
+		{
+				.name = "C",
+				.vector = FALSE,
+				.fill = span_fill_c,
+				.copy = span_copy_c,
+				.blend = span_blend_c,
+				.lerp = span_lerp_c,
+				.over = span_over_c,
+				.mask = span_mask_c
+		},
+		{
+				.name = "SSE2",
+				.vector = TRUE,
+				.fill = span_fill_sse2,
+				.copy = span_copy_sse2,
+				.blend = span_blend_sse2,
+				.lerp = span_lerp_sse2,
+				.over = span_over_sse2,
+				.mask = span_mask_sse2
+		},
+		{
+				.name = "AVX2",
+				.vector = TRUE,
+				.fill = span_fill_avx2,
+				.copy = span_copy_avx2,
+				.blend = span_blend_avx2,
+				.lerp = span_lerp_avx2,
+				.over = span_over_avx2,
+				.mask = span_mask_avx2
+		}
+};
+
+/*
+ * Lane constants of the compositing kernels, as memory operands, since all
+ * eight vector registers are taken. Sized for AVX2.
+ */
+static const struct {
+	uint16_t	round[16];
+	uint16_t	mul[16];
+	uint16_t	inv[16];
+	uint8_t		ones[32];
+} __attribute__((aligned(32))) span_k = {
+		.round = { [0 ... 15] = 0x80 },
+		.mul = { [0 ... 15] = 0x101 },
+		.inv = { [0 ... 15] = 0xFF },
+		.ones = { [0 ... 31] = 0xFF }
+};
+
+static BOOL					span_supported[NXGI_SPAN_ISA_COUNT] = { TRUE, FALSE, FALSE };
+static BOOL					span_initialized = FALSE;
+static NXGI_SPAN_ISA		span_isa = NXGI_SPAN_ISA_C;
+static const NXGI_SPAN_OPS	*span_cur = &span_ops[NXGI_SPAN_ISA_C];
+
+/*
+ * Vector registers are only safe while we can't be preempted.
+ */
+static inline uint32_t span_begin(const NXGI_SPAN_OPS *ops)
+{
+	uint32_t intf;
+
+	if (!ops->vector) {
+		return 0;
+	}
+
+	intf = hal_get_eflags() & EFLAGS_IF;
+	hal_cli();
+
+	return intf;
+}
+
+static inline void span_end(uint32_t intf)
+{
+	if (intf) hal_sti();
+}
+
+/*
+ * C kernels. These are also the reference the vector kernels are
+ * checked against.
+ */
+static void span_fill_c(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags)
+{
+	UNUSED_ARG(flags);
+
+	while (count--) {
+		*dst++ = color;
+	}
+}
+
+static void span_copy_c(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags)
+{
+	UNUSED_ARG(flags);
+
+	while (count--) {
+		*dst++ = *src++;
+	}
+}
+
+static inline uint32_t span_blend_pixel(uint32_t d, uint32_t color, uint32_t alpha)
+{
+	uint32_t i, c, r = 0;
+
+	for (i=0; i<32; i+=8) {
+		c = (((color >> i) & 0xFF) * alpha + ((d >> i) & 0xFF) * (256 - alpha)) >> 8;
+		r |= c << i;
+	}
+
+	return r;
+}
+
+static void span_blend_c(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count)
+{
+	while (count--) {
+		*dst = span_blend_pixel(*dst, color, alpha);
+		dst++;
+	}
+}
+
+static void span_lerp_c(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count)
+{
+	while (count--) {
+		*dst++ = span_blend_pixel(*a++, *b++, w);
+	}
+}
+
+/*
+ * Premultiplied source over destination. Channels saturate, like packuswb
+ * does, in case the source isn't properly premultiplied.
+ */
+static inline uint32_t span_over_pixel(uint32_t d, uint32_t s, uint32_t alpha)
+{
+	uint32_t i, c, ia, r = 0;
+
+	if (alpha != 255) {
+		s = nxgi_span_scale(s, alpha);
+	}
+
+	ia = 255 - (s >> 24);
+
+	for (i=0; i<32; i+=8) {
+		c = ((s >> i) & 0xFF) + nxgi_span_mul255((d >> i) & 0xFF, ia);
+		r |= (c > 255 ? 255 : c) << i;
+	}
+
+	return r;
+}
+
+static void span_over_c(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count)
+{
+	uint32_t s;
+
+	while (count--) {
+		s = *src++;
+
+		if ((s >> 24) == 255 && alpha == 255) {
+			*dst = s;
+		} else if ((s >> 24) != 0) {
+			*dst = span_over_pixel(*dst, s, alpha);
+		}
+
+		dst++;
+	}
+}
+
+static void span_mask_c(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count)
+{
+	while (count--) {
+		if (*mask != 0) {
+			*dst = span_over_pixel(*dst, color, *mask);
+		}
+
+		dst++;
+		mask++;
+	}
+}
+
+/*
+ * SSE2 kernels. The loops take 8 pixels (two registers) per iteration,
+ * the blend loop 4 since it widens pixels to 16 bits per channel.
+ */
+static void __attribute__((target("sse2"))) span_fill_sse2(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags)
+{
+	uint32_t n;
+
+	/* Head, up to a 16 byte boundary */
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		*dst++ = color;
+		count--;
+	}
+
+	if ((n = count / 8) > 0) {
+		if (flags & NXGI_SPAN_NT) {
+			asm volatile(
+					"movd		%[c], %%xmm0\n\t"
+					"pshufd		$0, %%xmm0, %%xmm0\n\t"
+					"1:\n\t"
+					"movntdq	%%xmm0, (%[d])\n\t"
+					"movntdq	%%xmm0, 16(%[d])\n\t"
+					"add		$32, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b\n\t"
+					"sfence"
+					: [d] "+r" (dst), [n] "+r" (n)
+					: [c] "r" (color)
+					: "xmm0", "memory", "cc");
+		} else {
+			asm volatile(
+					"movd		%[c], %%xmm0\n\t"
+					"pshufd		$0, %%xmm0, %%xmm0\n\t"
+					"1:\n\t"
+					"movdqa		%%xmm0, (%[d])\n\t"
+					"movdqa		%%xmm0, 16(%[d])\n\t"
+					"add		$32, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b"
+					: [d] "+r" (dst), [n] "+r" (n)
+					: [c] "r" (color)
+					: "xmm0", "memory", "cc");
+		}
+
+		count %= 8;
+	}
+
+	/* Tail */
+	while (count--) {
+		*dst++ = color;
+	}
+}
+
+static void __attribute__((target("sse2"))) span_copy_sse2(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags)
+{
+	uint32_t n;
+
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		*dst++ = *src++;
+		count--;
+	}
+
+	/* Source alignment is whatever it is, so loads are unaligned */
+	if ((n = count / 8) > 0) {
+		if (flags & NXGI_SPAN_NT) {
+			asm volatile(
+					"1:\n\t"
+					"movdqu		(%[s]), %%xmm0\n\t"
+					"movdqu		16(%[s]), %%xmm1\n\t"
+					"movntdq	%%xmm0, (%[d])\n\t"
+					"movntdq	%%xmm1, 16(%[d])\n\t"
+					"add		$32, %[s]\n\t"
+					"add		$32, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b\n\t"
+					"sfence"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n)
+					:
+					: "xmm0", "xmm1", "memory", "cc");
+		} else {
+			asm volatile(
+					"1:\n\t"
+					"movdqu		(%[s]), %%xmm0\n\t"
+					"movdqu		16(%[s]), %%xmm1\n\t"
+					"movdqa		%%xmm0, (%[d])\n\t"
+					"movdqa		%%xmm1, 16(%[d])\n\t"
+					"add		$32, %[s]\n\t"
+					"add		$32, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n)
+					:
+					: "xmm0", "xmm1", "memory", "cc");
+		}
+
+		count %= 8;
+	}
+
+	while (count--) {
+		*dst++ = *src++;
+	}
+}
+
+static void __attribute__((target("sse2"))) span_blend_sse2(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count)
+{
+	uint32_t n, inv = 256 - alpha;
+
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		*dst = span_blend_pixel(*dst, color, alpha);
+		dst++;
+		count--;
+	}
+
+	/*
+	 * xmm4 holds color * alpha and xmm5 (256 - alpha), as 16-bit lanes.
+	 * The sum of both products never exceeds 255 * 256, so it fits.
+	 */
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"pxor		%%xmm7, %%xmm7\n\t"
+				"movd		%[a], %%xmm6\n\t"
+				"pshuflw	$0, %%xmm6, %%xmm6\n\t"
+				"pshufd		$0, %%xmm6, %%xmm6\n\t"
+				"movd		%[ia], %%xmm5\n\t"
+				"pshuflw	$0, %%xmm5, %%xmm5\n\t"
+				"pshufd		$0, %%xmm5, %%xmm5\n\t"
+				"movd		%[c], %%xmm4\n\t"
+				"pshufd		$0, %%xmm4, %%xmm4\n\t"
+				"punpcklbw	%%xmm7, %%xmm4\n\t"
+				"pmullw		%%xmm6, %%xmm4\n\t"
+				"1:\n\t"
+				"movdqa		(%[d]), %%xmm0\n\t"
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"punpcklbw	%%xmm7, %%xmm0\n\t"
+				"punpckhbw	%%xmm7, %%xmm1\n\t"
+				"pmullw		%%xmm5, %%xmm0\n\t"
+				"pmullw		%%xmm5, %%xmm1\n\t"
+				"paddw		%%xmm4, %%xmm0\n\t"
+				"paddw		%%xmm4, %%xmm1\n\t"
+				"psrlw		$8, %%xmm0\n\t"
+				"psrlw		$8, %%xmm1\n\t"
+				"packuswb	%%xmm1, %%xmm0\n\t"
+				"movdqa		%%xmm0, (%[d])\n\t"
+				"add		$16, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (dst), [n] "+r" (n)
+				: [c] "r" (color), [a] "r" (alpha), [ia] "r" (inv)
+				: "xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 4;
+	}
+
+	while (count--) {
+		*dst = span_blend_pixel(*dst, color, alpha);
+		dst++;
+	}
+}
+
+static void __attribute__((target("sse2"))) span_lerp_sse2(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count)
+{
+	uint32_t n, inv = 256 - w;
+
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		*dst++ = span_blend_pixel(*a++, *b++, w);
+		count--;
+	}
+
+	/* Weights are memory operands, there are no registers left */
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"pxor		%%xmm7, %%xmm7\n\t"
+				"movd		%[w], %%xmm6\n\t"
+				"pshuflw	$0, %%xmm6, %%xmm6\n\t"
+				"pshufd		$0, %%xmm6, %%xmm6\n\t"
+				"movd		%[iw], %%xmm5\n\t"
+				"pshuflw	$0, %%xmm5, %%xmm5\n\t"
+				"pshufd		$0, %%xmm5, %%xmm5\n\t"
+				"1:\n\t"
+				"movdqu		(%[a]), %%xmm0\n\t"
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"punpcklbw	%%xmm7, %%xmm0\n\t"
+				"punpckhbw	%%xmm7, %%xmm1\n\t"
+				"movdqu		(%[b]), %%xmm2\n\t"
+				"movdqa		%%xmm2, %%xmm3\n\t"
+				"punpcklbw	%%xmm7, %%xmm2\n\t"
+				"punpckhbw	%%xmm7, %%xmm3\n\t"
+				"pmullw		%%xmm5, %%xmm0\n\t"
+				"pmullw		%%xmm5, %%xmm1\n\t"
+				"pmullw		%%xmm6, %%xmm2\n\t"
+				"pmullw		%%xmm6, %%xmm3\n\t"
+				"paddw		%%xmm2, %%xmm0\n\t"
+				"paddw		%%xmm3, %%xmm1\n\t"
+				"psrlw		$8, %%xmm0\n\t"
+				"psrlw		$8, %%xmm1\n\t"
+				"packuswb	%%xmm1, %%xmm0\n\t"
+				"movdqa		%%xmm0, (%[d])\n\t"
+				"add		$16, %[a]\n\t"
+				"add		$16, %[b]\n\t"
+				"add		$16, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (dst), [a] "+r" (a), [b] "+r" (b), [n] "+r" (n)
+				: [w] "m" (w), [iw] "m" (inv)
+				: "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 4;
+	}
+
+	while (count--) {
+		*dst++ = span_blend_pixel(*a++, *b++, w);
+	}
+}
+
+/*
+ * Second half of SSE2 compositing. Expects the source of 4 pixels as 16-bit
+ * lanes in xmm0 (pixels 0-1) and xmm1 (2-3), and zero in xmm7. Computes
+ * src + dst * (255 - src.a) / 255 and stores it at (%[d]).
+ */
+#define SPAN_OVER_SSE2 \
+		"pshuflw	$0xFF, %%xmm0, %%xmm2\n\t" \
+		"pshufhw	$0xFF, %%xmm2, %%xmm2\n\t" \
+		"pshuflw	$0xFF, %%xmm1, %%xmm3\n\t" \
+		"pshufhw	$0xFF, %%xmm3, %%xmm3\n\t" \
+		"pxor		%[inv], %%xmm2\n\t" \
+		"pxor		%[inv], %%xmm3\n\t" \
+		"movdqa		(%[d]), %%xmm5\n\t" \
+		"movdqa		%%xmm5, %%xmm6\n\t" \
+		"punpcklbw	%%xmm7, %%xmm5\n\t" \
+		"punpckhbw	%%xmm7, %%xmm6\n\t" \
+		"pmullw		%%xmm2, %%xmm5\n\t" \
+		"pmullw		%%xmm3, %%xmm6\n\t" \
+		"paddw		%[round], %%xmm5\n\t" \
+		"paddw		%[round], %%xmm6\n\t" \
+		"pmulhuw	%[mul], %%xmm5\n\t" \
+		"pmulhuw	%[mul], %%xmm6\n\t" \
+		"paddw		%%xmm5, %%xmm0\n\t" \
+		"paddw		%%xmm6, %%xmm1\n\t" \
+		"packuswb	%%xmm1, %%xmm0\n\t" \
+		"movdqa		%%xmm0, (%[d])\n\t"
+
+/* x * a / 255 for 16-bit lanes in `x`, the product being already in it */
+#define SPAN_DIV255_SSE2(x) \
+		"paddw		%[round], " x "\n\t" \
+		"pmulhuw	%[mul], " x "\n\t"
+
+static void __attribute__((target("sse2"))) span_over_sse2(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count)
+{
+	uint32_t n, t;
+
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		span_over_c(dst++, src++, alpha, 1);
+		count--;
+	}
+
+	/*
+	 * Groups of 4 transparent source pixels are skipped and opaque ones
+	 * copied, which covers most of a typical window or sprite.
+	 */
+	if ((n = count / 4) > 0) {
+		if (alpha == 255) {
+			asm volatile(
+					"pxor		%%xmm7, %%xmm7\n\t"
+					"1:\n\t"
+					"movdqu		(%[s]), %%xmm0\n\t"
+					"movdqa		%%xmm0, %%xmm1\n\t"
+					"pcmpeqb	%%xmm7, %%xmm1\n\t"
+					"pmovmskb	%%xmm1, %[t]\n\t"
+					"and		$0x8888, %[t]\n\t"
+					"cmp		$0x8888, %[t]\n\t"
+					"je			3f\n\t"
+					"movdqa		%%xmm0, %%xmm1\n\t"
+					"pcmpeqb	%[ones], %%xmm1\n\t"
+					"pmovmskb	%%xmm1, %[t]\n\t"
+					"and		$0x8888, %[t]\n\t"
+					"cmp		$0x8888, %[t]\n\t"
+					"jne		2f\n\t"
+					"movdqa		%%xmm0, (%[d])\n\t"
+					"jmp		3f\n\t"
+					"2:\n\t"
+					"movdqa		%%xmm0, %%xmm1\n\t"
+					"punpcklbw	%%xmm7, %%xmm0\n\t"
+					"punpckhbw	%%xmm7, %%xmm1\n\t"
+					SPAN_OVER_SSE2
+					"3:\n\t"
+					"add		$16, %[s]\n\t"
+					"add		$16, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n), [t] "=&r" (t)
+					: [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv), [ones] "m" (span_k.ones)
+					: "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory", "cc");
+		} else {
+			asm volatile(
+					"pxor		%%xmm7, %%xmm7\n\t"
+					"movd		%[a], %%xmm4\n\t"
+					"pshuflw	$0, %%xmm4, %%xmm4\n\t"
+					"pshufd		$0, %%xmm4, %%xmm4\n\t"
+					"1:\n\t"
+					"movdqu		(%[s]), %%xmm0\n\t"
+					"movdqa		%%xmm0, %%xmm1\n\t"
+					"pcmpeqb	%%xmm7, %%xmm1\n\t"
+					"pmovmskb	%%xmm1, %[t]\n\t"
+					"and		$0x8888, %[t]\n\t"
+					"cmp		$0x8888, %[t]\n\t"
+					"je			3f\n\t"
+					"movdqa		%%xmm0, %%xmm1\n\t"
+					"punpcklbw	%%xmm7, %%xmm0\n\t"
+					"punpckhbw	%%xmm7, %%xmm1\n\t"
+					"pmullw		%%xmm4, %%xmm0\n\t"
+					"pmullw		%%xmm4, %%xmm1\n\t"
+					SPAN_DIV255_SSE2("%%xmm0")
+					SPAN_DIV255_SSE2("%%xmm1")
+					SPAN_OVER_SSE2
+					"3:\n\t"
+					"add		$16, %[s]\n\t"
+					"add		$16, %[d]\n\t"
+					"dec		%[n]\n\t"
+					"jnz		1b"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n), [t] "=&r" (t)
+					: [a] "m" (alpha), [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv)
+					: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+		}
+
+		count %= 4;
+	}
+
+	span_over_c(dst, src, alpha, count);
+}
+
+static void __attribute__((target("sse2"))) span_mask_sse2(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count)
+{
+	uint32_t n, t, opaque = (color >> 24) == 255 ? 0xFFFFFFFF : 0;
+
+	while (count > 0 && ((uintptr_t)dst & 15) != 0) {
+		span_mask_c(dst++, color, mask++, 1);
+		count--;
+	}
+
+	/*
+	 * Four coverage bytes are tested at once: none skips the pixels, full
+	 * coverage by an opaque color just stores it (`opaque` is zero
+	 * otherwise, which never gets that far).
+	 */
+	if ((n = count / 4) > 0) {
+		asm volatile(
+				"pxor		%%xmm7, %%xmm7\n\t"
+				"movd		%[c], %%xmm4\n\t"
+				"pshufd		$0, %%xmm4, %%xmm4\n\t"
+				"punpcklbw	%%xmm7, %%xmm4\n\t"
+				"1:\n\t"
+				"mov		(%[m]), %[t]\n\t"
+				"test		%[t], %[t]\n\t"
+				"jz			3f\n\t"
+				"cmp		%[opq], %[t]\n\t"
+				"jne		2f\n\t"
+				"movdqa		%%xmm4, %%xmm0\n\t"
+				"packuswb	%%xmm0, %%xmm0\n\t"
+				"movdqa		%%xmm0, (%[d])\n\t"
+				"jmp		3f\n\t"
+				"2:\n\t"
+				"movd		%[t], %%xmm0\n\t"
+				"punpcklbw	%%xmm0, %%xmm0\n\t"
+				"punpcklwd	%%xmm0, %%xmm0\n\t"
+				"movdqa		%%xmm0, %%xmm1\n\t"
+				"punpcklbw	%%xmm7, %%xmm0\n\t"
+				"punpckhbw	%%xmm7, %%xmm1\n\t"
+				"pmullw		%%xmm4, %%xmm0\n\t"
+				"pmullw		%%xmm4, %%xmm1\n\t"
+				SPAN_DIV255_SSE2("%%xmm0")
+				SPAN_DIV255_SSE2("%%xmm1")
+				SPAN_OVER_SSE2
+				"3:\n\t"
+				"add		$4, %[m]\n\t"
+				"add		$16, %[d]\n\t"
+				"dec		%[n]\n\t"
+				"jnz		1b"
+				: [d] "+r" (dst), [m] "+r" (mask), [n] "+r" (n), [t] "=&r" (t)
+				: [c] "m" (color), [opq] "m" (opaque), [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv)
+				: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 4;
+	}
+
+	span_mask_c(dst, color, mask, count);
+}
+
+/*
+ * AVX2 kernels, 16 pixels per iteration (8 for blending). VEX unpack and
+ * pack instructions work within 128-bit lanes, which cancels out, since
+ * pixels are packed back the same way they were unpacked.
+ */
+static void __attribute__((target("avx2"))) span_fill_avx2(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags)
+{
+	uint32_t n;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		*dst++ = color;
+		count--;
+	}
+
+	if ((n = count / 16) > 0) {
+		if (flags & NXGI_SPAN_NT) {
+			asm volatile(
+					"vmovd			%[c], %%xmm0\n\t"
+					"vpbroadcastd	%%xmm0, %%ymm0\n\t"
+					"1:\n\t"
+					"vmovntdq		%%ymm0, (%[d])\n\t"
+					"vmovntdq		%%ymm0, 32(%[d])\n\t"
+					"add			$64, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"sfence\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [n] "+r" (n)
+					: [c] "r" (color)
+					: "xmm0", "memory", "cc");
+		} else {
+			asm volatile(
+					"vmovd			%[c], %%xmm0\n\t"
+					"vpbroadcastd	%%xmm0, %%ymm0\n\t"
+					"1:\n\t"
+					"vmovdqa		%%ymm0, (%[d])\n\t"
+					"vmovdqa		%%ymm0, 32(%[d])\n\t"
+					"add			$64, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [n] "+r" (n)
+					: [c] "r" (color)
+					: "xmm0", "memory", "cc");
+		}
+
+		count %= 16;
+	}
+
+	while (count--) {
+		*dst++ = color;
+	}
+}
+
+static void __attribute__((target("avx2"))) span_copy_avx2(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags)
+{
+	uint32_t n;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		*dst++ = *src++;
+		count--;
+	}
+
+	if ((n = count / 16) > 0) {
+		if (flags & NXGI_SPAN_NT) {
+			asm volatile(
+					"1:\n\t"
+					"vmovdqu		(%[s]), %%ymm0\n\t"
+					"vmovdqu		32(%[s]), %%ymm1\n\t"
+					"vmovntdq		%%ymm0, (%[d])\n\t"
+					"vmovntdq		%%ymm1, 32(%[d])\n\t"
+					"add			$64, %[s]\n\t"
+					"add			$64, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"sfence\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n)
+					:
+					: "xmm0", "xmm1", "memory", "cc");
+		} else {
+			asm volatile(
+					"1:\n\t"
+					"vmovdqu		(%[s]), %%ymm0\n\t"
+					"vmovdqu		32(%[s]), %%ymm1\n\t"
+					"vmovdqa		%%ymm0, (%[d])\n\t"
+					"vmovdqa		%%ymm1, 32(%[d])\n\t"
+					"add			$64, %[s]\n\t"
+					"add			$64, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n)
+					:
+					: "xmm0", "xmm1", "memory", "cc");
+		}
+
+		count %= 16;
+	}
+
+	while (count--) {
+		*dst++ = *src++;
+	}
+}
+
+static void __attribute__((target("avx2"))) span_blend_avx2(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count)
+{
+	uint32_t n, inv = 256 - alpha;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		*dst = span_blend_pixel(*dst, color, alpha);
+		dst++;
+		count--;
+	}
+
+	if ((n = count / 8) > 0) {
+		asm volatile(
+				"vpxor			%%ymm7, %%ymm7, %%ymm7\n\t"
+				"vmovd			%[a], %%xmm6\n\t"
+				"vpbroadcastw	%%xmm6, %%ymm6\n\t"
+				"vmovd			%[ia], %%xmm5\n\t"
+				"vpbroadcastw	%%xmm5, %%ymm5\n\t"
+				"vmovd			%[c], %%xmm4\n\t"
+				"vpbroadcastd	%%xmm4, %%ymm4\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm4, %%ymm4\n\t"
+				"vpmullw		%%ymm6, %%ymm4, %%ymm4\n\t"
+				"1:\n\t"
+				"vmovdqa		(%[d]), %%ymm0\n\t"
+				"vpunpckhbw		%%ymm7, %%ymm0, %%ymm1\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm0, %%ymm0\n\t"
+				"vpmullw		%%ymm5, %%ymm0, %%ymm0\n\t"
+				"vpmullw		%%ymm5, %%ymm1, %%ymm1\n\t"
+				"vpaddw			%%ymm4, %%ymm0, %%ymm0\n\t"
+				"vpaddw			%%ymm4, %%ymm1, %%ymm1\n\t"
+				"vpsrlw			$8, %%ymm0, %%ymm0\n\t"
+				"vpsrlw			$8, %%ymm1, %%ymm1\n\t"
+				"vpackuswb		%%ymm1, %%ymm0, %%ymm0\n\t"
+				"vmovdqa		%%ymm0, (%[d])\n\t"
+				"add			$32, %[d]\n\t"
+				"dec			%[n]\n\t"
+				"jnz			1b\n\t"
+				"vzeroupper"
+				: [d] "+r" (dst), [n] "+r" (n)
+				: [c] "r" (color), [a] "r" (alpha), [ia] "r" (inv)
+				: "xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 8;
+	}
+
+	while (count--) {
+		*dst = span_blend_pixel(*dst, color, alpha);
+		dst++;
+	}
+}
+
+static void __attribute__((target("avx2"))) span_lerp_avx2(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count)
+{
+	uint32_t n, inv = 256 - w;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		*dst++ = span_blend_pixel(*a++, *b++, w);
+		count--;
+	}
+
+	if ((n = count / 8) > 0) {
+		asm volatile(
+				"vpxor			%%ymm7, %%ymm7, %%ymm7\n\t"
+				"vmovd			%[w], %%xmm6\n\t"
+				"vpbroadcastw	%%xmm6, %%ymm6\n\t"
+				"vmovd			%[iw], %%xmm5\n\t"
+				"vpbroadcastw	%%xmm5, %%ymm5\n\t"
+				"1:\n\t"
+				"vmovdqu		(%[a]), %%ymm0\n\t"
+				"vpunpckhbw		%%ymm7, %%ymm0, %%ymm1\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm0, %%ymm0\n\t"
+				"vmovdqu		(%[b]), %%ymm2\n\t"
+				"vpunpckhbw		%%ymm7, %%ymm2, %%ymm3\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm2, %%ymm2\n\t"
+				"vpmullw		%%ymm5, %%ymm0, %%ymm0\n\t"
+				"vpmullw		%%ymm5, %%ymm1, %%ymm1\n\t"
+				"vpmullw		%%ymm6, %%ymm2, %%ymm2\n\t"
+				"vpmullw		%%ymm6, %%ymm3, %%ymm3\n\t"
+				"vpaddw			%%ymm2, %%ymm0, %%ymm0\n\t"
+				"vpaddw			%%ymm3, %%ymm1, %%ymm1\n\t"
+				"vpsrlw			$8, %%ymm0, %%ymm0\n\t"
+				"vpsrlw			$8, %%ymm1, %%ymm1\n\t"
+				"vpackuswb		%%ymm1, %%ymm0, %%ymm0\n\t"
+				"vmovdqa		%%ymm0, (%[d])\n\t"
+				"add			$32, %[a]\n\t"
+				"add			$32, %[b]\n\t"
+				"add			$32, %[d]\n\t"
+				"dec			%[n]\n\t"
+				"jnz			1b\n\t"
+				"vzeroupper"
+				: [d] "+r" (dst), [a] "+r" (a), [b] "+r" (b), [n] "+r" (n)
+				: [w] "m" (w), [iw] "m" (inv)
+				: "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 8;
+	}
+
+	while (count--) {
+		*dst++ = span_blend_pixel(*a++, *b++, w);
+	}
+}
+
+/*
+ * AVX2 version of SPAN_OVER_SSE2, 8 pixels: source lanes in ymm0 (pixels
+ * 0-1 and 4-5) and ymm1 (2-3 and 6-7).
+ */
+#define SPAN_OVER_AVX2 \
+		"vpshuflw		$0xFF, %%ymm0, %%ymm2\n\t" \
+		"vpshufhw		$0xFF, %%ymm2, %%ymm2\n\t" \
+		"vpshuflw		$0xFF, %%ymm1, %%ymm3\n\t" \
+		"vpshufhw		$0xFF, %%ymm3, %%ymm3\n\t" \
+		"vpxor			%[inv], %%ymm2, %%ymm2\n\t" \
+		"vpxor			%[inv], %%ymm3, %%ymm3\n\t" \
+		"vmovdqa		(%[d]), %%ymm5\n\t" \
+		"vpunpckhbw		%%ymm7, %%ymm5, %%ymm6\n\t" \
+		"vpunpcklbw		%%ymm7, %%ymm5, %%ymm5\n\t" \
+		"vpmullw		%%ymm2, %%ymm5, %%ymm5\n\t" \
+		"vpmullw		%%ymm3, %%ymm6, %%ymm6\n\t" \
+		"vpaddw			%[round], %%ymm5, %%ymm5\n\t" \
+		"vpaddw			%[round], %%ymm6, %%ymm6\n\t" \
+		"vpmulhuw		%[mul], %%ymm5, %%ymm5\n\t" \
+		"vpmulhuw		%[mul], %%ymm6, %%ymm6\n\t" \
+		"vpaddw			%%ymm5, %%ymm0, %%ymm0\n\t" \
+		"vpaddw			%%ymm6, %%ymm1, %%ymm1\n\t" \
+		"vpackuswb		%%ymm1, %%ymm0, %%ymm0\n\t" \
+		"vmovdqa		%%ymm0, (%[d])\n\t"
+
+#define SPAN_DIV255_AVX2(x) \
+		"vpaddw			%[round], " x ", " x "\n\t" \
+		"vpmulhuw		%[mul], " x ", " x "\n\t"
+
+static void __attribute__((target("avx2"))) span_over_avx2(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count)
+{
+	uint32_t n, t;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		span_over_c(dst++, src++, alpha, 1);
+		count--;
+	}
+
+	if ((n = count / 8) > 0) {
+		if (alpha == 255) {
+			asm volatile(
+					"vpxor			%%ymm7, %%ymm7, %%ymm7\n\t"
+					"1:\n\t"
+					"vmovdqu		(%[s]), %%ymm0\n\t"
+					"vpcmpeqb		%%ymm7, %%ymm0, %%ymm1\n\t"
+					"vpmovmskb		%%ymm1, %[t]\n\t"
+					"and			$0x88888888, %[t]\n\t"
+					"cmp			$0x88888888, %[t]\n\t"
+					"je				3f\n\t"
+					"vpcmpeqb		%[ones], %%ymm0, %%ymm1\n\t"
+					"vpmovmskb		%%ymm1, %[t]\n\t"
+					"and			$0x88888888, %[t]\n\t"
+					"cmp			$0x88888888, %[t]\n\t"
+					"jne			2f\n\t"
+					"vmovdqa		%%ymm0, (%[d])\n\t"
+					"jmp			3f\n\t"
+					"2:\n\t"
+					"vpunpckhbw		%%ymm7, %%ymm0, %%ymm1\n\t"
+					"vpunpcklbw		%%ymm7, %%ymm0, %%ymm0\n\t"
+					SPAN_OVER_AVX2
+					"3:\n\t"
+					"add			$32, %[s]\n\t"
+					"add			$32, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n), [t] "=&r" (t)
+					: [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv), [ones] "m" (span_k.ones)
+					: "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory", "cc");
+		} else {
+			asm volatile(
+					"vpxor			%%ymm7, %%ymm7, %%ymm7\n\t"
+					"vmovd			%[a], %%xmm4\n\t"
+					"vpbroadcastw	%%xmm4, %%ymm4\n\t"
+					"1:\n\t"
+					"vmovdqu		(%[s]), %%ymm0\n\t"
+					"vpcmpeqb		%%ymm7, %%ymm0, %%ymm1\n\t"
+					"vpmovmskb		%%ymm1, %[t]\n\t"
+					"and			$0x88888888, %[t]\n\t"
+					"cmp			$0x88888888, %[t]\n\t"
+					"je				3f\n\t"
+					"vpunpckhbw		%%ymm7, %%ymm0, %%ymm1\n\t"
+					"vpunpcklbw		%%ymm7, %%ymm0, %%ymm0\n\t"
+					"vpmullw		%%ymm4, %%ymm0, %%ymm0\n\t"
+					"vpmullw		%%ymm4, %%ymm1, %%ymm1\n\t"
+					SPAN_DIV255_AVX2("%%ymm0")
+					SPAN_DIV255_AVX2("%%ymm1")
+					SPAN_OVER_AVX2
+					"3:\n\t"
+					"add			$32, %[s]\n\t"
+					"add			$32, %[d]\n\t"
+					"dec			%[n]\n\t"
+					"jnz			1b\n\t"
+					"vzeroupper"
+					: [d] "+r" (dst), [s] "+r" (src), [n] "+r" (n), [t] "=&r" (t)
+					: [a] "m" (alpha), [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv)
+					: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+		}
+
+		count %= 8;
+	}
+
+	span_over_c(dst, src, alpha, count);
+}
+
+static void __attribute__((target("avx2"))) span_mask_avx2(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count)
+{
+	uint32_t n, t, opaque = (color >> 24) == 255;
+
+	while (count > 0 && ((uintptr_t)dst & 31) != 0) {
+		span_mask_c(dst++, color, mask++, 1);
+		count--;
+	}
+
+	/* Coverage bytes of 8 pixels are widened to 32 bytes in two halves */
+	if ((n = count / 8) > 0) {
+		asm volatile(
+				"vpxor			%%ymm7, %%ymm7, %%ymm7\n\t"
+				"vmovd			%[c], %%xmm4\n\t"
+				"vpbroadcastd	%%xmm4, %%ymm4\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm4, %%ymm4\n\t"
+				"1:\n\t"
+				"mov			(%[m]), %[t]\n\t"
+				"or				4(%[m]), %[t]\n\t"
+				"jz				3f\n\t"
+				"mov			(%[m]), %[t]\n\t"
+				"and			4(%[m]), %[t]\n\t"
+				"cmp			$0xFFFFFFFF, %[t]\n\t"
+				"jne			2f\n\t"
+				"cmpl			$0, %[opq]\n\t"
+				"je				2f\n\t"
+				"vpackuswb		%%ymm4, %%ymm4, %%ymm0\n\t"
+				"vmovdqa		%%ymm0, (%[d])\n\t"
+				"jmp			3f\n\t"
+				"2:\n\t"
+				"vmovq			(%[m]), %%xmm0\n\t"
+				"vpunpcklbw		%%xmm0, %%xmm0, %%xmm0\n\t"
+				"vpunpckhwd		%%xmm0, %%xmm0, %%xmm1\n\t"
+				"vpunpcklwd		%%xmm0, %%xmm0, %%xmm0\n\t"
+				"vinserti128	$1, %%xmm1, %%ymm0, %%ymm0\n\t"
+				"vpunpckhbw		%%ymm7, %%ymm0, %%ymm1\n\t"
+				"vpunpcklbw		%%ymm7, %%ymm0, %%ymm0\n\t"
+				"vpmullw		%%ymm4, %%ymm0, %%ymm0\n\t"
+				"vpmullw		%%ymm4, %%ymm1, %%ymm1\n\t"
+				SPAN_DIV255_AVX2("%%ymm0")
+				SPAN_DIV255_AVX2("%%ymm1")
+				SPAN_OVER_AVX2
+				"3:\n\t"
+				"add			$8, %[m]\n\t"
+				"add			$32, %[d]\n\t"
+				"dec			%[n]\n\t"
+				"jnz			1b\n\t"
+				"vzeroupper"
+				: [d] "+r" (dst), [m] "+r" (mask), [n] "+r" (n), [t] "=&r" (t)
+				: [c] "m" (color), [opq] "m" (opaque), [round] "m" (span_k.round), [mul] "m" (span_k.mul), [inv] "m" (span_k.inv)
+				: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+
+		count %= 8;
+	}
+
+	span_mask_c(dst, color, mask, count);
+}
+
+/*
+ * Public interface
+ */
+HRESULT __nxapi nxgi_span_initialize()
+{
+	uint32_t eax, ebx, ecx, edx, max;
+
+	if (span_initialized) {
+		return S_FALSE;
+	}
+
+	span_initialized = TRUE;
+
+	__cpuid(0, max, ebx, ecx, edx);
+	if (max < 1) {
+		return S_OK;
+	}
+
+	__cpuid(1, eax, ebx, ecx, edx);
+	if (!(edx & CPUID_1_EDX_SSE2)) {
+		return S_OK;
+	}
+
+	hal_enable_sse();
+	span_supported[NXGI_SPAN_ISA_SSE2] = TRUE;
+
+	if (max >= 7 && (ecx & CPUID_1_ECX_XSAVE) && (ecx & CPUID_1_ECX_AVX)) {
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+
+		if (ebx & CPUID_7_EBX_AVX2) {
+			hal_enable_avx();
+			span_supported[NXGI_SPAN_ISA_AVX2] = TRUE;
+		}
+	}
+
+	/* Pick the best one */
+	span_isa = span_supported[NXGI_SPAN_ISA_AVX2] ? NXGI_SPAN_ISA_AVX2 : NXGI_SPAN_ISA_SSE2;
+	span_cur = &span_ops[span_isa];
+
+	return S_OK;
+}
+
+HRESULT __nxapi nxgi_span_set_isa(NXGI_SPAN_ISA isa)
+{
+	if (isa >= NXGI_SPAN_ISA_COUNT) {
+		return E_INVALIDARG;
+	}
+
+	if (!span_supported[isa]) {
+		return E_NOTSUPPORTED;
+	}
+
+	span_isa = isa;
+	span_cur = &span_ops[isa];
+
+	return S_OK;
+}
+
+NXGI_SPAN_ISA __nxapi nxgi_span_get_isa()
+{
+	return span_isa;
+}
+
+VOID __nxapi nxgi_span_fill(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	intf = span_begin(ops);
+	ops->fill(dst, color, count, flags);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_copy(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	intf = span_begin(ops);
+	ops->copy(dst, src, count, flags);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_blend(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	intf = span_begin(ops);
+	ops->blend(dst, color, alpha, count);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_lerp(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	intf = span_begin(ops);
+	ops->lerp(dst, a, b, w, count);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_over(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	if (alpha == 0) {
+		return;
+	}
+
+	intf = span_begin(ops);
+	ops->over(dst, src, alpha, count);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_mask(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count)
+{
+	const NXGI_SPAN_OPS *ops = count < NXGI_SPAN_MIN_VECTOR ? &span_ops[NXGI_SPAN_ISA_C] : span_cur;
+	uint32_t intf;
+
+	if ((color >> 24) == 0) {
+		return;
+	}
+
+	intf = span_begin(ops);
+	ops->mask(dst, color, mask, count);
+	span_end(intf);
+}
+
+VOID __nxapi nxgi_span_fill_rect(void *dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color, uint32_t flags)
+{
+	uint8_t *row = dst;
+
+	while (height--) {
+		nxgi_span_fill((uint32_t*)row, color, width, flags);
+		row += stride;
+	}
+}
+
+VOID __nxapi nxgi_span_copy_rect(void *dst, uint32_t dst_stride, const void *src, uint32_t src_stride, uint32_t width, uint32_t height, uint32_t flags)
+{
+	uint8_t 		*d = dst;
+	const uint8_t 	*s = src;
+	int32_t			dir = 1;
+	uint32_t		size = width * 4;
+
+	if (height == 0 || width == 0) {
+		return;
+	}
+
+	/* Scrolling down within a bitmap, go bottom-up */
+	if (d > s && d < s + height * src_stride) {
+		d += (height - 1) * dst_stride;
+		s += (height - 1) * src_stride;
+		dir = -1;
+	}
+
+	while (height--) {
+		if ((d > s && d < s + size) || (s > d && s < d + size)) {
+			/* Overlapping spans on the same scanline */
+			memmove(d, s, size);
+		} else {
+			nxgi_span_copy((uint32_t*)d, (const uint32_t*)s, width, flags);
+		}
+
+		d += dir * (int32_t)dst_stride;
+		s += dir * (int32_t)src_stride;
+	}
+}
+
+/*
+ * Benchmark. Kernels are checked against the C kernels for every offset
+ * within a 64 byte line and a range of span lengths, including guard pixels
+ * on both sides, then timed on a 1024x256 bitmap.
+ */
+#define SPAN_BENCH_WIDTH		1024
+#define SPAN_BENCH_HEIGHT		256
+#define SPAN_BENCH_GUARD		32
+#define SPAN_BENCH_TIME			1000
+
+static const uint32_t span_bench_lengths[] = {
+		0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 24, 31, 32, 33, 47, 63, 64, 65, 100, 257, 1000
+};
+
+static const uint32_t span_bench_alphas[] = { 0, 1, 127, 128, 255, 256 };
+
+typedef enum {
+	SPAN_BENCH_FILL,
+	SPAN_BENCH_FILL_NT,
+	SPAN_BENCH_COPY,
+	SPAN_BENCH_COPY_NT,
+	SPAN_BENCH_BLEND,
+	SPAN_BENCH_LERP,
+	SPAN_BENCH_OVER,
+	SPAN_BENCH_MASK
+} SPAN_BENCH_OP;
+
+static void span_bench_pattern(uint32_t *p, uint32_t count, uint32_t seed)
+{
+	while (count--) {
+		seed = seed * 1103515245 + 12345;
+		*p++ = seed ^ (seed >> 16);
+	}
+}
+
+/*
+ * Compositing sources have to be premultiplied, with runs of transparent and
+ * opaque pixels (or of no and full coverage) to hit the early-outs.
+ */
+static void span_bench_alpha(uint32_t *p, uint32_t count, BOOL mask)
+{
+	uint32_t i;
+
+	for (i=0; i<count; i++) {
+		switch ((i / 8) % 4) {
+			case 0: p[i] = 0; break;
+			case 1: p[i] = mask ? 0xFFFFFFFF : p[i] | 0xFF000000; break;
+		}
+
+		if (!mask) p[i] = nxgi_span_premultiply(p[i]);
+	}
+}
+
+static void span_bench_run(const NXGI_SPAN_OPS *ops, SPAN_BENCH_OP op, uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t arg)
+{
+	uint32_t intf = span_begin(ops);
+
+	switch (op) {
+		case SPAN_BENCH_FILL: ops->fill(dst, arg, count, 0); break;
+		case SPAN_BENCH_FILL_NT: ops->fill(dst, arg, count, NXGI_SPAN_NT); break;
+		case SPAN_BENCH_COPY: ops->copy(dst, src, count, 0); break;
+		case SPAN_BENCH_COPY_NT: ops->copy(dst, src, count, NXGI_SPAN_NT); break;
+		case SPAN_BENCH_BLEND: ops->blend(dst, 0x80FF4020, arg, count); break;
+		case SPAN_BENCH_LERP: ops->lerp(dst, dst, src, arg, count); break;
+		case SPAN_BENCH_OVER: ops->over(dst, src, arg > 255 ? 255 : arg, count); break;
+		case SPAN_BENCH_MASK: ops->mask(dst, nxgi_span_premultiply(0x00FF4020 | ((arg > 255 ? 255 : arg) << 24)), (const uint8_t*)src, count); break;
+	}
+
+	span_end(intf);
+}
+
+static HRESULT span_bench_verify(const NXGI_SPAN_OPS *ops, uint32_t *ref, uint32_t *out, uint32_t *src)
+{
+	uint32_t total = SPAN_BENCH_WIDTH + 2 * SPAN_BENCH_GUARD;
+	uint32_t op, offs, l, a, i, len, arg, seed = 1;
+
+	for (op=SPAN_BENCH_FILL; op<=SPAN_BENCH_MASK; op++) {
+		for (offs=0; offs<16; offs++) {
+			for (l=0; l<sizeof(span_bench_lengths) / sizeof(uint32_t); l++) {
+				for (a=0; a<sizeof(span_bench_alphas) / sizeof(uint32_t); a++) {
+					len = span_bench_lengths[l];
+					arg = op >= SPAN_BENCH_BLEND ? span_bench_alphas[a] : 0xFF000000 | seed;
+
+					span_bench_pattern(ref, total, seed);
+					span_bench_pattern(out, total, seed);
+					span_bench_pattern(src, total, ~seed);
+					seed++;
+
+					if (op >= SPAN_BENCH_OVER) {
+						span_bench_alpha(src, total, op == SPAN_BENCH_MASK);
+					}
+
+					span_bench_run(&span_ops[NXGI_SPAN_ISA_C], op, ref + SPAN_BENCH_GUARD + offs, src + offs + 3, len, arg);
+					span_bench_run(ops, op, out + SPAN_BENCH_GUARD + offs, src + offs + 3, len, arg);
+
+					for (i=0; i<total; i++) {
+						if (ref[i] != out[i]) {
+							k_printf("%s: pixel %d is 0x%X instead of 0x%X (op %d, offset %d, length %d, arg 0x%X).\n",
+									ops->name, i, out[i], ref[i], op, offs, len, arg);
+							return E_FAIL;
+						}
+					}
+
+					/* Only blending, interpolation and compositing take a weight */
+					if (op < SPAN_BENCH_BLEND) break;
+				}
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+/*
+ * Runs `op` over a whole bitmap until SPAN_BENCH_TIME elapses and returns
+ * the throughput in Mpixels/s.
+ */
+static uint32_t span_bench_rate(const NXGI_SPAN_OPS *ops, SPAN_BENCH_OP op, uint32_t *dst, uint32_t *src, uint32_t width, uint32_t height, uint32_t stride)
+{
+	uint32_t start, elapsed, y;
+	uint64_t pixels = 0;
+
+	start = timer_gettickcount();
+
+	do {
+		for (y=0; y<height; y++) {
+			span_bench_run(ops, op, (uint32_t*)((uint8_t*)dst + y * stride), src ? src + y * width : NULL, width, 128);
+		}
+
+		pixels += width * height;
+		elapsed = timer_gettickcount() - start;
+	} while (elapsed < SPAN_BENCH_TIME);
+
+	return (uint32_t)udiv64(pixels, elapsed * 1000, NULL);
+}
+
+HRESULT __nxapi nxgi_span_benchmark()
+{
+	static const char *op_names[] = { "fill", "fill/nt", "copy", "copy/nt", "blend", "lerp" };
+	uint32_t	*ref = NULL, *out = NULL, *src = NULL, *bmp = NULL;
+	uint32_t	isa, op, total = SPAN_BENCH_WIDTH + 2 * SPAN_BENCH_GUARD;
+	NXGI_BITMAP	*screen = NULL;
+	HRESULT		hr = S_OK;
+
+	nxgi_span_initialize();
+
+	k_printf("Span kernels: C%s%s, using %s.\n",
+			span_supported[NXGI_SPAN_ISA_SSE2] ? ", SSE2" : "",
+			span_supported[NXGI_SPAN_ISA_AVX2] ? ", AVX2" : "",
+			span_cur->name);
+
+	ref = kmalloc(total * 4);
+	out = kmalloc(total * 4);
+	src = kmalloc(SPAN_BENCH_WIDTH * SPAN_BENCH_HEIGHT * 4);
+	bmp = kmalloc(SPAN_BENCH_WIDTH * SPAN_BENCH_HEIGHT * 4);
+
+	if (!ref || !out || !src || !bmp) {
+		hr = E_OUTOFMEM;
+		goto finally;
+	}
+
+	/* Correctness */
+	for (isa=NXGI_SPAN_ISA_SSE2; isa<NXGI_SPAN_ISA_COUNT; isa++) {
+		if (!span_supported[isa]) continue;
+
+		hr = span_bench_verify(&span_ops[isa], ref, out, src);
+		if (FAILED(hr)) goto finally;
+
+		k_printf("%s: output matches C kernels.\n", span_ops[isa].name);
+	}
+
+	/* Throughput, in system memory */
+	span_bench_pattern(src, SPAN_BENCH_WIDTH * SPAN_BENCH_HEIGHT, 7);
+
+	for (isa=NXGI_SPAN_ISA_C; isa<NXGI_SPAN_ISA_COUNT; isa++) {
+		if (!span_supported[isa]) continue;
+
+		k_printf("%s:", span_ops[isa].name);
+
+		for (op=SPAN_BENCH_FILL; op<=SPAN_BENCH_LERP; op++) {
+			k_printf(" %s %d", op_names[op], span_bench_rate(&span_ops[isa], op, bmp, src, SPAN_BENCH_WIDTH, SPAN_BENCH_HEIGHT, SPAN_BENCH_WIDTH * 4));
+		}
+
+		k_printf(" Mpixels/s\n");
+	}
+
+	/* Fills of the screen's back buffer, if the screen is up */
+	nxgi_get_screen(&screen);
+	if (screen != NULL && screen->format == NXGI_FORMAT_BGRA32) {
+		for (isa=NXGI_SPAN_ISA_C; isa<NXGI_SPAN_ISA_COUNT; isa++) {
+			if (!span_supported[isa]) continue;
+
+			k_printf("%s, %dx%d back buffer: fill %d, fill/nt %d Mpixels/s\n", span_ops[isa].name, screen->width, screen->height,
+					span_bench_rate(&span_ops[isa], SPAN_BENCH_FILL, screen->pBits, NULL, screen->width, screen->height, screen->stride),
+					span_bench_rate(&span_ops[isa], SPAN_BENCH_FILL_NT, screen->pBits, NULL, screen->width, screen->height, screen->stride));
+		}
+	}
+
+finally:
+	if (ref) kfree(ref);
+	if (out) kfree(out);
+	if (src) kfree(src);
+	if (bmp) kfree(bmp);
+
+	return hr;
+}
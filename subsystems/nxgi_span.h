@@ -0,0 +1,163 @@
+/*
+ * nxgi_span.h
+ *
+ *	Span kernels of the BGRA32 rasterizer.
+ *
+ *	A span is a run of 32-bit pixels on a single scanline. Filling, copying,
+ *	blending and compositing of spans is done by a set of kernels: plain C,
+ *	SSE2 (4 pixels per register, 8 per iteration) and AVX2 (8 pixels per
+ *	register, 16 per iteration). The best set supported by the CPU is chosen by
+ *	nxgi_span_initialize(), using CPUID.
+ *
+ *	Vector kernels write aligned: a scalar head brings the destination to the
+ *	register size, a scalar tail finishes the span. With NXGI_SPAN_NT, which is
+ *	used for the linear frame buffer, stores are non-temporal, since the frame
+ *	buffer is write-combined and never read back.
+ *
+ *	The scheduler doesn't save SSE/AVX registers, so vector kernels run with
+ *	interrupts disabled, one span at a time. Spans shorter than
+ *	NXGI_SPAN_MIN_VECTOR pixels are always done by the C kernels.
+ *
+ *  Created on: 18.10.2026
+ *      Author: Anton Angelov
+ */
+
+#ifndef SUBSYSTEMS_NXGI_SPAN_H_
+#define SUBSYSTEMS_NXGI_SPAN_H_
+
+#include <types.h>
+#include "nxgi.h"
+
+/** Use non-temporal stores */
+#define NXGI_SPAN_NT			0x01
+
+/** Shorter spans aren't worth saving the interrupt flag for */
+#define NXGI_SPAN_MIN_VECTOR	16
+
+typedef enum {
+	NXGI_SPAN_ISA_C = 0,
+	NXGI_SPAN_ISA_SSE2,
+	NXGI_SPAN_ISA_AVX2,
+	NXGI_SPAN_ISA_COUNT
+} NXGI_SPAN_ISA;
+
+/**
+ * Kernel set.
+ */
+typedef struct NXGI_SPAN_OPS NXGI_SPAN_OPS;
+struct NXGI_SPAN_OPS {
+	const char	*name;
+
+	/** Uses SSE/AVX registers, so has to run with interrupts disabled */
+	BOOL		vector;
+
+	/** Sets `count` pixels to `color` */
+	void (*fill)(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags);
+
+	/** Copies `count` pixels. The spans must not overlap. */
+	void (*copy)(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags);
+
+	/**
+	 * Blends `color` over `count` pixels, per channel:
+	 * dst = (color * alpha + dst * (256 - alpha)) >> 8, alpha in [0..256].
+	 */
+	void (*blend)(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count);
+
+	/**
+	 * Interpolates between two spans, per channel:
+	 * dst = (a * (256 - w) + b * w) >> 8, w in [0..256]. `dst` may be `a`.
+	 */
+	void (*lerp)(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count);
+
+	/**
+	 * Composites premultiplied `src` over `dst` (SRC_OVER), with the source
+	 * scaled by `alpha` in [0..255]:
+	 * dst = src * alpha / 255 + dst * (255 - src.a * alpha / 255) / 255.
+	 */
+	void (*over)(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count);
+
+	/**
+	 * Composites premultiplied `color` over `count` pixels, scaled by one
+	 * coverage byte per pixel. Used for glyphs.
+	 */
+	void (*mask)(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count);
+};
+
+/**
+ * Detects SSE2/AVX2, enables them and picks the fastest kernel set.
+ */
+HRESULT		__nxapi nxgi_span_initialize();
+
+/**
+ * Forces a kernel set. Returns E_NOTSUPPORTED if the CPU lacks it.
+ */
+HRESULT		__nxapi nxgi_span_set_isa(NXGI_SPAN_ISA isa);
+NXGI_SPAN_ISA __nxapi nxgi_span_get_isa();
+
+VOID		__nxapi nxgi_span_fill(uint32_t *dst, uint32_t color, uint32_t count, uint32_t flags);
+VOID		__nxapi nxgi_span_copy(uint32_t *dst, const uint32_t *src, uint32_t count, uint32_t flags);
+VOID		__nxapi nxgi_span_blend(uint32_t *dst, uint32_t color, uint32_t alpha, uint32_t count);
+VOID		__nxapi nxgi_span_lerp(uint32_t *dst, const uint32_t *a, const uint32_t *b, uint32_t w, uint32_t count);
+VOID		__nxapi nxgi_span_over(uint32_t *dst, const uint32_t *src, uint32_t alpha, uint32_t count);
+VOID		__nxapi nxgi_span_mask(uint32_t *dst, uint32_t color, const uint8_t *mask, uint32_t count);
+
+/**
+ * Fills `height` spans of `width` pixels, `stride` bytes apart.
+ */
+VOID		__nxapi nxgi_span_fill_rect(void *dst, uint32_t stride, uint32_t width, uint32_t height, uint32_t color, uint32_t flags);
+
+/**
+ * Copies `height` spans of `width` pixels. Rows are copied bottom-up when
+ * the destination is below the source within the same bitmap.
+ */
+VOID		__nxapi nxgi_span_copy_rect(void *dst, uint32_t dst_stride, const void *src, uint32_t src_stride, uint32_t width, uint32_t height, uint32_t flags);
+
+/**
+ * Span flags for drawing onto `bmp`.
+ */
+static inline uint32_t nxgi_span_flags(NXGI_BITMAP *bmp)
+{
+	return bmp->tag == NXGI_BITMAP_TAG_FRAME_BUFFER ? NXGI_SPAN_NT : 0;
+}
+
+/**
+ * Packs a color into a BGRA32 pixel.
+ */
+static inline uint32_t nxgi_span_color(NXGI_COLOR c)
+{
+	return (uint32_t)c.b | ((uint32_t)c.g << 8) | ((uint32_t)c.r << 16) | ((uint32_t)c.a << 24);
+}
+
+/**
+ * x * a / 255, rounded to nearest. Exact for x, a in [0..255], the vector
+ * kernels compute the same with pmulhuw.
+ */
+static inline uint32_t nxgi_span_mul255(uint32_t x, uint32_t a)
+{
+	return ((x * a + 128) * 257) >> 16;
+}
+
+/**
+ * Scales all four channels of a pixel by `a` in [0..255].
+ */
+static inline uint32_t nxgi_span_scale(uint32_t p, uint32_t a)
+{
+	return nxgi_span_mul255(p & 0xFF, a) | (nxgi_span_mul255((p >> 8) & 0xFF, a) << 8) |
+			(nxgi_span_mul255((p >> 16) & 0xFF, a) << 16) | (nxgi_span_mul255(p >> 24, a) << 24);
+}
+
+/**
+ * Premultiplies the color channels of a pixel by it's alpha.
+ */
+static inline uint32_t nxgi_span_premultiply(uint32_t p)
+{
+	return (nxgi_span_scale(p, p >> 24) & 0x00FFFFFF) | (p & 0xFF000000);
+}
+
+/**
+ * Checks every kernel set against the C kernels, pixel by pixel, and
+ * measures their throughput.
+ */
+HRESULT		__nxapi nxgi_span_benchmark();
+
+#endif /* SUBSYSTEMS_NXGI_SPAN_H_ */
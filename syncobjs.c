@@ -123,7 +123,6 @@ retry:
 	if (m->lock_count > 0) {
 		if (m->pid != curr_pid || m->tid != curr_tid) {
 			pass = FALSE;
-			HalKernelPanic("...");
 		}
 	}
 
@@ -141,7 +140,8 @@ retry:
 	spinlock_release(&m->inner_lock, intr_status);
 
 	if (!pass) {
-		//sched_yield();
+		/* Owned by another thread, let it run until it releases the mutex */
+		sched_yield();
 		goto retry;
 	}
 }
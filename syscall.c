@@ -9,7 +9,10 @@
 #include "vga.h"
 #include <stddef.h>
 #include "syncobjs.h"
+#include "scheduler.h"
 #include "kstdio.h"
+#include "shm.h"
+#include "msgport.h"
 
 
 typedef void __nxapi (*syscall_handler_t)(K_REGISTERS *r);
@@ -25,6 +28,8 @@ static syscall_handler_t syscalls[] =
 	sys_fwrite,
 	//todo: fread
 	sys_mutex,
+	sys_shm,
+	sys_port,
 	NULL
 };
 
@@ -61,6 +66,87 @@ void __nxapi sys_mutex(K_REGISTERS *regs)
 	regs->eax = S_OK;
 }
 
+void __nxapi sys_shm(K_REGISTERS *regs)
+{
+	SHM_SYSCALL_ARGS	*args = (SHM_SYSCALL_ARGS*)regs->edx;
+	K_PROCESS			*proc;
+	HRESULT				hr;
+
+	if (args == NULL) {
+		regs->eax = E_POINTER;
+		return;
+	}
+
+	hr = sched_get_current_proc(&proc);
+	if (FAILED(hr)) {
+		regs->eax = hr;
+		return;
+	}
+
+	switch (regs->ebx) {
+	case SHM_SYSCALL_CREATE:
+		hr = shm_create(args->name, args->size, SHM_FLAG_NONE, &args->handle);
+		break;
+	case SHM_SYSCALL_OPEN:
+		hr = shm_open(args->name, &args->handle);
+		break;
+	case SHM_SYSCALL_CLOSE:
+		hr = shm_close(&args->handle);
+		break;
+	case SHM_SYSCALL_MAP:
+		hr = shm_map(args->handle, proc, args->access, &args->address);
+		break;
+	case SHM_SYSCALL_UNMAP:
+		hr = shm_unmap(proc, args->address);
+		break;
+	default:
+		hr = E_INVALIDARG;
+		break;
+	}
+
+	regs->eax = hr;
+}
+
+void __nxapi sys_port(K_REGISTERS *regs)
+{
+	PORT_SYSCALL_ARGS	*args = (PORT_SYSCALL_ARGS*)regs->edx;
+	HRESULT				hr;
+
+	if (args == NULL) {
+		regs->eax = E_POINTER;
+		return;
+	}
+
+	switch (regs->ebx) {
+	case PORT_SYSCALL_CREATE:
+		hr = port_create(args->name, &args->handle);
+		break;
+	case PORT_SYSCALL_OPEN:
+		hr = port_open(args->name, &args->handle);
+		break;
+	case PORT_SYSCALL_CLOSE:
+		hr = port_close(&args->handle);
+		break;
+	case PORT_SYSCALL_SEND:
+		hr = port_send(args->handle, args->buffer, args->size, args->timeout);
+		break;
+	case PORT_SYSCALL_RECEIVE:
+		hr = port_receive(args->handle, &args->recv, args->timeout);
+		break;
+	case PORT_SYSCALL_ALLOC:
+		hr = port_alloc_buffer(args->size, &args->buffer);
+		break;
+	case PORT_SYSCALL_FREE:
+		hr = port_free_buffer(args->buffer);
+		break;
+	default:
+		hr = E_INVALIDARG;
+		break;
+	}
+
+	regs->eax = hr;
+}
+
 void __nxapi sys_fopen(K_REGISTERS *regs)
 {
 	K_STREAM *s;
@@ -12,6 +12,11 @@
 #include "url_utils.h"
 #include "vga.h"
 #include <kstdio.h>
+#include "dcache.h"
+#include "bcache.h"
+
+/* Initial number of buckets of a node's child hash table */
+#define VFS_CHILD_HASH_MIN	8
 
 /* Root node of the vfs */
 K_VFS_NODE *vfs_root;
@@ -24,6 +29,9 @@ K_FS_DRIVER vfs_fs_driver = {
 		.open = vfs_open,
 		.opendir = vfs_opendir,
 		.mkdir = vfs_mkdir,
+		.unlink = vfs_unlink,
+		.rename = vfs_rename,
+		.sync = vfs_sync,
 		.finalize = NULL
 };
 
@@ -37,20 +45,80 @@ HRESULT vfs_init() {
 	return S_OK;
 }
 
-HRESULT vfsnode_find_child(K_VFS_NODE *n, const char *child_name, uint32_t *id_out)
+/* Compares a node name with the first `len` characters of `name` */
+static BOOL vfsnode_name_equals(const char *node_name, const char *name, size_t len)
+{
+	size_t i;
+
+	for (i=0; i<len; i++) {
+		if (node_name[i] != name[i]) return FALSE;
+	}
+
+	return node_name[len] == '\0';
+}
+
+/* Finds a child by the first `len` characters of `name`, which hash to `hash` */
+static K_VFS_NODE *vfsnode_lookup(K_VFS_NODE *n, const char *name, size_t len, uint32_t hash)
+{
+	K_VFS_NODE *ch;
+
+	if (n->child_hash_size == 0) {
+		return NULL;
+	}
+
+	ch = n->child_hash[hash & (n->child_hash_size - 1)];
+
+	while (ch != NULL) {
+		if (ch->name_hash == hash && vfsnode_name_equals(ch->desc.name, name, len)) {
+			return ch;
+		}
+
+		ch = ch->hash_next;
+	}
+
+	return NULL;
+}
+
+HRESULT vfsnode_find_child(K_VFS_NODE *n, const char *child_name, K_VFS_NODE **out)
+{
+	size_t len = strlen(child_name);
+	K_VFS_NODE *ch = vfsnode_lookup(n, child_name, len, dcache_hash_name(child_name, len));
+
+	if (ch == NULL) {
+		return E_NOTFOUND;
+	}
+
+	*out = ch;
+	return S_OK;
+}
+
+/* Rebuilds the child hash table of `n` with `size` buckets */
+static HRESULT vfsnode_rehash(K_VFS_NODE *n, uint32_t size)
 {
+	K_VFS_NODE **table = kcalloc(sizeof(void*) * size);
 	int32_t i;
 
+	if (!table) {
+		/* Out of memory */
+		return E_FAIL;
+	}
+
 	for (i=0; i<n->child_cnt; i++) {
 		K_VFS_NODE *ch = n->children[i];
+		uint32_t b = ch->name_hash & (size - 1);
 
-		if (strcmp(ch->desc.name, child_name) == 0) {
-			*id_out = i;
-			return S_OK;
-		}
+		ch->hash_next = table[b];
+		table[b] = ch;
+	}
+
+	if (n->child_hash) {
+		kfree(n->child_hash);
 	}
 
-	return E_NOTFOUND;
+	n->child_hash = table;
+	n->child_hash_size = size;
+
+	return S_OK;
 }
 
 void vfsnode_addref(K_VFS_NODE *n)
@@ -69,8 +137,8 @@ uint32_t vfsnode_release(K_VFS_NODE *n)
 HRESULT vfsnode_add_child(K_VFS_NODE *n, char *node_name, uint32_t node_type, K_VFS_NODE **new_out)
 {
 	/* Check weather node with such name already exists */
-	uint32_t id;
-	if (vfsnode_find_child(n, node_name, &id) == S_OK) {
+	K_VFS_NODE *existing;
+	if (vfsnode_find_child(n, node_name, &existing) == S_OK) {
 		/* Node with same name already exists */
 		return E_INVALIDARG;
 	}
@@ -91,18 +159,32 @@ HRESULT vfsnode_add_child(K_VFS_NODE *n, char *node_name, uint32_t node_type, K_
 		}
 	}
 
+	if ((uint32_t)n->child_cnt >= n->child_hash_size) {
+		/* Keep the load of the hash table below one */
+		uint32_t size = n->child_hash_size ? n->child_hash_size * 2 : VFS_CHILD_HASH_MIN;
+
+		if (FAILED(vfsnode_rehash(n, size))) {
+			return E_FAIL;
+		}
+	}
+
 	/* Create new node and populate it with data */
 	K_VFS_NODE *new = kcalloc(sizeof(K_VFS_NODE));
 	strcpy(new->desc.name, node_name);
 	new->desc.type = node_type;
 	new->desc.index = n->child_cnt;
 	new->parent = n;
+	new->name_hash = dcache_hash_name(node_name, strlen(node_name));
 
 	mutex_create(&new->lock);
 
 	/* Add the new node as child */
 	n->children[n->child_cnt++] = new;
 
+	uint32_t b = new->name_hash & (n->child_hash_size - 1);
+	new->hash_next = n->child_hash[b];
+	n->child_hash[b] = new;
+
 	*new_out = new;
 	return S_OK;
 }
@@ -172,30 +254,20 @@ HRESULT vfs_parse_url(char *dirname, K_VFS_NODE *vfs_root, K_VFS_NODE **out, uin
 
 	/* Search across the file system */
 	for (i=0; i<(int32_t)comp_count; i++) {
-		char comp_name[256];
-
-		/* Find length of the component name */
-		const char *s = strchr(components[i], VFS_PATH_DELIMITER);
+		const char *comp = components[i];
+		uint32_t hash = 2166136261u;
 
-		if (!s) {
-			len = strlen(components[i]);
-		} else {
-			len = (uint32_t)(s - components[i]);
+		/* Find length of the component name and hash it in the same pass
+		 * (FNV-1a, same as dcache_hash_name()).
+		 */
+		for (len=0; comp[len] != '\0' && comp[len] != VFS_PATH_DELIMITER; len++) {
+			hash ^= (uint8_t)comp[len];
+			hash *= 16777619u;
 		}
 
-		/* Copy component name to local variable */
-		memcpy(comp_name, components[i], len);
-		comp_name[len] = '\0';
-
-		uint32_t id;
-		HRESULT hr;
-
-		/* Find node with name 'comp_name' among node 'current_pos' children */
-		hr = vfsnode_find_child(current_pos, comp_name, &id);
-		if (FAILED(hr)) return hr;
-
-		/* Found */
-		current_pos = current_pos->children[id];
+		/* Find node with name 'comp' among node 'current_pos' children */
+		current_pos = vfsnode_lookup(current_pos, comp, len, hash);
+		if (current_pos == NULL) return E_NOTFOUND;
 
 		if (current_pos->desc.type & NODE_TYPE_MOUNTPOINT) {
 			/* We reached a mount-point, the nodes descending from _current-pos_
@@ -347,15 +419,23 @@ HRESULT vfs_closedir(K_DIR_STREAM **dirstr)
 HRESULT vfs_mkdir(K_FS_DRIVER *self, char *path, uint32_t mode)
 {
 	char dir_path[1024], dir_name[1024];
+	char ext_path[1024];
+	uint32_t is_external_fs;
 	UNUSED_ARG(self);
 
 	url_get_dirname(path, dir_path);
 
-	/* Find directory
-	 * TODO: handle mountpoint redirect
-	 */
+	/* Find directory */
 	K_VFS_NODE *parent, *new;
-	HRESULT hr = vfs_parse_url(dir_path, vfs_root, &parent, NULL, NULL, NULL);
+	HRESULT hr = vfs_parse_url(path, vfs_root, &parent, &is_external_fs, NULL, ext_path);
+
+	if (SUCCEEDED(hr) && is_external_fs) {
+		/* Directory is created inside a mounted file system */
+		if (parent->desc.fs_driver->mkdir == NULL) return E_NOTSUPPORTED;
+		return parent->desc.fs_driver->mkdir(parent->desc.fs_driver, ext_path, mode);
+	}
+
+	hr = vfs_parse_url(dir_path, vfs_root, &parent, NULL, NULL, NULL);
 	if (FAILED(hr)) return hr;
 
 	/* TO DO:
@@ -373,8 +453,110 @@ HRESULT vfs_mkdir(K_FS_DRIVER *self, char *path, uint32_t mode)
 	return hr;
 }
 
+/*
+ * Copies up to _size_ bytes of node content, starting at _pos_.
+ */
+static HRESULT vfs_node_read_at(K_VFS_NODE *vfs_node, uint32_t pos, size_t size, void *out_buf, size_t *bytes_read)
+{
+	uint32_t node_size = vfs_node->desc.size;
+
+	size_t effective_block_size = (pos >= node_size) ? 0 :
+			(pos + size > node_size) ? node_size - pos : size;
+
+	if (effective_block_size == 0) {
+		/* End of file */
+		if(bytes_read != NULL) {
+			*bytes_read=0;
+		}
+
+		return E_ENDOFSTR;
+	}
+
+	/* Read from content */
+	memcpy(out_buf, (uint8_t*)vfs_node->content + pos, effective_block_size);
+
+	if (bytes_read != NULL) {
+		*bytes_read = effective_block_size;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Makes sure node's content buffer can hold at least _required_ bytes.
+ */
+static HRESULT vfs_node_reserve(K_VFS_NODE *vfs_node, uint32_t required)
+{
+	/* Allocate content buffer, if it hasn't been allocated yet */
+	if (vfs_node->content_capacity == 0) {
+		vfs_node->content = kmalloc(required);
+		if (vfs_node->content == NULL) {
+			return E_OUTOFMEM;
+		}
+
+		vfs_node->content_capacity = required;
+	}
+
+	/* Grow content buffer, if necessary */
+	if (required > vfs_node->content_capacity) {
+		/* The new capacity is the required capacity * 1.2 */
+		uint32_t new_cap = required;
+		new_cap += new_cap * 2 / 10;
+
+		/* Realloc content buffer */
+		vfs_node->content = krealloc(vfs_node->content, new_cap);
+		if (vfs_node->content == NULL) {
+			return E_OUTOFMEM;
+		}
+
+		vfs_node->content_capacity = new_cap;
+	}
+
+	return S_OK;
+}
+
+/*
+ * Writes _size_ bytes to node content at _pos_. A gap between the end of
+ * file and _pos_ is filled with zeroes.
+ */
+static HRESULT vfs_node_write_at(K_VFS_NODE *vfs_node, uint32_t pos, size_t size, void *in_buf, size_t *bytes_written)
+{
+	HRESULT hr;
+
+	hr = vfs_node_reserve(vfs_node, pos + size);
+	if (FAILED(hr)) {
+		if (bytes_written) *bytes_written = 0;
+		return hr;
+	}
+
+	if (pos > vfs_node->desc.size) {
+		memset((uint8_t*)vfs_node->content + vfs_node->desc.size, 0, pos - vfs_node->desc.size);
+	}
+
+	/* Write */
+	memcpy((uint8_t*)vfs_node->content + pos, in_buf, size);
+
+	/* Keep mapped pages coherent */
+	if (vfs_node->page_cache) {
+		pagecache_update(vfs_node->page_cache, pos, size, in_buf);
+	}
+
+	if (pos + size > vfs_node->desc.size) {
+		vfs_node->desc.size = pos + size;
+	}
+
+	if (bytes_written) {
+		*bytes_written = size;
+	}
+
+	return S_OK;
+}
+
 HRESULT vfs_file_read(K_STREAM *str, const size_t block_size, void *out_buf, size_t *bytes_read)
 {
+	size_t	done;
+	HRESULT	hr;
+
 	K_VFS_NODE *vfs_node = str->priv_data;
 	if (!vfs_node) {
 		/* Unexpected. Maybe we receive a K_STREAM struct, allocated by another fs driver? */
@@ -387,39 +569,28 @@ HRESULT vfs_file_read(K_STREAM *str, const size_t block_size, void *out_buf, siz
 		return E_FAIL;
 	}
 
-	uint32_t node_size = vfs_node->desc.size;
-
 	/* Make some validations */
-	if (str->pos > node_size) {
+	if (str->pos > vfs_node->desc.size) {
 		HalKernelPanic("File pos is beyond it's size.");
 	}
 
-	size_t effective_block_size = (str->pos + block_size > node_size) ? node_size - str->pos : block_size;
-
-	if (effective_block_size == 0) {
-		/* End of file */
-		if(bytes_read != NULL) {
-			*bytes_read=0;
-		}
-
-		return E_ENDOFSTR;
-	}
-
-	/* Read from content */
-	memcpy(out_buf, (uint8_t*)vfs_node->content + str->pos, effective_block_size);
+	hr = vfs_node_read_at(vfs_node, str->pos, block_size, out_buf, &done);
 
 	/* Move file position */
-	str->pos += effective_block_size;
+	str->pos += done;
 
 	if (bytes_read != NULL) {
-		*bytes_read = effective_block_size;
+		*bytes_read = done;
 	}
 
-	return S_OK;
+	return hr;
 }
 
 HRESULT vfs_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, size_t *bytes_written)
 {
+	size_t	done;
+	HRESULT	hr;
+
 	K_VFS_NODE *vfs_node = str->priv_data;
 	if (!vfs_node) {
 		/* Unexpected. Maybe we receive a K_STREAM struct, allocated by another fs driver? */
@@ -432,70 +603,193 @@ HRESULT vfs_file_write(K_STREAM *str, const int32_t block_size, void *in_buf, si
 		return E_FAIL;
 	}
 
-	uint32_t node_size = vfs_node->desc.size;
-
 	/* Make some validations */
-	if (str->pos > node_size) {
+	if (str->pos > vfs_node->desc.size) {
 		HalKernelPanic("vfs_file_write(): File pos is beyond it's size.");
 	}
 
-	/* Allocate content buffer, if it hasn't been allocated yet */
-	if (vfs_node->content_capacity == 0) {
-		vfs_node->content = kmalloc(block_size);
-		if (vfs_node->content == NULL) {
-			if (bytes_written) *bytes_written = 0;
-			return E_OUTOFMEM;
-		}
+	hr = vfs_node_write_at(vfs_node, str->pos, block_size, in_buf, &done);
+
+	/* Move cursor */
+	str->pos += done;
+
+	if (bytes_written) {
+		*bytes_written = done;
+	}
+
+	return hr;
+}
 
-		vfs_node->content_capacity = block_size;
+HRESULT vfs_file_readv(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_read)
+{
+	K_VFS_NODE	*vfs_node = str->priv_data;
+	size_t		total = 0, done;
+	HRESULT		hr = S_OK;
+
+	if ((str->mode & FILE_OPEN_READ) == 0) {
+		if (bytes_read) { *bytes_read = 0; }
+		return E_FAIL;
 	}
 
-	/* Grow content buffer, if necessary */
-	if (str->pos + block_size > vfs_node->content_capacity) {
-		/* The new capacity is the required capacity * 1.2 */
-		uint32_t new_cap = str->pos + block_size;
-		new_cap += new_cap * 2 / 10;
+	mutex_lock(&str->lock);
 
-		/* Realloc content buffer */
-		vfs_node->content = krealloc(vfs_node->content, new_cap);
-		if (vfs_node->content == NULL) {
-			if (bytes_written) *bytes_written = 0;
-			return E_OUTOFMEM;
-		}
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		hr = vfs_node_read_at(vfs_node, str->pos, iov[i].len, iov[i].base, &done);
 
-		vfs_node->content_capacity = new_cap;
+		str->pos += done;
+		total += done;
+
+		if (FAILED(hr) || done < iov[i].len) break;
 	}
 
-	uint8_t *content_pos = (uint8_t*)vfs_node->content + str->pos;
+	mutex_unlock(&str->lock);
 
-	/* Write */
-	memcpy(content_pos, in_buf, block_size);
+	if (bytes_read) {
+		*bytes_read = total;
+	}
 
-	/* Move cursor */
-	str->pos += block_size;
-	if (str->pos > vfs_node->desc.size) {
-		vfs_node->desc.size = str->pos;
+	return total > 0 ? S_OK : hr;
+}
+
+HRESULT vfs_file_writev(K_STREAM *str, const K_IOVEC *iov, uint32_t iov_cnt, size_t *bytes_written)
+{
+	K_VFS_NODE	*vfs_node = str->priv_data;
+	size_t		total = 0, done;
+	HRESULT		hr;
+
+	if ((str->mode & FILE_OPEN_WRITE) == 0) {
+		if (bytes_written) { *bytes_written = 0; }
+		return E_FAIL;
+	}
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		total += iov[i].len;
+	}
+
+	mutex_lock(&str->lock);
+
+	/* Grow content buffer once for the whole vector */
+	hr = vfs_node_reserve(vfs_node, str->pos + total);
+	if (FAILED(hr)) {
+		total = 0;
+		goto finally;
+	}
+
+	for (uint32_t i=0; i<iov_cnt; i++) {
+		vfs_node_write_at(vfs_node, str->pos, iov[i].len, iov[i].base, &done);
+		str->pos += done;
 	}
 
+finally:
+	mutex_unlock(&str->lock);
+
 	if (bytes_written) {
-		*bytes_written = block_size;
+		*bytes_written = total;
 	}
 
-	return S_OK;
+	return hr;
+}
+
+HRESULT vfs_file_pread(K_STREAM *str, uint64_t offset, size_t size, void *out_buf, size_t *bytes_read)
+{
+	if ((str->mode & FILE_OPEN_READ) == 0 || offset > 0xFFFFFFFF) {
+		if (bytes_read) { *bytes_read = 0; }
+		return E_FAIL;
+	}
+
+	return vfs_node_read_at(str->priv_data, (uint32_t)offset, size, out_buf, bytes_read);
+}
+
+HRESULT vfs_file_pwrite(K_STREAM *str, uint64_t offset, size_t size, void *in_buf, size_t *bytes_written)
+{
+	if ((str->mode & FILE_OPEN_WRITE) == 0 || offset + size > 0xFFFFFFFF) {
+		if (bytes_written) { *bytes_written = 0; }
+		return E_FAIL;
+	}
+
+	return vfs_node_write_at(str->priv_data, (uint32_t)offset, size, in_buf, bytes_written);
+}
+
+/*
+ * Fills page cache pages of a VFS file.
+ */
+static HRESULT vfs_node_fill(K_STREAM *s, uint64_t offset, size_t size, void *dst, size_t *bytes_read)
+{
+	if (offset > 0xFFFFFFFF) {
+		if (bytes_read) *bytes_read = 0;
+		return E_ENDOFSTR;
+	}
+
+	return vfs_node_read_at(s->priv_data, (uint32_t)offset, size, dst, bytes_read);
 }
 
 HRESULT vfs_file_ioctl(K_STREAM *s, uint32_t code, void *arg)
 {
+	K_VFS_NODE	*node = s->priv_data;
+	HRESULT		hr;
+
+	if (code == IOCTL_FILE_GET_PAGECACHE) {
+		if (arg == NULL) return E_POINTER;
+
+		/* Content is in memory already, so the inode is created only when
+		 * the file is mapped. The node keeps it's reference for good.
+		 */
+		mutex_lock(&node->lock);
+
+		if (node->page_cache == NULL) {
+			hr = pagecache_open_inode(&vfs_fs_driver, (uintptr_t)node, node->desc.size, vfs_node_fill, &node->page_cache);
+			if (FAILED(hr)) {
+				mutex_unlock(&node->lock);
+				return hr;
+			}
+		}
+
+		*(K_PAGECACHE_INODE**)arg = node->page_cache;
+		mutex_unlock(&node->lock);
+
+		return S_OK;
+	}
+
 	/* VFS should gracefully fail when being requested to perform
-	 * ioctl() on a file.
+	 * other ioctl() on a file.
 	 */
-	UNUSED_ARG(s);
-	UNUSED_ARG(code);
-	UNUSED_ARG(arg);
-
 	return E_FAIL;
 }
 
+HRESULT vfs_mmap(K_STREAM *s, uint64_t offset, size_t size, uint32_t flags, void *proc, void **out)
+{
+	K_PAGECACHE_INODE	*inode;
+	HRESULT				hr;
+
+	if (s == NULL || out == NULL) {
+		return E_POINTER;
+	}
+
+	if ((s->mode & FILE_OPEN_READ) == 0) {
+		return E_ACCESSDENIED;
+	}
+
+	/* Stream lock is taken before the page cache lock, as on reads */
+	mutex_lock(&s->lock);
+
+	hr = s->ioctl(s, IOCTL_FILE_GET_PAGECACHE, &inode);
+	if (FAILED(hr)) {
+		hr = E_NOTSUPPORTED;
+		goto finally;
+	}
+
+	hr = pagecache_map(inode, s, proc, offset, size, flags, out);
+
+finally:
+	mutex_unlock(&s->lock);
+	return hr;
+}
+
+HRESULT vfs_munmap(void *proc, void *addr)
+{
+	return pagecache_unmap(proc, addr);
+}
+
 uint32_t vfs_file_seek(K_STREAM *s, int64_t pos, int8_t origin)
 {
 	int32_t new_pos;
@@ -781,6 +1075,9 @@ HRESULT vfs_unmount_fs(char *mount_path)
 		hr = node->desc.fs_driver->finalize(node->desc.fs_driver);
 		if (FAILED(hr)) hr = S_FALSE;
 
+		/* Drop whatever the driver left in the dentry cache */
+		dcache_invalidate_owner(node->desc.fs_driver);
+
 		/* Free instance memory */
 		kfree(node->desc.fs_driver);
 	}
@@ -844,6 +1141,10 @@ HRESULT vfs_open(K_FS_DRIVER *self, char *filename, uint32_t fmode, K_STREAM **o
 		str->write = vfs_file_write;
 		str->ioctl = vfs_file_ioctl;
 		str->close = vfs_close;
+		str->readv = vfs_file_readv;
+		str->writev = vfs_file_writev;
+		str->pread = vfs_file_pread;
+		str->pwrite = vfs_file_pwrite;
 	}else if (node->desc.type == NODE_TYPE_BLOCKDEVICE || node->desc.type == NODE_TYPE_CHARDEVICE) {
 		/* Populate methods (for devices) */
 		K_DEVICE *dev = node->content;
@@ -853,6 +1154,11 @@ HRESULT vfs_open(K_FS_DRIVER *self, char *filename, uint32_t fmode, K_STREAM **o
 		str->write = dev->write;
 		str->ioctl = dev->ioctl;
 		str->close = vfs_close;
+		str->readv = dev->readv;
+		str->writev = dev->writev;
+		str->pread = dev->pread;
+		str->pwrite = dev->pwrite;
+		str->submit = dev->submit;
 
 		/* Issue a DEVIO_OPEN command, to let the device know it is being opened. */
 		hr = str->ioctl(str, DEVIO_OPEN, NULL);
@@ -870,6 +1176,95 @@ fail:
 	return E_FAIL;
 }
 
+HRESULT vfs_unlink(K_FS_DRIVER *self, char *path)
+{
+	K_VFS_NODE 	*node;
+	uint32_t 	is_external_fs;
+	char		ext_path[1024];
+
+	UNUSED_ARG(self);
+
+	/* Find VFS node by URL/filename */
+	HRESULT hr = vfs_parse_url(path, vfs_root, &node, &is_external_fs, NULL, ext_path);
+	if (FAILED(hr)) return hr;
+
+	if (is_external_fs) {
+		/* Redirect the remaining path to the mounted fs driver */
+		if (node->desc.fs_driver->unlink == NULL) return E_NOTSUPPORTED;
+		return node->desc.fs_driver->unlink(node->desc.fs_driver, ext_path);
+	}
+
+	/* VFS nodes can't be removed yet */
+	return E_NOTSUPPORTED;
+}
+
+HRESULT vfs_rename(K_FS_DRIVER *self, char *old_path, char *new_path)
+{
+	K_VFS_NODE 	*old_node, *new_node;
+	uint32_t 	old_external, new_external;
+	char		old_ext[1024], new_ext[1024];
+
+	UNUSED_ARG(self);
+
+	HRESULT hr = vfs_parse_url(old_path, vfs_root, &old_node, &old_external, NULL, old_ext);
+	if (FAILED(hr)) return hr;
+
+	hr = vfs_parse_url(new_path, vfs_root, &new_node, &new_external, NULL, new_ext);
+	if (FAILED(hr)) return hr;
+
+	if (!old_external || !new_external) {
+		/* VFS nodes can't be renamed yet */
+		return E_NOTSUPPORTED;
+	}
+
+	if (old_node != new_node) {
+		/* Moving across file systems takes a copy */
+		return E_NOTSUPPORTED;
+	}
+
+	if (old_node->desc.fs_driver->rename == NULL) return E_NOTSUPPORTED;
+	return old_node->desc.fs_driver->rename(old_node->desc.fs_driver, old_ext, new_ext);
+}
+
+/*
+ * Calls the sync routine of every file system mounted below `n`.
+ */
+static HRESULT vfs_sync_node(K_VFS_NODE *n)
+{
+	HRESULT hr = S_OK, r;
+	int32_t i;
+
+	if (n->desc.type & NODE_TYPE_MOUNTPOINT) {
+		if (n->desc.fs_driver->sync != NULL) {
+			return n->desc.fs_driver->sync(n->desc.fs_driver);
+		}
+
+		return S_OK;
+	}
+
+	for (i=0; i<n->child_cnt; i++) {
+		r = vfs_sync_node(n->children[i]);
+		if (FAILED(r)) hr = r;
+	}
+
+	return hr;
+}
+
+HRESULT vfs_sync(K_FS_DRIVER *self)
+{
+	HRESULT hr, r;
+
+	UNUSED_ARG(self);
+
+	/* File systems write their metadata to the buffer cache first */
+	hr = vfs_sync_node(vfs_root);
+
+	r = bcache_sync();
+	if (FAILED(r)) hr = r;
+
+	return hr;
+}
+
 HRESULT vfs_close(K_STREAM **str)
 {
 	K_STREAM *s = *str;
@@ -922,22 +1317,22 @@ HRESULT vfs_selftest() {
 
 //	vga_printf()
 	hr = k_mkdir("/newdir", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 	hr = k_mkdir("/newdir1", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 	hr = k_mkdir("/newdir2", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 	hr = k_mkdir("/newdir2/subdir1", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 	hr = k_mkdir("/newdir2/subdir2", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 	hr = k_mkdir("/newdir2/subdir3", NODE_MODE_ALL_RWE);
-	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=%x\n", hr); return hr; }
+	if (FAILED(hr)) { vga_printf("vfs_selftest(): failed. hr=0x%X\n", hr); return hr; }
 
 
 	vfs_selftest_list_dir("/");
@@ -188,8 +188,10 @@ void vga_set_color(vga_color fg, vga_color bg)
 	term_bg = bg;
 }
 
-//todo: documentations
-void __nxapi vga_print(char *str)
+/*
+ * Prints _len_ characters of _str_, which doesn't need to be null-terminated.
+ */
+void __nxapi vga_write(const char *str, size_t len)
 {
 	K_SPINLOCK sl;
 	spinlock_create(&sl);
@@ -202,7 +204,7 @@ void __nxapi vga_print(char *str)
 
 //	mutex_lock(&vga_lock);
 
-	while (*str != '\0') {
+	while (len-- > 0) {
 		/*
 		 * Check current character, and parse it if is a special one
 		 */
@@ -230,16 +232,23 @@ void __nxapi vga_print(char *str)
 	spinlock_release(&sl, intf);
 }
 
-void __nxapi vga_printf(char *fmt, ...)
+//todo: documentations
+void __nxapi vga_print(char *str)
 {
-	char buffer[1024];
+	vga_write(str, strlen(str));
+}
+
+static void vga_sink(void *ctx, const char *str, size_t len)
+{
+	UNUSED_ARG(ctx);
+	vga_write(str, len);
+}
 
+void __nxapi vga_printf(char *fmt, ...)
+{
 	va_list args;
 	va_start(args, fmt);
-	vsprintf(buffer, fmt, args);
+	vcbprintf(vga_sink, NULL, fmt, args);
 	va_end(args);
-
-	//Write formatted string with vga_print()
-	vga_print(buffer);
 }
 //TODO: sprintf()